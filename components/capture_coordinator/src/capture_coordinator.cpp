@@ -0,0 +1,135 @@
+#include <signal.h>
+#include <stdio.h>
+#include <time.h>
+#include <tclap/CmdLine.h>
+
+#include "coordinator.h"
+
+static volatile bool s_stop = false;
+
+static void onSignal(int) {
+	s_stop = true;
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+static bool saveVisible(const PXL_CAPTURED_FRAME* pFrame, const std::string& filename) {
+	U32 size = 0;
+	if (!API_SUCCESS(PxLFormatImage(pFrame->pData, (FRAME_DESC*)&pFrame->frameDesc, IMAGE_FORMAT_BMP, NULL, &size))) return false;
+	std::vector<U8> image(size);
+	if (!API_SUCCESS(PxLFormatImage(pFrame->pData, (FRAME_DESC*)&pFrame->frameDesc, IMAGE_FORMAT_BMP, &image[0], &size))) return false;
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (NULL == pFile) return false;
+	bool ok = size == fwrite(&image[0], 1, size, pFile);
+	fclose(pFile);
+	return ok;
+}
+
+static bool saveThermal(const ThermalFrame* pFrame, const std::string& filename) {
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (NULL == pFile) return false;
+	fprintf(pFile, "P6\n%d %d\n255\n", CAM_WIDTH, CAM_HEIGHT);
+	for (int y = 0; y < CAM_HEIGHT; y++) {
+		for (int x = 0; x < CAM_WIDTH; x++) fwrite(&pFrame->image[x][y], sizeof(struct pixel), 1, pFile);
+	}
+	bool ok = !ferror(pFile);
+	fclose(pFile);
+	return ok;
+}
+
+static void report(CaptureCoordinator& coordinator) {
+	PairingStats stats = coordinator.stats();
+	ClockStats visible = coordinator.visibleClock();
+	ClockStats thermal = coordinator.thermalClock();
+	printf("%llu pairs, %llu/%llu unpaired (visible/thermal); skew mean %.3f rms %.3f p50 %.3f p99 %.3f max %.3f ms\n",
+			(unsigned long long)stats.pairs, (unsigned long long)stats.unpairedVisible,
+			(unsigned long long)stats.unpairedThermal, stats.meanSkew * 1000.0, stats.rmsSkew * 1000.0,
+			stats.p50Skew * 1000.0, stats.p99Skew * 1000.0, stats.maxSkew * 1000.0);
+	printf("  visible clock offset %.6f s drift %.2f ppm; thermal clock offset %.6f s drift %.2f ppm\n",
+			visible.offset, visible.driftPpm, thermal.offset, thermal.driftPpm);
+}
+
+int main(int argc, char** argv) {
+	try {
+		TCLAP::CmdLine cmd("Pairs Pixelink frames with FLIR Lepton frames, by when they were taken", ' ', "0.1A");
+		TCLAP::UnlabeledValueArg<std::string> thermal_file_arg("thermal",
+				"flir_camdev's shared frame file", true, "", "thermal");
+		TCLAP::ValueArg<double> skew_arg("s", "skew",
+				"Furthest apart the frames of a pair may be, in ms", false, 20.0, "ms");
+		TCLAP::ValueArg<double> latency_arg("l", "thermal-latency",
+				"From a Lepton frame being taken to flir_camdev having it, in ms", false, 0.0, "ms");
+		TCLAP::ValueArg<unsigned> camera_arg("c", "camera",
+				"Which of the Pixelink cameras to use", false, 0, "index");
+		TCLAP::ValueArg<unsigned> duration_arg("d", "duration",
+				"Seconds to run for; 0 to run until interrupted", false, 0, "seconds");
+		TCLAP::ValueArg<std::string> output_arg("o", "output",
+				"Save every pair, as <output>-<n>-visible.bmp and <output>-<n>-thermal.ppm", false, "", "prefix");
+
+		cmd.add(thermal_file_arg);
+		cmd.add(skew_arg);
+		cmd.add(latency_arg);
+		cmd.add(camera_arg);
+		cmd.add(duration_arg);
+		cmd.add(output_arg);
+		cmd.parse(argc, argv);
+
+		ThermalSource thermal;
+		if (!thermal.open(thermal_file_arg.getValue().c_str())) {
+			printf("error: could not map %s\n", thermal_file_arg.getValue().c_str());
+			return 1;
+		}
+
+		// The visible frames wait, in the engine's buffers, for their thermal partner
+		PxLCaptureEngine engine(2 * PXL_CAPTURE_DEFAULT_BUFFERS);
+		PXL_RETURN_CODE rc = engine.open();
+		if (!API_SUCCESS(rc)) {
+			printf("error: could not open the Pixelink camera (0x%08X)\n", rc);
+			return 1;
+		}
+
+		CaptureCoordinator coordinator(engine, camera_arg.getValue(), thermal, skew_arg.getValue() / 1000.0,
+				latency_arg.getValue() / 1000.0);
+		rc = coordinator.start();
+		if (!API_SUCCESS(rc)) {
+			printf("error: could not start capturing (0x%08X)\n", rc);
+			return 1;
+		}
+
+		signal(SIGINT, onSignal);
+		signal(SIGTERM, onSignal);
+		std::string output = output_arg.getValue();
+		double start = now();
+		double lastReport = start;
+		unsigned long long saved = 0;
+		while (!s_stop && (0 == duration_arg.getValue() || now() - start < duration_arg.getValue())) {
+			CapturePair pair;
+			if (coordinator.nextPair(&pair, 0.5)) {
+				if (!output.empty()) {
+					char name[32];
+					snprintf(name, sizeof(name), "-%llu", saved++);
+					if (!saveVisible(pair.pVisible, output + name + "-visible.bmp") ||
+							!saveThermal(pair.pThermal, output + name + "-thermal.ppm")) {
+						printf("error: could not save pair %s\n", name + 1);
+					}
+				}
+				coordinator.release(&pair);
+			}
+			if (now() - lastReport >= 1.0) {
+				report(coordinator);
+				lastReport = now();
+			}
+		}
+
+		coordinator.stop();
+		report(coordinator);
+		engine.close();
+		return 0;
+	} catch (TCLAP::ArgException &e) {
+		printf("error: %s for arg %s\n", e.error().c_str(), e.argId().c_str());
+		return 1;
+	}
+}
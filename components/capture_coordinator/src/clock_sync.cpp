@@ -0,0 +1,95 @@
+#include <math.h>
+#include "clock_sync.h"
+
+ClockSync::ClockSync(double window)
+	: m_window(window), m_origin(0.0), m_offset(0.0), m_drift(0.0) {
+}
+
+void ClockSync::reset() {
+	m_samples.clear();
+	m_origin = 0.0;
+	m_offset = 0.0;
+	m_drift = 0.0;
+}
+
+void ClockSync::addSample(double deviceTime, double hostTime) {
+	// A device clock that goes backwards has been reset (the device restarted); start again
+	if (!m_samples.empty() && deviceTime < m_samples.back().device) reset();
+
+	Sample sample;
+	sample.device = deviceTime;
+	sample.offset = hostTime - deviceTime;
+	m_samples.push_back(sample);
+	while (m_samples.front().device < deviceTime - m_window) m_samples.pop_front();
+
+	fit();
+}
+
+double ClockSync::offset() const {
+	if (m_samples.empty()) return 0.0;
+	return m_offset + m_drift * (m_samples.back().device - m_origin);
+}
+
+double ClockSync::spread() const {
+	if (m_samples.empty()) return 0.0;
+	return m_samples.back().offset - offset();
+}
+
+void ClockSync::fit() {
+	double first = m_samples.front().device;
+	double last = m_samples.back().device;
+	double span = last - first;
+
+	//
+	// Step 1
+	//      The fastest sample of each bin.  Too short a span to see drift in is one bin, and the drift we had
+	Sample fastest[CLOCK_SYNC_BINS];
+	bool   have[CLOCK_SYNC_BINS] = {false};
+	int    bins = span < CLOCK_SYNC_MIN_SPAN ? 1 : CLOCK_SYNC_BINS;
+	for (size_t i = 0; i < m_samples.size(); i++) {
+		const Sample& sample = m_samples[i];
+		int bin = bins == 1 ? 0 : (int)((sample.device - first) / span * bins);
+		if (bin >= bins) bin = bins - 1;
+		if (!have[bin] || sample.offset < fastest[bin].offset) {
+			fastest[bin] = sample;
+			have[bin] = true;
+		}
+	}
+
+	//
+	// Step 2
+	//      Fit a line through them, about the middle of the window, for the drift.  Then lower it until it
+	//      runs under all of them; anything above the line is latency, not offset
+	double drift = m_drift;
+	double origin = first + span / 2.0;
+	double sumX = 0.0, sumY = 0.0, sumXX = 0.0, sumXY = 0.0;
+	int    n = 0;
+	for (int i = 0; i < bins; i++) {
+		if (!have[i]) continue;
+		double x = fastest[i].device - origin;
+		double y = fastest[i].offset;
+		sumX += x;
+		sumY += y;
+		sumXX += x * x;
+		sumXY += x * y;
+		n++;
+	}
+	double denominator = n * sumXX - sumX * sumX;
+	if (n >= 3 && denominator > 0.0) {
+		drift = (n * sumXY - sumX * sumY) / denominator;
+		if (fabs(drift) > CLOCK_SYNC_MAX_DRIFT) drift = m_drift;
+	}
+
+	double offset = 0.0;
+	bool   haveOffset = false;
+	for (int i = 0; i < bins; i++) {
+		if (!have[i]) continue;
+		double intercept = fastest[i].offset - drift * (fastest[i].device - origin);
+		if (!haveOffset || intercept < offset) offset = intercept;
+		haveOffset = true;
+	}
+
+	m_origin = origin;
+	m_drift = drift;
+	m_offset = offset;
+}
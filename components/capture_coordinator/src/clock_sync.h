@@ -0,0 +1,51 @@
+#pragma once
+
+#include <deque>
+
+#define CLOCK_SYNC_WINDOW    30.0     // Seconds of samples the fit is made over
+#define CLOCK_SYNC_BINS      8        // The window is cut into this many, and the fastest sample of each is fitted
+#define CLOCK_SYNC_MIN_SPAN  2.0      // Seconds of samples needed before drift is estimated
+#define CLOCK_SYNC_MAX_DRIFT 1.0e-3   // Anything beyond 1000 ppm is a bad fit, not a real clock
+
+// Maps a device's clock onto the host's CLOCK_MONOTONIC.
+//
+// Each sample is a device time, and a host time no earlier than when the
+// device read it; a timestamp read back from the device, or a frame's
+// timestamp and when the frame arrived.  The difference (host - device) is
+// the clock offset plus however long the sample took to reach us, so the
+// fastest samples are the truest.  The window of samples is cut into bins,
+// and a line is fitted through the fastest sample of each.  Its slope is the
+// drift between the two clocks; lowered until it runs under them all, it is
+// the offset.  The fit is made again on every sample, so the offset and drift
+// follow the clocks as they wander.
+class ClockSync {
+public:
+	explicit ClockSync(double window = CLOCK_SYNC_WINDOW);
+
+	void addSample(double deviceTime, double hostTime);
+	void reset();
+
+	bool   valid() const { return !m_samples.empty(); }
+	size_t sampleCount() const { return m_samples.size(); }
+
+	// deviceTime, on the host's clock
+	double toHost(double deviceTime) const { return deviceTime + m_offset + m_drift * (deviceTime - m_origin); }
+
+	double offset() const;                        // Host - device, as of the newest sample (seconds)
+	double driftPpm() const { return m_drift * 1.0e6; }  // How fast the offset changes, against the device clock
+	double spread() const;                        // Of the newest sample above the fit; what the last sample's latency cost (seconds)
+
+private:
+	struct Sample {
+		double device;
+		double offset;  // host - device
+	};
+
+	void fit();
+
+	double             m_window;
+	std::deque<Sample> m_samples;  // Oldest first
+	double             m_origin;   // Device time the fit is about
+	double             m_offset;   // At m_origin
+	double             m_drift;
+};
@@ -0,0 +1,227 @@
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include "coordinator.h"
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+CaptureCoordinator::CaptureCoordinator(PxLCaptureEngine& engine, U32 camera, ThermalSource& thermal, double maxSkew,
+		double thermalLatency, double maxLatency)
+	: m_engine(engine), m_camera(camera), m_thermal(thermal), m_thermalLatency(thermalLatency),
+	  m_matcher(maxSkew, maxLatency), m_stop(false), m_started(false) {
+	pthread_mutex_init(&m_mutex, NULL);
+	pthread_cond_init(&m_cond, NULL);
+}
+
+CaptureCoordinator::~CaptureCoordinator() {
+	stop();
+	pthread_cond_destroy(&m_cond);
+	pthread_mutex_destroy(&m_mutex);
+}
+
+PXL_RETURN_CODE CaptureCoordinator::start() {
+	if (m_started) return ApiSuccess;
+	if (m_camera >= m_engine.cameraCount()) return ApiInvalidParameterError;
+
+	//
+	// Step 1
+	//      Start the camera, and get a first fix on its clock, so its first frames can be placed
+	PXL_RETURN_CODE rc = m_engine.start();
+	if (!API_SUCCESS(rc)) return rc;
+	for (int i = 0; i < COORDINATOR_CLOCK_SAMPLES; i++) sampleCameraClock();
+
+	//
+	// Step 2
+	//      Our threads
+	m_stop = false;
+	if (0 != pthread_create(&m_visibleThread, NULL, visibleThread, this)) {
+		m_engine.stop();
+		return ApiOSServiceError;
+	}
+	if (0 != pthread_create(&m_thermalThread, NULL, thermalThread, this)) {
+		m_stop = true;
+		pthread_join(m_visibleThread, NULL);
+		m_engine.stop();
+		return ApiOSServiceError;
+	}
+	m_started = true;
+	return ApiSuccess;
+}
+
+void CaptureCoordinator::stop() {
+	if (!m_started) return;
+	m_stop = true;
+	pthread_join(m_visibleThread, NULL);
+	pthread_join(m_thermalThread, NULL);
+	m_started = false;
+
+	// Whatever the consumer hasn't taken, or was still waiting for a partner
+	pthread_mutex_lock(&m_mutex);
+	std::vector<void*> visible;
+	std::vector<void*> thermal;
+	m_matcher.flush(visible, thermal);
+	for (size_t i = 0; i < m_pairs.size(); i++) {
+		visible.push_back(m_pairs[i].pVisible);
+		thermal.push_back(m_pairs[i].pThermal);
+	}
+	m_pairs.clear();
+	pthread_mutex_unlock(&m_mutex);
+	discard(visible, thermal);
+
+	m_engine.stop();
+}
+
+bool CaptureCoordinator::nextPair(CapturePair* pPair, double timeout) {
+	struct timespec deadline;
+	clock_gettime(CLOCK_REALTIME, &deadline);
+	double seconds = (double)deadline.tv_sec + (double)deadline.tv_nsec / 1.0e9 + timeout;
+	deadline.tv_sec = (time_t)seconds;
+	deadline.tv_nsec = (long)((seconds - (double)deadline.tv_sec) * 1.0e9);
+
+	pthread_mutex_lock(&m_mutex);
+	while (m_pairs.empty()) {
+		if (ETIMEDOUT == pthread_cond_timedwait(&m_cond, &m_mutex, &deadline)) break;
+	}
+	bool havePair = !m_pairs.empty();
+	if (havePair) {
+		*pPair = m_pairs.front();
+		m_pairs.pop_front();
+	}
+	pthread_mutex_unlock(&m_mutex);
+	return havePair;
+}
+
+void CaptureCoordinator::release(CapturePair* pPair) {
+	m_engine.release(pPair->pVisible);
+	delete pPair->pThermal;
+	pPair->pVisible = NULL;
+	pPair->pThermal = NULL;
+}
+
+PairingStats CaptureCoordinator::stats() {
+	pthread_mutex_lock(&m_mutex);
+	PairingStats stats = m_matcher.stats();
+	pthread_mutex_unlock(&m_mutex);
+	return stats;
+}
+
+ClockStats CaptureCoordinator::clockStats(const ClockSync& clock) {
+	ClockStats stats;
+	stats.offset = clock.offset();
+	stats.driftPpm = clock.driftPpm();
+	stats.spread = clock.spread();
+	return stats;
+}
+
+ClockStats CaptureCoordinator::visibleClock() {
+	pthread_mutex_lock(&m_mutex);
+	ClockStats stats = clockStats(m_visibleClock);
+	pthread_mutex_unlock(&m_mutex);
+	return stats;
+}
+
+ClockStats CaptureCoordinator::thermalClock() {
+	pthread_mutex_lock(&m_mutex);
+	ClockStats stats = clockStats(m_thermalClock);
+	pthread_mutex_unlock(&m_mutex);
+	return stats;
+}
+
+void* CaptureCoordinator::visibleThread(void* pContext) {
+	((CaptureCoordinator*)pContext)->runVisible();
+	return NULL;
+}
+
+void* CaptureCoordinator::thermalThread(void* pContext) {
+	((CaptureCoordinator*)pContext)->runThermal();
+	return NULL;
+}
+
+// A reading of the camera's clock is good to no earlier than when we asked for it, and no later than when we got
+// it back; the latter is what ClockSync wants.
+void CaptureCoordinator::sampleCameraClock() {
+	double cameraTime;
+	if (!API_SUCCESS(PxLGetCurrentTimestamp(m_engine.camera(m_camera), &cameraTime))) return;
+	double hostTime = now();
+	pthread_mutex_lock(&m_mutex);
+	m_visibleClock.addSample(cameraTime, hostTime);
+	pthread_mutex_unlock(&m_mutex);
+}
+
+void CaptureCoordinator::runVisible() {
+	double lastSample = now();
+	while (!m_stop) {
+		if (now() - lastSample >= COORDINATOR_CLOCK_PERIOD) {
+			sampleCameraClock();
+			lastSample = now();
+		}
+
+		// Frames from the engine's other cameras aren't ours to pair
+		PXL_CAPTURED_FRAME* pFrame = m_engine.nextFrame(COORDINATOR_CLOCK_PERIOD / 2.0);
+		if (NULL != pFrame && pFrame->camera != m_camera) {
+			m_engine.release(pFrame);
+			pFrame = NULL;
+		}
+
+		pthread_mutex_lock(&m_mutex);
+		if (NULL != pFrame) m_matcher.addVisible(m_visibleClock.toHost(pFrame->frameDesc.fFrameTime), pFrame);
+		match();
+		pthread_mutex_unlock(&m_mutex);
+	}
+}
+
+void CaptureCoordinator::runThermal() {
+	ThermalFrame* pFrame = new ThermalFrame;
+	while (!m_stop) {
+		if (!m_thermal.poll(pFrame)) {
+			usleep(COORDINATOR_THERMAL_POLL);
+			continue;
+		}
+
+		double received = (double)pFrame->info.received_ns / 1.0e9;
+		pthread_mutex_lock(&m_mutex);
+		if (0 != pFrame->info.time_counter_ms) {
+			double deviceTime = (double)pFrame->info.time_counter_ms / 1000.0;
+			m_thermalClock.addSample(deviceTime, received);
+			pFrame->time = m_thermalClock.toHost(deviceTime) - m_thermalLatency;
+		} else {
+			pFrame->time = received - m_thermalLatency;
+		}
+		m_matcher.addThermal(pFrame->time, pFrame);
+		match();
+		pthread_mutex_unlock(&m_mutex);
+
+		pFrame = new ThermalFrame;
+	}
+	delete pFrame;
+}
+
+void CaptureCoordinator::match() {
+	std::vector<MatchedPair> pairs;
+	std::vector<void*> visible;
+	std::vector<void*> thermal;
+	m_matcher.match(now(), pairs, visible, thermal);
+
+	for (size_t i = 0; i < pairs.size(); i++) {
+		CapturePair pair;
+		pair.pVisible = (PXL_CAPTURED_FRAME*)pairs[i].pVisible;
+		pair.pThermal = (ThermalFrame*)pairs[i].pThermal;
+		pair.visibleTime = pairs[i].visibleTime;
+		pair.thermalTime = pairs[i].thermalTime;
+		pair.skew = pairs[i].skew;
+		m_pairs.push_back(pair);
+	}
+	if (!pairs.empty()) pthread_cond_broadcast(&m_cond);
+
+	// The engine has a lock of its own, but never takes ours, so releasing to it here is safe
+	discard(visible, thermal);
+}
+
+void CaptureCoordinator::discard(std::vector<void*>& visible, std::vector<void*>& thermal) {
+	for (size_t i = 0; i < visible.size(); i++) m_engine.release((PXL_CAPTURED_FRAME*)visible[i]);
+	for (size_t i = 0; i < thermal.size(); i++) delete (ThermalFrame*)thermal[i];
+}
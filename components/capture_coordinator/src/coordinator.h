@@ -0,0 +1,89 @@
+#pragma once
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+#include "PxLCaptureEngine.h"
+#include "clock_sync.h"
+#include "pair_matcher.h"
+#include "thermal_source.h"
+
+#define COORDINATOR_MAX_LATENCY    0.25    // Seconds a frame can take to reach us, after it was taken
+#define COORDINATOR_CLOCK_PERIOD   0.25    // Seconds between readings of the camera's clock
+#define COORDINATOR_CLOCK_SAMPLES  8       // Readings of the camera's clock, before we start
+#define COORDINATOR_THERMAL_POLL   2000    // Microseconds between looks for a new thermal frame
+
+// A visible frame, and the thermal one taken nearest to it
+struct CapturePair {
+	PXL_CAPTURED_FRAME* pVisible;
+	ThermalFrame*       pThermal;
+	double              visibleTime;  // Both on the host's monotonic clock (seconds)
+	double              thermalTime;
+	double              skew;         // visibleTime - thermalTime
+};
+
+struct ClockStats {
+	double offset;    // Host - device (seconds)
+	double driftPpm;
+	double spread;    // Latency of the newest sample, over the fit (seconds)
+};
+
+// Pairs the frames of a Pixelink camera with those of the FLIR Lepton.
+//
+// Both devices stamp their frames on clocks of their own:  the Pixelink's
+// FRAME_DESC::fFrameTime, and the Lepton's telemetry time counter.  Each is
+// mapped onto the host's CLOCK_MONOTONIC, with a ClockSync fed from the
+// camera's clock (PxLGetCurrentTimestamp, read in between the frames) and
+// from the Lepton's frame times against when flir_camdev received them.  A
+// Lepton without telemetry has only its receive times, less a known latency.
+//
+// The mapped frames go to a PairMatcher, and the pairs it makes come out of
+// nextPair().  The consumer must release() each pair, which returns the
+// visible frame to the capture engine's pool.
+class CaptureCoordinator {
+public:
+	// maxSkew:         Furthest apart (seconds) the two frames of a pair may be
+	// thermalLatency:  Seconds from a Lepton frame being taken, to flir_camdev having it
+	CaptureCoordinator(PxLCaptureEngine& engine, U32 camera, ThermalSource& thermal, double maxSkew,
+			double thermalLatency = 0.0, double maxLatency = COORDINATOR_MAX_LATENCY);
+	~CaptureCoordinator();
+
+	// Starts the capture engine, and our threads
+	PXL_RETURN_CODE start();
+	void stop();
+
+	// The next pair; false if there is none within timeout seconds
+	bool nextPair(CapturePair* pPair, double timeout);
+	void release(CapturePair* pPair);
+
+	PairingStats stats();
+	ClockStats   visibleClock();
+	ClockStats   thermalClock();
+
+private:
+	static void* visibleThread(void* pContext);
+	static void* thermalThread(void* pContext);
+	void runVisible();
+	void runThermal();
+	void sampleCameraClock();
+	void match();        // With m_mutex held
+	void discard(std::vector<void*>& visible, std::vector<void*>& thermal);
+	static ClockStats clockStats(const ClockSync& clock);
+
+	PxLCaptureEngine& m_engine;
+	U32               m_camera;
+	ThermalSource&    m_thermal;
+	double            m_thermalLatency;
+
+	pthread_mutex_t   m_mutex;     // Guards all below
+	pthread_cond_t    m_cond;      // Signalled as pairs are made
+	ClockSync         m_visibleClock;
+	ClockSync         m_thermalClock;
+	PairMatcher       m_matcher;
+	std::deque<CapturePair> m_pairs;
+
+	pthread_t         m_visibleThread;
+	pthread_t         m_thermalThread;
+	volatile bool     m_stop;
+	bool              m_started;
+};
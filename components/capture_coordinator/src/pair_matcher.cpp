@@ -0,0 +1,162 @@
+#include <math.h>
+#include "pair_matcher.h"
+
+PairMatcher::PairMatcher(double maxSkew, double maxLatency)
+	: m_maxSkew(maxSkew), m_maxLatency(maxLatency),
+	  m_pairs(0), m_unpairedVisible(0), m_unpairedThermal(0),
+	  m_sumSkew(0.0), m_sumSquaredSkew(0.0), m_maxSeen(0.0),
+	  m_histogram(PAIR_HISTOGRAM_BINS, 0) {
+}
+
+// Frames mostly come in order, but a clock fit that moves can put one a little before the last
+void PairMatcher::insert(std::deque<Entry>& queue, double time, void* pFrame) {
+	Entry entry;
+	entry.time = time;
+	entry.pFrame = pFrame;
+	std::deque<Entry>::iterator it = queue.end();
+	while (it != queue.begin() && (it - 1)->time > time) --it;
+	queue.insert(it, entry);
+}
+
+void PairMatcher::addVisible(double time, void* pFrame) {
+	insert(m_visible, time, pFrame);
+}
+
+void PairMatcher::addThermal(double time, void* pFrame) {
+	insert(m_thermal, time, pFrame);
+}
+
+void PairMatcher::match(double now, std::vector<MatchedPair>& pairs, std::vector<void*>& unpairedVisible,
+		std::vector<void*>& unpairedThermal) {
+	// Every frame stamped before this has arrived
+	double settled = now - m_maxLatency;
+
+	while (!m_visible.empty() && !m_thermal.empty()) {
+		const Entry& visible = m_visible.front();
+		const Entry& thermal = m_thermal.front();
+
+		//
+		// Step 1
+		//      The earlier of the two is too early for anything the other stream has, or will have
+		if (visible.time < thermal.time - m_maxSkew) {
+			unpairedVisible.push_back(visible.pFrame);
+			m_unpairedVisible++;
+			m_visible.pop_front();
+			continue;
+		}
+		if (thermal.time < visible.time - m_maxSkew) {
+			unpairedThermal.push_back(thermal.pFrame);
+			m_unpairedThermal++;
+			m_thermal.pop_front();
+			continue;
+		}
+
+		//
+		// Step 2
+		//      They're within the skew.  The later of the two may still be nearer to the earlier one's successor,
+		//      in which case the earlier one has lost it.  If that successor hasn't arrived, and still could, wait
+		double gap = fabs(visible.time - thermal.time);
+		if (visible.time <= thermal.time) {
+			if (m_visible.size() > 1) {
+				if (fabs(m_visible[1].time - thermal.time) < gap) {
+					unpairedVisible.push_back(visible.pFrame);
+					m_unpairedVisible++;
+					m_visible.pop_front();
+					continue;
+				}
+			} else if (thermal.time + gap > settled) {
+				break;
+			}
+		} else {
+			if (m_thermal.size() > 1) {
+				if (fabs(m_thermal[1].time - visible.time) < gap) {
+					unpairedThermal.push_back(thermal.pFrame);
+					m_unpairedThermal++;
+					m_thermal.pop_front();
+					continue;
+				}
+			} else if (visible.time + gap > settled) {
+				break;
+			}
+		}
+
+		//
+		// Step 3
+		//      A pair
+		MatchedPair pair;
+		pair.pVisible = visible.pFrame;
+		pair.pThermal = thermal.pFrame;
+		pair.visibleTime = visible.time;
+		pair.thermalTime = thermal.time;
+		pair.skew = visible.time - thermal.time;
+		pairs.push_back(pair);
+		record(pair.skew);
+		m_visible.pop_front();
+		m_thermal.pop_front();
+	}
+
+	//
+	// Step 4
+	//      With the other stream empty, a frame goes unpaired once no partner can arrive in time for it
+	while (!m_visible.empty() && m_thermal.empty() && m_visible.front().time + m_maxSkew < settled) {
+		unpairedVisible.push_back(m_visible.front().pFrame);
+		m_unpairedVisible++;
+		m_visible.pop_front();
+	}
+	while (!m_thermal.empty() && m_visible.empty() && m_thermal.front().time + m_maxSkew < settled) {
+		unpairedThermal.push_back(m_thermal.front().pFrame);
+		m_unpairedThermal++;
+		m_thermal.pop_front();
+	}
+}
+
+void PairMatcher::flush(std::vector<void*>& visible, std::vector<void*>& thermal) {
+	for (size_t i = 0; i < m_visible.size(); i++) visible.push_back(m_visible[i].pFrame);
+	for (size_t i = 0; i < m_thermal.size(); i++) thermal.push_back(m_thermal[i].pFrame);
+	m_visible.clear();
+	m_thermal.clear();
+}
+
+void PairMatcher::record(double skew) {
+	double magnitude = fabs(skew);
+	m_pairs++;
+	m_sumSkew += skew;
+	m_sumSquaredSkew += skew * skew;
+	if (magnitude > m_maxSeen) m_maxSeen = magnitude;
+
+	size_t bin = m_maxSkew > 0.0 ? (size_t)(magnitude / m_maxSkew * PAIR_HISTOGRAM_BINS) : 0;
+	if (bin >= PAIR_HISTOGRAM_BINS) bin = PAIR_HISTOGRAM_BINS - 1;
+	m_histogram[bin]++;
+}
+
+PairingStats PairMatcher::stats() const {
+	PairingStats stats;
+	stats.pairs = m_pairs;
+	stats.unpairedVisible = m_unpairedVisible;
+	stats.unpairedThermal = m_unpairedThermal;
+	stats.meanSkew = m_pairs ? m_sumSkew / m_pairs : 0.0;
+	stats.rmsSkew = m_pairs ? sqrt(m_sumSquaredSkew / m_pairs) : 0.0;
+	stats.maxSkew = m_maxSeen;
+
+	// The percentiles are to the top of their histogram bin
+	stats.p50Skew = 0.0;
+	stats.p99Skew = 0.0;
+	uint64_t count = 0;
+	bool havePercentile50 = false;
+	for (size_t i = 0; i < m_histogram.size() && m_pairs; i++) {
+		count += m_histogram[i];
+		double top = m_maxSkew * (i + 1) / PAIR_HISTOGRAM_BINS;
+		if (!havePercentile50 && count * 2 >= m_pairs) {
+			stats.p50Skew = top;
+			havePercentile50 = true;
+		}
+		if (count * 100 >= m_pairs * 99) {
+			stats.p99Skew = top;
+			break;
+		}
+	}
+	if (stats.p50Skew > m_maxSeen) stats.p50Skew = m_maxSeen;
+	if (stats.p99Skew > m_maxSeen) stats.p99Skew = m_maxSeen;
+
+	return stats;
+}
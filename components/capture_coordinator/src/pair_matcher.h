@@ -0,0 +1,78 @@
+#pragma once
+
+#include <stdint.h>
+#include <deque>
+#include <vector>
+
+#define PAIR_HISTOGRAM_BINS 1000  // Over 0 .. the maximum skew, for the percentiles
+
+// Two frames, one of each stream, taken as close together as we could find
+struct MatchedPair {
+	void*  pVisible;
+	void*  pThermal;
+	double visibleTime;  // Host monotonic clock (seconds)
+	double thermalTime;
+	double skew;         // visibleTime - thermalTime
+};
+
+struct PairingStats {
+	uint64_t pairs;
+	uint64_t unpairedVisible;  // Frames with no partner within the skew, or with a closer rival
+	uint64_t unpairedThermal;
+	double   meanSkew;         // Signed, so a bias between the two clocks shows up here
+	double   rmsSkew;
+	double   p50Skew;          // Of the magnitude
+	double   p99Skew;
+	double   maxSkew;
+};
+
+// Pairs the frames of two streams by time.
+//
+// Each frame is paired with its nearest in the other stream, if that is
+// within the maximum skew and it isn't nearer still to a frame of our own
+// stream.  So when one stream runs faster than the other (a 30 fps visible
+// camera, and an 8.7 Hz thermal one), each of the slower stream's frames
+// gets the closest of the faster one's, and the rest go unpaired.
+//
+// Frames can arrive late, and out of step between the streams; a frame that
+// might still be beaten by one yet to arrive is held, until maxLatency has
+// passed, after which no frame stamped that early can turn up.
+class PairMatcher {
+public:
+	PairMatcher(double maxSkew, double maxLatency);
+
+	void addVisible(double time, void* pFrame);
+	void addThermal(double time, void* pFrame);
+
+	// Makes every pair it can, as of now (host monotonic clock).  The frames that can never be paired are handed
+	// back too, so they can be freed.
+	void match(double now, std::vector<MatchedPair>& pairs, std::vector<void*>& unpairedVisible,
+			std::vector<void*>& unpairedThermal);
+
+	// Hands back every frame still held
+	void flush(std::vector<void*>& visible, std::vector<void*>& thermal);
+
+	PairingStats stats() const;
+
+private:
+	struct Entry {
+		double time;
+		void*  pFrame;
+	};
+
+	static void insert(std::deque<Entry>& queue, double time, void* pFrame);
+	void record(double skew);
+
+	double            m_maxSkew;
+	double            m_maxLatency;
+	std::deque<Entry> m_visible;  // Oldest first
+	std::deque<Entry> m_thermal;
+
+	uint64_t m_pairs;
+	uint64_t m_unpairedVisible;
+	uint64_t m_unpairedThermal;
+	double   m_sumSkew;
+	double   m_sumSquaredSkew;
+	double   m_maxSeen;
+	std::vector<uint64_t> m_histogram;
+};
@@ -0,0 +1,56 @@
+#include <fcntl.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#include "thermal_source.h"
+
+ThermalSource::ThermalSource()
+	: m_pShared(NULL), m_haveSequence(false), m_sequence(0), m_missed(0) {
+}
+
+ThermalSource::~ThermalSource() {
+	close();
+}
+
+bool ThermalSource::open(const char* pPath) {
+	close();
+	int fd = ::open(pPath, O_RDONLY);
+	if (fd < 0) return false;
+	void* pMapped = mmap(NULL, sizeof(struct flir_camdev), PROT_READ, MAP_SHARED, fd, 0);
+	::close(fd);
+	if (MAP_FAILED == pMapped) return false;
+	m_pShared = (struct flir_camdev*)pMapped;
+	m_haveSequence = false;
+	m_missed = 0;
+	return true;
+}
+
+void ThermalSource::close() {
+	if (NULL == m_pShared) return;
+	munmap(m_pShared, sizeof(struct flir_camdev));
+	m_pShared = NULL;
+}
+
+bool ThermalSource::poll(ThermalFrame* pFrame) {
+	if (NULL == m_pShared) return false;
+
+	for (int attempt = 0; attempt < THERMAL_COPY_RETRIES; attempt++) {
+		uint32_t sequence = m_pShared->sequence;
+		__sync_synchronize();
+		if (0 == sequence || (m_haveSequence && sequence == m_sequence)) return false;
+
+		// The writer fills the other buffer.  If it finished a frame while we copied, we may have copied that one
+		// instead, or half of each; copy again
+		uint32_t current = m_pShared->current;
+		memcpy(pFrame->image, 2 == current ? m_pShared->buf2 : m_pShared->buf1, sizeof(pFrame->image));
+		pFrame->info = 2 == current ? m_pShared->info2 : m_pShared->info1;
+		__sync_synchronize();
+		if (m_pShared->sequence != sequence) continue;
+
+		if (m_haveSequence && sequence - m_sequence > 1) m_missed += sequence - m_sequence - 1;
+		m_sequence = sequence;
+		m_haveSequence = true;
+		return true;
+	}
+	return false;
+}
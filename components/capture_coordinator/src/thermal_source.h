@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stdint.h>
+#include "flir_camdev.h"
+
+#define THERMAL_COPY_RETRIES 4
+
+struct ThermalFrame {
+	struct pixel           image[CAM_WIDTH][CAM_HEIGHT];
+	struct flir_frame_info info;
+	double                 time;  // When it was taken, on the host's monotonic clock (seconds)
+};
+
+// Reads the frames flir_camdev leaves in its shared double buffer
+class ThermalSource {
+public:
+	ThermalSource();
+	~ThermalSource();
+
+	bool open(const char* pPath);
+	void close();
+
+	// Copies out the newest frame, if there is one we haven't had; false if there isn't (yet).  Frames that came
+	// and went since the last call are counted as missed.
+	bool poll(ThermalFrame* pFrame);
+
+	uint64_t missed() const { return m_missed; }
+
+private:
+	struct flir_camdev* m_pShared;
+	bool                m_haveSequence;
+	uint32_t            m_sequence;  // Of the last frame we had
+	uint64_t            m_missed;
+};
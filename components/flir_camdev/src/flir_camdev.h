@@ -11,7 +11,22 @@ struct pixel {
   uint8_t b;
 };
 
+// When a frame was taken, so that other components can line the thermal
+// frames up with their own.
+struct flir_frame_info {
+  uint32_t frame_counter;    // Lepton telemetry frame counter
+  uint32_t time_counter_ms;  // Lepton telemetry uptime, in ms; 0 without telemetry
+  uint64_t received_ns;      // CLOCK_MONOTONIC, when the frame's last VoSPI segment arrived
+};
+
+// The writer fills the buffer that isn't current, then points current at it
+// (1 or 2) and bumps sequence.  A reader should copy out the current buffer,
+// and copy again if sequence moved on while it did.
 struct flir_camdev {
   struct pixel buf1[CAM_WIDTH][CAM_HEIGHT];
   struct pixel buf2[CAM_WIDTH][CAM_HEIGHT];
+  struct flir_frame_info info1;
+  struct flir_frame_info info2;
+  volatile uint32_t current;
+  volatile uint32_t sequence;
 };
@@ -0,0 +1,148 @@
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+#include <sys/timerfd.h>
+#include <time.h>
+#include <unistd.h>
+#include "capture_scheduler.h"
+
+#if !defined(CLOCK_TAI)
+#define CLOCK_TAI 11
+#endif
+
+static double seconds(const struct timespec& ts) {
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return seconds(ts);
+}
+
+static struct itimerspec expiry(double when) {
+	struct itimerspec spec;
+	memset(&spec, 0, sizeof(spec));
+	if (when <= 0.0) when = 1.0e-9;   // All zeros would disarm the timer
+	spec.it_value.tv_sec = (time_t)when;
+	spec.it_value.tv_nsec = (long)((when - (double)spec.it_value.tv_sec) * 1.0e9);
+	return spec;
+}
+
+CaptureScheduler::CaptureScheduler(double prearm)
+	: m_prearm(prearm), m_timer(-1) {
+}
+
+CaptureScheduler::~CaptureScheduler() {
+	if (m_timer >= 0) close(m_timer);
+}
+
+bool CaptureScheduler::open() {
+	m_timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+	return m_timer >= 0;
+}
+
+// The TAI clock is read in between two reads of the monotonic one, to pin down the offset between them
+bool CaptureScheduler::toMonotonic(uint16_t clock, uint64_t atNs, double* pDeadline) {
+	double at = (double)(atNs / 1000000000ULL) + (double)(atNs % 1000000000ULL) / 1.0e9;
+	if (PAYLOAD_CLOCK_MONOTONIC == clock) {
+		*pDeadline = at;
+		return true;
+	}
+	if (PAYLOAD_CLOCK_TAI != clock) return false;
+
+	struct timespec before, tai, after;
+	clock_gettime(CLOCK_MONOTONIC, &before);
+	if (0 != clock_gettime(CLOCK_TAI, &tai)) return false;
+	clock_gettime(CLOCK_MONOTONIC, &after);
+	*pDeadline = at - seconds(tai) + (seconds(before) + seconds(after)) / 2.0;
+	return true;
+}
+
+bool CaptureScheduler::add(const payload_request& request, const std::string& path, int client) {
+	ScheduledCommand command;
+	if (!toMonotonic(request.clock, request.at_ns, &command.deadline)) return false;
+	command.request = request;
+	command.path = path;
+	command.client = client;
+	m_queue.insert(std::make_pair(command.deadline, command));
+	arm();
+	return true;
+}
+
+void CaptureScheduler::forget(int client) {
+	std::multimap<double, ScheduledCommand>::iterator it;
+	for (it = m_queue.begin(); it != m_queue.end(); ++it) {
+		if (it->second.client == client) it->second.client = -1;
+	}
+}
+
+bool CaptureScheduler::due(ScheduledCommand* pCommand) {
+	uint64_t expirations;
+	while (read(m_timer, &expirations, sizeof(expirations)) > 0) {}
+
+	refresh();
+	if (m_queue.empty() || m_queue.begin()->first - m_prearm > now()) {
+		arm();
+		return false;
+	}
+	*pCommand = m_queue.begin()->second;
+	m_queue.erase(m_queue.begin());
+	arm();
+	return true;
+}
+
+double CaptureScheduler::wait(ScheduledCommand* pCommand) {
+	// The deadline again, for TAI's sake, since readying the sensors took a while
+	double deadline;
+	if (toMonotonic(pCommand->request.clock, pCommand->request.at_ns, &deadline)) pCommand->deadline = deadline;
+
+	// A timer of our own, so we can block on it; the queue's stays armed for the next command
+	int timer = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC);
+	if (timer >= 0) {
+		struct itimerspec spec = expiry(pCommand->deadline);
+		if (0 == timerfd_settime(timer, TFD_TIMER_ABSTIME, &spec, NULL)) {
+			uint64_t expirations;
+			while (read(timer, &expirations, sizeof(expirations)) < 0 && EINTR == errno) {}
+		}
+		close(timer);
+	}
+	// Only if the timer failed us; sleep rather than spin, as we may be on SCHED_FIFO
+	while (now() < pCommand->deadline) {
+		struct itimerspec spec = expiry(pCommand->deadline);
+		int error = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &spec.it_value, NULL);
+		if (0 != error && EINTR != error) break;
+	}
+
+	return now() - pCommand->deadline;
+}
+
+bool CaptureScheduler::dueWithin(double seconds) const {
+	return !m_queue.empty() && m_queue.begin()->first - m_prearm <= now() + seconds;
+}
+
+// TAI commands' deadlines, as of now
+void CaptureScheduler::refresh() {
+	std::multimap<double, ScheduledCommand> queue;
+	std::multimap<double, ScheduledCommand>::iterator it;
+	bool changed = false;
+	for (it = m_queue.begin(); it != m_queue.end(); ++it) {
+		ScheduledCommand command = it->second;
+		if (PAYLOAD_CLOCK_TAI == command.request.clock) {
+			double deadline;
+			if (toMonotonic(command.request.clock, command.request.at_ns, &deadline) && deadline != command.deadline) {
+				command.deadline = deadline;
+				changed = true;
+			}
+		}
+		queue.insert(std::make_pair(command.deadline, command));
+	}
+	if (changed) m_queue.swap(queue);
+}
+
+void CaptureScheduler::arm() {
+	struct itimerspec spec;
+	memset(&spec, 0, sizeof(spec));
+	if (!m_queue.empty()) spec = expiry(m_queue.begin()->first - m_prearm);
+	timerfd_settime(m_timer, TFD_TIMER_ABSTIME, &spec, NULL);
+}
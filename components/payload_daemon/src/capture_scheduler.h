@@ -0,0 +1,58 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include "payload_protocol.h"
+
+#define SCHEDULER_DEFAULT_PREARM  0.2   // Seconds ahead of a command that its sensors are readied
+
+struct ScheduledCommand {
+	payload_request request;
+	std::string     path;
+	int             client;    // Connection to respond on; -1 once it's gone
+	double          deadline;  // On CLOCK_MONOTONIC (seconds)
+};
+
+// A queue of time-tagged commands, woken by a timerfd.
+//
+// Each command is woken for twice:  first, prearm seconds ahead of it, when
+// fd() becomes readable, for the caller to ready the sensors; then at the
+// deadline itself, which the caller blocks for with wait().  timerfd waits
+// are good to the microsecond or so; with the daemon on SCHED_FIFO, that is
+// about how late commands start.
+//
+// Commands for CLOCK_TAI are converted to CLOCK_MONOTONIC (which timerfd can
+// wait on) at each arming, so an adjustment to the TAI clock in the meantime
+// is followed.
+class CaptureScheduler {
+public:
+	explicit CaptureScheduler(double prearm = SCHEDULER_DEFAULT_PREARM);
+	~CaptureScheduler();
+
+	bool open();
+	int  fd() const { return m_timer; }   // Readable when the next command's prearm time has come
+
+	// False for a clock we don't know
+	bool add(const payload_request& request, const std::string& path, int client);
+	void forget(int client);
+	bool empty() const { return m_queue.empty(); }
+	size_t size() const { return m_queue.size(); }
+
+	// The command whose prearm time has come, taken off the queue; false if there's none (yet)
+	bool due(ScheduledCommand* pCommand);
+	// Blocks until the command's deadline (now on CLOCK_MONOTONIC, in seconds), and gives how late we woke
+	double wait(ScheduledCommand* pCommand);
+
+	// Whether a command's prearm time comes within the next seconds
+	bool dueWithin(double seconds) const;
+
+	static bool toMonotonic(uint16_t clock, uint64_t atNs, double* pDeadline);
+
+private:
+	void refresh();
+	void arm();
+
+	double m_prearm;
+	int    m_timer;
+	std::multimap<double, ScheduledCommand> m_queue;   // By deadline
+};
@@ -0,0 +1,46 @@
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include "payload_client.h"
+
+int payloadConnect(const char* pSocketPath) {
+	struct sockaddr_un address;
+	if (strlen(pSocketPath) >= sizeof(address.sun_path)) return -1;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, pSocketPath);
+
+	int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (fd < 0) return -1;
+	if (0 != connect(fd, (struct sockaddr*)&address, sizeof(address))) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
+
+bool payloadSend(int fd, payload_request* pRequest, const char* pPath) {
+	size_t pathLength = NULL == pPath ? 0 : strlen(pPath);
+	if (pathLength > PAYLOAD_MAX_PATH) return false;
+	pRequest->magic = PAYLOAD_MAGIC;
+	pRequest->version = PAYLOAD_VERSION;
+	pRequest->path_length = (uint16_t)pathLength;
+
+	// One send, so the daemon has the whole command at once
+	char message[sizeof(payload_request) + PAYLOAD_MAX_PATH];
+	memcpy(message, pRequest, sizeof(payload_request));
+	if (pathLength) memcpy(message + sizeof(payload_request), pPath, pathLength);
+	ssize_t length = (ssize_t)(sizeof(payload_request) + pathLength);
+	return length == send(fd, message, length, MSG_NOSIGNAL);
+}
+
+bool payloadReceive(int fd, payload_response* pResponse) {
+	if (sizeof(*pResponse) != recv(fd, pResponse, sizeof(*pResponse), MSG_WAITALL)) return false;
+	return PAYLOAD_MAGIC == pResponse->magic;
+}
+
+bool payloadCommand(int fd, payload_request* pRequest, const char* pPath, payload_response* pResponse) {
+	if (!payloadSend(fd, pRequest, pPath) || !payloadReceive(fd, pResponse)) return false;
+	return pRequest->id == pResponse->id;
+}
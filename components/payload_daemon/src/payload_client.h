@@ -0,0 +1,15 @@
+#pragma once
+
+#include "payload_protocol.h"
+
+// Connects to payloadd; the socket, or -1
+int payloadConnect(const char* pSocketPath);
+
+// Sends a command (request's magic and version are filled in), and waits for its response.  False if the
+// connection failed; the command's own outcome is in pResponse->status.
+bool payloadCommand(int fd, payload_request* pRequest, const char* pPath, payload_response* pResponse);
+
+// The same, in two halves, for scheduled commands:  send a pass's worth, then collect their responses, which come
+// in the order the commands ran (match them up by id).
+bool payloadSend(int fd, payload_request* pRequest, const char* pPath);
+bool payloadReceive(int fd, payload_response* pResponse);
@@ -0,0 +1,183 @@
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <sys/mman.h>
+#include <tclap/CmdLine.h>
+
+#include "payload_server.h"
+#include "PxLProfile.h"
+
+static volatile bool s_stop = false;
+
+static void onSignal(int) {
+	s_stop = true;
+}
+
+// Real time scheduling, for the scheduled commands' sake.  Threads started from here on (the camera's acquisition
+// threads) inherit it; they are given CPUs of their own by the capture engine.
+static bool setRealtime(int priority, int cpu) {
+	if (priority > 0) {
+		// A page fault mid capture would cost more than all the rest
+		if (0 != mlockall(MCL_CURRENT | MCL_FUTURE)) printf("warning: could not lock our memory\n");
+		struct sched_param param;
+		param.sched_priority = priority;
+		if (0 != pthread_setschedparam(pthread_self(), SCHED_FIFO, &param)) {
+			printf("error: could not run at SCHED_FIFO priority %d (is CAP_SYS_NICE missing?)\n", priority);
+			return false;
+		}
+	}
+	if (cpu >= 0) {
+		cpu_set_t cpus;
+		CPU_ZERO(&cpus);
+		CPU_SET(cpu, &cpus);
+		if (0 != pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus)) {
+			printf("error: could not pin to CPU %d\n", cpu);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Brings each camera's settings up to date:  its features described (from the cache, when it has them), and the
+// profile, if there is one, applied.  Only the camera's first frame tells us how long that really took; see
+// firstFrame().
+static bool configure(PxLCaptureEngine& engine, const std::string& cacheDir, const PxLSettingsProfile* pProfile) {
+	for (U32 i = 0; i < engine.cameraCount(); i++) {
+		PxLFeatureCache features;
+		PXL_RETURN_CODE rc = features.load(engine.camera(i), cacheDir.empty() ? NULL : cacheDir.c_str());
+		if (!API_SUCCESS(rc)) {
+			printf("error: could not describe camera %u's features (0x%08X)\n", engine.serialNumber(i), rc);
+			return false;
+		}
+		printf("camera %s:  features described by the %s\n", features.key().c_str(), features.fromCache() ? "cache" : "camera");
+		if (NULL == pProfile) continue;
+
+		PXL_PROFILE_APPLY_STATS stats;
+		rc = pProfile->apply(engine.camera(i), features, &stats);
+		printf("camera %s:  profile applied in %.1f ms; %u of %u features changed, %u skipped\n", features.key().c_str(),
+				stats.seconds * 1000.0, stats.changed, stats.compared, stats.skipped);
+		if (!API_SUCCESS(rc)) {
+			printf("error: camera %u would not take %u of the profile's features (0x%08X)\n", engine.serialNumber(i),
+					stats.failed, rc);
+			return false;
+		}
+	}
+	return true;
+}
+
+// Starts the cameras, and says how long after the daemon was started their first frame came:  what a command could
+// have waited, had it been the first thing we were asked
+static void firstFrame(PxLCaptureEngine& engine) {
+	PXL_RETURN_CODE rc = engine.start();
+	if (!API_SUCCESS(rc)) {
+		printf("warning: the camera would not start (0x%08X)\n", rc);
+		return;
+	}
+	PXL_CAPTURED_FRAME* pFrame = engine.nextFrame(PAYLOAD_FRAME_TIMEOUT);
+	double age = pxlSecondsSinceProcessStart();
+	if (NULL == pFrame) {
+		printf("warning: no frame from the camera within %.1f s\n", PAYLOAD_FRAME_TIMEOUT);
+		return;
+	}
+	engine.release(pFrame);
+	if (age >= 0.0) printf("first frame %.1f ms after the daemon started\n", age * 1000.0);
+}
+
+int main(int argc, char** argv) {
+	try {
+		TCLAP::CmdLine cmd("Keeps the payload's cameras up, and captures from them on command", ' ', "0.1A");
+		TCLAP::ValueArg<std::string> socket_arg("s", "socket",
+				"Unix domain socket to take commands on", false, PAYLOAD_DEFAULT_SOCKET, "path");
+		TCLAP::ValueArg<std::string> thermal_arg("t", "thermal",
+				"flir_camdev's shared frame file; without it, there is no thermal sensor", false, "", "path");
+		TCLAP::ValueArg<double> latency_arg("l", "thermal-latency",
+				"From a Lepton frame being taken to flir_camdev having it, in ms", false, 0.0, "ms");
+		TCLAP::SwitchArg idle_stop_arg("i", "idle-stop",
+				"Stop the Pixelink camera streaming between commands; saves power, costs latency", false);
+		TCLAP::ValueArg<double> prearm_arg("p", "prearm",
+				"How long ahead of a scheduled command to ready the sensors, in ms", false,
+				SCHEDULER_DEFAULT_PREARM * 1000.0, "ms");
+		TCLAP::ValueArg<int> fifo_arg("f", "fifo",
+				"Run at this SCHED_FIFO priority; 0 for the normal scheduler", false, 0, "priority");
+		TCLAP::ValueArg<int> cpu_arg("c", "cpu",
+				"Pin the daemon's thread to this CPU; -1 for none", false, -1, "cpu");
+		TCLAP::ValueArg<std::string> cache_arg("C", "cache-dir",
+				"Where the cameras' feature descriptions are cached, so they needn't be asked for", false, "", "path");
+		TCLAP::ValueArg<std::string> profile_arg("P", "profile",
+				"Settings profile to apply to the Pixelink camera (see pxlprofile)", false, "", "path");
+
+		cmd.add(socket_arg);
+		cmd.add(thermal_arg);
+		cmd.add(latency_arg);
+		cmd.add(idle_stop_arg);
+		cmd.add(prearm_arg);
+		cmd.add(fifo_arg);
+		cmd.add(cpu_arg);
+		cmd.add(cache_arg);
+		cmd.add(profile_arg);
+		cmd.parse(argc, argv);
+
+		PxLSettingsProfile profile;
+		if (!profile_arg.getValue().empty() && !profile.load(profile_arg.getValue().c_str())) {
+			printf("error: could not read the settings profile %s\n", profile_arg.getValue().c_str());
+			return 1;
+		}
+
+		//
+		// Step 1
+		//      Bring the sensors up, once.  Either may be missing; commands for it will say so
+		PxLCaptureEngine engine(PAYLOAD_BUFFERS);
+		PxLCaptureEngine* pEngine = &engine;
+		PXL_RETURN_CODE rc = engine.open();
+		if (!API_SUCCESS(rc)) {
+			printf("warning: no Pixelink camera (0x%08X)\n", rc);
+			pEngine = NULL;
+		}
+		if (NULL != pEngine && !configure(engine, cache_arg.getValue(), profile_arg.getValue().empty() ? NULL : &profile)) {
+			engine.close();
+			return 1;
+		}
+
+		ThermalSource thermal;
+		ThermalSource* pThermal = NULL;
+		if (!thermal_arg.getValue().empty()) {
+			if (thermal.open(thermal_arg.getValue().c_str())) {
+				pThermal = &thermal;
+			} else {
+				printf("warning: could not map %s; no thermal sensor\n", thermal_arg.getValue().c_str());
+			}
+		}
+
+		//
+		// Step 2
+		//      Serve commands, until we're told to stop.  The camera is started here, rather than by the server, to
+		//      see how long it took to be ready for the first command.
+		if (!setRealtime(fifo_arg.getValue(), cpu_arg.getValue())) {
+			if (NULL != pEngine) engine.close();
+			return 1;
+		}
+		if (NULL != pEngine && !idle_stop_arg.getValue()) firstFrame(engine);
+		signal(SIGINT, onSignal);
+		signal(SIGTERM, onSignal);
+		int result = 0;
+		{
+			PayloadServer server(pEngine, pThermal, latency_arg.getValue() / 1000.0, idle_stop_arg.getValue(),
+					prearm_arg.getValue() / 1000.0);
+			if (server.listen(socket_arg.getValue().c_str())) {
+				printf("listening on %s\n", socket_arg.getValue().c_str());
+				fflush(stdout);
+				server.serve(s_stop);
+			} else {
+				printf("error: could not listen on %s\n", socket_arg.getValue().c_str());
+				result = 1;
+			}
+		}
+
+		if (NULL != pEngine) engine.close();
+		return result;
+	} catch (TCLAP::ArgException &e) {
+		printf("error: %s for arg %s\n", e.error().c_str(), e.argId().c_str());
+		return 1;
+	}
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <stdint.h>
+
+// The protocol between payloadd and its clients, over a Unix domain stream
+// socket.  Both ends are on the one host, so everything is in its byte order.
+//
+// A client sends a payload_request, followed by path_length bytes of output
+// path (no terminator), and gets a payload_response back when the command
+// has finished.  A connection can carry any number of commands.
+//
+// A command can be scheduled, for a time on CLOCK_MONOTONIC or CLOCK_TAI;
+// the daemon queues it, and carries on taking commands.  Its response comes
+// once it has run, and its times are from when it was scheduled for, rather
+// than from when it arrived.  So a client can send a whole pass's worth of
+// commands at once, and collect the responses, which come back in the order
+// the commands ran, by id.
+//
+// Stills are saved as <path>-<id>-<n>-visible.<format> and
+// <path>-<id>-<n>-thermal.ppm, where id is the request's, so that commands
+// sent with the one path don't overwrite one another.  Video is saved as
+// <path>-<id>.pxlrec (see lib/PxLRecord) for the visible frames, and
+// <path>-<id>-thermal.ppm, one PPM image after another, for the thermal ones.
+
+#define PAYLOAD_MAGIC          0x444C5950   // "PYLD"
+#define PAYLOAD_VERSION        2
+#define PAYLOAD_MAX_PATH       256
+#define PAYLOAD_DEFAULT_SOCKET "/tmp/payloadd.sock"
+
+// Commands
+#define PAYLOAD_PING           0   // Does nothing; for the round trip time
+#define PAYLOAD_SINGLE         1   // One frame from each sensor
+#define PAYLOAD_BURST          2   // count frames from each sensor, as fast as they come
+#define PAYLOAD_SEQUENCE       3   // One frame from each sensor, every interval_ms, count times
+#define PAYLOAD_VIDEO          4   // Every frame, for duration_ms
+
+// Sensors
+#define PAYLOAD_VISIBLE        0x01
+#define PAYLOAD_THERMAL        0x02
+#define PAYLOAD_SENSORS        2   // The per-sensor fields of payload_response are indexed by:
+#define PAYLOAD_VISIBLE_INDEX  0
+#define PAYLOAD_THERMAL_INDEX  1
+
+// Clocks
+#define PAYLOAD_CLOCK_NOW       0   // Not scheduled; run the command as soon as it arrives
+#define PAYLOAD_CLOCK_MONOTONIC 1
+#define PAYLOAD_CLOCK_TAI       2
+
+// Status
+#define PAYLOAD_OK             0
+#define PAYLOAD_BAD_REQUEST    1   // Unknown command, sensor, or clock; no frames asked for; bad magic or version; path too long
+#define PAYLOAD_NO_SENSOR      2   // A sensor asked for isn't there
+#define PAYLOAD_TIMEOUT        3   // A sensor stopped delivering frames
+#define PAYLOAD_WRITE_FAILED   4   // A frame couldn't be saved
+
+struct payload_request {
+	uint32_t magic;
+	uint16_t version;
+	uint8_t  command;
+	uint8_t  sensors;       // PAYLOAD_VISIBLE | PAYLOAD_THERMAL
+	uint32_t id;            // Echoed in the response
+	uint32_t count;         // Burst, sequence
+	uint32_t interval_ms;   // Sequence
+	uint32_t duration_ms;   // Video
+	uint32_t format;        // Of visible stills:  IMAGE_FORMAT_*
+	uint16_t path_length;
+	uint16_t clock;         // Of at_ns:  PAYLOAD_CLOCK_*
+	uint64_t at_ns;         // When to run the command
+};
+
+struct payload_response {
+	uint32_t magic;
+	uint32_t id;
+	uint32_t status;
+	uint32_t frames[PAYLOAD_SENSORS];      // Saved
+	uint32_t taken_us[PAYLOAD_SENSORS];    // From the command arriving (or its scheduled time) to the first frame being taken
+	uint32_t arrived_us[PAYLOAD_SENSORS];  // ... to the first frame reaching us
+	uint32_t elapsed_us;                   // ... to this response
+	uint32_t late_us;                      // From its scheduled time to the command starting; 0 if not scheduled
+};
@@ -0,0 +1,457 @@
+#include <errno.h>
+#include <poll.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <time.h>
+#include <unistd.h>
+#include "PxLRecording.h"
+#include "payload_server.h"
+
+static double now() {
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+static uint32_t microseconds(double seconds) {
+	return seconds > 0.0 ? (uint32_t)(seconds * 1.0e6) : 0;
+}
+
+static const char* extension(uint32_t format) {
+	switch (format) {
+		case IMAGE_FORMAT_BMP:  return "bmp";
+		case IMAGE_FORMAT_TIFF: return "tiff";
+		case IMAGE_FORMAT_PSD:  return "psd";
+		case IMAGE_FORMAT_JPEG: return "jpg";
+		case IMAGE_FORMAT_PNG:  return "png";
+		default:                return "raw";
+	}
+}
+
+static bool writeThermal(FILE* pFile, const ThermalFrame& frame) {
+	fprintf(pFile, "P6\n%d %d\n255\n", CAM_WIDTH, CAM_HEIGHT);
+	for (int y = 0; y < CAM_HEIGHT; y++) {
+		for (int x = 0; x < CAM_WIDTH; x++) fwrite(&frame.image[x][y], sizeof(struct pixel), 1, pFile);
+	}
+	return !ferror(pFile);
+}
+
+static bool saveThermal(const ThermalFrame& frame, const std::string& filename) {
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (NULL == pFile) return false;
+	bool ok = writeThermal(pFile, frame);
+	return 0 == fclose(pFile) && ok;
+}
+
+// The first frame of a sensor, for a command, is the one its latency is reported for
+static void noteFrame(payload_response* pResponse, int sensor, double taken, double arrived, double received) {
+	if (0 == pResponse->frames[sensor]++) {
+		pResponse->taken_us[sensor] = microseconds(taken - received);
+		pResponse->arrived_us[sensor] = microseconds(arrived - received);
+	}
+}
+
+PayloadServer::PayloadServer(PxLCaptureEngine* pEngine, ThermalSource* pThermal, double thermalLatency, bool idleStop,
+		double prearm)
+	: m_pEngine(pEngine), m_pThermal(pThermal), m_thermalLatency(thermalLatency), m_idleStop(idleStop),
+	  m_streaming(false), m_listen(-1), m_scheduler(prearm), m_lastClockSample(0.0) {
+	if (NULL != m_pEngine && !m_idleStop) m_streaming = API_SUCCESS(m_pEngine->start());
+	sampleCameraClock();
+}
+
+PayloadServer::~PayloadServer() {
+	if (m_streaming) m_pEngine->stop();
+	if (m_listen >= 0) {
+		close(m_listen);
+		unlink(m_socketPath.c_str());
+	}
+}
+
+bool PayloadServer::listen(const char* pSocketPath) {
+	struct sockaddr_un address;
+	if (strlen(pSocketPath) >= sizeof(address.sun_path)) return false;
+	memset(&address, 0, sizeof(address));
+	address.sun_family = AF_UNIX;
+	strcpy(address.sun_path, pSocketPath);
+	if (!m_scheduler.open()) return false;
+
+	// A socket left behind by a daemon that didn't get to clean up
+	unlink(pSocketPath);
+	m_listen = socket(AF_UNIX, SOCK_STREAM, 0);
+	if (m_listen < 0) return false;
+	if (0 != bind(m_listen, (struct sockaddr*)&address, sizeof(address)) || 0 != ::listen(m_listen, 4)) {
+		close(m_listen);
+		m_listen = -1;
+		return false;
+	}
+	m_socketPath = pSocketPath;
+	return true;
+}
+
+void PayloadServer::serve(volatile bool& stop) {
+	int client = -1;
+	while (!stop) {
+		//
+		// Step 1
+		//      Wait for a command, a client (only once we've finished with the last one), or a scheduled command's
+		//      time to come round
+		struct pollfd fds[2];
+		fds[0].fd = client >= 0 ? client : m_listen;
+		fds[0].events = POLLIN;
+		fds[0].revents = 0;
+		fds[1].fd = m_scheduler.fd();
+		fds[1].events = POLLIN;
+		fds[1].revents = 0;
+		int ready = poll(fds, 2, PAYLOAD_IDLE_POLL);
+		if (ready < 0 && EINTR != errno) break;
+
+		//
+		// Step 2
+		//      Whatever the camera took while we waited is stale.  And keep up with the camera's clock
+		drain();
+		if (now() - m_lastClockSample >= PAYLOAD_CLOCK_PERIOD) sampleCameraClock();
+		if (ready <= 0) continue;
+
+		//
+		// Step 3
+		//      Scheduled commands first; they're the ones with a time to keep
+		if (fds[1].revents & POLLIN) runScheduled();
+
+		//
+		// Step 4
+		//      The client, or its next command
+		if (0 == (fds[0].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+		if (client < 0) {
+			client = accept(m_listen, NULL, NULL);
+		} else if (!handle(client)) {
+			m_scheduler.forget(client);
+			close(client);
+			client = -1;
+		}
+	}
+	if (client >= 0) close(client);
+}
+
+// One command, and its response (unless it's scheduled).  False once the connection is done with, or no longer in
+// step
+bool PayloadServer::handle(int fd) {
+	payload_request request;
+	if (sizeof(request) != recv(fd, &request, sizeof(request), MSG_WAITALL)) return false;
+	double received = now();
+
+	payload_response response;
+	memset(&response, 0, sizeof(response));
+	response.magic = PAYLOAD_MAGIC;
+	response.id = request.id;
+
+	bool inStep = PAYLOAD_MAGIC == request.magic && PAYLOAD_VERSION == request.version &&
+			request.path_length <= PAYLOAD_MAX_PATH;
+	std::string path;
+	if (inStep && request.path_length) {
+		path.resize(request.path_length);
+		inStep = request.path_length == recv(fd, &path[0], request.path_length, MSG_WAITALL);
+	}
+
+	if (!inStep) {
+		response.status = PAYLOAD_BAD_REQUEST;
+	} else if (PAYLOAD_CLOCK_NOW != request.clock) {
+		// Queued, to be responded to when it has run
+		response.status = validate(request, path);
+		if (PAYLOAD_OK == response.status && m_scheduler.add(request, path, fd)) return true;
+		if (PAYLOAD_OK == response.status) response.status = PAYLOAD_BAD_REQUEST;
+	} else {
+		execute(request, path, received, &response);
+	}
+	respond(fd, request, &response, received);
+	return inStep;
+}
+
+void PayloadServer::runScheduled() {
+	ScheduledCommand command;
+	while (m_scheduler.due(&command)) {
+		payload_response response;
+		memset(&response, 0, sizeof(response));
+		response.magic = PAYLOAD_MAGIC;
+		response.id = command.request.id;
+
+		// Ready the sensors while there's time, then run it on the dot.  What the camera took while we waited is stale,
+		// and holds buffers the first frame after the deadline may need
+		if (!ready(command.request)) {
+			response.status = PAYLOAD_NO_SENSOR;
+		} else {
+			response.late_us = microseconds(m_scheduler.wait(&command));
+			drain();
+			execute(command.request, command.path, command.deadline, &response);
+		}
+		respond(command.client, command.request, &response, command.deadline);
+	}
+}
+
+void PayloadServer::respond(int fd, const payload_request& request, payload_response* pResponse, double reference) {
+	pResponse->elapsed_us = microseconds(now() - reference);
+	log(request, *pResponse);
+	if (fd >= 0) send(fd, pResponse, sizeof(*pResponse), MSG_NOSIGNAL);
+}
+
+uint32_t PayloadServer::validate(const payload_request& request, const std::string& path) const {
+	if (PAYLOAD_PING == request.command) return PAYLOAD_OK;
+	bool known = PAYLOAD_SINGLE == request.command || PAYLOAD_BURST == request.command ||
+			PAYLOAD_SEQUENCE == request.command || PAYLOAD_VIDEO == request.command;
+	bool none = (PAYLOAD_BURST == request.command || PAYLOAD_SEQUENCE == request.command) && 0 == request.count;
+	if (!known || none || 0 == request.sensors || 0 != (request.sensors & ~(PAYLOAD_VISIBLE | PAYLOAD_THERMAL)) ||
+			path.empty()) {
+		return PAYLOAD_BAD_REQUEST;
+	}
+	if (((request.sensors & PAYLOAD_VISIBLE) && NULL == m_pEngine) ||
+			((request.sensors & PAYLOAD_THERMAL) && NULL == m_pThermal)) {
+		return PAYLOAD_NO_SENSOR;
+	}
+	return PAYLOAD_OK;
+}
+
+// Gets the sensors a scheduled command needs ready to deliver frames, ahead of its time:  the camera streaming, and
+// nothing stale in its queue
+bool PayloadServer::ready(const payload_request& request) {
+	if (PAYLOAD_PING == request.command || 0 == (request.sensors & PAYLOAD_VISIBLE) || NULL == m_pEngine) return true;
+	if (!m_streaming) {
+		if (!API_SUCCESS(m_pEngine->start())) return false;
+		m_streaming = true;
+	}
+	drain();
+	sampleCameraClock();
+	return true;
+}
+
+void PayloadServer::execute(const payload_request& request, const std::string& path, double received,
+		payload_response* pResponse) {
+	//
+	// Step 1
+	//      Check the command
+	pResponse->status = validate(request, path);
+	if (PAYLOAD_OK != pResponse->status || PAYLOAD_PING == request.command) return;
+
+	//
+	// Step 2
+	//      Capture.  Anything the camera has queued is older than the command, and is passed over
+	if ((request.sensors & PAYLOAD_VISIBLE) && !m_streaming) {
+		if (!API_SUCCESS(m_pEngine->start())) {
+			pResponse->status = PAYLOAD_NO_SENSOR;
+			return;
+		}
+		m_streaming = true;
+	}
+	if (PAYLOAD_VIDEO == request.command) {
+		pResponse->status = captureVideo(request, path, received, pResponse);
+	} else {
+		pResponse->status = captureStills(request, path, received, pResponse);
+	}
+
+	//
+	// Step 3
+	//      When idling stopped, the camera stays up only for a scheduled command that's being readied for
+	if (m_idleStop && m_streaming && !m_scheduler.dueWithin(0.0)) {
+		m_pEngine->stop();
+		m_streaming = false;
+	}
+}
+
+uint32_t PayloadServer::captureStills(const payload_request& request, const std::string& path, double received,
+		payload_response* pResponse) {
+	uint32_t count = PAYLOAD_SINGLE == request.command ? 1 : request.count;
+	double interval = PAYLOAD_SEQUENCE == request.command ? request.interval_ms / 1000.0 : 0.0;
+
+	for (uint32_t n = 0; n < count; n++) {
+		//
+		// Step 1
+		//      A sequence's frames are taken on its ticks; a burst's as fast as they come
+		double tick = received + n * interval;
+		while (now() < tick) {
+			drain();
+			double wait = tick - now();
+			if (wait > PAYLOAD_IDLE_POLL / 1000.0) wait = PAYLOAD_IDLE_POLL / 1000.0;
+			if (wait > 0.0) usleep((useconds_t)(wait * 1.0e6));
+		}
+
+		//
+		// Step 2
+		//      The first frame of each sensor taken since
+		char name[32];
+		snprintf(name, sizeof(name), "-%u-%u", request.id, n);
+		bool needVisible = 0 != (request.sensors & PAYLOAD_VISIBLE);
+		bool needThermal = 0 != (request.sensors & PAYLOAD_THERMAL);
+		double deadline = now() + PAYLOAD_FRAME_TIMEOUT;
+		while (needVisible || needThermal) {
+			if (now() > deadline) return PAYLOAD_TIMEOUT;
+
+			if (needThermal && nextThermal() && m_thermalFrame.time >= tick) {
+				if (!saveThermal(m_thermalFrame, path + name + "-thermal.ppm")) return PAYLOAD_WRITE_FAILED;
+				noteFrame(pResponse, PAYLOAD_THERMAL_INDEX, m_thermalFrame.time,
+						(double)m_thermalFrame.info.received_ns / 1.0e9, received);
+				needThermal = false;
+				deadline = now() + PAYLOAD_FRAME_TIMEOUT;
+			}
+
+			if (needVisible) {
+				// Don't sit in the camera's queue while a thermal frame waits to be picked up
+				PXL_CAPTURED_FRAME* pFrame = nextVisible(needThermal ? PAYLOAD_THERMAL_POLL / 1.0e6 : PAYLOAD_FRAME_TIMEOUT);
+				if (NULL == pFrame) continue;
+				double arrived = now();
+				double taken = visibleTaken(pFrame);
+				if (taken >= tick) {
+					std::string filename = path + name + "-visible." + extension(request.format);
+					bool saved = saveVisible(pFrame, request.format, filename);
+					noteFrame(pResponse, PAYLOAD_VISIBLE_INDEX, taken, arrived, received);
+					m_pEngine->release(pFrame);
+					if (!saved) return PAYLOAD_WRITE_FAILED;
+					needVisible = false;
+					deadline = now() + PAYLOAD_FRAME_TIMEOUT;
+				} else {
+					m_pEngine->release(pFrame);
+				}
+			} else if (needThermal) {
+				usleep(PAYLOAD_THERMAL_POLL);
+			}
+		}
+	}
+	return PAYLOAD_OK;
+}
+
+uint32_t PayloadServer::captureVideo(const payload_request& request, const std::string& path, double received,
+		payload_response* pResponse) {
+	bool wantVisible = 0 != (request.sensors & PAYLOAD_VISIBLE);
+	bool wantThermal = 0 != (request.sensors & PAYLOAD_THERMAL);
+	double end = received + request.duration_ms / 1000.0;
+
+	//
+	// Step 1
+	//      The files
+	char name[16];
+	snprintf(name, sizeof(name), "-%u", request.id);
+	PxLRecordWriter writer;
+	FILE* pThermalFile = NULL;
+	if (wantVisible && !writer.open((path + name + ".pxlrec").c_str(), m_pEngine->serialNumber(0), "payloadd")) {
+		return PAYLOAD_WRITE_FAILED;
+	}
+	if (wantThermal && NULL == (pThermalFile = fopen((path + name + "-thermal.ppm").c_str(), "wb"))) {
+		writer.close();
+		return PAYLOAD_WRITE_FAILED;
+	}
+
+	//
+	// Step 2
+	//      Every frame taken from now until the end, waiting a little past it for the last ones to arrive
+	uint32_t status = PAYLOAD_OK;
+	double lastVisible = received;
+	double lastThermal = received;
+	while (PAYLOAD_OK == status && now() < end + PAYLOAD_VIDEO_TAIL) {
+		if (wantThermal && nextThermal()) {
+			lastThermal = now();
+			if (m_thermalFrame.time >= received && m_thermalFrame.time < end) {
+				if (!writeThermal(pThermalFile, m_thermalFrame)) status = PAYLOAD_WRITE_FAILED;
+				noteFrame(pResponse, PAYLOAD_THERMAL_INDEX, m_thermalFrame.time,
+						(double)m_thermalFrame.info.received_ns / 1.0e9, received);
+			}
+		}
+
+		if (wantVisible) {
+			PXL_CAPTURED_FRAME* pFrame = nextVisible(wantThermal ? PAYLOAD_THERMAL_POLL / 1.0e6 : PAYLOAD_VIDEO_TAIL);
+			if (NULL != pFrame) {
+				double arrived = lastVisible = now();
+				double taken = visibleTaken(pFrame);
+				if (taken >= received && taken < end) {
+					if (!writer.addFrame(pFrame->pData, pFrame->size, pFrame->pixelFormat, &pFrame->frameDesc)) {
+						status = PAYLOAD_WRITE_FAILED;
+					}
+					noteFrame(pResponse, PAYLOAD_VISIBLE_INDEX, taken, arrived, received);
+				}
+				m_pEngine->release(pFrame);
+			}
+		} else {
+			usleep(PAYLOAD_THERMAL_POLL);
+		}
+
+		double timeNow = now();
+		if ((wantVisible && timeNow - lastVisible > PAYLOAD_FRAME_TIMEOUT) ||
+				(wantThermal && timeNow - lastThermal > PAYLOAD_FRAME_TIMEOUT)) {
+			status = PAYLOAD_TIMEOUT;
+		}
+	}
+
+	//
+	// Step 3
+	//      Finish the files; what was written before a failure is kept
+	if (wantVisible && !writer.close() && PAYLOAD_OK == status) status = PAYLOAD_WRITE_FAILED;
+	if (NULL != pThermalFile && 0 != fclose(pThermalFile) && PAYLOAD_OK == status) status = PAYLOAD_WRITE_FAILED;
+	return status;
+}
+
+// The next frame from our camera; the engine's other cameras, if it found any, aren't ours
+PXL_CAPTURED_FRAME* PayloadServer::nextVisible(double timeout) {
+	PXL_CAPTURED_FRAME* pFrame = m_pEngine->nextFrame(timeout);
+	if (NULL != pFrame && 0 != pFrame->camera) {
+		m_pEngine->release(pFrame);
+		pFrame = NULL;
+	}
+	return pFrame;
+}
+
+// A thermal frame we haven't had, into m_thermalFrame, with when it was taken
+bool PayloadServer::nextThermal() {
+	if (!m_pThermal->poll(&m_thermalFrame)) return false;
+	m_thermalFrame.time = (double)m_thermalFrame.info.received_ns / 1.0e9 - m_thermalLatency;
+	return true;
+}
+
+// A reading of the camera's clock is good to no later than when we got it back; that's what ClockSync wants
+void PayloadServer::sampleCameraClock() {
+	m_lastClockSample = now();
+	if (NULL == m_pEngine) return;
+	double cameraTime;
+	if (!API_SUCCESS(PxLGetCurrentTimestamp(m_pEngine->camera(0), &cameraTime))) return;
+	m_visibleClock.addSample(cameraTime, now());
+}
+
+// When a visible frame was taken, on CLOCK_MONOTONIC.  Without a fix on the camera's clock (or a frame time), the
+// engine's timestamp; that's nearer when the frame arrived
+double PayloadServer::visibleTaken(const PXL_CAPTURED_FRAME* pFrame) const {
+	if (!m_visibleClock.valid() || pFrame->frameDesc.fFrameTime <= 0.0f) return pFrame->timestamp;
+	return m_visibleClock.toHost(pFrame->frameDesc.fFrameTime);
+}
+
+void PayloadServer::drain() {
+	if (!m_streaming) return;
+	PXL_CAPTURED_FRAME* pFrame;
+	while (NULL != (pFrame = m_pEngine->nextFrame(0.0))) m_pEngine->release(pFrame);
+}
+
+bool PayloadServer::saveVisible(const PXL_CAPTURED_FRAME* pFrame, uint32_t format, const std::string& filename) {
+	U32 size = 0;
+	FRAME_DESC frameDesc = pFrame->frameDesc;
+	if (!API_SUCCESS(PxLFormatImage(pFrame->pData, &frameDesc, format, NULL, &size))) return false;
+	if (m_image.size() < size) m_image.resize(size);
+	if (!API_SUCCESS(PxLFormatImage(pFrame->pData, &frameDesc, format, &m_image[0], &size))) return false;
+
+	FILE* pFile = fopen(filename.c_str(), "wb");
+	if (NULL == pFile) return false;
+	bool ok = size == fwrite(&m_image[0], 1, size, pFile);
+	return 0 == fclose(pFile) && ok;
+}
+
+void PayloadServer::log(const payload_request& request, const payload_response& response) {
+	static const char* s_commands[] = {"ping", "single", "burst", "sequence", "video"};
+	const char* pCommand = request.command < sizeof(s_commands) / sizeof(s_commands[0]) ? s_commands[request.command] : "?";
+	printf("%s (id %u):  status %u, %.1f ms", pCommand, response.id, response.status, response.elapsed_us / 1000.0);
+	if (response.late_us) printf(", %.3f ms late", response.late_us / 1000.0);
+	if (response.frames[PAYLOAD_VISIBLE_INDEX]) {
+		printf("; %u visible, first taken %.1f ms, arrived %.1f ms after the command", response.frames[PAYLOAD_VISIBLE_INDEX],
+				response.taken_us[PAYLOAD_VISIBLE_INDEX] / 1000.0, response.arrived_us[PAYLOAD_VISIBLE_INDEX] / 1000.0);
+	}
+	if (response.frames[PAYLOAD_THERMAL_INDEX]) {
+		printf("; %u thermal, first taken %.1f ms, arrived %.1f ms after the command", response.frames[PAYLOAD_THERMAL_INDEX],
+				response.taken_us[PAYLOAD_THERMAL_INDEX] / 1000.0, response.arrived_us[PAYLOAD_THERMAL_INDEX] / 1000.0);
+	}
+	printf("\n");
+	fflush(stdout);
+}
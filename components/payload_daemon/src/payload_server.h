@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include "PxLCaptureEngine.h"
+#include "thermal_source.h"
+#include "clock_sync.h"
+#include "capture_scheduler.h"
+#include "payload_protocol.h"
+
+#define PAYLOAD_IDLE_POLL       50     // Milliseconds between emptying the camera's queue, while idle
+#define PAYLOAD_THERMAL_POLL    2000   // Microseconds between looks for a new thermal frame
+#define PAYLOAD_FRAME_TIMEOUT   2.0    // Seconds a sensor may go without a frame, mid command
+#define PAYLOAD_VIDEO_TAIL      0.1    // Seconds we wait, after a video, for its last frames to reach us
+#define PAYLOAD_BUFFERS         16     // In the camera's pool
+#define PAYLOAD_CLOCK_PERIOD    0.25   // Seconds between readings of the camera's clock
+
+// Serves capture commands for the payload's sensors, over a Unix domain
+// socket (see payload_protocol.h).
+//
+// The sensors are brought up once, when the daemon starts, and kept that
+// way:  the Pixelink camera initialized, configured and (unless idleStop)
+// streaming, and flir_camdev's frames mapped.  So a command costs only the
+// wait for the next frame to be taken, not the camera's bring up.  Frames
+// taken before a command arrived are never used for it.  When a visible
+// frame was taken is told from its frame time, mapped onto the host's clock
+// with a ClockSync fed from the camera's clock (PxLGetCurrentTimestamp), as
+// capture_coordinator does; the engine's timestamp is little more than when
+// the frame reached us.
+//
+// Commands are served one at a time, from one client at a time; the sensors
+// are shared, and a second client's commands could only wait anyway.
+// Scheduled commands are queued (see CaptureScheduler), and run at their
+// time, with the sensors readied ahead of it:  the camera started, if it was
+// stopped for idling, and emptied of stale frames.
+class PayloadServer {
+public:
+	// pEngine, pThermal:  NULL for a sensor that isn't there
+	// thermalLatency:     Seconds from a Lepton frame being taken, to flir_camdev having it
+	// idleStop:           Stop the camera streaming between commands, to save power, at the cost of latency
+	// prearm:             Seconds ahead of a scheduled command that the sensors are readied
+	PayloadServer(PxLCaptureEngine* pEngine, ThermalSource* pThermal, double thermalLatency, bool idleStop,
+			double prearm = SCHEDULER_DEFAULT_PREARM);
+	~PayloadServer();
+
+	bool listen(const char* pSocketPath);
+	void serve(volatile bool& stop);
+
+private:
+	bool handle(int fd);
+	void runScheduled();
+	void respond(int fd, const payload_request& request, payload_response* pResponse, double reference);
+	uint32_t validate(const payload_request& request, const std::string& path) const;
+	bool ready(const payload_request& request);
+	void execute(const payload_request& request, const std::string& path, double received, payload_response* pResponse);
+	uint32_t captureStills(const payload_request& request, const std::string& path, double received,
+			payload_response* pResponse);
+	uint32_t captureVideo(const payload_request& request, const std::string& path, double received,
+			payload_response* pResponse);
+	PXL_CAPTURED_FRAME* nextVisible(double timeout);
+	bool nextThermal();
+	void sampleCameraClock();
+	double visibleTaken(const PXL_CAPTURED_FRAME* pFrame) const;
+	void drain();
+	bool saveVisible(const PXL_CAPTURED_FRAME* pFrame, uint32_t format, const std::string& filename);
+	void log(const payload_request& request, const payload_response& response);
+
+	PxLCaptureEngine* m_pEngine;
+	ThermalSource*    m_pThermal;
+	double            m_thermalLatency;
+	bool              m_idleStop;
+	bool              m_streaming;
+	int               m_listen;
+	std::string       m_socketPath;
+	CaptureScheduler  m_scheduler;
+	ClockSync         m_visibleClock;  // The camera's clock, on CLOCK_MONOTONIC
+	double            m_lastClockSample;
+	ThermalFrame      m_thermalFrame;  // The last one polled
+	std::vector<U8>   m_image;         // For formatting visible stills
+};
@@ -0,0 +1,192 @@
+#include <stdio.h>
+#include <time.h>
+#include <unistd.h>
+#include <tclap/CmdLine.h>
+
+#include <PixeLINKApi.h>
+#include "payload_client.h"
+
+#if !defined(CLOCK_TAI)
+#define CLOCK_TAI 11
+#endif
+
+static const char* s_statuses[] = {"ok", "bad request", "no such sensor", "timed out", "could not save"};
+
+static uint64_t nowNs(clockid_t clock) {
+	struct timespec ts;
+	clock_gettime(clock, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+static void report(const std::string& command, const payload_response& response) {
+	const char* pStatus = response.status < sizeof(s_statuses) / sizeof(s_statuses[0]) ? s_statuses[response.status] : "?";
+	printf("%s %u: %s in %.1f ms", command.c_str(), response.id, pStatus, response.elapsed_us / 1000.0);
+	if (response.late_us) printf(", %.3f ms late", response.late_us / 1000.0);
+	if (response.frames[PAYLOAD_VISIBLE_INDEX]) {
+		printf("; %u visible (first taken %.1f ms, here %.1f ms)", response.frames[PAYLOAD_VISIBLE_INDEX],
+				response.taken_us[PAYLOAD_VISIBLE_INDEX] / 1000.0, response.arrived_us[PAYLOAD_VISIBLE_INDEX] / 1000.0);
+	}
+	if (response.frames[PAYLOAD_THERMAL_INDEX]) {
+		printf("; %u thermal (first taken %.1f ms, here %.1f ms)", response.frames[PAYLOAD_THERMAL_INDEX],
+				response.taken_us[PAYLOAD_THERMAL_INDEX] / 1000.0, response.arrived_us[PAYLOAD_THERMAL_INDEX] / 1000.0);
+	}
+	printf("\n");
+}
+
+int main(int argc, char** argv) {
+	try {
+		TCLAP::CmdLine cmd("Sends a capture command to payloadd", ' ', "0.1A");
+		TCLAP::UnlabeledValueArg<std::string> command_arg("command",
+				"One of ping, single, burst, sequence, or video", true, "", "command");
+		TCLAP::UnlabeledValueArg<std::string> path_arg("path",
+				"Where to save the frames (a prefix)", false, "", "path");
+		TCLAP::ValueArg<std::string> socket_arg("s", "socket",
+				"payloadd's socket", false, PAYLOAD_DEFAULT_SOCKET, "path");
+		TCLAP::ValueArg<std::string> sensors_arg("S", "sensors",
+				"visible, thermal, or both", false, "both", "sensors");
+		TCLAP::ValueArg<unsigned> count_arg("n", "count",
+				"Frames of a burst or sequence", false, 1, "frames");
+		TCLAP::ValueArg<unsigned> interval_arg("i", "interval",
+				"Between the frames of a sequence, in ms", false, 1000, "ms");
+		TCLAP::ValueArg<unsigned> duration_arg("d", "duration",
+				"Of a video, in ms", false, 1000, "ms");
+		TCLAP::ValueArg<std::string> format_arg("f", "format",
+				"Of visible stills:  bmp, jpg, tiff, psd, png, or mono8", false, "bmp", "format");
+		TCLAP::ValueArg<unsigned> repeat_arg("r", "repeat",
+				"Send the command this many times, over the one connection", false, 1, "times");
+		TCLAP::ValueArg<double> at_arg("a", "at",
+				"Schedule the (first) command for this long from now, in ms", false, -1.0, "ms");
+		TCLAP::ValueArg<double> every_arg("e", "every",
+				"Schedule the repeats of the command this far apart, in ms", false, 1000.0, "ms");
+		TCLAP::SwitchArg tai_arg("T", "tai",
+				"Schedule on CLOCK_TAI, rather than CLOCK_MONOTONIC", false);
+
+		cmd.add(command_arg);
+		cmd.add(path_arg);
+		cmd.add(socket_arg);
+		cmd.add(sensors_arg);
+		cmd.add(count_arg);
+		cmd.add(interval_arg);
+		cmd.add(duration_arg);
+		cmd.add(format_arg);
+		cmd.add(repeat_arg);
+		cmd.add(at_arg);
+		cmd.add(every_arg);
+		cmd.add(tai_arg);
+		cmd.parse(argc, argv);
+
+		payload_request request = {};
+		std::string command = command_arg.getValue();
+		if (command == "ping") {
+			request.command = PAYLOAD_PING;
+		} else if (command == "single") {
+			request.command = PAYLOAD_SINGLE;
+		} else if (command == "burst") {
+			request.command = PAYLOAD_BURST;
+		} else if (command == "sequence") {
+			request.command = PAYLOAD_SEQUENCE;
+		} else if (command == "video") {
+			request.command = PAYLOAD_VIDEO;
+		} else {
+			printf("error: unknown command %s\n", command.c_str());
+			return 1;
+		}
+
+		std::string sensors = sensors_arg.getValue();
+		if (sensors == "visible") {
+			request.sensors = PAYLOAD_VISIBLE;
+		} else if (sensors == "thermal") {
+			request.sensors = PAYLOAD_THERMAL;
+		} else if (sensors == "both") {
+			request.sensors = PAYLOAD_VISIBLE | PAYLOAD_THERMAL;
+		} else {
+			printf("error: unknown sensors %s\n", sensors.c_str());
+			return 1;
+		}
+
+		std::string format = format_arg.getValue();
+		if (format == "bmp") {
+			request.format = IMAGE_FORMAT_BMP;
+		} else if (format == "jpg" || format == "jpeg") {
+			request.format = IMAGE_FORMAT_JPEG;
+		} else if (format == "tiff") {
+			request.format = IMAGE_FORMAT_TIFF;
+		} else if (format == "psd") {
+			request.format = IMAGE_FORMAT_PSD;
+		} else if (format == "png") {
+			request.format = IMAGE_FORMAT_PNG;
+		} else if (format == "mono8") {
+			request.format = IMAGE_FORMAT_RAW_MONO8;
+		} else {
+			printf("error: unknown format %s\n", format.c_str());
+			return 1;
+		}
+
+		request.count = count_arg.getValue();
+		request.interval_ms = interval_arg.getValue();
+		request.duration_ms = duration_arg.getValue();
+
+		int fd = payloadConnect(socket_arg.getValue().c_str());
+		if (fd < 0) {
+			printf("error: could not connect to %s\n", socket_arg.getValue().c_str());
+			return 1;
+		}
+
+		// Scheduled commands all go at once, and their responses are collected as they run.  Otherwise, each waits for
+		// the last
+		int result = 0;
+		bool lost = false;
+		bool scheduled = at_arg.getValue() >= 0.0;
+		clockid_t clock = tai_arg.getValue() ? CLOCK_TAI : CLOCK_MONOTONIC;
+		uint64_t first = nowNs(clock) + (uint64_t)(at_arg.getValue() * 1.0e6);
+		for (unsigned i = 0; i < repeat_arg.getValue() && !lost; i++) {
+			request.id = i + 1;
+			if (scheduled) {
+				request.clock = tai_arg.getValue() ? PAYLOAD_CLOCK_TAI : PAYLOAD_CLOCK_MONOTONIC;
+				request.at_ns = first + (uint64_t)(i * every_arg.getValue() * 1.0e6);
+				lost = !payloadSend(fd, &request, path_arg.getValue().c_str());
+				continue;
+			}
+			payload_response response;
+			lost = !payloadCommand(fd, &request, path_arg.getValue().c_str(), &response);
+			if (lost) break;
+			report(command, response);
+			if (PAYLOAD_OK != response.status) result = 1;
+		}
+
+		// How late the scheduled commands started, and how long after their time the visible frames were taken
+		double lateSum = 0.0, lateWorst = 0.0;
+		double takenSum = 0.0, takenWorst = 0.0;
+		unsigned responses = 0, taken = 0;
+		for (unsigned i = 0; scheduled && !lost && i < repeat_arg.getValue(); i++) {
+			payload_response response;
+			lost = !payloadReceive(fd, &response);
+			if (lost) break;
+			report(command, response);
+			if (PAYLOAD_OK != response.status) result = 1;
+
+			double late = response.late_us / 1000.0;
+			lateSum += late;
+			if (late > lateWorst) lateWorst = late;
+			responses++;
+			if (response.frames[PAYLOAD_VISIBLE_INDEX]) {
+				double off = response.taken_us[PAYLOAD_VISIBLE_INDEX] / 1000.0;
+				takenSum += off;
+				if (off > takenWorst) takenWorst = off;
+				taken++;
+			}
+		}
+		if (responses) printf("started late by %.3f ms on average, %.3f ms at worst\n", lateSum / responses, lateWorst);
+		if (taken) printf("visible frames taken %.3f ms after their time on average, %.3f ms at worst\n", takenSum / taken, takenWorst);
+
+		if (lost) {
+			printf("error: lost the connection to payloadd\n");
+			result = 1;
+		}
+		close(fd);
+		return result;
+	} catch (TCLAP::ArgException &e) {
+		printf("error: %s for arg %s\n", e.error().c_str(), e.argId().c_str());
+		return 1;
+	}
+}
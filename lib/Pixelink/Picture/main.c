@@ -4,25 +4,83 @@
 // Sample code to capture an image from a PixeLINK camera and save
 // the encoded image to a file.
 //
+// If payloadd (components/payload_daemon) is running, it has the camera
+// up already, and is asked for the image; bringing the camera up here
+// would cost far more than the image itself, and payloadd holds the camera
+// anyway.  Only if no daemon is listening is the camera used directly.
+//
 
 #include <stdio.h>
+#include <string.h>
+#include <unistd.h>
 #include <PixeLINKApi.h>
 #include "getsnapshot.h"
 #include "../../../main.h"
+#include "../../../components/payload_daemon/src/payload_client.h"
+
+#define MAX_FILENAME 256
+
+// Asks payloadd for the image.  FAILURE if it couldn't give us one; -1 if it isn't there
+static int DaemonSnapshot(const char* pFilenameJpg, const char* fileName)
+{
+	payload_request request = {};
+	payload_response response;
+	char path[MAX_FILENAME];
+	char saved[MAX_FILENAME + 32];
+	int fd;
+
+	fd = payloadConnect(PAYLOAD_DEFAULT_SOCKET);
+	if (fd < 0) {
+		return -1;
+	}
+
+	// The daemon saves where it's told, from where it runs; so tell it where we are
+	if ('/' == fileName[0] || NULL == getcwd(path, sizeof(path))) {
+		snprintf(path, sizeof(path), "%s", fileName);
+	} else {
+		size_t length = strlen(path);
+		snprintf(path + length, sizeof(path) - length, "/%s", fileName);
+	}
+
+	request.command = PAYLOAD_SINGLE;
+	request.sensors = PAYLOAD_VISIBLE;
+	request.format = IMAGE_FORMAT_JPEG;
+	request.id = 1;
+	if (!payloadCommand(fd, &request, path, &response) || PAYLOAD_OK != response.status) {
+		close(fd);
+		return FAILURE;
+	}
+	close(fd);
+
+	// It's saved as <path>-<id>-0-visible.jpg
+	snprintf(saved, sizeof(saved), "%s-%u-0-visible.jpg", path, request.id);
+	return 0 == rename(saved, pFilenameJpg) ? SUCCESS : FAILURE;
+}
+
 int visSnapshot(const char* fileName)
 {
 	HANDLE hCamera;
-	const char* pFilenameJpg = strCat(fileName, ".jpg");
+	char pFilenameJpg[MAX_FILENAME];
 	int retVal;
 
-	// Tell the camera we want to start using it.
-	// NOTE: We're assuming there's only one camera.
-	if (!API_SUCCESS(PxLInitialize(0, &hCamera))) {
-		return 1;
+	snprintf(pFilenameJpg, sizeof(pFilenameJpg), "%s.jpg", fileName);
+
+	// payloadd, if it's there
+	retVal = DaemonSnapshot(pFilenameJpg, fileName);
+	if (-1 == retVal) {
+		// Tell the camera we want to start using it.
+		// NOTE: We're assuming there's only one camera.
+		if (!API_SUCCESS(PxLInitialize(0, &hCamera))) {
+			return 1;
+		}
+
+		// Get the snapshots and save it to a file
+		retVal = GetSnapshot(hCamera, IMAGE_FORMAT_JPEG, pFilenameJpg);
+
+		// Tell the camera we're done with it.
+		PxLUninitialize(hCamera);
 	}
 
-	// Get the snapshots and save it to a file
-	retVal = GetSnapshot(hCamera, IMAGE_FORMAT_JPEG, pFilenameJpg);
 	if (SUCCESS == retVal) {
 		printf("Saved image to '%s'\n", pFilenameJpg);
 	}
@@ -30,8 +88,5 @@ int visSnapshot(const char* fileName)
 		printf("ERROR: Unable to capture an image\n");
 	}
 
-	// Tell the camera we're done with it.
-	PxLUninitialize(hCamera);
-
 	return (SUCCESS == retVal) ? 0 : 1;
 }
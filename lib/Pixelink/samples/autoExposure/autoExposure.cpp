@@ -24,6 +24,7 @@
 
 #include "PixeLINKApi.h"
 #include "LinuxUtil.h"
+#include "PxLProfile.h"
 
 #include <iostream>
 #include <stdio.h>
@@ -57,19 +58,20 @@ static OneTimeState oneTimeAutoExpose = Inactive;
 static pthread_t    oneTimeThread;
 
 // Returns true if the camera supports one-time auto adjustment and continual adjustment of the specified feature,
-// false otherwise
-static bool cameraSupportsAutoFeature (HANDLE camera, U32 featureId)
+// false otherwise.  The camera's features are described by a PxLFeatureCache, so that once it has been seen,
+// this doesn't cost the camera a control transfer.
+static bool cameraSupportsAutoFeature (const PxLFeatureCache& features, U32 featureId)
 {
     // How big a buffer will we need to hold the information about the feature?
     U32 bufferSize = -1;
-    PXL_RETURN_CODE rc = PxLGetCameraFeatures(camera, featureId, NULL, &bufferSize);
+    PXL_RETURN_CODE rc = features.getCameraFeatures(featureId, NULL, &bufferSize);
     ASSERT(API_SUCCESS(rc));
     ASSERT(bufferSize > 0);
 
     // Declare a buffer and read the feature information
     vector<U8> buffer(bufferSize, 0);  // zero-initialized buffer
     CAMERA_FEATURES* pCameraFeatures = (CAMERA_FEATURES*)&buffer[0];
-    rc = PxLGetCameraFeatures(camera, featureId, pCameraFeatures, &bufferSize);
+    rc = features.getCameraFeatures(featureId, pCameraFeatures, &bufferSize);
     ASSERT(API_SUCCESS(rc));
 
     // Check the sanity of the return information
@@ -242,7 +244,16 @@ int main() {
         return 1;
     }
 
-    if (! cameraSupportsAutoFeature(myCamera, FEATURE_EXPOSURE))
+    PxLFeatureCache features;
+    rc = features.load(myCamera, pxlDefaultFeatureCacheDir());
+    if (!API_SUCCESS(rc))
+    {
+        printf ("Could not describe the camera's features!  Rc = 0x%X\n", rc);
+        PxLUninitialize(myCamera);
+        return 1;
+    }
+
+    if (! cameraSupportsAutoFeature(features, FEATURE_EXPOSURE))
     {
         printf ("Camera does not support Auto Expsoure\n");
         PxLUninitialize(myCamera);
@@ -0,0 +1,565 @@
+//
+// filterBench.cpp
+//
+// A headless benchmark and regression test for the CaptureOEM preview filters
+// (../src/callbacks.cpp).  No camera, and no GUI, is required.
+//
+// Each filter callback is called directly, for every pixel format the filters
+// support, and for a range of ROI sizes, on synthetic (but deterministic)
+// frames.  For each combination we record:
+//    - the time per pixel, the frame rate and the throughput that the filter
+//      can sustain
+//    - the number of heap allocations made per frame (after the first)
+//    - the scratch arena requirements of the filter
+//    - whether the filter wrote outside of the frame
+//    - a hash of the filtered image, which is compared against the 'golden'
+//      hash stored in golden.txt
+//
+// Results are written as JSON (see -j) so that they can be tracked over time.
+//
+// Usage:
+//    filterBench [-s sizes] [-f filter] [-p format] [-t msPerCase] [-g goldenFile] [-r] [-d dumpDir] [-j jsonFile] [-i isa]
+//
+//       -s  Comma separated list of ROI sizes (default 64x48,320x240,1280x1024).  Widths must be multiples of 4.
+//       -f  Only run filters whose name contains this string
+//       -p  Only run pixel formats whose name contains this string
+//       -t  Minimum time (milliseconds) spent timing each case (default 100)
+//       -g  The golden hash file (default golden.txt)
+//       -r  Record new golden hashes (to the golden file), rather than checking them
+//       -d  Write each filtered image to this directory (<filter>_<format>_<w>x<h>.raw)
+//       -j  Write the results to this file (default filterBench.json)
+//       -i  Use kernels for no higher an instruction set than this (scalar, sse4.1, avx2 or neon).  All of
+//           them must match the same golden hashes.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/utsname.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+#include <map>
+#include <SDL2/SDL.h>
+#include <PixeLINKApi.h>
+#include "callbacks.h"
+#include "filterKernels.h"
+#include "filterStream.h"
+#include "pixelFormat.h"
+
+using namespace std;
+
+#define GUARD_BYTES     64    // Bytes after each frame used to detect filters writing beyond the frame
+#define GUARD_VALUE     0xA5
+#define SEQUENCE_LENGTH 4     // Number of frames fed to the filters before the golden hash is taken
+
+/* ---------------------------------------------------------------------------
+ * --   Heap allocation counting.
+ * --      We interpose the glibc allocator, so that we see every allocation made
+ * --      by a filter, whether it uses new, malloc, or posix_memalign.
+ * ---------------------------------------------------------------------------
+ */
+extern "C" void* __libc_malloc (size_t size);
+extern "C" void* __libc_calloc (size_t n, size_t size);
+extern "C" void* __libc_realloc (void* ptr, size_t size);
+extern "C" void* __libc_memalign (size_t alignment, size_t size);
+
+static volatile bool s_countAllocations = false;
+static volatile U32  s_allocations = 0;
+
+extern "C" void* malloc (size_t size)
+{
+    if (s_countAllocations) s_allocations++;
+    return __libc_malloc (size);
+}
+
+extern "C" void* calloc (size_t n, size_t size)
+{
+    if (s_countAllocations) s_allocations++;
+    return __libc_calloc (n, size);
+}
+
+extern "C" void* realloc (void* ptr, size_t size)
+{
+    if (s_countAllocations) s_allocations++;
+    return __libc_realloc (ptr, size);
+}
+
+extern "C" int posix_memalign (void** ptr, size_t alignment, size_t size)
+{
+    if (s_countAllocations) s_allocations++;
+    *ptr = __libc_memalign (alignment, size);
+    return *ptr ? 0 : 12; // ENOMEM
+}
+
+/* ---------------------------------------------------------------------------
+ * --   The filters and pixel formats under test
+ * ---------------------------------------------------------------------------
+ */
+typedef U32 (* FILTER_CALLBACK)(HANDLE, LPVOID, U32, FRAME_DESC const *, LPVOID);
+
+// Variants of the Sobel filter, with options other than the defaults
+static PXLAPI_CALLBACK(SobelL2)
+{
+    PxLEdgeState& edges = static_cast<PxLFilterStream*>(pContext)->m_edgeState;
+    edges.setNorm (PxLEdgeState::NORM_L2);
+    return PxLCallbackSobel (hCamera, pFrameData, uDataFormat, pFrameDesc, pContext);
+}
+
+static PXLAPI_CALLBACK(SobelThin)
+{
+    PxLEdgeState& edges = static_cast<PxLFilterStream*>(pContext)->m_edgeState;
+    edges.setThinning (true);
+    edges.setOrientation (true);
+    edges.setPublish (true);
+    return PxLCallbackSobel (hCamera, pFrameData, uDataFormat, pFrameDesc, pContext);
+}
+
+struct FilterInfo
+{
+    const char*     name;
+    FILTER_CALLBACK callback;
+};
+
+static const FilterInfo s_filters[] =
+{
+    {"Negative",              PxLCallbackNegative},
+    {"Grayscale",             PxLCallbackGrayscale},
+    {"HistogramEqualization", PxLCallbackHistogramEqualization},
+    {"SaturatedAndBlack",     PxLCallbackSaturatedAndBlack},
+    {"Threshold50Percent",    PxLCallbackTreshold50Percent},
+    {"LowPass",               PxLCallbackLowPass},
+    {"Median",                PxLCallbackMedian},
+    {"HighPass",              PxLCallbackHighPass},
+    {"Sobel",                 PxLCallbackSobel},
+    {"SobelL2",               SobelL2},
+    {"SobelThin",             SobelThin},
+    {"TemporalThreshold",     PxLCallbackTemporalTheshold},
+    {"MotionDetector",        PxLCallbackMotionDetector},
+    {"Ascii",                 PxLCallbackAscii},
+    {"BitmapOverlay",         PxLCallbackBitmapOverlay},
+    {"CrosshairOverlay",      PxLCallbackCrosshairOverlay},
+};
+
+struct FormatInfo
+{
+    const char* name;
+    U32         format;
+};
+
+#define PIXEL_FORMAT_ENTRY(fmt) {#fmt, PIXEL_FORMAT_##fmt}
+static const FormatInfo s_formats[] =
+{
+    PIXEL_FORMAT_ENTRY(MONO8),
+    PIXEL_FORMAT_ENTRY(MONO16),
+    PIXEL_FORMAT_ENTRY(MONO10_PACKED_MSFIRST),
+    PIXEL_FORMAT_ENTRY(MONO12_PACKED),
+    PIXEL_FORMAT_ENTRY(MONO12_PACKED_MSFIRST),
+    PIXEL_FORMAT_ENTRY(BAYER8_BGGR),
+    PIXEL_FORMAT_ENTRY(BAYER8_GBRG),
+    PIXEL_FORMAT_ENTRY(BAYER8_GRBG),
+    PIXEL_FORMAT_ENTRY(BAYER8_RGGB),
+    PIXEL_FORMAT_ENTRY(BAYER16_BGGR),
+    PIXEL_FORMAT_ENTRY(BAYER16_GBRG),
+    PIXEL_FORMAT_ENTRY(BAYER16_GRBG),
+    PIXEL_FORMAT_ENTRY(BAYER16_RGGB),
+    PIXEL_FORMAT_ENTRY(BAYER10_BGGR_PACKED_MSFIRST),
+    PIXEL_FORMAT_ENTRY(BAYER10_GBRG_PACKED_MSFIRST),
+    PIXEL_FORMAT_ENTRY(BAYER10_GRBG_PACKED_MSFIRST),
+    PIXEL_FORMAT_ENTRY(BAYER10_RGGB_PACKED_MSFIRST),
+    PIXEL_FORMAT_ENTRY(BAYER12_BGGR_PACKED),
+    PIXEL_FORMAT_ENTRY(BAYER12_GBRG_PACKED),
+    PIXEL_FORMAT_ENTRY(BAYER12_GRBG_PACKED),
+    PIXEL_FORMAT_ENTRY(BAYER12_RGGB_PACKED),
+    PIXEL_FORMAT_ENTRY(BAYER12_BGGR_PACKED_MSFIRST),
+    PIXEL_FORMAT_ENTRY(BAYER12_GBRG_PACKED_MSFIRST),
+    PIXEL_FORMAT_ENTRY(BAYER12_GRBG_PACKED_MSFIRST),
+    PIXEL_FORMAT_ENTRY(BAYER12_RGGB_PACKED_MSFIRST),
+    PIXEL_FORMAT_ENTRY(RGB24),
+    PIXEL_FORMAT_ENTRY(RGB24_NON_DIB),
+};
+
+#define ARRAY_SIZE(a) (sizeof(a)/sizeof((a)[0]))
+
+/* ---------------------------------------------------------------------------
+ * --   Results
+ * ---------------------------------------------------------------------------
+ */
+struct CaseResult
+{
+    string  filter;
+    string  format;
+    int     width;
+    int     height;
+    bool    supported;
+    U32     frames;
+    double  nsPerPixel;
+    double  framesPerSecond;
+    double  megabytesPerSecond;
+    double  allocationsPerFrame;
+    size_t  arenaPeak;
+    U32     arenaGrowths;
+    bool    overrun;
+    string  hash;
+    string  golden;   // "match", "mismatch", "missing", or "recorded"
+};
+
+/* ---------------------------------------------------------------------------
+ * --   Helpers
+ * ---------------------------------------------------------------------------
+ */
+static double NowInSeconds ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1e9;
+}
+
+// Simple (deterministic) pseudo random numbers
+static U32 NextRandom (U32& seed)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+static string HashImage (const U8* pData, size_t size)
+{
+    // 64 bit FNV-1a
+    unsigned long long hash = 14695981039346656037ULL;
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= pData[i];
+        hash *= 1099511628211ULL;
+    }
+    char text[20];
+    sprintf (text, "%016llx", hash);
+    return string(text);
+}
+
+//
+// Generate synthetic frame 'frameNum' of a sequence.  The image has a diagonal gradient (so the filters have edges and
+// a spread of values to work with), a little noise, and a bright square that moves a little with each frame (so the
+// temporal filters have something to see).  The pattern is generated byte by byte, so it's valid for every pixel format.
+static void MakeFrame (vector<U8>& frame, int width, int height, int bytesPerRow, int frameNum)
+{
+    U32 seed = 12345 + frameNum;
+    const int squareX = width/4 + 8*frameNum;
+    const int squareY = height/4 + 4*frameNum;
+    const int squareSize = max (4, min (width, height) / 4);
+    const double bytesPerPixel = (double)bytesPerRow / width;
+
+    for (int y = 0; y < height; y++)
+    {
+        U8* pRow = &frame[y * bytesPerRow];
+        for (int i = 0; i < bytesPerRow; i++)
+        {
+            const int x = (int)(i / bytesPerPixel);
+            int value = ((x * 255) / width + (y * 255) / height) / 2;
+            value += (int)(NextRandom (seed) % 7) - 3;
+            if (x >= squareX && x < squareX + squareSize && y >= squareY && y < squareY + squareSize) value = 250;
+            pRow[i] = (U8)max (0, min (255, value));
+        }
+    }
+}
+
+static string JsonString (const string& text)
+{
+    string quoted = "\"";
+    for (size_t i = 0; i < text.size(); i++)
+    {
+        if (text[i] == '"' || text[i] == '\\') quoted += '\\';
+        quoted += text[i];
+    }
+    return quoted + "\"";
+}
+
+static void LoadGolden (const char* fileName, map<string, string>& golden)
+{
+    FILE* pFile = fopen (fileName, "r");
+    if (! pFile) return;
+
+    char line[256];
+    while (fgets (line, sizeof(line), pFile))
+    {
+        char filter[64], format[64], size[32], hash[32];
+        if (line[0] == '#') continue;
+        if (sscanf (line, "%63s %63s %31s %31s", filter, format, size, hash) != 4) continue;
+        golden[string(filter) + " " + format + " " + size] = hash;
+    }
+    fclose (pFile);
+}
+
+static bool SaveGolden (const char* fileName, const map<string, string>& golden)
+{
+    FILE* pFile = fopen (fileName, "w");
+    if (! pFile) return false;
+
+    fprintf (pFile, "# Golden image hashes for filterBench:  <filter> <pixel format> <width>x<height> <FNV-1a hash>\n");
+    fprintf (pFile, "# Regenerate with 'filterBench -r' ONLY after verifying that a change in filter output is intended.\n");
+    for (map<string, string>::const_iterator it = golden.begin(); it != golden.end(); ++it)
+    {
+        fprintf (pFile, "%s %s\n", it->first.c_str(), it->second.c_str());
+    }
+    fclose (pFile);
+    return true;
+}
+
+static bool WriteJson (const char* fileName, const vector<CaseResult>& results, int failures)
+{
+    FILE* pFile = fopen (fileName, "w");
+    if (! pFile) return false;
+
+    struct utsname host;
+    uname (&host);
+
+    fprintf (pFile, "{\n");
+    fprintf (pFile, "  \"tool\": \"filterBench\",\n");
+    fprintf (pFile, "  \"host\": {\"name\": %s, \"machine\": %s, \"kernel\": %s},\n",
+             JsonString(host.nodename).c_str(), JsonString(host.machine).c_str(), JsonString(host.release).c_str());
+    fprintf (pFile, "  \"compiler\": %s,\n", JsonString(__VERSION__).c_str());
+    fprintf (pFile, "  \"isa\": %s,\n", JsonString(PxLIsaName (PxLHostIsa())).c_str());
+    fprintf (pFile, "  \"failures\": %d,\n", failures);
+    fprintf (pFile, "  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const CaseResult& r = results[i];
+        fprintf (pFile, "    {\"filter\": %s, \"format\": %s, \"width\": %d, \"height\": %d, \"supported\": %s",
+                 JsonString(r.filter).c_str(), JsonString(r.format).c_str(), r.width, r.height,
+                 r.supported ? "true" : "false");
+        if (r.supported)
+        {
+            fprintf (pFile, ", \"frames\": %u, \"nsPerPixel\": %.3f, \"framesPerSecond\": %.2f, \"megabytesPerSecond\": %.2f"
+                            ", \"allocationsPerFrame\": %.3f, \"arenaPeakBytes\": %lu, \"arenaGrowths\": %u"
+                            ", \"overrun\": %s, \"hash\": %s, \"golden\": %s",
+                     r.frames, r.nsPerPixel, r.framesPerSecond, r.megabytesPerSecond,
+                     r.allocationsPerFrame, (unsigned long)r.arenaPeak, r.arenaGrowths,
+                     r.overrun ? "true" : "false", JsonString(r.hash).c_str(), JsonString(r.golden).c_str());
+        }
+        fprintf (pFile, "}%s\n", i+1 < results.size() ? "," : "");
+    }
+    fprintf (pFile, "  ]\n");
+    fprintf (pFile, "}\n");
+    fclose (pFile);
+    return true;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Running a single case
+ * ---------------------------------------------------------------------------
+ */
+static void RunCase (const FilterInfo& filter, const FormatInfo& format, int width, int height, double minSeconds,
+                     SDL_Surface* pOverlay, const char* dumpDir, CaseResult& result)
+{
+    const int bytesPerRow = (int)(width * PxLPixelFormat::bytesPerPixel (format.format));
+    const size_t frameSize = (size_t)bytesPerRow * height;
+
+    FRAME_DESC frameDesc;
+    memset (&frameDesc, 0, sizeof(frameDesc));
+    frameDesc.uSize = sizeof(frameDesc);
+    frameDesc.Roi.fWidth = (float)width;
+    frameDesc.Roi.fHeight = (float)height;
+    frameDesc.PixelAddressingValue.fHorizontal = 1.0f;
+    frameDesc.PixelAddressingValue.fVertical = 1.0f;
+
+    result.filter = filter.name;
+    result.format = format.name;
+    result.width = width;
+    result.height = height;
+    result.supported = false;
+    result.frames = 0;
+    result.nsPerPixel = result.framesPerSecond = result.megabytesPerSecond = result.allocationsPerFrame = 0.0;
+    result.arenaPeak = 0;
+    result.arenaGrowths = 0;
+    result.overrun = false;
+
+    // The input sequence, and the buffer the filters work on (with guard bytes at the end)
+    vector< vector<U8> > sequence (SEQUENCE_LENGTH, vector<U8>(frameSize));
+    for (int i = 0; i < SEQUENCE_LENGTH; i++) MakeFrame (sequence[i], width, height, bytesPerRow, i);
+    vector<U8> frame (frameSize + GUARD_BYTES);
+
+    PxLFilterStream stream;
+    stream.m_bitmapOverlay = pOverlay;
+
+    //
+    // Step 1
+    //      Feed the sequence through the filter, and hash the final result.
+    for (int i = 0; i < SEQUENCE_LENGTH; i++)
+    {
+        memcpy (&frame[0], &sequence[i][0], frameSize);
+        memset (&frame[frameSize], GUARD_VALUE, GUARD_BYTES);
+        frameDesc.uFrameNumber = i;
+        frameDesc.fFrameTime = i / 30.0f;
+        if (filter.callback (NULL, &frame[0], format.format, &frameDesc, &stream) != ApiSuccess) return;
+        for (int g = 0; g < GUARD_BYTES; g++) if (frame[frameSize+g] != GUARD_VALUE) result.overrun = true;
+    }
+    result.supported = true;
+    result.hash = HashImage (&frame[0], frameSize);
+
+    if (dumpDir)
+    {
+        char fileName[512];
+        snprintf (fileName, sizeof(fileName), "%s/%s_%s_%dx%d.raw", dumpDir, filter.name, format.name, width, height);
+        FILE* pFile = fopen (fileName, "wb");
+        if (pFile)
+        {
+            fwrite (&frame[0], 1, frameSize, pFile);
+            fclose (pFile);
+        }
+    }
+
+    //
+    // Step 2
+    //      Time the filter.  We keep cycling through the sequence; only the callback itself is timed.
+    double filterTime = 0.0;
+    U32 allocations = 0;
+    U32 frames = 0;
+    const double startTime = NowInSeconds();
+    while (frames < 3 || NowInSeconds() - startTime < minSeconds)
+    {
+        memcpy (&frame[0], &sequence[frames % SEQUENCE_LENGTH][0], frameSize);
+        frameDesc.uFrameNumber = SEQUENCE_LENGTH + frames;
+
+        s_allocations = 0;
+        s_countAllocations = true;
+        const double before = NowInSeconds();
+        filter.callback (NULL, &frame[0], format.format, &frameDesc, &stream);
+        filterTime += NowInSeconds() - before;
+        s_countAllocations = false;
+        allocations += s_allocations;
+        frames++;
+    }
+
+    result.frames = frames;
+    result.nsPerPixel = filterTime * 1e9 / ((double)frames * width * height);
+    result.framesPerSecond = frames / filterTime;
+    result.megabytesPerSecond = (double)frameSize * frames / filterTime / (1024.0 * 1024.0);
+    result.allocationsPerFrame = (double)allocations / frames;
+    result.arenaPeak = stream.m_arena.peakUsage();
+    result.arenaGrowths = stream.m_arena.growCount();
+}
+
+/* ---------------------------------------------------------------------------
+ * --   main
+ * ---------------------------------------------------------------------------
+ */
+int main (int argc, char* argv[])
+{
+    const char* sizes = "64x48,320x240,1280x1024";
+    const char* filterMatch = "";
+    const char* formatMatch = "";
+    const char* goldenFile = "golden.txt";
+    const char* dumpDir = NULL;
+    const char* jsonFile = "filterBench.json";
+    double minSeconds = 0.1;
+    bool record = false;
+
+    int opt;
+    while ((opt = getopt (argc, argv, "s:f:p:t:g:rd:j:i:")) != -1)
+    {
+        switch (opt)
+        {
+        case 's': sizes = optarg; break;
+        case 'f': filterMatch = optarg; break;
+        case 'p': formatMatch = optarg; break;
+        case 't': minSeconds = atof (optarg) / 1000.0; break;
+        case 'g': goldenFile = optarg; break;
+        case 'r': record = true; break;
+        case 'd': dumpDir = optarg; break;
+        case 'j': jsonFile = optarg; break;
+        case 'i': setenv ("PXL_FILTER_ISA", optarg, 1); break;  // Must be done before the first filter is run
+        default:
+            printf ("Usage: %s [-s sizes] [-f filter] [-p format] [-t msPerCase] [-g goldenFile] [-r] [-d dumpDir] [-j jsonFile] [-i isa]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    vector< pair<int,int> > roiSizes;
+    for (const char* pSize = sizes; pSize && *pSize; )
+    {
+        int width, height;
+        // Like the cameras, we need a width that is a whole number of packed pixel groups (4 pixels, for 10 bit packed)
+        if (sscanf (pSize, "%dx%d", &width, &height) != 2 || width < 8 || height < 8 || width % 4 != 0)
+        {
+            printf ("Invalid ROI size list '%s' (widths must be multiples of 4)\n", sizes);
+            return 1;
+        }
+        roiSizes.push_back (make_pair (width, height));
+        pSize = strchr (pSize, ',');
+        if (pSize) pSize++;
+    }
+
+    map<string, string> golden;
+    LoadGolden (goldenFile, golden);
+
+    // The overlay used by the bitmap overlay filter; a (24 bit BGR) white image with a black diagonal band
+    const int overlayWidth = 256, overlayHeight = 128;
+    vector<U8> overlayPixels (overlayWidth * overlayHeight * 3, 0xFF);
+    for (int y = 0; y < overlayHeight; y++)
+    {
+        for (int x = y; x < min (y + 16, overlayWidth); x++) memset (&overlayPixels[(y*overlayWidth + x)*3], 0, 3);
+    }
+    SDL_Surface overlay;
+    memset (&overlay, 0, sizeof(overlay));
+    overlay.w = overlayWidth;
+    overlay.h = overlayHeight;
+    overlay.pitch = overlayWidth * 3;
+    overlay.pixels = &overlayPixels[0];
+
+    vector<CaseResult> results;
+    int failures = 0;
+
+    printf ("Kernels: %s\n", PxLIsaName (PxLHostIsa()));
+    printf ("%-22s %-28s %-10s %10s %10s %10s %8s  %s\n",
+            "Filter", "Format", "ROI", "ns/pixel", "fps", "MB/s", "allocs", "golden");
+    for (size_t f = 0; f < ARRAY_SIZE(s_filters); f++)
+    {
+        if (! strstr (s_filters[f].name, filterMatch)) continue;
+        for (size_t p = 0; p < ARRAY_SIZE(s_formats); p++)
+        {
+            if (! strstr (s_formats[p].name, formatMatch)) continue;
+            for (size_t s = 0; s < roiSizes.size(); s++)
+            {
+                CaseResult result;
+                RunCase (s_filters[f], s_formats[p], roiSizes[s].first, roiSizes[s].second, minSeconds,
+                         &overlay, dumpDir, result);
+                if (! result.supported) continue;
+
+                char roi[32];
+                sprintf (roi, "%dx%d", result.width, result.height);
+                const string key = result.filter + " " + result.format + " " + roi;
+                if (record)
+                {
+                    golden[key] = result.hash;
+                    result.golden = "recorded";
+                } else if (golden.find (key) == golden.end()) {
+                    result.golden = "missing";
+                } else {
+                    result.golden = golden[key] == result.hash ? "match" : "mismatch";
+                }
+                if (result.golden == "mismatch" || result.overrun) failures++;
+
+                printf ("%-22s %-28s %-10s %10.3f %10.1f %10.1f %8.2f  %s%s\n",
+                        result.filter.c_str(), result.format.c_str(), roi,
+                        result.nsPerPixel, result.framesPerSecond, result.megabytesPerSecond,
+                        result.allocationsPerFrame, result.golden.c_str(), result.overrun ? " OVERRUN" : "");
+                results.push_back (result);
+            }
+        }
+    }
+
+    if (record && ! SaveGolden (goldenFile, golden))
+    {
+        printf ("Could not write the golden file %s\n", goldenFile);
+        failures++;
+    }
+    if (! WriteJson (jsonFile, results, failures))
+    {
+        printf ("Could not write the results file %s\n", jsonFile);
+        failures++;
+    }
+
+    printf ("%lu cases, %d failure(s).  Results written to %s\n", (unsigned long)results.size(), failures, jsonFile);
+    return failures ? 1 : 0;
+}
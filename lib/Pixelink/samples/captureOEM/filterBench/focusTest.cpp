@@ -0,0 +1,318 @@
+//
+// focusTest.cpp
+//
+// A headless test of the CaptureOEM host side focus metrics (../src/focus.cpp).
+// No camera, and no GUI, is required.
+//
+// The metrics are checked against a straightforward (scalar, per pixel)
+// computation of their definitions, on deterministic pseudo random frames of
+// awkward sizes, and regions, so that the vector kernels' tails are covered.
+// The sums are exact integers, so the scores must match exactly, whichever
+// instruction set is used.  We also check that:
+//    - the same image scores the same in every pixel format that can be
+//      measured directly
+//    - each metric falls as the image is blurred, and is 0 for a flat image
+//    - frames and regions that can't be measured are rejected
+//
+// Usage:
+//    focusTest [-i isa]
+//
+//       -i  Use kernels for no higher an instruction set than this (scalar, sse4.1, avx2 or neon)
+//
+// Returns 0 if all of the checks pass.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <vector>
+#include <PixeLINKApi.h>
+#include "focus.h"
+#include "filterKernels.h"
+
+using namespace std;
+
+static int s_failures = 0;
+
+#define CHECK(cond, ...) \
+    do { if (!(cond)) { printf ("FAIL: "); printf (__VA_ARGS__); printf ("\n"); s_failures++; } } while (0)
+
+static U32 NextRandom (U32& seed)
+{
+    seed = seed * 1664525 + 1013904223;
+    return seed >> 8;
+}
+
+// A width x height image of 8 bit samples:  a few large blocks, with noise on top, so that it has both
+// edges and texture.
+static void MakeImage (vector<U8>& image, int width, int height, U32 seed)
+{
+    image.resize ((size_t)width * height);
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int value = ((x / 13 + y / 7) & 1) ? 180 : 60;
+            value += (int)(NextRandom (seed) % 41) - 20;
+            image[(size_t)y * width + x] = (U8)value;
+        }
+    }
+}
+
+// The metrics, straight from their definitions (see focus.h), over the region x0..x1-1, y0..y1-1
+static PxLFocusScores Reference (const vector<U8>& image, int width, int x0, int y0, int x1, int y1)
+{
+    U64 gradient = 0, laplacianSquared = 0, brenner = 0;
+    S64 laplacian = 0;
+    for (int y = y0 + 1; y < y1 - 1; y++)
+    {
+        for (int x = x0 + 1; x < x1 - 1; x++)
+        {
+            #define P(dx, dy) ((int)image[(size_t)(y + (dy)) * width + x + (dx)])
+            const int gx = (P(1,-1) - P(-1,-1)) + 2*(P(1,0) - P(-1,0)) + (P(1,1) - P(-1,1));
+            const int gy = (P(-1,1) + 2*P(0,1) + P(1,1)) - (P(-1,-1) + 2*P(0,-1) + P(1,-1));
+            const int l  = P(0,-1) + P(0,1) + P(-1,0) + P(1,0) - 4*P(0,0);
+            const int b  = P(1,0) - P(-1,0);
+            #undef P
+            gradient += (U64)(gx*gx + gy*gy);
+            laplacian += l;
+            laplacianSquared += (U64)(l*l);
+            brenner += (U64)(b*b);
+        }
+    }
+
+    PxLFocusScores scores;
+    const double pixels = (double)(x1 - x0 - 2) * (y1 - y0 - 2);
+    const double laplacianMean = (double)laplacian / pixels;
+    scores.m_tenengrad = (double)gradient / pixels;
+    scores.m_laplacianVariance = (double)laplacianSquared / pixels - laplacianMean * laplacianMean;
+    if (scores.m_laplacianVariance < 0.0) scores.m_laplacianVariance = 0.0;
+    scores.m_brenner = (double)brenner / pixels;
+    scores.m_pixels = (U32)pixels;
+    return scores;
+}
+
+static bool SameScores (const PxLFocusScores& a, const PxLFocusScores& b)
+{
+    return a.m_tenengrad == b.m_tenengrad && a.m_laplacianVariance == b.m_laplacianVariance &&
+           a.m_brenner == b.m_brenner && a.m_pixels == b.m_pixels;
+}
+
+// The image, as a frame of pixelFormat
+static void MakeFrame (const vector<U8>& image, int width, int height, U32 pixelFormat, vector<U8>& frame)
+{
+    const size_t pixels = (size_t)width * height;
+    switch (pixelFormat)
+    {
+    case PIXEL_FORMAT_MONO16:
+        // The MS byte comes first; the LS byte should make no difference
+        frame.resize (pixels * 2);
+        for (size_t i = 0; i < pixels; i++)
+        {
+            frame[2*i] = image[i];
+            frame[2*i+1] = (U8)(i * 37);
+        }
+        break;
+    case PIXEL_FORMAT_RGB24_NON_DIB:
+    case PIXEL_FORMAT_RGB24:
+        // Grey, so that the luminance is the image.  DIBs are 'bottom up'.
+        frame.resize (pixels * 3);
+        for (int y = 0; y < height; y++)
+        {
+            const int row = (pixelFormat == PIXEL_FORMAT_RGB24) ? height - 1 - y : y;
+            for (int x = 0; x < width; x++)
+            {
+                U8* pPixel = &frame[((size_t)row * width + x) * 3];
+                pPixel[0] = pPixel[1] = pPixel[2] = image[(size_t)y * width + x];
+            }
+        }
+        break;
+    default:
+        frame = image;
+        break;
+    }
+}
+
+// A box blur, of radius pixels in each direction
+static void Blur (const vector<U8>& image, int width, int height, int radius, vector<U8>& blurred)
+{
+    blurred.resize (image.size());
+    for (int y = 0; y < height; y++)
+    {
+        for (int x = 0; x < width; x++)
+        {
+            int sum = 0, count = 0;
+            for (int dy = -radius; dy <= radius; dy++)
+            {
+                for (int dx = -radius; dx <= radius; dx++)
+                {
+                    const int sx = x + dx, sy = y + dy;
+                    if (sx < 0 || sy < 0 || sx >= width || sy >= height) continue;
+                    sum += image[(size_t)sy * width + sx];
+                    count++;
+                }
+            }
+            blurred[(size_t)y * width + x] = (U8)(sum / count);
+        }
+    }
+}
+
+// The metrics match their definitions, for any size of frame and region
+static void TestAgainstReference ()
+{
+    static const int sizes[][2] = {{3, 3}, {8, 5}, {17, 9}, {33, 20}, {64, 48}, {101, 37}, {320, 240}};
+    PxLFocusMetric metric;
+    vector<U8> image;
+    U32 seed = 1;
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++)
+    {
+        const int width = sizes[s][0], height = sizes[s][1];
+        MakeImage (image, width, height, (U32)s + 1);
+
+        // The whole frame, and then some regions within it (one of which hangs off the frame)
+        for (int r = 0; r < 6; r++)
+        {
+            PXL_ROI region;
+            int x0 = 0, y0 = 0, x1 = width, y1 = height;
+            if (r > 0)
+            {
+                region.m_offsetX = (int)(NextRandom (seed) % width);
+                region.m_offsetY = (int)(NextRandom (seed) % height);
+                region.m_width = 3 + (int)(NextRandom (seed) % width);
+                region.m_height = 3 + (int)(NextRandom (seed) % height);
+                if (r == 5) region.m_offsetX = region.m_offsetY = -2;
+                x0 = max (0, region.m_offsetX);
+                y0 = max (0, region.m_offsetY);
+                x1 = min (width, region.m_offsetX + region.m_width);
+                y1 = min (height, region.m_offsetY + region.m_height);
+                if (x1 - x0 < 3 || y1 - y0 < 3) continue;
+            }
+
+            PxLFocusScores scores;
+            PXL_RETURN_CODE rc = metric.measure (&image[0], image.size(), PIXEL_FORMAT_MONO8, width, height, region, scores);
+            CHECK (API_SUCCESS (rc), "%dx%d region %d: measure failed (0x%08X)", width, height, r, rc);
+            PxLFocusScores expected = Reference (image, width, x0, y0, x1, y1);
+            CHECK (SameScores (scores, expected),
+                   "%dx%d region (%d,%d)-(%d,%d): tenengrad %f, laplacian %f, brenner %f; expected %f, %f, %f",
+                   width, height, x0, y0, x1, y1,
+                   scores.m_tenengrad, scores.m_laplacianVariance, scores.m_brenner,
+                   expected.m_tenengrad, expected.m_laplacianVariance, expected.m_brenner);
+        }
+    }
+}
+
+// The same image scores the same, in every format we can measure directly
+static void TestFormats ()
+{
+    static const U32 formats[] = {PIXEL_FORMAT_MONO16, PIXEL_FORMAT_RGB24, PIXEL_FORMAT_RGB24_NON_DIB};
+    const int width = 61, height = 29;
+    PxLFocusMetric metric;
+    vector<U8> image, frame;
+    MakeImage (image, width, height, 7);
+    PXL_ROI whole;
+
+    PxLFocusScores mono8;
+    metric.measure (&image[0], image.size(), PIXEL_FORMAT_MONO8, width, height, whole, mono8);
+    for (size_t f = 0; f < sizeof(formats) / sizeof(formats[0]); f++)
+    {
+        CHECK (PxLFocusMetric::measurable (formats[f]), "pixel format %u should be measurable", formats[f]);
+        MakeFrame (image, width, height, formats[f], frame);
+        PxLFocusScores scores;
+        PXL_RETURN_CODE rc = metric.measure (&frame[0], frame.size(), formats[f], width, height, whole, scores);
+        CHECK (API_SUCCESS (rc) && SameScores (scores, mono8),
+               "pixel format %u scores differently from MONO8 (0x%08X)", formats[f], rc);
+    }
+}
+
+// Blurrier images score lower, by every metric; a flat image scores 0
+static void TestBlur ()
+{
+    const int width = 96, height = 64;
+    PxLFocusMetric metric;
+    vector<U8> image, blurred;
+    MakeImage (image, width, height, 3);
+    PXL_ROI whole;
+
+    PxLFocusScores last;
+    for (int radius = 0; radius <= 4; radius++)
+    {
+        Blur (image, width, height, radius, blurred);
+        PxLFocusScores scores;
+        metric.measure (&blurred[0], blurred.size(), PIXEL_FORMAT_MONO8, width, height, whole, scores);
+        if (radius > 0)
+        {
+            for (int m = 0; m < FOCUS_METRIC_COUNT; m++)
+            {
+                CHECK (scores.score ((PXL_FOCUS_METRIC)m) < last.score ((PXL_FOCUS_METRIC)m),
+                       "%s did not fall when blurred to radius %d (%f, from %f)", PxLFocusMetricName ((PXL_FOCUS_METRIC)m),
+                       radius, scores.score ((PXL_FOCUS_METRIC)m), last.score ((PXL_FOCUS_METRIC)m));
+            }
+        }
+        last = scores;
+    }
+
+    vector<U8> flat (width * height, 128);
+    PxLFocusScores scores;
+    metric.measure (&flat[0], flat.size(), PIXEL_FORMAT_MONO8, width, height, whole, scores);
+    for (int m = 0; m < FOCUS_METRIC_COUNT; m++)
+    {
+        CHECK (scores.score ((PXL_FOCUS_METRIC)m) == 0.0, "%s of a flat image is %f",
+               PxLFocusMetricName ((PXL_FOCUS_METRIC)m), scores.score ((PXL_FOCUS_METRIC)m));
+    }
+}
+
+// What can't be measured, isn't
+static void TestRejects ()
+{
+    const int width = 16, height = 16;
+    PxLFocusMetric metric;
+    vector<U8> image (width * height * 2, 0);
+    PxLFocusScores scores;
+    PXL_ROI whole;
+
+    CHECK (! PxLFocusMetric::measurable (PIXEL_FORMAT_YUV422), "YUV422 should not be measurable");
+    CHECK (metric.measure (&image[0], image.size(), PIXEL_FORMAT_YUV422, width, height, whole, scores) == ApiInvalidParameterError,
+           "YUV422 frame was measured");
+    CHECK (metric.measure (&image[0], width * height - 1, PIXEL_FORMAT_MONO8, width, height, whole, scores) == ApiInvalidParameterError,
+           "a short frame was measured");
+    CHECK (metric.measure (NULL, image.size(), PIXEL_FORMAT_MONO8, width, height, whole, scores) == ApiInvalidParameterError,
+           "a NULL frame was measured");
+    PXL_ROI thin (2, 10, 4, 4);
+    CHECK (metric.measure (&image[0], image.size(), PIXEL_FORMAT_MONO8, width, height, thin, scores) == ApiInvalidParameterError,
+           "a region 2 pixels wide was measured");
+    PXL_ROI outside (8, 8, width + 1, 0);
+    CHECK (metric.measure (&image[0], image.size(), PIXEL_FORMAT_MONO8, width, height, outside, scores) == ApiInvalidParameterError,
+           "a region outside of the frame was measured");
+
+    for (int m = 0; m < FOCUS_METRIC_COUNT; m++)
+    {
+        CHECK (PxLFocusMetricFromName (PxLFocusMetricName ((PXL_FOCUS_METRIC)m)) == m, "metric %d's name does not map back to it", m);
+    }
+    CHECK (PxLFocusMetricFromName ("sharpness") == FOCUS_METRIC_COUNT, "an unknown metric name was accepted");
+}
+
+int main (int argc, char* argv[])
+{
+    int opt;
+    while ((opt = getopt (argc, argv, "i:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'i': setenv ("PXL_FILTER_ISA", optarg, 1); break;  // Must be done before the first measurement
+        default:
+            printf ("Usage: %s [-i isa]\n", argv[0]);
+            return 1;
+        }
+    }
+    printf ("Kernels: %s\n", PxLIsaName (PxLHostIsa()));
+
+    TestAgainstReference();
+    TestFormats();
+    TestBlur();
+    TestRejects();
+
+    printf ("%s (%d failures)\n", s_failures ? "FAILED" : "PASSED", s_failures);
+    return s_failures ? 1 : 0;
+}
@@ -16,6 +16,7 @@
 #include "roi.h"
 #include "slider.h"
 #include "tab.h"
+#include "thumbnail.h"
 
 #define ROI_AREA_WIDTH  384 // Must match the size in the Glade project
 #define ROI_AREA_HEIGHT 288 // Must match the size in the Glade project
@@ -80,6 +81,7 @@ public:
 
 
     GdkPixbuf    *m_roiBuf;  //buffer used for roi image -- Either from the camera, or a default message
+    PxLThumbnail  m_roiThumbnail; // owns m_roiBuf, while it holds an image from the camera
     // AUTOROI button limits.  The values are pixels coordinates within the roi image
     // work area.  If the roi has the same aspect ration of ROI_AREA_WIDTH x ROI_AREA_HEIGHT,
     // then m_autoroiButtonLimits will be {0, ROI_AREA_WIDTH, 0, ROI_AREA_HEIGHT}.  Otherwise,
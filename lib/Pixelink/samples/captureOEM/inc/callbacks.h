@@ -0,0 +1,41 @@
+/***************************************************************************
+ *
+ *     File: callbacks.h
+ *
+ *     Description:
+ *         The preview filter callbacks (callbacks.cpp) offered by the 'filter' tab
+ *         in CaptureOEM.  These have no GUI dependencies, so that they can also be
+ *         used by headless tools (see filterBench).
+ *
+ *         Each callback expects a PxLFilterStream (filterStream.h) as it's context.
+ *
+ */
+
+#if !defined(PIXELINK_CALLBACKS_H)
+#define PIXELINK_CALLBACKS_H
+
+#include <PixeLINKApi.h>
+
+#define PXLAPI_CALLBACK(funcname)                         \
+    U32 funcname( HANDLE hCamera,               \
+                  LPVOID pFrameData,            \
+                  U32 uDataFormat,              \
+                  FRAME_DESC const * pFrameDesc,\
+                  LPVOID pContext)              \
+
+extern PXLAPI_CALLBACK (PxLCallbackNegative);
+extern PXLAPI_CALLBACK (PxLCallbackGrayscale);
+extern PXLAPI_CALLBACK (PxLCallbackHistogramEqualization);
+extern PXLAPI_CALLBACK (PxLCallbackSaturatedAndBlack);
+extern PXLAPI_CALLBACK (PxLCallbackTreshold50Percent);
+extern PXLAPI_CALLBACK (PxLCallbackLowPass);
+extern PXLAPI_CALLBACK (PxLCallbackMedian);
+extern PXLAPI_CALLBACK (PxLCallbackHighPass);
+extern PXLAPI_CALLBACK (PxLCallbackSobel);
+extern PXLAPI_CALLBACK (PxLCallbackTemporalTheshold);
+extern PXLAPI_CALLBACK (PxLCallbackMotionDetector);
+extern PXLAPI_CALLBACK (PxLCallbackAscii);
+extern PXLAPI_CALLBACK (PxLCallbackBitmapOverlay);
+extern PXLAPI_CALLBACK (PxLCallbackCrosshairOverlay);
+
+#endif // !defined(PIXELINK_CALLBACKS_H)
@@ -14,8 +14,11 @@
 #include <stdio.h>
 #include <assert.h>
 #include <memory>
+#include <vector>
 #include "PixeLINKApi.h"
+#include "PxLProfile.h"
 #include "featurePoller.h"
+#include "locks.h"
 #include "roi.h"
 #include "pixelFormat.h"
 
@@ -83,9 +86,38 @@ public:
     float m_param3;
 };
 
+// How much the camera's locks are being used, and how often the cached feature values could be used
+// instead of asking the camera.
+class PxLCameraLockStatistics
+{
+public:
+    PxLLockStatistics m_featureReads;
+    PxLLockStatistics m_featureWrites;
+    PxLLockStatistics m_stream;
+    U32               m_cacheHits;
+    U32               m_cacheMisses;
+};
+
+// The most recent value read for a feature.  These are read without taking any lock; m_generation
+// is 0 while the entry is being updated (see PxLCamera::cachedFeature).
+class PxLCachedFeature
+{
+public:
+    PxLCachedFeature();
+
+    static const ULONG MAX_PARAMS = 6;
+
+    volatile U32 m_generation;  // The camera's cache generation when this value was read
+    ULONG        m_capacity;    // The number of parameters that were asked for
+    ULONG        m_flags;
+    ULONG        m_numParams;
+    float        m_params[MAX_PARAMS];
+};
+
 class PxLCamera
 {
     friend class PxLInterruptStream;
+    friend class PxLSettingsTransaction;
 public:
 
     // Constructor
@@ -167,6 +199,7 @@ public:
     PXL_RETURN_CODE loadSettings (bool factoryDefaults);
     PXL_RETURN_CODE saveSettings ();
     FRAME_RATE_LIMITER actualFrameRatelimiter ();
+    PxLCameraLockStatistics lockStatistics ();
 
     PxLFeaturePoller* m_poller;
 
@@ -177,12 +210,48 @@ private:
     bool   requiresStreamStop (ULONG feature);
     float  pixelSize (ULONG pixelFormat);
 
+    // All feature accesses are done through these, so that they are serialized by m_featureLock.  Note
+    // that m_featureLock is only held for the duration of the one API call.
+    PXL_RETURN_CODE getFeature (ULONG feature, ULONG* flags, ULONG* numParams, float* params);
+    PXL_RETURN_CODE setFeature (ULONG feature, ULONG flags, ULONG numParams, const float* params);
+    PXL_RETURN_CODE applyFeature (ULONG feature, ULONG flags, ULONG numParams, const float* params);
+    PXL_RETURN_CODE getCameraFeatures (ULONG feature, CAMERA_FEATURES* pFeatureInfo, ULONG* bufferSize);
+    PXL_RETURN_CODE describeFeature (ULONG feature, CAMERA_FEATURES* pFeatureInfo, ULONG* bufferSize);
+    PXL_RETURN_CODE getParamLimits (ULONG feature, std::vector<FEATURE_PARAM>& limits);
+    PXL_RETURN_CODE untransformRoi (ROI_TYPE type, PXL_ROI& roi);
+
+    // The cache of feature values, for those features that only change when we change them.
+    bool   cachedFeature (ULONG feature, ULONG* flags, ULONG* numParams, float* params);
+    void   cacheFeature (ULONG feature, ULONG capacity, ULONG flags, ULONG numParams, const float* params);
+    void   invalidateCache ();
+
     ULONG  m_serialNum; // serial number of our camera
 
     HANDLE m_hCamera;   // handle to our camera
 
-    ULONG  m_streamState;
-    ULONG  m_previewState;
+    // The camera's feature descriptions, kept on disk (see PxLProfile.h) so that bringing the camera up, and
+    // the tabs, needn't ask it for them again.  Only valid if m_haveFeatures.
+    PxLFeatureCache m_features;
+    bool   m_haveFeatures;
+
+    // The stream and preview state can be read (streaming(), previewing()) without taking any
+    // lock, but they are only changed while holding m_streamLock.
+    volatile ULONG  m_streamState;
+    volatile ULONG  m_previewState;
+
+    PxLRwLock  m_featureLock;     // Held (for reading) while getting a feature, and (for writing) while setting one
+    PxLMutex   m_streamLock;      // Held while changing the stream or preview state.  Take it before m_featureLock
+
+    pthread_mutex_t  m_cacheFillLock;   // Only one thread updates the cache at a time
+    volatile U32     m_cacheGeneration; // Incremented whenever a feature is set, making all cached values stale
+    volatile U32     m_cacheHits;
+    volatile U32     m_cacheMisses;
+    PxLCachedFeature m_cache[FEATURES_TOTAL];
+
+    // The parameter limits of each feature, as last reported by the camera.  These are protected by
+    // m_cacheFillLock, and are stale if their generation is not m_cacheGeneration.
+    std::vector<FEATURE_PARAM> m_limits[FEATURES_TOTAL];
+    U32                        m_limitsGeneration[FEATURES_TOTAL];
 
     HWND   m_previewHandle;
 
@@ -272,12 +341,16 @@ inline float PxLCamera::pixelSize(ULONG pixelFormat)
 // of the video stream within the scope of a code block.  Note that this
 // class will also pause the preview (if necessary) -- doing this makes
 // the stream interruption a little smoother
+//
+// The stream lock is held for the lifetime of the interruption, so that no one else changes
+// the stream state while we have it interrupted.
 class PxLInterruptStream
 {
 public:
     PxLInterruptStream(PxLCamera* pCam, ULONG newState)
     : m_pCam(pCam)
     {
+        pCam->m_streamLock.lock();
         m_oldStreamState = pCam->m_streamState;
         m_oldPreviewState = pCam->m_previewState;
         if (newState != m_oldStreamState)
@@ -315,6 +388,7 @@ public:
             }
             if (m_oldPreviewState == START_PREVIEW) m_pCam->playPreview();
         }
+        m_pCam->m_streamLock.unlock();
     }
 private:
     PxLCamera*   m_pCam;
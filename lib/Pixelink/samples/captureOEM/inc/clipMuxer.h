@@ -0,0 +1,132 @@
+
+/***************************************************************************
+ *
+ *     File: clipMuxer.h
+ *
+ *     Description:
+ *       Muxes the H.264 elementary stream of a clip capture into its AVI or
+ *       MP4 container as the API produces it, rather than with a second pass
+ *       over the whole encoded file (PxLFormatClipEx) once the capture is done.
+ *
+ *       The API writes the elementary stream to the encoded file as usual; a
+ *       thread follows that file as it grows, splits it into access units
+ *       (frames), and appends each to the container.  The container index
+ *       is built up as the frames are written:
+ *          - AVI:  the idx1 entries are kept in memory (16 bytes a frame), and
+ *                  written, along with the frame counts, when the clip ends.
+ *          - MP4:  the file is fragmented; each fragment (a GOP, or at most
+ *                  MAX_FRAGMENT_FRAMES) carries its own index, so the file is
+ *                  playable up to the last complete fragment at any time.
+ *       Either way, the video file is complete moments after the capture.
+ *
+ *       Optionally, the encoded 'file' can instead be a FIFO, so that the
+ *       elementary stream never touches the disk at all.
+ *
+ */
+
+#if !defined(PIXELINK_CLIP_MUXER_H)
+#define PIXELINK_CLIP_MUXER_H
+
+#include <string>
+#include <vector>
+#include <glib.h>
+#include "PixeLINKApi.h"
+
+class PxLClipWriter;
+
+// Where the muxer reads the elementary stream from
+typedef enum _CLIP_MUX_INPUT
+{
+    MUX_INPUT_FILE = 0,   // Follow the encoded file as the API writes it
+    MUX_INPUT_FIFO        // The encoded file is replaced by a FIFO, read as the API writes to it
+} CLIP_MUX_INPUT;
+
+class PxLClipMuxStatistics
+{
+public:
+    PxLClipMuxStatistics ();
+
+    U32    m_frames;        // Frames written to the video file
+    U32    m_keyFrames;
+    U64    m_bytesIn;       // Size of the elementary stream
+    U64    m_bytesOut;      // Size of the video file
+    double m_finishTime;    // Time (in seconds) from the end of the capture, to the video file being complete
+};
+
+class PxLClipMuxer
+{
+public:
+    // Constructor
+    PxLClipMuxer ();
+    // Destructor
+    ~PxLClipMuxer ();
+
+    // Start muxing, into videoFile (CLIP_FORMAT_AVI or CLIP_FORMAT_MP4), the encoded file that is about
+    // to be captured.  width and height are those of the frames; frameRate is the playback rate.
+    PXL_RETURN_CODE begin (LPCSTR encodedFile, LPCSTR videoFile, ULONG videoFormat,
+                           int width, int height, float frameRate, CLIP_MUX_INPUT input);
+    // The API has finished writing the encoded file (successfully).
+    void inputComplete ();
+    // Waits for the last of the frames to be written, and returns the outcome.
+    PXL_RETURN_CODE end ();
+    // The capture failed; stop, and remove the (partial) video file.
+    void abort ();
+
+    bool active ();
+    PxLClipMuxStatistics statistics ();   // Only valid once ended
+
+    // The body of the mux thread
+    void run ();
+
+private:
+    PXL_RETURN_CODE openInput ();
+    int             readInput (U8* pBuf, int size);
+    void            splitNalUnits (bool endOfStream);
+    void            nalUnit (const U8* pNal, size_t size);
+    void            accessUnitComplete ();
+    void            closeFifoWriter ();
+
+    std::string     m_encodedFile;
+    std::string     m_videoFile;
+    int             m_width;
+    int             m_height;
+    float           m_frameRate;
+    CLIP_MUX_INPUT  m_input;
+
+    int             m_inputFd;
+    int             m_fifoWriterFd;   // Held open until the capture ends, so that we don't see EOF early
+    volatile bool   m_inputComplete;
+    volatile bool   m_aborted;
+    double          m_completeTime;   // When the capture ended
+
+    bool            m_active;
+    GThread*        m_thread;
+    PXL_RETURN_CODE m_rc;
+    PxLClipWriter*  m_writer;
+    FILE*           m_file;
+
+    // Parse state, owned by the mux thread
+    std::vector<U8> m_pending;        // Input that has not yet been split into NAL units
+    size_t          m_nalStart;       // Start of the current NAL unit in m_pending (past its start code)
+    size_t          m_scanPos;        // Where to resume looking for the next start code
+    bool            m_haveNal;
+    std::vector<U8> m_accessUnit;     // NAL units of the current frame, each with a 4 byte (big endian) length
+    bool            m_auHasSlice;
+    bool            m_auKey;
+    std::vector<U8> m_sps;
+    std::vector<U8> m_pps;
+
+    PxLClipMuxStatistics m_stats;
+};
+
+inline bool PxLClipMuxer::active ()
+{
+    return m_active;
+}
+
+inline PxLClipMuxStatistics PxLClipMuxer::statistics ()
+{
+    return m_stats;
+}
+
+#endif // !defined(PIXELINK_CLIP_MUXER_H)
@@ -0,0 +1,107 @@
+
+/***************************************************************************
+ *
+ *     File: edges.h
+ *
+ *     Description:
+ *       Per-stream state used by the Sobel (edge) filter in CaptureOEM.
+ *
+ *       The filter computes both Sobel gradients in a single pass over the
+ *       frame, keeping only a rolling window of three rows, and replaces the
+ *       frame with either the gradient magnitude, or (if thinning is enabled)
+ *       with the edges that survive non-maximum suppression.
+ *
+ *       Optionally, the results can also be published for use from other
+ *       threads (see getEdges), as 8 bit maps of:
+ *          - the gradient magnitude
+ *          - the gradient orientation, quantized to one of 4 directions
+ *          - the thinned edges
+ *
+ */
+
+#if !defined(PIXELINK_EDGES_H)
+#define PIXELINK_EDGES_H
+
+#include <pthread.h>
+#include <vector>
+#include "PixeLINKApi.h"
+#include "scratchArena.h"
+
+// A snapshot of the results of the most recent edge detection.  All maps are m_width x m_height,
+// with row 0 being the top of the image.
+class PxLEdgeResult
+{
+public:
+    // Gradient orientations.  The names are the direction of the gradient (not of the edge), with
+    // y increasing down the image.
+    typedef enum _EDGE_ORIENTATION
+    {
+        ORIENTATION_0 = 0,    // horizontal
+        ORIENTATION_45,       // down and to the right
+        ORIENTATION_90,       // vertical
+        ORIENTATION_135,      // down and to the left
+        ORIENTATION_NONE = 0xFF  // magnitude below the edge threshold
+    } EDGE_ORIENTATION;
+
+    PxLEdgeResult () : m_frameNumber(0), m_width(0), m_height(0), m_edgeCount(0) {}
+
+    U32  m_frameNumber;
+    int  m_width;
+    int  m_height;
+    std::vector<U8> m_magnitude;    // Gradient magnitude, scaled to 8 bits
+    std::vector<U8> m_orientation;  // EDGE_ORIENTATION; empty unless orientations are enabled
+    std::vector<U8> m_edges;        // 0xFF for each (thinned) edge pixel; empty unless thinning is enabled
+    U32  m_edgeCount;               // Number of pixels in m_edges
+};
+
+class PxLEdgeState
+{
+public:
+    typedef enum _MAGNITUDE_NORM
+    {
+        NORM_L1 = 0,    // |Gx| + |Gy|
+        NORM_L2         // sqrt (Gx^2 + Gy^2)
+    } MAGNITUDE_NORM;
+
+    // Minimum magnitude of an edge, in 8 bit sample units.  The magnitude is scaled by the gain of the
+    // Sobel operator (4), so a step of N produces a magnitude of N.
+    static const U8 DEFAULT_EDGE_THRESHOLD = 16;
+
+    // Constructor
+    PxLEdgeState ();
+    // Destructor
+    ~PxLEdgeState ();
+
+    // These may be called from any thread; they take effect on the next frame.
+    void setNorm (MAGNITUDE_NORM norm);
+    void setThreshold (U8 threshold);
+    void setThinning (bool thin);             // Output the thinned edges, rather than the magnitude
+    void setOrientation (bool orientation);   // Publish the orientation map
+    void setPublish (bool publish);           // Make the results available from getEdges
+
+    // Called from the stream (callback) thread, once per frame.
+    PXL_RETURN_CODE sobelFilter (void* pFrameData, U32 pixelFormat, FRAME_DESC const * pFrameDesc, PxLScratchArena& arena);
+
+    // Thread safe copy of the most recent published results.  Returns false if there are none.
+    bool getEdges (PxLEdgeResult& result);
+
+private:
+    void publish (U32 frameNumber);
+
+    volatile int m_norm;
+    volatile U8  m_threshold;
+    volatile int m_thin;
+    volatile int m_orientation;
+    volatile int m_publish;
+
+    // The results being built for the current frame; owned by the stream thread.  Swapped with m_result
+    // once complete, so that neither needs to be reallocated once they reach the frame size.
+    PxLEdgeResult   m_pending;
+
+    // Results, protected by m_resultLock
+    pthread_mutex_t m_resultLock;
+    PxLEdgeResult   m_result;
+    bool            m_haveResult;
+};
+
+#endif // !defined(PIXELINK_EDGES_H)
@@ -14,6 +14,9 @@
  *          - A function that will be called to update the features controls to
  *            the value in use by the camera.
  *
+ *       All of the features are read together, and the controls are only updated
+ *       when one of them has changed.  While nothing changes, we poll less often.
+ *
  */
 
 #if !defined(PIXELINK_FEATURE_POLLER_H)
@@ -22,13 +25,48 @@
 #include <vector>
 #include <gtk/gtk.h>
 #include "PixeLINKApi.h"
+#include "locks.h"
+
+class PxLCamera;
 
 // data types/class for the following functions:
 //   1. that we use to check specific features to see if they have changed, and
 //   2. that we call to update the user (GUI) control for that feature
+// The poll function should return ApiSuccessParametersChanged if the feature's value has changed since
+// it was last read; the controls are only updated when something has changed.
+// The poll functions are called from the poll thread WITHOUT gCameraLock.  This is safe, as the camera joins
+// the poll thread before it is destroyed; they should only read the camera's features, and record what they
+// read (in a PxLPolledValue) for the update function (which is called on the GUI thread, with gCameraLock).
+// They must not touch the tabs, or any other GUI state -- that is only safe with gCameraLock.
 typedef PXL_RETURN_CODE ( * PXL_POLL_FEATURE_FUNCTION)();
 typedef void ( * PXL_UPDATE_CONTROLS_FUNCTION)();
 
+// What a poll function last read, handed over to its update function.  Also used for the little a poll
+// function needs to know about the camera (set on the GUI thread, when the feature is added to the poll list).
+template <typename T> class PxLPolledValue
+{
+public:
+    PxLPolledValue () : m_value() {}
+
+    // Records a value; returns true if it differs from the one before
+    bool store (const T& value)
+    {
+        PxLAutoMutex lock(&m_lock);
+        bool changed = !(value == m_value);
+        m_value = value;
+        return changed;
+    }
+    T    load ()
+    {
+        PxLAutoMutex lock(&m_lock);
+        return m_value;
+    }
+
+private:
+    PxLMutex m_lock;
+    T        m_value;
+};
+
 class PxLFeaturePollFunctions
 {
 public:
@@ -39,24 +77,57 @@ public:
     PXL_UPDATE_CONTROLS_FUNCTION m_updateControls; // Update the user controls
 };
 
+// The cost of polling.  Each poll reads each of the features from the camera, holding the camera's
+// feature lock (for reading) while it does each read.
+class PxLPollStatistics
+{
+public:
+    PxLPollStatistics ();
+
+    U32    m_polls;           // Number of polls performed
+    U32    m_updates;         // Number of those polls that updated the controls
+    U32    m_lastReads;       // Number of features read by the most recent poll
+    double m_lastDuration;    // Time (in seconds) the most recent poll spent reading the features
+    double m_totalDuration;
+    double m_maxDuration;
+    ULONG  m_interval;        // Current time (in milliseconds) between polls
+};
+
 class PxLFeaturePoller
 {
 public:
     // Constructor
     // updateInterval is the number of milliseconds between each update of the features being polled
-    PxLFeaturePoller (ULONG updateInterval);
+    PxLFeaturePoller (PxLCamera* pCamera, ULONG updateInterval);
 	// Destructor
 	~PxLFeaturePoller ();
 
 	void pollAdd (const PxLFeaturePollFunctions& functions);    // Add a feature to the poll list
     void pollRemove (const PxLFeaturePollFunctions& functions); // remove a feature from the poll list
     bool polling (const PxLFeaturePollFunctions& functions);    // returns true if the currently polling for the specified feature
+    PxLPollStatistics statistics ();                            // The cost of polling, so far
+
+    PxLCamera* m_pCamera;                                // The camera that owns us
 
+    // Protects all of the poll state below.  Note that this lock is never held while the features are read
+    // (the poll thread works from a copy of the poll list), nor while the controls are updated.
+    PxLMutex m_lock;
     std::vector<PxLFeaturePollFunctions> m_pollList;     // The set of features requiring polling
 
     static const ULONG m_pollInterval = 200; //200 ms between polls ensures the poll thread will exit quickly
     ULONG m_pollsPerUpdate;
 
+    // While the features are not changing, the time between polls doubles (up to m_maxBackoff times the
+    // update interval).  Once at the maximum, the controls are updated after every poll regardless, so
+    // that they can notice when they no longer need to be polled.
+    static const ULONG m_maxBackoff = 4;
+    ULONG m_backoff;
+    volatile bool m_pollSoon;   // A feature was just added; poll it (and update the controls) on the next tick
+    bool  m_updatePending;      // updateFeatureControls has been scheduled, but has not run yet
+
+    bool  m_reportStatistics;   // Print the cost of each poll (set PXL_POLL_STATS in the environment)
+    PxLPollStatistics m_statistics;
+
     bool     m_pollThreadRunning;
     GThread *m_pollThread;
 };
@@ -16,13 +16,8 @@
 #include <SDL2/SDL.h>
 #include "camera.h"
 #include "tab.h"
-
-#define PXLAPI_CALLBACK(funcname)                         \
-    U32 funcname( HANDLE hCamera,               \
-                  LPVOID pFrameData,            \
-                  U32 uDataFormat,              \
-                  FRAME_DESC const * pFrameDesc,\
-                  LPVOID pContext)              \
+#include "callbacks.h"
+#include "filterStream.h"
 
 class PxLFilter : public PxLTab
 {
@@ -64,9 +59,16 @@ public:
     GtkWidget    *m_filterLocation;
     GtkWidget    *m_filterLocationBrowser;
 
+    // Options of the temporal threshold and motion detector filters (see temporal.h)
+    GtkWidget    *m_noiseFloor;
+    GtkWidget    *m_motionThreshold;
+    GtkWidget    *m_blockPercent;
 
     // The bitmap overlay to be used by the bitmap overlay callback.  NULL if not valid.
     SDL_Surface* m_bitmapOverlay;
+
+    // The per-stream state (scratch buffers, frame history, etc) passed to all of the callbacks
+    PxLFilterStream m_filterStream;
 };
 
 #endif // !defined(PIXELINK_FILTER_H)
@@ -0,0 +1,155 @@
+
+/***************************************************************************
+ *
+ *     File: filterKernels.h
+ *
+ *     Description:
+ *       Run time selection of the kernels used by the preview filters in
+ *       CaptureOEM.
+ *
+ *       Each kernel is specialized at compile time for one pixel layout and one
+ *       instruction set; the one to use is chosen once, based on the pixel format
+ *       and the instruction sets supported by the CPU we are running on, and
+ *       cached in the stream's PxLKernelCache.  So, the per-frame path is
+ *       simply a call through a function pointer.
+ *
+ *       Setting the environment variable PXL_FILTER_ISA (to scalar, sse4.1, avx2,
+ *       or neon) limits the instruction sets that will be used.
+ *
+ *       The 'per pixel' filters (Negative, Threshold, Saturated and Black,
+ *       Grayscale) have kernels for each instruction set (see filterKernels.cpp).
+ *       The 'frame' filters (Median, Low Pass, High Pass, Histogram Equalization
+ *       and the overlays), which need a pixel's neighbours or the statistics of the
+ *       whole frame, only have plain C kernels; they are with the filters
+ *       themselves, in callbacks.cpp.
+ *
+ */
+
+#if !defined(PIXELINK_FILTER_KERNELS_H)
+#define PIXELINK_FILTER_KERNELS_H
+
+#include "PixeLINKApi.h"
+
+// Instruction set levels, for which we have kernels.  On x86, each level includes
+// those below it.
+typedef enum _PXL_ISA_LEVEL
+{
+    ISA_SCALAR = 0,
+    ISA_SSE41,
+    ISA_AVX2,
+    ISA_NEON,
+    ISA_COUNT
+} PXL_ISA_LEVEL;
+
+// For the kernel implementations:  the x86 kernels are compiled for their instruction set using the
+// target attribute, so that they can be built into a binary that still runs on any x86 CPU.
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PXL_X86_KERNELS
+#define PXL_TARGET_SSE41 __attribute__((target("sse4.1")))
+#define PXL_TARGET_AVX2  __attribute__((target("avx2")))
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define PXL_NEON_KERNELS
+#endif
+
+// The filters that have kernels
+typedef enum _PXL_PIXEL_FILTER
+{
+    PIXEL_FILTER_NEGATIVE = 0,
+    PIXEL_FILTER_THRESHOLD_50,
+    PIXEL_FILTER_SATURATED_AND_BLACK,
+    PIXEL_FILTER_GRAYSCALE,
+    PIXEL_FILTER_COUNT
+} PXL_PIXEL_FILTER;
+
+// A kernel filters (in place) numPixels consecutive pixels.
+typedef void (*PxLPixelKernel) (U8* pData, U32 numPixels);
+
+// The best instruction set level supported by this CPU (and this build), limited by
+// PXL_FILTER_ISA.  Determined on first use.
+PXL_ISA_LEVEL PxLHostIsa ();
+const char*   PxLIsaName (PXL_ISA_LEVEL isa);
+// The next level to try, should there be no kernel for a level.
+PXL_ISA_LEVEL PxLFallbackIsa (PXL_ISA_LEVEL isa);
+
+// Returns the fastest kernel, no higher than isa, for the filter and pixel format.  Returns NULL
+// if the filter does not support the pixel format.
+PxLPixelKernel PxLSelectPixelKernel (PXL_PIXEL_FILTER filter, U32 uDataFormat, PXL_ISA_LEVEL isa);
+
+// The filters that work on the frame as a whole
+typedef enum _PXL_FRAME_FILTER
+{
+    FRAME_FILTER_MEDIAN = 0,
+    FRAME_FILTER_LOW_PASS,
+    FRAME_FILTER_HIGH_PASS,
+    FRAME_FILTER_HISTOGRAM_EQUALIZATION,
+    FRAME_FILTER_BITMAP_OVERLAY,
+    FRAME_FILTER_CROSSHAIR_OVERLAY,
+    FRAME_FILTER_COUNT
+} PXL_FRAME_FILTER;
+
+class PxLScratchArena;
+
+// A frame kernel filters (in place) a width x height frame, drawing any temporary buffers from arena.  pArg
+// is specific to the filter (the bitmap, for the bitmap overlay).
+typedef void (*PxLFrameKernel) (U8* pData, int width, int height, PxLScratchArena& arena, const void* pArg);
+
+// Returns the kernel for the filter and pixel format.  Returns NULL if the filter does not support
+// the pixel format.
+PxLFrameKernel PxLSelectFrameKernel (PXL_FRAME_FILTER filter, U32 uDataFormat);
+
+//
+// The kernels most recently selected for a stream.  Owned by the stream (callback) thread.
+class PxLKernelCache
+{
+public:
+    // Constructor
+    PxLKernelCache ();
+
+    // Returns the kernel to use for the filter and pixel format (NULL if the filter does not
+    // support the pixel format).  Only does the selection when either of them changes.
+    PxLPixelKernel kernel (PXL_PIXEL_FILTER filter, U32 uDataFormat);
+    PxLFrameKernel kernel (PXL_FRAME_FILTER filter, U32 uDataFormat);
+
+private:
+    PXL_PIXEL_FILTER m_filter;
+    U32              m_format;
+    PxLPixelKernel   m_kernel;
+
+    PXL_FRAME_FILTER m_frameFilter;
+    U32              m_frameFormat;
+    PxLFrameKernel   m_frameKernel;
+};
+
+inline PxLKernelCache::PxLKernelCache ()
+: m_filter (PIXEL_FILTER_COUNT)
+, m_format (0)
+, m_kernel (NULL)
+, m_frameFilter (FRAME_FILTER_COUNT)
+, m_frameFormat (0)
+, m_frameKernel (NULL)
+{
+}
+
+inline PxLPixelKernel PxLKernelCache::kernel (PXL_PIXEL_FILTER filter, U32 uDataFormat)
+{
+    if (filter != m_filter || uDataFormat != m_format)
+    {
+        m_kernel = PxLSelectPixelKernel (filter, uDataFormat, PxLHostIsa());
+        m_filter = filter;
+        m_format = uDataFormat;
+    }
+    return m_kernel;
+}
+
+inline PxLFrameKernel PxLKernelCache::kernel (PXL_FRAME_FILTER filter, U32 uDataFormat)
+{
+    if (filter != m_frameFilter || uDataFormat != m_frameFormat)
+    {
+        m_frameKernel = PxLSelectFrameKernel (filter, uDataFormat);
+        m_frameFilter = filter;
+        m_frameFormat = uDataFormat;
+    }
+    return m_frameKernel;
+}
+
+#endif // !defined(PIXELINK_FILTER_KERNELS_H)
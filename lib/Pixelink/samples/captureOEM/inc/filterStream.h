@@ -0,0 +1,69 @@
+
+/***************************************************************************
+ *
+ *     File: filterStream.h
+ *
+ *     Description:
+ *       Per-stream state used by the preview filters (callbacks.cpp) in CaptureOEM.
+ *       A pointer to one of these is passed to the filter callbacks as their context.
+ *
+ *       All of the members are owned by the stream (callback) thread; the only
+ *       things that may be accessed from other threads, are the ones that say so.
+ *
+ */
+
+#if !defined(PIXELINK_FILTER_STREAM_H)
+#define PIXELINK_FILTER_STREAM_H
+
+#include "PixeLINKApi.h"
+#include "scratchArena.h"
+#include "temporal.h"
+#include "filterKernels.h"
+#include "edges.h"
+
+struct SDL_Surface;
+
+class PxLFilterStream
+{
+public:
+    // Constructor
+    PxLFilterStream ();
+
+    // Called by each filter at the start of a frame.  Returns the arena from which the filter should
+    // draw all of its temporary buffers.
+    PxLScratchArena& beginFrame ();
+
+    // Temporary buffers for the filters.  Reset on each frame.
+    PxLScratchArena  m_arena;
+
+    // The kernels chosen for the current filter and pixel format (see filterKernels.h).
+    PxLKernelCache   m_kernels;
+
+    // The frame history (and motion results) used by the temporal threshold and motion detector filters.
+    // See temporal.h for those members that can be used from other threads.
+    PxLTemporalState m_temporalState;
+    PxLTemporalState m_motionState;
+
+    // The options, and published results, of the Sobel (edge) filter.  See edges.h for those members
+    // that can be used from other threads.
+    PxLEdgeState     m_edgeState;
+
+    // The bitmap to be used by the bitmap overlay filter.  NULL if not valid.  Set (from the GUI thread)
+    // only while the bitmap overlay filter is not in use.
+    SDL_Surface*     m_bitmapOverlay;
+};
+
+inline PxLFilterStream::PxLFilterStream ()
+: m_temporalState (PxLTemporalState::DEFAULT_NOISE_FLOOR)
+, m_motionState (PxLTemporalState::DEFAULT_MOTION_THRESHOLD)
+, m_bitmapOverlay (NULL)
+{
+}
+
+inline PxLScratchArena& PxLFilterStream::beginFrame ()
+{
+    m_arena.reset();
+    return m_arena;
+}
+
+#endif // !defined(PIXELINK_FILTER_STREAM_H)
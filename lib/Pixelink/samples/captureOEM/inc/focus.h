@@ -0,0 +1,182 @@
+
+/***************************************************************************
+ *
+ *     File: focus.h
+ *
+ *     Description:
+ *       Host side focus metrics, and an autofocus search built on them, for
+ *       the 'Lens' tab in CaptureOEM.
+ *
+ *       The metrics are computed from the frames themselves, over a region of
+ *       the frame (normally the sharpness score ROI), so they work with cameras
+ *       that do not report a sharpness score, or do not have a one time focus:
+ *          - Tenengrad:  the mean squared Sobel gradient magnitude
+ *          - The variance of the Laplacian
+ *          - Brenner:  the mean squared difference of pixels 2 apart (horizontally)
+ *       All three are computed together, in a single pass over the region, using
+ *       SSE4.1, AVX2 or NEON when available.
+ *
+ *       The autofocus search drives FEATURE_FOCUS through a coarse sweep of the
+ *       focus range (cut short once the score has clearly passed its peak),
+ *       then refines the best of those by fitting a parabola through it and its
+ *       neighbours, measuring only at the vertex.  So, the best focus is
+ *       usually found after measuring 7 to 14 focus positions (each of which
+ *       costs a frame, plus those discarded while the lens settles).
+ *
+ *       The metrics are in focus.cpp, and the search in autofocus.cpp, so that
+ *       the metrics can be tested without a camera (see filterBench/focusTest).
+ *
+ */
+
+#if !defined(PIXELINK_FOCUS_H)
+#define PIXELINK_FOCUS_H
+
+#include <vector>
+#include "PixeLINKApi.h"
+#include "roi.h"
+
+class PxLCamera;
+
+typedef enum _PXL_FOCUS_METRIC
+{
+    FOCUS_TENENGRAD = 0,
+    FOCUS_LAPLACIAN_VARIANCE,
+    FOCUS_BRENNER,
+    FOCUS_METRIC_COUNT
+} PXL_FOCUS_METRIC;
+
+const char* PxLFocusMetricName (PXL_FOCUS_METRIC metric);
+// Returns FOCUS_METRIC_COUNT if the name is not one of the metrics
+PXL_FOCUS_METRIC PxLFocusMetricFromName (const char* name);
+
+// The metrics for one region of one frame.  Each is normalized by the number of pixels, so that they
+// can be compared across different sized regions (but not across pixel formats of different depths).
+class PxLFocusScores
+{
+public:
+    PxLFocusScores ();
+
+    double score (PXL_FOCUS_METRIC metric) const;
+
+    double m_tenengrad;
+    double m_laplacianVariance;
+    double m_brenner;
+    U32    m_pixels;   // Number of pixels the metrics were computed over
+};
+
+class PxLFocusMetric
+{
+public:
+    // Constructor
+    PxLFocusMetric ();
+
+    // Computes the metrics over region (in frame pixels) of a frame that is width x height pixels.  A
+    // region that is empty is the whole frame; otherwise, it is clipped to the frame.  Samples are 8 bits
+    // (the MS bits of the deeper formats, and the luminance of color formats).  Returns
+    // ApiInvalidParameterError for pixel formats that cannot be measured directly.
+    PXL_RETURN_CODE measure (const void* pFrame, U32 frameSize, U32 pixelFormat, int width, int height,
+                             const PXL_ROI& region, PxLFocusScores& scores);
+
+    static bool measurable (U32 pixelFormat);
+
+private:
+    std::vector<S16> m_samples; // three rows of samples
+};
+
+// The outcome of an autofocus search
+class PxLAutofocusResult
+{
+public:
+    PxLAutofocusResult ();
+
+    PXL_RETURN_CODE  m_rc;
+    PXL_FOCUS_METRIC m_metric;
+    float  m_focus;        // The focus value that was settled on
+    double m_score;        // Its score
+    U32    m_frames;       // Frames grabbed (including those discarded while the lens settled)
+    U32    m_sweepFrames;  // Of which, those grabbed during the coarse sweep
+    U32    m_moves;        // Times the focus was changed
+    double m_duration;     // Time (in seconds) to focus
+};
+
+class PxLAutofocus
+{
+public:
+    // Constructor
+    PxLAutofocus (PXL_FOCUS_METRIC metric = FOCUS_TENENGRAD);
+
+    void setMetric (PXL_FOCUS_METRIC metric);
+    // The region to be measured, in sensor pixels relative to the frame ROI.  Empty for the whole frame.
+    void setRegion (const PXL_ROI& region);
+    // Frames to discard after each focus change, to allow for the lens moving, and frames that
+    // were already exposed.
+    void setSettleFrames (U32 frames);
+
+    // Finds the best focus, and leaves the camera at it.  The stream is started, if need be, for the
+    // duration of the search.  Searches take many frames, so are best done off of the GUI thread.
+    PXL_RETURN_CODE search (PxLCamera* pCamera, PxLAutofocusResult& result);
+    // Abandons a search in progress (from another thread), leaving the focus where it was.  The search
+    // returns ApiInvalidFunctionCallError.  Searches that start later are also abandoned, until uncancel.
+    void cancel ();
+    void uncancel ();
+
+private:
+    class Sample
+    {
+    public:
+        Sample (float focus, double score) : m_focus(focus), m_score(score) {}
+        bool operator<(const Sample& rhs) const {return m_focus < rhs.m_focus;}
+        float  m_focus;
+        double m_score;
+    };
+
+    PXL_RETURN_CODE measureAt (PxLCamera* pCamera, float focus, float* pActual, double* pScore);
+    PXL_RETURN_CODE measureFrame (PxLCamera* pCamera, double* pScore);
+    bool            refinement (float tolerance, float* pNext);
+    void            addSample (float focus, double score);
+
+    PXL_FOCUS_METRIC m_metric;
+    PXL_ROI          m_region;
+    U32              m_settleFrames;
+    volatile bool    m_cancelled;
+
+    static const U32 COARSE_STEPS = 9;       // Points in the coarse sweep
+    static const U32 MAX_REFINEMENTS = 5;    // Parabolic fits, after the sweep
+    static const U32 FOCUS_RESOLUTION = 256; // Refine to within 1/FOCUS_RESOLUTION of the focus range
+
+    // Per search
+    std::vector<Sample> m_samples;  // Sorted by focus
+    PxLAutofocusResult  m_result;
+
+    // Reused from one frame (and search) to the next
+    PxLFocusMetric   m_focusMetric;
+    std::vector<U8>  m_frameBuf;
+    std::vector<U8>  m_rgbBuf;      // Frames that must be formatted by the API before they can be measured
+};
+
+inline void PxLAutofocus::setMetric (PXL_FOCUS_METRIC metric)
+{
+    m_metric = metric;
+}
+
+inline void PxLAutofocus::setRegion (const PXL_ROI& region)
+{
+    m_region = region;
+}
+
+inline void PxLAutofocus::setSettleFrames (U32 frames)
+{
+    m_settleFrames = frames;
+}
+
+inline void PxLAutofocus::cancel ()
+{
+    m_cancelled = true;
+}
+
+inline void PxLAutofocus::uncancel ()
+{
+    m_cancelled = false;
+}
+
+#endif // !defined(PIXELINK_FOCUS_H)
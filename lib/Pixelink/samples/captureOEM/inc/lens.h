@@ -16,6 +16,9 @@
 #include "roi.h"
 #include "slider.h"
 #include "tab.h"
+#include "thumbnail.h"
+#include "focus.h"
+#include "locks.h"
 
 #define ROI_AREA_WIDTH  384 // Must match the size in the Glade project
 #define ROI_AREA_HEIGHT 288 // Must match the size in the Glade project
@@ -51,6 +54,9 @@ public:
     void finishSsroiButtonOperation (GtkWidget *widget);
     void setSsroiButtonSize ();
 
+    void startAutofocus ();
+    void stopAutofocus ();  // Cancels, and waits for, a search in progress.  Do so before releasing the camera.
+
     //
     // All of the controls
 
@@ -73,6 +79,7 @@ public:
     GtkWidget    *m_zoomAssertMax;
 
     GdkPixbuf    *m_roiBuf;  //buffer used for roi image -- Either from the camera, or a default message
+    PxLThumbnail  m_roiThumbnail; // owns m_roiBuf, while it holds an image from the camera
     // SSROI button limits.  The values are pixels coordinates within the roi image
     // work area.  If the roi has the same aspect ration of ROI_AREA_WIDTH x ROI_AREA_HEIGHT,
     // then m_ssroiButtonLimits will be {0, ROI_AREA_WIDTH, 0, ROI_AREA_HEIGHT}.  Otherwise,
@@ -123,6 +130,17 @@ public:
 
     float m_focusLast;  // The focus value most recently read
     float m_ssLast;     // The sharpness score of the most recent callback
+
+    PxLAutofocus m_autofocus;     // Host side autofocus, for cameras that cannot do a one time focus themselves
+    bool         m_hostAutofocus; // Use m_autofocus even if they can (set PXL_HOST_AUTOFOCUS in the environment)
+
+    // The host side search runs on its own thread; its result is reported on the GUI thread.
+    PxLMutex           m_autofocusLock;    // Protects m_autofocusThread
+    GThread*           m_autofocusThread;  // NULL when there is no search in progress
+    PxLCamera*         m_autofocusCamera;
+    PxLAutofocusResult m_autofocusResult;
+    PXL_RETURN_CODE    m_autofocusRc;
+    volatile bool      m_autofocusFinished; // The thread has its result, and can be joined
 };
 
 inline GdkCursor* PxLLens::getCursorForOperation(ROI_BUTTON_OPS op)
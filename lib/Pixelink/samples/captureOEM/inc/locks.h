@@ -0,0 +1,150 @@
+
+/***************************************************************************
+ *
+ *     File: locks.h
+ *
+ *     Description:
+ *       The locks used to serialize access to the camera.  gCameraLock protects
+ *       gCamera itself (and the GUI state that goes with it); the camera object
+ *       then uses these finer grained locks:
+ *          - A reader/writer lock for the camera's features.  Any number of
+ *            threads may read features at once, but setting a feature excludes
+ *            everyone else.
+ *          - A (nestable) mutex for changes to the stream and preview state.
+ *
+ *       Each lock keeps track of how often it was acquired, how often a thread
+ *       had to wait for it, and how long it was waited on and held.
+ *
+ */
+
+#if !defined(PIXELINK_LOCKS_H)
+#define PIXELINK_LOCKS_H
+
+#include <pthread.h>
+#include "PixeLINKApi.h"
+
+class PxLLockStatistics
+{
+public:
+    PxLLockStatistics ();
+
+    void acquired (bool contended, double waited);
+    void released (double held);
+
+    U32    m_acquisitions;    // Number of times the lock was acquired
+    U32    m_contentions;     // Number of those times that the lock was held by someone else
+    double m_totalWait;       // Time (in seconds) spent waiting for the lock
+    double m_maxWait;
+    double m_totalHeld;       // Time (in seconds) the lock was held
+    double m_maxHeld;
+};
+
+//
+// A mutex that can be locked more than once by the same thread.  Only the outermost lock/unlock
+// are accounted for in the statistics.
+class PxLMutex
+{
+public:
+    PxLMutex ();
+    ~PxLMutex ();
+
+    void lock ();
+    void unlock ();
+
+    PxLLockStatistics statistics ();
+
+private:
+    // Copying a lock makes no sense
+    PxLMutex (const PxLMutex&);
+    PxLMutex& operator= (const PxLMutex&);
+
+    pthread_mutex_t   m_mutex;
+    pthread_mutex_t   m_statsMutex;
+    U32               m_depth;        // Only touched by the thread holding m_mutex
+    double            m_acquiredAt;
+    PxLLockStatistics m_stats;
+};
+
+//
+// A reader/writer lock.  Unlike PxLMutex, this lock can NOT be nested -- a thread holding
+// the lock (in either mode) must not try to acquire it again.
+class PxLRwLock
+{
+public:
+    PxLRwLock ();
+    ~PxLRwLock ();
+
+    // Both return the time the lock was acquired; pass it back to unlock
+    double readLock ();
+    double writeLock ();
+    void   unlock (bool writer, double acquiredAt);
+
+    PxLLockStatistics readStatistics ();
+    PxLLockStatistics writeStatistics ();
+
+private:
+    PxLRwLock (const PxLRwLock&);
+    PxLRwLock& operator= (const PxLRwLock&);
+
+    pthread_rwlock_t  m_lock;
+    pthread_mutex_t   m_statsMutex;
+    PxLLockStatistics m_readStats;
+    PxLLockStatistics m_writeStats;
+};
+
+// Returns a monotonic time, in seconds
+double PxLLockClock ();
+
+//
+// Declare one of these on the stack to hold a lock for the scope of a code block
+class PxLAutoMutex
+{
+public:
+    explicit PxLAutoMutex (PxLMutex *mutex)
+    : m_mutex(mutex)
+    {
+        m_mutex->lock();
+    }
+    ~PxLAutoMutex()
+    {
+        m_mutex->unlock();
+    }
+private:
+    PxLMutex *m_mutex;
+};
+
+class PxLAutoReadLock
+{
+public:
+    explicit PxLAutoReadLock (PxLRwLock *lock)
+    : m_lock(lock)
+    {
+        m_acquiredAt = m_lock->readLock();
+    }
+    ~PxLAutoReadLock()
+    {
+        m_lock->unlock (false, m_acquiredAt);
+    }
+private:
+    PxLRwLock *m_lock;
+    double     m_acquiredAt;
+};
+
+class PxLAutoWriteLock
+{
+public:
+    explicit PxLAutoWriteLock (PxLRwLock *lock)
+    : m_lock(lock)
+    {
+        m_acquiredAt = m_lock->writeLock();
+    }
+    ~PxLAutoWriteLock()
+    {
+        m_lock->unlock (true, m_acquiredAt);
+    }
+private:
+    PxLRwLock *m_lock;
+    double     m_acquiredAt;
+};
+
+#endif // !defined(PIXELINK_LOCKS_H)
@@ -13,6 +13,10 @@
 
 #include "PixeLINKApi.h"
 
+// Macro to calculate decimated width or height of the ROI.  The camera rounds up, so a frame with a pixel
+// addressing value that doesn't divide the ROI has a partial pixel at its end.
+#define DEC_SIZE(len,dec) (((len) + (dec) - 1) / (dec))
+
 typedef enum _COEM_PIXEL_ADDRESS_MODES
 {
    PA_DECIMATE,
@@ -92,7 +96,7 @@ public:
     {
         // There are 6 possible address values; 1, 2, 3, 4, 6, and 8
         int xOffset = (apiPixelAddressValueX == 8.0f ? 5 : (apiPixelAddressValueX == 6.0f ? 4 : (int)apiPixelAddressValueX-1));
-        int yOffset = (apiPixelAddressValueY == 8.0f ? 6 : (apiPixelAddressValueY == 6.0f ? 5 : (int)apiPixelAddressValueY-1));
+        int yOffset = (apiPixelAddressValueY == 8.0f ? 5 : (apiPixelAddressValueY == 6.0f ? 4 : (int)apiPixelAddressValueY-1));
         return (COEM_PIXEL_ADDRESS_VALUES)(xOffset*6 + yOffset);
     }
 
@@ -0,0 +1,207 @@
+
+/***************************************************************************
+ *
+ *     File: rawRecorder.h
+ *
+ *     Description:
+ *       Lossless recording of the camera's frames, exactly as they arrive
+ *       from the camera, for the 'Video' tab in CaptureOEM.
+ *
+ *       Unlike an H.264 clip, there is no encoding to fall behind, so this can
+ *       keep up with the camera at any ROI the disk can sustain.  A capture
+ *       thread grabs frames straight into a ring of block aligned records, and
+ *       a writer thread writes runs of records with a single large sequential
+ *       write (optionally with O_DIRECT, so the page cache is bypassed).  The
+ *       file is preallocated for the whole recording up front, so running out
+ *       of disk space is reported before the recording, rather than part way
+ *       through it.
+ *
+ *       The file layout (all values little endian):
+ *          - A PxLRawFileHeader, padded to RAW_BLOCK_SIZE
+ *          - One record per frame:  a PxLRawFrameHeader, then the frame, padded
+ *            to a multiple of RAW_BLOCK_SIZE.  All records are the same size.
+ *          - The frame index (a PxLRawIndexEntry per frame), then padding, then
+ *            a PxLRawTrailer that ends the file.
+ *       So, a reader can find any frame by reading the trailer (the last
+ *       bytes of the file), or simply from the record size in the header.
+ *
+ *       Optionally (skipStaticFrames), frames of a static scene are left out;
+ *       each is compared with the frames before it by a motion detector (see
+ *       temporal.h), and only those in which some block changed are stored.
+ *       The recording still ends after numFrames are stored, so it covers more
+ *       of the stream.  The frame numbers in the index tell which were kept.
+ *
+ */
+
+#if !defined(PIXELINK_RAW_RECORDER_H)
+#define PIXELINK_RAW_RECORDER_H
+
+#include <string>
+#include <vector>
+#include <pthread.h>
+#include <glib.h>
+#include "PixeLINKApi.h"
+#include "temporal.h"
+
+class PxLCamera;
+
+extern "C" typedef U32 (* ClipTerminationCallback)(HANDLE, U32, PXL_RETURN_CODE);
+
+#define RAW_BLOCK_SIZE      4096          // Records, and all writes, are a multiple of this
+#define RAW_FILE_MAGIC      "PXLRAW01"
+#define RAW_FRAME_MAGIC     0x4D415246    // 'FRAM'
+#define RAW_TRAILER_MAGIC   "PXLRAWIX"
+
+// The start of the file
+typedef struct _PxLRawFileHeader
+{
+    char   magic[8];           // RAW_FILE_MAGIC
+    U32    headerSize;         // Bytes before the first record
+    U32    recordSize;         // Bytes in each record
+    U32    frameHeaderSize;    // sizeof (PxLRawFrameHeader)
+    U32    frameSize;          // The largest frame a record can hold
+    U32    serialNumber;       // Of the camera
+    U32    pixelFormat;        // As at the start of the recording; each frame also has its own
+    U32    width;              // Of the frames, in pixels
+    U32    height;
+    float  frameRate;          // Camera frame rate at the start of the recording
+    U32    decimation;         // Every decimation'th frame was recorded
+    U64    frames;             // Frames recorded; 0 if the recording did not complete
+    U64    indexOffset;        // Of the frame index; 0 if the recording did not complete
+    U64    missingFrames;      // Frames the camera numbered, but never delivered to us
+} PxLRawFileHeader;
+
+// Precedes each frame
+typedef struct _PxLRawFrameHeader
+{
+    U32    magic;              // RAW_FRAME_MAGIC
+    U32    frameSize;          // Bytes of frame data that follow
+    U64    frameNumber;        // As numbered by the camera
+    double frameTime;          // Camera time stamp (in seconds)
+    double hostTime;           // When we got it (monotonic, in seconds from the start of the recording)
+    float  shutter;            // Exposure (in seconds)
+    float  gain;
+    U32    pixelFormat;
+    U16    width;
+    U16    height;
+    U32    hdrMode;
+    U32    reserved;
+} PxLRawFrameHeader;
+
+typedef struct _PxLRawIndexEntry
+{
+    U64    frameNumber;
+    U64    offset;             // Of the record in the file
+    double frameTime;
+} PxLRawIndexEntry;
+
+// The last bytes of the file
+typedef struct _PxLRawTrailer
+{
+    char   magic[8];           // RAW_TRAILER_MAGIC
+    U64    frames;             // Entries in the index
+    U64    indexOffset;
+    U64    missingFrames;
+} PxLRawTrailer;
+
+// A run of frames the camera numbered, but we did not get
+class PxLRawGap
+{
+public:
+    PxLRawGap (U64 first, U64 count) : m_firstMissing(first), m_count(count) {}
+    U64 m_firstMissing;
+    U64 m_count;
+};
+
+class PxLRawRecordStatistics
+{
+public:
+    PxLRawRecordStatistics ();
+
+    U32    m_frames;          // Frames written
+    U64    m_framesStreamed;  // Frames the camera sent (as numbered by the camera) over the recording
+    U64    m_missingFrames;   // Of those, frames we never saw
+    U32    m_staticFrames;    // Frames left out, as nothing in the scene changed
+    std::vector<PxLRawGap> m_gaps;  // The first MAX_GAPS runs of missing frames
+    U32    m_ringStalls;      // Times the capture thread had to wait for the writer
+    U32    m_writes;
+    U64    m_bytesWritten;
+    double m_maxWriteTime;    // Longest single write (in seconds)
+    double m_duration;        // Of the recording (in seconds)
+    bool   m_directIo;        // Whether O_DIRECT was actually used
+
+    static const U32 MAX_GAPS = 64;
+};
+
+class PxLRawRecorder
+{
+public:
+    // Constructor
+    PxLRawRecorder ();
+    // Destructor
+    ~PxLRawRecorder ();
+
+    // Records numFrames (of every decimation'th frame) from the camera's (running) stream, into fileName.
+    // termCallback is called, from the capture thread, once the recording is over.
+    PXL_RETURN_CODE begin (PxLCamera* pCamera, LPCSTR fileName, U32 numFrames, U32 decimation,
+                           bool directIo, ClipTerminationCallback termCallback);
+    // Leave out the frames in which the motion detector, with these options, sees no change.  Only frames of
+    // 8 bit samples can be compared; others are all stored.  Takes effect with the next begin.
+    void skipStaticFrames (bool skip, U8 motionThreshold = PxLTemporalState::DEFAULT_MOTION_THRESHOLD,
+                           int blockPercent = PxLTemporalState::DEFAULT_BLOCK_PERCENT);
+    // Cut the recording short; the frames recorded so far are kept.
+    void cancel ();
+    bool active ();
+    PxLRawRecordStatistics statistics ();   // Only valid once the termination callback has been made
+
+    // The bodies of the capture and writer threads
+    void captureFrames ();
+    void writeRecords ();
+
+private:
+    // Copying a recorder makes no sense
+    PxLRawRecorder (const PxLRawRecorder&);
+    PxLRawRecorder& operator= (const PxLRawRecorder&);
+
+    PXL_RETURN_CODE writeAt (const void* pData, size_t size, U64 offset);
+    PXL_RETURN_CODE finish ();
+    void            release ();
+
+    PxLCamera*   m_pCamera;
+    std::string  m_fileName;
+    U32          m_numFrames;
+    U32          m_decimation;
+    ClipTerminationCallback m_termCallback;
+    bool         m_skipStatic;
+    PxLTemporalState m_motion;       // Owned by the capture thread, while recording
+    int          m_fd;
+
+    U32          m_recordSize;
+    U32          m_frameSize;
+    PxLRawFileHeader* m_pHeader;     // A whole (aligned) block
+
+    // The ring of records.  The capture thread fills records at m_head; the writer writes them from m_tail.
+    U8*          m_ring;
+    U32          m_ringRecords;
+    U32          m_head;             // Total records filled
+    U32          m_tail;             // Total records written
+    pthread_mutex_t m_ringMutex;
+    pthread_cond_t  m_ringCond;
+    bool         m_captureDone;      // No more records will be filled
+    PXL_RETURN_CODE m_writeRc;
+
+    volatile bool m_cancelled;
+    volatile bool m_active;
+    GThread*     m_captureThread;
+    GThread*     m_writerThread;
+
+    std::vector<PxLRawIndexEntry> m_index;
+    PxLRawRecordStatistics m_stats;
+};
+
+inline bool PxLRawRecorder::active ()
+{
+    return m_active;
+}
+
+#endif // !defined(PIXELINK_RAW_RECORDER_H)
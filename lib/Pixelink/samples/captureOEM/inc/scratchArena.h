@@ -0,0 +1,90 @@
+
+/***************************************************************************
+ *
+ *     File: scratchArena.h
+ *
+ *     Description:
+ *       A simple 'bump' allocator for the temporary buffers used by the
+ *       preview filters in CaptureOEM.
+ *
+ *       The arena is reset at the start of each frame, and allocations are
+ *       simply carved out of a single block of memory, so a steady stream of
+ *       frames does not touch the heap at all.  If a frame needs more memory
+ *       than the arena has (the ROI or pixel format changed), the extra
+ *       requests are satisfied from the heap, and the arena grows to the new
+ *       requirement on the next reset.
+ *
+ */
+
+#if !defined(PIXELINK_SCRATCH_ARENA_H)
+#define PIXELINK_SCRATCH_ARENA_H
+
+#include <stddef.h>
+#include <vector>
+#include "PixeLINKApi.h"
+
+class PxLScratchArena
+{
+public:
+    static const size_t ALIGNMENT = 64; // Suitable for any of our SIMD kernels (and a cache line)
+
+    // Constructor
+    PxLScratchArena ();
+    // Destructor
+    ~PxLScratchArena ();
+
+    // Release all of the allocations made since the last reset.
+    void reset ();
+
+    // Returns (uninitialized) memory, aligned to ALIGNMENT, that remains valid until the next reset.
+    void* alloc (size_t bytes);
+
+    template<typename T>
+    T* allocArray (size_t count)
+    {
+        return static_cast<T*>(alloc (count * sizeof(T)));
+    }
+
+    // Statistics.  These may be read from any thread.
+    size_t capacity ();       // size of the arena
+    size_t peakUsage ();      // largest number of bytes required by any one frame
+    size_t lastUsage ();      // number of bytes required by the previous frame
+    U32    growCount ();      // number of times the arena had to grow
+
+private:
+    // Copying an arena makes no sense
+    PxLScratchArena (const PxLScratchArena&);
+    PxLScratchArena& operator= (const PxLScratchArena&);
+
+    U8*    m_base;
+    size_t m_capacity;
+    size_t m_used;            // Bytes required so far this frame (including overflow allocations)
+
+    std::vector<void*> m_overflow;  // Heap allocations made this frame, because the arena was too small
+
+    volatile size_t m_peakUsage;
+    volatile size_t m_lastUsage;
+    volatile U32    m_growCount;
+};
+
+inline size_t PxLScratchArena::capacity()
+{
+    return m_capacity;
+}
+
+inline size_t PxLScratchArena::peakUsage()
+{
+    return m_peakUsage;
+}
+
+inline size_t PxLScratchArena::lastUsage()
+{
+    return m_lastUsage;
+}
+
+inline U32 PxLScratchArena::growCount()
+{
+    return m_growCount;
+}
+
+#endif // !defined(PIXELINK_SCRATCH_ARENA_H)
@@ -0,0 +1,111 @@
+
+/***************************************************************************
+ *
+ *     File: settingsTransaction.h
+ *
+ *     Description:
+ *       A set of feature changes that are made together.  Setting ROI, pixel
+ *       format and pixel addressing one at a time stops and restarts the stream
+ *       for each of them; a transaction collects the changes, checks them
+ *       against the feature limits before touching the camera, orders them so
+ *       that each is valid given the ones before it, and then applies them all
+ *       with at most one interruption of the stream.  Features whose limits
+ *       depend on the others (FEATURE_FLAG_VOLATILE) can't be checked until the
+ *       changes before them are made, so the camera is left to judge those.
+ *
+ *       If any of the changes cannot be made, those that were made are undone.
+ *       Once committed, rollback restores all of the features to the values they
+ *       had before the commit (again, with at most one stream interruption).
+ *
+ *       Set PXL_TRANSACTION_STATS in the environment to have each commit report
+ *       how long it took.  If it is set to 'individual', the changes are instead
+ *       made one at a time, the way they would be without a transaction, so that
+ *       the two can be compared.
+ *
+ */
+
+#if !defined(PIXELINK_SETTINGS_TRANSACTION_H)
+#define PIXELINK_SETTINGS_TRANSACTION_H
+
+#include <vector>
+#include "PixeLINKApi.h"
+#include "camera.h"
+
+class PxLSettingsChange
+{
+public:
+    PxLSettingsChange (ULONG feature, ULONG flags, ULONG numParams, const float* params);
+
+    ULONG              m_feature;
+    ULONG              m_flags;
+    std::vector<float> m_params;
+
+    // The feature as it was before the change was made
+    bool               m_applied;
+    ULONG              m_oldFlags;
+    std::vector<float> m_oldParams;
+};
+
+class PxLSettingsTransaction
+{
+public:
+    // Constructor
+    PxLSettingsTransaction (PxLCamera* pCamera);
+
+    // Collect the changes; nothing is sent to the camera until commit
+    void setValue (ULONG feature, float value);
+    void setPixelAddressValues (float mode, float valueX, float valueY);
+    PXL_RETURN_CODE setRoiValue (ROI_TYPE type, PXL_ROI &roi);
+    void setFeature (ULONG feature, ULONG flags, ULONG numParams, const float* params);
+    void remove (ULONG feature);
+
+    bool empty ();
+
+    PXL_RETURN_CODE commit ();
+    PXL_RETURN_CODE rollback ();  // Undo a successful commit
+
+    ULONG  failedFeature ();       // The feature that caused commit to fail
+    double duration ();            // Time (in seconds) the last commit (or rollback) took
+    ULONG  streamInterruptions (); // The number of times the last commit (or rollback) stopped the stream
+
+private:
+    PXL_RETURN_CODE validate ();
+    void            order ();
+    PXL_RETURN_CODE readOldValues ();
+    PXL_RETURN_CODE apply (bool restore);
+    PXL_RETURN_CODE applyIndividually (bool restore);
+    void            report (const char* operation, PXL_RETURN_CODE rc);
+
+    PxLCamera* m_pCamera;
+    std::vector<PxLSettingsChange> m_changes;
+
+    bool   m_committed;
+    ULONG  m_failedFeature;
+    double m_duration;
+    ULONG  m_streamInterruptions;
+
+    bool   m_reportStatistics;   // Set PXL_TRANSACTION_STATS in the environment
+    bool   m_individually;       // PXL_TRANSACTION_STATS=individual
+};
+
+inline bool PxLSettingsTransaction::empty ()
+{
+    return m_changes.empty();
+}
+
+inline ULONG PxLSettingsTransaction::failedFeature ()
+{
+    return m_failedFeature;
+}
+
+inline double PxLSettingsTransaction::duration ()
+{
+    return m_duration;
+}
+
+inline ULONG PxLSettingsTransaction::streamInterruptions ()
+{
+    return m_streamInterruptions;
+}
+
+#endif // !defined(PIXELINK_SETTINGS_TRANSACTION_H)
@@ -17,6 +17,7 @@
 #include "roi.h"
 #include "pixelFormat.h"
 #include "pixelAddress.h"
+#include "thumbnail.h"
 
 #define FFOV_AREA_WIDTH  512 // Must match the size in the Glade project
 #define FFOV_AREA_HEIGHT 384 // Must match the size in the Glade project
@@ -53,6 +54,7 @@ public:
     void playChange (bool playing);  // indication that the app has transitioned to/from playing state
 
     void loadFfovImage (bool streamInterrupted = false);
+    bool thumbnailPixelAddressing (int width, int height, float* mode, float* value);
     void updateRoiButton ();
     void startRoiButtonOperation (GtkWidget *widget, double relativeX, double relativeY, double absoluteX, double absoluteY);
     GdkCursor* getCursorForOperation (ROI_BUTTON_OPS op);
@@ -79,6 +81,7 @@ public:
     GtkWidget    *m_flip;
 
     GdkPixbuf    *m_ffovBuf;  //buffer used for ffov image -- Either from the camera, or a default message
+    PxLThumbnail  m_ffovThumbnail; // owns m_ffovBuf, while it holds an image from the camera
     // ROI button limits.  The values are pixels coordinates within the ffov image
     // work area.  If the sensor has the same aspect ration of FFOV_AREA_WIDTH x FFOV_AREA_HEIGHT,
     // then m_roiButtonLimits will be {0, FFOV_AREA_WIDTH, 0, FFOV_AREA_HEIGHT}.  Otherwise,
@@ -0,0 +1,135 @@
+
+/***************************************************************************
+ *
+ *     File: temporal.h
+ *
+ *     Description:
+ *       Per-stream state used by the temporal filters (temporal threshold and
+ *       motion detector) in CaptureOEM.
+ *
+ *       Each stream owns its own PxLTemporalState, so the frame history is no
+ *       longer shared between cameras (or between filters).  The history buffer
+ *       is only re-seeded (not freed) when the frame geometry changes.
+ *
+ *       In addition to modifying the frame, the motion detector produces:
+ *          - A downsampled motion mask; one entry per block of pixels
+ *          - The bounding boxes of each connected region of changed blocks
+ *       These results can be read from any thread (see getMotion), so that the
+ *       capture pipeline can skip storing frames of a static scene; the raw
+ *       recorder does (see rawRecorder.h).
+ *
+ *       The noise floor, and the share of a block that must change, are set
+ *       from the 'Filter' tab.
+ *
+ */
+
+#if !defined(PIXELINK_TEMPORAL_H)
+#define PIXELINK_TEMPORAL_H
+
+#include <pthread.h>
+#include <vector>
+#include "PixeLINKApi.h"
+
+// Bounding box (in pixels, of the decimated image) of a connected region of changed blocks
+class PxLMotionBox
+{
+public:
+    PxLMotionBox () : m_x(0), m_y(0), m_width(0), m_height(0), m_numBlocks(0) {}
+
+    int m_x;
+    int m_y;
+    int m_width;
+    int m_height;
+    int m_numBlocks;  // Number of changed blocks within the region
+};
+
+// A snapshot of the results of the most recent motion detection.
+class PxLMotionResult
+{
+public:
+    PxLMotionResult () : m_frameNumber(0), m_blockSize(0), m_blocksX(0), m_blocksY(0),
+                         m_changedBlocks(0), m_sceneChanged(false), m_staticFrames(0) {}
+
+    U32  m_frameNumber;
+    int  m_blockSize;     // Width (and height) of each block, in pixels
+    int  m_blocksX;       // Dimensions of m_mask
+    int  m_blocksY;
+    // One entry per block; 0 means nothing changed, 255 means every sample in the block changed
+    std::vector<U8>           m_mask;
+    std::vector<PxLMotionBox> m_boxes;
+    int  m_changedBlocks;
+    bool m_sceneChanged;  // true if at least one block changed in this frame
+    U32  m_staticFrames;  // Number of consecutive frames (up to and including this one) without change
+};
+
+class PxLTemporalState
+{
+public:
+    static const U8  DEFAULT_NOISE_FLOOR = 5;      // temporal threshold filter
+    static const U8  DEFAULT_MOTION_THRESHOLD = 64; // motion detector
+    static const int DEFAULT_BLOCK_SIZE = 16;
+    static const int DEFAULT_BLOCK_PERCENT = 2;    // % of a block that must change for the block to be 'changed'
+
+    // Constructor
+    PxLTemporalState (U8 noiseFloor, int blockSize = DEFAULT_BLOCK_SIZE);
+    // Destructor
+    ~PxLTemporalState ();
+
+    // These may be called from any thread; they take effect on the next frame.
+    void requestReset ();
+    void setNoiseFloor (U8 noiseFloor);
+    void setBlockPercent (int percent);
+    U8   noiseFloor () const;
+    int  blockPercent () const;
+
+    // Called from the stream (callback) thread, once per frame.
+    //    temporalFilter - replaces samples that differ from the history by less than the noise
+    //                     floor, with the history value.
+    //    detectMotion   - replaces samples that differ from the history by more than the noise
+    //                     floor with 0xFF (all others with 0x00) if markFrame is true, and
+    //                     updates the motion results.
+    U32 temporalFilter (void* pFrameData, U32 pixelFormat, FRAME_DESC const * pFrameDesc);
+    U32 detectMotion (void* pFrameData, U32 pixelFormat, FRAME_DESC const * pFrameDesc, bool markFrame = true);
+
+    // Thread safe copy of the most recent motion results.
+    void getMotion (PxLMotionResult& result);
+    bool sceneChanged ();
+
+private:
+    bool prepare (void* pFrameData, U32 pixelFormat, FRAME_DESC const * pFrameDesc);
+    void findMotionBoxes ();
+
+    // Frame history; owned by the stream thread
+    std::vector<U8> m_lastFrame;
+    int   m_lastFrameSize;   // Bytes of m_lastFrame in use (it's capacity is not reduced)
+    U32   m_lastFormat;
+    int   m_width;
+    int   m_height;
+    int   m_bytesPerPixel;
+
+    volatile U8   m_noiseFloor;
+    volatile int  m_blockPercent;
+    volatile int  m_resetRequested;
+    const int     m_blockSize;
+
+    // Working storage for the motion detector; owned by the stream thread
+    std::vector<U32>  m_blockCounts;
+    std::vector<int>  m_labelStack;
+    std::vector<int>  m_labels;
+
+    // Results, protected by m_resultLock
+    pthread_mutex_t   m_resultLock;
+    PxLMotionResult   m_result;
+};
+
+inline U8 PxLTemporalState::noiseFloor () const
+{
+    return m_noiseFloor;
+}
+
+inline int PxLTemporalState::blockPercent () const
+{
+    return m_blockPercent;
+}
+
+#endif // !defined(PIXELINK_TEMPORAL_H)
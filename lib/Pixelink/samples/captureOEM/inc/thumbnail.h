@@ -0,0 +1,79 @@
+
+/***************************************************************************
+ *
+ *     File: thumbnail.h
+ *
+ *     Description:
+ *       Small (thumbnail) images of the camera's stream, as displayed in the
+ *       FFOV area of the Stream tab, and the ROI area of the AutoROI and Lens
+ *       tabs.
+ *
+ *       Rather than having the API convert the entire frame to RGB, only to
+ *       then scale it down to the (much smaller) display area, raw mono and
+ *       bayer frames are scaled and converted in a single pass.  Each thumbnail
+ *       pixel is the average of the frame pixels it covers, with the bayer
+ *       sites of each color averaged separately.  All of the buffers, including
+ *       the displayed pixbuf, are kept from one refresh to the next.
+ *
+ */
+
+#if !defined(PIXELINK_THUMBNAIL_H)
+#define PIXELINK_THUMBNAIL_H
+
+#include <vector>
+#include <gtk/gtk.h>
+#include "PixeLINKApi.h"
+#include "camera.h"
+
+class PxLThumbnail
+{
+public:
+    // Constructor
+    PxLThumbnail ();
+    // Destructor
+    ~PxLThumbnail ();
+
+    // Grabs the next frame from the camera, and scales it to width x height.  Returns NULL on failure.
+    // The returned pixbuf is owned by the thumbnail, and is reused by the next grab.
+    GdkPixbuf* grab (PxLCamera* pCamera, int width, int height);
+
+    // Scales a frame, of frameSize bytes, to width x height
+    PXL_RETURN_CODE scale (const void* pFrame, U32 frameSize, FRAME_DESC const * pFrameDesc, int width, int height);
+
+    GdkPixbuf* pixbuf ();
+
+    // Returns true if frames of this pixel format can be scaled without the API converting them first
+    static bool directlyScalable (U32 pixelFormat);
+
+private:
+    // Copying a thumbnail makes no sense
+    PxLThumbnail (const PxLThumbnail&);
+    PxLThumbnail& operator= (const PxLThumbnail&);
+
+    PXL_RETURN_CODE scaleRaw (const U8* pFrame, U32 frameSize, U32 pixelFormat, int frameWidth, int frameHeight);
+    PXL_RETURN_CODE scaleRgb (const void* pFrame, U32 frameSize, FRAME_DESC const * pFrameDesc, int frameWidth, int frameHeight);
+    void            setGeometry (int frameWidth, int frameHeight, bool bayer);
+
+    GdkPixbuf*       m_pixbuf;    // The thumbnail itself
+
+    std::vector<U8>  m_frameBuf;  // The most recent frame grabbed from the camera
+    std::vector<U8>  m_rgbBuf;    // Frames that are not directly scalable, converted to RGB by the API
+
+    // The frame pixels covered by each thumbnail column (m_xStart[i] <= x < m_xEnd[i]), and row.
+    int              m_frameWidth;
+    int              m_frameHeight;
+    bool             m_bayerGeometry;
+    std::vector<int> m_xStart;
+    std::vector<int> m_xEnd;
+    std::vector<int> m_yStart;
+    std::vector<int> m_yEnd;
+
+    std::vector<U32> m_sums;      // Per color sums, for one row of the thumbnail
+};
+
+inline GdkPixbuf* PxLThumbnail::pixbuf ()
+{
+    return m_pixbuf;
+}
+
+#endif // !defined(PIXELINK_THUMBNAIL_H)
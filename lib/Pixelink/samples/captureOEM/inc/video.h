@@ -14,8 +14,13 @@
 #include <stdio.h>
 #include <PixeLINKApi.h>
 #include "slider.h"
+#include "clipMuxer.h"
+#include "rawRecorder.h"
 #include "tab.h"
 
+// In addition to the API's clip formats (CLIP_FORMAT_AVI and CLIP_FORMAT_MP4), we can record the raw frames.
+#define VIDEO_FORMAT_RAW (CLIP_FORMAT_MP4+1)
+
 class PxLVideo : public PxLTab
 {
 public:
@@ -64,6 +69,21 @@ public:
     gchar* m_encodedFilename;
     gchar* m_videoFilename;
 
+    // The video file is muxed while the clip is being captured (unless PXL_CLIP_MUX=off), rather than
+    // formatted with the API once the capture is done.  With PXL_CLIP_MUX=fifo, the encoded file is a
+    // FIFO, so the elementary stream is never written to disk (unless it is to be kept).
+    PxLClipMuxer m_muxer;
+    bool         m_muxWhileCapturing;
+    bool         m_muxFromFifo;
+
+    // Lossless recordings (VIDEO_FORMAT_RAW) are not encoded at all; the frames are written as is.  They are
+    // written with O_DIRECT if PXL_RAW_DIRECT_IO is set.  If PXL_RAW_SKIP_STATIC is set, frames in which the
+    // motion detector (with the options on the 'Filter' tab) sees no change, are left out.
+    PxLRawRecorder m_rawRecorder;
+    bool           m_recordingRaw;    // The capture in progress is a raw recording
+    bool           m_rawDirectIo;
+    bool           m_rawSkipStatic;
+
     // If the decimation factor changes, we need to compute a new playback rate and playback time.  However,
     // we cannot compute both of these with just a new decimation value (and number of frames) -- we need to
     // also know how much decimation was applied to the old playback rate and time.  In other words,
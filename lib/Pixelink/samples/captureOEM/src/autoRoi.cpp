@@ -52,6 +52,11 @@ static PXL_RETURN_CODE GetCurrentWhitebalance();
 static void UpdateWhitebalanceControls();
 static const PxLFeaturePollFunctions whitebalanceFuncs (GetCurrentWhitebalance, UpdateWhitebalanceControls);
 
+// What the poll functions last read (they can't use the tab; see featurePoller.h)
+static PxLPolledValue<float> exposurePolled;
+static PxLPolledValue<float> gainPolled;
+static PxLPolledValue<float> redPolled, greenPolled, bluePolled;
+
 extern "C" void NewAutoroiSelected (GtkWidget* widget, GdkEventExpose* event, gpointer userdata);
 
 extern "C" bool AutoroiButtonPress  (GtkWidget* widget, GdkEventButton *event );
@@ -230,7 +235,6 @@ void PxLAutoRoi::loadRoiImage(bool streamInterrupted)
             gtk_image_set_from_pixbuf (GTK_IMAGE (m_roiImage), m_roiBuf);
         }
     } else {
-        PXL_RETURN_CODE rc;
 
         // Step 2.
         //      Figure out the aspect ration of the ROI and ROI image area
@@ -268,43 +272,24 @@ void PxLAutoRoi::loadRoiImage(bool streamInterrupted)
 
             //
             // Step 5
-            //      Grab and format the image
-            std::vector<U8> frameBuf (gCamera->imageSizeInBytes());
-            FRAME_DESC     frameDesc;
-
-            rc = gCamera->getNextFrame(frameBuf.size(), &frameBuf[0], &frameDesc);
-            if (API_SUCCESS(rc))
+            //      Grab the image, and scale it to the roi area.  Be sure to use the same aspect ratio as the roi.
+            //      The thumbnail keeps its buffers, so refreshing the image does not allocate any memory.
+            GdkPixbuf* roiImage = m_roiThumbnail.grab (gCamera,
+                                                       m_autoroiButtonLimits.xMax - m_autoroiButtonLimits.xMin,
+                                                       m_autoroiButtonLimits.yMax - m_autoroiButtonLimits.yMin);
+            if (roiImage)
             {
-                // Allocate an rgb Buffer.
-                std::vector<U8> rgbBuffer (frameBuf.size()*3);
-                rc = gCamera->formatRgbImage(&frameBuf[0], &frameDesc, rgbBuffer.size(), &rgbBuffer[0]);
-                if (API_SUCCESS(rc))
-                {
-                    //
-                    // Step 6
-                    //      Convert the rgb image into a roi buffer.  Be sure to use the same aspect ratio as the roi
-
-
-                    GdkPixbuf  *tempPixBuf = gdk_pixbuf_new_from_data (
-                            &rgbBuffer[0], GDK_COLORSPACE_RGB, false, 8,
-                            (int)(frameDesc.Roi.fWidth / frameDesc.PixelAddressingValue.fHorizontal),
-                            (int)(frameDesc.Roi.fHeight / frameDesc.PixelAddressingValue.fVertical),
-                            (int)(frameDesc.Roi.fWidth / frameDesc.PixelAddressingValue.fHorizontal)*3, NULL, NULL);
-                    m_roiBuf = gdk_pixbuf_scale_simple (tempPixBuf,
-                            m_autoroiButtonLimits.xMax - m_autoroiButtonLimits.xMin,
-                            m_autoroiButtonLimits.yMax - m_autoroiButtonLimits.yMin,
-                            GDK_INTERP_BILINEAR);
-                    gtk_image_set_from_pixbuf (GTK_IMAGE (m_roiImage), m_roiBuf);
-                }
+                m_roiBuf = roiImage;
+                gtk_image_set_from_pixbuf (GTK_IMAGE (m_roiImage), m_roiBuf);
             }
 
             //
-            // Step 7
+            // Step 6
             //      Restore the stream as necessary
             if (streamInterrupted) gCamera->stopStream ();
         } else {
             //
-            // Step 8
+            // Step 7
             //      We can't grab an image.  Display the No Stream FFOV image (if we're not
             //      already displaying it
             if (m_roiBuf == NULL)
@@ -884,8 +869,7 @@ static PXL_RETURN_CODE GetCurrentExposure()
 {
     PXL_RETURN_CODE rc = ApiSuccess;
 
-    PxLAutoLock lock(&gCameraLock);
-    if (gCamera && gAutoRoiTab)
+    if (gCamera)
     {
         // It's safe to assume the camera supports exposure, as this function will not be called
         // otherwise.  If we were to check via pCamera->supported (FEATURE_EXPOSURE) or
@@ -893,7 +877,11 @@ static PXL_RETURN_CODE GetCurrentExposure()
         // which is a lot of work for not.
         float exposureinSeconds = 0.0;
         rc = gCamera->getValue(FEATURE_EXPOSURE, &exposureinSeconds);
-        if (API_SUCCESS(rc)) gAutoRoiTab->m_exposureLast = exposureinSeconds * 1000.0f;
+        if (API_SUCCESS(rc))
+        {
+            float exposure = exposureinSeconds * 1000.0f;
+            rc = exposurePolled.store (exposure) ? ApiSuccessParametersChanged : ApiSuccess;
+        }
     }
 
     return rc;
@@ -909,6 +897,7 @@ static void UpdateExposureControls()
     {
         PxLAutoLock lock(&gCameraLock);
 
+        gAutoRoiTab->m_exposureLast = exposurePolled.load();
         sprintf (cValue, "%5.2f",gAutoRoiTab->m_exposureLast);
         gtk_entry_set_text (GTK_ENTRY (gAutoRoiTab->m_exposure), cValue);
 
@@ -936,8 +925,7 @@ static PXL_RETURN_CODE GetCurrentGain()
 {
     PXL_RETURN_CODE rc = ApiSuccess;
 
-    PxLAutoLock lock(&gCameraLock);
-    if (gCamera && gAutoRoiTab)
+    if (gCamera)
     {
         // It's safe to assume the camera supports gain, as this function will not be called
         // otherwise.  If we were to check via pCamera->supported (FEATURE_GAIN) or
@@ -945,7 +933,10 @@ static PXL_RETURN_CODE GetCurrentGain()
         // which is a lot of work for not.
         float gain = 0.0;
         rc = gCamera->getValue(FEATURE_GAIN, &gain);
-        if (API_SUCCESS(rc)) gAutoRoiTab->m_gainLast = gain;
+        if (API_SUCCESS(rc))
+        {
+            rc = gainPolled.store (gain) ? ApiSuccessParametersChanged : ApiSuccess;
+        }
     }
 
     return rc;
@@ -961,6 +952,7 @@ static void UpdateGainControls()
     {
         PxLAutoLock lock(&gCameraLock);
 
+        gAutoRoiTab->m_gainLast = gainPolled.load();
         sprintf (cValue, "%5.2f",gAutoRoiTab->m_gainLast);
         gtk_entry_set_text (GTK_ENTRY (gAutoRoiTab->m_gain), cValue);
 
@@ -988,8 +980,7 @@ static PXL_RETURN_CODE GetCurrentWhitebalance()
 {
     PXL_RETURN_CODE rc = ApiSuccess;
 
-    PxLAutoLock lock(&gCameraLock);
-    if (gCamera && gAutoRoiTab)
+    if (gCamera)
     {
         // It's safe to assume the camera supports white balance, as this function will not be called
         // otherwise.  If we were to check via pCamera->supported (FEATURE_WHITE_BALANCE) or
@@ -1001,9 +992,10 @@ static PXL_RETURN_CODE GetCurrentWhitebalance()
         rc = gCamera->getWhiteBalanceValues(&currentRed, &currentGreen, &currentBlue);
         if (API_SUCCESS(rc))
         {
-            gAutoRoiTab->m_redLast = currentRed;
-            gAutoRoiTab->m_greenLast = currentGreen;
-            gAutoRoiTab->m_blueLast = currentBlue;
+            bool changed = redPolled.store (currentRed);
+            changed = greenPolled.store (currentGreen) || changed;
+            changed = bluePolled.store (currentBlue) || changed;
+            if (changed) rc = ApiSuccessParametersChanged;
         }
     }
 
@@ -1020,6 +1012,9 @@ static void UpdateWhitebalanceControls()
     {
         PxLAutoLock lock(&gCameraLock);
 
+        gAutoRoiTab->m_redLast = redPolled.load();
+        gAutoRoiTab->m_greenLast = greenPolled.load();
+        gAutoRoiTab->m_blueLast = bluePolled.load();
         sprintf (cValue, "%5.2f",gAutoRoiTab->m_redLast);
         gtk_entry_set_text (GTK_ENTRY (gAutoRoiTab->m_red), cValue);
         sprintf (cValue, "%5.2f",gAutoRoiTab->m_greenLast);
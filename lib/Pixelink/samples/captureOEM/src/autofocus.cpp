@@ -0,0 +1,289 @@
+/***************************************************************************
+ *
+ *     File: autofocus.cpp
+ *
+ *     Description:
+ *       The autofocus search, built on the host side focus metrics (see
+ *       focus.cpp), used by the 'Lens' tab in CaptureOEM.
+ */
+
+#include <math.h>
+#include <algorithm>
+#include "focus.h"
+#include "camera.h"
+#include "locks.h"
+#include "pixelAddress.h"
+
+using namespace std;
+
+// Once the sweep has passed the best score, and the score has fallen back this far towards the lowest
+// score seen, for 2 samples in a row, there is no point sweeping any further.
+#define SWEEP_DROP_RATIO 0.5
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Public
+ * ---------------------------------------------------------------------------
+ */
+
+PxLAutofocusResult::PxLAutofocusResult ()
+: m_rc(ApiSuccess)
+, m_metric(FOCUS_TENENGRAD)
+, m_focus(0.0f)
+, m_score(0.0)
+, m_frames(0)
+, m_sweepFrames(0)
+, m_moves(0)
+, m_duration(0.0)
+{
+}
+
+PxLAutofocus::PxLAutofocus (PXL_FOCUS_METRIC metric)
+: m_metric(metric)
+, m_settleFrames(1)
+, m_cancelled(false)
+{
+}
+
+PXL_RETURN_CODE PxLAutofocus::search (PxLCamera* pCamera, PxLAutofocusResult& result)
+{
+    if (NULL == pCamera) return ApiInvalidParameterError;
+
+    m_result = PxLAutofocusResult();
+    m_result.m_metric = m_metric;
+    m_samples.clear();
+    const double start = PxLLockClock();
+
+    //
+    // Step 1
+    //      Find the range we have to search, and where we are starting from (so that we can go back to it,
+    //      should we fail).
+    float minFocus, maxFocus, original;
+    PXL_RETURN_CODE rc = pCamera->getRange (FEATURE_FOCUS, &minFocus, &maxFocus);
+    if (API_SUCCESS (rc)) rc = pCamera->getValue (FEATURE_FOCUS, &original);
+    if (API_SUCCESS (rc) && maxFocus <= minFocus) rc = ApiInvalidParameterError;
+    U32 frameSize = pCamera->imageSizeInBytes();
+    if (API_SUCCESS (rc) && 0 == frameSize) rc = ApiInvalidParameterError;
+
+    if (API_SUCCESS (rc))
+    {
+        if (m_frameBuf.size() < frameSize) m_frameBuf.resize (frameSize);
+
+        // We need frames for the duration of the search.
+        PxLInterruptStream streaming (pCamera, START_STREAM);
+
+        //
+        // Step 2
+        //      Coarse sweep, starting from whichever end of the range is closest to where we are now, so
+        //      that the first move is a short one.  Focus curves have a single peak, so once the score
+        //      has clearly fallen away from the best one, we can stop.
+        const bool fromMax = (maxFocus - original) < (original - minFocus);
+        const float step = (maxFocus - minFocus) / (float)(COARSE_STEPS - 1);
+        double bestScore = -1.0;
+        double lowestScore = -1.0;
+        U32 falling = 0;
+        float focus = original;
+        for (U32 i = 0; i < COARSE_STEPS && API_SUCCESS (rc); i++)
+        {
+            double score;
+            const float target = fromMax ? maxFocus - step * i : minFocus + step * i;
+            rc = measureAt (pCamera, target, &focus, &score);
+            if (!API_SUCCESS (rc)) break;
+
+            if (lowestScore < 0.0 || score < lowestScore) lowestScore = score;
+            if (score > bestScore)
+            {
+                bestScore = score;
+                falling = 0;
+            } else if (score - lowestScore < SWEEP_DROP_RATIO * (bestScore - lowestScore)) {
+                if (++falling >= 2) break;
+            } else {
+                falling = 0;
+            }
+        }
+        m_result.m_sweepFrames = m_result.m_frames;
+
+        //
+        // Step 3
+        //      Refine the best of the samples, measuring at the vertex of the parabola through it and its
+        //      neighbours, until the vertex is (within the tolerance) one of the samples we already have.
+        const float tolerance = (maxFocus - minFocus) / (float)FOCUS_RESOLUTION;
+        for (U32 i = 0; i < MAX_REFINEMENTS && API_SUCCESS (rc); i++)
+        {
+            float next;
+            if (! refinement (tolerance, &next)) break;
+            double score;
+            rc = measureAt (pCamera, next, &focus, &score);
+        }
+
+        //
+        // Step 4
+        //      Settle on the best focus found.  We don't need another frame for it; we already have its score.
+        if (API_SUCCESS (rc) && ! m_samples.empty())
+        {
+            vector<Sample>::const_iterator best = m_samples.begin();
+            for (vector<Sample>::const_iterator it = m_samples.begin(); it != m_samples.end(); it++)
+            {
+                if (it->m_score > best->m_score) best = it;
+            }
+            if (best->m_focus != focus)
+            {
+                rc = pCamera->setValue (FEATURE_FOCUS, best->m_focus);
+                m_result.m_moves++;
+            }
+            m_result.m_focus = best->m_focus;
+            m_result.m_score = best->m_score;
+        }
+
+        if (!API_SUCCESS (rc))
+        {
+            pCamera->setValue (FEATURE_FOCUS, original);
+            m_result.m_focus = original;
+        }
+    }
+
+    m_result.m_rc = rc;
+    m_result.m_duration = PxLLockClock() - start;
+    result = m_result;
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Private
+ * ---------------------------------------------------------------------------
+ */
+
+// Moves the focus to (close to) focus, and measures it.  pActual is the focus the camera actually used.
+PXL_RETURN_CODE PxLAutofocus::measureAt (PxLCamera* pCamera, float focus, float* pActual, double* pScore)
+{
+    if (m_cancelled) return ApiInvalidFunctionCallError;
+
+    PXL_RETURN_CODE rc = pCamera->setValue (FEATURE_FOCUS, focus);
+    if (!API_SUCCESS (rc)) return rc;
+    m_result.m_moves++;
+
+    // The camera may have rounded it
+    *pActual = focus;
+    pCamera->getValue (FEATURE_FOCUS, pActual);
+
+    // Let the lens settle; frames that were already on their way are of the old focus.
+    FRAME_DESC frameDesc;
+    for (U32 i = 0; i < m_settleFrames; i++)
+    {
+        rc = pCamera->getNextFrame (m_frameBuf.size(), &m_frameBuf[0], &frameDesc);
+        m_result.m_frames++;
+        if (!API_SUCCESS (rc)) return rc;
+    }
+
+    rc = measureFrame (pCamera, pScore);
+    if (API_SUCCESS (rc)) addSample (*pActual, *pScore);
+    return rc;
+}
+
+PXL_RETURN_CODE PxLAutofocus::measureFrame (PxLCamera* pCamera, double* pScore)
+{
+    FRAME_DESC frameDesc;
+    PXL_RETURN_CODE rc = pCamera->getNextFrame (m_frameBuf.size(), &m_frameBuf[0], &frameDesc);
+    m_result.m_frames++;
+    if (!API_SUCCESS (rc)) return rc;
+
+    //
+    // Step 1
+    //      Figure out the frame dimensions, and where the region is within the frame
+    int decX = max (1, (int)frameDesc.PixelAddressingValue.fHorizontal);
+    int decY = max (1, (int)frameDesc.PixelAddressingValue.fVertical);
+    int frameWidth = DEC_SIZE ((int)frameDesc.Roi.fWidth, decX);
+    int frameHeight = DEC_SIZE ((int)frameDesc.Roi.fHeight, decY);
+    PXL_ROI region (m_region.m_width / decX, m_region.m_height / decY,
+                    m_region.m_offsetX / decX, m_region.m_offsetY / decY);
+
+    //
+    // Step 2
+    //      Measure it; directly if we can, otherwise let the API convert it to RGB first.  Interleaved
+    //      HDR frames hold 2 images, which only the API knows how to combine.
+    PxLFocusScores scores;
+    U32 pixelFormat = (U32)frameDesc.PixelFormat.fValue;
+    if (PxLFocusMetric::measurable (pixelFormat) && frameDesc.HDRInfo.uMode != FEATURE_GAIN_HDR_MODE_INTERLEAVED)
+    {
+        rc = m_focusMetric.measure (&m_frameBuf[0], m_frameBuf.size(), pixelFormat, frameWidth, frameHeight, region, scores);
+    } else {
+        U32 rgbSize = (U32)frameWidth * frameHeight * 3;
+        if (m_rgbBuf.size() < rgbSize) m_rgbBuf.resize (rgbSize);
+        rc = pCamera->formatRgbImage (&m_frameBuf[0], &frameDesc, rgbSize, &m_rgbBuf[0]);
+        if (API_SUCCESS (rc))
+        {
+            rc = m_focusMetric.measure (&m_rgbBuf[0], rgbSize, PIXEL_FORMAT_RGB24_NON_DIB, frameWidth, frameHeight, region, scores);
+        }
+    }
+
+    if (API_SUCCESS (rc)) *pScore = scores.score (m_metric);
+    return rc;
+}
+
+// Decides where to measure next.  Returns false if there is no point measuring anywhere else.
+bool PxLAutofocus::refinement (float tolerance, float* pNext)
+{
+    const size_t numSamples = m_samples.size();
+    if (numSamples < 2) return false;
+
+    size_t b = 0;
+    for (size_t i = 1; i < numSamples; i++)
+    {
+        if (m_samples[i].m_score > m_samples[b].m_score) b = i;
+    }
+
+    // Should the fit not help, we close in on the best from the side of its better neighbour.
+    size_t n;
+    if (b == 0) {
+        n = 1;
+    } else if (b == numSamples-1) {
+        n = numSamples-2;
+    } else {
+        n = (m_samples[b-1].m_score > m_samples[b+1].m_score) ? b-1 : b+1;
+    }
+    float next = (m_samples[b].m_focus + m_samples[n].m_focus) / 2.0f;
+
+    if (b != 0 && b != numSamples-1)
+    {
+        const double xa = m_samples[b-1].m_focus, sa = m_samples[b-1].m_score;
+        const double xb = m_samples[b].m_focus,   sb = m_samples[b].m_score;
+        const double xc = m_samples[b+1].m_focus, sc = m_samples[b+1].m_score;
+
+        const double num = (xb - xa) * (xb - xa) * (sb - sc) - (xb - xc) * (xb - xc) * (sb - sa);
+        const double den = (xb - xa) * (sb - sc) - (xb - xc) * (sb - sa);
+        double vertex = (den != 0.0) ? xb - 0.5 * num / den : xa;
+        if (vertex <= xa || vertex >= xc)
+        {
+            // Degenerate (flat) fit; split the wider of the two intervals instead
+            vertex = (xb - xa > xc - xb) ? (xa + xb) / 2.0 : (xb + xc) / 2.0;
+        }
+        // A fit over a wide bracket can put the vertex right back on the best sample, even though the peak
+        // is a fair way off; if so, close in on it instead.
+        bool measured = false;
+        for (size_t i = 0; i < numSamples; i++)
+        {
+            if (fabsf (m_samples[i].m_focus - (float)vertex) < tolerance) measured = true;
+        }
+        if (! measured) next = (float)vertex;
+    }
+
+    // No point in measuring (nearly) the same focus twice
+    for (size_t i = 0; i < numSamples; i++)
+    {
+        if (fabsf (m_samples[i].m_focus - next) < tolerance) return false;
+    }
+
+    *pNext = next;
+    return true;
+}
+
+void PxLAutofocus::addSample (float focus, double score)
+{
+    Sample sample (focus, score);
+    vector<Sample>::iterator it = lower_bound (m_samples.begin(), m_samples.end(), sample);
+    if (it != m_samples.end() && it->m_focus == focus)
+    {
+        it->m_score = score;  // The camera rounded two requests to the same focus; keep the latest
+    } else {
+        m_samples.insert (it, sample);
+    }
+}
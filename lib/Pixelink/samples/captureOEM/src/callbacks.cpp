@@ -10,22 +10,61 @@
  */
 
 #include <string.h>
-#include <vector>
-#include <glib.h>
+#include <stdlib.h>
 #include <algorithm>
 #include <SDL2/SDL.h>
-#include "filter.h"
+#include "callbacks.h"
 #include "pixelFormat.h"
+#include "pixelAddress.h"
+#include "filterStream.h"
 
 using namespace std;
 
-
-// Macro to calculate decimated width or height of the ROI:
-#define DEC_SIZE(len,dec) (((len) + (dec) - 1) / (dec))
-
 #define DCAM16_TO_TENBIT(x) ((((x) & 0x00FF) << 2) | ((x) >> 14))
 #define TENBIT_TO_DCAM16(x) ((((x) & 0x03FC) >> 2) | ((x) << 14))
 
+// All filters draw their temporary buffers from the stream's scratch arena (see filterStream.h), so that
+// a steady stream of frames does not touch the heap.  Should a filter be used without a stream context,
+// it uses a short lived arena of it's own.
+#define FILTER_SCRATCH_ARENA(context)                                                          \
+    PxLScratchArena  _localArena;                                                              \
+    PxLScratchArena& arena = (context) ? static_cast<PxLFilterStream*>(context)->beginFrame()  \
+                                       : _localArena;                                          \
+
+// The 'per pixel' filters use kernels specialized for the pixel format and the CPU (see filterKernels.h).
+// The selection is cached in the stream, so it is only done when the filter or the format changes.
+static PxLPixelKernel FilterKernel (void* pContext, PXL_PIXEL_FILTER filter, U32 uDataFormat)
+{
+    return pContext ? static_cast<PxLFilterStream*>(pContext)->m_kernels.kernel (filter, uDataFormat)
+                    : PxLSelectPixelKernel (filter, uDataFormat, PxLHostIsa());
+}
+
+// Likewise the 'frame' filters, whose kernels are specialized for the pixel format (see PxLSelectFrameKernel, below)
+static PxLFrameKernel FilterKernel (void* pContext, PXL_FRAME_FILTER filter, U32 uDataFormat)
+{
+    return pContext ? static_cast<PxLFilterStream*>(pContext)->m_kernels.kernel (filter, uDataFormat)
+                    : PxLSelectFrameKernel (filter, uDataFormat);
+}
+
+// Runs one of the 'frame' filters over the whole (decimated) frame.
+static U32 FrameFilter (PXL_FRAME_FILTER filter, void* pFrameData, U32 uDataFormat, FRAME_DESC const * pFrameDesc,
+                        void* pContext, const void* pArg)
+{
+    // If this isn't one of the formats we support, we're out of here.
+    PxLFrameKernel kernel = FilterKernel (pContext, filter, uDataFormat);
+    if (! kernel) return ApiInvalidParameterError;
+
+    const int decX = max(1, static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal));
+    const int decY = max(1, static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical));
+    const int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
+    const int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
+
+    FILTER_SCRATCH_ARENA(pContext);
+    kernel (static_cast<U8*>(pFrameData), width, height, arena, pArg);
+
+    return ApiSuccess;
+}
+
 struct RGBPixel
 {
     U8 R,G,B;
@@ -96,7 +135,7 @@ inline void YUVtoBGR(T1 const* YUV, T2* BGR)
 }
 
 template<typename T>
-void Convolution_3x3(int const* kernel, T* pData, const int width, const int height)
+void Convolution_3x3(int const* kernel, T* pData, const int width, const int height, PxLScratchArena& arena)
 {
     int normalizer = 0;
     for (int i = 0; i < 9; i++)
@@ -111,17 +150,17 @@ void Convolution_3x3(int const* kernel, T* pData, const int width, const int hei
 
 
     // Make a buffer to hold the unaltered values of the previous row.
-    std::vector<T> rowBuffer(width);
+    T* rowBuffer = arena.allocArray<T>(width);
     T prevVal;
 
     // Copy row 0 into the rowBuffer.
-    memcpy(&rowBuffer[0], pData, width * sizeof(T));
+    memcpy(rowBuffer, pData, width * sizeof(T));
 
     for (int y = 1; y < height-1; y++)
     {
         // Copy the "about-to-be-altered" row into the rowBuffer
-        memcpy(&rowBuffer[0], pData + (y*width), width * sizeof(T));
-        T* prevRow = &rowBuffer[0];
+        memcpy(rowBuffer, pData + (y*width), width * sizeof(T));
+        T* prevRow = rowBuffer;
         T* thisRow = pData + (y * width);
         T* nextRow = pData + ((y+1) * width);
         prevVal = thisRow[0];
@@ -156,7 +195,7 @@ void Convolution_3x3(int const* kernel, T* pData, const int width, const int hei
 }
 
 void
-Convolution_3x3_12Bit_Packed(int const* kernel, U8* pData, const int width, const int height, bool msFirst)
+Convolution_3x3_12Bit_Packed(int const* kernel, U8* pData, const int width, const int height, bool msFirst, PxLScratchArena& arena)
 // see Design Notes above on special handling of 12 bit packed formats.
 {
     int normalizer = 0;
@@ -173,18 +212,18 @@ Convolution_3x3_12Bit_Packed(int const* kernel, U8* pData, const int width, cons
 
 
     // Make a buffer to hold the unaltered values of the previous row.
-    std::vector<U8> rowBuffer(widthPlusHalf);
+    U8*             rowBuffer = arena.allocArray<U8>(widthPlusHalf);
     U8              prevVal;
     int             skipByte = msFirst ? 2 : 1;  //Are we to skip every 3rd (msFirst) or 2nd (normal) byte?
 
     // Copy row 0 into the rowBuffer.
-    memcpy(&rowBuffer[0], pData, widthPlusHalf);
+    memcpy(rowBuffer, pData, widthPlusHalf);
 
     for (int y = 1; y < height-1; y++)
     {
         // Copy the "about-to-be-altered" row into the rowBuffer
-        memcpy(&rowBuffer[0], pData + (y*widthPlusHalf), widthPlusHalf);
-        U8* prevRow = &rowBuffer[0];
+        memcpy(rowBuffer, pData + (y*widthPlusHalf), widthPlusHalf);
+        U8* prevRow = rowBuffer;
         U8* thisRow = pData + (y * widthPlusHalf);
         U8* nextRow = pData + ((y+1) * widthPlusHalf);
         prevVal = thisRow[0];
@@ -225,7 +264,7 @@ Convolution_3x3_12Bit_Packed(int const* kernel, U8* pData, const int width, cons
 }
 
 void
-Convolution_3x3_10Bit_Packed(int const* kernel, U8* pData, const int width, const int height)
+Convolution_3x3_10Bit_Packed(int const* kernel, U8* pData, const int width, const int height, PxLScratchArena& arena)
 // see Design Notes above on special handling of 10 bit packed formats.
 {
     int normalizer = 0;
@@ -242,18 +281,18 @@ Convolution_3x3_10Bit_Packed(int const* kernel, U8* pData, const int width, cons
 
 
     // Make a buffer to hold the unaltered values of the previous row.
-    std::vector<U8> rowBuffer(widthPlusQuarter);
+    U8*             rowBuffer = arena.allocArray<U8>(widthPlusQuarter);
     U8              prevVal;
     int             div5;  //We to skip every 5th byte
 
     // Copy row 0 into the rowBuffer.
-    memcpy(&rowBuffer[0], pData, widthPlusQuarter);
+    memcpy(rowBuffer, pData, widthPlusQuarter);
 
     for (int y = 1; y < height-1; y++)
     {
         // Copy the "about-to-be-altered" row into the rowBuffer
-        memcpy(&rowBuffer[0], pData + (y*widthPlusQuarter), widthPlusQuarter);
-        U8* prevRow = &rowBuffer[0];
+        memcpy(rowBuffer, pData + (y*widthPlusQuarter), widthPlusQuarter);
+        U8* prevRow = rowBuffer;
         U8* thisRow = pData + (y * widthPlusQuarter);
         U8* nextRow = pData + ((y+1) * widthPlusQuarter);
         prevVal = thisRow[0];
@@ -308,7 +347,7 @@ Convolution_3x3_10Bit_Packed(int const* kernel, U8* pData, const int width, cons
 }
 
 void
-Convolution_3x3_RGB(int const * const kernel, U8* pData, const int width, const int height)
+Convolution_3x3_RGB(int const * const kernel, U8* pData, const int width, const int height, PxLScratchArena& arena)
 {
     int normalizer = 0;
     for (int i = 0; i < 9; i++)
@@ -325,7 +364,7 @@ Convolution_3x3_RGB(int const * const kernel, U8* pData, const int width, const
 
     // Make a buffer to hold the unaltered values of the previous row and the
     // current row.
-    U8* buffer = new U8[bytewidth * 2];
+    U8* buffer = arena.allocArray<U8>(bytewidth * 2);
 
     // Copy row 0 into the buffer.
     memcpy(buffer, pData, bytewidth * sizeof(U8));
@@ -369,27 +408,6 @@ const int lowpass_kernel_3x3[] =
     1,      2,      1
 };
 
-const int sobel_vertical_3x3[] =
-{
-    -1,     0,      1,
-    -2,     0,      2,
-    -1,     0,      1
-};
-
-const int sobel_horizontal_3x3[] =
-{
-    -1,     -2,     -1,
-    0,      0,      0,
-    1,      2,      1
-};
-
-#define PXLAPI_CALLBACK(funcname)                       \
-    U32 funcname( HANDLE hCamera,             \
-                  LPVOID pFrameData,          \
-                  U32 uDataFormat,            \
-                  FRAME_DESC const * pFrameDesc,      \
-                  LPVOID pContext)            \
-
 template<typename T>void MedianFilter_3x3_Impl(T* const pData, T const * const pCopy, const int width, const int height)
 {
     int buf[9];
@@ -509,370 +527,98 @@ MedianFilter_3x3_RGB_Impl(U8* const pData, U8 const * const pCopy, const int wid
     }
 }
 
-PXLAPI_CALLBACK(PxLCallbackMedian)
+// A copy of the frame (height rows of rowBytes), for those filters that need the unaltered pixels.
+static U8* CopyFrame(U8 const * pData, const int rowBytes, const int height, PxLScratchArena& arena)
 {
-    int decX = max(1, static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal));
-    int decY = max(1, static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical));
-    int decWidth = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
-    int decHeight = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
-    float pixelSize = PxLPixelFormat::bytesPerPixel(static_cast<int>(uDataFormat));
-    int bufferSize = static_cast<int> (static_cast<float>(decWidth) * static_cast<float>(decHeight) * pixelSize);
-
-    // Allocate enough memory to hold a copy of the frame.
-    std::vector<U8> buffer(bufferSize);
-    memcpy(&buffer[0], pFrameData, bufferSize);
+    const size_t bytes = static_cast<size_t>(rowBytes) * height;
+    U8* pCopy = arena.allocArray<U8>(bytes);
+    memcpy(pCopy, pData, bytes);
+    return pCopy;
+}
 
-    switch (uDataFormat)
-    {
-    case PIXEL_FORMAT_MONO8:
-    case PIXEL_FORMAT_BAYER8_BGGR:
-    case PIXEL_FORMAT_BAYER8_GBRG:
-    case PIXEL_FORMAT_BAYER8_GRBG:
-    case PIXEL_FORMAT_BAYER8_RGGB:
-        MedianFilter_3x3_Impl<U8>(static_cast<U8*>(pFrameData),
-                                  static_cast<U8*>(&buffer[0]),
-                                  decWidth,
-                                  decHeight);
-        break;
-
-    case PIXEL_FORMAT_MONO16:
-    case PIXEL_FORMAT_BAYER16_BGGR:
-    case PIXEL_FORMAT_BAYER16_GBRG:
-    case PIXEL_FORMAT_BAYER16_GRBG:
-    case PIXEL_FORMAT_BAYER16_RGGB:
-        MedianFilter_3x3_Impl<U16>(static_cast<U16*>(pFrameData),
-                                   reinterpret_cast<U16*>(&buffer[0]),
-                                   decWidth,
-                                   decHeight);
-        break;
-
-    case PIXEL_FORMAT_MONO12_PACKED:
-    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
-    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
-    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
-    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
-        MedianFilter_3x3_12Bit_Packed_Impl(static_cast<U8*>(pFrameData),
-                                   reinterpret_cast<U8*>(&buffer[0]),
-                                   decWidth,
-                                   decHeight,
-                                   FALSE);
-        break;
-
-    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
-        MedianFilter_3x3_12Bit_Packed_Impl(static_cast<U8*>(pFrameData),
-                                   reinterpret_cast<U8*>(&buffer[0]),
-                                   decWidth,
-                                   decHeight,
-                                   TRUE);
-        break;
-
-    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
-        MedianFilter_3x3_10Bit_Packed_Impl(static_cast<U8*>(pFrameData),
-                                   reinterpret_cast<U8*>(&buffer[0]),
-                                   decWidth,
-                                   decHeight);
-        break;
-
-    case PIXEL_FORMAT_RGB24:
-    case PIXEL_FORMAT_RGB24_NON_DIB:
-        MedianFilter_3x3_RGB_Impl(static_cast<U8*>(pFrameData),
-                                  static_cast<U8*>(&buffer[0]),
-                                  decWidth,
-                                  decHeight);
-        break;
-
-    default:
-        return ApiInvalidParameterError;
-    }
+template<typename T>
+static void MedianKernel(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
+{
+    U8* pCopy = CopyFrame(pData, width * sizeof(T), height, arena);
+    MedianFilter_3x3_Impl<T>(reinterpret_cast<T*>(pData), reinterpret_cast<T*>(pCopy), width, height);
+}
 
-    return ApiSuccess;
+template<bool MS_FIRST>
+static void MedianKernel_12Bit_Packed(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
+{
+    U8* pCopy = CopyFrame(pData, width + width/2, height, arena);
+    MedianFilter_3x3_12Bit_Packed_Impl(pData, pCopy, width, height, MS_FIRST);
 }
 
-PXLAPI_CALLBACK(PxLCallbackLowPass)
+static void MedianKernel_10Bit_Packed(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
 {
-    int decX = static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal);
-    int decY = static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical);
-    int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
-    int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
+    U8* pCopy = CopyFrame(pData, width + width/4, height, arena);
+    MedianFilter_3x3_10Bit_Packed_Impl(pData, pCopy, width, height);
+}
 
-    switch (uDataFormat)
-    {
-    case PIXEL_FORMAT_MONO8:
-    case PIXEL_FORMAT_BAYER8_BGGR:
-    case PIXEL_FORMAT_BAYER8_GBRG:
-    case PIXEL_FORMAT_BAYER8_GRBG:
-    case PIXEL_FORMAT_BAYER8_RGGB:
-        Convolution_3x3<U8>(&lowpass_kernel_3x3[0],
-                            static_cast<U8*>(pFrameData),
-                            width,
-                            height);
-        break;
-
-    case PIXEL_FORMAT_MONO16:
-    case PIXEL_FORMAT_BAYER16_BGGR:
-    case PIXEL_FORMAT_BAYER16_GBRG:
-    case PIXEL_FORMAT_BAYER16_GRBG:
-    case PIXEL_FORMAT_BAYER16_RGGB:
-        Convolution_3x3<U16>(&lowpass_kernel_3x3[0],
-                             static_cast<U16*>(pFrameData),
-                             width,
-                             height);
-        break;
-
-    case PIXEL_FORMAT_MONO12_PACKED:
-    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
-    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
-    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
-    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
-        Convolution_3x3_12Bit_Packed(&lowpass_kernel_3x3[0],
-                             static_cast<U8*>(pFrameData),
-                             width,
-                             height,
-                             FALSE);
-        break;
-
-    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
-        Convolution_3x3_12Bit_Packed(&lowpass_kernel_3x3[0],
-                             static_cast<U8*>(pFrameData),
-                             width,
-                             height,
-                             TRUE);
-        break;
-
-    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
-        Convolution_3x3_10Bit_Packed(&lowpass_kernel_3x3[0],
-                             static_cast<U8*>(pFrameData),
-                             width,
-                             height);
-        break;
-
-    case PIXEL_FORMAT_RGB24:
-    case PIXEL_FORMAT_RGB24_NON_DIB:
-        Convolution_3x3_RGB(&lowpass_kernel_3x3[0],
-                            static_cast<U8*>(pFrameData),
-                            width,
-                            height);
-        break;
-    default:
-        return ApiInvalidParameterError;
-    }
+static void MedianKernel_RGB(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
+{
+    U8* pCopy = CopyFrame(pData, width * 3, height, arena);
+    MedianFilter_3x3_RGB_Impl(pData, pCopy, width, height);
+}
 
-    return ApiSuccess;
+PXLAPI_CALLBACK(PxLCallbackMedian)
+{
+    return FrameFilter(FRAME_FILTER_MEDIAN, pFrameData, uDataFormat, pFrameDesc, pContext, NULL);
 }
 
-PXLAPI_CALLBACK(PxLCallbackHighPass)
+// The coefficients of the convolution filters
+template<PXL_FRAME_FILTER FILTER> struct ConvolutionKernel;
+template<> struct ConvolutionKernel<FRAME_FILTER_LOW_PASS>  { static int const * coefficients() { return &lowpass_kernel_3x3[0]; } };
+template<> struct ConvolutionKernel<FRAME_FILTER_HIGH_PASS> { static int const * coefficients() { return &highpass_kernel_3x3[0]; } };
+
+template<PXL_FRAME_FILTER FILTER, typename T>
+static void Convolution_3x3_Kernel(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
 {
-    int decX = static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal);
-    int decY = static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical);
-    int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
-    int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
+    Convolution_3x3<T>(ConvolutionKernel<FILTER>::coefficients(), reinterpret_cast<T*>(pData), width, height, arena);
+}
 
-    switch (uDataFormat)
-    {
-    case PIXEL_FORMAT_MONO8:
-    case PIXEL_FORMAT_BAYER8_BGGR:
-    case PIXEL_FORMAT_BAYER8_GBRG:
-    case PIXEL_FORMAT_BAYER8_GRBG:
-    case PIXEL_FORMAT_BAYER8_RGGB:
-        Convolution_3x3<U8>(&highpass_kernel_3x3[0],
-                            static_cast<U8*>(pFrameData),
-                            width,
-                            height);
-        break;
-
-    case PIXEL_FORMAT_MONO16:
-    case PIXEL_FORMAT_BAYER16_BGGR:
-    case PIXEL_FORMAT_BAYER16_GBRG:
-    case PIXEL_FORMAT_BAYER16_GRBG:
-    case PIXEL_FORMAT_BAYER16_RGGB:
-        Convolution_3x3<U16>(&highpass_kernel_3x3[0],
-                             static_cast<U16*>(pFrameData),
-                             width,
-                             height);
-        break;
-
-    case PIXEL_FORMAT_MONO12_PACKED:
-    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
-    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
-    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
-    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
-        Convolution_3x3_12Bit_Packed(&highpass_kernel_3x3[0],
-                             static_cast<U8*>(pFrameData),
-                             width,
-                             height,
-                             FALSE);
-        break;
-
-    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
-        Convolution_3x3_12Bit_Packed(&highpass_kernel_3x3[0],
-                             static_cast<U8*>(pFrameData),
-                             width,
-                             height,
-                             TRUE);
-        break;
-
-    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
-    case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
-        Convolution_3x3_10Bit_Packed(&highpass_kernel_3x3[0],
-                             static_cast<U8*>(pFrameData),
-                             width,
-                             height);
-        break;
-
-    case PIXEL_FORMAT_RGB24:
-    case PIXEL_FORMAT_RGB24_NON_DIB:
-        Convolution_3x3_RGB(&highpass_kernel_3x3[0],
-                            static_cast<U8*>(pFrameData),
-                            width,
-                            height);
-        break;
-    default:
-        return ApiInvalidParameterError;
-    }
+template<PXL_FRAME_FILTER FILTER, bool MS_FIRST>
+static void Convolution_3x3_12Bit_Packed_Kernel(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
+{
+    Convolution_3x3_12Bit_Packed(ConvolutionKernel<FILTER>::coefficients(), pData, width, height, MS_FIRST, arena);
+}
 
-    return ApiSuccess;
+template<PXL_FRAME_FILTER FILTER>
+static void Convolution_3x3_10Bit_Packed_Kernel(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
+{
+    Convolution_3x3_10Bit_Packed(ConvolutionKernel<FILTER>::coefficients(), pData, width, height, arena);
 }
 
-template<typename T>
-void
-SobelFilter_3x3_Impl(T* pData, T* pCopy, int width, int height)
+template<PXL_FRAME_FILTER FILTER>
+static void Convolution_3x3_RGB_Kernel(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
 {
-    Convolution_3x3<T>( &sobel_vertical_3x3[0],
-                        pData,
-                        width,
-                        height );
-    Convolution_3x3<T>( &sobel_horizontal_3x3[0],
-                        pCopy,
-                        width,
-                        height );
-    for (int i = 0; i < width*height; i++)
-    {
-        // Should really be: sqrt(sqr(pData[i])+sqr(pCopy[i])), but this is faster and close enough:
-        pData[i] = (pData[i] + pCopy[i]) / 2 ;
-    }
+    Convolution_3x3_RGB(ConvolutionKernel<FILTER>::coefficients(), pData, width, height, arena);
 }
 
-void
-SobelFilter_3x3_12Bit_Packed_Impl(U8* const pData, U8 * const pCopy, const int width, const int height)
+PXLAPI_CALLBACK(PxLCallbackLowPass)
 {
-    Convolution_3x3<U8>( &sobel_vertical_3x3[0],
-                        pData,
-                        width,
-                        height );
-    Convolution_3x3<U8>( &sobel_horizontal_3x3[0],
-                        pCopy,
-                        width,
-                        height );
-    int widthPlusHalf = width + width/2;
-    for (int i = 0; i < widthPlusHalf*height; i++)
-    {
-        // Should really be: sqrt(sqr(pData[i])+sqr(pCopy[i])), but this is faster and close enough:
-        pData[i] = (pData[i] + pCopy[i]) / 2 ;
-    }
+    return FrameFilter(FRAME_FILTER_LOW_PASS, pFrameData, uDataFormat, pFrameDesc, pContext, NULL);
 }
 
-void
-SobelFilter_3x3_RGB_Impl(U8* const pData, U8* const pCopy,const int width, const int height)
+PXLAPI_CALLBACK(PxLCallbackHighPass)
 {
-    Convolution_3x3_RGB(&sobel_vertical_3x3[0],
-                        pData,
-                        width,
-                        height );
-    Convolution_3x3_RGB(&sobel_horizontal_3x3[0],
-                        pCopy,
-                        width,
-                        height );
-    for (int i = 0; i < width*height*3; i++)
-    {
-        // Should really be: sqrt(sqr(pData[i])+sqr(pCopy[i])), but this is faster and close enough:
-        pData[i] = (pData[i] + pCopy[i]) / 2 ;
-    }
+    return FrameFilter(FRAME_FILTER_HIGH_PASS, pFrameData, uDataFormat, pFrameDesc, pContext, NULL);
 }
 
+//
+// The Sobel filter keeps its options (and results) in the stream's PxLFilterStream (pContext).  See edges.h
+//
 PXLAPI_CALLBACK(PxLCallbackSobel)
 {
-    int decX = static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal);
-    int decY = static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical);
-    int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
-    int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
-    float pixelSize = PxLPixelFormat::bytesPerPixel(static_cast<int>(uDataFormat));
-    int bufferSize = static_cast<int> (static_cast<float>(width)
-                                       * static_cast<float>(height)
-                                       * pixelSize);
-
-    std::vector<U8> buffer(bufferSize);
-    memcpy(&buffer[0], pFrameData, bufferSize);
-
-    switch (uDataFormat)
+    FILTER_SCRATCH_ARENA(pContext);
+    if (pContext)
     {
-    case PIXEL_FORMAT_MONO8:
-    case PIXEL_FORMAT_BAYER8_BGGR:
-    case PIXEL_FORMAT_BAYER8_GBRG:
-    case PIXEL_FORMAT_BAYER8_GRBG:
-    case PIXEL_FORMAT_BAYER8_RGGB:
-        SobelFilter_3x3_Impl<U8>(static_cast<U8*>(pFrameData),
-                                 static_cast<U8*>(&buffer[0]),
-                                 width,
-                                 height);
-        break;
-
-    case PIXEL_FORMAT_MONO16:
-    case PIXEL_FORMAT_BAYER16_BGGR:
-    case PIXEL_FORMAT_BAYER16_GBRG:
-    case PIXEL_FORMAT_BAYER16_GRBG:
-    case PIXEL_FORMAT_BAYER16_RGGB:
-        SobelFilter_3x3_Impl<U16>(static_cast<U16*>(pFrameData),
-                                  reinterpret_cast<U16*>(&buffer[0]),
-                                  width,
-                                  height);
-        break;
-
-    case PIXEL_FORMAT_MONO12_PACKED:
-    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
-    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
-    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
-    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
-        SobelFilter_3x3_12Bit_Packed_Impl(static_cast<U8*>(pFrameData),
-                                          reinterpret_cast<U8*>(&buffer[0]),
-                                          width,
-                                          height);
-        break;
-
-    case PIXEL_FORMAT_RGB24:
-    case PIXEL_FORMAT_RGB24_NON_DIB:
-        SobelFilter_3x3_RGB_Impl(static_cast<U8*>(pFrameData),
-                                 static_cast<U8*>(&buffer[0]),
-                                 width,
-                                 height);
-        break;
-    default:
-        return ApiInvalidParameterError;
+        return static_cast<PxLFilterStream*>(pContext)->m_edgeState.sobelFilter (pFrameData, uDataFormat, pFrameDesc, arena);
     }
 
-    return ApiSuccess;
+    PxLEdgeState edgeState;  // Use the default options
+    return edgeState.sobelFilter (pFrameData, uDataFormat, pFrameDesc, arena);
 }
 
 
@@ -1106,235 +852,138 @@ PXLAPI_CALLBACK(PxLCallbackTreshold50Percent)
     const int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
     const int numPixels = width * height;
 
-    if (uDataFormat == PIXEL_FORMAT_MONO8)
-    {
-        U8* pPixel = (U8*)pFrameData;
-        U8* pLastPixel = &pPixel[numPixels];
-        while(pPixel != pLastPixel)
-        {
-            U8 value = *pPixel;
-            value = (value < 128) ? 0 : 255;
-            *pPixel = value;
-            pPixel++;
-        }
-    }
-    else if (uDataFormat == PIXEL_FORMAT_RGB24 || uDataFormat == PIXEL_FORMAT_RGB24_NON_DIB )
-    {
-        RGBPixel* pPixel = (RGBPixel*)pFrameData;
-        RGBPixel* pLastPixel = &pPixel[numPixels];
-        while(pPixel != pLastPixel)
-        {
-            int total = pPixel->R + pPixel->G + pPixel->B;
-            int newValue = (total < 128*3) ? 0 : 255;
-            pPixel->R = newValue;
-            pPixel->G = newValue;
-            pPixel->B = newValue;
-            pPixel++;
-        }
-    }
-    else
-    {
-        return ApiInvalidParameterError;
-    }
+    // If this isn't one of the formats we support, we're out of here.
+    PxLPixelKernel kernel = FilterKernel (pContext, PIXEL_FILTER_THRESHOLD_50, uDataFormat);
+    if (! kernel) return ApiInvalidParameterError;
 
-    return 0;
+    kernel (static_cast<U8*>(pFrameData), numPixels);
 
+    return ApiSuccess;
 }
 
 
-PXLAPI_CALLBACK(PxLCallbackHistogramEqualization)
+// Turns a histogram (of numValues values, taken from nPixels pixels) into the map that equalizes it.
+static void EqualizationMap(int* map, const int numValues, const int nPixels)
 {
-    int decX = static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal);
-    int decY = static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical);
-    int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
-    int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
-    int nPixels = width * height;
-
-    if (uDataFormat == PIXEL_FORMAT_MONO8)
+    int i;
+    for (i = 1; i < numValues; i++)
     {
-        const int NUM_PIXEL_VALUES = 256;
-        U8* pData = static_cast<U8*>(pFrameData);
-        std::vector<int> map(NUM_PIXEL_VALUES, 0);
-        int i;
-        for (i = 0; i < nPixels; i++)
-        {
-            ++map[pData[i]];
-        }
-        for (i = 1; i < NUM_PIXEL_VALUES; i++)
-        {
-            map[i] += map[i-1];
-        }
-        for (i = 0; i < NUM_PIXEL_VALUES; i++)
-        {
-            map[i] = (NUM_PIXEL_VALUES-1) * map[i] / nPixels;
-        }
-
-        for (i = 0; i < nPixels; i++)
-        {
-            pData[i] = map[pData[i]];
-        }
+        map[i] += map[i-1];
     }
-    else if (uDataFormat == PIXEL_FORMAT_RGB24 || uDataFormat == PIXEL_FORMAT_RGB24_NON_DIB )
+    for (i = 0; i < numValues; i++)
     {
-        // Equalize the Y part of YUV data, then convert back to RGB.
-        // Remember that PIXEL_FORMAT_RGB24 really means that the data is
-        // in "BGR" format - that is, the first byte of each triplet is
-        // the blue, not the red.
-        const int NUM_COLOUR_VALUES = 256;
-        U8* pData = static_cast<U8*>(pFrameData);
-        std::vector<int> map(NUM_COLOUR_VALUES, 0);
-        int i;
-        U8 yuv[3] = {0,0,0};
-
-        for (i = 0; i < nPixels; i++)
-        {
-            if (uDataFormat == PIXEL_FORMAT_RGB24) {
-                BGRtoYUV(&pData[3*i], &yuv[0]);
-            } else {
-                RGBtoYUV(&pData[3*i], &yuv[0]);
-            }
-            map[yuv[0]]++;
-        }
-
-        for (i = 1; i < NUM_COLOUR_VALUES; i++)
-        {
-            map[i] += map[i-1];
-        }
-
-        for (i = 0; i < NUM_COLOUR_VALUES; i++)
-        {
-            map[i] = (NUM_COLOUR_VALUES-1) * map[i] / nPixels;
-        }
-
-        for (i = 0; i < nPixels; i++)
-        {
-            if (uDataFormat == PIXEL_FORMAT_RGB24) {
-                BGRtoYUV(&pData[3*i], &yuv[0]);
-                yuv[0] = map[yuv[0]];
-                YUVtoBGR(&yuv[0], &pData[3*i]);
-            } else {
-                RGBtoYUV(&pData[3*i], &yuv[0]);
-                yuv[0] = map[yuv[0]];
-                YUVtoRGB(&yuv[0], &pData[3*i]);
-            }
-        }
+        map[i] = (numValues-1) * map[i] / nPixels;
     }
-    else if (uDataFormat == PIXEL_FORMAT_MONO16)
-    {
-        // We work only with 10 bits.
-        // Pixels with more bits will be truncated.
-        const int NUM_PIXEL_VALUES = 1024;
-        U16* pData = static_cast<U16*>(pFrameData);
-        std::vector<int> map(NUM_PIXEL_VALUES, 0);
-        int i;
-        for (i = 0; i < nPixels; i++)
-        {
-            ++map[ DCAM16_TO_TENBIT(pData[i]) ];
-        }
-        for (i = 1; i < NUM_PIXEL_VALUES; i++)
-        {
-            map[i] += map[i-1];
-        }
+}
 
-        for (i = 0; i < NUM_PIXEL_VALUES; i++)
-        {
-            map[i] = (NUM_PIXEL_VALUES-1) * map[i] / nPixels;
-        }
-        for (i = 0; i < nPixels; i++)
-        {
-            pData[i] = TENBIT_TO_DCAM16( map[ DCAM16_TO_TENBIT(pData[i]) ] );
-        }
+static void HistogramEqualization_Mono8(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
+{
+    const int NUM_PIXEL_VALUES = 256;
+    const int nPixels = width * height;
+    int* map = arena.allocArray<int>(NUM_PIXEL_VALUES);
+    memset(map, 0, NUM_PIXEL_VALUES * sizeof(int));
+    int i;
+    for (i = 0; i < nPixels; i++)
+    {
+        ++map[pData[i]];
     }
-    else if (uDataFormat == PIXEL_FORMAT_MONO12_PACKED)
+    EqualizationMap(map, NUM_PIXEL_VALUES, nPixels);
+
+    for (i = 0; i < nPixels; i++)
     {
-        // as per Design Notes above -- we only use the MS 8 bits of data
-        const int NUM_PIXEL_VALUES = 256;
-        int nPixelsPlusHalf = nPixels + nPixels/2;
-        U8* pData = static_cast<U8*>(pFrameData);
-        std::vector<int> map(NUM_PIXEL_VALUES, 0);
-        int i;
-        for (i = 0; i < nPixelsPlusHalf; i++)
-        {
-            if (i % 3 == 1) continue;
-            ++map[pData[i]];
-        }
-        for (i = 1; i < NUM_PIXEL_VALUES; i++)
-        {
-            map[i] += map[i-1];
-        }
-        for (i = 0; i < NUM_PIXEL_VALUES; i++)
-        {
-            map[i] = (NUM_PIXEL_VALUES-1) * map[i] / nPixels;
-        }
+        pData[i] = map[pData[i]];
+    }
+}
 
-        for (i = 0; i < nPixelsPlusHalf; i++)
-        {
-            if (i % 3 == 1) continue;
-            pData[i] = map[pData[i]];
+template<bool BGR>
+static void HistogramEqualization_RGB(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
+{
+    // Equalize the Y part of YUV data, then convert back to RGB.
+    // Remember that PIXEL_FORMAT_RGB24 really means that the data is
+    // in "BGR" format - that is, the first byte of each triplet is
+    // the blue, not the red.
+    const int NUM_COLOUR_VALUES = 256;
+    const int nPixels = width * height;
+    int* map = arena.allocArray<int>(NUM_COLOUR_VALUES);
+    memset(map, 0, NUM_COLOUR_VALUES * sizeof(int));
+    int i;
+    U8 yuv[3] = {0,0,0};
+
+    for (i = 0; i < nPixels; i++)
+    {
+        if (BGR) {
+            BGRtoYUV(&pData[3*i], &yuv[0]);
+        } else {
+            RGBtoYUV(&pData[3*i], &yuv[0]);
         }
+        map[yuv[0]]++;
     }
-    else if (uDataFormat == PIXEL_FORMAT_MONO12_PACKED_MSFIRST)
+    EqualizationMap(map, NUM_COLOUR_VALUES, nPixels);
+
+    for (i = 0; i < nPixels; i++)
     {
-        // as per Design Notes above -- we only use the MS 8 bits of data
-        const int NUM_PIXEL_VALUES = 256;
-        int nPixelsPlusHalf = nPixels + nPixels/2;
-        U8* pData = static_cast<U8*>(pFrameData);
-        std::vector<int> map(NUM_PIXEL_VALUES, 0);
-        int i;
-        for (i = 0; i < nPixelsPlusHalf; i++)
-        {
-            if (i % 3 == 2) continue;
-            ++map[pData[i]];
-        }
-        for (i = 1; i < NUM_PIXEL_VALUES; i++)
-        {
-            map[i] += map[i-1];
-        }
-        for (i = 0; i < NUM_PIXEL_VALUES; i++)
-        {
-            map[i] = (NUM_PIXEL_VALUES-1) * map[i] / nPixels;
+        if (BGR) {
+            BGRtoYUV(&pData[3*i], &yuv[0]);
+            yuv[0] = map[yuv[0]];
+            YUVtoBGR(&yuv[0], &pData[3*i]);
+        } else {
+            RGBtoYUV(&pData[3*i], &yuv[0]);
+            yuv[0] = map[yuv[0]];
+            YUVtoRGB(&yuv[0], &pData[3*i]);
         }
+    }
+}
 
-        for (i = 0; i < nPixelsPlusHalf; i++)
-        {
-            if (i % 3 == 2) continue;
-            pData[i] = map[pData[i]];
-        }
+static void HistogramEqualization_Mono16(U8* pFrameData, const int width, const int height, PxLScratchArena& arena, const void*)
+{
+    // We work only with 10 bits.
+    // Pixels with more bits will be truncated.
+    const int NUM_PIXEL_VALUES = 1024;
+    const int nPixels = width * height;
+    U16* pData = reinterpret_cast<U16*>(pFrameData);
+    int* map = arena.allocArray<int>(NUM_PIXEL_VALUES);
+    memset(map, 0, NUM_PIXEL_VALUES * sizeof(int));
+    int i;
+    for (i = 0; i < nPixels; i++)
+    {
+        ++map[ DCAM16_TO_TENBIT(pData[i]) ];
     }
-    else if (uDataFormat == PIXEL_FORMAT_MONO10_PACKED_MSFIRST)
+    EqualizationMap(map, NUM_PIXEL_VALUES, nPixels);
+
+    for (i = 0; i < nPixels; i++)
     {
-        // as per Design Notes above -- we only use the MS 8 bits of data
-        const int NUM_PIXEL_VALUES = 256;
-        int nPixelsPlusQuarter = nPixels + nPixels/4;
-        U8* pData = static_cast<U8*>(pFrameData);
-        std::vector<int> map(NUM_PIXEL_VALUES, 0);
-        int i;
-        for (i = 0; i < nPixelsPlusQuarter; i++)
-        {
-            if (i % 5 == 4) continue;
-            ++map[pData[i]];
-        }
-        for (i = 1; i < NUM_PIXEL_VALUES; i++)
-        {
-            map[i] += map[i-1];
-        }
-        for (i = 0; i < NUM_PIXEL_VALUES; i++)
-        {
-            map[i] = (NUM_PIXEL_VALUES-1) * map[i] / nPixels;
-        }
+        pData[i] = TENBIT_TO_DCAM16( map[ DCAM16_TO_TENBIT(pData[i]) ] );
+    }
+}
 
-        for (i = 0; i < nPixelsPlusQuarter; i++)
-        {
-            if (i % 5 == 4) continue;
-            pData[i] = map[pData[i]];
-        }
+// The packed formats:  the byte at SKIP, in each group of PERIOD bytes, holds the LS bits of the others.
+template<int PERIOD, int SKIP>
+static void HistogramEqualization_Packed(U8* pData, const int width, const int height, PxLScratchArena& arena, const void*)
+{
+    // as per Design Notes above -- we only use the MS 8 bits of data
+    const int NUM_PIXEL_VALUES = 256;
+    const int nPixels = width * height;
+    const int nBytes = nPixels + nPixels/(PERIOD-1);
+    int* map = arena.allocArray<int>(NUM_PIXEL_VALUES);
+    memset(map, 0, NUM_PIXEL_VALUES * sizeof(int));
+    int i;
+    for (i = 0; i < nBytes; i++)
+    {
+        if (i % PERIOD == SKIP) continue;
+        ++map[pData[i]];
     }
-    else
+    EqualizationMap(map, NUM_PIXEL_VALUES, nPixels);
+
+    for (i = 0; i < nBytes; i++)
     {
-        return ApiInvalidParameterError;
+        if (i % PERIOD == SKIP) continue;
+        pData[i] = map[pData[i]];
     }
+}
 
-    return ApiSuccess;
+PXLAPI_CALLBACK(PxLCallbackHistogramEqualization)
+{
+    return FrameFilter(FRAME_FILTER_HISTOGRAM_EQUALIZATION, pFrameData, uDataFormat, pFrameDesc, pContext, NULL);
 }
 
 //
@@ -1350,50 +999,12 @@ PXLAPI_CALLBACK(PxLCallbackSaturatedAndBlack)
     const int numPixels = width * height;
 
     // If this isn't one of the formats we support, we're out of here.
-    switch(uDataFormat) {
-        case PIXEL_FORMAT_RGB24:
-        case PIXEL_FORMAT_RGB24_NON_DIB:
-        case PIXEL_FORMAT_MONO8:
-            break;
-        default:
-            return ApiInvalidParameterError;
-    }
+    PxLPixelKernel kernel = FilterKernel (pContext, PIXEL_FILTER_SATURATED_AND_BLACK, uDataFormat);
+    if (! kernel) return ApiInvalidParameterError;
 
-    unsigned int TOLERANCE = 5; // +- 5 from pure black or pure white.
-
-    if (PIXEL_FORMAT_RGB24 == uDataFormat || PIXEL_FORMAT_RGB24_NON_DIB == uDataFormat ) {
-        U8* pPixel = (U8*)pFrameData;
-        U8* pLastPixel = &pPixel[(numPixels-1)*3];
-        for(; pPixel <= pLastPixel; pPixel+=3) {
-            U32 total = pPixel[0] + pPixel[1] + pPixel[2];
-            if (total <= (3 * (0x00 + TOLERANCE))) {
-                // Make an all- or near-black pixel blue (cold)
-                pPixel[0] = PIXEL_FORMAT_RGB24 == uDataFormat ? 0xFF : 0x00; // B, or R
-                pPixel[1] = 0x00; // G
-                pPixel[2] = PIXEL_FORMAT_RGB24 == uDataFormat ? 0x00 : 0xFF; // R, or B
-            } else if (total >= (3 * (0xFF - TOLERANCE))) {
-                // Make an all- or near-white pixel red (hot)
-                pPixel[0] = PIXEL_FORMAT_RGB24 == uDataFormat ? 0x00 : 0xFF; // B, or R
-                pPixel[1] = 0x00; // G
-                pPixel[2] = PIXEL_FORMAT_RGB24 == uDataFormat ? 0xFF : 0x00; // R, or B
-            }
-        }
-    } else if (PIXEL_FORMAT_MONO8 == uDataFormat) {
-        U8* pPixel = (U8*)pFrameData;
-        U8* pLastPixel = &pPixel[numPixels-1];
-        for(; pPixel <= pLastPixel; pPixel++) {
-            const U8 pixelVal = *pPixel;
-            if (0x00 == pixelVal) {
-                *pPixel = 0xFF; // Make an all black pixel white
-            }
-            if (0xFF == pixelVal) {
-                *pPixel = 0x00; // Make an all white pixel black
-            }
-        }
-    }
+    kernel (static_cast<U8*>(pFrameData), numPixels);
 
     return ApiSuccess;
-
 }
 
 //
@@ -1409,34 +1020,12 @@ PXLAPI_CALLBACK(PxLCallbackNegative)
     const int numPixels = width * height;
 
     // If this isn't one of the formats we support, we're out of here.
-    switch(uDataFormat) {
-        case PIXEL_FORMAT_RGB24:
-        case PIXEL_FORMAT_RGB24_NON_DIB:
-        case PIXEL_FORMAT_MONO8:
-            break;
-        default:
-            return ApiInvalidParameterError;
-    }
+    PxLPixelKernel kernel = FilterKernel (pContext, PIXEL_FILTER_NEGATIVE, uDataFormat);
+    if (! kernel) return ApiInvalidParameterError;
 
-    if (PIXEL_FORMAT_RGB24 == uDataFormat || PIXEL_FORMAT_RGB24_NON_DIB == uDataFormat) {
-        U8* pPixel = (U8*)pFrameData;
-        U8* pLastPixel = &pPixel[(numPixels-1)*3];
-        for(; pPixel <= pLastPixel; pPixel+=3) {
-            pPixel[0] = 255 - pPixel[0];
-            pPixel[1] = 255 - pPixel[1];
-            pPixel[2] = 255 - pPixel[2];
-        }
-    } else if (PIXEL_FORMAT_MONO8 == uDataFormat) {
-        U8* pPixel = (U8*)pFrameData;
-        U8* pLastPixel = &pPixel[numPixels-1];
-        for(; pPixel <= pLastPixel; pPixel++) {
-            const U8 pixelVal = *pPixel;
-            *pPixel = 255 - pixelVal;
-        }
-    }
+    kernel (static_cast<U8*>(pFrameData), numPixels);
 
     return ApiSuccess;
-
 }
 
 
@@ -1452,180 +1041,56 @@ PXLAPI_CALLBACK(PxLCallbackGrayscale)
     const int numPixels = width * height;
 
     // If this isn't one of the formats we support, we're out of here.
-    switch(uDataFormat) {
-        case PIXEL_FORMAT_RGB24:
-        case PIXEL_FORMAT_RGB24_NON_DIB:
-        case PIXEL_FORMAT_MONO8:
-            break;
-        default:
-            return ApiInvalidParameterError;
-    }
+    PxLPixelKernel kernel = FilterKernel (pContext, PIXEL_FILTER_GRAYSCALE, uDataFormat);
+    if (! kernel) return ApiInvalidParameterError;
 
-    if (PIXEL_FORMAT_RGB24 == uDataFormat || PIXEL_FORMAT_RGB24_NON_DIB == uDataFormat) {
-        U8* pPixel = (U8*)pFrameData;
-        U8* pLastPixel = &pPixel[(numPixels-1)*3];
-        for(; pPixel <= pLastPixel; pPixel+=3) {
-            const float b = static_cast<float>(PIXEL_FORMAT_RGB24 == uDataFormat ? pPixel[0] : pPixel[0]);
-            const float g = static_cast<float>(pPixel[1]);
-            const float r = static_cast<float>(PIXEL_FORMAT_RGB24 == uDataFormat ? pPixel[2] : pPixel[2]);
-            const float Y =  (0.2989f * r) + (0.5870f * g) + (0.1140f * b);
-            const U8 y = static_cast<U8>(Y);
-            pPixel[0] = y;
-            pPixel[1] = y;
-            pPixel[2] = y;
-        }
-    }
+    kernel (static_cast<U8*>(pFrameData), numPixels);
 
     return ApiSuccess;
-
 }
 
 
 //
 // A very simple temporal filter that attempts to remove
 // a bit of noise from images by comparing the current image to
-// the previous image.
+// the previous image.  The previous image is kept in the stream's
+// PxLFilterStream (pContext).
 //
-static U32
-TemporalFilterImpl(void* pFrameData, const U32 pixelFormat, FRAME_DESC const * pFrameDesc, const U8 noiseThreshold)
+PXLAPI_CALLBACK(PxLCallbackTemporalTheshold)
 {
-    static std::vector<U8>  s_lastFrame;
-    const int decX = static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal);
-    const int decY = static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical);
-    const int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
-    const int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
-    const int numPixels = width * height;
-    const float pixelSize = PxLPixelFormat::bytesPerPixel(pixelFormat);
-    const int frameSize = static_cast<int>( static_cast<float>(numPixels) * pixelSize);
-
-    // Is this the first frame?
-    if ((int)s_lastFrame.size() != frameSize) {
-        s_lastFrame.clear();
-        s_lastFrame.resize(frameSize);
-        memcpy(&s_lastFrame[0], (U8*)pFrameData, frameSize);
-        return ApiSuccess;
-    }
-
-    // If this isn't one of the formats we support, we're out of here.
-    switch(pixelFormat) {
-        case PIXEL_FORMAT_RGB24:
-        case PIXEL_FORMAT_RGB24_NON_DIB:
-        case PIXEL_FORMAT_MONO8:
-            break;
-        default:
-            return ApiInvalidParameterError;
-    }
+    PxLFilterStream* pStream = (PxLFilterStream*)pContext;
+    if (! pStream) return ApiSuccess;  // Callback cancelled -- quietly return
 
-    // Go through the pixel values 1 by 1 looking for differences.
-    // If the difference is greater than our noise threshold, use the new value and store it in the last frame.
-    // If the difference is less than our noise threshold, use the old value.
-    U8* pNewPixel       = (U8*)pFrameData;
-    U8* pOldPixel       = &s_lastFrame[0];
-    U8* pLastOldPixel   = &s_lastFrame[s_lastFrame.size()-1];
-
-    for( ; pOldPixel <= pLastOldPixel ; pNewPixel++, pOldPixel++) {
-        U16 newPixel = (U16)*pNewPixel;
-        U16 oldPixel = (U16)*pOldPixel;
-        U16 delta = abs(newPixel - oldPixel);
-        if (delta < noiseThreshold) {
-            *pNewPixel = (U8)oldPixel;
-        } else {
-            *pOldPixel = (U8)newPixel;
-        }
-    }
-    return ApiSuccess;
+    return pStream->m_temporalState.temporalFilter(pFrameData, uDataFormat, pFrameDesc);
 }
 
 //
-// A very simple temporal filter that shows areas that are changing rapidly.
+// A very simple temporal filter that shows areas that are changing rapidly.  The
+// motion mask and bounding boxes are available from the stream's PxLFilterStream (pContext).
 //
 PXLAPI_CALLBACK(PxLCallbackMotionDetector)
 {
-    static std::vector<U8>  s_lastFrame;
-    const int decX = static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal);
-    const int decY = static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical);
-    const int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
-    const int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
-    const int numPixels = width * height;
-    const float pixelSize = PxLPixelFormat::bytesPerPixel(uDataFormat);
-    const int frameSize = static_cast<int>(static_cast<float>(numPixels) * pixelSize);
-
-    // Is this the first frame?
-    if ((int)s_lastFrame.size() != frameSize) {
-        s_lastFrame.clear();
-        s_lastFrame.resize(frameSize);
-        memcpy(&s_lastFrame[0], (U8*)pFrameData, frameSize);
-        return ApiSuccess;
-    }
+    PxLFilterStream* pStream = (PxLFilterStream*)pContext;
+    if (! pStream) return ApiSuccess;  // Callback cancelled -- quietly return
 
-    // If this isn't one of the formats we support, we're out of here.
-    switch(uDataFormat) {
-        case PIXEL_FORMAT_RGB24:
-        case PIXEL_FORMAT_RGB24_NON_DIB:
-        case PIXEL_FORMAT_MONO8:
-            break;
-        default:
-            return ApiInvalidParameterError;
-    }
-
-    // Go through the pixel values 1 by 1 looking for differences.
-    U8* pNewPixel       = (U8*)pFrameData;
-    U8* pOldPixel       = &s_lastFrame[0];
-    U8* pLastOldPixel   = &s_lastFrame[s_lastFrame.size()-1];
-
-    U32 numPixelsMoving =0;
-
-    for( ; pOldPixel <= pLastOldPixel ; pNewPixel++, pOldPixel++) {
-        U16 newPixel = (U16)*pNewPixel;
-        U16 oldPixel = (U16)*pOldPixel;
-        U16 delta = abs(newPixel - oldPixel);
-        if (delta > 64) {
-            *pOldPixel = (U8)newPixel;
-            *pNewPixel = (U8)0xFF;
-            numPixelsMoving++;
-        } else {
-            *pNewPixel = 0x00;
-        }
-    }
-
-    return ApiSuccess;
-}
-
-
-PXLAPI_CALLBACK(PxLCallbackTemporalTheshold)
-{
-    return TemporalFilterImpl(pFrameData, uDataFormat, pFrameDesc, 5);
+    return pStream->m_motionState.detectMotion(pFrameData, uDataFormat, pFrameDesc);
 }
 
 
 //
 // Merges an image with a bitmap file.
 //
-PXLAPI_CALLBACK(PxLCallbackBitmapOverlay)
+template<bool MONO>
+static void BitmapOverlay(U8* pData, int width, int height, PxLScratchArena&, const void* pArg)
 {
-    const int decX = static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal);
-    const int decY = static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical);
-    int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
-    int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
-
-    // If this isn't one of the formats we support, we're out of here.
-    switch(uDataFormat) {
-        case PIXEL_FORMAT_RGB24:
-        case PIXEL_FORMAT_RGB24_NON_DIB:
-        case PIXEL_FORMAT_MONO8:
-            break;
-        default:
-            return ApiInvalidParameterError;
-    }
-
-    SDL_Surface* pSurface = (SDL_Surface*)pContext;
-    if (! pSurface) return ApiSuccess;  // Callback cancelled -- quietly return
+    const SDL_Surface* pSurface = static_cast<const SDL_Surface*>(pArg);
+    if (! pSurface) return;  // Callback cancelled -- quietly return
 
     // pSrc is the bitmap overlay; pDest is the preview buffer
     U8* pSrc = (U8*)pSurface->pixels;
-    U8* pDest = (U8*)pFrameData;
+    U8* pDest = pData;
     int srcPitch = pSurface->pitch;
-    int destPitch = width * sizeof (RGBPixel);
+    int destPitch = width * (MONO ? 1 : sizeof (RGBPixel));
     RGBPixel* pSrcRow;
     RGBPixel* pDestRow;
 
@@ -1643,6 +1108,12 @@ PXLAPI_CALLBACK(PxLCallbackBitmapOverlay)
             // the bitmap
             if (pSrcRow[x].R != 255 || pSrcRow[x].G != 255 || pSrcRow[x].B != 255)
             {
+                if (MONO)
+                {
+                    // Mono images only have one byte per pixel, so use the bitmap pixel's (unweighted) intensity
+                    pDest[x] = static_cast<U8>((pSrcRow[x].R + pSrcRow[x].G + pSrcRow[x].B) / 3);
+                    continue;
+                }
                 // bitmaps are 'unusual', in that the color channels are represented in the order of
                 // B-G-R, not the normal R-G-B.  So, we can't simply copy the three bytes over as you might
                 // expect; we need to assign the individual color channels
@@ -1655,76 +1126,177 @@ PXLAPI_CALLBACK(PxLCallbackBitmapOverlay)
         pSrc += srcPitch;
         pDest += destPitch;
     }
+}
 
-    return ApiSuccess;
+PXLAPI_CALLBACK(PxLCallbackBitmapOverlay)
+{
+    PxLFilterStream* pStream = (PxLFilterStream*)pContext;
+    SDL_Surface* pSurface = pStream ? pStream->m_bitmapOverlay : NULL;
+
+    return FrameFilter(FRAME_FILTER_BITMAP_OVERLAY, pFrameData, uDataFormat, pFrameDesc, pContext, pSurface);
 }
 
 //
 // A very simple filter that draws a cross hair in the middle of the image.
 //
-PXLAPI_CALLBACK(PxLCallbackCrosshairOverlay)
+static void CrosshairOverlay_RGB(U8* pData, const int width, const int height, PxLScratchArena&, const void*)
 {
-    const int decX = static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal);
-    const int decY = static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical);
-    const int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
-    const int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
-
-    // If this isn't one of the formats we support, we're out of here.
-    switch(uDataFormat) {
-        case PIXEL_FORMAT_RGB24:
-        case PIXEL_FORMAT_RGB24_NON_DIB:
-        case PIXEL_FORMAT_MONO8:
-            break;
-        default:
-            return ApiInvalidParameterError;
-    }
-
     // The Cross hair will be red lines (3 pixels wide), and the 10% of the size of the image
     int lengthX = width / 10;
     int lengthY = height / 10;
-    if (PIXEL_FORMAT_RGB24 == uDataFormat || PIXEL_FORMAT_RGB24_NON_DIB == uDataFormat) {
-        // Vertical line
-        RGBPixel* pFirstPixel = (RGBPixel*)pFrameData;
-        RGBPixel* pPixel = &pFirstPixel[(height/2 - lengthY/2)*width + width/2 ];
-        for(int i = 0; i < lengthY; i++)
-        {
-            pPixel[width*i].R = 255; pPixel[width*i].G = 0; pPixel[width*i].B = 0;
-            pPixel[width*i - 1].R = 255; pPixel[width*i - 1].G = 0; pPixel[width*i - 1].B = 0;
-            pPixel[width*i + 1].R = 255; pPixel[width*i + 1].G = 0; pPixel[width*i + 1].B = 0;
-        }
-        // Horizontal line
-        pPixel = &pFirstPixel[((height/2 -1)*width) + width/2 - lengthX/2];
-        for(int i = 0; i < lengthX; i++)
-        {
-            pPixel[i].R = 255; pPixel[i].G = 0; pPixel[i].B = 0;
-            pPixel[width + i].R = 255; pPixel[width + i].G = 0; pPixel[width + i].B = 0;
-            pPixel[2*width + i].R = 255; pPixel[2*width + i].G = 0; pPixel[2*width + i].B = 0;
-        }
-    } else if (PIXEL_FORMAT_MONO8 == uDataFormat) {
-        U8* pFirstPixel = (U8*)pFrameData;
-        U8* pPixel = &pFirstPixel[(height/2 - lengthY/2)*width + width/2 ];
-        for(int i = 0; i < lengthY; i++)
-        {
-            pPixel[width*i] = 255;
-            pPixel[width*i - 1] = 255;;
-            pPixel[width*i + 1] = 255;
-        }
-        pPixel = &pFirstPixel[((height/2 -1)*width) + lengthX/2];
-        for(int i = 0; i < lengthX; i++)
-        {
-            pPixel[i] = 255;
-            pPixel[width + i] = 255;
-            pPixel[2*width + i] = 255;
-        }
-    }
 
-    return ApiSuccess;
+    // Vertical line
+    RGBPixel* pFirstPixel = (RGBPixel*)pData;
+    RGBPixel* pPixel = &pFirstPixel[(height/2 - lengthY/2)*width + width/2 ];
+    for(int i = 0; i < lengthY; i++)
+    {
+        pPixel[width*i].R = 255; pPixel[width*i].G = 0; pPixel[width*i].B = 0;
+        pPixel[width*i - 1].R = 255; pPixel[width*i - 1].G = 0; pPixel[width*i - 1].B = 0;
+        pPixel[width*i + 1].R = 255; pPixel[width*i + 1].G = 0; pPixel[width*i + 1].B = 0;
+    }
+    // Horizontal line
+    pPixel = &pFirstPixel[((height/2 -1)*width) + width/2 - lengthX/2];
+    for(int i = 0; i < lengthX; i++)
+    {
+        pPixel[i].R = 255; pPixel[i].G = 0; pPixel[i].B = 0;
+        pPixel[width + i].R = 255; pPixel[width + i].G = 0; pPixel[width + i].B = 0;
+        pPixel[2*width + i].R = 255; pPixel[2*width + i].G = 0; pPixel[2*width + i].B = 0;
+    }
 }
 
+static void CrosshairOverlay_Mono8(U8* pData, const int width, const int height, PxLScratchArena&, const void*)
+{
+    // The Cross hair will be white lines (3 pixels wide), and the 10% of the size of the image
+    int lengthX = width / 10;
+    int lengthY = height / 10;
 
+    U8* pFirstPixel = pData;
+    U8* pPixel = &pFirstPixel[(height/2 - lengthY/2)*width + width/2 ];
+    for(int i = 0; i < lengthY; i++)
+    {
+        pPixel[width*i] = 255;
+        pPixel[width*i - 1] = 255;;
+        pPixel[width*i + 1] = 255;
+    }
+    pPixel = &pFirstPixel[((height/2 -1)*width) + lengthX/2];
+    for(int i = 0; i < lengthX; i++)
+    {
+        pPixel[i] = 255;
+        pPixel[width + i] = 255;
+        pPixel[2*width + i] = 255;
+    }
+}
 
+PXLAPI_CALLBACK(PxLCallbackCrosshairOverlay)
+{
+    return FrameFilter(FRAME_FILTER_CROSSHAIR_OVERLAY, pFrameData, uDataFormat, pFrameDesc, pContext, NULL);
+}
 
+/* ---------------------------------------------------------------------------
+ * --   Kernel selection for the 'frame' filters
+ * ---------------------------------------------------------------------------
+ */
 
+// The pixel layouts of the formats supported by the frame filters.  Some of the filters only
+// support the mono formats, so those are kept separate from the bayer ones.
+typedef enum _PXL_FRAME_LAYOUT
+{
+    FRAME_LAYOUT_MONO8 = 0,
+    FRAME_LAYOUT_BAYER8,
+    FRAME_LAYOUT_MONO16,
+    FRAME_LAYOUT_BAYER16,
+    FRAME_LAYOUT_MONO12_PACKED,
+    FRAME_LAYOUT_BAYER12_PACKED,
+    FRAME_LAYOUT_MONO12_PACKED_MSFIRST,
+    FRAME_LAYOUT_BAYER12_PACKED_MSFIRST,
+    FRAME_LAYOUT_MONO10_PACKED_MSFIRST,
+    FRAME_LAYOUT_BAYER10_PACKED_MSFIRST,
+    FRAME_LAYOUT_BGR24,     // PIXEL_FORMAT_RGB24 (Windows DIB order)
+    FRAME_LAYOUT_RGB24,     // PIXEL_FORMAT_RGB24_NON_DIB
+    FRAME_LAYOUT_COUNT
+} PXL_FRAME_LAYOUT;
+
+static int FrameLayout (U32 uDataFormat)
+{
+    switch (uDataFormat)
+    {
+    case PIXEL_FORMAT_MONO8:                        return FRAME_LAYOUT_MONO8;
+    case PIXEL_FORMAT_BAYER8_BGGR:
+    case PIXEL_FORMAT_BAYER8_GBRG:
+    case PIXEL_FORMAT_BAYER8_GRBG:
+    case PIXEL_FORMAT_BAYER8_RGGB:                  return FRAME_LAYOUT_BAYER8;
+    case PIXEL_FORMAT_MONO16:                       return FRAME_LAYOUT_MONO16;
+    case PIXEL_FORMAT_BAYER16_BGGR:
+    case PIXEL_FORMAT_BAYER16_GBRG:
+    case PIXEL_FORMAT_BAYER16_GRBG:
+    case PIXEL_FORMAT_BAYER16_RGGB:                 return FRAME_LAYOUT_BAYER16;
+    case PIXEL_FORMAT_MONO12_PACKED:                return FRAME_LAYOUT_MONO12_PACKED;
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:          return FRAME_LAYOUT_BAYER12_PACKED;
+    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:        return FRAME_LAYOUT_MONO12_PACKED_MSFIRST;
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:  return FRAME_LAYOUT_BAYER12_PACKED_MSFIRST;
+    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:        return FRAME_LAYOUT_MONO10_PACKED_MSFIRST;
+    case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:  return FRAME_LAYOUT_BAYER10_PACKED_MSFIRST;
+    case PIXEL_FORMAT_RGB24:                        return FRAME_LAYOUT_BGR24;
+    case PIXEL_FORMAT_RGB24_NON_DIB:                return FRAME_LAYOUT_RGB24;
+    default:                                        return FRAME_LAYOUT_COUNT;
+    }
+}
 
+// Indexed by PXL_FRAME_FILTER, then PXL_FRAME_LAYOUT.  NULL entries are the formats not supported by the filter.
+static const PxLFrameKernel s_frameKernels[FRAME_FILTER_COUNT][FRAME_LAYOUT_COUNT] = {
+    // MONO8 / BAYER8, MONO16 / BAYER16, MONO12_PACKED / BAYER12_PACKED, MONO12_PACKED_MSFIRST / BAYER12_PACKED_MSFIRST,
+    // MONO10_PACKED_MSFIRST / BAYER10_PACKED_MSFIRST, BGR24 / RGB24
+    { MedianKernel<U8>,                                                     MedianKernel<U8>,
+      MedianKernel<U16>,                                                    MedianKernel<U16>,
+      MedianKernel_12Bit_Packed<false>,                                     MedianKernel_12Bit_Packed<false>,
+      MedianKernel_12Bit_Packed<true>,                                      MedianKernel_12Bit_Packed<true>,
+      MedianKernel_10Bit_Packed,                                            MedianKernel_10Bit_Packed,
+      MedianKernel_RGB,                                                     MedianKernel_RGB },
+    { Convolution_3x3_Kernel<FRAME_FILTER_LOW_PASS, U8>,                    Convolution_3x3_Kernel<FRAME_FILTER_LOW_PASS, U8>,
+      Convolution_3x3_Kernel<FRAME_FILTER_LOW_PASS, U16>,                   Convolution_3x3_Kernel<FRAME_FILTER_LOW_PASS, U16>,
+      Convolution_3x3_12Bit_Packed_Kernel<FRAME_FILTER_LOW_PASS, false>,    Convolution_3x3_12Bit_Packed_Kernel<FRAME_FILTER_LOW_PASS, false>,
+      Convolution_3x3_12Bit_Packed_Kernel<FRAME_FILTER_LOW_PASS, true>,     Convolution_3x3_12Bit_Packed_Kernel<FRAME_FILTER_LOW_PASS, true>,
+      Convolution_3x3_10Bit_Packed_Kernel<FRAME_FILTER_LOW_PASS>,           Convolution_3x3_10Bit_Packed_Kernel<FRAME_FILTER_LOW_PASS>,
+      Convolution_3x3_RGB_Kernel<FRAME_FILTER_LOW_PASS>,                    Convolution_3x3_RGB_Kernel<FRAME_FILTER_LOW_PASS> },
+    { Convolution_3x3_Kernel<FRAME_FILTER_HIGH_PASS, U8>,                   Convolution_3x3_Kernel<FRAME_FILTER_HIGH_PASS, U8>,
+      Convolution_3x3_Kernel<FRAME_FILTER_HIGH_PASS, U16>,                  Convolution_3x3_Kernel<FRAME_FILTER_HIGH_PASS, U16>,
+      Convolution_3x3_12Bit_Packed_Kernel<FRAME_FILTER_HIGH_PASS, false>,   Convolution_3x3_12Bit_Packed_Kernel<FRAME_FILTER_HIGH_PASS, false>,
+      Convolution_3x3_12Bit_Packed_Kernel<FRAME_FILTER_HIGH_PASS, true>,    Convolution_3x3_12Bit_Packed_Kernel<FRAME_FILTER_HIGH_PASS, true>,
+      Convolution_3x3_10Bit_Packed_Kernel<FRAME_FILTER_HIGH_PASS>,          Convolution_3x3_10Bit_Packed_Kernel<FRAME_FILTER_HIGH_PASS>,
+      Convolution_3x3_RGB_Kernel<FRAME_FILTER_HIGH_PASS>,                   Convolution_3x3_RGB_Kernel<FRAME_FILTER_HIGH_PASS> },
+    { HistogramEqualization_Mono8,                                          NULL,
+      HistogramEqualization_Mono16,                                         NULL,
+      HistogramEqualization_Packed<3, 1>,                                   NULL,
+      HistogramEqualization_Packed<3, 2>,                                   NULL,
+      HistogramEqualization_Packed<5, 4>,                                   NULL,
+      HistogramEqualization_RGB<true>,                                      HistogramEqualization_RGB<false> },
+    { BitmapOverlay<true>,                                                  NULL,
+      NULL,                                                                 NULL,
+      NULL,                                                                 NULL,
+      NULL,                                                                 NULL,
+      NULL,                                                                 NULL,
+      BitmapOverlay<false>,                                                 BitmapOverlay<false> },
+    { CrosshairOverlay_Mono8,                                               NULL,
+      NULL,                                                                 NULL,
+      NULL,                                                                 NULL,
+      NULL,                                                                 NULL,
+      NULL,                                                                 NULL,
+      CrosshairOverlay_RGB,                                                 CrosshairOverlay_RGB }
+};
 
+PxLFrameKernel PxLSelectFrameKernel (PXL_FRAME_FILTER filter, U32 uDataFormat)
+{
+    const int layout = FrameLayout (uDataFormat);
+    if (filter < 0 || filter >= FRAME_FILTER_COUNT || layout == FRAME_LAYOUT_COUNT) return NULL;
 
+    return s_frameKernels[filter][layout];
+}
@@ -6,6 +6,7 @@
  */
 
 #include <unistd.h>
+#include <stdlib.h>
 #include <vector>
 #include <memory>
 
@@ -55,12 +56,23 @@ PxLGpioInfo::PxLGpioInfo()
 , m_param3(0)
 {}
 
+PxLCachedFeature::PxLCachedFeature()
+: m_generation(0)
+, m_capacity(0)
+, m_flags(0)
+, m_numParams(0)
+{}
+
 PxLCamera::PxLCamera (ULONG serialNum)
 : m_ssUpdateFunc(NULL)
 , m_serialNum(0)
 , m_hCamera(NULL)
+, m_haveFeatures(false)
 , m_streamState(STOP_STREAM)
 , m_previewState(STOP_PREVIEW)
+, m_cacheGeneration(1)
+, m_cacheHits(0)
+, m_cacheMisses(0)
 , m_pixelFormatInterpretation(HSV_AS_COLOR)
 {
     PXL_RETURN_CODE rc = ApiSuccess;
@@ -72,18 +84,42 @@ PxLCamera::PxLCamera (ULONG serialNum)
     {
         throw PxLError(rc);
     }
+    pthread_mutex_init (&m_cacheFillLock, NULL);
+    for (int i = 0; i < FEATURES_TOTAL; i++) m_limitsGeneration[i] = 0;
     m_serialNum = serialNum;
 
+    // Without the descriptions, each feature is asked about as it comes up
+    m_haveFeatures = API_SUCCESS (m_features.load (m_hCamera, pxlDefaultFeatureCacheDir()));
+
     // Set the preview window to a fixed size.
     sprintf (title, "Preview - Camera %d", m_serialNum);
     PxLSetPreviewSettings (m_hCamera, title, 0, 128, 128, 1024, 768);
 
     // Create our poller object
-    m_poller = new PxLFeaturePoller (1000);
+    m_poller = new PxLFeaturePoller (this, 1000);
 }
 
 PxLCamera::~PxLCamera()
 {
+    // destroy our poller first -- the poll thread reads features without gCameraLock, so the camera
+    // must still be usable until it has stopped.
+    delete m_poller;
+
+    if (getenv ("PXL_LOCK_STATS"))
+    {
+        PxLCameraLockStatistics stats = lockStatistics();
+        const char*  names[] = {"feature reads", "feature writes", "stream"};
+        PxLLockStatistics* locks[] = {&stats.m_featureReads, &stats.m_featureWrites, &stats.m_stream};
+        for (int i = 0; i < 3; i++)
+        {
+            printf ("Camera %u %s lock: %u acquisitions, %u waited (total %.2f ms, max %.2f ms), held total %.2f ms, max %.2f ms\n",
+                    m_serialNum, names[i], locks[i]->m_acquisitions, locks[i]->m_contentions,
+                    locks[i]->m_totalWait * 1000.0, locks[i]->m_maxWait * 1000.0,
+                    locks[i]->m_totalHeld * 1000.0, locks[i]->m_maxHeld * 1000.0);
+        }
+        printf ("Camera %u feature cache: %u hits, %u misses\n", m_serialNum, stats.m_cacheHits, stats.m_cacheMisses);
+    }
+
     // Cancel the Sharpness score callback, if there is one
     if (m_ssUpdateFunc)
     {
@@ -96,13 +132,12 @@ PxLCamera::~PxLCamera()
 
     PxLUninitialize (m_hCamera);
 
-    // destroy our poller
-    delete m_poller;
-
+    pthread_mutex_destroy (&m_cacheFillLock);
 }
 
 PXL_RETURN_CODE PxLCamera::play()
 {
+    PxLAutoMutex lock(&m_streamLock);
     PXL_RETURN_CODE rc = ApiSuccess;
     ULONG currentStreamState = m_streamState;
 
@@ -129,6 +164,7 @@ PXL_RETURN_CODE PxLCamera::play()
 
 PXL_RETURN_CODE PxLCamera::pause()
 {
+    PxLAutoMutex lock(&m_streamLock);
     PXL_RETURN_CODE rc = ApiSuccess;
 
     rc = PxLSetPreviewState (m_hCamera, PAUSE_PREVIEW, &m_previewHandle);
@@ -154,6 +190,7 @@ PXL_RETURN_CODE PxLCamera::pause()
 // while previewing
 PXL_RETURN_CODE PxLCamera::suspend()
 {
+    PxLAutoMutex lock(&m_streamLock);
     PXL_RETURN_CODE rc = ApiSuccess;
 
     rc = PxLSetPreviewState (m_hCamera, PAUSE_PREVIEW, &m_previewHandle);
@@ -176,6 +213,7 @@ PXL_RETURN_CODE PxLCamera::suspend()
 
 PXL_RETURN_CODE PxLCamera::stop()
 {
+    PxLAutoMutex lock(&m_streamLock);
     PXL_RETURN_CODE rc = ApiSuccess;
 
     rc = PxLSetPreviewState(m_hCamera, STOP_PREVIEW, &m_previewHandle);
@@ -195,6 +233,7 @@ PXL_RETURN_CODE PxLCamera::stop()
 
 PXL_RETURN_CODE PxLCamera::pausePreview()
 {
+    PxLAutoMutex lock(&m_streamLock);
     PXL_RETURN_CODE rc = ApiSuccess;
 
     if (m_previewState == PAUSE_PREVIEW) return ApiSuccess;
@@ -208,6 +247,7 @@ PXL_RETURN_CODE PxLCamera::pausePreview()
 
 PXL_RETURN_CODE PxLCamera::playPreview()
 {
+    PxLAutoMutex lock(&m_streamLock);
     PXL_RETURN_CODE rc = ApiSuccess;
 
     if (m_previewState == START_PREVIEW) return ApiSuccess;
@@ -221,6 +261,7 @@ PXL_RETURN_CODE PxLCamera::playPreview()
 
 PXL_RETURN_CODE PxLCamera::stopStream()
 {
+    PxLAutoMutex lock(&m_streamLock);
     PXL_RETURN_CODE rc = ApiSuccess;
 
     if (m_streamState == STOP_STREAM) return ApiSuccess;
@@ -234,6 +275,7 @@ PXL_RETURN_CODE PxLCamera::stopStream()
 
 PXL_RETURN_CODE PxLCamera::startStream()
 {
+    PxLAutoMutex lock(&m_streamLock);
     PXL_RETURN_CODE rc = ApiSuccess;
 
     if (m_streamState == START_STREAM) return ApiSuccess;
@@ -247,6 +289,7 @@ PXL_RETURN_CODE PxLCamera::startStream()
 
 PXL_RETURN_CODE PxLCamera::pauseStream()
 {
+    PxLAutoMutex lock(&m_streamLock);
     PXL_RETURN_CODE rc = ApiSuccess;
 
     rc = PxLSetStreamState (m_hCamera, PAUSE_STREAM);
@@ -258,6 +301,8 @@ PXL_RETURN_CODE PxLCamera::pauseStream()
 
 PXL_RETURN_CODE PxLCamera::resizePreviewToRoi()
 {
+    PxLAutoMutex lock(&m_streamLock);
+
     return PxLResetPreviewWindow(m_hCamera);
 }
 
@@ -290,7 +335,7 @@ bool PxLCamera::enabled (ULONG feature)
     float featureValues[10]; // This is large enough for any feature
     ULONG numParams = 10;
 
-    rc = PxLGetFeature (m_hCamera, feature, &flags, &numParams, &featureValues[0]);
+    rc = getFeature (feature, &flags, &numParams, &featureValues[0]);
     if (!API_SUCCESS(rc)) return false;
 
     return (IS_FEATURE_ENABLED(flags));
@@ -323,11 +368,11 @@ bool PxLCamera::settable (ULONG feature)
     PXL_RETURN_CODE rc = ApiSuccess;
     ULONG  featureSize = 0;
 
-    rc = PxLGetCameraFeatures (m_hCamera, feature, NULL, &featureSize);
+    rc = getCameraFeatures (feature, NULL, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
     vector<BYTE> featureStore(featureSize);
     PCAMERA_FEATURES pFeatureInfo= (PCAMERA_FEATURES)&featureStore[0];
-    rc = PxLGetCameraFeatures (m_hCamera, feature, pFeatureInfo, &featureSize);
+    rc = getCameraFeatures (feature, pFeatureInfo, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
 
     if (1 != pFeatureInfo->uNumberOfFeatures ||
@@ -350,7 +395,7 @@ ULONG PxLCamera::numParametersSupported (ULONG feature)
 {
     ULONG  featureSize = 0;
 
-    PxLGetCameraFeatures (m_hCamera, feature, NULL, &featureSize);
+    getCameraFeatures (feature, NULL, &featureSize);
     return featureSize/sizeof(float); // Will be '0' on error
 }
 
@@ -365,7 +410,7 @@ PXL_RETURN_CODE PxLCamera::disable (ULONG feature)
 
     STOP_STREAM_IF_REQUIRED(feature);
 
-    rc = PxLSetFeature (m_hCamera, feature, flags, numParameters, &value);
+    rc = setFeature (feature, flags, numParameters, &value);
 
     return rc;
 }
@@ -375,11 +420,11 @@ PXL_RETURN_CODE PxLCamera::getRange (ULONG feature, float* min, float* max)
     PXL_RETURN_CODE rc = ApiSuccess;
     ULONG  featureSize = 0;
 
-    rc = PxLGetCameraFeatures (m_hCamera, feature, NULL, &featureSize);
+    rc = getCameraFeatures (feature, NULL, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
     vector<BYTE> featureStore(featureSize);
     PCAMERA_FEATURES pFeatureInfo= (PCAMERA_FEATURES)&featureStore[0];
-    rc = PxLGetCameraFeatures (m_hCamera, feature, pFeatureInfo, &featureSize);
+    rc = getCameraFeatures (feature, pFeatureInfo, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
 
     if (1 != pFeatureInfo->uNumberOfFeatures ||
@@ -399,7 +444,7 @@ PXL_RETURN_CODE PxLCamera::getValue (ULONG feature, float* value)
     ULONG flags;
     ULONG numParams = 1;
 
-    rc = PxLGetFeature (m_hCamera, feature, &flags, &numParams, &featureValue);
+    rc = getFeature (feature, &flags, &numParams, &featureValue);
     if (!API_SUCCESS(rc)) return rc;
 
     *value = featureValue;
@@ -413,7 +458,7 @@ PXL_RETURN_CODE PxLCamera::setValue (ULONG feature, float value)
 
     STOP_STREAM_IF_REQUIRED(feature);
 
-    rc = PxLSetFeature (m_hCamera, feature, FEATURE_FLAG_MANUAL, 1, &value);
+    rc = setFeature (feature, FEATURE_FLAG_MANUAL, 1, &value);
 
     return rc;
 }
@@ -425,7 +470,7 @@ PXL_RETURN_CODE PxLCamera::getOnetimeAuto (ULONG feature, bool* stillRunning)
     ULONG flags;
     ULONG numParams = (feature == FEATURE_WHITE_SHADING ? 3 : 1);
 
-    rc = PxLGetFeature (m_hCamera, feature, &flags, &numParams, &featureValue[0]);
+    rc = getFeature (feature, &flags, &numParams, &featureValue[0]);
     if (!API_SUCCESS(rc)) return rc;
 
     *stillRunning = (0 != (flags & FEATURE_FLAG_ONETIME));
@@ -446,13 +491,13 @@ PXL_RETURN_CODE PxLCamera::setOnetimeAuto (ULONG feature, bool enable)
         // We are cancelling onetime auto adjustment, and restoring manual adjustment.
         // When we set the feature (to turn off onetime), we have to set the feature to
         // 'something' -- so read the current value so that we can use it.
-        rc = PxLGetFeature (m_hCamera, feature, &flags, &numParameters, &value[0]);
+        rc = getFeature (feature, &flags, &numParameters, &value[0]);
         if (!API_SUCCESS(rc)) return rc;
     }
 
     flags = enable ? FEATURE_FLAG_ONETIME : FEATURE_FLAG_MANUAL;
 
-    rc = PxLSetFeature (m_hCamera, feature, flags, numParameters, &value[0]);
+    rc = setFeature (feature, flags, numParameters, &value[0]);
 
     return rc;
 }
@@ -473,13 +518,13 @@ PXL_RETURN_CODE PxLCamera::setOnetimeAuto (ULONG feature, bool enable, float min
         // We are cancelling onetime auto adjustment, and restoring manual adjustment.
         // When we set the feature (to turn off onetime), we have to set the feature to
         // 'something' -- so read the current value so that we can use it.
-        rc = PxLGetFeature (m_hCamera, feature, &flags, &numParameters, &value[0]);
+        rc = getFeature (feature, &flags, &numParameters, &value[0]);
         if (!API_SUCCESS(rc)) return rc;
     }
 
     flags = enable ? FEATURE_FLAG_ONETIME : FEATURE_FLAG_MANUAL;
 
-    rc = PxLSetFeature (m_hCamera, feature, flags, numParameters, &value[0]);
+    rc = setFeature (feature, flags, numParameters, &value[0]);
 
     return rc;
 }
@@ -491,7 +536,7 @@ PXL_RETURN_CODE PxLCamera::getContinuousAuto (ULONG feature, bool* enabled)
     ULONG flags;
     ULONG numParams = 1;
 
-    rc = PxLGetFeature (m_hCamera, feature, &flags, &numParams, &featureValue);
+    rc = getFeature (feature, &flags, &numParams, &featureValue);
     if (!API_SUCCESS(rc)) return rc;
 
     *enabled = (0 != (flags & FEATURE_FLAG_AUTO));
@@ -512,7 +557,7 @@ PXL_RETURN_CODE PxLCamera::setContinuousAuto (ULONG feature, bool enable)
         // We are disabling continuous auto adjustment, and restoring manual adjustment.
         // When we set the feature (to turn off continuous), we have to set the feature to
         // 'something' -- so read the current value so that we can use it.
-        rc = PxLGetFeature (m_hCamera, feature, &flags, &numParameters, &value);
+        rc = getFeature (feature, &flags, &numParameters, &value);
         if (!API_SUCCESS(rc)) return rc;
     }
 
@@ -520,7 +565,7 @@ PXL_RETURN_CODE PxLCamera::setContinuousAuto (ULONG feature, bool enable)
 
     STOP_STREAM_IF_REQUIRED(feature);
 
-    rc = PxLSetFeature (m_hCamera, feature, flags, numParameters, &value);
+    rc = setFeature (feature, flags, numParameters, &value);
 
     return rc;
 }
@@ -541,7 +586,7 @@ PXL_RETURN_CODE PxLCamera::setContinuousAuto (ULONG feature, bool enable, float
         // We are disabling continuous auto adjustment, and restoring manual adjustment.
         // When we set the feature (to turn off continuous), we have to set the feature to
         // 'something' -- so read the current value so that we can use it.
-        rc = PxLGetFeature (m_hCamera, feature, &flags, &numParameters, values);
+        rc = getFeature (feature, &flags, &numParameters, values);
         if (!API_SUCCESS(rc)) return rc;
     }
 
@@ -549,7 +594,7 @@ PXL_RETURN_CODE PxLCamera::setContinuousAuto (ULONG feature, bool enable, float
 
     STOP_STREAM_IF_REQUIRED(feature);
 
-    rc = PxLSetFeature (m_hCamera, feature, flags, numParameters, values);
+    rc = setFeature (feature, flags, numParameters, values);
 
     return rc;
 }
@@ -566,7 +611,7 @@ PXL_RETURN_CODE PxLCamera::getAutoLimits (ULONG feature, float* min, float* max)
     ULONG flags;
     ULONG numParams = 3;
 
-    rc = PxLGetFeature (m_hCamera, feature, &flags, &numParams, featureValue);
+    rc = getFeature (feature, &flags, &numParams, featureValue);
     if (!API_SUCCESS(rc)) return rc;
 
     *min = featureValue[1];
@@ -583,7 +628,7 @@ bool PxLCamera::triggering ()
     ULONG flags = 0;
     ULONG numParameters = 5;
 
-    rc = PxLGetFeature (m_hCamera, FEATURE_TRIGGER, &flags, &numParameters, value);
+    rc = getFeature (FEATURE_TRIGGER, &flags, &numParameters, value);
     if (API_SUCCESS(rc))
     {
         return ((flags & FEATURE_FLAG_OFF) == 0);
@@ -600,7 +645,7 @@ bool PxLCamera::hardwareTriggering ()
     ULONG flags = 0;
     ULONG numParameters = 5;
 
-    rc = PxLGetFeature (m_hCamera, FEATURE_TRIGGER, &flags, &numParameters, value);
+    rc = getFeature (FEATURE_TRIGGER, &flags, &numParameters, value);
     if (API_SUCCESS(rc))
     {
         return ((flags & FEATURE_FLAG_OFF) == 0 && value[1] == TRIGGER_TYPE_HARDWARE);
@@ -614,11 +659,11 @@ PXL_RETURN_CODE PxLCamera::getPixelAddressRange (float* minMode, float* maxMode,
     PXL_RETURN_CODE rc = ApiSuccess;
     ULONG  featureSize = 0;
 
-    rc = PxLGetCameraFeatures (m_hCamera, FEATURE_PIXEL_ADDRESSING, NULL, &featureSize);
+    rc = getCameraFeatures (FEATURE_PIXEL_ADDRESSING, NULL, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
     vector<BYTE> featureStore(featureSize);
     PCAMERA_FEATURES pFeatureInfo= (PCAMERA_FEATURES)&featureStore[0];
-    rc = PxLGetCameraFeatures (m_hCamera, FEATURE_PIXEL_ADDRESSING, pFeatureInfo, &featureSize);
+    rc = getCameraFeatures (FEATURE_PIXEL_ADDRESSING, pFeatureInfo, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
 
     if (1 != pFeatureInfo->uNumberOfFeatures ||
@@ -644,7 +689,7 @@ PXL_RETURN_CODE PxLCamera::getPixelAddressValues (float* mode, float* valueX, fl
     float featureValue[numParams];
     ULONG flags;
 
-    rc = PxLGetFeature (m_hCamera, FEATURE_PIXEL_ADDRESSING, &flags, &numParams, featureValue);
+    rc = getFeature (FEATURE_PIXEL_ADDRESSING, &flags, &numParams, featureValue);
     if (!API_SUCCESS(rc)) return rc;
 
     *mode = featureValue[FEATURE_PIXEL_ADDRESSING_PARAM_MODE];
@@ -678,7 +723,7 @@ PXL_RETURN_CODE PxLCamera::setPixelAddressValues (float mode, float valueX, floa
     featureValue[FEATURE_PIXEL_ADDRESSING_PARAM_X_VALUE] = valueX;
     featureValue[FEATURE_PIXEL_ADDRESSING_PARAM_Y_VALUE] = valueY;
 
-    rc = PxLSetFeature (m_hCamera, FEATURE_PIXEL_ADDRESSING, FEATURE_FLAG_MANUAL, numParams, featureValue);
+    rc = setFeature (FEATURE_PIXEL_ADDRESSING, FEATURE_FLAG_MANUAL, numParams, featureValue);
 
     return rc;
 }
@@ -709,11 +754,11 @@ PXL_RETURN_CODE PxLCamera::getRoiRange (ROI_TYPE type, PXL_ROI* minRoi, PXL_ROI*
     //
     // Step 2.
     //      Get the requested ROI limit information
-    rc = PxLGetCameraFeatures (m_hCamera, feature, NULL, &featureSize);
+    rc = getCameraFeatures (feature, NULL, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
     vector<BYTE> featureStore(featureSize);
     PCAMERA_FEATURES pFeatureInfo= (PCAMERA_FEATURES)&featureStore[0];
-    rc = PxLGetCameraFeatures (m_hCamera, feature, pFeatureInfo, &featureSize);
+    rc = getCameraFeatures (feature, pFeatureInfo, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
 
     if (1 != pFeatureInfo->uNumberOfFeatures ||
@@ -779,7 +824,7 @@ PXL_RETURN_CODE PxLCamera::getRoiValue (ROI_TYPE type, PXL_ROI* roi, bool ignore
     //
     // Step 2
     //      Get the camera's ROI
-    rc = PxLGetFeature (m_hCamera, feature, &flags, &numParams, featureValue);
+    rc = getFeature (feature, &flags, &numParams, featureValue);
     if (!API_SUCCESS(rc)) return rc;
 
     roi->m_width = (int)featureValue[FEATURE_ROI_PARAM_WIDTH];
@@ -861,36 +906,8 @@ PXL_RETURN_CODE PxLCamera::setRoiValue (ROI_TYPE type, PXL_ROI &roi, bool off)
 
     //
     // Step 3
-    //      figure out if we need to transpose the ROI to deal
-    //      with flip and rotate
-    bool hFlip = false;
-    bool vFlip = false;
-    getFlip (&hFlip, &vFlip);
-
-    float rotate = 0.0;
-    getValue (FEATURE_ROTATE, &rotate);
-
-    if (hFlip || vFlip || rotate != 0.0)
-    {
-        //
-        // Step 4
-        //      We need to transpose the ROI values to accommodate the
-        //      flip or rotate.  but first, we need to know the maxRoi
-        PXL_ROI minRoi;
-        PXL_ROI maxRoi;
-        rc = getRoiRange (type, &minRoi, &maxRoi, true); // don't transpose the ROIs
-        maxRoi.m_offsetX = maxRoi.m_offsetY = 0;  // Offests are 0 for ffov
-        PXL_ROI rotatedMaxRoi = maxRoi;
-        rotatedMaxRoi.rotateCounterClockwise((int)rotate);
-        if (API_SUCCESS(rc))
-        {
-            // flip need the transposed maxRoi
-            if (hFlip) adjustedRoi.flipHorizontal(rotatedMaxRoi);
-            if (vFlip) adjustedRoi.flipVertical(rotatedMaxRoi);
-            // note that maxRoi has NOT already been transposed
-            adjustedRoi.rotateCounterClockwise ((int)rotate, maxRoi);
-        }
-    }
+    //      transpose the ROI to deal with flip and rotate
+    rc = untransformRoi (type, adjustedRoi);
 
     featureValue[FEATURE_ROI_PARAM_WIDTH] = (float)adjustedRoi.m_width;
     featureValue[FEATURE_ROI_PARAM_HEIGHT] = (float)adjustedRoi.m_height;
@@ -905,9 +922,9 @@ PXL_RETURN_CODE PxLCamera::setRoiValue (ROI_TYPE type, PXL_ROI &roi, bool off)
     {
         if (off)
         {
-            rc = PxLSetFeature (m_hCamera, feature, FEATURE_FLAG_OFF, numParams, featureValue);
+            rc = setFeature (feature, FEATURE_FLAG_OFF, numParams, featureValue);
         } else {
-            rc = PxLSetFeature (m_hCamera, feature, FEATURE_FLAG_MANUAL, numParams, featureValue);
+            rc = setFeature (feature, FEATURE_FLAG_MANUAL, numParams, featureValue);
         }
     }
 
@@ -919,11 +936,11 @@ PXL_RETURN_CODE PxLCamera::getTriggerRange (float* minMode, float* maxMode, floa
     PXL_RETURN_CODE rc = ApiSuccess;
     ULONG  featureSize = 0;
 
-    rc = PxLGetCameraFeatures (m_hCamera, FEATURE_TRIGGER, NULL, &featureSize);
+    rc = getCameraFeatures (FEATURE_TRIGGER, NULL, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
     vector<BYTE> featureStore(featureSize);
     PCAMERA_FEATURES pFeatureInfo= (PCAMERA_FEATURES)&featureStore[0];
-    rc = PxLGetCameraFeatures (m_hCamera, FEATURE_TRIGGER, pFeatureInfo, &featureSize);
+    rc = getCameraFeatures (FEATURE_TRIGGER, pFeatureInfo, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
 
     if (1 != pFeatureInfo->uNumberOfFeatures ||
@@ -946,7 +963,7 @@ PXL_RETURN_CODE PxLCamera::getTriggerValue (PxLTriggerInfo& trig)
     ULONG flags = 0;
     ULONG numParameters = 5;
 
-    rc = PxLGetFeature (m_hCamera, FEATURE_TRIGGER, &flags, &numParameters, values);
+    rc = getFeature (FEATURE_TRIGGER, &flags, &numParameters, values);
     if (! API_SUCCESS(rc)) return rc;
 
     PxLTriggerInfo currentTrig;
@@ -984,7 +1001,7 @@ PXL_RETURN_CODE PxLCamera::setTriggerValue (PxLTriggerInfo& trig)
     values [FEATURE_TRIGGER_PARAM_DELAY] = trig.m_delay;
     values [FEATURE_TRIGGER_PARAM_NUMBER] = trig.m_number;
 
-    return PxLSetFeature (m_hCamera, FEATURE_TRIGGER, flags, numParameters, values);
+    return setFeature (FEATURE_TRIGGER, flags, numParameters, values);
 }
 
 PXL_RETURN_CODE PxLCamera::getGpioRange (int* numGpios, float* minMode, float* maxMode)
@@ -992,11 +1009,11 @@ PXL_RETURN_CODE PxLCamera::getGpioRange (int* numGpios, float* minMode, float* m
     PXL_RETURN_CODE rc = ApiSuccess;
     ULONG  featureSize = 0;
 
-    rc = PxLGetCameraFeatures (m_hCamera, FEATURE_GPIO, NULL, &featureSize);
+    rc = getCameraFeatures (FEATURE_GPIO, NULL, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
     vector<BYTE> featureStore(featureSize);
     PCAMERA_FEATURES pFeatureInfo= (PCAMERA_FEATURES)&featureStore[0];
-    rc = PxLGetCameraFeatures (m_hCamera, FEATURE_GPIO, pFeatureInfo, &featureSize);
+    rc = getCameraFeatures (FEATURE_GPIO, pFeatureInfo, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
 
     if (1 != pFeatureInfo->uNumberOfFeatures ||
@@ -1023,7 +1040,7 @@ PXL_RETURN_CODE PxLCamera::getGpioValue (int gpioNum, PxLGpioInfo& info)
     ULONG numParameters = 6;
 
     values[FEATURE_GPIO_PARAM_GPIO_INDEX] = (float)gpioNum+1;
-    rc = PxLGetFeature (m_hCamera, FEATURE_GPIO, &flags, &numParameters, values);
+    rc = getFeature (FEATURE_GPIO, &flags, &numParameters, values);
     if (! API_SUCCESS(rc)) return rc;
 
     info.m_enabled= (flags & FEATURE_FLAG_OFF) == 0;
@@ -1054,7 +1071,7 @@ PXL_RETURN_CODE PxLCamera::setGpioValue (int gpioNum, PxLGpioInfo& info)
     values [FEATURE_GPIO_PARAM_PARAM_2] = info.m_param2;
     values [FEATURE_GPIO_PARAM_PARAM_3] = info.m_param3;
 
-    return PxLSetFeature (m_hCamera, FEATURE_GPIO, flags, numParameters, values);
+    return setFeature (FEATURE_GPIO, flags, numParameters, values);
 }
 
 PXL_RETURN_CODE PxLCamera::getWhiteBalanceValues (float* red, float* green, float* blue)
@@ -1064,7 +1081,7 @@ PXL_RETURN_CODE PxLCamera::getWhiteBalanceValues (float* red, float* green, floa
     ULONG flags;
     ULONG numParams = 3;
 
-    rc = PxLGetFeature (m_hCamera, FEATURE_WHITE_SHADING, &flags, &numParams, featureValues);
+    rc = getFeature (FEATURE_WHITE_SHADING, &flags, &numParams, featureValues);
     if (!API_SUCCESS(rc)) return rc;
 
     *red   = featureValues[0];
@@ -1085,7 +1102,7 @@ PXL_RETURN_CODE PxLCamera::setWhiteBalanceValues (float red, float green, float
     featureValues[1] = green;
     featureValues[2] = blue;
 
-    rc = PxLSetFeature (m_hCamera, FEATURE_WHITE_SHADING, FEATURE_FLAG_MANUAL, 3, featureValues);
+    rc = setFeature (FEATURE_WHITE_SHADING, FEATURE_FLAG_MANUAL, 3, featureValues);
 
     return rc;
 }
@@ -1097,7 +1114,7 @@ PXL_RETURN_CODE PxLCamera::getFlip (bool* horizontal, bool* vertical)
     ULONG flags;
     ULONG numParams = 2;
 
-    rc = PxLGetFeature (m_hCamera, FEATURE_FLIP, &flags, &numParams, featureValues);
+    rc = getFeature (FEATURE_FLIP, &flags, &numParams, featureValues);
     if (!API_SUCCESS(rc)) return rc;
 
     *horizontal = featureValues[0] != 0.0f;
@@ -1116,7 +1133,7 @@ PXL_RETURN_CODE PxLCamera::setFlip (bool horizontal, bool vertical)
     featureValues[0] = horizontal ? 1.0f : 0.0f;;
     featureValues[1] = vertical ? 1.0f : 0.0f;
 
-    rc = PxLSetFeature (m_hCamera, FEATURE_FLIP, FEATURE_FLAG_MANUAL, 2, featureValues);
+    rc = setFeature (FEATURE_FLIP, FEATURE_FLAG_MANUAL, 2, featureValues);
 
     return rc;
 }
@@ -1139,19 +1156,19 @@ ULONG  PxLCamera::imageSizeInPixels ()
 
     // Get region of interest (ROI)
     numParams = 4; // left, top, width, height
-    rc = PxLGetFeature(m_hCamera, FEATURE_ROI, &flags, &numParams, &parms[0]);
+    rc = getFeature (FEATURE_ROI, &flags, &numParams, &parms[0]);
     if (!API_SUCCESS(rc)) return 0;
     roiWidth    = (U32)parms[FEATURE_ROI_PARAM_WIDTH];
     roiHeight   = (U32)parms[FEATURE_ROI_PARAM_HEIGHT];
 
     // Determine if the image is interleaved, and double the width if so.
     numParams = 1;
-    rc = PxLGetFeature(m_hCamera, FEATURE_GAIN_HDR, &flags, &numParams, parms);
+    rc = getFeature (FEATURE_GAIN_HDR, &flags, &numParams, parms);
     if (API_SUCCESS (rc) && parms[0] == FEATURE_GAIN_HDR_MODE_INTERLEAVED) roiWidth *= 2;
 
     // Query pixel addressing
     numParams = 4; // pixel addressing value, pixel addressing type (e.g. bin, average, ...)
-    rc = PxLGetFeature(m_hCamera, FEATURE_PIXEL_ADDRESSING, &flags, &numParams, &parms[0]);
+    rc = getFeature (FEATURE_PIXEL_ADDRESSING, &flags, &numParams, &parms[0]);
     if (API_SUCCESS(rc))
     {
         if (numParams < 4)
@@ -1184,7 +1201,7 @@ ULONG  PxLCamera::imageSizeInBytes ()
 
     // Knowing pixel format means we can determine how many bytes per pixel.
     numParams = 1;
-    rc = PxLGetFeature(m_hCamera, FEATURE_PIXEL_FORMAT, &flags, &numParams, &parms[0]);
+    rc = getFeature (FEATURE_PIXEL_FORMAT, &flags, &numParams, &parms[0]);
     if (!API_SUCCESS(rc)) return 0;
     pixelFormat = (U32)parms[0];
 
@@ -1265,11 +1282,17 @@ PXL_RETURN_CODE PxLCamera::getCameraInfo (CAMERA_INFO &cameraInfo)
 
 PXL_RETURN_CODE PxLCamera::loadSettings (bool factoryDefaults)
 {
+    // This changes all of the features at once
+    PxLAutoWriteLock lock(&m_featureLock);
+    invalidateCache();
+
     return PxLLoadSettings (m_hCamera, factoryDefaults ? PXL_SETTINGS_FACTORY : PXL_SETTINGS_USER);
 }
 
 PXL_RETURN_CODE PxLCamera::saveSettings ()
 {
+    PxLAutoReadLock lock(&m_featureLock);
+
     return PxLSaveSettings (m_hCamera, PXL_SETTINGS_USER);
 }
 
@@ -1352,21 +1375,255 @@ FRAME_RATE_LIMITER PxLCamera::actualFrameRatelimiter ()
 }
 
 
+PxLCameraLockStatistics PxLCamera::lockStatistics ()
+{
+    PxLCameraLockStatistics stats;
+
+    stats.m_featureReads = m_featureLock.readStatistics();
+    stats.m_featureWrites = m_featureLock.writeStatistics();
+    stats.m_stream = m_streamLock.statistics();
+    stats.m_cacheHits = m_cacheHits;
+    stats.m_cacheMisses = m_cacheMisses;
+
+    return stats;
+}
+
 /* ---------------------------------------------------------------------------
  * --   Member functions : private
  * ---------------------------------------------------------------------------
  */
 
+PXL_RETURN_CODE PxLCamera::getFeature (ULONG feature, ULONG* flags, ULONG* numParams, float* params)
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    ULONG capacity = *numParams;
+
+    if (cachedFeature (feature, flags, numParams, params)) return ApiSuccess;
+
+    PxLAutoReadLock lock(&m_featureLock);
+
+    rc = PxLGetFeature (m_hCamera, feature, flags, numParams, params);
+    if (API_SUCCESS(rc)) cacheFeature (feature, capacity, *flags, *numParams, params);
+
+    return rc;
+}
+
+PXL_RETURN_CODE PxLCamera::setFeature (ULONG feature, ULONG flags, ULONG numParams, const float* params)
+{
+    PxLAutoWriteLock lock(&m_featureLock);
+
+    return applyFeature (feature, flags, numParams, params);
+}
+
+// Must be called while holding m_featureLock for writing
+PXL_RETURN_CODE PxLCamera::applyFeature (ULONG feature, ULONG flags, ULONG numParams, const float* params)
+{
+    // Setting one feature can change others (the API will return ApiSuccessParametersChanged), so
+    // none of the cached values can be trusted anymore.
+    invalidateCache();
+
+    return PxLSetFeature (m_hCamera, feature, flags, numParams, params);
+}
+
+PXL_RETURN_CODE PxLCamera::getCameraFeatures (ULONG feature, CAMERA_FEATURES* pFeatureInfo, ULONG* bufferSize)
+{
+    PxLAutoReadLock lock(&m_featureLock);
+
+    return describeFeature (feature, pFeatureInfo, bufferSize);
+}
+
+//
+// A feature's description, from m_features.  Only those whose limits can change (FEATURE_FLAG_VOLATILE) are
+// asked of the camera; their size is the same, either way.  Must be called while holding m_featureLock.
+PXL_RETURN_CODE PxLCamera::describeFeature (ULONG feature, CAMERA_FEATURES* pFeatureInfo, ULONG* bufferSize)
+{
+    if (m_haveFeatures && API_SUCCESS (m_features.getCameraFeatures (feature, pFeatureInfo, bufferSize)))
+    {
+        if (NULL == pFeatureInfo || !(pFeatureInfo->pFeatures->uFlags & FEATURE_FLAG_VOLATILE)) return ApiSuccess;
+    }
+
+    return PxLGetCameraFeatures (m_hCamera, feature, pFeatureInfo, bufferSize);
+}
+
+//
+// Returns the limits of each of the feature's parameters.  These are kept until a feature is set.
+PXL_RETURN_CODE PxLCamera::getParamLimits (ULONG feature, vector<FEATURE_PARAM>& limits)
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    ULONG  featureSize = 0;
+
+    if (feature >= FEATURES_TOTAL) return ApiInvalidParameterError;
+
+    pthread_mutex_lock (&m_cacheFillLock);
+    bool cached = m_limitsGeneration[feature] == m_cacheGeneration;
+    if (cached) limits = m_limits[feature];
+    pthread_mutex_unlock (&m_cacheFillLock);
+    if (cached) return ApiSuccess;
+
+    PxLAutoReadLock lock(&m_featureLock);
+
+    rc = describeFeature (feature, NULL, &featureSize);
+    if (!API_SUCCESS(rc)) return rc;
+    vector<BYTE> featureStore(featureSize);
+    PCAMERA_FEATURES pFeatureInfo= (PCAMERA_FEATURES)&featureStore[0];
+    rc = describeFeature (feature, pFeatureInfo, &featureSize);
+    if (!API_SUCCESS(rc)) return rc;
+
+    if (1 != pFeatureInfo->uNumberOfFeatures || NULL == pFeatureInfo->pFeatures) return ApiInvalidParameterError;
+
+    limits.clear();
+    if (pFeatureInfo->pFeatures->pParams)
+    {
+        limits.assign (pFeatureInfo->pFeatures->pParams,
+                       pFeatureInfo->pFeatures->pParams + pFeatureInfo->pFeatures->uNumberOfParameters);
+    }
+
+    pthread_mutex_lock (&m_cacheFillLock);
+    m_limits[feature] = limits;
+    m_limitsGeneration[feature] = m_cacheGeneration;
+    pthread_mutex_unlock (&m_cacheFillLock);
+
+    return ApiSuccess;
+}
+
+//
+// Converts roi, as the user sees it, to the camera's orientation -- undoing any flip or rotate
+// the camera is doing.
+PXL_RETURN_CODE PxLCamera::untransformRoi (ROI_TYPE type, PXL_ROI& roi)
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+
+    bool hFlip = false;
+    bool vFlip = false;
+    getFlip (&hFlip, &vFlip);
+
+    float rotate = 0.0;
+    getValue (FEATURE_ROTATE, &rotate);
+
+    if (hFlip || vFlip || rotate != 0.0)
+    {
+        //
+        // We need to transpose the ROI values to accommodate the
+        // flip or rotate.  but first, we need to know the maxRoi
+        PXL_ROI minRoi;
+        PXL_ROI maxRoi;
+        rc = getRoiRange (type, &minRoi, &maxRoi, true); // don't transpose the ROIs
+        maxRoi.m_offsetX = maxRoi.m_offsetY = 0;  // Offests are 0 for ffov
+        PXL_ROI rotatedMaxRoi = maxRoi;
+        rotatedMaxRoi.rotateCounterClockwise((int)rotate);
+        if (API_SUCCESS(rc))
+        {
+            // flip need the transposed maxRoi
+            if (hFlip) roi.flipHorizontal(rotatedMaxRoi);
+            if (vFlip) roi.flipVertical(rotatedMaxRoi);
+            // note that maxRoi has NOT already been transposed
+            roi.rotateCounterClockwise ((int)rotate, maxRoi);
+        }
+    }
+
+    return rc;
+}
+
+// Only the features that describe the image (and whether or not we are triggered) are cached;
+// these are read often, and they never change on their own.
+static bool CacheableFeature (ULONG feature)
+{
+    switch (feature)
+    {
+    case FEATURE_ROI:
+    case FEATURE_PIXEL_FORMAT:
+    case FEATURE_PIXEL_ADDRESSING:
+    case FEATURE_GAIN_HDR:
+    case FEATURE_FLIP:
+    case FEATURE_ROTATE:
+    case FEATURE_TRIGGER:
+        return true;
+    default:
+        return false;
+    }
+}
+
+//
+// Returns the cached value of the feature, if there is a current one.  No lock is taken, so
+// an entry is only used if its generation is the same before and after we copy it out.
+bool PxLCamera::cachedFeature (ULONG feature, ULONG* flags, ULONG* numParams, float* params)
+{
+    if (! CacheableFeature (feature)) return false;
+
+    PxLCachedFeature& entry = m_cache[feature];
+    U32 generation = entry.m_generation;
+    __sync_synchronize();
+
+    ULONG cachedFlags = entry.m_flags;
+    ULONG cachedNumParams = entry.m_numParams;
+    float cachedParams[PxLCachedFeature::MAX_PARAMS];
+    bool  hit = generation != 0 && generation == m_cacheGeneration && entry.m_capacity == *numParams;
+    if (hit)
+    {
+        for (ULONG i = 0; i < cachedNumParams; i++) cachedParams[i] = entry.m_params[i];
+    }
+
+    __sync_synchronize();
+    if (!hit || entry.m_generation != generation)
+    {
+        __sync_fetch_and_add (&m_cacheMisses, 1);
+        return false;
+    }
+
+    *flags = cachedFlags;
+    *numParams = cachedNumParams;
+    for (ULONG i = 0; i < cachedNumParams; i++) params[i] = cachedParams[i];
+    __sync_fetch_and_add (&m_cacheHits, 1);
+
+    return true;
+}
+
+//
+// Records a value just read from the camera.  This must be called while holding m_featureLock,
+// so that the generation cannot change between reading the feature, and caching it.
+void PxLCamera::cacheFeature (ULONG feature, ULONG capacity, ULONG flags, ULONG numParams, const float* params)
+{
+    if (! CacheableFeature (feature)) return;
+    // Don't cache anything the camera is adjusting on its own
+    if (flags & (FEATURE_FLAG_AUTO | FEATURE_FLAG_ONETIME)) return;
+    if (capacity > PxLCachedFeature::MAX_PARAMS || numParams > capacity) return;
+
+    // If someone else is updating the cache, then don't bother; it will be cached next time.
+    if (0 != pthread_mutex_trylock (&m_cacheFillLock)) return;
+
+    PxLCachedFeature& entry = m_cache[feature];
+    entry.m_generation = 0;
+    __sync_synchronize();
+
+    entry.m_capacity = capacity;
+    entry.m_flags = flags;
+    entry.m_numParams = numParams;
+    for (ULONG i = 0; i < numParams; i++) entry.m_params[i] = params[i];
+
+    __sync_synchronize();
+    entry.m_generation = m_cacheGeneration;
+
+    pthread_mutex_unlock (&m_cacheFillLock);
+}
+
+// Must be called while holding m_featureLock for writing
+void PxLCamera::invalidateCache ()
+{
+    U32 generation = m_cacheGeneration + 1;
+    m_cacheGeneration = (generation == 0 ? 1 : generation);
+    __sync_synchronize();
+}
+
 PXL_RETURN_CODE PxLCamera::getFlags (ULONG feature, ULONG *flags)
 {
      PXL_RETURN_CODE rc = ApiSuccess;
      ULONG  featureSize = 0;
 
-    rc = PxLGetCameraFeatures (m_hCamera, feature, NULL, &featureSize);
+    rc = getCameraFeatures (feature, NULL, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
     vector<BYTE> featureStore(featureSize);
     PCAMERA_FEATURES pFeatureInfo= (PCAMERA_FEATURES)&featureStore[0];
-    rc = PxLGetCameraFeatures (m_hCamera, feature, pFeatureInfo, &featureSize);
+    rc = getCameraFeatures (feature, pFeatureInfo, &featureSize);
     if (!API_SUCCESS(rc)) return rc;
 
     if (1 != pFeatureInfo->uNumberOfFeatures || NULL == pFeatureInfo->pFeatures) return ApiInvalidParameterError;
@@ -193,7 +193,12 @@ int main(int argc, char* argv[]) {
 
     //
     // Step 6.
-    //      User wants to quit.  Do cleanup and exit.
+    //      User wants to quit.  Do cleanup and exit.  The camera goes first, so that its poll thread is stopped
+    //      before the tabs its updates refer to are deleted.
+    {
+        PxLAutoLock lock(&gCameraLock);
+        if (gCamera) ReleaseCamera();
+    }
     delete gVideoCaptureDialog; gVideoCaptureDialog = NULL;
     delete gOnetimeDialog; gOnetimeDialog = NULL;
 
@@ -295,6 +300,9 @@ void ReleaseCamera ()
 {
     ASSERT (gCamera);
 
+    // A host side autofocus search uses the camera from a thread of its own
+    if (gLensTab) gLensTab->stopAutofocus();
+
     delete gCamera;
     gCamera = NULL;
 
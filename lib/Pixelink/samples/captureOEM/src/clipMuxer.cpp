@@ -0,0 +1,940 @@
+
+/***************************************************************************
+ *
+ *     File: clipMuxer.cpp
+ *
+ *     Description:
+ *       Muxes the H.264 elementary stream of a clip capture into its AVI or
+ *       MP4 container, as the stream is captured.
+ *
+ *       The elementary stream (Annex B) is split into NAL units at the start
+ *       codes, and the NAL units are grouped into access units (frames); a new
+ *       frame starts with an access unit delimiter, SPS, PPS or SEI, or with
+ *       a slice whose first_mb_in_slice is 0.  Each frame is held with 4 byte
+ *       length prefixes (as MP4 wants them); for AVI, the prefixes are simply
+ *       overwritten with start codes, which are the same size.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include "clipMuxer.h"
+#include "locks.h"
+
+using namespace std;
+
+#define MUX_READ_SIZE      (256*1024)
+#define MUX_FILE_BUFFER    (1024*1024)
+#define MUX_POLL_INTERVAL  5000          // us between looks at an encoded file that has not grown
+
+// NAL unit types that we care about
+#define NAL_SLICE       1
+#define NAL_SLICE_IDR   5
+#define NAL_SEI         6
+#define NAL_SPS         7
+#define NAL_PPS         8
+#define NAL_AUD         9
+
+static void *muxThread (PxLClipMuxer *muxer);
+
+/* ---------------------------------------------------------------------------
+ * --   Byte packing
+ * ---------------------------------------------------------------------------
+ */
+
+static inline void PutBE16 (vector<U8>& buf, U32 value)
+{
+    buf.push_back ((U8)(value >> 8));
+    buf.push_back ((U8)value);
+}
+
+static inline void PutBE32 (vector<U8>& buf, U32 value)
+{
+    buf.push_back ((U8)(value >> 24));
+    buf.push_back ((U8)(value >> 16));
+    buf.push_back ((U8)(value >> 8));
+    buf.push_back ((U8)value);
+}
+
+static inline void PutBE64 (vector<U8>& buf, U64 value)
+{
+    PutBE32 (buf, (U32)(value >> 32));
+    PutBE32 (buf, (U32)value);
+}
+
+static inline void PutLE16 (vector<U8>& buf, U32 value)
+{
+    buf.push_back ((U8)value);
+    buf.push_back ((U8)(value >> 8));
+}
+
+static inline void PutLE32 (vector<U8>& buf, U32 value)
+{
+    buf.push_back ((U8)value);
+    buf.push_back ((U8)(value >> 8));
+    buf.push_back ((U8)(value >> 16));
+    buf.push_back ((U8)(value >> 24));
+}
+
+static inline void PutFourcc (vector<U8>& buf, const char* fourcc)
+{
+    buf.insert (buf.end(), fourcc, fourcc + 4);
+}
+
+static inline void SetBE32 (U8* p, U32 value)
+{
+    p[0] = (U8)(value >> 24);
+    p[1] = (U8)(value >> 16);
+    p[2] = (U8)(value >> 8);
+    p[3] = (U8)value;
+}
+
+static inline void SetLE32 (U8* p, U32 value)
+{
+    p[0] = (U8)value;
+    p[1] = (U8)(value >> 8);
+    p[2] = (U8)(value >> 16);
+    p[3] = (U8)(value >> 24);
+}
+
+// MP4 boxes:  the size (big endian) includes the 8 byte header
+static inline size_t BeginBox (vector<U8>& buf, const char* type)
+{
+    size_t start = buf.size();
+    PutBE32 (buf, 0);
+    PutFourcc (buf, type);
+    return start;
+}
+
+static inline size_t BeginFullBox (vector<U8>& buf, const char* type, U32 version, U32 flags)
+{
+    size_t start = BeginBox (buf, type);
+    PutBE32 (buf, (version << 24) | flags);
+    return start;
+}
+
+static inline void EndBox (vector<U8>& buf, size_t start)
+{
+    SetBE32 (&buf[start], (U32)(buf.size() - start));
+}
+
+// RIFF chunks:  the size (little endian) excludes the 8 byte header
+static inline size_t BeginChunk (vector<U8>& buf, const char* id)
+{
+    size_t start = buf.size();
+    PutFourcc (buf, id);
+    PutLE32 (buf, 0);
+    return start;
+}
+
+static inline size_t BeginList (vector<U8>& buf, const char* id, const char* type)
+{
+    size_t start = BeginChunk (buf, id);
+    PutFourcc (buf, type);
+    return start;
+}
+
+static inline void EndChunk (vector<U8>& buf, size_t start)
+{
+    SetLE32 (&buf[start + 4], (U32)(buf.size() - start - 8));
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Container writers
+ * ---------------------------------------------------------------------------
+ */
+
+class PxLClipWriter
+{
+public:
+    PxLClipWriter () : m_file(NULL), m_offset(0) {}
+    virtual ~PxLClipWriter () {}
+
+    virtual PXL_RETURN_CODE open (FILE* file, int width, int height, float frameRate,
+                                  const vector<U8>& sps, const vector<U8>& pps) = 0;
+    // pFrame is the frame's NAL units, each with a 4 byte length prefix.  The writer may modify it.
+    virtual PXL_RETURN_CODE write (U8* pFrame, size_t size, bool key) = 0;
+    virtual PXL_RETURN_CODE close () = 0;
+
+    U64 bytesWritten () {return m_offset;}
+
+protected:
+    PXL_RETURN_CODE put (const void* pData, size_t size)
+    {
+        if (size && fwrite (pData, 1, size, m_file) != size) return errno == ENOSPC ? ApiDiskFullError : ApiIOError;
+        m_offset += size;
+        return ApiSuccess;
+    }
+    PXL_RETURN_CODE patch (U64 offset, const void* pData, size_t size)
+    {
+        if (fseeko (m_file, (off_t)offset, SEEK_SET) != 0 ||
+            fwrite (pData, 1, size, m_file) != size ||
+            fseeko (m_file, (off_t)m_offset, SEEK_SET) != 0) return ApiIOError;
+        return ApiSuccess;
+    }
+
+    FILE* m_file;
+    U64   m_offset;  // Bytes written so far (the end of the file)
+};
+
+//
+// AVI 1.0:  a header, the frames in the 'movi' list, then the 'idx1' index.  RIFF sizes are 32 bits, so
+// the file is limited to 4 GB; use MP4 for longer clips.
+class PxLAviWriter : public PxLClipWriter
+{
+public:
+    PxLAviWriter () : m_frames(0), m_maxFrameSize(0) {}
+
+    PXL_RETURN_CODE open (FILE* file, int width, int height, float frameRate, const vector<U8>& sps, const vector<U8>& pps);
+    PXL_RETURN_CODE write (U8* pFrame, size_t size, bool key);
+    PXL_RETURN_CODE close ();
+
+private:
+    static const U32 AVIF_HASINDEX = 0x00000010;
+    static const U32 AVIIF_KEYFRAME = 0x00000010;
+
+    U32        m_frames;
+    U32        m_maxFrameSize;
+    vector<U8> m_index;          // The idx1 entries, so far
+
+    // Where the fields that are only known at the end are
+    size_t     m_totalFramesOffset;
+    size_t     m_avihBufferSizeOffset;
+    size_t     m_lengthOffset;
+    size_t     m_strhBufferSizeOffset;
+    size_t     m_moviOffset;     // of the 'movi' LIST
+};
+
+PXL_RETURN_CODE PxLAviWriter::open (FILE* file, int width, int height, float frameRate, const vector<U8>& sps, const vector<U8>& pps)
+{
+    m_file = file;
+    const U32 rate = (U32)(frameRate * 1000.0f + 0.5f);
+
+    vector<U8> hdr;
+    size_t riff = BeginList (hdr, "RIFF", "AVI ");
+    size_t hdrl = BeginList (hdr, "LIST", "hdrl");
+
+    size_t avih = BeginChunk (hdr, "avih");
+    PutLE32 (hdr, (U32)(1000000.0f / frameRate + 0.5f));   // dwMicroSecPerFrame
+    PutLE32 (hdr, 0);                                       // dwMaxBytesPerSec
+    PutLE32 (hdr, 0);                                       // dwPaddingGranularity
+    PutLE32 (hdr, AVIF_HASINDEX);                           // dwFlags
+    m_totalFramesOffset = hdr.size();
+    PutLE32 (hdr, 0);                                       // dwTotalFrames
+    PutLE32 (hdr, 0);                                       // dwInitialFrames
+    PutLE32 (hdr, 1);                                       // dwStreams
+    m_avihBufferSizeOffset = hdr.size();
+    PutLE32 (hdr, 0);                                       // dwSuggestedBufferSize
+    PutLE32 (hdr, width);
+    PutLE32 (hdr, height);
+    for (int i = 0; i < 4; i++) PutLE32 (hdr, 0);           // dwReserved
+    EndChunk (hdr, avih);
+
+    size_t strl = BeginList (hdr, "LIST", "strl");
+    size_t strh = BeginChunk (hdr, "strh");
+    PutFourcc (hdr, "vids");
+    PutFourcc (hdr, "H264");
+    PutLE32 (hdr, 0);                                       // dwFlags
+    PutLE16 (hdr, 0);                                       // wPriority
+    PutLE16 (hdr, 0);                                       // wLanguage
+    PutLE32 (hdr, 0);                                       // dwInitialFrames
+    PutLE32 (hdr, 1000);                                    // dwScale
+    PutLE32 (hdr, rate);                                    // dwRate
+    PutLE32 (hdr, 0);                                       // dwStart
+    m_lengthOffset = hdr.size();
+    PutLE32 (hdr, 0);                                       // dwLength
+    m_strhBufferSizeOffset = hdr.size();
+    PutLE32 (hdr, 0);                                       // dwSuggestedBufferSize
+    PutLE32 (hdr, 0xFFFFFFFF);                              // dwQuality
+    PutLE32 (hdr, 0);                                       // dwSampleSize
+    PutLE16 (hdr, 0);                                       // rcFrame
+    PutLE16 (hdr, 0);
+    PutLE16 (hdr, width);
+    PutLE16 (hdr, height);
+    EndChunk (hdr, strh);
+
+    size_t strf = BeginChunk (hdr, "strf");                 // BITMAPINFOHEADER
+    PutLE32 (hdr, 40);
+    PutLE32 (hdr, width);
+    PutLE32 (hdr, height);
+    PutLE16 (hdr, 1);                                       // biPlanes
+    PutLE16 (hdr, 24);                                      // biBitCount
+    PutFourcc (hdr, "H264");
+    PutLE32 (hdr, width * height * 3);                      // biSizeImage
+    for (int i = 0; i < 4; i++) PutLE32 (hdr, 0);
+    EndChunk (hdr, strf);
+    EndChunk (hdr, strl);
+    EndChunk (hdr, hdrl);
+
+    // The sizes of RIFF and movi are patched once we know them
+    m_moviOffset = BeginList (hdr, "LIST", "movi");
+    (void)riff;
+
+    return put (&hdr[0], hdr.size());
+}
+
+PXL_RETURN_CODE PxLAviWriter::write (U8* pFrame, size_t size, bool key)
+{
+    // Replace the length prefixes with start codes
+    for (size_t pos = 0; pos + 4 <= size; )
+    {
+        const U32 nalSize = (pFrame[pos] << 24) | (pFrame[pos+1] << 16) | (pFrame[pos+2] << 8) | pFrame[pos+3];
+        SetBE32 (&pFrame[pos], 1);
+        pos += 4 + nalSize;
+    }
+
+    if (m_offset + 8 + size + 1 + m_index.size() + 16 + 8 > 0xFFFFFFFFULL) return ApiIOError;
+
+    // idx1 offsets are relative to the 'movi' fourcc
+    PutFourcc (m_index, "00dc");
+    PutLE32 (m_index, key ? AVIIF_KEYFRAME : 0);
+    PutLE32 (m_index, (U32)(m_offset - (m_moviOffset + 8)));
+    PutLE32 (m_index, (U32)size);
+
+    vector<U8> chunk;
+    PutFourcc (chunk, "00dc");
+    PutLE32 (chunk, (U32)size);
+    PXL_RETURN_CODE rc = put (&chunk[0], chunk.size());
+    if (API_SUCCESS (rc)) rc = put (pFrame, size);
+    if (API_SUCCESS (rc) && (size & 1)) rc = put ("", 1);  // chunks are word aligned
+
+    m_frames++;
+    m_maxFrameSize = max (m_maxFrameSize, (U32)size);
+    return rc;
+}
+
+PXL_RETURN_CODE PxLAviWriter::close ()
+{
+    //
+    // Step 1
+    //      The movi list is done; append the index.
+    const U32 moviSize = (U32)(m_offset - m_moviOffset - 8);
+    vector<U8> idx1;
+    PutFourcc (idx1, "idx1");
+    PutLE32 (idx1, (U32)m_index.size());
+    PXL_RETURN_CODE rc = put (&idx1[0], idx1.size());
+    if (API_SUCCESS (rc) && ! m_index.empty()) rc = put (&m_index[0], m_index.size());
+
+    //
+    // Step 2
+    //      Fill in the sizes and counts we did not know when we started.
+    U8 value[4];
+    SetLE32 (value, (U32)(m_offset - 8));
+    if (API_SUCCESS (rc)) rc = patch (4, value, 4);
+    SetLE32 (value, moviSize);
+    if (API_SUCCESS (rc)) rc = patch (m_moviOffset + 4, value, 4);
+    SetLE32 (value, m_frames);
+    if (API_SUCCESS (rc)) rc = patch (m_totalFramesOffset, value, 4);
+    if (API_SUCCESS (rc)) rc = patch (m_lengthOffset, value, 4);
+    SetLE32 (value, m_maxFrameSize);
+    if (API_SUCCESS (rc)) rc = patch (m_avihBufferSizeOffset, value, 4);
+    if (API_SUCCESS (rc)) rc = patch (m_strhBufferSizeOffset, value, 4);
+
+    return rc;
+}
+
+//
+// Fragmented MP4:  ftyp, then a moov with no samples (but with an mvex, so players expect fragments),
+// then a moof + mdat for each fragment.  Each fragment starts with a key frame if it can.
+class PxLMp4Writer : public PxLClipWriter
+{
+public:
+    PxLMp4Writer () : m_sampleDuration(0), m_decodeTime(0), m_sequence(0), m_durationOffset(0) {}
+
+    PXL_RETURN_CODE open (FILE* file, int width, int height, float frameRate, const vector<U8>& sps, const vector<U8>& pps);
+    PXL_RETURN_CODE write (U8* pFrame, size_t size, bool key);
+    PXL_RETURN_CODE close ();
+
+private:
+    PXL_RETURN_CODE flushFragment ();
+
+    static const U32 TIMESCALE = 90000;           // of the track
+    static const U32 MOVIE_TIMESCALE = 1000;
+    static const U32 MAX_FRAGMENT_FRAMES = 60;
+    static const U32 SAMPLE_FLAGS_KEY = 0x02000000;        // depends on no others
+    static const U32 SAMPLE_FLAGS_NON_KEY = 0x01010000;    // depends on others, not a sync sample
+
+    U32        m_sampleDuration;
+    U64        m_decodeTime;        // of the first sample in the current fragment
+    U32        m_sequence;
+    size_t     m_durationOffset;    // of the fragment_duration in mehd
+
+    // The current fragment
+    vector<U8>  m_mdat;
+    vector<U32> m_sampleSizes;
+    vector<U32> m_sampleFlags;
+};
+
+PXL_RETURN_CODE PxLMp4Writer::open (FILE* file, int width, int height, float frameRate, const vector<U8>& sps, const vector<U8>& pps)
+{
+    m_file = file;
+    m_sampleDuration = (U32)((float)TIMESCALE / frameRate + 0.5f);
+
+    static const U32 matrix[9] = {0x00010000, 0, 0, 0, 0x00010000, 0, 0, 0, 0x40000000};
+    vector<U8> hdr;
+    int i;
+
+    size_t ftyp = BeginBox (hdr, "ftyp");
+    PutFourcc (hdr, "isom");
+    PutBE32 (hdr, 0x200);
+    PutFourcc (hdr, "isom");
+    PutFourcc (hdr, "iso5");
+    PutFourcc (hdr, "avc1");
+    PutFourcc (hdr, "mp41");
+    EndBox (hdr, ftyp);
+
+    size_t moov = BeginBox (hdr, "moov");
+    size_t mvhd = BeginFullBox (hdr, "mvhd", 0, 0);
+    PutBE32 (hdr, 0);                       // creation_time
+    PutBE32 (hdr, 0);                       // modification_time
+    PutBE32 (hdr, MOVIE_TIMESCALE);
+    PutBE32 (hdr, 0);                       // duration; see mehd
+    PutBE32 (hdr, 0x00010000);              // rate
+    PutBE16 (hdr, 0x0100);                  // volume
+    PutBE16 (hdr, 0);
+    PutBE32 (hdr, 0);
+    PutBE32 (hdr, 0);
+    for (i = 0; i < 9; i++) PutBE32 (hdr, matrix[i]);
+    for (i = 0; i < 6; i++) PutBE32 (hdr, 0);   // pre_defined
+    PutBE32 (hdr, 2);                       // next_track_ID
+    EndBox (hdr, mvhd);
+
+    size_t trak = BeginBox (hdr, "trak");
+    size_t tkhd = BeginFullBox (hdr, "tkhd", 0, 3);   // enabled, in movie
+    PutBE32 (hdr, 0);
+    PutBE32 (hdr, 0);
+    PutBE32 (hdr, 1);                       // track_ID
+    PutBE32 (hdr, 0);
+    PutBE32 (hdr, 0);                       // duration
+    PutBE32 (hdr, 0);
+    PutBE32 (hdr, 0);
+    PutBE16 (hdr, 0);                       // layer
+    PutBE16 (hdr, 0);                       // alternate_group
+    PutBE16 (hdr, 0);                       // volume
+    PutBE16 (hdr, 0);
+    for (i = 0; i < 9; i++) PutBE32 (hdr, matrix[i]);
+    PutBE32 (hdr, (U32)width << 16);
+    PutBE32 (hdr, (U32)height << 16);
+    EndBox (hdr, tkhd);
+
+    size_t mdia = BeginBox (hdr, "mdia");
+    size_t mdhd = BeginFullBox (hdr, "mdhd", 0, 0);
+    PutBE32 (hdr, 0);
+    PutBE32 (hdr, 0);
+    PutBE32 (hdr, TIMESCALE);
+    PutBE32 (hdr, 0);
+    PutBE16 (hdr, 0x55C4);                  // language 'und'
+    PutBE16 (hdr, 0);
+    EndBox (hdr, mdhd);
+
+    size_t hdlr = BeginFullBox (hdr, "hdlr", 0, 0);
+    PutBE32 (hdr, 0);
+    PutFourcc (hdr, "vide");
+    for (i = 0; i < 3; i++) PutBE32 (hdr, 0);
+    const char handlerName[] = "VideoHandler";
+    hdr.insert (hdr.end(), handlerName, handlerName + sizeof(handlerName));
+    EndBox (hdr, hdlr);
+
+    size_t minf = BeginBox (hdr, "minf");
+    size_t vmhd = BeginFullBox (hdr, "vmhd", 0, 1);
+    PutBE32 (hdr, 0);
+    PutBE32 (hdr, 0);
+    EndBox (hdr, vmhd);
+    size_t dinf = BeginBox (hdr, "dinf");
+    size_t dref = BeginFullBox (hdr, "dref", 0, 0);
+    PutBE32 (hdr, 1);
+    size_t url = BeginFullBox (hdr, "url ", 0, 1);   // media is in this file
+    EndBox (hdr, url);
+    EndBox (hdr, dref);
+    EndBox (hdr, dinf);
+
+    size_t stbl = BeginBox (hdr, "stbl");
+    size_t stsd = BeginFullBox (hdr, "stsd", 0, 0);
+    PutBE32 (hdr, 1);
+    size_t avc1 = BeginBox (hdr, "avc1");
+    for (i = 0; i < 6; i++) hdr.push_back (0);
+    PutBE16 (hdr, 1);                       // data_reference_index
+    for (i = 0; i < 4; i++) PutBE32 (hdr, 0);
+    PutBE16 (hdr, width);
+    PutBE16 (hdr, height);
+    PutBE32 (hdr, 0x00480000);              // 72 dpi
+    PutBE32 (hdr, 0x00480000);
+    PutBE32 (hdr, 0);
+    PutBE16 (hdr, 1);                       // frame_count
+    for (i = 0; i < 32; i++) hdr.push_back (0);   // compressorname
+    PutBE16 (hdr, 0x0018);                  // depth
+    PutBE16 (hdr, 0xFFFF);
+    size_t avcC = BeginBox (hdr, "avcC");
+    hdr.push_back (1);                      // configurationVersion
+    hdr.push_back (sps[1]);                 // profile
+    hdr.push_back (sps[2]);                 // profile compatibility
+    hdr.push_back (sps[3]);                 // level
+    hdr.push_back (0xFF);                   // 4 byte NAL lengths
+    hdr.push_back (0xE1);                   // 1 SPS
+    PutBE16 (hdr, (U32)sps.size());
+    hdr.insert (hdr.end(), sps.begin(), sps.end());
+    hdr.push_back (1);                      // 1 PPS
+    PutBE16 (hdr, (U32)pps.size());
+    hdr.insert (hdr.end(), pps.begin(), pps.end());
+    EndBox (hdr, avcC);
+    EndBox (hdr, avc1);
+    EndBox (hdr, stsd);
+    // The sample tables are empty; the samples are all in the fragments
+    const char* emptyTables[] = {"stts", "stsc", "stco"};
+    for (i = 0; i < 3; i++)
+    {
+        size_t box = BeginFullBox (hdr, emptyTables[i], 0, 0);
+        PutBE32 (hdr, 0);
+        EndBox (hdr, box);
+    }
+    size_t stsz = BeginFullBox (hdr, "stsz", 0, 0);
+    PutBE32 (hdr, 0);
+    PutBE32 (hdr, 0);
+    EndBox (hdr, stsz);
+    EndBox (hdr, stbl);
+    EndBox (hdr, minf);
+    EndBox (hdr, mdia);
+    EndBox (hdr, trak);
+
+    size_t mvex = BeginBox (hdr, "mvex");
+    size_t mehd = BeginFullBox (hdr, "mehd", 1, 0);
+    m_durationOffset = hdr.size();
+    PutBE64 (hdr, 0);                       // fragment_duration; filled in at the end
+    EndBox (hdr, mehd);
+    size_t trex = BeginFullBox (hdr, "trex", 0, 0);
+    PutBE32 (hdr, 1);                       // track_ID
+    PutBE32 (hdr, 1);                       // default_sample_description_index
+    PutBE32 (hdr, m_sampleDuration);
+    PutBE32 (hdr, 0);
+    PutBE32 (hdr, SAMPLE_FLAGS_NON_KEY);
+    EndBox (hdr, trex);
+    EndBox (hdr, mvex);
+    EndBox (hdr, moov);
+
+    return put (&hdr[0], hdr.size());
+}
+
+PXL_RETURN_CODE PxLMp4Writer::write (U8* pFrame, size_t size, bool key)
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    if ((key && ! m_sampleSizes.empty()) || m_sampleSizes.size() >= MAX_FRAGMENT_FRAMES) rc = flushFragment();
+
+    // The parameter sets are in the sample description, so leave them (and delimiters) out of the samples
+    U32 sampleSize = 0;
+    for (size_t pos = 0; pos + 4 <= size; )
+    {
+        const U32 nalSize = (pFrame[pos] << 24) | (pFrame[pos+1] << 16) | (pFrame[pos+2] << 8) | pFrame[pos+3];
+        const U32 nalType = (nalSize > 0 && pos + 4 < size) ? (pFrame[pos+4] & 0x1F) : 0;
+        if (nalType != NAL_SPS && nalType != NAL_PPS && nalType != NAL_AUD)
+        {
+            m_mdat.insert (m_mdat.end(), pFrame + pos, pFrame + pos + 4 + nalSize);
+            sampleSize += 4 + nalSize;
+        }
+        pos += 4 + nalSize;
+    }
+    m_sampleSizes.push_back (sampleSize);
+    m_sampleFlags.push_back (key ? (U32)SAMPLE_FLAGS_KEY : (U32)SAMPLE_FLAGS_NON_KEY);
+
+    return rc;
+}
+
+PXL_RETURN_CODE PxLMp4Writer::flushFragment ()
+{
+    if (m_sampleSizes.empty()) return ApiSuccess;
+
+    vector<U8> moof;
+    size_t box = BeginBox (moof, "moof");
+    size_t mfhd = BeginFullBox (moof, "mfhd", 0, 0);
+    PutBE32 (moof, ++m_sequence);
+    EndBox (moof, mfhd);
+    size_t traf = BeginBox (moof, "traf");
+    size_t tfhd = BeginFullBox (moof, "tfhd", 0, 0x020000);   // default-base-is-moof
+    PutBE32 (moof, 1);
+    EndBox (moof, tfhd);
+    size_t tfdt = BeginFullBox (moof, "tfdt", 1, 0);
+    PutBE64 (moof, m_decodeTime);
+    EndBox (moof, tfdt);
+    size_t trun = BeginFullBox (moof, "trun", 0, 0x000701);   // data offset; sample durations, sizes, flags
+    PutBE32 (moof, (U32)m_sampleSizes.size());
+    size_t dataOffset = moof.size();
+    PutBE32 (moof, 0);
+    for (size_t i = 0; i < m_sampleSizes.size(); i++)
+    {
+        PutBE32 (moof, m_sampleDuration);
+        PutBE32 (moof, m_sampleSizes[i]);
+        PutBE32 (moof, m_sampleFlags[i]);
+    }
+    EndBox (moof, trun);
+    EndBox (moof, traf);
+    EndBox (moof, box);
+    SetBE32 (&moof[dataOffset], (U32)(moof.size() + 8));     // the samples start just past the mdat header
+
+    PutBE32 (moof, (U32)(m_mdat.size() + 8));
+    PutFourcc (moof, "mdat");
+    PXL_RETURN_CODE rc = put (&moof[0], moof.size());
+    if (API_SUCCESS (rc)) rc = put (&m_mdat[0], m_mdat.size());
+    // Make the fragment playable right away
+    if (API_SUCCESS (rc) && fflush (m_file) != 0) rc = ApiIOError;
+
+    m_decodeTime += (U64)m_sampleDuration * m_sampleSizes.size();
+    m_mdat.clear();
+    m_sampleSizes.clear();
+    m_sampleFlags.clear();
+
+    return rc;
+}
+
+PXL_RETURN_CODE PxLMp4Writer::close ()
+{
+    PXL_RETURN_CODE rc = flushFragment ();
+
+    // Now that we know it, fill in the duration
+    vector<U8> duration;
+    PutBE64 (duration, m_decodeTime * MOVIE_TIMESCALE / TIMESCALE);
+    if (API_SUCCESS (rc)) rc = patch (m_durationOffset, &duration[0], duration.size());
+
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Public
+ * ---------------------------------------------------------------------------
+ */
+
+PxLClipMuxStatistics::PxLClipMuxStatistics ()
+: m_frames(0)
+, m_keyFrames(0)
+, m_bytesIn(0)
+, m_bytesOut(0)
+, m_finishTime(0.0)
+{
+}
+
+PxLClipMuxer::PxLClipMuxer ()
+: m_width(0)
+, m_height(0)
+, m_frameRate(0.0f)
+, m_input(MUX_INPUT_FILE)
+, m_inputFd(-1)
+, m_fifoWriterFd(-1)
+, m_inputComplete(false)
+, m_aborted(false)
+, m_completeTime(0.0)
+, m_active(false)
+, m_thread(NULL)
+, m_rc(ApiSuccess)
+, m_writer(NULL)
+, m_file(NULL)
+{
+}
+
+PxLClipMuxer::~PxLClipMuxer ()
+{
+    if (m_active) abort();
+}
+
+PXL_RETURN_CODE PxLClipMuxer::begin (LPCSTR encodedFile, LPCSTR videoFile, ULONG videoFormat,
+                                     int width, int height, float frameRate, CLIP_MUX_INPUT input)
+{
+    if (m_active) return ApiInvalidFunctionCallError;
+    if (NULL == encodedFile || NULL == videoFile || width <= 0 || height <= 0) return ApiInvalidParameterError;
+
+    m_encodedFile = encodedFile;
+    m_videoFile = videoFile;
+    m_width = width;
+    m_height = height;
+    m_frameRate = frameRate > 0.0f ? frameRate : CLIP_PLAYBACK_FRAMERATE_DEFAULT;
+    m_input = input;
+    m_inputComplete = false;
+    m_aborted = false;
+    m_rc = ApiSuccess;
+    m_stats = PxLClipMuxStatistics();
+    m_pending.clear();
+    m_nalStart = m_scanPos = 0;
+    m_haveNal = false;
+    m_accessUnit.clear();
+    m_auHasSlice = m_auKey = false;
+    m_sps.clear();
+    m_pps.clear();
+
+    //
+    // Step 1
+    //      Get rid of any old encoded file, so that we don't follow it rather than the new one.  If we are
+    //      using a FIFO, make it, and open both ends now, so that neither the API nor we block opening it, and
+    //      so that we don't see the end of it until the capture is over.
+    remove (m_encodedFile.c_str());
+    if (m_input == MUX_INPUT_FIFO)
+    {
+        if (mkfifo (m_encodedFile.c_str(), 0600) != 0) return ApiIOError;
+        m_inputFd = ::open (m_encodedFile.c_str(), O_RDONLY | O_NONBLOCK);
+        if (m_inputFd >= 0) m_fifoWriterFd = ::open (m_encodedFile.c_str(), O_WRONLY | O_NONBLOCK);
+        if (m_inputFd < 0 || m_fifoWriterFd < 0)
+        {
+            if (m_inputFd >= 0) ::close (m_inputFd);
+            m_inputFd = -1;
+            remove (m_encodedFile.c_str());
+            return ApiIOError;
+        }
+        fcntl (m_inputFd, F_SETFL, fcntl (m_inputFd, F_GETFL) & ~O_NONBLOCK);
+    }
+
+    //
+    // Step 2
+    //      The video file
+    m_file = fopen (m_videoFile.c_str(), "wb");
+    if (NULL == m_file)
+    {
+        closeFifoWriter();
+        if (m_inputFd >= 0) ::close (m_inputFd);
+        m_inputFd = -1;
+        if (m_input == MUX_INPUT_FIFO) remove (m_encodedFile.c_str());
+        return ApiIOError;
+    }
+    setvbuf (m_file, NULL, _IOFBF, MUX_FILE_BUFFER);
+    if (videoFormat == CLIP_FORMAT_AVI)
+    {
+        m_writer = new PxLAviWriter();
+    } else {
+        m_writer = new PxLMp4Writer();
+    }
+
+    m_active = true;
+    m_thread = g_thread_new ("clipMuxThread", (GThreadFunc)muxThread, this);
+
+    return ApiSuccess;
+}
+
+void PxLClipMuxer::inputComplete ()
+{
+    m_completeTime = PxLLockClock();
+    m_inputComplete = true;
+    closeFifoWriter();
+}
+
+PXL_RETURN_CODE PxLClipMuxer::end ()
+{
+    if (! m_active) return m_rc;
+
+    g_thread_join (m_thread);
+    m_thread = NULL;
+    m_active = false;
+
+    if (m_inputComplete && ! m_aborted) m_stats.m_finishTime = PxLLockClock() - m_completeTime;
+    if (m_input == MUX_INPUT_FIFO) remove (m_encodedFile.c_str());
+
+    return m_rc;
+}
+
+void PxLClipMuxer::abort ()
+{
+    if (! m_active) return;
+
+    m_aborted = true;
+    closeFifoWriter();
+    end();
+}
+
+void PxLClipMuxer::run ()
+{
+    PXL_RETURN_CODE rc = openInput();
+
+    //
+    // Step 1
+    //      Mux frames as they arrive, until the capture is over.
+    if (API_SUCCESS (rc))
+    {
+        vector<U8> buf (MUX_READ_SIZE);
+        int bytesRead;
+        while ((bytesRead = readInput (&buf[0], (int)buf.size())) > 0)
+        {
+            m_stats.m_bytesIn += bytesRead;
+            m_pending.insert (m_pending.end(), buf.begin(), buf.begin() + bytesRead);
+            splitNalUnits (false);
+            if (!API_SUCCESS (m_rc)) break;
+        }
+        if (bytesRead < 0) rc = ApiIOError;
+        ::close (m_inputFd);
+        m_inputFd = -1;
+    }
+
+    //
+    // Step 2
+    //      The last frame ends with the stream; then complete the index.
+    if (API_SUCCESS (rc) && API_SUCCESS (m_rc) && ! m_aborted)
+    {
+        splitNalUnits (true);
+        if (m_auHasSlice) accessUnitComplete();
+        if (API_SUCCESS (m_rc) && 0 == m_stats.m_frames) m_rc = ApiH264InsufficientDataError;
+        if (API_SUCCESS (m_rc)) m_rc = m_writer->close();
+    }
+    if (API_SUCCESS (m_rc)) m_rc = rc;
+    m_stats.m_bytesOut = m_writer->bytesWritten();
+
+    if (fclose (m_file) != 0 && API_SUCCESS (m_rc)) m_rc = ApiIOError;
+    m_file = NULL;
+    delete m_writer;
+    m_writer = NULL;
+    m_pending.clear();
+    m_accessUnit.clear();
+
+    // Don't leave a partial file behind
+    if (m_aborted || !API_SUCCESS (m_rc)) remove (m_videoFile.c_str());
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Private
+ * ---------------------------------------------------------------------------
+ */
+
+PXL_RETURN_CODE PxLClipMuxer::openInput ()
+{
+    if (m_inputFd >= 0) return ApiSuccess;  // The FIFO is already open
+
+    // The API creates the encoded file once it starts capturing
+    while (m_inputFd < 0)
+    {
+        const bool complete = m_inputComplete || m_aborted;
+        m_inputFd = ::open (m_encodedFile.c_str(), O_RDONLY);
+        if (m_inputFd >= 0) break;
+        if (errno != ENOENT || complete) return ApiIOError;
+        usleep (MUX_POLL_INTERVAL);
+    }
+    return ApiSuccess;
+}
+
+// Returns the number of bytes read; 0 once the capture is over and everything has been read, or -1 on error.
+int PxLClipMuxer::readInput (U8* pBuf, int size)
+{
+    for (;;)
+    {
+        // Note whether the capture was done BEFORE we read, so that we don't miss the last of it
+        const bool complete = m_inputComplete || m_aborted;
+        ssize_t bytesRead = read (m_inputFd, pBuf, size);
+        if (bytesRead > 0) return (int)bytesRead;
+        if (bytesRead < 0)
+        {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        // At the end of the data.  For a FIFO, that means the writers are all done.
+        if (m_input == MUX_INPUT_FIFO || complete || m_aborted) return 0;
+        usleep (MUX_POLL_INTERVAL);
+    }
+}
+
+// Finds the NAL units in m_pending.  The last one is only known to be complete at the end of the stream.
+void PxLClipMuxer::splitNalUnits (bool endOfStream)
+{
+    const size_t size = m_pending.size();
+    size_t pos = max (m_scanPos, m_haveNal ? m_nalStart : (size_t)0);
+
+    for (; pos + 3 <= size; pos++)
+    {
+        if (m_pending[pos+2] > 1) {pos += 2; continue;}  // can't be a start code at pos, pos+1 or pos+2
+        if (m_pending[pos] != 0 || m_pending[pos+1] != 0 || m_pending[pos+2] != 1) continue;
+
+        if (m_haveNal)
+        {
+            // Trailing zeros (including the first byte of a 4 byte start code) are not part of the NAL unit
+            size_t nalEnd = pos;
+            while (nalEnd > m_nalStart && m_pending[nalEnd-1] == 0) nalEnd--;
+            if (nalEnd > m_nalStart) nalUnit (&m_pending[m_nalStart], nalEnd - m_nalStart);
+        }
+        m_haveNal = true;
+        m_nalStart = pos + 3;
+        pos += 2;
+    }
+
+    if (endOfStream)
+    {
+        size_t nalEnd = size;
+        while (nalEnd > m_nalStart && m_pending[nalEnd-1] == 0) nalEnd--;
+        if (m_haveNal && nalEnd > m_nalStart) nalUnit (&m_pending[m_nalStart], nalEnd - m_nalStart);
+        m_pending.clear();
+        m_haveNal = false;
+        m_nalStart = m_scanPos = 0;
+        return;
+    }
+
+    // Drop what we have consumed; keep the current NAL unit, and enough to find a start code that spans reads
+    const size_t keep = m_haveNal ? m_nalStart : (size > 2 ? size - 2 : 0);
+    if (keep > 0)
+    {
+        m_pending.erase (m_pending.begin(), m_pending.begin() + keep);
+        if (m_haveNal) m_nalStart = 0;
+    }
+    m_scanPos = m_pending.size() > 2 ? m_pending.size() - 2 : 0;
+}
+
+void PxLClipMuxer::nalUnit (const U8* pNal, size_t size)
+{
+    const U32 type = pNal[0] & 0x1F;
+    const bool slice = (type == NAL_SLICE || type == NAL_SLICE_IDR);
+
+    // Does this NAL unit start a new frame?
+    if (m_auHasSlice)
+    {
+        if (type == NAL_AUD || type == NAL_SPS || type == NAL_PPS || type == NAL_SEI ||
+            (slice && size > 1 && (pNal[1] & 0x80)))  // first_mb_in_slice == 0
+        {
+            accessUnitComplete();
+        }
+    }
+
+    if (type == NAL_SPS) m_sps.assign (pNal, pNal + size);
+    if (type == NAL_PPS) m_pps.assign (pNal, pNal + size);
+
+    PutBE32 (m_accessUnit, (U32)size);
+    m_accessUnit.insert (m_accessUnit.end(), pNal, pNal + size);
+    if (slice) m_auHasSlice = true;
+    if (type == NAL_SLICE_IDR) m_auKey = true;
+}
+
+void PxLClipMuxer::accessUnitComplete ()
+{
+    //
+    // Step 1
+    //      The container can't be started until we have the parameter sets, and a key frame to start
+    //      with.  The encoder always starts with one, so we should never drop anything here.
+    if (API_SUCCESS (m_rc) && m_stats.m_frames == 0 && m_writer->bytesWritten() == 0)
+    {
+        if (m_auKey && m_sps.size() >= 4 && ! m_pps.empty())
+        {
+            m_rc = m_writer->open (m_file, m_width, m_height, m_frameRate, m_sps, m_pps);
+        }
+    }
+
+    //
+    // Step 2
+    //      Write the frame
+    if (API_SUCCESS (m_rc) && m_writer->bytesWritten() > 0)
+    {
+        m_rc = m_writer->write (&m_accessUnit[0], m_accessUnit.size(), m_auKey);
+        m_stats.m_frames++;
+        if (m_auKey) m_stats.m_keyFrames++;
+    }
+
+    m_accessUnit.clear();
+    m_auHasSlice = false;
+    m_auKey = false;
+}
+
+void PxLClipMuxer::closeFifoWriter ()
+{
+    if (m_fifoWriterFd >= 0)
+    {
+        ::close (m_fifoWriterFd);
+        m_fifoWriterFd = -1;
+    }
+}
+
+// The mux thread; it lives for the duration of one clip.
+static void *muxThread (PxLClipMuxer *muxer)
+{
+    muxer->run();
+    return NULL;
+}
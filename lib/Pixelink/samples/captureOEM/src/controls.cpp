@@ -66,6 +66,14 @@ static PXL_RETURN_CODE GetCurrentWhitebalance();
 static void UpdateWhitebalanceControls();
 static const PxLFeaturePollFunctions whitebalanceFuncs (GetCurrentWhitebalance, UpdateWhitebalanceControls);
 
+// What the poll functions last read (they can't use the tab; see featurePoller.h)
+static PxLPolledValue<float> exposurePolled;
+static PxLPolledValue<float> gainPolled;
+static PxLPolledValue<float> frameratePolled;
+static PxLPolledValue<float> framerateActualPolled;
+static PxLPolledValue<bool>  framerateActualSupported;
+static PxLPolledValue<float> redPolled, greenPolled, bluePolled;
+
 /* ---------------------------------------------------------------------------
  * --   Member functions - Public
  * ---------------------------------------------------------------------------
@@ -388,8 +396,7 @@ static PXL_RETURN_CODE GetCurrentExposure()
 {
     PXL_RETURN_CODE rc = ApiSuccess;
 
-    PxLAutoLock lock(&gCameraLock);
-    if (gCamera && gControlsTab)
+    if (gCamera)
     {
         // It's safe to assume the camera supports exposure, as this function will not be called
         // otherwise.  If we were to check via pCamera->supported (FEATURE_EXPOSURE) or
@@ -397,7 +404,11 @@ static PXL_RETURN_CODE GetCurrentExposure()
         // which is a lot of work for not.
         float exposureinSeconds = 0.0;
         rc = gCamera->getValue(FEATURE_EXPOSURE, &exposureinSeconds);
-        if (API_SUCCESS(rc)) gControlsTab->m_exposureLast = exposureinSeconds * 1000;
+        if (API_SUCCESS(rc))
+        {
+            float exposure = exposureinSeconds * 1000;
+            rc = exposurePolled.store (exposure) ? ApiSuccessParametersChanged : ApiSuccess;
+        }
     }
 
     return rc;
@@ -411,6 +422,7 @@ static void UpdateExposureControls()
     {
         PxLAutoLock lock(&gCameraLock);
 
+        gControlsTab->m_exposureLast = exposurePolled.load();
         gControlsTab->m_exposureSlider->setValue(gControlsTab->m_exposureLast);
 
         bool continuousExposureOn = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON( gControlsTab->m_exposureContinous));
@@ -441,6 +453,7 @@ static gboolean FramerateDeactivate (gpointer pData)
     gtk_toggle_button_set_active (GTK_TOGGLE_BUTTON(pControls->m_framerateContinous), false);
 
     pControls->m_cameraSupportsActualFramerate = false;
+    framerateActualSupported.store (false);
 
     if (gCamera)
     {
@@ -520,6 +533,7 @@ static gboolean FramerateActivate (gpointer pData)
     pControls->m_framerateSlider->activate (! continuousCurrentlyOn && ! fixedCurrentlyOn);
 
     pControls->m_cameraSupportsActualFramerate = actualSupported;
+    framerateActualSupported.store (actualSupported);
 
     if (continuousCurrentlyOn)
     {
@@ -536,8 +550,7 @@ static PXL_RETURN_CODE GetCurrentFramerate()
 {
     PXL_RETURN_CODE rc = ApiSuccess;
 
-    PxLAutoLock lock(&gCameraLock);
-    if (gCamera && gControlsTab)
+    if (gCamera)
     {
         // It's safe to assume the camera supports framerate, as this function will not be called
         // otherwise.  If we were to check via pCamera->supported (FEATURE_FRAME_RATE) or
@@ -545,12 +558,13 @@ static PXL_RETURN_CODE GetCurrentFramerate()
         // which is a lot of work for not.
         float framerate = 0.0;
         rc = gCamera->getValue(FEATURE_FRAME_RATE, &framerate);
-        gControlsTab->m_framerateLast = framerate;
-        if (gControlsTab->m_cameraSupportsActualFramerate)
+        bool changed = frameratePolled.store (framerate);
+        if (framerateActualSupported.load())
         {
             rc = gCamera->getValue(FEATURE_ACTUAL_FRAME_RATE, &framerate);
         }
-        gControlsTab->m_framerateActualLast = framerate;
+        changed = framerateActualPolled.store (framerate) || changed;
+        if (API_SUCCESS(rc) && changed) rc = ApiSuccessParametersChanged;
     }
 
     return rc;
@@ -564,6 +578,8 @@ static void UpdateFramerateControls()
     {
         PxLAutoLock lock(&gCameraLock);
 
+        gControlsTab->m_framerateLast = frameratePolled.load();
+        gControlsTab->m_framerateActualLast = framerateActualPolled.load();
         gControlsTab->m_framerateSlider->setValue(gControlsTab->m_framerateLast);
         char cValue[40];
         sprintf (cValue, "%5.3f",gControlsTab->m_framerateActualLast);
@@ -696,8 +712,7 @@ static PXL_RETURN_CODE GetCurrentGain()
 {
     PXL_RETURN_CODE rc = ApiSuccess;
 
-    PxLAutoLock lock(&gCameraLock);
-    if (gCamera && gControlsTab)
+    if (gCamera)
     {
         // It's safe to assume the camera supports gain, as this function will not be called
         // otherwise.  If we were to check via pCamera->supported (FEATURE_GAIN) or
@@ -705,7 +720,10 @@ static PXL_RETURN_CODE GetCurrentGain()
         // which is a lot of work for not.
         float gain = 0.0;
         rc = gCamera->getValue(FEATURE_GAIN, &gain);
-        if (API_SUCCESS(rc)) gControlsTab->m_gainLast = gain;
+        if (API_SUCCESS(rc))
+        {
+            rc = gainPolled.store (gain) ? ApiSuccessParametersChanged : ApiSuccess;
+        }
     }
 
     return rc;
@@ -719,6 +737,7 @@ static void UpdateGainControls()
     {
         PxLAutoLock lock(&gCameraLock);
 
+        gControlsTab->m_gainLast = gainPolled.load();
         gControlsTab->m_gainSlider->setValue(gControlsTab->m_gainLast);
 
         bool continuousGainOn = gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON( gControlsTab->m_gainContinous));
@@ -971,16 +990,16 @@ static PXL_RETURN_CODE GetCurrentWhitebalance()
 {
     PXL_RETURN_CODE rc = ApiSuccess;
 
-    PxLAutoLock lock(&gCameraLock);
-    if (gCamera && gControlsTab)
+    if (gCamera)
     {
         float red, green, blue;
         red = green = blue = 0.0f;
 
         rc = gCamera->getWhiteBalanceValues(&red, &green, &blue);
-        gControlsTab->m_redLast = red;
-        gControlsTab->m_greenLast = green;
-        gControlsTab->m_blueLast = blue;
+        bool changed = redPolled.store (red);
+        changed = greenPolled.store (green) || changed;
+        changed = bluePolled.store (blue) || changed;
+        if (API_SUCCESS(rc) && changed) rc = ApiSuccessParametersChanged;
     }
 
     return rc;
@@ -994,6 +1013,9 @@ static void UpdateWhitebalanceControls()
     {
         PxLAutoLock lock(&gCameraLock);
 
+        gControlsTab->m_redLast = redPolled.load();
+        gControlsTab->m_greenLast = greenPolled.load();
+        gControlsTab->m_blueLast = bluePolled.load();
         gControlsTab->m_redSlider->setValue(gControlsTab->m_redLast);
         gControlsTab->m_greenSlider->setValue(gControlsTab->m_greenLast);
         gControlsTab->m_blueSlider->setValue(gControlsTab->m_blueLast);
@@ -0,0 +1,658 @@
+
+/***************************************************************************
+ *
+ *     File: edges.cpp
+ *
+ *     Description:
+ *       Per-stream state, and the gradient kernels, used by the Sobel (edge)
+ *       filter in CaptureOEM.
+ *
+ *       Each row of the frame is first converted to 16 bit samples (the MS 8
+ *       bits of packed formats, 10 bits of 16 bit formats, and the luminance
+ *       of color formats).  The gradient kernels then compute Gx, Gy and the
+ *       magnitude of a row from three rows of samples, 8 or 16 pixels at a time
+ *       using SSE4.1, AVX2 or NEON when available.  Orientation and non-maximum
+ *       suppression are cheap by comparison, so they are done in plain C.
+ *
+ *       Only three rows of samples (and of magnitudes) are kept, so a frame is
+ *       filtered in place with a single pass over it.  Pixels on the border of
+ *       the frame have no gradient, so are always 0.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <math.h>
+#include <algorithm>
+#include "edges.h"
+#include "filterKernels.h"
+#include "pixelAddress.h"
+#if defined(PXL_X86_KERNELS)
+#include <immintrin.h>
+#elif defined(PXL_NEON_KERNELS)
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+#define DCAM16_TO_TENBIT(x) ((((x) & 0x00FF) << 2) | ((x) >> 14))
+#define TENBIT_TO_DCAM16(x) ((((x) & 0x03FC) >> 2) | ((x) << 14))
+
+// The gain of the Sobel operator; a step of N samples produces a gradient of SOBEL_GAIN * N.
+#define SOBEL_GAIN_SHIFT 2
+
+/* ---------------------------------------------------------------------------
+ * --   Gradient kernels
+ * ---------------------------------------------------------------------------
+ */
+
+//
+// Each kernel computes, for pixels 1 through width-2 of the middle row (p1):
+//      Gx = (p0[x+1] - p0[x-1]) + 2*(p1[x+1] - p1[x-1]) + (p2[x+1] - p2[x-1])
+//      Gy = (p2[x-1] + 2*p2[x] + p2[x+1]) - (p0[x-1] + 2*p0[x] + p0[x+1])
+// and the magnitude, either L1 or L2 (rounded to the nearest integer).  Pixels 0 and width-1 are
+// set to 0.  Samples must be no more than 10 bits, so that everything fits in 16 bits.
+//
+// The vector versions do exactly the same operations (including the float ones, in the same order) as
+// the scalar one, so they give identical results.
+typedef void (*PxLGradientRow) (const S16* p0, const S16* p1, const S16* p2, int width, S16* pMag, S16* pGx, S16* pGy);
+
+template<bool L2>
+static inline void GradientAt (const S16* p0, const S16* p1, const S16* p2, int x, S16* pMag, S16* pGx, S16* pGy)
+{
+    const int gx = (p0[x+1] - p0[x-1]) + 2*(p1[x+1] - p1[x-1]) + (p2[x+1] - p2[x-1]);
+    const int gy = (p2[x-1] + 2*p2[x] + p2[x+1]) - (p0[x-1] + 2*p0[x] + p0[x+1]);
+    pGx[x] = (S16)gx;
+    pGy[x] = (S16)gy;
+    if (L2)
+    {
+        const float fx = (float)gx;
+        const float fy = (float)gy;
+        pMag[x] = (S16)(sqrtf (fx*fx + fy*fy) + 0.5f);
+    } else {
+        pMag[x] = (S16)(abs (gx) + abs (gy));
+    }
+}
+
+static inline void GradientBorders (int width, S16* pMag, S16* pGx, S16* pGy)
+{
+    pMag[0] = pGx[0] = pGy[0] = 0;
+    pMag[width-1] = pGx[width-1] = pGy[width-1] = 0;
+}
+
+template<bool L2>
+static void GradientRow_Scalar (const S16* p0, const S16* p1, const S16* p2, int width, S16* pMag, S16* pGx, S16* pGy)
+{
+    for (int x = 1; x < width-1; x++) GradientAt<L2> (p0, p1, p2, x, pMag, pGx, pGy);
+    GradientBorders (width, pMag, pGx, pGy);
+}
+
+#if defined(PXL_X86_KERNELS)
+template<bool L2>
+PXL_TARGET_SSE41 static void GradientRow_Sse41 (const S16* p0, const S16* p1, const S16* p2, int width, S16* pMag, S16* pGx, S16* pGy)
+{
+    int x = 1;
+    for (; x + 8 <= width-1; x += 8)
+    {
+        const __m128i l0 = _mm_loadu_si128 ((const __m128i*)(p0+x-1));
+        const __m128i c0 = _mm_loadu_si128 ((const __m128i*)(p0+x));
+        const __m128i r0 = _mm_loadu_si128 ((const __m128i*)(p0+x+1));
+        const __m128i l1 = _mm_loadu_si128 ((const __m128i*)(p1+x-1));
+        const __m128i r1 = _mm_loadu_si128 ((const __m128i*)(p1+x+1));
+        const __m128i l2 = _mm_loadu_si128 ((const __m128i*)(p2+x-1));
+        const __m128i c2 = _mm_loadu_si128 ((const __m128i*)(p2+x));
+        const __m128i r2 = _mm_loadu_si128 ((const __m128i*)(p2+x+1));
+
+        const __m128i gx = _mm_add_epi16 (_mm_add_epi16 (_mm_sub_epi16 (r0, l0), _mm_slli_epi16 (_mm_sub_epi16 (r1, l1), 1)),
+                                          _mm_sub_epi16 (r2, l2));
+        const __m128i gy = _mm_sub_epi16 (_mm_add_epi16 (_mm_add_epi16 (l2, _mm_slli_epi16 (c2, 1)), r2),
+                                          _mm_add_epi16 (_mm_add_epi16 (l0, _mm_slli_epi16 (c0, 1)), r0));
+        __m128i mag;
+        if (L2)
+        {
+            const __m128 half = _mm_set1_ps (0.5f);
+            const __m128 fxLo = _mm_cvtepi32_ps (_mm_cvtepi16_epi32 (gx));
+            const __m128 fyLo = _mm_cvtepi32_ps (_mm_cvtepi16_epi32 (gy));
+            const __m128 fxHi = _mm_cvtepi32_ps (_mm_cvtepi16_epi32 (_mm_srli_si128 (gx, 8)));
+            const __m128 fyHi = _mm_cvtepi32_ps (_mm_cvtepi16_epi32 (_mm_srli_si128 (gy, 8)));
+            const __m128i lo = _mm_cvttps_epi32 (_mm_add_ps (_mm_sqrt_ps (_mm_add_ps (_mm_mul_ps (fxLo, fxLo), _mm_mul_ps (fyLo, fyLo))), half));
+            const __m128i hi = _mm_cvttps_epi32 (_mm_add_ps (_mm_sqrt_ps (_mm_add_ps (_mm_mul_ps (fxHi, fxHi), _mm_mul_ps (fyHi, fyHi))), half));
+            mag = _mm_packs_epi32 (lo, hi);
+        } else {
+            mag = _mm_add_epi16 (_mm_abs_epi16 (gx), _mm_abs_epi16 (gy));
+        }
+        _mm_storeu_si128 ((__m128i*)(pGx+x), gx);
+        _mm_storeu_si128 ((__m128i*)(pGy+x), gy);
+        _mm_storeu_si128 ((__m128i*)(pMag+x), mag);
+    }
+    for (; x < width-1; x++) GradientAt<L2> (p0, p1, p2, x, pMag, pGx, pGy);
+    GradientBorders (width, pMag, pGx, pGy);
+}
+
+template<bool L2>
+PXL_TARGET_AVX2 static void GradientRow_Avx2 (const S16* p0, const S16* p1, const S16* p2, int width, S16* pMag, S16* pGx, S16* pGy)
+{
+    int x = 1;
+    for (; x + 16 <= width-1; x += 16)
+    {
+        const __m256i l0 = _mm256_loadu_si256 ((const __m256i*)(p0+x-1));
+        const __m256i c0 = _mm256_loadu_si256 ((const __m256i*)(p0+x));
+        const __m256i r0 = _mm256_loadu_si256 ((const __m256i*)(p0+x+1));
+        const __m256i l1 = _mm256_loadu_si256 ((const __m256i*)(p1+x-1));
+        const __m256i r1 = _mm256_loadu_si256 ((const __m256i*)(p1+x+1));
+        const __m256i l2 = _mm256_loadu_si256 ((const __m256i*)(p2+x-1));
+        const __m256i c2 = _mm256_loadu_si256 ((const __m256i*)(p2+x));
+        const __m256i r2 = _mm256_loadu_si256 ((const __m256i*)(p2+x+1));
+
+        const __m256i gx = _mm256_add_epi16 (_mm256_add_epi16 (_mm256_sub_epi16 (r0, l0), _mm256_slli_epi16 (_mm256_sub_epi16 (r1, l1), 1)),
+                                             _mm256_sub_epi16 (r2, l2));
+        const __m256i gy = _mm256_sub_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (l2, _mm256_slli_epi16 (c2, 1)), r2),
+                                             _mm256_add_epi16 (_mm256_add_epi16 (l0, _mm256_slli_epi16 (c0, 1)), r0));
+        __m256i mag;
+        if (L2)
+        {
+            const __m256 half = _mm256_set1_ps (0.5f);
+            const __m256 fxLo = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm256_castsi256_si128 (gx)));
+            const __m256 fyLo = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm256_castsi256_si128 (gy)));
+            const __m256 fxHi = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm256_extracti128_si256 (gx, 1)));
+            const __m256 fyHi = _mm256_cvtepi32_ps (_mm256_cvtepi16_epi32 (_mm256_extracti128_si256 (gy, 1)));
+            const __m256i lo = _mm256_cvttps_epi32 (_mm256_add_ps (_mm256_sqrt_ps (_mm256_add_ps (_mm256_mul_ps (fxLo, fxLo), _mm256_mul_ps (fyLo, fyLo))), half));
+            const __m256i hi = _mm256_cvttps_epi32 (_mm256_add_ps (_mm256_sqrt_ps (_mm256_add_ps (_mm256_mul_ps (fxHi, fxHi), _mm256_mul_ps (fyHi, fyHi))), half));
+            // The pack works within each 128 bit lane, so put the 64 bit quarters back in order
+            mag = _mm256_permute4x64_epi64 (_mm256_packs_epi32 (lo, hi), 0xD8);
+        } else {
+            mag = _mm256_add_epi16 (_mm256_abs_epi16 (gx), _mm256_abs_epi16 (gy));
+        }
+        _mm256_storeu_si256 ((__m256i*)(pGx+x), gx);
+        _mm256_storeu_si256 ((__m256i*)(pGy+x), gy);
+        _mm256_storeu_si256 ((__m256i*)(pMag+x), mag);
+    }
+    for (; x < width-1; x++) GradientAt<L2> (p0, p1, p2, x, pMag, pGx, pGy);
+    GradientBorders (width, pMag, pGx, pGy);
+}
+#endif
+
+#if defined(PXL_NEON_KERNELS)
+template<bool L2>
+static void GradientRow_Neon (const S16* p0, const S16* p1, const S16* p2, int width, S16* pMag, S16* pGx, S16* pGy)
+{
+    int x = 1;
+    for (; x + 8 <= width-1; x += 8)
+    {
+        const int16x8_t l0 = vld1q_s16 (p0+x-1);
+        const int16x8_t c0 = vld1q_s16 (p0+x);
+        const int16x8_t r0 = vld1q_s16 (p0+x+1);
+        const int16x8_t l1 = vld1q_s16 (p1+x-1);
+        const int16x8_t r1 = vld1q_s16 (p1+x+1);
+        const int16x8_t l2 = vld1q_s16 (p2+x-1);
+        const int16x8_t c2 = vld1q_s16 (p2+x);
+        const int16x8_t r2 = vld1q_s16 (p2+x+1);
+
+        const int16x8_t gx = vaddq_s16 (vaddq_s16 (vsubq_s16 (r0, l0), vshlq_n_s16 (vsubq_s16 (r1, l1), 1)), vsubq_s16 (r2, l2));
+        const int16x8_t gy = vsubq_s16 (vaddq_s16 (vaddq_s16 (l2, vshlq_n_s16 (c2, 1)), r2),
+                                        vaddq_s16 (vaddq_s16 (l0, vshlq_n_s16 (c0, 1)), r0));
+        int16x8_t mag;
+#if defined(__aarch64__)
+        if (L2)
+        {
+            const float32x4_t half = vdupq_n_f32 (0.5f);
+            const float32x4_t fxLo = vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (gx)));
+            const float32x4_t fyLo = vcvtq_f32_s32 (vmovl_s16 (vget_low_s16 (gy)));
+            const float32x4_t fxHi = vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (gx)));
+            const float32x4_t fyHi = vcvtq_f32_s32 (vmovl_s16 (vget_high_s16 (gy)));
+            const int32x4_t lo = vcvtq_s32_f32 (vaddq_f32 (vsqrtq_f32 (vaddq_f32 (vmulq_f32 (fxLo, fxLo), vmulq_f32 (fyLo, fyLo))), half));
+            const int32x4_t hi = vcvtq_s32_f32 (vaddq_f32 (vsqrtq_f32 (vaddq_f32 (vmulq_f32 (fxHi, fxHi), vmulq_f32 (fyHi, fyHi))), half));
+            mag = vcombine_s16 (vmovn_s32 (lo), vmovn_s32 (hi));
+        } else
+#endif
+        {
+            mag = vaddq_s16 (vabsq_s16 (gx), vabsq_s16 (gy));
+        }
+        vst1q_s16 (pGx+x, gx);
+        vst1q_s16 (pGy+x, gy);
+        vst1q_s16 (pMag+x, mag);
+    }
+    for (; x < width-1; x++) GradientAt<L2> (p0, p1, p2, x, pMag, pGx, pGy);
+    GradientBorders (width, pMag, pGx, pGy);
+}
+#endif
+
+// Indexed by PXL_ISA_LEVEL, then by L2.  NULL entries fall back to the level below.
+static const PxLGradientRow s_gradientRows[ISA_COUNT][2] = {
+    { GradientRow_Scalar<false>, GradientRow_Scalar<true> },
+#if defined(PXL_X86_KERNELS)
+    { GradientRow_Sse41<false>,  GradientRow_Sse41<true> },
+    { GradientRow_Avx2<false>,   GradientRow_Avx2<true> },
+#else
+    { NULL,                      NULL },
+    { NULL,                      NULL },
+#endif
+#if defined(PXL_NEON_KERNELS) && defined(__aarch64__)
+    { GradientRow_Neon<false>,   GradientRow_Neon<true> },
+#elif defined(PXL_NEON_KERNELS)
+    { GradientRow_Neon<false>,   NULL },    // No vector square root before ARMv8
+#else
+    { NULL,                      NULL },
+#endif
+};
+
+static PxLGradientRow SelectGradientRow (bool l2)
+{
+    PXL_ISA_LEVEL isa = PxLHostIsa();
+    while (! s_gradientRows[isa][l2]) isa = PxLFallbackIsa (isa);
+    return s_gradientRows[isa][l2];
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Conversion to and from samples
+ * ---------------------------------------------------------------------------
+ */
+
+typedef enum _EDGE_SAMPLE_LAYOUT
+{
+    SAMPLES_8BIT = 0,
+    SAMPLES_DCAM16,                  // Only the 10 MS bits are used
+    SAMPLES_12BIT_PACKED,            // as per Design Notes in callbacks.cpp, we only use the MS 8 bits of
+    SAMPLES_12BIT_PACKED_MSFIRST,    // the packed formats
+    SAMPLES_10BIT_PACKED_MSFIRST,
+    SAMPLES_BGR24,
+    SAMPLES_RGB24,
+    SAMPLES_UNSUPPORTED
+} EDGE_SAMPLE_LAYOUT;
+
+static EDGE_SAMPLE_LAYOUT SampleLayout (U32 pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case PIXEL_FORMAT_MONO8:
+    case PIXEL_FORMAT_BAYER8_BGGR:
+    case PIXEL_FORMAT_BAYER8_GBRG:
+    case PIXEL_FORMAT_BAYER8_GRBG:
+    case PIXEL_FORMAT_BAYER8_RGGB:
+        return SAMPLES_8BIT;
+
+    case PIXEL_FORMAT_MONO16:
+    case PIXEL_FORMAT_BAYER16_BGGR:
+    case PIXEL_FORMAT_BAYER16_GBRG:
+    case PIXEL_FORMAT_BAYER16_GRBG:
+    case PIXEL_FORMAT_BAYER16_RGGB:
+        return SAMPLES_DCAM16;
+
+    case PIXEL_FORMAT_MONO12_PACKED:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+        return SAMPLES_12BIT_PACKED;
+
+    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+        return SAMPLES_12BIT_PACKED_MSFIRST;
+
+    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
+        return SAMPLES_10BIT_PACKED_MSFIRST;
+
+    case PIXEL_FORMAT_RGB24:
+        return SAMPLES_BGR24;
+    case PIXEL_FORMAT_RGB24_NON_DIB:
+        return SAMPLES_RGB24;
+
+    default:
+        return SAMPLES_UNSUPPORTED;
+    }
+}
+
+static int BytesPerRow (EDGE_SAMPLE_LAYOUT layout, int width)
+{
+    switch (layout)
+    {
+    case SAMPLES_DCAM16:               return width * 2;
+    case SAMPLES_12BIT_PACKED:
+    case SAMPLES_12BIT_PACKED_MSFIRST: return width + width/2;
+    case SAMPLES_10BIT_PACKED_MSFIRST: return width + width/4;
+    case SAMPLES_BGR24:
+    case SAMPLES_RGB24:                return width * 3;
+    default:                           return width;
+    }
+}
+
+static void LoadRow (EDGE_SAMPLE_LAYOUT layout, const U8* pRow, int width, S16* pSamples)
+{
+    int x;
+    switch (layout)
+    {
+    case SAMPLES_8BIT:
+        for (x = 0; x < width; x++) pSamples[x] = pRow[x];
+        break;
+    case SAMPLES_DCAM16:
+        for (x = 0; x < width; x++) pSamples[x] = (S16)DCAM16_TO_TENBIT(((const U16*)pRow)[x]);
+        break;
+    case SAMPLES_12BIT_PACKED:
+        for (x = 0; x < width; x++) pSamples[x] = pRow[3*(x/2) + 2*(x&1)];
+        break;
+    case SAMPLES_12BIT_PACKED_MSFIRST:
+        for (x = 0; x < width; x++) pSamples[x] = pRow[3*(x/2) + (x&1)];
+        break;
+    case SAMPLES_10BIT_PACKED_MSFIRST:
+        for (x = 0; x < width; x++) pSamples[x] = pRow[5*(x/4) + (x&3)];
+        break;
+    case SAMPLES_BGR24:
+    case SAMPLES_RGB24:
+        // Green is in the middle either way
+        for (x = 0; x < width; x++, pRow += 3) pSamples[x] = (S16)((pRow[0] + 2*pRow[1] + pRow[2]) >> 2);
+        break;
+    default:
+        break;
+    }
+}
+
+// The LS bits of the packed formats are cleared.
+static void StoreRow (EDGE_SAMPLE_LAYOUT layout, const S16* pSamples, int width, U8* pRow)
+{
+    int x;
+    switch (layout)
+    {
+    case SAMPLES_8BIT:
+        for (x = 0; x < width; x++) pRow[x] = (U8)pSamples[x];
+        break;
+    case SAMPLES_DCAM16:
+        for (x = 0; x < width; x++) ((U16*)pRow)[x] = (U16)TENBIT_TO_DCAM16(pSamples[x]);
+        break;
+    case SAMPLES_12BIT_PACKED:
+    case SAMPLES_12BIT_PACKED_MSFIRST:
+        memset (pRow, 0, BytesPerRow (layout, width));
+        for (x = 0; x < width; x++)
+        {
+            pRow[3*(x/2) + (layout == SAMPLES_12BIT_PACKED ? 2*(x&1) : (x&1))] = (U8)pSamples[x];
+        }
+        break;
+    case SAMPLES_10BIT_PACKED_MSFIRST:
+        memset (pRow, 0, BytesPerRow (layout, width));
+        for (x = 0; x < width; x++) pRow[5*(x/4) + (x&3)] = (U8)pSamples[x];
+        break;
+    case SAMPLES_BGR24:
+    case SAMPLES_RGB24:
+        for (x = 0; x < width; x++, pRow += 3) pRow[0] = pRow[1] = pRow[2] = (U8)pSamples[x];
+        break;
+    default:
+        break;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Orientation and non-maximum suppression
+ * ---------------------------------------------------------------------------
+ */
+
+//
+// Quantizes each gradient, with a magnitude of at least threshold, to the nearest of 4 directions.  The
+// boundaries are at 22.5 and 67.5 degrees:  ay/ax < tan (22.5) = sqrt(2) - 1, is the same as
+// (ax + ay)^2 < 2 * ax^2, which we can test exactly.
+static void Orientations (const S16* pGx, const S16* pGy, const S16* pMag, int width, int threshold, U8* pOrientation)
+{
+    for (int x = 0; x < width; x++)
+    {
+        if (pMag[x] < threshold || pMag[x] == 0)
+        {
+            pOrientation[x] = PxLEdgeResult::ORIENTATION_NONE;
+            continue;
+        }
+        const int ax = abs (pGx[x]);
+        const int ay = abs (pGy[x]);
+        const int sumSquared = (ax + ay) * (ax + ay);
+        if (sumSquared < 2 * ax * ax) {
+            pOrientation[x] = PxLEdgeResult::ORIENTATION_0;
+        } else if (sumSquared < 2 * ay * ay) {
+            pOrientation[x] = PxLEdgeResult::ORIENTATION_90;
+        } else {
+            pOrientation[x] = ((pGx[x] ^ pGy[x]) >= 0) ? PxLEdgeResult::ORIENTATION_45 : PxLEdgeResult::ORIENTATION_135;
+        }
+    }
+}
+
+//
+// A pixel is an edge if its magnitude is at least the threshold (it has an orientation), and it is a maximum
+// along its gradient direction.  Ties are broken towards the first neighbour, so that a plateau two pixels
+// wide yields a single edge.  Edge pixels keep their magnitude; all others become 0.
+static U32 SuppressNonMaxima (const S16* pPrev, const S16* pThis, const S16* pNext, const U8* pOrientation,
+                              int width, S16* pEdges)
+{
+    U32 edges = 0;
+    pEdges[0] = pEdges[width-1] = 0;
+    for (int x = 1; x < width-1; x++)
+    {
+        const S16 mag = pThis[x];
+        S16 before, after;
+        switch (pOrientation[x])
+        {
+        case PxLEdgeResult::ORIENTATION_0:   before = pThis[x-1]; after = pThis[x+1]; break;
+        case PxLEdgeResult::ORIENTATION_90:  before = pPrev[x];   after = pNext[x];   break;
+        case PxLEdgeResult::ORIENTATION_45:  before = pPrev[x-1]; after = pNext[x+1]; break;
+        case PxLEdgeResult::ORIENTATION_135: before = pPrev[x+1]; after = pNext[x-1]; break;
+        default:
+            pEdges[x] = 0;
+            continue;
+        }
+        if (mag > before && mag >= after)
+        {
+            pEdges[x] = mag;
+            edges++;
+        } else {
+            pEdges[x] = 0;
+        }
+    }
+    return edges;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Public
+ * ---------------------------------------------------------------------------
+ */
+
+PxLEdgeState::PxLEdgeState ()
+: m_norm(NORM_L1)
+, m_threshold(DEFAULT_EDGE_THRESHOLD)
+, m_thin(0)
+, m_orientation(0)
+, m_publish(0)
+, m_haveResult(false)
+{
+    pthread_mutex_init (&m_resultLock, NULL);
+}
+
+PxLEdgeState::~PxLEdgeState ()
+{
+    pthread_mutex_destroy (&m_resultLock);
+}
+
+void PxLEdgeState::setNorm (MAGNITUDE_NORM norm)
+{
+    m_norm = norm;
+}
+
+void PxLEdgeState::setThreshold (U8 threshold)
+{
+    m_threshold = threshold;
+}
+
+void PxLEdgeState::setThinning (bool thin)
+{
+    m_thin = thin;
+}
+
+void PxLEdgeState::setOrientation (bool orientation)
+{
+    m_orientation = orientation;
+}
+
+void PxLEdgeState::setPublish (bool publish)
+{
+    m_publish = publish;
+}
+
+PXL_RETURN_CODE PxLEdgeState::sobelFilter (void* pFrameData, U32 pixelFormat, FRAME_DESC const * pFrameDesc, PxLScratchArena& arena)
+{
+    const EDGE_SAMPLE_LAYOUT layout = SampleLayout (pixelFormat);
+    if (layout == SAMPLES_UNSUPPORTED) return ApiInvalidParameterError;
+
+    const int decX = static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal);
+    const int decY = static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical);
+    const int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
+    const int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
+    if (width < 3 || height < 3) return ApiSuccess;
+
+    // Read the options just once, so that they are consistent for the whole frame.
+    const bool thin = m_thin != 0;
+    const bool publishing = m_publish != 0;
+    const bool orientation = thin || (publishing && m_orientation);
+    const PxLGradientRow gradientRow = SelectGradientRow (m_norm == NORM_L2);
+
+    // Samples are 8 bits, other than the 16 bit formats (which are 10).  The output is the magnitude
+    // divided by the Sobel gain, saturated to the sample size.
+    const int sampleBits = (layout == SAMPLES_DCAM16) ? 10 : 8;
+    const S16 sampleMax = (S16)((1 << sampleBits) - 1);
+    const int threshold = (int)m_threshold << (sampleBits - 8 + SOBEL_GAIN_SHIFT);
+    const int bytesPerRow = BytesPerRow (layout, width);
+
+    // RGB24 (DIB) frames are 'bottom up'; published maps are always top down.
+    const bool bottomUp = (pixelFormat == PIXEL_FORMAT_RGB24);
+
+    if (publishing)
+    {
+        const size_t pixels = (size_t)width * height;
+        m_pending.m_width = width;
+        m_pending.m_height = height;
+        m_pending.m_magnitude.resize (pixels);
+        m_pending.m_orientation.resize (orientation && m_orientation ? pixels : 0);
+        m_pending.m_edges.resize (thin ? pixels : 0);
+        m_pending.m_edgeCount = 0;
+    }
+
+    // The rolling windows:  three rows of samples, magnitudes and orientations, indexed by row % 3.
+    S16* samples[3];
+    S16* mags[3];
+    U8*  orientations[3];
+    for (int i = 0; i < 3; i++)
+    {
+        samples[i] = arena.allocArray<S16>(width);
+        mags[i] = arena.allocArray<S16>(width);
+        orientations[i] = arena.allocArray<U8>(width);
+    }
+    S16* pGx = arena.allocArray<S16>(width);
+    S16* pGy = arena.allocArray<S16>(width);
+    S16* pOut = arena.allocArray<S16>(width);
+    if (! pOut) return ApiOutOfMemoryError;
+
+    U8* pFrame = static_cast<U8*>(pFrameData);
+    LoadRow (layout, pFrame, width, samples[0]);
+    LoadRow (layout, pFrame + bytesPerRow, width, samples[1]);
+    memset (mags[0], 0, width * sizeof(S16));
+    memset (orientations[0], PxLEdgeResult::ORIENTATION_NONE, width);
+
+    //
+    // Each time through, compute the gradient of row y, and then write row y-1 -- the last row that will not
+    // be needed for any more gradients (and, with thinning, that has the magnitudes of both of its neighbours).
+    // Row y-1 of the frame can be overwritten, as its samples are already in the window.
+    for (int y = 1; y <= height; y++)
+    {
+        if (y < height)
+        {
+            S16* pMag = mags[y % 3];
+            U8*  pOrientation = orientations[y % 3];
+            if (y < height-1)
+            {
+                LoadRow (layout, pFrame + (y+1)*bytesPerRow, width, samples[(y+1) % 3]);
+                gradientRow (samples[(y-1) % 3], samples[y % 3], samples[(y+1) % 3], width, pMag, pGx, pGy);
+                if (orientation) Orientations (pGx, pGy, pMag, width, threshold, pOrientation);
+            } else {
+                // The bottom row has no gradient
+                memset (pMag, 0, width * sizeof(S16));
+                memset (pOrientation, PxLEdgeResult::ORIENTATION_NONE, width);
+            }
+        }
+
+        const int row = y - 1;
+        const S16* pRowMag = mags[row % 3];
+        const U8*  pRowOrientation = orientations[row % 3];
+        U32 rowEdges = 0;
+        if (thin && row > 0 && row < height-1)
+        {
+            rowEdges = SuppressNonMaxima (mags[(row-1) % 3], pRowMag, mags[(row+1) % 3], pRowOrientation, width, pOut);
+        } else if (thin) {
+            memset (pOut, 0, width * sizeof(S16));
+        } else {
+            memcpy (pOut, pRowMag, width * sizeof(S16));
+        }
+
+        if (publishing)
+        {
+            const int imageRow = bottomUp ? height - 1 - row : row;
+            U8* pMagnitude = &m_pending.m_magnitude[(size_t)imageRow * width];
+            const int magShift = sampleBits - 8 + SOBEL_GAIN_SHIFT;
+            for (int x = 0; x < width; x++) pMagnitude[x] = (U8)min (pRowMag[x] >> magShift, 255);
+            if (! m_pending.m_orientation.empty())
+            {
+                U8* pDest = &m_pending.m_orientation[(size_t)imageRow * width];
+                memcpy (pDest, pRowOrientation, width);
+                // Flipping the image vertically flips the diagonals too
+                if (bottomUp)
+                {
+                    for (int x = 0; x < width; x++)
+                    {
+                        if (pDest[x] == PxLEdgeResult::ORIENTATION_45) pDest[x] = PxLEdgeResult::ORIENTATION_135;
+                        else if (pDest[x] == PxLEdgeResult::ORIENTATION_135) pDest[x] = PxLEdgeResult::ORIENTATION_45;
+                    }
+                }
+            }
+            if (thin)
+            {
+                U8* pDest = &m_pending.m_edges[(size_t)imageRow * width];
+                for (int x = 0; x < width; x++) pDest[x] = pOut[x] ? 0xFF : 0x00;
+                m_pending.m_edgeCount += rowEdges;
+            }
+        }
+
+        for (int x = 0; x < width; x++) pOut[x] = min ((S16)(pOut[x] >> SOBEL_GAIN_SHIFT), sampleMax);
+        StoreRow (layout, pOut, width, pFrame + row*bytesPerRow);
+    }
+
+    if (publishing) publish (pFrameDesc->uFrameNumber);
+
+    return ApiSuccess;
+}
+
+bool PxLEdgeState::getEdges (PxLEdgeResult& result)
+{
+    pthread_mutex_lock (&m_resultLock);
+    const bool haveResult = m_haveResult;
+    if (haveResult) result = m_result;
+    pthread_mutex_unlock (&m_resultLock);
+    return haveResult;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Private
+ * ---------------------------------------------------------------------------
+ */
+
+void PxLEdgeState::publish (U32 frameNumber)
+{
+    m_pending.m_frameNumber = frameNumber;
+
+    pthread_mutex_lock (&m_resultLock);
+    swap (m_result.m_frameNumber, m_pending.m_frameNumber);
+    swap (m_result.m_width, m_pending.m_width);
+    swap (m_result.m_height, m_pending.m_height);
+    m_result.m_magnitude.swap (m_pending.m_magnitude);
+    m_result.m_orientation.swap (m_pending.m_orientation);
+    m_result.m_edges.swap (m_pending.m_edges);
+    swap (m_result.m_edgeCount, m_pending.m_edgeCount);
+    m_haveResult = true;
+    pthread_mutex_unlock (&m_resultLock);
+}
@@ -17,6 +17,7 @@
 
 #include <gtk/gtk.h>
 #include <stdlib.h>
+#include <stdio.h>
 #include <algorithm>
 #include "featurePoller.h"
 #include "camera.h"
@@ -39,13 +40,29 @@ bool PxLFeaturePollFunctions::operator==(const PxLFeaturePollFunctions& func)
             func.m_updateControls == m_updateControls);
 }
 
+PxLPollStatistics::PxLPollStatistics ()
+: m_polls(0)
+, m_updates(0)
+, m_lastReads(0)
+, m_lastDuration(0.0)
+, m_totalDuration(0.0)
+, m_maxDuration(0.0)
+, m_interval(0)
+{}
+
 
 // updateInterval is the number of milliseconds between each update of the features being polled
-PxLFeaturePoller::PxLFeaturePoller (ULONG updateInterval)
-: m_pollThreadRunning(false)
+PxLFeaturePoller::PxLFeaturePoller (PxLCamera* pCamera, ULONG updateInterval)
+: m_pCamera(pCamera)
+, m_backoff(1)
+, m_pollSoon(false)
+, m_updatePending(false)
+, m_pollThreadRunning(false)
 {
     m_pollList.clear();
     m_pollsPerUpdate = updateInterval / m_pollInterval;
+    m_reportStatistics = getenv ("PXL_POLL_STATS") != NULL;
+    m_statistics.m_interval = m_pollsPerUpdate * m_pollInterval;
 
 	m_pollThreadRunning = true;
 	m_pollThread = g_thread_new ("featurePollThread", (GThreadFunc)pollThread, this);
@@ -65,21 +82,21 @@ PxLFeaturePoller::~PxLFeaturePoller ()
 
 void PxLFeaturePoller::pollAdd (const PxLFeaturePollFunctions& functions)    // Add a feature to the poll list
 {
-    // Even though we don't do any camera operations, we need a mutex to ensure the various poll operations are
-    // thread safe.  Introducing another mutex runs the risk of deadlock, so use the existing mutex
-    PxLAutoLock lock(&gCameraLock);
+    PxLAutoMutex lock(&m_lock);
 
     // Don't add this one if has already been added
     if (find (m_pollList.begin(), m_pollList.end(), functions) !=  m_pollList.end()) return;
     m_pollList.push_back (functions);
 
+    // The new feature is likely to change, so start polling quickly again
+    m_backoff = 1;
+    m_pollSoon = true;
+
 }
 
 void PxLFeaturePoller::pollRemove (const PxLFeaturePollFunctions& functions)    // Remove a feature from the poll list
 {
-    // Even though we don't do any camera operations, we need a mutex to ensure the various poll operations are
-    // thread safe.  Introducing another mutex runs the risk of deadlock, so use the existing mutex
-    PxLAutoLock lock(&gCameraLock);
+    PxLAutoMutex lock(&m_lock);
 
     vector<PxLFeaturePollFunctions>::iterator it;
 
@@ -91,65 +108,132 @@ void PxLFeaturePoller::pollRemove (const PxLFeaturePollFunctions& functions)
 
 bool PxLFeaturePoller::polling (const PxLFeaturePollFunctions& functions) // are we polling thi feature??
 {
+    PxLAutoMutex lock(&m_lock);
+
     return (find (m_pollList.begin(), m_pollList.end(), functions) !=  m_pollList.end());
 }
 
+PxLPollStatistics PxLFeaturePoller::statistics ()
+{
+    // The statistics are only updated by the poll thread while it holds the lock
+    PxLAutoMutex lock(&m_lock);
+
+    return m_statistics;
+}
+
 
 static gboolean updateFeatureControls (gpointer pData)
 {
-    // Even though we don't do any camera operations, we need a mutex to ensure the various poll operations are
-    // thread safe.  Introducing another mutex runs the risk of deadlock, so use the existing mutex
+    // The update functions work with the GUI, and with gCamera, so they need gCameraLock.  Note that
+    // the lock order is always gCameraLock, then the poller's lock -- the poll thread never takes gCameraLock.
     PxLAutoLock lock(&gCameraLock);
 
-    // Bugzilla.1335 -- Don't need to update the controls if the camera is gone.
-    if (! gCamera) return false;
-
     PxLFeaturePoller *poller = (PxLFeaturePoller *)pData;
-    vector<PxLFeaturePollFunctions>::iterator it;
+
+    // Bugzilla.1335 -- Don't need to update the controls if the camera is gone.
+    if (! gCamera || gCamera->m_poller != poller) return false;
 
     // update the controls for each of the features.  Note that calling updateControls
-    // will remove the item if it's no longer needed, so we need to be careful to
-    // not miss any
-    int numFuncsPrev = poller->m_pollList.size();
-    int numFuncsNow  = numFuncsPrev;
-    for (int i = 0; i < numFuncsNow; )
+    // will remove the item if it's no longer needed, so work from a copy of the list.
+    vector<PxLFeaturePollFunctions> pollList;
+    {
+        PxLAutoMutex pollLock(&poller->m_lock);
+        poller->m_updatePending = false; // Any changes from now on need another update
+        pollList = poller->m_pollList;
+    }
+    vector<PxLFeaturePollFunctions>::iterator it;
+    for (it = pollList.begin(); it != pollList.end(); it++)
     {
-        (poller->m_pollList[i].m_updateControls)();
-        numFuncsNow = poller->m_pollList.size();
-        if (numFuncsNow == numFuncsPrev) i++;
-        numFuncsPrev = numFuncsNow;
+        (it->m_updateControls)();
     }
 
     return false;  //  Only run once....
 }
 
+//
+// Poll each of the features once, and update the controls if need be.
+static void pollFeatures (PxLFeaturePoller *poller)
+{
+    vector<PxLFeaturePollFunctions>::iterator it;
+
+    // Work from a copy of the poll list, so that no lock is held while the features are read.  The camera
+    // serializes the reads itself, using its feature lock; a poll does not hold off the GUI, or the stream.
+    vector<PxLFeaturePollFunctions> pollList;
+    bool forceUpdate;
+    {
+        PxLAutoMutex lock(&poller->m_lock);
+        forceUpdate = poller->m_pollSoon;
+        poller->m_pollSoon = false;
+        if (poller->m_pollList.empty())
+        {
+            poller->m_backoff = 1;
+            return;
+        }
+        pollList = poller->m_pollList;
+    }
+
+    // Get each of the feature values
+    double pollStart = PxLLockClock();
+    bool changed = false;
+    U32  numReads = 0;
+    for (it = pollList.begin(); it != pollList.end(); it++, numReads++)
+    {
+        if ((*it->m_pollFeature)() == ApiSuccessParametersChanged) changed = true;
+    }
+    double pollDuration = PxLLockClock() - pollStart;
+
+    PxLAutoMutex lock(&poller->m_lock);
+
+    // Only update the controls if something changed (or if we have backed off as far as we go)
+    bool update = changed || forceUpdate || poller->m_backoff >= PxLFeaturePoller::m_maxBackoff;
+    if (update && !poller->m_updatePending)
+    {
+        poller->m_updatePending = true;
+        gdk_threads_add_idle ((GSourceFunc)updateFeatureControls, poller);
+    }
+
+    if (changed)
+    {
+        poller->m_backoff = 1;
+    } else if (poller->m_backoff < PxLFeaturePoller::m_maxBackoff) {
+        poller->m_backoff *= 2;
+    }
+
+    // Account for the cost of this poll
+    PxLPollStatistics& stats = poller->m_statistics;
+    stats.m_polls++;
+    if (update) stats.m_updates++;
+    stats.m_lastReads = numReads;
+    stats.m_lastDuration = pollDuration;
+    stats.m_totalDuration += stats.m_lastDuration;
+    stats.m_maxDuration = max (stats.m_maxDuration, stats.m_lastDuration);
+    stats.m_interval = poller->m_pollsPerUpdate * poller->m_backoff * PxLFeaturePoller::m_pollInterval;
+    if (poller->m_reportStatistics)
+    {
+        // Along with the cost of the poll, report how often the stream was held up by other camera operations
+        PxLCameraLockStatistics lockStats = poller->m_pCamera->lockStatistics();
+        printf ("Poll %u: %u reads in %.2f ms (avg %.2f, max %.2f), %s, next in %u ms; "
+                "feature reads waited %u/%u, stream lock waited %u/%u (max %.2f ms)\n",
+                stats.m_polls, stats.m_lastReads,
+                stats.m_lastDuration * 1000.0, stats.m_totalDuration * 1000.0 / stats.m_polls,
+                stats.m_maxDuration * 1000.0,
+                changed ? "changed" : "unchanged", (U32)stats.m_interval,
+                lockStats.m_featureReads.m_contentions, lockStats.m_featureReads.m_acquisitions,
+                lockStats.m_stream.m_contentions, lockStats.m_stream.m_acquisitions,
+                lockStats.m_stream.m_maxWait * 1000.0);
+    }
+}
+
 // thread to periodically poll the active cameras, getting specified features values so the controls
 // can be updated..
 static void *pollThread (PxLFeaturePoller *poller)
 {
-    vector<PxLFeaturePollFunctions>::iterator it;
-
     for (ULONG i = 0; poller->m_pollThreadRunning; i++)
     {
+        if (i >= poller->m_pollsPerUpdate * poller->m_backoff || poller->m_pollSoon)
         {
-            // Even though we don't do any camera operations, we need a mutex to ensure the various poll operations are
-            // thread safe.  Introducing another mutex runs the risk of deadlock, so use the existing mutex
-            PxLAutoLock lock(&gCameraLock);
-            if (i >= poller->m_pollsPerUpdate)
-            {
-                i = 0; // restart our poll count
-
-                // Get each of the feature values
-                for (it = poller->m_pollList.begin(); it != poller->m_pollList.end(); it++)
-                {
-                    if (poller->m_pollList.empty()) break;
-                    (*it->m_pollFeature)();
-                }
-                if (!poller->m_pollList.empty())
-                {
-                    gdk_threads_add_idle ((GSourceFunc)updateFeatureControls, poller);
-                }
-            }
+            i = 0; // restart our poll count
+            pollFeatures (poller);
         }
 
         usleep (poller->m_pollInterval*1000);  // stall for a bit -- but convert ms to us
@@ -157,7 +241,3 @@ static void *pollThread (PxLFeaturePoller *poller)
 
     return NULL;
 }
-
-
-
-
@@ -7,6 +7,8 @@
  */
 
 #include <string>
+#include <stdlib.h>
+#include <algorithm>
 #include "filter.h"
 #include "camera.h"
 #include "captureOEM.h"
@@ -26,21 +28,7 @@ extern PxLFilter      *gFilterTab;
 static gboolean  RefreshComplete (gpointer pData);
 static gboolean  FilterDeactivate (gpointer pData);
 static gboolean  FilterActivate (gpointer pData);
-
-extern PXLAPI_CALLBACK (PxLCallbackNegative);
-extern PXLAPI_CALLBACK (PxLCallbackGrayscale);
-extern PXLAPI_CALLBACK (PxLCallbackHistogramEqualization);
-extern PXLAPI_CALLBACK (PxLCallbackSaturatedAndBlack);
-extern PXLAPI_CALLBACK (PxLCallbackTreshold50Percent);
-extern PXLAPI_CALLBACK (PxLCallbackLowPass);
-extern PXLAPI_CALLBACK (PxLCallbackMedian);
-extern PXLAPI_CALLBACK (PxLCallbackHighPass);
-extern PXLAPI_CALLBACK (PxLCallbackSobel);
-extern PXLAPI_CALLBACK (PxLCallbackTemporalTheshold);
-extern PXLAPI_CALLBACK (PxLCallbackMotionDetector);
-extern PXLAPI_CALLBACK (PxLCallbackAscii);
-extern PXLAPI_CALLBACK (PxLCallbackBitmapOverlay);
-extern PXLAPI_CALLBACK (PxLCallbackCrosshairOverlay);
+static void      ShowTemporalOptions (PxLFilter* pFilter);
 
 // Indexed by PxLFilter::PREVIEW_FILTERS
 static PxLApiCallback Callbacks[] =
@@ -77,6 +65,9 @@ PxLFilter::PxLFilter (GtkBuilder *builder)
     m_filterWarning = GTK_WIDGET( gtk_builder_get_object( builder, "FilterDesc_Label" ) );
     m_filterLocation = GTK_WIDGET( gtk_builder_get_object( builder, "FilterLocation_Text" ) );
     m_filterLocationBrowser = GTK_WIDGET( gtk_builder_get_object( builder, "FilterLocation_Button" ) );
+    m_noiseFloor = GTK_WIDGET( gtk_builder_get_object( builder, "FilterNoiseFloor_Text" ) );
+    m_motionThreshold = GTK_WIDGET( gtk_builder_get_object( builder, "FilterMotionThreshold_Text" ) );
+    m_blockPercent = GTK_WIDGET( gtk_builder_get_object( builder, "FilterBlockPercent_Text" ) );
 
     //
     // Step 2
@@ -107,6 +98,11 @@ PxLFilter::PxLFilter (GtkBuilder *builder)
     gtk_file_chooser_set_current_folder (GTK_FILE_CHOOSER(m_filterLocationBrowser),
                                          bitmapFolder);
     g_free(bitmapFolder);
+
+    //
+    // Step 4
+    //  And, the temporal filters' defaults
+    ShowTemporalOptions (this);
 }
 
 
@@ -179,6 +175,9 @@ static gboolean FilterDeactivate (gpointer pData)
 
     gtk_widget_set_sensitive (pFilter->m_previewFilter, false);
     gtk_widget_set_sensitive (pFilter->m_filterLocationBrowser, false);
+    gtk_widget_set_sensitive (pFilter->m_noiseFloor, false);
+    gtk_widget_set_sensitive (pFilter->m_motionThreshold, false);
+    gtk_widget_set_sensitive (pFilter->m_blockPercent, false);
 
     // The camera is 'gone', and any callback has been canceled.  Represent this
     // in the dropdown.
@@ -189,6 +188,7 @@ static gboolean FilterDeactivate (gpointer pData)
     {
         SDL_FreeSurface (pFilter->m_bitmapOverlay);
         pFilter->m_bitmapOverlay = NULL;
+        pFilter->m_filterStream.m_bitmapOverlay = NULL;
     }
 
     gtk_label_set_text (GTK_LABEL (pFilter->m_filterWarning), " ");
@@ -206,6 +206,10 @@ static gboolean FilterActivate (gpointer pData)
     if (gCamera)
     {
         gtk_widget_set_sensitive (pFilter->m_previewFilter, true);
+        gtk_widget_set_sensitive (pFilter->m_noiseFloor, true);
+        gtk_widget_set_sensitive (pFilter->m_motionThreshold, true);
+        gtk_widget_set_sensitive (pFilter->m_blockPercent, true);
+        ShowTemporalOptions (pFilter);
 
         // Only activate the bitmap overlay controls if the user has selected the bitmap overlay
         int callbackSelected = gtk_combo_box_get_active (GTK_COMBO_BOX(pFilter->m_previewFilter));
@@ -228,6 +232,20 @@ static gboolean FilterActivate (gpointer pData)
     return false;  //  Only run once....
 }
 
+//
+// Show the options the temporal filters are using
+static void ShowTemporalOptions (PxLFilter* pFilter)
+{
+    char cValue[40];
+
+    sprintf (cValue, "%d", pFilter->m_filterStream.m_temporalState.noiseFloor());
+    gtk_entry_set_text (GTK_ENTRY (pFilter->m_noiseFloor), cValue);
+    sprintf (cValue, "%d", pFilter->m_filterStream.m_motionState.noiseFloor());
+    gtk_entry_set_text (GTK_ENTRY (pFilter->m_motionThreshold), cValue);
+    sprintf (cValue, "%d", pFilter->m_filterStream.m_motionState.blockPercent());
+    gtk_entry_set_text (GTK_ENTRY (pFilter->m_blockPercent), cValue);
+}
+
 /* ---------------------------------------------------------------------------
  * --   Control functions from the Glade project
  * ---------------------------------------------------------------------------
@@ -267,8 +285,13 @@ extern "C" void NewPreviewFilterSelected
 
         gtk_widget_set_sensitive (gFilterTab->m_filterLocationBrowser, bitmapOverlay);
 
+        // A newly selected temporal filter should not compare against frames from some earlier stream
+        gFilterTab->m_filterStream.m_temporalState.requestReset();
+        gFilterTab->m_filterStream.m_motionState.requestReset();
+        gFilterTab->m_filterStream.m_bitmapOverlay = gFilterTab->m_bitmapOverlay;
+
         // And finally, set the callback (which may actually cancel the callback if NULL were specified).
-        gCamera->setPreviewCallback (Callbacks[callbackSelected], gFilterTab->m_bitmapOverlay);
+        gCamera->setPreviewCallback (Callbacks[callbackSelected], &gFilterTab->m_filterStream);
     }
 }
 
@@ -279,3 +302,37 @@ extern "C" void NewPreviewLocation
     // user selected bitmap overaly as the new filter.
     NewPreviewFilterSelected (widget, event, userdata);
 }
+
+//
+// The temporal filters' options take effect on the next frame; they don't need the callback to be set again.
+extern "C" void FilterNoiseFloorChanged
+    (GtkWidget* widget, GdkEventExpose* event, gpointer userdata )
+{
+    if (! gFilterTab) return;
+    if (gFilterTab->m_refreshRequired) return;
+
+    int noiseFloor = atoi (gtk_entry_get_text (GTK_ENTRY (gFilterTab->m_noiseFloor)));
+    gFilterTab->m_filterStream.m_temporalState.setNoiseFloor ((U8)min (255, max (0, noiseFloor)));
+    ShowTemporalOptions (gFilterTab);
+}
+
+extern "C" void FilterMotionThresholdChanged
+    (GtkWidget* widget, GdkEventExpose* event, gpointer userdata )
+{
+    if (! gFilterTab) return;
+    if (gFilterTab->m_refreshRequired) return;
+
+    int threshold = atoi (gtk_entry_get_text (GTK_ENTRY (gFilterTab->m_motionThreshold)));
+    gFilterTab->m_filterStream.m_motionState.setNoiseFloor ((U8)min (255, max (0, threshold)));
+    ShowTemporalOptions (gFilterTab);
+}
+
+extern "C" void FilterBlockPercentChanged
+    (GtkWidget* widget, GdkEventExpose* event, gpointer userdata )
+{
+    if (! gFilterTab) return;
+    if (gFilterTab->m_refreshRequired) return;
+
+    gFilterTab->m_filterStream.m_motionState.setBlockPercent (atoi (gtk_entry_get_text (GTK_ENTRY (gFilterTab->m_blockPercent))));
+    ShowTemporalOptions (gFilterTab);
+}
@@ -0,0 +1,542 @@
+
+/***************************************************************************
+ *
+ *     File: filterKernels.cpp
+ *
+ *     Description:
+ *       The kernels used by the 'per pixel' preview filters in CaptureOEM, and
+ *       the run time selection of them.
+ *
+ *       Each filter is described by an 'Op' class, that knows how to filter
+ *       one sample (or pixel) using plain C, and many samples (or pixels) at
+ *       once using each of the instruction sets we support.  The kernel
+ *       templates then specialize these for each of the pixel layouts.  All of
+ *       the specializations must give exactly the same results as the plain C
+ *       versions.
+ *
+ *       The x86 kernels are only called after checking that the CPU supports
+ *       their instruction set (see PxLHostIsa).
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <stdlib.h>
+#include "filterKernels.h"
+
+#if defined(PXL_X86_KERNELS)
+#include <immintrin.h>
+#elif defined(PXL_NEON_KERNELS)
+#include <arm_neon.h>
+#endif
+
+// The pixel layouts of the formats supported by the kernels
+typedef enum _PXL_PIXEL_LAYOUT
+{
+    LAYOUT_MONO8 = 0,
+    LAYOUT_BGR24,       // PIXEL_FORMAT_RGB24 (Windows DIB order)
+    LAYOUT_RGB24,       // PIXEL_FORMAT_RGB24_NON_DIB
+    LAYOUT_COUNT
+} PXL_PIXEL_LAYOUT;
+
+static int PixelLayout (U32 uDataFormat)
+{
+    switch (uDataFormat)
+    {
+    case PIXEL_FORMAT_MONO8:         return LAYOUT_MONO8;
+    case PIXEL_FORMAT_RGB24:         return LAYOUT_BGR24;
+    case PIXEL_FORMAT_RGB24_NON_DIB: return LAYOUT_RGB24;
+    default:                         return LAYOUT_COUNT;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Filter operations
+ * ---------------------------------------------------------------------------
+ */
+
+#if defined(PXL_X86_KERNELS)
+// Shuffle masks to separate 16 packed 3-byte pixels (in 3 vectors) into one vector per channel
+// (s_deinterleave[channel]), and to put them back again (s_interleave[vector]).
+static const char s_deinterleave[3][3][16] __attribute__((aligned(16))) = {
+    {{  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+     { -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14, -1, -1, -1, -1, -1 },
+     { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  1,  4,  7, 10, 13 }},
+    {{  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+     { -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15, -1, -1, -1, -1, -1 },
+     { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  2,  5,  8, 11, 14 }},
+    {{  2,  5,  8, 11, 14, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1 },
+     { -1, -1, -1, -1, -1,  1,  4,  7, 10, 13, -1, -1, -1, -1, -1, -1 },
+     { -1, -1, -1, -1, -1, -1, -1, -1, -1, -1,  0,  3,  6,  9, 12, 15 }}};
+static const char s_interleave[3][3][16] __attribute__((aligned(16))) = {
+    {{  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1,  5 },
+     { -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1, -1 },
+     { -1, -1,  0, -1, -1,  1, -1, -1,  2, -1, -1,  3, -1, -1,  4, -1 }},
+    {{ -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10, -1 },
+     {  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1, 10 },
+     { -1,  5, -1, -1,  6, -1, -1,  7, -1, -1,  8, -1, -1,  9, -1, -1 }},
+    {{ -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1, -1 },
+     { -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15, -1 },
+     { 10, -1, -1, 11, -1, -1, 12, -1, -1, 13, -1, -1, 14, -1, -1, 15 }}};
+
+PXL_TARGET_SSE41 static inline __m128i Shuffle3 (__m128i a, __m128i b, __m128i c, const char (*masks)[16])
+{
+    return _mm_or_si128 (_mm_or_si128 (_mm_shuffle_epi8 (a, _mm_load_si128 ((const __m128i*)masks[0])),
+                                       _mm_shuffle_epi8 (b, _mm_load_si128 ((const __m128i*)masks[1]))),
+                         _mm_shuffle_epi8 (c, _mm_load_si128 ((const __m128i*)masks[2])));
+}
+
+// Sum of the 3 channels of 16 pixels, as 2 vectors of 8 16-bit values
+PXL_TARGET_SSE41 static inline void ChannelSums (__m128i c0, __m128i c1, __m128i c2, __m128i& lo, __m128i& hi)
+{
+    lo = _mm_add_epi16 (_mm_add_epi16 (_mm_cvtepu8_epi16 (c0), _mm_cvtepu8_epi16 (c1)), _mm_cvtepu8_epi16 (c2));
+    hi = _mm_add_epi16 (_mm_add_epi16 (_mm_cvtepu8_epi16 (_mm_srli_si128 (c0, 8)),
+                                       _mm_cvtepu8_epi16 (_mm_srli_si128 (c1, 8))),
+                        _mm_cvtepu8_epi16 (_mm_srli_si128 (c2, 8)));
+}
+#endif
+
+#if defined(PXL_NEON_KERNELS)
+static inline void ChannelSums (uint8x16_t c0, uint8x16_t c1, uint8x16_t c2, uint16x8_t& lo, uint16x8_t& hi)
+{
+    lo = vaddw_u8 (vaddl_u8 (vget_low_u8 (c0), vget_low_u8 (c1)), vget_low_u8 (c2));
+    hi = vaddw_u8 (vaddl_u8 (vget_high_u8 (c0), vget_high_u8 (c1)), vget_high_u8 (c2));
+}
+#endif
+
+//
+// Operations on individual samples
+//
+
+// Negative:  255 - sample
+struct NegativeOp
+{
+    static U8 scalar (U8 v) { return 255 - v; }
+#if defined(PXL_X86_KERNELS)
+    PXL_TARGET_SSE41 static __m128i sse41 (__m128i v) { return _mm_xor_si128 (v, _mm_set1_epi8 (-1)); }
+    PXL_TARGET_AVX2  static __m256i avx2 (__m256i v)  { return _mm256_xor_si256 (v, _mm256_set1_epi8 (-1)); }
+#elif defined(PXL_NEON_KERNELS)
+    static uint8x16_t neon (uint8x16_t v) { return vmvnq_u8 (v); }
+#endif
+};
+
+// Mono threshold:  0 below 50%, 255 otherwise.  Above 50% is the same as the sign bit being set.
+struct ThresholdOp
+{
+    static U8 scalar (U8 v) { return (v < 128) ? 0 : 255; }
+#if defined(PXL_X86_KERNELS)
+    PXL_TARGET_SSE41 static __m128i sse41 (__m128i v) { return _mm_cmplt_epi8 (v, _mm_setzero_si128()); }
+    PXL_TARGET_AVX2  static __m256i avx2 (__m256i v)  { return _mm256_cmpgt_epi8 (_mm256_setzero_si256(), v); }
+#elif defined(PXL_NEON_KERNELS)
+    static uint8x16_t neon (uint8x16_t v) { return vcgeq_u8 (v, vdupq_n_u8 (128)); }
+#endif
+};
+
+// Mono saturated and black:  black becomes white, and white becomes black.
+struct SaturatedOp
+{
+    static U8 scalar (U8 v) { return (v == 0x00) ? 0xFF : (v == 0xFF) ? 0x00 : v; }
+#if defined(PXL_X86_KERNELS)
+    PXL_TARGET_SSE41 static __m128i sse41 (__m128i v)
+    {
+        const __m128i black = _mm_cmpeq_epi8 (v, _mm_setzero_si128());
+        const __m128i white = _mm_cmpeq_epi8 (v, _mm_set1_epi8 (-1));
+        return _mm_or_si128 (_mm_andnot_si128 (white, v), black);
+    }
+    PXL_TARGET_AVX2 static __m256i avx2 (__m256i v)
+    {
+        const __m256i black = _mm256_cmpeq_epi8 (v, _mm256_setzero_si256());
+        const __m256i white = _mm256_cmpeq_epi8 (v, _mm256_set1_epi8 (-1));
+        return _mm256_or_si256 (_mm256_andnot_si256 (white, v), black);
+    }
+#elif defined(PXL_NEON_KERNELS)
+    static uint8x16_t neon (uint8x16_t v)
+    {
+        const uint8x16_t black = vceqq_u8 (v, vdupq_n_u8 (0x00));
+        const uint8x16_t white = vceqq_u8 (v, vdupq_n_u8 (0xFF));
+        return vorrq_u8 (vbicq_u8 (v, white), black);
+    }
+#endif
+};
+
+//
+// Operations on 3-byte pixels.  The vector versions are given one vector for each channel.
+//
+
+// Color threshold:  black if the sum of the channels is below 50%, white otherwise
+struct ThresholdRgbOp
+{
+    static void scalar (U8* pPixel)
+    {
+        int total = pPixel[0] + pPixel[1] + pPixel[2];
+        U8 newValue = (total < 128*3) ? 0 : 255;
+        pPixel[0] = pPixel[1] = pPixel[2] = newValue;
+    }
+#if defined(PXL_X86_KERNELS)
+    PXL_TARGET_SSE41 static void sse41 (__m128i& c0, __m128i& c1, __m128i& c2)
+    {
+        __m128i lo, hi;
+        ChannelSums (c0, c1, c2, lo, hi);
+        const __m128i limit = _mm_set1_epi16 (128*3 - 1);
+        c0 = c1 = c2 = _mm_packs_epi16 (_mm_cmpgt_epi16 (lo, limit), _mm_cmpgt_epi16 (hi, limit));
+    }
+#elif defined(PXL_NEON_KERNELS)
+    static void neon (uint8x16_t& c0, uint8x16_t& c1, uint8x16_t& c2)
+    {
+        uint16x8_t lo, hi;
+        ChannelSums (c0, c1, c2, lo, hi);
+        const uint16x8_t limit = vdupq_n_u16 (128*3);
+        c0 = c1 = c2 = vcombine_u8 (vmovn_u16 (vcgeq_u16 (lo, limit)), vmovn_u16 (vcgeq_u16 (hi, limit)));
+    }
+#endif
+};
+
+// Color saturated and black:  all- or near-black pixels become blue (cold), and all- or near-white pixels
+// become red (hot).  Which channel is blue depends on the layout.
+template<int LAYOUT>
+struct SaturatedRgbOp
+{
+    enum { TOLERANCE = 5,                   // +- 5 from pure black or pure white.
+           BLUE = (LAYOUT == LAYOUT_BGR24) ? 0 : 2,
+           RED  = 2 - BLUE };
+
+    static void scalar (U8* pPixel)
+    {
+        U32 total = pPixel[0] + pPixel[1] + pPixel[2];
+        if (total <= (3 * (0x00 + TOLERANCE))) {
+            pPixel[BLUE] = 0xFF;
+            pPixel[1] = 0x00;
+            pPixel[RED] = 0x00;
+        } else if (total >= (3 * (0xFF - TOLERANCE))) {
+            pPixel[BLUE] = 0x00;
+            pPixel[1] = 0x00;
+            pPixel[RED] = 0xFF;
+        }
+    }
+#if defined(PXL_X86_KERNELS)
+    PXL_TARGET_SSE41 static void sse41 (__m128i& c0, __m128i& c1, __m128i& c2)
+    {
+        __m128i lo, hi;
+        ChannelSums (c0, c1, c2, lo, hi);
+        const __m128i coldLimit = _mm_set1_epi16 (3 * (0x00 + TOLERANCE) + 1);
+        const __m128i hotLimit  = _mm_set1_epi16 (3 * (0xFF - TOLERANCE) - 1);
+        const __m128i cold = _mm_packs_epi16 (_mm_cmplt_epi16 (lo, coldLimit), _mm_cmplt_epi16 (hi, coldLimit));
+        const __m128i hot  = _mm_packs_epi16 (_mm_cmpgt_epi16 (lo, hotLimit), _mm_cmpgt_epi16 (hi, hotLimit));
+        const __m128i either = _mm_or_si128 (cold, hot);
+        // The blue channel becomes 0xFF for the cold pixels, the red channel 0xFF for the hot ones, and
+        // everything else 0.
+        __m128i& blue = (BLUE == 0) ? c0 : c2;
+        __m128i& red  = (BLUE == 0) ? c2 : c0;
+        blue = _mm_blendv_epi8 (blue, cold, either);
+        red  = _mm_blendv_epi8 (red, hot, either);
+        c1   = _mm_andnot_si128 (either, c1);
+    }
+#elif defined(PXL_NEON_KERNELS)
+    static void neon (uint8x16_t& c0, uint8x16_t& c1, uint8x16_t& c2)
+    {
+        uint16x8_t lo, hi;
+        ChannelSums (c0, c1, c2, lo, hi);
+        const uint16x8_t coldLimit = vdupq_n_u16 (3 * (0x00 + TOLERANCE));
+        const uint16x8_t hotLimit  = vdupq_n_u16 (3 * (0xFF - TOLERANCE));
+        const uint8x16_t cold = vcombine_u8 (vmovn_u16 (vcleq_u16 (lo, coldLimit)), vmovn_u16 (vcleq_u16 (hi, coldLimit)));
+        const uint8x16_t hot  = vcombine_u8 (vmovn_u16 (vcgeq_u16 (lo, hotLimit)), vmovn_u16 (vcgeq_u16 (hi, hotLimit)));
+        const uint8x16_t either = vorrq_u8 (cold, hot);
+        uint8x16_t& blue = (BLUE == 0) ? c0 : c2;
+        uint8x16_t& red  = (BLUE == 0) ? c2 : c0;
+        blue = vbslq_u8 (either, cold, blue);
+        red  = vbslq_u8 (either, hot, red);
+        c1   = vbicq_u8 (c1, either);
+    }
+#endif
+};
+
+// Grayscale:  each channel becomes the luminance.  Note that the original filter treats both of the
+// color layouts as BGR, so we do too.  The vector versions do exactly the same float operations as the
+// scalar one (in the same order), so they give identical results.
+struct GrayscaleOp
+{
+    static void scalar (U8* pPixel)
+    {
+        const float b = static_cast<float>(pPixel[0]);
+        const float g = static_cast<float>(pPixel[1]);
+        const float r = static_cast<float>(pPixel[2]);
+        const float Y =  (0.2989f * r) + (0.5870f * g) + (0.1140f * b);
+        pPixel[0] = pPixel[1] = pPixel[2] = static_cast<U8>(Y);
+    }
+#if defined(PXL_X86_KERNELS)
+    PXL_TARGET_SSE41 static __m128i luminance4 (__m128i b, __m128i g, __m128i r)
+    {
+        const __m128 Y = _mm_add_ps (_mm_add_ps (_mm_mul_ps (_mm_set1_ps (0.2989f), _mm_cvtepi32_ps (_mm_cvtepu8_epi32 (r))),
+                                                 _mm_mul_ps (_mm_set1_ps (0.5870f), _mm_cvtepi32_ps (_mm_cvtepu8_epi32 (g)))),
+                                     _mm_mul_ps (_mm_set1_ps (0.1140f), _mm_cvtepi32_ps (_mm_cvtepu8_epi32 (b))));
+        return _mm_cvttps_epi32 (Y);
+    }
+    PXL_TARGET_SSE41 static void sse41 (__m128i& c0, __m128i& c1, __m128i& c2)
+    {
+        const __m128i y0 = luminance4 (c0, c1, c2);
+        const __m128i y1 = luminance4 (_mm_srli_si128 (c0, 4), _mm_srli_si128 (c1, 4), _mm_srli_si128 (c2, 4));
+        const __m128i y2 = luminance4 (_mm_srli_si128 (c0, 8), _mm_srli_si128 (c1, 8), _mm_srli_si128 (c2, 8));
+        const __m128i y3 = luminance4 (_mm_srli_si128 (c0, 12), _mm_srli_si128 (c1, 12), _mm_srli_si128 (c2, 12));
+        c0 = c1 = c2 = _mm_packus_epi16 (_mm_packus_epi32 (y0, y1), _mm_packus_epi32 (y2, y3));
+    }
+#elif defined(PXL_NEON_KERNELS)
+    static uint16x4_t luminance4 (uint16x4_t b, uint16x4_t g, uint16x4_t r)
+    {
+        const float32x4_t Y = vaddq_f32 (vaddq_f32 (vmulq_n_f32 (vcvtq_f32_u32 (vmovl_u16 (r)), 0.2989f),
+                                                    vmulq_n_f32 (vcvtq_f32_u32 (vmovl_u16 (g)), 0.5870f)),
+                                         vmulq_n_f32 (vcvtq_f32_u32 (vmovl_u16 (b)), 0.1140f));
+        return vmovn_u32 (vcvtq_u32_f32 (Y));
+    }
+    static void neon (uint8x16_t& c0, uint8x16_t& c1, uint8x16_t& c2)
+    {
+        const uint16x8_t bLo = vmovl_u8 (vget_low_u8 (c0)), bHi = vmovl_u8 (vget_high_u8 (c0));
+        const uint16x8_t gLo = vmovl_u8 (vget_low_u8 (c1)), gHi = vmovl_u8 (vget_high_u8 (c1));
+        const uint16x8_t rLo = vmovl_u8 (vget_low_u8 (c2)), rHi = vmovl_u8 (vget_high_u8 (c2));
+        const uint16x8_t yLo = vcombine_u16 (luminance4 (vget_low_u16 (bLo), vget_low_u16 (gLo), vget_low_u16 (rLo)),
+                                             luminance4 (vget_high_u16 (bLo), vget_high_u16 (gLo), vget_high_u16 (rLo)));
+        const uint16x8_t yHi = vcombine_u16 (luminance4 (vget_low_u16 (bHi), vget_low_u16 (gHi), vget_low_u16 (rHi)),
+                                             luminance4 (vget_high_u16 (bHi), vget_high_u16 (gHi), vget_high_u16 (rHi)));
+        c0 = c1 = c2 = vcombine_u8 (vmovn_u16 (yLo), vmovn_u16 (yHi));
+    }
+#endif
+};
+
+/* ---------------------------------------------------------------------------
+ * --   Kernels
+ * ---------------------------------------------------------------------------
+ */
+
+// Grayscale of a mono image is the image itself
+static void Unchanged (U8* /*pData*/, U32 /*numPixels*/)
+{
+}
+
+template<typename OP, int BYTES_PER_PIXEL>
+static void SampleKernel_Scalar (U8* pData, U32 numPixels)
+{
+    const size_t n = (size_t)numPixels * BYTES_PER_PIXEL;
+    for (size_t i = 0; i < n; i++) pData[i] = OP::scalar (pData[i]);
+}
+
+template<typename OP>
+static void PixelKernel_Scalar (U8* pData, U32 numPixels)
+{
+    for (U32 i = 0; i < numPixels; i++, pData += 3) OP::scalar (pData);
+}
+
+#if defined(PXL_X86_KERNELS)
+template<typename OP, int BYTES_PER_PIXEL>
+PXL_TARGET_SSE41 static void SampleKernel_Sse41 (U8* pData, U32 numPixels)
+{
+    const size_t n = (size_t)numPixels * BYTES_PER_PIXEL;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i* p = (__m128i*)(pData+i);
+        _mm_storeu_si128 (p, OP::sse41 (_mm_loadu_si128 (p)));
+    }
+    for (; i < n; i++) pData[i] = OP::scalar (pData[i]);
+}
+
+template<typename OP, int BYTES_PER_PIXEL>
+PXL_TARGET_AVX2 static void SampleKernel_Avx2 (U8* pData, U32 numPixels)
+{
+    const size_t n = (size_t)numPixels * BYTES_PER_PIXEL;
+    size_t i = 0;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i* p = (__m256i*)(pData+i);
+        _mm256_storeu_si256 (p, OP::avx2 (_mm256_loadu_si256 (p)));
+    }
+    for (; i < n; i++) pData[i] = OP::scalar (pData[i]);
+}
+
+// 16 pixels (48 bytes) at a time.  The channels don't line up in 256 bit registers any better than they do
+// in 128 bit ones, so there are no AVX2 versions of these.
+template<typename OP>
+PXL_TARGET_SSE41 static void PixelKernel_Sse41 (U8* pData, U32 numPixels)
+{
+    U32 i = 0;
+    for (; i + 16 <= numPixels; i += 16, pData += 48)
+    {
+        __m128i* p = (__m128i*)pData;
+        const __m128i a = _mm_loadu_si128 (p);
+        const __m128i b = _mm_loadu_si128 (p+1);
+        const __m128i c = _mm_loadu_si128 (p+2);
+        __m128i c0 = Shuffle3 (a, b, c, s_deinterleave[0]);
+        __m128i c1 = Shuffle3 (a, b, c, s_deinterleave[1]);
+        __m128i c2 = Shuffle3 (a, b, c, s_deinterleave[2]);
+        OP::sse41 (c0, c1, c2);
+        _mm_storeu_si128 (p,   Shuffle3 (c0, c1, c2, s_interleave[0]));
+        _mm_storeu_si128 (p+1, Shuffle3 (c0, c1, c2, s_interleave[1]));
+        _mm_storeu_si128 (p+2, Shuffle3 (c0, c1, c2, s_interleave[2]));
+    }
+    for (; i < numPixels; i++, pData += 3) OP::scalar (pData);
+}
+#endif
+
+#if defined(PXL_NEON_KERNELS)
+template<typename OP, int BYTES_PER_PIXEL>
+static void SampleKernel_Neon (U8* pData, U32 numPixels)
+{
+    const size_t n = (size_t)numPixels * BYTES_PER_PIXEL;
+    size_t i = 0;
+    for (; i + 16 <= n; i += 16)
+    {
+        vst1q_u8 (pData+i, OP::neon (vld1q_u8 (pData+i)));
+    }
+    for (; i < n; i++) pData[i] = OP::scalar (pData[i]);
+}
+
+// 16 pixels (48 bytes) at a time; the channels are separated (and put back) by the loads and stores.
+template<typename OP>
+static void PixelKernel_Neon (U8* pData, U32 numPixels)
+{
+    U32 i = 0;
+    for (; i + 16 <= numPixels; i += 16, pData += 48)
+    {
+        uint8x16x3_t pixels = vld3q_u8 (pData);
+        OP::neon (pixels.val[0], pixels.val[1], pixels.val[2]);
+        vst3q_u8 (pData, pixels);
+    }
+    for (; i < numPixels; i++, pData += 3) OP::scalar (pData);
+}
+#endif
+
+/* ---------------------------------------------------------------------------
+ * --   Kernel selection
+ * ---------------------------------------------------------------------------
+ */
+
+// The kernels for one instruction set level.  NULL entries fall back to the level below (and NULL entries
+// in the scalar table are those formats not supported by the filter).
+typedef struct _PXL_KERNEL_TABLE
+{
+    PxLPixelKernel kernels[PIXEL_FILTER_COUNT][LAYOUT_COUNT];
+} PXL_KERNEL_TABLE;
+
+static const PXL_KERNEL_TABLE s_scalarKernels = {{
+    // MONO8                                     BGR24                                      RGB24
+    { SampleKernel_Scalar<NegativeOp, 1>,       SampleKernel_Scalar<NegativeOp, 3>,        SampleKernel_Scalar<NegativeOp, 3> },
+    { SampleKernel_Scalar<ThresholdOp, 1>,      PixelKernel_Scalar<ThresholdRgbOp>,        PixelKernel_Scalar<ThresholdRgbOp> },
+    { SampleKernel_Scalar<SaturatedOp, 1>,      PixelKernel_Scalar<SaturatedRgbOp<LAYOUT_BGR24> >,
+                                                                                           PixelKernel_Scalar<SaturatedRgbOp<LAYOUT_RGB24> > },
+    { Unchanged,                                PixelKernel_Scalar<GrayscaleOp>,           PixelKernel_Scalar<GrayscaleOp> }
+}};
+
+#if defined(PXL_X86_KERNELS)
+static const PXL_KERNEL_TABLE s_sse41Kernels = {{
+    { SampleKernel_Sse41<NegativeOp, 1>,        SampleKernel_Sse41<NegativeOp, 3>,         SampleKernel_Sse41<NegativeOp, 3> },
+    { SampleKernel_Sse41<ThresholdOp, 1>,       PixelKernel_Sse41<ThresholdRgbOp>,         PixelKernel_Sse41<ThresholdRgbOp> },
+    { SampleKernel_Sse41<SaturatedOp, 1>,       PixelKernel_Sse41<SaturatedRgbOp<LAYOUT_BGR24> >,
+                                                                                           PixelKernel_Sse41<SaturatedRgbOp<LAYOUT_RGB24> > },
+    { NULL,                                     PixelKernel_Sse41<GrayscaleOp>,            PixelKernel_Sse41<GrayscaleOp> }
+}};
+
+static const PXL_KERNEL_TABLE s_avx2Kernels = {{
+    { SampleKernel_Avx2<NegativeOp, 1>,         SampleKernel_Avx2<NegativeOp, 3>,          SampleKernel_Avx2<NegativeOp, 3> },
+    { SampleKernel_Avx2<ThresholdOp, 1>,        NULL,                                      NULL },
+    { SampleKernel_Avx2<SaturatedOp, 1>,        NULL,                                      NULL },
+    { NULL,                                     NULL,                                      NULL }
+}};
+#endif
+
+#if defined(PXL_NEON_KERNELS)
+static const PXL_KERNEL_TABLE s_neonKernels = {{
+    { SampleKernel_Neon<NegativeOp, 1>,         SampleKernel_Neon<NegativeOp, 3>,          SampleKernel_Neon<NegativeOp, 3> },
+    { SampleKernel_Neon<ThresholdOp, 1>,        PixelKernel_Neon<ThresholdRgbOp>,          PixelKernel_Neon<ThresholdRgbOp> },
+    { SampleKernel_Neon<SaturatedOp, 1>,        PixelKernel_Neon<SaturatedRgbOp<LAYOUT_BGR24> >,
+                                                                                           PixelKernel_Neon<SaturatedRgbOp<LAYOUT_RGB24> > },
+    { NULL,                                     PixelKernel_Neon<GrayscaleOp>,             PixelKernel_Neon<GrayscaleOp> }
+}};
+#endif
+
+// Indexed by PXL_ISA_LEVEL; NULL for those levels not built.
+static const PXL_KERNEL_TABLE* const s_kernelTables[ISA_COUNT] = {
+    &s_scalarKernels,
+#if defined(PXL_X86_KERNELS)
+    &s_sse41Kernels,
+    &s_avx2Kernels,
+#else
+    NULL,
+    NULL,
+#endif
+#if defined(PXL_NEON_KERNELS)
+    &s_neonKernels,
+#else
+    NULL,
+#endif
+};
+
+static const char* const s_isaNames[ISA_COUNT] = {"scalar", "sse4.1", "avx2", "neon"};
+
+PXL_ISA_LEVEL PxLFallbackIsa (PXL_ISA_LEVEL isa)
+{
+    return (isa == ISA_NEON) ? ISA_SCALAR : (PXL_ISA_LEVEL)(isa - 1);
+}
+
+// Can level isa be used, when the user has limited us to level limit?
+static bool IsaAllowed (PXL_ISA_LEVEL isa, int limit)
+{
+    if (isa == ISA_SCALAR || isa == limit) return true;
+    // NEON is neither above nor below the x86 levels
+    return isa != ISA_NEON && limit != ISA_NEON && isa < limit;
+}
+
+// The best level supported by the CPU
+static PXL_ISA_LEVEL DetectIsa ()
+{
+#if defined(PXL_X86_KERNELS)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports ("avx2"))   return ISA_AVX2;
+    if (__builtin_cpu_supports ("sse4.1")) return ISA_SSE41;
+    return ISA_SCALAR;
+#elif defined(PXL_NEON_KERNELS)
+    return ISA_NEON;
+#else
+    return ISA_SCALAR;
+#endif
+}
+
+PXL_ISA_LEVEL PxLHostIsa ()
+{
+    static volatile int hostIsa = -1;  // Not yet determined
+
+    if (hostIsa < 0)
+    {
+        PXL_ISA_LEVEL isa = DetectIsa();
+
+        // Is the user limiting us?
+        const char* pLimit = getenv ("PXL_FILTER_ISA");
+        if (pLimit)
+        {
+            for (int limit = ISA_SCALAR; limit < ISA_COUNT; limit++)
+            {
+                if (strcasecmp (pLimit, s_isaNames[limit]) != 0) continue;
+                while (! IsaAllowed (isa, limit)) isa = PxLFallbackIsa (isa);
+                break;
+            }
+        }
+        hostIsa = isa;
+    }
+    return (PXL_ISA_LEVEL)hostIsa;
+}
+
+const char* PxLIsaName (PXL_ISA_LEVEL isa)
+{
+    return (isa >= ISA_SCALAR && isa < ISA_COUNT) ? s_isaNames[isa] : "unknown";
+}
+
+PxLPixelKernel PxLSelectPixelKernel (PXL_PIXEL_FILTER filter, U32 uDataFormat, PXL_ISA_LEVEL isa)
+{
+    const int layout = PixelLayout (uDataFormat);
+    if (filter < 0 || filter >= PIXEL_FILTER_COUNT || layout == LAYOUT_COUNT) return NULL;
+    if (isa < ISA_SCALAR || isa >= ISA_COUNT) isa = ISA_SCALAR;
+
+    for (;;)
+    {
+        const PXL_KERNEL_TABLE* pTable = s_kernelTables[isa];
+        if (pTable && pTable->kernels[filter][layout]) return pTable->kernels[filter][layout];
+        if (isa == ISA_SCALAR) return NULL;
+        isa = PxLFallbackIsa (isa);
+    }
+}
@@ -0,0 +1,485 @@
+
+/***************************************************************************
+ *
+ *     File: focus.cpp
+ *
+ *     Description:
+ *       Host side focus metrics, used by the 'Lens' tab in CaptureOEM (and its
+ *       autofocus search, in autofocus.cpp).
+ *
+ *       Each row of the region being measured is first converted to 16 bit
+ *       samples (the MS 8 bits of each pixel, or the luminance of color
+ *       formats).  The row kernels then accumulate, from three rows of samples,
+ *       the sums needed by all three metrics, 8 or 16 pixels at a time using
+ *       SSE4.1, AVX2 or NEON when available.  The sums are exact integers, so
+ *       the vector kernels give the same results as the scalar one.
+ */
+
+#include <string.h>
+#include <strings.h>
+#include <stdio.h>
+#include <math.h>
+#include <algorithm>
+#include "focus.h"
+#include "filterKernels.h"
+#if defined(PXL_X86_KERNELS)
+#include <immintrin.h>
+#elif defined(PXL_NEON_KERNELS)
+#include <arm_neon.h>
+#endif
+
+using namespace std;
+
+/* ---------------------------------------------------------------------------
+ * --   Row kernels
+ * ---------------------------------------------------------------------------
+ */
+
+// The sums, over a region, from which the metrics are computed.
+typedef struct _PXL_FOCUS_SUMS
+{
+    U64 gradient;           // Gx^2 + Gy^2, of the Sobel operator
+    S64 laplacian;          // L, of the 4 neighbour Laplacian
+    U64 laplacianSquared;   // L^2
+    U64 brenner;            // (p[x+1] - p[x-1])^2
+} PXL_FOCUS_SUMS;
+
+//
+// Each kernel adds, for pixels 1 through width-2 of the middle row (p1):
+//      Gx = (p0[x+1] - p0[x-1]) + 2*(p1[x+1] - p1[x-1]) + (p2[x+1] - p2[x-1])
+//      Gy = (p2[x-1] + 2*p2[x] + p2[x+1]) - (p0[x-1] + 2*p0[x] + p0[x+1])
+//      L  = p0[x] + p2[x] + p1[x-1] + p1[x+1] - 4*p1[x]
+//      B  = p1[x+1] - p1[x-1]
+// to the sums.  Samples must be no more than 8 bits, so that the products of each pair of pixels
+// fit in 32 bits.
+typedef void (*PxLFocusRow) (const S16* p0, const S16* p1, const S16* p2, int width, PXL_FOCUS_SUMS* pSums);
+
+static inline void FocusAt (const S16* p0, const S16* p1, const S16* p2, int x, PXL_FOCUS_SUMS* pSums)
+{
+    const int gx = (p0[x+1] - p0[x-1]) + 2*(p1[x+1] - p1[x-1]) + (p2[x+1] - p2[x-1]);
+    const int gy = (p2[x-1] + 2*p2[x] + p2[x+1]) - (p0[x-1] + 2*p0[x] + p0[x+1]);
+    const int l  = p0[x] + p2[x] + p1[x-1] + p1[x+1] - 4*p1[x];
+    const int b  = p1[x+1] - p1[x-1];
+    pSums->gradient += (U64)(gx*gx + gy*gy);
+    pSums->laplacian += l;
+    pSums->laplacianSquared += (U64)(l*l);
+    pSums->brenner += (U64)(b*b);
+}
+
+static void FocusRow_Scalar (const S16* p0, const S16* p1, const S16* p2, int width, PXL_FOCUS_SUMS* pSums)
+{
+    for (int x = 1; x < width-1; x++) FocusAt (p0, p1, p2, x, pSums);
+}
+
+#if defined(PXL_X86_KERNELS)
+// Adds the 4 (non negative) 32 bit lanes of v to the 2 64 bit lanes of acc.
+PXL_TARGET_SSE41 static inline __m128i Accumulate64_Sse41 (__m128i acc, __m128i v)
+{
+    acc = _mm_add_epi64 (acc, _mm_cvtepu32_epi64 (v));
+    return _mm_add_epi64 (acc, _mm_cvtepu32_epi64 (_mm_srli_si128 (v, 8)));
+}
+
+PXL_TARGET_SSE41 static void FocusRow_Sse41 (const S16* p0, const S16* p1, const S16* p2, int width, PXL_FOCUS_SUMS* pSums)
+{
+    const __m128i ones = _mm_set1_epi16 (1);
+    __m128i gradient = _mm_setzero_si128();
+    __m128i laplacian = _mm_setzero_si128();     // 32 bit lanes; ample for one row
+    __m128i laplacianSquared = _mm_setzero_si128();
+    __m128i brenner = _mm_setzero_si128();
+
+    int x = 1;
+    for (; x + 8 <= width-1; x += 8)
+    {
+        const __m128i l0 = _mm_loadu_si128 ((const __m128i*)(p0+x-1));
+        const __m128i c0 = _mm_loadu_si128 ((const __m128i*)(p0+x));
+        const __m128i r0 = _mm_loadu_si128 ((const __m128i*)(p0+x+1));
+        const __m128i l1 = _mm_loadu_si128 ((const __m128i*)(p1+x-1));
+        const __m128i c1 = _mm_loadu_si128 ((const __m128i*)(p1+x));
+        const __m128i r1 = _mm_loadu_si128 ((const __m128i*)(p1+x+1));
+        const __m128i l2 = _mm_loadu_si128 ((const __m128i*)(p2+x-1));
+        const __m128i c2 = _mm_loadu_si128 ((const __m128i*)(p2+x));
+        const __m128i r2 = _mm_loadu_si128 ((const __m128i*)(p2+x+1));
+
+        const __m128i d1 = _mm_sub_epi16 (r1, l1);
+        const __m128i gx = _mm_add_epi16 (_mm_add_epi16 (_mm_sub_epi16 (r0, l0), _mm_slli_epi16 (d1, 1)),
+                                          _mm_sub_epi16 (r2, l2));
+        const __m128i gy = _mm_sub_epi16 (_mm_add_epi16 (_mm_add_epi16 (l2, _mm_slli_epi16 (c2, 1)), r2),
+                                          _mm_add_epi16 (_mm_add_epi16 (l0, _mm_slli_epi16 (c0, 1)), r0));
+        const __m128i l  = _mm_sub_epi16 (_mm_add_epi16 (_mm_add_epi16 (c0, c2), _mm_add_epi16 (l1, r1)),
+                                          _mm_slli_epi16 (c1, 2));
+
+        gradient = Accumulate64_Sse41 (gradient, _mm_add_epi32 (_mm_madd_epi16 (gx, gx), _mm_madd_epi16 (gy, gy)));
+        laplacian = _mm_add_epi32 (laplacian, _mm_madd_epi16 (l, ones));
+        laplacianSquared = Accumulate64_Sse41 (laplacianSquared, _mm_madd_epi16 (l, l));
+        brenner = Accumulate64_Sse41 (brenner, _mm_madd_epi16 (d1, d1));
+    }
+
+    U64 lanes64[2];
+    S32 lanes32[4];
+    _mm_storeu_si128 ((__m128i*)lanes64, gradient);
+    pSums->gradient += lanes64[0] + lanes64[1];
+    _mm_storeu_si128 ((__m128i*)lanes64, laplacianSquared);
+    pSums->laplacianSquared += lanes64[0] + lanes64[1];
+    _mm_storeu_si128 ((__m128i*)lanes64, brenner);
+    pSums->brenner += lanes64[0] + lanes64[1];
+    _mm_storeu_si128 ((__m128i*)lanes32, laplacian);
+    pSums->laplacian += (S64)lanes32[0] + lanes32[1] + lanes32[2] + lanes32[3];
+
+    for (; x < width-1; x++) FocusAt (p0, p1, p2, x, pSums);
+}
+
+// Adds the 8 (non negative) 32 bit lanes of v to the 4 64 bit lanes of acc.
+PXL_TARGET_AVX2 static inline __m256i Accumulate64_Avx2 (__m256i acc, __m256i v)
+{
+    acc = _mm256_add_epi64 (acc, _mm256_cvtepu32_epi64 (_mm256_castsi256_si128 (v)));
+    return _mm256_add_epi64 (acc, _mm256_cvtepu32_epi64 (_mm256_extracti128_si256 (v, 1)));
+}
+
+PXL_TARGET_AVX2 static void FocusRow_Avx2 (const S16* p0, const S16* p1, const S16* p2, int width, PXL_FOCUS_SUMS* pSums)
+{
+    const __m256i ones = _mm256_set1_epi16 (1);
+    __m256i gradient = _mm256_setzero_si256();
+    __m256i laplacian = _mm256_setzero_si256();  // 32 bit lanes; ample for one row
+    __m256i laplacianSquared = _mm256_setzero_si256();
+    __m256i brenner = _mm256_setzero_si256();
+
+    int x = 1;
+    for (; x + 16 <= width-1; x += 16)
+    {
+        const __m256i l0 = _mm256_loadu_si256 ((const __m256i*)(p0+x-1));
+        const __m256i c0 = _mm256_loadu_si256 ((const __m256i*)(p0+x));
+        const __m256i r0 = _mm256_loadu_si256 ((const __m256i*)(p0+x+1));
+        const __m256i l1 = _mm256_loadu_si256 ((const __m256i*)(p1+x-1));
+        const __m256i c1 = _mm256_loadu_si256 ((const __m256i*)(p1+x));
+        const __m256i r1 = _mm256_loadu_si256 ((const __m256i*)(p1+x+1));
+        const __m256i l2 = _mm256_loadu_si256 ((const __m256i*)(p2+x-1));
+        const __m256i c2 = _mm256_loadu_si256 ((const __m256i*)(p2+x));
+        const __m256i r2 = _mm256_loadu_si256 ((const __m256i*)(p2+x+1));
+
+        const __m256i d1 = _mm256_sub_epi16 (r1, l1);
+        const __m256i gx = _mm256_add_epi16 (_mm256_add_epi16 (_mm256_sub_epi16 (r0, l0), _mm256_slli_epi16 (d1, 1)),
+                                             _mm256_sub_epi16 (r2, l2));
+        const __m256i gy = _mm256_sub_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (l2, _mm256_slli_epi16 (c2, 1)), r2),
+                                             _mm256_add_epi16 (_mm256_add_epi16 (l0, _mm256_slli_epi16 (c0, 1)), r0));
+        const __m256i l  = _mm256_sub_epi16 (_mm256_add_epi16 (_mm256_add_epi16 (c0, c2), _mm256_add_epi16 (l1, r1)),
+                                             _mm256_slli_epi16 (c1, 2));
+
+        gradient = Accumulate64_Avx2 (gradient, _mm256_add_epi32 (_mm256_madd_epi16 (gx, gx), _mm256_madd_epi16 (gy, gy)));
+        laplacian = _mm256_add_epi32 (laplacian, _mm256_madd_epi16 (l, ones));
+        laplacianSquared = Accumulate64_Avx2 (laplacianSquared, _mm256_madd_epi16 (l, l));
+        brenner = Accumulate64_Avx2 (brenner, _mm256_madd_epi16 (d1, d1));
+    }
+
+    U64 lanes64[4];
+    S32 lanes32[8];
+    _mm256_storeu_si256 ((__m256i*)lanes64, gradient);
+    pSums->gradient += lanes64[0] + lanes64[1] + lanes64[2] + lanes64[3];
+    _mm256_storeu_si256 ((__m256i*)lanes64, laplacianSquared);
+    pSums->laplacianSquared += lanes64[0] + lanes64[1] + lanes64[2] + lanes64[3];
+    _mm256_storeu_si256 ((__m256i*)lanes64, brenner);
+    pSums->brenner += lanes64[0] + lanes64[1] + lanes64[2] + lanes64[3];
+    _mm256_storeu_si256 ((__m256i*)lanes32, laplacian);
+    for (int i = 0; i < 8; i++) pSums->laplacian += lanes32[i];
+
+    for (; x < width-1; x++) FocusAt (p0, p1, p2, x, pSums);
+}
+#endif
+
+#if defined(PXL_NEON_KERNELS)
+static void FocusRow_Neon (const S16* p0, const S16* p1, const S16* p2, int width, PXL_FOCUS_SUMS* pSums)
+{
+    int64x2_t gradient = vdupq_n_s64 (0);
+    int32x4_t laplacian = vdupq_n_s32 (0);       // ample for one row
+    int64x2_t laplacianSquared = vdupq_n_s64 (0);
+    int64x2_t brenner = vdupq_n_s64 (0);
+
+    int x = 1;
+    for (; x + 8 <= width-1; x += 8)
+    {
+        const int16x8_t l0 = vld1q_s16 (p0+x-1);
+        const int16x8_t c0 = vld1q_s16 (p0+x);
+        const int16x8_t r0 = vld1q_s16 (p0+x+1);
+        const int16x8_t l1 = vld1q_s16 (p1+x-1);
+        const int16x8_t c1 = vld1q_s16 (p1+x);
+        const int16x8_t r1 = vld1q_s16 (p1+x+1);
+        const int16x8_t l2 = vld1q_s16 (p2+x-1);
+        const int16x8_t c2 = vld1q_s16 (p2+x);
+        const int16x8_t r2 = vld1q_s16 (p2+x+1);
+
+        const int16x8_t d1 = vsubq_s16 (r1, l1);
+        const int16x8_t gx = vaddq_s16 (vaddq_s16 (vsubq_s16 (r0, l0), vshlq_n_s16 (d1, 1)), vsubq_s16 (r2, l2));
+        const int16x8_t gy = vsubq_s16 (vaddq_s16 (vaddq_s16 (l2, vshlq_n_s16 (c2, 1)), r2),
+                                        vaddq_s16 (vaddq_s16 (l0, vshlq_n_s16 (c0, 1)), r0));
+        const int16x8_t l  = vsubq_s16 (vaddq_s16 (vaddq_s16 (c0, c2), vaddq_s16 (l1, r1)), vshlq_n_s16 (c1, 2));
+
+        int32x4_t g = vmull_s16 (vget_low_s16 (gx), vget_low_s16 (gx));
+        g = vmlal_s16 (g, vget_low_s16 (gy), vget_low_s16 (gy));
+        gradient = vpadalq_s32 (gradient, g);
+        g = vmull_s16 (vget_high_s16 (gx), vget_high_s16 (gx));
+        g = vmlal_s16 (g, vget_high_s16 (gy), vget_high_s16 (gy));
+        gradient = vpadalq_s32 (gradient, g);
+
+        laplacian = vpadalq_s16 (laplacian, l);
+        laplacianSquared = vpadalq_s32 (laplacianSquared, vmull_s16 (vget_low_s16 (l), vget_low_s16 (l)));
+        laplacianSquared = vpadalq_s32 (laplacianSquared, vmull_s16 (vget_high_s16 (l), vget_high_s16 (l)));
+        brenner = vpadalq_s32 (brenner, vmull_s16 (vget_low_s16 (d1), vget_low_s16 (d1)));
+        brenner = vpadalq_s32 (brenner, vmull_s16 (vget_high_s16 (d1), vget_high_s16 (d1)));
+    }
+
+    pSums->gradient += (U64)(vgetq_lane_s64 (gradient, 0) + vgetq_lane_s64 (gradient, 1));
+    pSums->laplacianSquared += (U64)(vgetq_lane_s64 (laplacianSquared, 0) + vgetq_lane_s64 (laplacianSquared, 1));
+    pSums->brenner += (U64)(vgetq_lane_s64 (brenner, 0) + vgetq_lane_s64 (brenner, 1));
+    pSums->laplacian += (S64)vgetq_lane_s32 (laplacian, 0) + vgetq_lane_s32 (laplacian, 1) +
+                        vgetq_lane_s32 (laplacian, 2) + vgetq_lane_s32 (laplacian, 3);
+
+    for (; x < width-1; x++) FocusAt (p0, p1, p2, x, pSums);
+}
+#endif
+
+// Indexed by PXL_ISA_LEVEL.  NULL entries fall back to the level below.
+static const PxLFocusRow s_focusRows[ISA_COUNT] = {
+    FocusRow_Scalar,
+#if defined(PXL_X86_KERNELS)
+    FocusRow_Sse41,
+    FocusRow_Avx2,
+#else
+    NULL,
+    NULL,
+#endif
+#if defined(PXL_NEON_KERNELS)
+    FocusRow_Neon,
+#else
+    NULL,
+#endif
+};
+
+static PxLFocusRow SelectFocusRow ()
+{
+    PXL_ISA_LEVEL isa = PxLHostIsa();
+    while (! s_focusRows[isa]) isa = PxLFallbackIsa (isa);
+    return s_focusRows[isa];
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Conversion to samples
+ * ---------------------------------------------------------------------------
+ */
+
+typedef enum _FOCUS_SAMPLE_LAYOUT
+{
+    SAMPLES_8BIT = 0,
+    SAMPLES_DCAM16,                  // The MS 8 bits are in the first byte
+    SAMPLES_12BIT_PACKED,            // as per Design Notes in callbacks.cpp, we only use the MS 8 bits of
+    SAMPLES_12BIT_PACKED_MSFIRST,    // the packed formats
+    SAMPLES_10BIT_PACKED_MSFIRST,
+    SAMPLES_RGB24,                   // either order; green is in the middle
+    SAMPLES_UNSUPPORTED
+} FOCUS_SAMPLE_LAYOUT;
+
+static FOCUS_SAMPLE_LAYOUT SampleLayout (U32 pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case PIXEL_FORMAT_MONO8:
+    case PIXEL_FORMAT_BAYER8_BGGR:
+    case PIXEL_FORMAT_BAYER8_GBRG:
+    case PIXEL_FORMAT_BAYER8_GRBG:
+    case PIXEL_FORMAT_BAYER8_RGGB:
+        return SAMPLES_8BIT;
+
+    case PIXEL_FORMAT_MONO16:
+    case PIXEL_FORMAT_BAYER16_BGGR:
+    case PIXEL_FORMAT_BAYER16_GBRG:
+    case PIXEL_FORMAT_BAYER16_GRBG:
+    case PIXEL_FORMAT_BAYER16_RGGB:
+        return SAMPLES_DCAM16;
+
+    case PIXEL_FORMAT_MONO12_PACKED:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+        return SAMPLES_12BIT_PACKED;
+
+    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+        return SAMPLES_12BIT_PACKED_MSFIRST;
+
+    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
+        return SAMPLES_10BIT_PACKED_MSFIRST;
+
+    case PIXEL_FORMAT_RGB24:
+    case PIXEL_FORMAT_RGB24_NON_DIB:
+        return SAMPLES_RGB24;
+
+    default:
+        return SAMPLES_UNSUPPORTED;
+    }
+}
+
+static int BytesPerRow (FOCUS_SAMPLE_LAYOUT layout, int width)
+{
+    switch (layout)
+    {
+    case SAMPLES_DCAM16:               return width * 2;
+    case SAMPLES_12BIT_PACKED:
+    case SAMPLES_12BIT_PACKED_MSFIRST: return width + width/2;
+    case SAMPLES_10BIT_PACKED_MSFIRST: return width + width/4;
+    case SAMPLES_RGB24:                return width * 3;
+    default:                           return width;
+    }
+}
+
+// Loads width samples, starting at pixel offset of the row.
+static void LoadRow (FOCUS_SAMPLE_LAYOUT layout, const U8* pRow, int offset, int width, S16* pSamples)
+{
+    int x, p;
+    switch (layout)
+    {
+    case SAMPLES_8BIT:
+        for (x = 0, p = offset; x < width; x++, p++) pSamples[x] = pRow[p];
+        break;
+    case SAMPLES_DCAM16:
+        for (x = 0, p = offset; x < width; x++, p++) pSamples[x] = pRow[2*p];
+        break;
+    case SAMPLES_12BIT_PACKED:
+        for (x = 0, p = offset; x < width; x++, p++) pSamples[x] = pRow[3*(p/2) + 2*(p&1)];
+        break;
+    case SAMPLES_12BIT_PACKED_MSFIRST:
+        for (x = 0, p = offset; x < width; x++, p++) pSamples[x] = pRow[3*(p/2) + (p&1)];
+        break;
+    case SAMPLES_10BIT_PACKED_MSFIRST:
+        for (x = 0, p = offset; x < width; x++, p++) pSamples[x] = pRow[5*(p/4) + (p&3)];
+        break;
+    case SAMPLES_RGB24:
+        pRow += 3*offset;
+        for (x = 0; x < width; x++, pRow += 3) pSamples[x] = (S16)((pRow[0] + 2*pRow[1] + pRow[2]) >> 2);
+        break;
+    default:
+        break;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Metric names
+ * ---------------------------------------------------------------------------
+ */
+
+static const char* const s_metricNames[FOCUS_METRIC_COUNT] = {
+    "tenengrad",
+    "laplacian",
+    "brenner"
+};
+
+const char* PxLFocusMetricName (PXL_FOCUS_METRIC metric)
+{
+    return metric < FOCUS_METRIC_COUNT ? s_metricNames[metric] : "unknown";
+}
+
+PXL_FOCUS_METRIC PxLFocusMetricFromName (const char* name)
+{
+    if (name)
+    {
+        for (int i = 0; i < FOCUS_METRIC_COUNT; i++)
+        {
+            if (0 == strcasecmp (name, s_metricNames[i])) return (PXL_FOCUS_METRIC)i;
+        }
+    }
+    return FOCUS_METRIC_COUNT;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Public
+ * ---------------------------------------------------------------------------
+ */
+
+PxLFocusScores::PxLFocusScores ()
+: m_tenengrad(0.0)
+, m_laplacianVariance(0.0)
+, m_brenner(0.0)
+, m_pixels(0)
+{
+}
+
+double PxLFocusScores::score (PXL_FOCUS_METRIC metric) const
+{
+    switch (metric)
+    {
+    case FOCUS_LAPLACIAN_VARIANCE: return m_laplacianVariance;
+    case FOCUS_BRENNER:            return m_brenner;
+    default:
+    case FOCUS_TENENGRAD:          return m_tenengrad;
+    }
+}
+
+PxLFocusMetric::PxLFocusMetric ()
+{
+}
+
+bool PxLFocusMetric::measurable (U32 pixelFormat)
+{
+    return SampleLayout (pixelFormat) != SAMPLES_UNSUPPORTED;
+}
+
+PXL_RETURN_CODE PxLFocusMetric::measure (const void* pFrame, U32 frameSize, U32 pixelFormat, int width, int height,
+                                         const PXL_ROI& region, PxLFocusScores& scores)
+{
+    const FOCUS_SAMPLE_LAYOUT layout = SampleLayout (pixelFormat);
+    if (layout == SAMPLES_UNSUPPORTED || NULL == pFrame) return ApiInvalidParameterError;
+
+    const int bytesPerRow = BytesPerRow (layout, width);
+    if ((U32)bytesPerRow * height > frameSize) return ApiInvalidParameterError;
+
+    //
+    // Step 1
+    //      Clip the region to the frame.  We need at least 3 x 3 pixels to have anything to measure.
+    int x0 = 0, y0 = 0, x1 = width, y1 = height;
+    if (region.m_width > 0 && region.m_height > 0)
+    {
+        x0 = max (0, region.m_offsetX);
+        y0 = max (0, region.m_offsetY);
+        x1 = min (width, region.m_offsetX + region.m_width);
+        y1 = min (height, region.m_offsetY + region.m_height);
+    }
+    const int regionWidth = x1 - x0;
+    const int regionHeight = y1 - y0;
+    if (regionWidth < 3 || regionHeight < 3) return ApiInvalidParameterError;
+
+    //
+    // Step 2
+    //      A single pass over the region, with a rolling window of three rows of samples.  RGB24 (DIB)
+    //      frames are 'bottom up', which makes no difference to the metrics, other than where the
+    //      region is.
+    const bool bottomUp = (pixelFormat == PIXEL_FORMAT_RGB24);
+    const PxLFocusRow focusRow = SelectFocusRow();
+    if (m_samples.size() < (size_t)regionWidth * 3) m_samples.resize (regionWidth * 3);
+    S16* rows[3] = {&m_samples[0], &m_samples[regionWidth], &m_samples[2*regionWidth]};
+
+    const U8* pData = static_cast<const U8*>(pFrame);
+    PXL_FOCUS_SUMS sums = {0, 0, 0, 0};
+    for (int y = 0; y < regionHeight; y++)
+    {
+        const int frameRow = bottomUp ? height - 1 - (y0 + y) : y0 + y;
+        LoadRow (layout, pData + (size_t)frameRow * bytesPerRow, x0, regionWidth, rows[y % 3]);
+        if (y >= 2) focusRow (rows[(y-2) % 3], rows[(y-1) % 3], rows[y % 3], regionWidth, &sums);
+    }
+
+    //
+    // Step 3
+    //      Normalize
+    const double pixels = (double)(regionWidth - 2) * (regionHeight - 2);
+    const double laplacianMean = (double)sums.laplacian / pixels;
+    scores.m_tenengrad = (double)sums.gradient / pixels;
+    scores.m_laplacianVariance = max (0.0, (double)sums.laplacianSquared / pixels - laplacianMean * laplacianMean);
+    scores.m_brenner = (double)sums.brenner / pixels;
+    scores.m_pixels = (U32)pixels;
+
+    return ApiSuccess;
+}
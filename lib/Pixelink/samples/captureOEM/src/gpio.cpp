@@ -43,6 +43,11 @@ static void      UpdateGpioInfo (PxLGpioInfo& info);
 PXL_RETURN_CODE  GetCurrentGpio();
 void             UpdateGpiStatus();
 const PxLFeaturePollFunctions gpInputPoll (GetCurrentGpio, UpdateGpiStatus);
+static void      PollGpInput ();
+
+// The GP Input GetCurrentGpio reads, and what it last read (it can't use the tab; see featurePoller.h)
+static PxLPolledValue<int>  gpiPolledNumber;
+static PxLPolledValue<bool> gpiPolled;
 
 static const char* const PxLTriggerModeDescriptions[] = {
   "Mode 0\n\n"
@@ -196,7 +201,7 @@ void PxLGpio::activate()
                                   m_supportedGpioModes[modeIndex] == GPIO_MODE_INPUT;
             if (gpInputEnabled)
             {
-                gCamera->m_poller->pollAdd(gpInputPoll);
+                PollGpInput();
             }
         }
     } else {
@@ -536,7 +541,7 @@ static gboolean GpioActivate (gpointer pData)
                 //      If GP Input is enabled, start it's poller
                 if (origGpio.m_enabled && origGpio.m_mode == GPIO_MODE_INPUT)
                 {
-                    gCamera->m_poller->pollAdd(gpInputPoll);
+                    PollGpInput();
                 }
             }
         }
@@ -557,17 +562,19 @@ PXL_RETURN_CODE GetCurrentGpio()
 {
     PXL_RETURN_CODE rc = ApiSuccess;
 
-    PxLAutoLock lock(&gCameraLock);
-    if (gCamera && gGpioTab)
+    if (gCamera)
     {
         // It's safe to assume the camera supports GPIO, as this function will not be called
         // otherwise.  If we were to check via pCamera->supported (FEATURE_GPIO) or
         // pCamera->continuousSupported (FEATURE_GPIO), then that will perform a PxLGetCameraFeatures,
         // which is a lot of work for not.
         PxLGpioInfo currentGpio;
-        int requestedGpioNum = gtk_combo_box_get_active (GTK_COMBO_BOX(gGpioTab->m_gpioNumber));  // This is '0' based
-        rc = gCamera->getGpioValue(requestedGpioNum, currentGpio);
-        if (API_SUCCESS(rc)) gGpioTab->m_gpiLast = currentGpio.m_param1 == 1.0f;
+        rc = gCamera->getGpioValue(gpiPolledNumber.load(), currentGpio);
+        if (API_SUCCESS(rc))
+        {
+            bool gpiState = currentGpio.m_param1 == 1.0f;
+            rc = gpiPolled.store (gpiState) ? ApiSuccessParametersChanged : ApiSuccess;
+        }
     }
 
     return rc;
@@ -581,11 +588,20 @@ void UpdateGpiStatus()
     {
         PxLAutoLock lock(&gCameraLock);
 
+        gGpioTab->m_gpiLast = gpiPolled.load();
         gtk_entry_set_text (GTK_ENTRY (gGpioTab->m_gpioParam1Value),
                                        gGpioTab->m_gpiLast ? "Signaled" : "Not signaled");
     }
 }
 
+//
+// Starts polling the GP Input the GPIO number control shows.  The poll thread can't read the control itself.
+static void PollGpInput ()
+{
+    gpiPolledNumber.store (gtk_combo_box_get_active (GTK_COMBO_BOX(gGpioTab->m_gpioNumber)));  // This is '0' based
+    gCamera->m_poller->pollAdd(gpInputPoll);
+}
+
 static void UpdateTriggerInfo (PxLTriggerInfo& info, vector<int>& supportedHwTriggerModes)
 {
     gtk_combo_box_set_active (GTK_COMBO_BOX(gGpioTab->m_triggerType), info.m_enabled ? (int)info.m_type : TRIGGER_TYPE_NONE);
@@ -962,7 +978,7 @@ extern "C" void GpioEnableToggled
             // If GP Input is enabled, start it's poller
             if (requestedGpio.m_enabled && requestedGpio.m_mode == GPIO_MODE_INPUT)
             {
-                gCamera->m_poller->pollAdd(gpInputPoll);
+                PollGpInput();
             } else {
                 // This will safely do nothing if there is no poller
                 gCamera->m_poller->pollRemove(gpInputPoll);
@@ -43,6 +43,12 @@ PXL_RETURN_CODE GetCurrentTemperatures();
 void UpdateTemperatureControls();
 const PxLFeaturePollFunctions temperatureFuncs (GetCurrentTemperatures, UpdateTemperatureControls);
 
+// Which temperatures GetCurrentTemperatures reads, and what it last read (it can't use the tab; see featurePoller.h)
+static PxLPolledValue<bool>  sensorTempPolling;
+static PxLPolledValue<bool>  bodyTempPolling;
+static PxLPolledValue<float> sensorTempPolled;
+static PxLPolledValue<float> bodyTempPolled;
+
 // Define the thresholds used as user temperature warnings.  These values were taken from Window C-OEM
 //static const float sensorWarm = 45.0;
 static const float sensorWarm = 38.0;
@@ -276,6 +282,8 @@ static gboolean CameraActivate (gpointer pData)
         // add our functions to the continuous poller
         pInfo->m_hasSensorTemperature = gCamera->supported(FEATURE_SENSOR_TEMPERATURE);
         pInfo->m_hasBodyTemperature = gCamera->supported(FEATURE_BODY_TEMPERATURE);
+        sensorTempPolling.store (pInfo->m_hasSensorTemperature);
+        bodyTempPolling.store (pInfo->m_hasBodyTemperature);
         if (pInfo->m_hasSensorTemperature || pInfo->m_hasBodyTemperature)
         {
             gCamera->m_poller->pollAdd(temperatureFuncs);
@@ -308,21 +316,28 @@ PXL_RETURN_CODE GetCurrentTemperatures()
 {
     PXL_RETURN_CODE rc = ApiSuccess;
 
-    PxLAutoLock lock(&gCameraLock);
-    if (gCamera && gInfoTab)
+    if (gCamera)
     {
         float temp = 0.0;
+        bool changed = false;
 
-        if (gInfoTab->m_hasSensorTemperature)
+        if (sensorTempPolling.load())
         {
             rc = gCamera->getValue(FEATURE_SENSOR_TEMPERATURE, &temp);
-            if (API_SUCCESS(rc)) gInfoTab->m_sensorTempLast = temp;
+            if (API_SUCCESS(rc))
+            {
+                changed = sensorTempPolled.store (temp);
+            }
         }
-        if (gInfoTab->m_hasBodyTemperature)
+        if (bodyTempPolling.load())
         {
             rc = gCamera->getValue(FEATURE_BODY_TEMPERATURE, &temp);
-            if (API_SUCCESS(rc)) gInfoTab->m_bodyTempLast = temp;
+            if (API_SUCCESS(rc))
+            {
+                changed = bodyTempPolled.store (temp) || changed;
+            }
         }
+        if (API_SUCCESS(rc) && changed) rc = ApiSuccessParametersChanged;
     }
 
     return rc;
@@ -338,6 +353,8 @@ void UpdateTemperatureControls()
         GdkRGBA red = {1.0, 0.0, 0.0, 0.3};
         GdkRGBA yellow = {1.0, 1.0, 0.0, 0.3};
 
+        gInfoTab->m_sensorTempLast = sensorTempPolled.load();
+        gInfoTab->m_bodyTempLast = bodyTempPolled.load();
         if (gInfoTab->m_hasSensorTemperature)
         {
             sprintf (cActualValue, "%5.2f", gInfoTab->m_sensorTempLast);
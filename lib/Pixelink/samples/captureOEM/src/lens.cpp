@@ -7,6 +7,7 @@
  *        Controls for the 'Lens' tab  in CaptureOEM.
  */
 
+#include <stdlib.h>
 #include <algorithm>
 #include "lens.h"
 #include "cameraSelect.h"
@@ -38,6 +39,9 @@ static gboolean  FocusDeactivate (gpointer pData);
 static gboolean  FocusActivate (gpointer pData);
 static gboolean  ZoomDeactivate (gpointer pData);
 static gboolean  ZoomActivate (gpointer pData);
+static gboolean  AutofocusDone (gpointer pData);
+
+static void *autofocusThread (PxLLens *pLens);
 
 extern "C" void NewSsroiSelected (GtkWidget* widget, GdkEventExpose* event, gpointer userdata);
 
@@ -48,6 +52,7 @@ extern "C" bool SsroiButtonEnter  (GtkWidget* widget, GdkEventButton *event );
 PXL_RETURN_CODE GetCurrentFocus();
 void UpdateFocusControls();
 const PxLFeaturePollFunctions focusFuncs (GetCurrentFocus, UpdateFocusControls);
+static PxLPolledValue<float> focusPolled;   // What GetCurrentFocus last read
 
 static void SsFrameCallback (float sharpnessScore);
 
@@ -68,6 +73,11 @@ PxLLens::PxLLens (GtkBuilder *builder)
 , m_roiAspectRatio((float)ROI_AREA_WIDTH / (float)ROI_AREA_HEIGHT)
 , m_currentOp(OP_NONE)
 , m_maxSs (0)
+, m_hostAutofocus (false)
+, m_autofocusThread (NULL)
+, m_autofocusCamera (NULL)
+, m_autofocusRc (ApiSuccess)
+, m_autofocusFinished (false)
 {
     //
     // Step 1
@@ -106,6 +116,18 @@ PxLLens::PxLLens (GtkBuilder *builder)
     m_zoomAssertMin = GTK_WIDGET( gtk_builder_get_object( builder, "ZoomMin_Button" ) );
     m_zoomAssertMax = GTK_WIDGET( gtk_builder_get_object( builder, "ZoomMax_Button" ) );
 
+    //
+    // Step 2.
+    //      Host side autofocus.  PXL_HOST_AUTOFOCUS may name the metric to use (tenengrad, laplacian
+    //      or brenner).
+    const char* hostAutofocus = getenv ("PXL_HOST_AUTOFOCUS");
+    if (hostAutofocus)
+    {
+        m_hostAutofocus = true;
+        PXL_FOCUS_METRIC metric = PxLFocusMetricFromName (hostAutofocus);
+        if (metric != FOCUS_METRIC_COUNT) m_autofocus.setMetric (metric);
+    }
+
     //
     // Step 3.
     //      Create the cursors we will use for ROI button operations
@@ -139,6 +161,7 @@ PxLLens::PxLLens (GtkBuilder *builder)
 
 PxLLens::~PxLLens ()
 {
+    stopAutofocus();
 }
 
 void PxLLens::refreshRequired (bool noCamera)
@@ -228,7 +251,6 @@ void PxLLens::loadRoiImage(bool streamInterrupted)
             gtk_image_set_from_pixbuf (GTK_IMAGE (m_roiImage), m_roiBuf);
         }
     } else {
-        PXL_RETURN_CODE rc;
 
         // Step 2.
         //      Figure out the aspect ration of the ROI and ROI image area
@@ -266,43 +288,24 @@ void PxLLens::loadRoiImage(bool streamInterrupted)
 
             //
             // Step 5
-            //      Grab and format the image
-            std::vector<U8> frameBuf (gCamera->imageSizeInBytes());
-            FRAME_DESC     frameDesc;
-
-            rc = gCamera->getNextFrame(frameBuf.size(), &frameBuf[0], &frameDesc);
-            if (API_SUCCESS(rc))
+            //      Grab the image, and scale it to the roi area.  Be sure to use the same aspect ratio as the roi.
+            //      The thumbnail keeps its buffers, so refreshing the image does not allocate any memory.
+            GdkPixbuf* roiImage = m_roiThumbnail.grab (gCamera,
+                                                       m_ssroiButtonLimits.xMax - m_ssroiButtonLimits.xMin,
+                                                       m_ssroiButtonLimits.yMax - m_ssroiButtonLimits.yMin);
+            if (roiImage)
             {
-                // Allocate an rgb Buffer.
-                std::vector<U8> rgbBuffer (frameBuf.size()*3);
-                rc = gCamera->formatRgbImage(&frameBuf[0], &frameDesc, rgbBuffer.size(), &rgbBuffer[0]);
-                if (API_SUCCESS(rc))
-                {
-                    //
-                    // Step 6
-                    //      Convert the rgb image into a roi buffer.  Be sure to use the same aspect ratio as the roi
-
-
-                    GdkPixbuf  *tempPixBuf = gdk_pixbuf_new_from_data (
-                            &rgbBuffer[0], GDK_COLORSPACE_RGB, false, 8,
-                            (int)(frameDesc.Roi.fWidth / frameDesc.PixelAddressingValue.fHorizontal),
-                            (int)(frameDesc.Roi.fHeight / frameDesc.PixelAddressingValue.fVertical),
-                            (int)(frameDesc.Roi.fWidth / frameDesc.PixelAddressingValue.fHorizontal)*3, NULL, NULL);
-                    m_roiBuf = gdk_pixbuf_scale_simple (tempPixBuf,
-                            m_ssroiButtonLimits.xMax - m_ssroiButtonLimits.xMin,
-                            m_ssroiButtonLimits.yMax - m_ssroiButtonLimits.yMin,
-                            GDK_INTERP_BILINEAR);
-                    gtk_image_set_from_pixbuf (GTK_IMAGE (m_roiImage), m_roiBuf);
-                }
+                m_roiBuf = roiImage;
+                gtk_image_set_from_pixbuf (GTK_IMAGE (m_roiImage), m_roiBuf);
             }
 
             //
-            // Step 7
+            // Step 6
             //      Restore the stream as necessary
             if (streamInterrupted) gCamera->stopStream ();
         } else {
             //
-            // Step 8
+            // Step 7
             //      We can't grab an image.  Display the No Stream FFOV image (if we're not
             //      already displaying it
             if (m_roiBuf == NULL)
@@ -554,6 +557,35 @@ void PxLLens::setSsroiButtonSize ()
      gtk_widget_set_size_request (m_ssroiButton, m_ssroiButtonRoi.m_width, m_ssroiButtonRoi.m_height);
 }
 
+// Starts a host side search for the best focus, measuring the sharpness score ROI (if the camera has one --
+// otherwise, the whole frame).  The search takes many frames, so it runs on a thread of its own, and
+// AutofocusDone reports the result.  Called with gCameraLock held.
+void PxLLens::startAutofocus ()
+{
+    PxLAutoMutex lock(&m_autofocusLock);
+    if (m_autofocusThread || ! gCamera) return;  // One search at a time
+
+    PXL_ROI region;
+    if (gCamera->supported(FEATURE_SHARPNESS_SCORE)) gCamera->getRoiValue (SharpnessScoreRoi, &region);
+    m_autofocus.setRegion (region);
+    m_autofocus.uncancel();
+    m_autofocusCamera = gCamera;
+    m_autofocusFinished = false;
+
+    gtk_widget_set_sensitive (m_focusOneTime, false);
+    m_autofocusThread = g_thread_new ("autofocusThread", (GThreadFunc)autofocusThread, this);
+}
+
+void PxLLens::stopAutofocus ()
+{
+    PxLAutoMutex lock(&m_autofocusLock);
+    if (! m_autofocusThread) return;
+
+    m_autofocus.cancel();
+    g_thread_join (m_autofocusThread);
+    m_autofocusThread = NULL;
+}
+
 /* ---------------------------------------------------------------------------
  * --   gtk thread callbacks - used to update controls
  * ---------------------------------------------------------------------------
@@ -854,7 +886,9 @@ static gboolean FocusActivate (gpointer pData)
 
             float min, max, value;
 
+            // If the camera can't do a one time focus itself, we can do it for it
             if (gCamera->oneTimeSuppored(FEATURE_FOCUS)) oneTimeEnable = true;
+            if (gCamera->settable(FEATURE_FOCUS)) oneTimeEnable = true;
 
             //pLens->m_focusSlider->activate(true);
             gCamera->getRange(FEATURE_FOCUS, &min, &max);
@@ -876,8 +910,7 @@ PXL_RETURN_CODE GetCurrentFocus()
 {
     PXL_RETURN_CODE rc = ApiSuccess;
 
-    PxLAutoLock lock(&gCameraLock);
-    if (gCamera && gLensTab)
+    if (gCamera)
     {
         // It's safe to assume the camera supports focus, as this function will not be called
         // otherwise.  If we were to check via pCamera->supported (FEATURE_FOCUS) or
@@ -885,7 +918,10 @@ PXL_RETURN_CODE GetCurrentFocus()
         // which is a lot of work for not.
         float focus = 0.0;
         rc = gCamera->getValue(FEATURE_FOCUS, &focus);
-        if (API_SUCCESS(rc)) gLensTab->m_focusLast = focus;
+        if (API_SUCCESS(rc))
+        {
+            rc = focusPolled.store (focus) ? ApiSuccessParametersChanged : ApiSuccess;
+        }
     }
 
     return rc;
@@ -899,6 +935,7 @@ void UpdateFocusControls()
     {
         PxLAutoLock lock(&gCameraLock);
 
+        gLensTab->m_focusLast = focusPolled.load();
         gLensTab->m_focusSlider->setValue(gLensTab->m_focusLast);
 
         bool onetimeFocusOn = false;
@@ -1536,16 +1573,74 @@ extern "C" void FocusOneTimeButtonPressed
     (GtkWidget* widget, GdkEventExpose* event, gpointer userdata )
 {
     if (! gCamera || ! gCameraSelectTab || !gLensTab) return;
-    if (!gCamera->oneTimeSuppored(FEATURE_FOCUS)) return;
     if (gCameraSelectTab->changingCameras()) return;
 
     PxLAutoLock lock(&gCameraLock);
 
-    gOnetimeDialog->initiate(FEATURE_FOCUS, 500); // Pool every 500 ms
-    // Also add a poller so that the slider and the edit control also update as the
-    // one time is performed.
-    gCamera->m_poller->pollAdd(focusFuncs);
+    if (gCamera->oneTimeSuppored(FEATURE_FOCUS) && !gLensTab->m_hostAutofocus)
+    {
+        gOnetimeDialog->initiate(FEATURE_FOCUS, 500); // Pool every 500 ms
+        // Also add a poller so that the slider and the edit control also update as the
+        // one time is performed.
+        gCamera->m_poller->pollAdd(focusFuncs);
+        return;
+    }
+
+    // Otherwise, we search for the best focus ourselves
+    gLensTab->startAutofocus();
 }
 
+// Reports the result of a host side autofocus search
+static gboolean AutofocusDone (gpointer pData)
+{
+    PxLLens* pLens = (PxLLens*)pData;
 
+    //
+    // Step 1
+    //      Finish off the search.  There is nothing to report if it was stopped (its camera was released)
+    //      before we got here.
+    {
+        PxLAutoMutex lock(&pLens->m_autofocusLock);
+        if (! pLens->m_autofocusThread || ! pLens->m_autofocusFinished) return false;
+        g_thread_join (pLens->m_autofocusThread);
+        pLens->m_autofocusThread = NULL;
+    }
 
+    PxLAutoLock lock(&gCameraLock);
+    if (! gCamera) return false;
+
+    //
+    // Step 2
+    //      Report how quickly we got there
+    const PxLAutofocusResult& result = pLens->m_autofocusResult;
+    PXL_RETURN_CODE rc = pLens->m_autofocusRc;
+    printf ("Autofocus (%s): ", PxLFocusMetricName (result.m_metric));
+    if (API_SUCCESS (rc))
+    {
+        printf ("focus %.3f, score %.1f; %u frames (%u in the sweep), %u moves, in %.1f ms\n",
+                result.m_focus, result.m_score, result.m_frames, result.m_sweepFrames, result.m_moves,
+                result.m_duration * 1000.0);
+    } else {
+        printf ("failed with 0x%08X after %u frames\n", rc, result.m_frames);
+    }
+    if (! gCamera->supported(FEATURE_SHARPNESS_SCORE))
+    {
+        // The sharpness score is otherwise unused, so show the result there.
+        char cValue[40];
+        sprintf (cValue, "%u frames, %.0f ms", result.m_frames, result.m_duration * 1000.0);
+        gtk_entry_set_text (GTK_ENTRY (pLens->m_sharpnessScore), cValue);
+    }
+
+    pLens->m_focusSlider->setValue(result.m_focus);
+    gtk_widget_set_sensitive (pLens->m_focusOneTime, true);
+
+    return false;
+}
+
+static void *autofocusThread (PxLLens *pLens)
+{
+    pLens->m_autofocusRc = pLens->m_autofocus.search (pLens->m_autofocusCamera, pLens->m_autofocusResult);
+    pLens->m_autofocusFinished = true;
+    gdk_threads_add_idle ((GSourceFunc)AutofocusDone, pLens);
+    return NULL;
+}
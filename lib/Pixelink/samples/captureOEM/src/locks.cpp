@@ -0,0 +1,199 @@
+
+/***************************************************************************
+ *
+ *     File: locks.cpp
+ *
+ *     Description:
+ *       The locks used to serialize access to the camera, along with the
+ *       statistics they keep.
+ */
+
+#include <time.h>
+#include <algorithm>
+#include "locks.h"
+
+using namespace std;
+
+double PxLLockClock ()
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec + (double)now.tv_nsec / 1.0e9;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Public
+ * ---------------------------------------------------------------------------
+ */
+
+PxLLockStatistics::PxLLockStatistics ()
+: m_acquisitions(0)
+, m_contentions(0)
+, m_totalWait(0.0)
+, m_maxWait(0.0)
+, m_totalHeld(0.0)
+, m_maxHeld(0.0)
+{}
+
+void PxLLockStatistics::acquired (bool contended, double waited)
+{
+    m_acquisitions++;
+    if (contended)
+    {
+        m_contentions++;
+        m_totalWait += waited;
+        m_maxWait = max (m_maxWait, waited);
+    }
+}
+
+void PxLLockStatistics::released (double held)
+{
+    m_totalHeld += held;
+    m_maxHeld = max (m_maxHeld, held);
+}
+
+PxLMutex::PxLMutex ()
+: m_depth(0)
+, m_acquiredAt(0.0)
+{
+    pthread_mutexattr_t mutexAttr;
+
+    pthread_mutexattr_init (&mutexAttr);
+    pthread_mutexattr_settype (&mutexAttr, PTHREAD_MUTEX_RECURSIVE);
+    pthread_mutex_init (&m_mutex, &mutexAttr);
+    pthread_mutexattr_destroy (&mutexAttr);
+
+    pthread_mutex_init (&m_statsMutex, NULL);
+}
+
+PxLMutex::~PxLMutex ()
+{
+    pthread_mutex_destroy (&m_statsMutex);
+    pthread_mutex_destroy (&m_mutex);
+}
+
+void PxLMutex::lock ()
+{
+    // Only go to the trouble of timing the wait, if we actually have to wait.
+    bool contended = false;
+    double requestedAt = 0.0;
+    if (0 != pthread_mutex_trylock (&m_mutex))
+    {
+        contended = true;
+        requestedAt = PxLLockClock();
+        pthread_mutex_lock (&m_mutex);
+    }
+
+    if (m_depth++ > 0) return;  // Nested lock by the current owner
+
+    m_acquiredAt = PxLLockClock();
+    pthread_mutex_lock (&m_statsMutex);
+    m_stats.acquired (contended, m_acquiredAt - requestedAt);
+    pthread_mutex_unlock (&m_statsMutex);
+}
+
+void PxLMutex::unlock ()
+{
+    if (--m_depth == 0)
+    {
+        double held = PxLLockClock() - m_acquiredAt;
+        pthread_mutex_lock (&m_statsMutex);
+        m_stats.released (held);
+        pthread_mutex_unlock (&m_statsMutex);
+    }
+
+    pthread_mutex_unlock (&m_mutex);
+}
+
+PxLLockStatistics PxLMutex::statistics ()
+{
+    pthread_mutex_lock (&m_statsMutex);
+    PxLLockStatistics stats = m_stats;
+    pthread_mutex_unlock (&m_statsMutex);
+
+    return stats;
+}
+
+PxLRwLock::PxLRwLock ()
+{
+    pthread_rwlock_init (&m_lock, NULL);
+    pthread_mutex_init (&m_statsMutex, NULL);
+}
+
+PxLRwLock::~PxLRwLock ()
+{
+    pthread_mutex_destroy (&m_statsMutex);
+    pthread_rwlock_destroy (&m_lock);
+}
+
+double PxLRwLock::readLock ()
+{
+    bool contended = false;
+    double requestedAt = 0.0;
+    if (0 != pthread_rwlock_tryrdlock (&m_lock))
+    {
+        contended = true;
+        requestedAt = PxLLockClock();
+        pthread_rwlock_rdlock (&m_lock);
+    }
+
+    double acquiredAt = PxLLockClock();
+    pthread_mutex_lock (&m_statsMutex);
+    m_readStats.acquired (contended, acquiredAt - requestedAt);
+    pthread_mutex_unlock (&m_statsMutex);
+
+    return acquiredAt;
+}
+
+double PxLRwLock::writeLock ()
+{
+    bool contended = false;
+    double requestedAt = 0.0;
+    if (0 != pthread_rwlock_trywrlock (&m_lock))
+    {
+        contended = true;
+        requestedAt = PxLLockClock();
+        pthread_rwlock_wrlock (&m_lock);
+    }
+
+    double acquiredAt = PxLLockClock();
+    pthread_mutex_lock (&m_statsMutex);
+    m_writeStats.acquired (contended, acquiredAt - requestedAt);
+    pthread_mutex_unlock (&m_statsMutex);
+
+    return acquiredAt;
+}
+
+void PxLRwLock::unlock (bool writer, double acquiredAt)
+{
+    double held = PxLLockClock() - acquiredAt;
+
+    pthread_mutex_lock (&m_statsMutex);
+    if (writer)
+    {
+        m_writeStats.released (held);
+    } else {
+        m_readStats.released (held);
+    }
+    pthread_mutex_unlock (&m_statsMutex);
+
+    pthread_rwlock_unlock (&m_lock);
+}
+
+PxLLockStatistics PxLRwLock::readStatistics ()
+{
+    pthread_mutex_lock (&m_statsMutex);
+    PxLLockStatistics stats = m_readStats;
+    pthread_mutex_unlock (&m_statsMutex);
+
+    return stats;
+}
+
+PxLLockStatistics PxLRwLock::writeStatistics ()
+{
+    pthread_mutex_lock (&m_statsMutex);
+    PxLLockStatistics stats = m_writeStats;
+    pthread_mutex_unlock (&m_statsMutex);
+
+    return stats;
+}
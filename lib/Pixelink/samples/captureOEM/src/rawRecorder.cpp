@@ -0,0 +1,471 @@
+
+/***************************************************************************
+ *
+ *     File: rawRecorder.cpp
+ *
+ *     Description:
+ *       Lossless recording of the camera's frames, for the 'Video' tab in
+ *       CaptureOEM.  See rawRecorder.h for the file layout.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include "rawRecorder.h"
+#include "camera.h"
+#include "locks.h"
+#include "pixelAddress.h"
+#include "pixelFormat.h"
+
+using namespace std;
+
+#define RING_BYTES       (256*1024*1024)  // Frames buffered between the capture and writer threads
+#define MIN_RING_RECORDS 8
+#define MAX_WRITE_BYTES  (32*1024*1024)   // Largest single write
+
+static inline U64 RoundUp (U64 value, U64 multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+static void *captureThread (PxLRawRecorder *recorder);
+static void *writerThread (PxLRawRecorder *recorder);
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Public
+ * ---------------------------------------------------------------------------
+ */
+
+PxLRawRecordStatistics::PxLRawRecordStatistics ()
+: m_frames(0)
+, m_framesStreamed(0)
+, m_missingFrames(0)
+, m_staticFrames(0)
+, m_ringStalls(0)
+, m_writes(0)
+, m_bytesWritten(0)
+, m_maxWriteTime(0.0)
+, m_duration(0.0)
+, m_directIo(false)
+{
+}
+
+PxLRawRecorder::PxLRawRecorder ()
+: m_pCamera(NULL)
+, m_numFrames(0)
+, m_decimation(1)
+, m_termCallback(NULL)
+, m_skipStatic(false)
+, m_motion(PxLTemporalState::DEFAULT_MOTION_THRESHOLD)
+, m_fd(-1)
+, m_recordSize(0)
+, m_frameSize(0)
+, m_pHeader(NULL)
+, m_ring(NULL)
+, m_ringRecords(0)
+, m_head(0)
+, m_tail(0)
+, m_captureDone(false)
+, m_writeRc(ApiSuccess)
+, m_cancelled(false)
+, m_active(false)
+, m_captureThread(NULL)
+, m_writerThread(NULL)
+{
+    pthread_mutex_init (&m_ringMutex, NULL);
+    pthread_cond_init (&m_ringCond, NULL);
+}
+
+PxLRawRecorder::~PxLRawRecorder ()
+{
+    cancel();
+    if (m_captureThread) g_thread_join (m_captureThread);
+    release();
+    pthread_cond_destroy (&m_ringCond);
+    pthread_mutex_destroy (&m_ringMutex);
+}
+
+PXL_RETURN_CODE PxLRawRecorder::begin (PxLCamera* pCamera, LPCSTR fileName, U32 numFrames, U32 decimation,
+                                       bool directIo, ClipTerminationCallback termCallback)
+{
+    if (m_active) return ApiInvalidFunctionCallError;
+    if (NULL == pCamera || NULL == fileName || 0 == numFrames) return ApiInvalidParameterError;
+
+    // The previous recording is over, but its thread may not quite be done
+    if (m_captureThread) g_thread_join (m_captureThread);
+    m_captureThread = NULL;
+    release();
+
+    m_pCamera = pCamera;
+    m_fileName = fileName;
+    m_numFrames = numFrames;
+    m_decimation = max (decimation, (U32)1);
+    m_termCallback = termCallback;
+    m_head = m_tail = 0;
+    m_captureDone = false;
+    m_writeRc = ApiSuccess;
+    m_cancelled = false;
+    m_index.clear();
+    m_index.reserve (numFrames);
+    m_stats = PxLRawRecordStatistics();
+    m_motion.requestReset();   // Nothing to compare the first frame with
+
+    //
+    // Step 1
+    //      Size the records, and the ring of them.  Each record is a whole number of blocks, so that the
+    //      records can be written directly from the ring, wherever they are in it.
+    m_frameSize = pCamera->imageSizeInBytes();
+    if (0 == m_frameSize) return ApiUnknownError;
+    m_recordSize = (U32)RoundUp (sizeof(PxLRawFrameHeader) + m_frameSize, RAW_BLOCK_SIZE);
+    m_ringRecords = max ((U32)MIN_RING_RECORDS, (U32)(RING_BYTES / m_recordSize));
+    m_ringRecords = min (m_ringRecords, numFrames);
+    void* pMem = NULL;
+    if (posix_memalign (&pMem, RAW_BLOCK_SIZE, (size_t)m_ringRecords * m_recordSize) != 0) return ApiOutOfMemoryError;
+    m_ring = (U8*)pMem;
+    if (posix_memalign (&pMem, RAW_BLOCK_SIZE, RAW_BLOCK_SIZE) != 0)
+    {
+        release();
+        return ApiOutOfMemoryError;
+    }
+    m_pHeader = (PxLRawFileHeader*)pMem;
+    memset (m_pHeader, 0, RAW_BLOCK_SIZE);
+
+    //
+    // Step 2
+    //      Create the file, and reserve the space for the entire recording.  Not all file systems support
+    //      O_DIRECT; if this one doesn't, we simply write through the page cache.
+    m_fd = -1;
+    if (directIo)
+    {
+        m_fd = ::open (fileName, O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        m_stats.m_directIo = m_fd >= 0;
+    }
+    if (m_fd < 0) m_fd = ::open (fileName, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0)
+    {
+        release();
+        return ApiIOError;
+    }
+
+    const U64 indexSize = RoundUp ((U64)numFrames * sizeof(PxLRawIndexEntry) + sizeof(PxLRawTrailer), RAW_BLOCK_SIZE);
+    const U64 fileSize = RAW_BLOCK_SIZE + (U64)numFrames * m_recordSize + indexSize;
+    if (fallocate (m_fd, 0, 0, (off_t)fileSize) != 0 && errno != EOPNOTSUPP && errno != ENOSYS)
+    {
+        PXL_RETURN_CODE rc = errno == ENOSPC ? ApiDiskFullError : ApiIOError;
+        ::close (m_fd);
+        m_fd = -1;
+        remove (fileName);
+        release();
+        return rc;
+    }
+
+    //
+    // Step 3
+    //      The header, as it will be if the recording never finishes.
+    memcpy (m_pHeader->magic, RAW_FILE_MAGIC, sizeof(m_pHeader->magic));
+    m_pHeader->headerSize = RAW_BLOCK_SIZE;
+    m_pHeader->recordSize = m_recordSize;
+    m_pHeader->frameHeaderSize = sizeof(PxLRawFrameHeader);
+    m_pHeader->frameSize = m_frameSize;
+    m_pHeader->serialNumber = pCamera->serialNum();
+    m_pHeader->decimation = m_decimation;
+    float value;
+    if (API_SUCCESS (pCamera->getValue (FEATURE_PIXEL_FORMAT, &value))) m_pHeader->pixelFormat = (U32)value;
+    if (API_SUCCESS (pCamera->getValue (FEATURE_ACTUAL_FRAME_RATE, &value)) ||
+        API_SUCCESS (pCamera->getValue (FEATURE_FRAME_RATE, &value))) m_pHeader->frameRate = value;
+    PXL_RETURN_CODE rc = writeAt (m_pHeader, RAW_BLOCK_SIZE, 0);
+    if (!API_SUCCESS (rc))
+    {
+        ::close (m_fd);
+        m_fd = -1;
+        remove (fileName);
+        release();
+        return rc;
+    }
+
+    m_active = true;
+    m_writerThread = g_thread_new ("rawWriterThread", (GThreadFunc)writerThread, this);
+    m_captureThread = g_thread_new ("rawCaptureThread", (GThreadFunc)captureThread, this);
+
+    return ApiSuccess;
+}
+
+void PxLRawRecorder::skipStaticFrames (bool skip, U8 motionThreshold, int blockPercent)
+{
+    if (m_active) return;
+
+    m_skipStatic = skip;
+    m_motion.setNoiseFloor (motionThreshold);
+    m_motion.setBlockPercent (blockPercent);
+}
+
+void PxLRawRecorder::cancel ()
+{
+    m_cancelled = true;
+}
+
+PxLRawRecordStatistics PxLRawRecorder::statistics ()
+{
+    return m_stats;
+}
+
+void PxLRawRecorder::captureFrames ()
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    const double startTime = PxLLockClock();
+    bool haveFrame = false;
+    U64  firstFrameNumber = 0;
+    U64  lastFrameNumber = 0;
+    U32  framesSeen = 0;
+
+    while (m_stats.m_frames < m_numFrames && ! m_cancelled)
+    {
+        //
+        // Step 1
+        //      Wait for a free record.  If we have to wait here, the disk isn't keeping up, and the camera
+        //      will (eventually) drop frames; we will see them as gaps in the frame numbers.
+        pthread_mutex_lock (&m_ringMutex);
+        if (m_head - m_tail == m_ringRecords) m_stats.m_ringStalls++;
+        while (m_head - m_tail == m_ringRecords && API_SUCCESS (m_writeRc)) pthread_cond_wait (&m_ringCond, &m_ringMutex);
+        rc = m_writeRc;
+        pthread_mutex_unlock (&m_ringMutex);
+        if (!API_SUCCESS (rc)) break;
+
+        //
+        // Step 2
+        //      Grab the frame straight into the record
+        U8* pRecord = m_ring + (size_t)(m_head % m_ringRecords) * m_recordSize;
+        PxLRawFrameHeader* pFrameHeader = (PxLRawFrameHeader*)pRecord;
+        FRAME_DESC frameDesc;
+        rc = m_pCamera->getNextFrame (m_frameSize, pRecord + sizeof(PxLRawFrameHeader), &frameDesc);
+        if (!API_SUCCESS (rc))
+        {
+            if (m_cancelled) rc = ApiSuccess;   // The stream was cycled to cancel us
+            break;
+        }
+        const double hostTime = PxLLockClock() - startTime;
+
+        //
+        // Step 3
+        //      Look for frames that the camera numbered, but we didn't get.
+        const U64 frameNumber = frameDesc.u64FrameNumber ? frameDesc.u64FrameNumber : frameDesc.uFrameNumber;
+        if (haveFrame && frameNumber > lastFrameNumber + 1)
+        {
+            const U64 missing = frameNumber - lastFrameNumber - 1;
+            m_stats.m_missingFrames += missing;
+            if (m_stats.m_gaps.size() < PxLRawRecordStatistics::MAX_GAPS)
+            {
+                m_stats.m_gaps.push_back (PxLRawGap (lastFrameNumber + 1, missing));
+            }
+        }
+        if (! haveFrame || frameNumber < lastFrameNumber) firstFrameNumber = frameNumber - m_stats.m_framesStreamed;
+        haveFrame = true;
+        lastFrameNumber = frameNumber;
+        m_stats.m_framesStreamed = frameNumber - firstFrameNumber + 1;
+
+        if ((framesSeen++ % m_decimation) != 0) continue;   // The record is reused for the next frame
+
+        //
+        // Step 4
+        //      Leave out frames of a static scene.  The first frame is always kept; it is what the next ones
+        //      are compared with.  The motion detector treats 8 bit Bayer samples as it does mono ones.
+        if (m_skipStatic && 1.0f == PxLPixelFormat::bytesPerPixel ((U32)frameDesc.PixelFormat.fValue) &&
+            API_SUCCESS (m_motion.detectMotion (pRecord + sizeof(PxLRawFrameHeader), PIXEL_FORMAT_MONO8, &frameDesc, false)) &&
+            m_stats.m_frames > 0 && ! m_motion.sceneChanged())
+        {
+            m_stats.m_staticFrames++;
+            continue;
+        }
+
+        //
+        // Step 5
+        //      Describe the frame, and hand it to the writer.
+        int decX = max (1, (int)frameDesc.PixelAddressingValue.fHorizontal);
+        int decY = max (1, (int)frameDesc.PixelAddressingValue.fVertical);
+        int width = DEC_SIZE ((int)frameDesc.Roi.fWidth, decX);
+        int height = DEC_SIZE ((int)frameDesc.Roi.fHeight, decY);
+        if (0 == m_stats.m_frames)
+        {
+            m_pHeader->pixelFormat = (U32)frameDesc.PixelFormat.fValue;
+            m_pHeader->width = (U32)width;
+            m_pHeader->height = (U32)height;
+        }
+        memset (pFrameHeader, 0, sizeof(PxLRawFrameHeader));
+        pFrameHeader->magic = RAW_FRAME_MAGIC;
+        pFrameHeader->frameSize = m_frameSize;
+        pFrameHeader->frameNumber = frameNumber;
+        pFrameHeader->frameTime = frameDesc.dFrameTime != 0.0 ? frameDesc.dFrameTime : frameDesc.fFrameTime;
+        pFrameHeader->hostTime = hostTime;
+        pFrameHeader->shutter = frameDesc.Shutter.fValue;
+        pFrameHeader->gain = frameDesc.Gain.fValue;
+        pFrameHeader->pixelFormat = (U32)frameDesc.PixelFormat.fValue;
+        pFrameHeader->width = (U16)width;
+        pFrameHeader->height = (U16)height;
+        pFrameHeader->hdrMode = frameDesc.HDRInfo.uMode;
+
+        PxLRawIndexEntry entry;
+        entry.frameNumber = frameNumber;
+        entry.offset = RAW_BLOCK_SIZE + (U64)m_stats.m_frames * m_recordSize;
+        entry.frameTime = pFrameHeader->frameTime;
+        m_index.push_back (entry);
+        m_stats.m_frames++;
+
+        pthread_mutex_lock (&m_ringMutex);
+        m_head++;
+        pthread_cond_broadcast (&m_ringCond);
+        pthread_mutex_unlock (&m_ringMutex);
+    }
+
+    //
+    // Step 6
+    //      Let the writer drain the ring, then complete the file.
+    pthread_mutex_lock (&m_ringMutex);
+    m_captureDone = true;
+    pthread_cond_broadcast (&m_ringCond);
+    pthread_mutex_unlock (&m_ringMutex);
+    g_thread_join (m_writerThread);
+    m_writerThread = NULL;
+    m_stats.m_duration = PxLLockClock() - startTime;
+
+    if (API_SUCCESS (rc)) rc = m_writeRc;
+    PXL_RETURN_CODE finishRc = finish();
+    if (API_SUCCESS (rc)) rc = finishRc;
+    if (API_SUCCESS (rc) && m_stats.m_missingFrames > 0) rc = ApiSuccessWithFrameLoss;
+
+    m_active = false;
+    if (m_termCallback) m_termCallback (0, (U32)m_stats.m_framesStreamed, rc);
+}
+
+void PxLRawRecorder::writeRecords ()
+{
+    for (;;)
+    {
+        pthread_mutex_lock (&m_ringMutex);
+        while (m_head == m_tail && ! m_captureDone) pthread_cond_wait (&m_ringCond, &m_ringMutex);
+        if (m_head == m_tail)
+        {
+            pthread_mutex_unlock (&m_ringMutex);
+            break;
+        }
+        // Write as many records as we can, in one go; up to the end of the ring.
+        const U32 first = m_tail;
+        const U32 ringPos = first % m_ringRecords;
+        U32 count = min (m_head - first, m_ringRecords - ringPos);
+        count = max ((U32)1, min (count, (U32)(MAX_WRITE_BYTES / m_recordSize)));
+        pthread_mutex_unlock (&m_ringMutex);
+
+        PXL_RETURN_CODE rc = writeAt (m_ring + (size_t)ringPos * m_recordSize,
+                                      (size_t)count * m_recordSize,
+                                      RAW_BLOCK_SIZE + (U64)first * m_recordSize);
+
+        pthread_mutex_lock (&m_ringMutex);
+        m_tail += count;
+        if (!API_SUCCESS (rc)) m_writeRc = rc;
+        pthread_cond_broadcast (&m_ringCond);
+        pthread_mutex_unlock (&m_ringMutex);
+        if (!API_SUCCESS (rc)) break;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Private
+ * ---------------------------------------------------------------------------
+ */
+
+PXL_RETURN_CODE PxLRawRecorder::writeAt (const void* pData, size_t size, U64 offset)
+{
+    const double startTime = PxLLockClock();
+    const U8* pBytes = (const U8*)pData;
+    while (size > 0)
+    {
+        ssize_t written = pwrite (m_fd, pBytes, size, (off_t)offset);
+        if (written < 0)
+        {
+            if (errno == EINTR) continue;
+            // Some file systems accept O_DIRECT on open, but not on write; carry on without it.
+            if (errno == EINVAL && m_stats.m_directIo)
+            {
+                fcntl (m_fd, F_SETFL, fcntl (m_fd, F_GETFL) & ~O_DIRECT);
+                m_stats.m_directIo = false;
+                continue;
+            }
+            return errno == ENOSPC ? ApiDiskFullError : ApiIOError;
+        }
+        pBytes += written;
+        offset += written;
+        size -= written;
+        m_stats.m_bytesWritten += written;
+    }
+    m_stats.m_writes++;
+    m_stats.m_maxWriteTime = max (m_stats.m_maxWriteTime, PxLLockClock() - startTime);
+    return ApiSuccess;
+}
+
+// Writes the index and trailer, trims the file to the frames actually recorded, and completes the header.
+PXL_RETURN_CODE PxLRawRecorder::finish ()
+{
+    PXL_RETURN_CODE rc = m_writeRc;
+    const U64 indexOffset = RAW_BLOCK_SIZE + (U64)m_stats.m_frames * m_recordSize;
+    const size_t indexBytes = m_index.size() * sizeof(PxLRawIndexEntry);
+    const size_t trailerBytes = (size_t)RoundUp (indexBytes + sizeof(PxLRawTrailer), RAW_BLOCK_SIZE);
+
+    void* pMem = NULL;
+    if (API_SUCCESS (rc) && posix_memalign (&pMem, RAW_BLOCK_SIZE, trailerBytes) != 0) rc = ApiOutOfMemoryError;
+    if (API_SUCCESS (rc))
+    {
+        U8* pTrailerBlock = (U8*)pMem;
+        memset (pTrailerBlock, 0, trailerBytes);
+        if (indexBytes) memcpy (pTrailerBlock, &m_index[0], indexBytes);
+        PxLRawTrailer* pTrailer = (PxLRawTrailer*)(pTrailerBlock + trailerBytes - sizeof(PxLRawTrailer));
+        memcpy (pTrailer->magic, RAW_TRAILER_MAGIC, sizeof(pTrailer->magic));
+        pTrailer->frames = m_index.size();
+        pTrailer->indexOffset = indexOffset;
+        pTrailer->missingFrames = m_stats.m_missingFrames;
+        rc = writeAt (pTrailerBlock, trailerBytes, indexOffset);
+        free (pMem);
+    }
+
+    // Give back the space we reserved, but did not use
+    if (API_SUCCESS (rc) && ftruncate (m_fd, (off_t)(indexOffset + trailerBytes)) != 0) rc = ApiIOError;
+
+    if (API_SUCCESS (rc))
+    {
+        m_pHeader->frames = m_index.size();
+        m_pHeader->indexOffset = indexOffset;
+        m_pHeader->missingFrames = m_stats.m_missingFrames;
+        rc = writeAt (m_pHeader, RAW_BLOCK_SIZE, 0);
+    }
+    if (API_SUCCESS (rc) && fdatasync (m_fd) != 0) rc = ApiIOError;
+    if (::close (m_fd) != 0 && API_SUCCESS (rc)) rc = ApiIOError;
+    m_fd = -1;
+
+    release();
+    return rc;
+}
+
+void PxLRawRecorder::release ()
+{
+    free (m_ring);
+    m_ring = NULL;
+    free (m_pHeader);
+    m_pHeader = NULL;
+    if (m_fd >= 0) ::close (m_fd);
+    m_fd = -1;
+    vector<PxLRawIndexEntry>().swap (m_index);
+}
+
+static void *captureThread (PxLRawRecorder *recorder)
+{
+    recorder->captureFrames();
+    return NULL;
+}
+
+static void *writerThread (PxLRawRecorder *recorder)
+{
+    recorder->writeRecords();
+    return NULL;
+}
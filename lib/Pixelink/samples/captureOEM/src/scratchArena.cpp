@@ -0,0 +1,96 @@
+
+/***************************************************************************
+ *
+ *     File: scratchArena.cpp
+ *
+ *     Description:
+ *       A simple 'bump' allocator for the temporary buffers used by the
+ *       preview filters in CaptureOEM.
+ */
+
+#include <stdlib.h>
+#include <algorithm>
+#include "scratchArena.h"
+
+using namespace std;
+
+// Round a size up to our alignment
+#define ARENA_ROUND(bytes) (((bytes) + PxLScratchArena::ALIGNMENT - 1) & ~(PxLScratchArena::ALIGNMENT - 1))
+
+static void* AlignedAlloc (size_t bytes)
+{
+    void* pMem = NULL;
+    if (posix_memalign (&pMem, PxLScratchArena::ALIGNMENT, max (bytes, (size_t)PxLScratchArena::ALIGNMENT)) != 0)
+    {
+        return NULL;
+    }
+    return pMem;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Public
+ * ---------------------------------------------------------------------------
+ */
+
+PxLScratchArena::PxLScratchArena ()
+: m_base(NULL)
+, m_capacity(0)
+, m_used(0)
+, m_peakUsage(0)
+, m_lastUsage(0)
+, m_growCount(0)
+{
+}
+
+PxLScratchArena::~PxLScratchArena ()
+{
+    reset();
+    free (m_base);
+}
+
+void PxLScratchArena::reset ()
+{
+    m_lastUsage = m_used;
+    if (m_used > m_peakUsage) m_peakUsage = m_used;
+
+    if (! m_overflow.empty())
+    {
+        for (size_t i = 0; i < m_overflow.size(); i++) free (m_overflow[i]);
+        m_overflow.clear();
+
+        // The last frame didn't fit; grow so that the next one will.  We don't bother keeping the old
+        // contents, so there is no need for a realloc.
+        void* pNewBase = AlignedAlloc (m_used);
+        if (pNewBase)
+        {
+            free (m_base);
+            m_base = static_cast<U8*>(pNewBase);
+            m_capacity = m_used;
+            m_growCount++;
+        }
+    }
+
+    m_used = 0;
+}
+
+void* PxLScratchArena::alloc (size_t bytes)
+{
+    const size_t rounded = ARENA_ROUND (bytes);
+
+    if (m_used + rounded <= m_capacity)
+    {
+        void* pMem = m_base + m_used;
+        m_used += rounded;
+        return pMem;
+    }
+
+    // Doesn't fit -- use the heap for this frame.  Note that m_used still tracks the total requirement
+    // for the frame, so that the arena can be resized accordingly on the next reset.
+    void* pMem = AlignedAlloc (rounded);
+    if (pMem)
+    {
+        m_overflow.push_back (pMem);
+        m_used += rounded;
+    }
+    return pMem;
+}
@@ -0,0 +1,461 @@
+
+/***************************************************************************
+ *
+ *     File: settingsTransaction.cpp
+ *
+ *     Description:
+ *       A set of feature changes that are made together, with at most one
+ *       interruption of the stream.
+ */
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include "settingsTransaction.h"
+
+using namespace std;
+
+// There is no feature with this id; used to indicate that no feature failed.
+static const ULONG NO_FEATURE = FEATURE_ALL;
+
+//
+// The order in which features are changed.  Features that define the image come first, then the
+// ROI (which must fit within that image), then the ROIs that must fit within the ROI.  Frame rate and
+// exposure limit each other, so which goes first depends on which way the frame rate is going.
+class PxLSettingsChangeOrder
+{
+public:
+    PxLSettingsChangeOrder (bool framerateFirst) : m_framerateFirst(framerateFirst) {}
+
+    int rank (ULONG feature) const
+    {
+        switch (feature)
+        {
+        case FEATURE_SPECIAL_CAMERA_MODE:
+        case FEATURE_GAIN_HDR:
+        case FEATURE_PIXEL_FORMAT:
+        case FEATURE_PIXEL_ADDRESSING:
+        case FEATURE_FLIP:
+        case FEATURE_ROTATE:
+            return 0;
+        case FEATURE_ROI:
+            return 1;
+        case FEATURE_AUTO_ROI:
+        case FEATURE_SHARPNESS_SCORE:
+            return 2;
+        case FEATURE_FRAME_RATE:
+            return m_framerateFirst ? 3 : 4;
+        case FEATURE_EXPOSURE:
+            return m_framerateFirst ? 4 : 3;
+        default:
+            return 5;
+        }
+    }
+
+    bool operator() (const PxLSettingsChange& lhs, const PxLSettingsChange& rhs) const
+    {
+        return rank (lhs.m_feature) < rank (rhs.m_feature);
+    }
+
+private:
+    bool m_framerateFirst;
+};
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Public
+ * ---------------------------------------------------------------------------
+ */
+
+PxLSettingsChange::PxLSettingsChange (ULONG feature, ULONG flags, ULONG numParams, const float* params)
+: m_feature(feature)
+, m_flags(flags)
+, m_params(params, params + numParams)
+, m_applied(false)
+, m_oldFlags(0)
+{}
+
+PxLSettingsTransaction::PxLSettingsTransaction (PxLCamera* pCamera)
+: m_pCamera(pCamera)
+, m_committed(false)
+, m_failedFeature(NO_FEATURE)
+, m_duration(0.0)
+, m_streamInterruptions(0)
+{
+    const char* stats = getenv ("PXL_TRANSACTION_STATS");
+    m_reportStatistics = stats != NULL;
+    m_individually = stats != NULL && 0 == strcmp (stats, "individual");
+}
+
+void PxLSettingsTransaction::setValue (ULONG feature, float value)
+{
+    setFeature (feature, FEATURE_FLAG_MANUAL, 1, &value);
+}
+
+void PxLSettingsTransaction::setPixelAddressValues (float mode, float valueX, float valueY)
+{
+    float featureValue[4];
+
+    featureValue[FEATURE_PIXEL_ADDRESSING_PARAM_MODE] = mode;
+    featureValue[FEATURE_PIXEL_ADDRESSING_PARAM_VALUE] = valueX;
+    featureValue[FEATURE_PIXEL_ADDRESSING_PARAM_X_VALUE] = valueX;
+    featureValue[FEATURE_PIXEL_ADDRESSING_PARAM_Y_VALUE] = valueY;
+
+    setFeature (FEATURE_PIXEL_ADDRESSING, FEATURE_FLAG_MANUAL, 4, featureValue);
+}
+
+//
+// Note that the ROI is converted to the camera's orientation now, using the current flip and rotate.
+PXL_RETURN_CODE PxLSettingsTransaction::setRoiValue (ROI_TYPE type, PXL_ROI &roi)
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    ULONG numParams = 5;
+    float featureValue[5];
+    ULONG flags;
+    PXL_ROI adjustedRoi = roi;
+
+    ULONG feature;
+    switch (type)
+    {
+    case SharpnessScoreRoi:
+        feature = FEATURE_SHARPNESS_SCORE;
+        break;
+    case AutoRoi:
+        feature = FEATURE_AUTO_ROI;
+        break;
+    case FrameRoi:
+    default:
+        feature = FEATURE_ROI;
+        break;
+    }
+
+    // Start with the current value, so that any parameters beyond the ROI itself are left alone
+    rc = m_pCamera->getFeature (feature, &flags, &numParams, featureValue);
+    if (!API_SUCCESS(rc)) return rc;
+
+    rc = m_pCamera->untransformRoi (type, adjustedRoi);
+    if (!API_SUCCESS(rc)) return rc;
+
+    featureValue[FEATURE_ROI_PARAM_WIDTH] = (float)adjustedRoi.m_width;
+    featureValue[FEATURE_ROI_PARAM_HEIGHT] = (float)adjustedRoi.m_height;
+    featureValue[FEATURE_ROI_PARAM_LEFT] = (float)adjustedRoi.m_offsetX;
+    featureValue[FEATURE_ROI_PARAM_TOP] = (float)adjustedRoi.m_offsetY;
+
+    setFeature (feature, FEATURE_FLAG_MANUAL, numParams, featureValue);
+
+    return ApiSuccess;
+}
+
+// If the same feature is changed more than once, only the last change is kept
+void PxLSettingsTransaction::setFeature (ULONG feature, ULONG flags, ULONG numParams, const float* params)
+{
+    PxLSettingsChange change (feature, flags, numParams, params);
+
+    for (size_t i = 0; i < m_changes.size(); i++)
+    {
+        if (m_changes[i].m_feature == feature)
+        {
+            m_changes[i] = change;
+            return;
+        }
+    }
+    m_changes.push_back (change);
+    m_committed = false;
+}
+
+void PxLSettingsTransaction::remove (ULONG feature)
+{
+    for (size_t i = 0; i < m_changes.size(); i++)
+    {
+        if (m_changes[i].m_feature == feature)
+        {
+            m_changes.erase (m_changes.begin() + i);
+            m_committed = false;
+            return;
+        }
+    }
+}
+
+PXL_RETURN_CODE PxLSettingsTransaction::commit ()
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    double start = PxLLockClock();
+
+    m_failedFeature = NO_FEATURE;
+    m_streamInterruptions = 0;
+    m_committed = false;
+    if (m_changes.empty()) return ApiSuccess;
+
+    //
+    // Step 1
+    //      Make sure all of the changes are within the limits of the features, before we change anything
+    rc = validate();
+
+    //
+    // Step 2
+    //      Remember how things were, so that the changes can be undone
+    if (API_SUCCESS(rc))
+    {
+        order();
+        rc = readOldValues();
+    }
+
+    //
+    // Step 3
+    //      Make the changes
+    if (API_SUCCESS(rc))
+    {
+        rc = m_individually ? applyIndividually (false) : apply (false);
+        m_committed = API_SUCCESS(rc);
+    }
+
+    m_duration = PxLLockClock() - start;
+    report ("commit", rc);
+
+    return rc;
+}
+
+PXL_RETURN_CODE PxLSettingsTransaction::rollback ()
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+
+    if (! m_committed) return ApiSuccess;
+
+    double start = PxLLockClock();
+    m_streamInterruptions = 0;
+
+    rc = m_individually ? applyIndividually (true) : apply (true);
+    m_committed = false;
+
+    m_duration = PxLLockClock() - start;
+    report ("rollback", rc);
+
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Private
+ * ---------------------------------------------------------------------------
+ */
+
+//
+// Only the features whose limits are fixed can be checked up front.  The limits of FEATURE_FLAG_VOLATILE
+// features (the frame rate's maximum, for one) depend on the other features, so what they are now says
+// nothing about whether the change is valid after the others in the transaction are made; those are left
+// to the camera, when the changes are applied in order (see apply).
+PXL_RETURN_CODE PxLSettingsTransaction::validate ()
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    vector<FEATURE_PARAM> limits;
+
+    for (size_t i = 0; i < m_changes.size(); i++)
+    {
+        const PxLSettingsChange& change = m_changes[i];
+
+        ULONG flags = 0;
+        rc = m_pCamera->getFlags (change.m_feature, &flags);
+        if (!API_SUCCESS(rc))
+        {
+            m_failedFeature = change.m_feature;
+            return rc;
+        }
+        if (flags & FEATURE_FLAG_VOLATILE) continue;
+
+        rc = m_pCamera->getParamLimits (change.m_feature, limits);
+        if (!API_SUCCESS(rc))
+        {
+            m_failedFeature = change.m_feature;
+            return rc;
+        }
+
+        // The parameters of a feature being turned off don't matter
+        if (change.m_flags & FEATURE_FLAG_OFF) continue;
+
+        size_t numParams = min (limits.size(), change.m_params.size());
+        for (size_t j = 0; j < numParams; j++)
+        {
+            if (change.m_params[j] < limits[j].fMinValue || change.m_params[j] > limits[j].fMaxValue)
+            {
+                m_failedFeature = change.m_feature;
+                return ApiInvalidParameterError;
+            }
+        }
+    }
+
+    return ApiSuccess;
+}
+
+void PxLSettingsTransaction::order ()
+{
+    // If the frame rate is going down, then set it before the exposure (which may be going up); if it
+    // is going up, then set the exposure (which may be going down) first.
+    bool framerateFirst = false;
+    for (size_t i = 0; i < m_changes.size(); i++)
+    {
+        float framerate;
+        if (m_changes[i].m_feature == FEATURE_FRAME_RATE &&
+            API_SUCCESS (m_pCamera->getValue (FEATURE_FRAME_RATE, &framerate)))
+        {
+            framerateFirst = m_changes[i].m_params[0] < framerate;
+        }
+    }
+
+    stable_sort (m_changes.begin(), m_changes.end(), PxLSettingsChangeOrder (framerateFirst));
+}
+
+PXL_RETURN_CODE PxLSettingsTransaction::readOldValues ()
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+
+    for (size_t i = 0; i < m_changes.size(); i++)
+    {
+        PxLSettingsChange& change = m_changes[i];
+        ULONG numParams = change.m_params.size();
+        vector<float> params (numParams);
+
+        change.m_applied = false;
+        rc = m_pCamera->getFeature (change.m_feature, &change.m_oldFlags, &numParams, &params[0]);
+        if (!API_SUCCESS(rc))
+        {
+            m_failedFeature = change.m_feature;
+            return rc;
+        }
+        change.m_oldParams.assign (params.begin(), params.begin() + numParams);
+    }
+
+    return ApiSuccess;
+}
+
+//
+// Make all of the changes (or if restoring, put back all of the old values), stopping the stream once
+// if any of them need it.  The feature lock is held throughout, so no one sees the camera half way.
+PXL_RETURN_CODE PxLSettingsTransaction::apply (bool restore)
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    PXL_RETURN_CODE lastError = ApiSuccess;
+
+    //
+    // Step 1
+    //      Stop the stream, if any of the changes require it.  Note that the stream lock must be
+    //      taken before the feature lock.
+    bool stopRequired = false;
+    for (size_t i = 0; i < m_changes.size() && !stopRequired; i++)
+    {
+        stopRequired = m_pCamera->requiresStreamStop (m_changes[i].m_feature);
+    }
+    std::auto_ptr<PxLInterruptStream> interruption(NULL);
+    if (stopRequired)
+    {
+        if (m_pCamera->m_streamState != STOP_STREAM) m_streamInterruptions++;
+        interruption = std::auto_ptr<PxLInterruptStream>(new PxLInterruptStream(m_pCamera, STOP_STREAM));
+    }
+
+    PxLAutoWriteLock lock(&m_pCamera->m_featureLock);
+
+    //
+    // Step 2
+    //      Make the changes in order, or undo them in the reverse order.  A change the camera rejects
+    //      may only be valid after one of the others, so keep retrying while we are making progress.
+    vector<size_t> pending;
+    for (size_t i = 0; i < m_changes.size(); i++)
+    {
+        size_t index = restore ? m_changes.size() - 1 - i : i;
+        if (!restore || m_changes[index].m_applied) pending.push_back (index);
+    }
+    vector<size_t> applied;
+    while (! pending.empty())
+    {
+        vector<size_t> failed;
+        for (size_t i = 0; i < pending.size(); i++)
+        {
+            PxLSettingsChange& change = m_changes[pending[i]];
+            if (restore)
+            {
+                rc = m_pCamera->applyFeature (change.m_feature, change.m_oldFlags,
+                                              change.m_oldParams.size(), &change.m_oldParams[0]);
+            } else {
+                rc = m_pCamera->applyFeature (change.m_feature, change.m_flags,
+                                              change.m_params.size(), &change.m_params[0]);
+            }
+            if (API_SUCCESS(rc))
+            {
+                change.m_applied = !restore;
+                applied.push_back (pending[i]);
+            } else {
+                failed.push_back (pending[i]);
+                lastError = rc;
+            }
+        }
+        if (failed.size() == pending.size()) break;  // No progress
+        pending = failed;
+    }
+
+    if (pending.empty()) return ApiSuccess;
+    m_failedFeature = m_changes[pending[0]].m_feature;
+    if (restore) return lastError;  // We did what we could
+
+    //
+    // Step 3
+    //      Some of the changes could not be made; undo those that were, in the reverse order.
+    for (size_t i = applied.size(); i > 0; i--)
+    {
+        PxLSettingsChange& change = m_changes[applied[i-1]];
+        m_pCamera->applyFeature (change.m_feature, change.m_oldFlags,
+                                 change.m_oldParams.size(), &change.m_oldParams[0]);
+        change.m_applied = false;
+    }
+
+    return lastError;
+}
+
+//
+// Make the changes one at a time, the way they would be made without a transaction -- stopping the
+// stream for each of them that needs it.  Used to measure what the transaction saves.
+PXL_RETURN_CODE PxLSettingsTransaction::applyIndividually (bool restore)
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+
+    for (size_t i = 0; i < m_changes.size(); i++)
+    {
+        PxLSettingsChange& change = m_changes[restore ? m_changes.size() - 1 - i : i];
+        if (restore && !change.m_applied) continue;
+
+        std::auto_ptr<PxLInterruptStream> interruption(NULL);
+        if (m_pCamera->requiresStreamStop (change.m_feature))
+        {
+            if (m_pCamera->m_streamState != STOP_STREAM) m_streamInterruptions++;
+            interruption = std::auto_ptr<PxLInterruptStream>(new PxLInterruptStream(m_pCamera, STOP_STREAM));
+        }
+
+        if (restore)
+        {
+            m_pCamera->setFeature (change.m_feature, change.m_oldFlags, change.m_oldParams.size(), &change.m_oldParams[0]);
+            change.m_applied = false;
+            continue;
+        }
+
+        rc = m_pCamera->setFeature (change.m_feature, change.m_flags, change.m_params.size(), &change.m_params[0]);
+        if (!API_SUCCESS(rc))
+        {
+            m_failedFeature = change.m_feature;
+            interruption.reset();
+            applyIndividually (true);
+            return rc;
+        }
+        change.m_applied = true;
+    }
+
+    return ApiSuccess;
+}
+
+void PxLSettingsTransaction::report (const char* operation, PXL_RETURN_CODE rc)
+{
+    if (! m_reportStatistics) return;
+
+    printf ("Settings transaction %s (%s): %u changes in %.2f ms, %u stream interruption(s)",
+            operation, m_individually ? "one at a time" : "together",
+            (U32)m_changes.size(), m_duration * 1000.0, (U32)m_streamInterruptions);
+    if (!API_SUCCESS(rc)) printf (", failed with 0x%08X on feature %u", rc, (U32)m_failedFeature);
+    printf ("\n");
+}
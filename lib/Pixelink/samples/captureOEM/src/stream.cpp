@@ -11,6 +11,7 @@
 #include "stream.h"
 #include "cameraSelect.h"
 #include "camera.h"
+#include "settingsTransaction.h"
 #include "captureOEM.h"
 #include "controls.h"
 #include "preview.h"
@@ -298,30 +299,59 @@ void PxLStream::loadFfovImage(bool streamInterrupted)
 
             //
             // Step 4
+            //      The camera settings needed for the thumbnail are all changed together (and later restored
+            //      together), so the stream is interrupted at most once for each.
             //      If the camera is using Interleaved HDR, Put the camera in CAMERA_MODE hdr
-            bool   wasUsingInterleavedHdr = false;
+            PxLSettingsTransaction thumbnailSettings (gCamera);
             float  oldHdrMode;
             if (API_SUCCESS (gCamera->getValue (FEATURE_GAIN_HDR, &oldHdrMode)))
             {
                 if (oldHdrMode == FEATURE_GAIN_HDR_MODE_INTERLEAVED)
                 {
-                    wasUsingInterleavedHdr = true;
-                    gCamera->setValue (FEATURE_GAIN_HDR, FEATURE_GAIN_HDR_MODE_CAMERA);
+                    thumbnailSettings.setValue (FEATURE_GAIN_HDR, FEATURE_GAIN_HDR_MODE_CAMERA);
                 }
             }
 
             //
             // Step 5
-            //      Adjust the ROI if necessary
+            //      Adjust the ROI if necessary.  We only need a thumbnail, so if the stream is being reconfigured
+            //      anyway, also have the camera reduce the image using pixel addressing; there is then less to
+            //      transfer, and less to scale.
+            const int thumbnailWidth = m_roiButtonLimits.xMax - m_roiButtonLimits.xMin;
+            const int thumbnailHeight = m_roiButtonLimits.yMax - m_roiButtonLimits.yMin;
             bool rioAdjustmentNecessary = m_roi != m_maxRoi;
+            bool paAdjustmentNecessary = false;
+            float oldPaMode, oldPaValueX, oldPaValueY;
+            float thumbnailPaMode, thumbnailPaValue;
+            if ((rioAdjustmentNecessary || streamInterrupted) &&
+                thumbnailPixelAddressing (thumbnailWidth, thumbnailHeight, &thumbnailPaMode, &thumbnailPaValue) &&
+                API_SUCCESS (gCamera->getPixelAddressValues (&oldPaMode, &oldPaValueX, &oldPaValueY)))
+            {
+                paAdjustmentNecessary = oldPaMode != thumbnailPaMode ||
+                                        oldPaValueX != thumbnailPaValue ||
+                                        oldPaValueY != thumbnailPaValue;
+            }
             bool wasPreviewing = false;
-            if (rioAdjustmentNecessary)
+            if (rioAdjustmentNecessary || paAdjustmentNecessary)
             {
-                PXL_ROI ffov = m_maxRoi;
                 wasPreviewing = gCamera->previewing();
                 if (wasPreviewing) gCamera->pausePreview();
-                rc = gCamera->setRoiValue(FrameRoi, ffov);
-
+            }
+            if (rioAdjustmentNecessary)
+            {
+                PXL_ROI ffov = m_maxRoi;
+                thumbnailSettings.setRoiValue(FrameRoi, ffov);
+            }
+            if (paAdjustmentNecessary)
+            {
+                thumbnailSettings.setPixelAddressValues (thumbnailPaMode, thumbnailPaValue, thumbnailPaValue);
+            }
+            rc = thumbnailSettings.commit();
+            if (!API_SUCCESS(rc) && thumbnailSettings.failedFeature() == FEATURE_PIXEL_ADDRESSING)
+            {
+                // Not all pixel formats support pixel addressing.  If not, we simply scale the full image.
+                thumbnailSettings.remove (FEATURE_PIXEL_ADDRESSING);
+                rc = thumbnailSettings.commit();
             }
 
             //
@@ -331,60 +361,25 @@ void PxLStream::loadFfovImage(bool streamInterrupted)
 
             //
             // Step 7
-            //      Grab and format the image
-            std::vector<U8> frameBuf (gCamera->imageSizeInBytes());
-            FRAME_DESC     frameDesc;
-
-            rc = gCamera->getNextFrame(frameBuf.size(), &frameBuf[0], &frameDesc);
-            if (API_SUCCESS(rc))
+            //      Grab the image, and scale it to the ffov area.  Be sure to use the same aspect ratio as the
+            //      imager.  The thumbnail keeps its buffers, so refreshing the image does not allocate any memory.
+            GdkPixbuf* ffovImage = m_ffovThumbnail.grab (gCamera, thumbnailWidth, thumbnailHeight);
+            if (ffovImage)
             {
-
-                // Allocate an rgb Buffer.  the rgbBuffer may be bigger or smaller than the frame buffer, depending on
-                // the pixel format.  Play it safe, and deal with the worst case where we need 3 bytes for every pixel
-                std::vector<U8> rgbBuffer (frameBuf.size()*3);
-                rc = gCamera->formatRgbImage(&frameBuf[0], &frameDesc, rgbBuffer.size(), &rgbBuffer[0]);
-
-                if (API_SUCCESS(rc))
-                {
-                    //
-                    // Step 8
-                    //      Convert the rgb image into a ffov buffer.  Be sure to use the same aspect ratio as the imager
-
-
-                    GdkPixbuf  *tempPixBuf = gdk_pixbuf_new_from_data (
-                            &rgbBuffer[0], GDK_COLORSPACE_RGB, false, 8,
-                            (int)(frameDesc.Roi.fWidth / frameDesc.PixelAddressingValue.fHorizontal),
-                            (int)(frameDesc.Roi.fHeight / frameDesc.PixelAddressingValue.fVertical),
-                            (int)(frameDesc.Roi.fWidth / frameDesc.PixelAddressingValue.fHorizontal)*3, NULL, NULL);
-                    m_ffovBuf = gdk_pixbuf_scale_simple (tempPixBuf,
-                            m_roiButtonLimits.xMax - m_roiButtonLimits.xMin,
-                            m_roiButtonLimits.yMax - m_roiButtonLimits.yMin,
-                            GDK_INTERP_BILINEAR);
-                    gtk_image_set_from_pixbuf (GTK_IMAGE (m_ffovImage), m_ffovBuf);
-                }
+                m_ffovBuf = ffovImage;
+                gtk_image_set_from_pixbuf (GTK_IMAGE (m_ffovImage), m_ffovBuf);
             }
 
             //
-            // Step 9
-            //      Restore the ROI, preview, and stream as necessary
+            // Step 8
+            //      Restore the HDR mode, pixel addressing, ROI, preview, and stream as necessary
             if (streamInterrupted) gCamera->stopStream ();
-            if (rioAdjustmentNecessary)
-            {
-                gCamera->setRoiValue(FrameRoi, m_roi);
-                if (wasPreviewing) gCamera->playPreview();
-            }
-
-            //
-            // Step 10
-            //      If the camera was using Interleaved HDR, re-enable it
-            if (wasUsingInterleavedHdr)
-            {
-                gCamera->setValue (FEATURE_GAIN_HDR, oldHdrMode);
-            }
+            thumbnailSettings.rollback();
+            if (wasPreviewing) gCamera->playPreview();
         } else {
 
             //
-            // Step 11
+            // Step 9
             //      We can't grab an image.  Display the No Stream FFOV image (if we're not
             //      already displaying it
             if (m_ffovBuf == NULL)
@@ -399,6 +394,42 @@ void PxLStream::loadFfovImage(bool streamInterrupted)
     }
 }
 
+// Determines the pixel addressing the camera should use, when grabbing a FFOV image that will be scaled to
+// width x height.  That is, the largest supported (symmetric) value that still gives us at least that many
+// pixels.  Averaging and decimation keep the image's brightness; binning does not, so we don't use it.
+// Returns false if the camera can't usefully reduce the image.  Assumes m_maxRoi and the supported pixel
+// addressing values are valid.
+bool PxLStream::thumbnailPixelAddressing (int width, int height, float* mode, float* value)
+{
+    COEM_PIXEL_ADDRESS_MODES paMode;
+    if (find (m_supportedPixelAddressModes.begin(), m_supportedPixelAddressModes.end(), PA_AVERAGE) !=
+        m_supportedPixelAddressModes.end())
+    {
+        paMode = PA_AVERAGE;
+    } else if (find (m_supportedPixelAddressModes.begin(), m_supportedPixelAddressModes.end(), PA_DECIMATE) !=
+               m_supportedPixelAddressModes.end()) {
+        paMode = PA_DECIMATE;
+    } else {
+        return false;
+    }
+
+    float bestValue = 1.0f;
+    for (int i = 0; i < (int)m_supportedPixelAddressValues.size(); i++)
+    {
+        float valueX, valueY;
+        PxLPixelAddress::valueToApi (m_supportedPixelAddressValues[i], &valueX, &valueY);
+        if (valueX != valueY || valueX <= bestValue) continue;
+        if ((float)m_maxRoi.m_width / valueX < (float)width ||
+            (float)m_maxRoi.m_height / valueX < (float)height) continue;
+        bestValue = valueX;
+    }
+    if (bestValue <= 1.0f) return false;
+
+    *mode = PxLPixelAddress::modeToApi (paMode);
+    *value = bestValue;
+    return true;
+}
+
 // This will update the ROI button so that it reflects the current ROI.  Assumes m_roi and m_maxRoi are valid
 void PxLStream::updateRoiButton()
 {
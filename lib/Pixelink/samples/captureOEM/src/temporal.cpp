@@ -0,0 +1,380 @@
+
+/***************************************************************************
+ *
+ *     File: temporal.cpp
+ *
+ *     Description:
+ *       Per-stream state, and the absolute difference kernels, used by the
+ *       temporal filters in CaptureOEM.
+ *
+ *       The kernels work on spans of bytes (RGB samples are treated individually,
+ *       just as the original filters did), 16 bytes at a time using SSE2 or NEON
+ *       when available.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+#include <algorithm>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+#include "temporal.h"
+#include "pixelFormat.h"
+#include "pixelAddress.h"
+
+using namespace std;
+
+/* ---------------------------------------------------------------------------
+ * --   Absolute difference kernels
+ * ---------------------------------------------------------------------------
+ */
+
+//
+// For each sample, if |new - old| < noiseFloor, then the new sample takes on the old value.  Otherwise,
+// the history takes on the new value.  Either way, both end up with the same value.
+static void TemporalSpan (U8* pNew, U8* pOld, int n, U8 noiseFloor)
+{
+    int i = 0;
+    if (noiseFloor == 0)
+    {
+        // Nothing is below the noise floor; everything is new.
+        memcpy (pOld, pNew, n);
+        return;
+    }
+#if defined(__SSE2__)
+    const __m128i floorMinus1 = _mm_set1_epi8 ((char)(noiseFloor-1));
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i vNew = _mm_loadu_si128 ((__m128i*)(pNew+i));
+        __m128i vOld = _mm_loadu_si128 ((__m128i*)(pOld+i));
+        __m128i delta = _mm_or_si128 (_mm_subs_epu8 (vNew, vOld), _mm_subs_epu8 (vOld, vNew));
+        // delta < noiseFloor  <==> (delta - (noiseFloor-1)) saturates to 0
+        __m128i quiet = _mm_cmpeq_epi8 (_mm_subs_epu8 (delta, floorMinus1), zero);
+        __m128i result = _mm_or_si128 (_mm_and_si128 (quiet, vOld), _mm_andnot_si128 (quiet, vNew));
+        _mm_storeu_si128 ((__m128i*)(pNew+i), result);
+        _mm_storeu_si128 ((__m128i*)(pOld+i), result);
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t vFloor = vdupq_n_u8 (noiseFloor);
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16_t vNew = vld1q_u8 (pNew+i);
+        uint8x16_t vOld = vld1q_u8 (pOld+i);
+        uint8x16_t quiet = vcltq_u8 (vabdq_u8 (vNew, vOld), vFloor);
+        uint8x16_t result = vbslq_u8 (quiet, vOld, vNew);
+        vst1q_u8 (pNew+i, result);
+        vst1q_u8 (pOld+i, result);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        int delta = abs ((int)pNew[i] - (int)pOld[i]);
+        if (delta < noiseFloor)
+        {
+            pNew[i] = pOld[i];
+        } else {
+            pOld[i] = pNew[i];
+        }
+    }
+}
+
+//
+// For each sample, if |new - old| > threshold, then the sample is 'moving'; the history takes on the new value,
+// and (if mark is true) the new sample becomes 0xFF.  Other samples become 0x00 (if mark is true).
+// Returns the number of moving samples.
+static U32 MotionSpan (U8* pNew, U8* pOld, int n, U8 threshold, bool mark)
+{
+    int i = 0;
+    U32 moving = 0;
+#if defined(__SSE2__)
+    const __m128i vThreshold = _mm_set1_epi8 ((char)threshold);
+    const __m128i zero = _mm_setzero_si128();
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i vNew = _mm_loadu_si128 ((__m128i*)(pNew+i));
+        __m128i vOld = _mm_loadu_si128 ((__m128i*)(pOld+i));
+        __m128i delta = _mm_or_si128 (_mm_subs_epu8 (vNew, vOld), _mm_subs_epu8 (vOld, vNew));
+        // delta > threshold  <==> (delta - threshold) does not saturate to 0
+        __m128i still = _mm_cmpeq_epi8 (_mm_subs_epu8 (delta, vThreshold), zero);
+        int stillBits = _mm_movemask_epi8 (still);
+        if (stillBits != 0xFFFF)
+        {
+            moving += 16 - __builtin_popcount (stillBits);
+            _mm_storeu_si128 ((__m128i*)(pOld+i),
+                              _mm_or_si128 (_mm_and_si128 (still, vOld), _mm_andnot_si128 (still, vNew)));
+        }
+        if (mark) _mm_storeu_si128 ((__m128i*)(pNew+i), _mm_andnot_si128 (still, _mm_cmpeq_epi8 (zero, zero)));
+    }
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+    const uint8x16_t vThreshold = vdupq_n_u8 (threshold);
+    for (; i + 16 <= n; i += 16)
+    {
+        uint8x16_t vNew = vld1q_u8 (pNew+i);
+        uint8x16_t vOld = vld1q_u8 (pOld+i);
+        uint8x16_t move = vcgtq_u8 (vabdq_u8 (vNew, vOld), vThreshold);
+        // Each moving lane is 0xFF; shift down to 1 and sum the lanes.
+        uint64x2_t sum = vpaddlq_u32 (vpaddlq_u16 (vpaddlq_u8 (vshrq_n_u8 (move, 7))));
+        moving += (U32)(vgetq_lane_u64 (sum, 0) + vgetq_lane_u64 (sum, 1));
+        vst1q_u8 (pOld+i, vbslq_u8 (move, vNew, vOld));
+        if (mark) vst1q_u8 (pNew+i, move);
+    }
+#endif
+    for (; i < n; i++)
+    {
+        int delta = abs ((int)pNew[i] - (int)pOld[i]);
+        if (delta > threshold)
+        {
+            pOld[i] = pNew[i];
+            if (mark) pNew[i] = 0xFF;
+            moving++;
+        } else {
+            if (mark) pNew[i] = 0x00;
+        }
+    }
+    return moving;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Public
+ * ---------------------------------------------------------------------------
+ */
+
+PxLTemporalState::PxLTemporalState (U8 noiseFloor, int blockSize)
+: m_lastFrameSize(0)
+, m_lastFormat(0)
+, m_width(0)
+, m_height(0)
+, m_bytesPerPixel(0)
+, m_noiseFloor(noiseFloor)
+, m_blockPercent(DEFAULT_BLOCK_PERCENT)
+, m_resetRequested(0)
+, m_blockSize(max(1, blockSize))
+{
+    pthread_mutex_init (&m_resultLock, NULL);
+}
+
+PxLTemporalState::~PxLTemporalState ()
+{
+    pthread_mutex_destroy (&m_resultLock);
+}
+
+void PxLTemporalState::requestReset ()
+{
+    __sync_lock_test_and_set (&m_resetRequested, 1);
+}
+
+void PxLTemporalState::setNoiseFloor (U8 noiseFloor)
+{
+    m_noiseFloor = noiseFloor;
+}
+
+void PxLTemporalState::setBlockPercent (int percent)
+{
+    m_blockPercent = min (100, max (0, percent));
+}
+
+U32 PxLTemporalState::temporalFilter (void* pFrameData, U32 pixelFormat, FRAME_DESC const * pFrameDesc)
+{
+    switch (pixelFormat)
+    {
+        case PIXEL_FORMAT_RGB24:
+        case PIXEL_FORMAT_RGB24_NON_DIB:
+        case PIXEL_FORMAT_MONO8:
+            break;
+        default:
+            return ApiInvalidParameterError;
+    }
+
+    if (! prepare (pFrameData, pixelFormat, pFrameDesc)) return ApiSuccess; // First frame
+
+    TemporalSpan ((U8*)pFrameData, &m_lastFrame[0], m_lastFrameSize, m_noiseFloor);
+    return ApiSuccess;
+}
+
+U32 PxLTemporalState::detectMotion (void* pFrameData, U32 pixelFormat, FRAME_DESC const * pFrameDesc, bool markFrame)
+{
+    switch (pixelFormat)
+    {
+        case PIXEL_FORMAT_RGB24:
+        case PIXEL_FORMAT_RGB24_NON_DIB:
+        case PIXEL_FORMAT_MONO8:
+            break;
+        default:
+            return ApiInvalidParameterError;
+    }
+
+    if (! prepare (pFrameData, pixelFormat, pFrameDesc)) return ApiSuccess; // First frame
+
+    const int blocksX = DEC_SIZE (m_width, m_blockSize);
+    const int blocksY = DEC_SIZE (m_height, m_blockSize);
+    const int rowBytes = m_width * m_bytesPerPixel;
+    const int blockBytes = m_blockSize * m_bytesPerPixel;
+    const U8  threshold = m_noiseFloor;
+
+    // RGB24 (DIB) frames are 'bottom up'; count each row against the block it occupies in the image, so that
+    // the mask and boxes are always in image order.
+    const bool bottomUp = (pixelFormat == PIXEL_FORMAT_RGB24);
+
+    m_blockCounts.assign (blocksX * blocksY, 0);
+
+    U8* pNew = (U8*)pFrameData;
+    U8* pOld = &m_lastFrame[0];
+    for (int y = 0; y < m_height; y++, pNew += rowBytes, pOld += rowBytes)
+    {
+        const int imageRow = bottomUp ? m_height - 1 - y : y;
+        U32* pCounts = &m_blockCounts[(imageRow / m_blockSize) * blocksX];
+        for (int bx = 0, offset = 0; bx < blocksX; bx++, offset += blockBytes)
+        {
+            const int spanBytes = min (blockBytes, rowBytes - offset);
+            pCounts[bx] += MotionSpan (pNew + offset, pOld + offset, spanBytes, threshold, markFrame);
+        }
+    }
+
+    //
+    // Publish the results.
+    {
+        pthread_mutex_lock (&m_resultLock);
+        m_result.m_frameNumber = pFrameDesc->uFrameNumber;
+        m_result.m_blockSize = m_blockSize;
+        m_result.m_blocksX = blocksX;
+        m_result.m_blocksY = blocksY;
+        m_result.m_mask.resize (blocksX * blocksY);
+        m_result.m_changedBlocks = 0;
+        for (int by = 0; by < blocksY; by++)
+        {
+            const int blockRows = min (m_blockSize, m_height - by*m_blockSize);
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                const int blockCols = min (m_blockSize, m_width - bx*m_blockSize);
+                const U32 samples = blockRows * blockCols * m_bytesPerPixel;
+                const U32 count = m_blockCounts[by*blocksX + bx];
+                U8 level = (U8)((count * 255) / samples);
+                // Make sure any change above the block threshold is visible in the mask
+                if (count * 100 > samples * (U32)m_blockPercent && count > 0)
+                {
+                    level = max (level, (U8)1);
+                    m_result.m_changedBlocks++;
+                } else {
+                    level = 0;
+                }
+                m_result.m_mask[by*blocksX + bx] = level;
+            }
+        }
+        findMotionBoxes ();
+        m_result.m_sceneChanged = (m_result.m_changedBlocks != 0);
+        m_result.m_staticFrames = m_result.m_sceneChanged ? 0 : m_result.m_staticFrames + 1;
+        pthread_mutex_unlock (&m_resultLock);
+    }
+
+    return ApiSuccess;
+}
+
+void PxLTemporalState::getMotion (PxLMotionResult& result)
+{
+    pthread_mutex_lock (&m_resultLock);
+    result = m_result;
+    pthread_mutex_unlock (&m_resultLock);
+}
+
+bool PxLTemporalState::sceneChanged ()
+{
+    pthread_mutex_lock (&m_resultLock);
+    bool changed = m_result.m_sceneChanged;
+    pthread_mutex_unlock (&m_resultLock);
+    return changed;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Private
+ * ---------------------------------------------------------------------------
+ */
+
+//
+// Ensure our history matches this frame.  Returns false if the history had to be (re)seeded from this frame,
+// in which case there is nothing to compare against.
+bool PxLTemporalState::prepare (void* pFrameData, U32 pixelFormat, FRAME_DESC const * pFrameDesc)
+{
+    const int decX = max (1, static_cast<int>(pFrameDesc->PixelAddressingValue.fHorizontal));
+    const int decY = max (1, static_cast<int>(pFrameDesc->PixelAddressingValue.fVertical));
+    const int width = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fWidth), decX);
+    const int height = DEC_SIZE(static_cast<int>(pFrameDesc->Roi.fHeight), decY);
+    const int bytesPerPixel = static_cast<int>(PxLPixelFormat::bytesPerPixel (pixelFormat));
+    const int frameSize = width * height * bytesPerPixel;
+
+    bool reset = __sync_lock_test_and_set (&m_resetRequested, 0) != 0;
+    if (reset || frameSize != m_lastFrameSize || pixelFormat != m_lastFormat ||
+        width != m_width || height != m_height)
+    {
+        // Only grow the history -- a smaller frame reuses the existing buffer
+        if ((int)m_lastFrame.size() < frameSize) m_lastFrame.resize (frameSize);
+        memcpy (&m_lastFrame[0], pFrameData, frameSize);
+        m_lastFrameSize = frameSize;
+        m_lastFormat = pixelFormat;
+        m_width = width;
+        m_height = height;
+        m_bytesPerPixel = bytesPerPixel;
+        return false;
+    }
+
+    return true;
+}
+
+//
+// Label each connected (4-neighbour) region of changed blocks in m_result.m_mask, and record its bounding box.
+// Called with m_resultLock held.
+void PxLTemporalState::findMotionBoxes ()
+{
+    const int blocksX = m_result.m_blocksX;
+    const int blocksY = m_result.m_blocksY;
+    const int numBlocks = blocksX * blocksY;
+
+    m_result.m_boxes.clear();
+    if (m_result.m_changedBlocks == 0) return;
+
+    m_labels.assign (numBlocks, 0);
+    m_labelStack.reserve (numBlocks);
+
+    for (int start = 0; start < numBlocks; start++)
+    {
+        if (m_result.m_mask[start] == 0 || m_labels[start] != 0) continue;
+
+        int minX = blocksX, minY = blocksY, maxX = -1, maxY = -1;
+        int count = 0;
+        m_labelStack.clear();
+        m_labelStack.push_back (start);
+        m_labels[start] = 1;
+        while (! m_labelStack.empty())
+        {
+            const int block = m_labelStack.back();
+            m_labelStack.pop_back();
+            const int bx = block % blocksX;
+            const int by = block / blocksX;
+            minX = min (minX, bx); maxX = max (maxX, bx);
+            minY = min (minY, by); maxY = max (maxY, by);
+            count++;
+
+            const int neighbours[4] = {bx > 0 ? block-1 : -1,
+                                       bx < blocksX-1 ? block+1 : -1,
+                                       by > 0 ? block-blocksX : -1,
+                                       by < blocksY-1 ? block+blocksX : -1};
+            for (int i = 0; i < 4; i++)
+            {
+                const int n = neighbours[i];
+                if (n < 0 || m_result.m_mask[n] == 0 || m_labels[n] != 0) continue;
+                m_labels[n] = 1;
+                m_labelStack.push_back (n);
+            }
+        }
+
+        PxLMotionBox box;
+        box.m_x = minX * m_blockSize;
+        box.m_y = minY * m_blockSize;
+        box.m_width = min ((maxX+1) * m_blockSize, m_width) - box.m_x;
+        box.m_height = min ((maxY+1) * m_blockSize, m_height) - box.m_y;
+        box.m_numBlocks = count;
+        m_result.m_boxes.push_back (box);
+    }
+}
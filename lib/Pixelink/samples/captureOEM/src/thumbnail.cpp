@@ -0,0 +1,408 @@
+
+/***************************************************************************
+ *
+ *     File: thumbnail.cpp
+ *
+ *     Description:
+ *       Small (thumbnail) images of the camera's stream.  Raw mono and bayer
+ *       frames are scaled (by averaging) and converted to RGB in a single pass.
+ */
+
+#include <string.h>
+#include <algorithm>
+#include "thumbnail.h"
+#include "pixelAddress.h"
+
+using namespace std;
+
+/* ---------------------------------------------------------------------------
+ * --   Frame samples
+ * ---------------------------------------------------------------------------
+ */
+
+typedef enum _THUMBNAIL_SAMPLE_LAYOUT
+{
+    SAMPLES_8BIT = 0,
+    SAMPLES_DCAM16,                  // As with the preview filters, we only use the MS 8 bits of
+    SAMPLES_12BIT_PACKED,            // each sample; which is all that the thumbnail can show anyway
+    SAMPLES_12BIT_PACKED_MSFIRST,
+    SAMPLES_10BIT_PACKED_MSFIRST,
+    SAMPLES_UNSUPPORTED
+} THUMBNAIL_SAMPLE_LAYOUT;
+
+// The color of each site of a 2x2 bayer cell, in RGB (pixbuf) order:  {row 0, col 0}, {row 0, col 1},
+// {row 1, col 0}, {row 1, col 1}
+enum {RED = 0, GREEN, BLUE};
+static const U8 s_bggr[4] = {BLUE, GREEN, GREEN, RED};
+static const U8 s_gbrg[4] = {GREEN, BLUE, RED, GREEN};
+static const U8 s_grbg[4] = {GREEN, RED, BLUE, GREEN};
+static const U8 s_rggb[4] = {RED, GREEN, GREEN, BLUE};
+
+// Returns the layout of the samples, and sets *ppPattern to the bayer pattern (NULL for mono)
+static THUMBNAIL_SAMPLE_LAYOUT SampleLayout (U32 pixelFormat, const U8** ppPattern)
+{
+    *ppPattern = NULL;
+    switch (pixelFormat)
+    {
+    case PIXEL_FORMAT_MONO8:                          return SAMPLES_8BIT;
+    case PIXEL_FORMAT_BAYER8_BGGR:  *ppPattern = s_bggr; return SAMPLES_8BIT;
+    case PIXEL_FORMAT_BAYER8_GBRG:  *ppPattern = s_gbrg; return SAMPLES_8BIT;
+    case PIXEL_FORMAT_BAYER8_GRBG:  *ppPattern = s_grbg; return SAMPLES_8BIT;
+    case PIXEL_FORMAT_BAYER8_RGGB:  *ppPattern = s_rggb; return SAMPLES_8BIT;
+
+    case PIXEL_FORMAT_MONO16:                          return SAMPLES_DCAM16;
+    case PIXEL_FORMAT_BAYER16_BGGR: *ppPattern = s_bggr; return SAMPLES_DCAM16;
+    case PIXEL_FORMAT_BAYER16_GBRG: *ppPattern = s_gbrg; return SAMPLES_DCAM16;
+    case PIXEL_FORMAT_BAYER16_GRBG: *ppPattern = s_grbg; return SAMPLES_DCAM16;
+    case PIXEL_FORMAT_BAYER16_RGGB: *ppPattern = s_rggb; return SAMPLES_DCAM16;
+
+    case PIXEL_FORMAT_MONO12_PACKED:                          return SAMPLES_12BIT_PACKED;
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:  *ppPattern = s_bggr; return SAMPLES_12BIT_PACKED;
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:  *ppPattern = s_gbrg; return SAMPLES_12BIT_PACKED;
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:  *ppPattern = s_grbg; return SAMPLES_12BIT_PACKED;
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:  *ppPattern = s_rggb; return SAMPLES_12BIT_PACKED;
+
+    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:                          return SAMPLES_12BIT_PACKED_MSFIRST;
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:  *ppPattern = s_bggr; return SAMPLES_12BIT_PACKED_MSFIRST;
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:  *ppPattern = s_gbrg; return SAMPLES_12BIT_PACKED_MSFIRST;
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:  *ppPattern = s_grbg; return SAMPLES_12BIT_PACKED_MSFIRST;
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:  *ppPattern = s_rggb; return SAMPLES_12BIT_PACKED_MSFIRST;
+
+    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:                          return SAMPLES_10BIT_PACKED_MSFIRST;
+    case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:  *ppPattern = s_bggr; return SAMPLES_10BIT_PACKED_MSFIRST;
+    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:  *ppPattern = s_gbrg; return SAMPLES_10BIT_PACKED_MSFIRST;
+    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:  *ppPattern = s_grbg; return SAMPLES_10BIT_PACKED_MSFIRST;
+    case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:  *ppPattern = s_rggb; return SAMPLES_10BIT_PACKED_MSFIRST;
+
+    default:
+        return SAMPLES_UNSUPPORTED;
+    }
+}
+
+static int BytesPerRow (THUMBNAIL_SAMPLE_LAYOUT layout, int width)
+{
+    switch (layout)
+    {
+    case SAMPLES_DCAM16:               return width * 2;
+    case SAMPLES_12BIT_PACKED:
+    case SAMPLES_12BIT_PACKED_MSFIRST: return width + width/2;
+    case SAMPLES_10BIT_PACKED_MSFIRST: return width + width/4;
+    default:                           return width;
+    }
+}
+
+// The MS 8 bits of sample x of a row
+template <THUMBNAIL_SAMPLE_LAYOUT LAYOUT>
+static inline U32 Sample (const U8* pRow, int x)
+{
+    switch (LAYOUT)
+    {
+    case SAMPLES_DCAM16:               return pRow[x*2];
+    case SAMPLES_12BIT_PACKED:         return pRow[(x>>1)*3 + (x&1)*2];  // MS0, LS, MS1
+    case SAMPLES_12BIT_PACKED_MSFIRST: return pRow[(x>>1)*3 + (x&1)];    // MS0, MS1, LS
+    case SAMPLES_10BIT_PACKED_MSFIRST: return pRow[(x>>2)*5 + (x&3)];    // MS0, MS1, MS2, MS3, LS
+    default:                           return pRow[x];
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Scaling kernels
+ * ---------------------------------------------------------------------------
+ */
+
+//
+// Each thumbnail pixel is the (rounded) average of the frame pixels in its box.  pSums needs room for
+// one sum per thumbnail column.
+template <THUMBNAIL_SAMPLE_LAYOUT LAYOUT>
+static void ScaleMono (const U8* pFrame, int bytesPerRow,
+                       const int* pXStart, const int* pXEnd, const int* pYStart, const int* pYEnd,
+                       U32* pSums, U8* pPixels, int width, int height, int rowstride)
+{
+    for (int row = 0; row < height; row++)
+    {
+        memset (pSums, 0, width * sizeof(U32));
+        for (int y = pYStart[row]; y < pYEnd[row]; y++)
+        {
+            const U8* pRow = pFrame + y * bytesPerRow;
+            for (int col = 0; col < width; col++)
+            {
+                U32 sum = 0;
+                for (int x = pXStart[col]; x < pXEnd[col]; x++) sum += Sample<LAYOUT> (pRow, x);
+                pSums[col] += sum;
+            }
+        }
+
+        const U32 boxHeight = pYEnd[row] - pYStart[row];
+        U8* pPixel = pPixels + row * rowstride;
+        for (int col = 0; col < width; col++, pPixel += 3)
+        {
+            const U32 boxSize = boxHeight * (pXEnd[col] - pXStart[col]);
+            pPixel[0] = pPixel[1] = pPixel[2] = (U8)((pSums[col] + boxSize/2) / boxSize);
+        }
+    }
+}
+
+//
+// As ScaleMono, but the sites of each color are averaged separately, which also takes care of the
+// de-bayering.  Each box covers at least one 2x2 bayer cell, so there is always a sample of each color.
+// pSums needs room for 3 sums per thumbnail column.
+template <THUMBNAIL_SAMPLE_LAYOUT LAYOUT>
+static void ScaleBayer (const U8* pFrame, int bytesPerRow, const U8* pPattern,
+                        const int* pXStart, const int* pXEnd, const int* pYStart, const int* pYEnd,
+                        U32* pSums, U8* pPixels, int width, int height, int rowstride)
+{
+    for (int row = 0; row < height; row++)
+    {
+        memset (pSums, 0, width * 3 * sizeof(U32));
+        int rowsOfParity[2] = {0, 0};
+        for (int y = pYStart[row]; y < pYEnd[row]; y++)
+        {
+            const U8* pRow = pFrame + y * bytesPerRow;
+            const U8* pColors = pPattern + (y & 1) * 2;
+            rowsOfParity[y & 1]++;
+            for (int col = 0; col < width; col++)
+            {
+                U32* pColSums = pSums + col * 3;
+                for (int x = pXStart[col]; x < pXEnd[col]; x++) pColSums[pColors[x & 1]] += Sample<LAYOUT> (pRow, x);
+            }
+        }
+
+        U8* pPixel = pPixels + row * rowstride;
+        for (int col = 0; col < width; col++, pPixel += 3)
+        {
+            const int boxWidth = pXEnd[col] - pXStart[col];
+            int colsOfParity[2];
+            colsOfParity[pXStart[col] & 1] = (boxWidth + 1) / 2;
+            colsOfParity[(pXStart[col] & 1) ^ 1] = boxWidth / 2;
+
+            U32 counts[3] = {0, 0, 0};
+            for (int site = 0; site < 4; site++) counts[pPattern[site]] += rowsOfParity[site >> 1] * colsOfParity[site & 1];
+
+            const U32* pColSums = pSums + col * 3;
+            for (int color = RED; color <= BLUE; color++)
+            {
+                pPixel[color] = (U8)((pColSums[color] + counts[color]/2) / counts[color]);
+            }
+        }
+    }
+}
+
+//
+// The frame pixels covered by each of the thumbnailSize boxes.  Bayer boxes are at least 2 pixels
+// (and start on an even pixel), so that each contains both parities.
+static void BoxEdges (int frameSize, int thumbnailSize, bool bayer, vector<int>& start, vector<int>& end)
+{
+    start.resize (thumbnailSize);
+    end.resize (thumbnailSize);
+    for (int i = 0; i < thumbnailSize; i++)
+    {
+        int first = (i * frameSize) / thumbnailSize;
+        int last = ((i + 1) * frameSize) / thumbnailSize;
+        if (last <= first) last = first + 1;
+        if (bayer)
+        {
+            first &= ~1;
+            if (last < first + 2) last = first + 2;
+            if (last > frameSize)
+            {
+                last = frameSize;
+                first = last - 2;
+            }
+        }
+        start[i] = first;
+        end[i] = last;
+    }
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Public
+ * ---------------------------------------------------------------------------
+ */
+
+PxLThumbnail::PxLThumbnail ()
+: m_pixbuf(NULL)
+, m_frameWidth(0)
+, m_frameHeight(0)
+, m_bayerGeometry(false)
+{
+}
+
+PxLThumbnail::~PxLThumbnail ()
+{
+    if (m_pixbuf) g_object_unref (m_pixbuf);
+}
+
+GdkPixbuf* PxLThumbnail::grab (PxLCamera* pCamera, int width, int height)
+{
+    if (NULL == pCamera) return NULL;
+
+    //
+    // Step 1
+    //      Grab the frame.  The frame buffer only ever grows, so once it is large enough, refreshing
+    //      the thumbnail does not allocate anything.
+    U32 frameSize = pCamera->imageSizeInBytes();
+    if (0 == frameSize) return NULL;
+    if (m_frameBuf.size() < frameSize) m_frameBuf.resize (frameSize);
+
+    FRAME_DESC frameDesc;
+    PXL_RETURN_CODE rc = pCamera->getNextFrame (frameSize, &m_frameBuf[0], &frameDesc);
+
+    //
+    // Step 2
+    //      Scale it
+    if (API_SUCCESS (rc)) rc = scale (&m_frameBuf[0], frameSize, &frameDesc, width, height);
+
+    return API_SUCCESS (rc) ? m_pixbuf : NULL;
+}
+
+PXL_RETURN_CODE PxLThumbnail::scale (const void* pFrame, U32 frameSize, FRAME_DESC const * pFrameDesc, int width, int height)
+{
+    if (NULL == pFrame || NULL == pFrameDesc || width <= 0 || height <= 0) return ApiInvalidParameterError;
+
+    //
+    // Step 1
+    //      (re)create the thumbnail, if it is not already the right size
+    if (NULL == m_pixbuf ||
+        gdk_pixbuf_get_width (m_pixbuf) != width ||
+        gdk_pixbuf_get_height (m_pixbuf) != height)
+    {
+        if (m_pixbuf) g_object_unref (m_pixbuf);
+        m_pixbuf = gdk_pixbuf_new (GDK_COLORSPACE_RGB, false, 8, width, height);
+        if (NULL == m_pixbuf) return ApiOutOfMemoryError;
+    }
+
+    //
+    // Step 2
+    //      Figure out the frame dimensions
+    int decX = max (1, (int)pFrameDesc->PixelAddressingValue.fHorizontal);
+    int decY = max (1, (int)pFrameDesc->PixelAddressingValue.fVertical);
+    int frameWidth = DEC_SIZE ((int)pFrameDesc->Roi.fWidth, decX);
+    int frameHeight = DEC_SIZE ((int)pFrameDesc->Roi.fHeight, decY);
+    if (frameWidth < 2 || frameHeight < 2) return ApiInvalidParameterError;
+
+    //
+    // Step 3
+    //      Scale the frame; directly if we can, otherwise let the API convert it to RGB first.  Interleaved
+    //      HDR frames hold 2 images, which only the API knows how to combine.
+    U32 pixelFormat = (U32)pFrameDesc->PixelFormat.fValue;
+    if (directlyScalable (pixelFormat) && pFrameDesc->HDRInfo.uMode != FEATURE_GAIN_HDR_MODE_INTERLEAVED)
+    {
+        return scaleRaw ((const U8*)pFrame, frameSize, pixelFormat, frameWidth, frameHeight);
+    }
+    return scaleRgb (pFrame, frameSize, pFrameDesc, frameWidth, frameHeight);
+}
+
+bool PxLThumbnail::directlyScalable (U32 pixelFormat)
+{
+    const U8* pPattern;
+    return SampleLayout (pixelFormat, &pPattern) != SAMPLES_UNSUPPORTED;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Member functions - Private
+ * ---------------------------------------------------------------------------
+ */
+
+PXL_RETURN_CODE PxLThumbnail::scaleRaw (const U8* pFrame, U32 frameSize, U32 pixelFormat, int frameWidth, int frameHeight)
+{
+    const U8* pPattern;
+    const THUMBNAIL_SAMPLE_LAYOUT layout = SampleLayout (pixelFormat, &pPattern);
+    const int bytesPerRow = BytesPerRow (layout, frameWidth);
+    if ((U32)bytesPerRow * frameHeight > frameSize) return ApiInvalidParameterError;
+
+    const int width = gdk_pixbuf_get_width (m_pixbuf);
+    const int height = gdk_pixbuf_get_height (m_pixbuf);
+    const int rowstride = gdk_pixbuf_get_rowstride (m_pixbuf);
+    U8* pPixels = gdk_pixbuf_get_pixels (m_pixbuf);
+
+    setGeometry (frameWidth, frameHeight, pPattern != NULL);
+    m_sums.resize (width * 3);
+
+    const int* pXStart = &m_xStart[0];
+    const int* pXEnd = &m_xEnd[0];
+    const int* pYStart = &m_yStart[0];
+    const int* pYEnd = &m_yEnd[0];
+    U32* pSums = &m_sums[0];
+
+    if (pPattern)
+    {
+        switch (layout)
+        {
+        case SAMPLES_DCAM16:
+            ScaleBayer<SAMPLES_DCAM16> (pFrame, bytesPerRow, pPattern, pXStart, pXEnd, pYStart, pYEnd, pSums, pPixels, width, height, rowstride);
+            break;
+        case SAMPLES_12BIT_PACKED:
+            ScaleBayer<SAMPLES_12BIT_PACKED> (pFrame, bytesPerRow, pPattern, pXStart, pXEnd, pYStart, pYEnd, pSums, pPixels, width, height, rowstride);
+            break;
+        case SAMPLES_12BIT_PACKED_MSFIRST:
+            ScaleBayer<SAMPLES_12BIT_PACKED_MSFIRST> (pFrame, bytesPerRow, pPattern, pXStart, pXEnd, pYStart, pYEnd, pSums, pPixels, width, height, rowstride);
+            break;
+        case SAMPLES_10BIT_PACKED_MSFIRST:
+            ScaleBayer<SAMPLES_10BIT_PACKED_MSFIRST> (pFrame, bytesPerRow, pPattern, pXStart, pXEnd, pYStart, pYEnd, pSums, pPixels, width, height, rowstride);
+            break;
+        default:
+            ScaleBayer<SAMPLES_8BIT> (pFrame, bytesPerRow, pPattern, pXStart, pXEnd, pYStart, pYEnd, pSums, pPixels, width, height, rowstride);
+            break;
+        }
+    } else {
+        switch (layout)
+        {
+        case SAMPLES_DCAM16:
+            ScaleMono<SAMPLES_DCAM16> (pFrame, bytesPerRow, pXStart, pXEnd, pYStart, pYEnd, pSums, pPixels, width, height, rowstride);
+            break;
+        case SAMPLES_12BIT_PACKED:
+            ScaleMono<SAMPLES_12BIT_PACKED> (pFrame, bytesPerRow, pXStart, pXEnd, pYStart, pYEnd, pSums, pPixels, width, height, rowstride);
+            break;
+        case SAMPLES_12BIT_PACKED_MSFIRST:
+            ScaleMono<SAMPLES_12BIT_PACKED_MSFIRST> (pFrame, bytesPerRow, pXStart, pXEnd, pYStart, pYEnd, pSums, pPixels, width, height, rowstride);
+            break;
+        case SAMPLES_10BIT_PACKED_MSFIRST:
+            ScaleMono<SAMPLES_10BIT_PACKED_MSFIRST> (pFrame, bytesPerRow, pXStart, pXEnd, pYStart, pYEnd, pSums, pPixels, width, height, rowstride);
+            break;
+        default:
+            ScaleMono<SAMPLES_8BIT> (pFrame, bytesPerRow, pXStart, pXEnd, pYStart, pYEnd, pSums, pPixels, width, height, rowstride);
+            break;
+        }
+    }
+
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PxLThumbnail::scaleRgb (const void* pFrame, U32 frameSize, FRAME_DESC const * pFrameDesc, int frameWidth, int frameHeight)
+{
+    // The rgb image may be bigger or smaller than the frame, depending on the pixel format.  Play it safe,
+    // and deal with the worst case where we need 3 bytes for every byte of the frame.
+    if (m_rgbBuf.size() < (size_t)frameSize * 3) m_rgbBuf.resize ((size_t)frameSize * 3);
+    U32 imageSize = m_rgbBuf.size();
+    PXL_RETURN_CODE rc = PxLFormatImage (pFrame, pFrameDesc, IMAGE_FORMAT_RAW_RGB24_NON_DIB, &m_rgbBuf[0], &imageSize);
+    if (!API_SUCCESS (rc)) return rc;
+
+    const int width = gdk_pixbuf_get_width (m_pixbuf);
+    const int height = gdk_pixbuf_get_height (m_pixbuf);
+    GdkPixbuf* pFramePixbuf = gdk_pixbuf_new_from_data (
+            &m_rgbBuf[0], GDK_COLORSPACE_RGB, false, 8,
+            frameWidth, frameHeight, frameWidth*3, NULL, NULL);
+    if (NULL == pFramePixbuf) return ApiOutOfMemoryError;
+    gdk_pixbuf_scale (pFramePixbuf, m_pixbuf, 0, 0, width, height, 0.0, 0.0,
+                      (double)width / (double)frameWidth, (double)height / (double)frameHeight,
+                      GDK_INTERP_BILINEAR);
+    g_object_unref (pFramePixbuf);
+
+    return ApiSuccess;
+}
+
+// Recomputes the boxes, should the frame or thumbnail size change
+void PxLThumbnail::setGeometry (int frameWidth, int frameHeight, bool bayer)
+{
+    const int width = gdk_pixbuf_get_width (m_pixbuf);
+    const int height = gdk_pixbuf_get_height (m_pixbuf);
+
+    if (frameWidth == m_frameWidth && frameHeight == m_frameHeight && bayer == m_bayerGeometry &&
+        width == (int)m_xStart.size() && height == (int)m_yStart.size()) return;
+
+    BoxEdges (frameWidth, width, bayer, m_xStart, m_xEnd);
+    BoxEdges (frameHeight, height, bayer, m_yStart, m_yEnd);
+    m_frameWidth = frameWidth;
+    m_frameHeight = frameHeight;
+    m_bayerGeometry = bayer;
+}
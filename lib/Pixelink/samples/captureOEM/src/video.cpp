@@ -10,6 +10,8 @@
 #include <string>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <algorithm>
 #include <sys/types.h>
 #include <unistd.h>
 #include "video.h"
@@ -17,10 +19,12 @@
 #include "captureOEM.h"
 #include "helpers.h"
 #include "videoCaptureDialog.h"
+#include "filter.h"
 
 using namespace std;
 
 extern PxLVideo    *gVideoTab;
+extern PxLFilter   *gFilterTab;
 extern GtkWindow   *gTopLevelWindow;
 extern PxLVideoCaptureDialog *gVideoCaptureDialog;
 
@@ -50,6 +54,8 @@ static gboolean  PlaybackActivate (gpointer pData);
 static gboolean  VideoDeactivate (gpointer pData);
 static gboolean  VideoActivate (gpointer pData);
 
+static void ShowFileSize (PxLVideo* pControls, float numFrames, float playbackTime, float bitRate);
+
 extern "C" U32 ClipTermCallback(HANDLE hCamera, U32 uNumFramesCaptured, PXL_RETURN_CODE uRetCode);
 
 
@@ -59,6 +65,11 @@ extern "C" U32 ClipTermCallback(HANDLE hCamera, U32 uNumFramesCaptured, PXL_RETU
  */
 PxLVideo::PxLVideo (GtkBuilder *builder)
 : m_captureInProgress (false)
+, m_muxWhileCapturing (true)
+, m_muxFromFifo (false)
+, m_recordingRaw (false)
+, m_rawDirectIo (getenv ("PXL_RAW_DIRECT_IO") != NULL)
+, m_rawSkipStatic (getenv ("PXL_RAW_SKIP_STATIC") != NULL)
 , m_currentDecimation (1)
 {
     //
@@ -108,6 +119,9 @@ PxLVideo::PxLVideo (GtkBuilder *builder)
     gtk_combo_box_text_insert_text (GTK_COMBO_BOX_TEXT(m_fileType),
                                     CLIP_FORMAT_MP4,
                                     "MP4");
+    gtk_combo_box_text_insert_text (GTK_COMBO_BOX_TEXT(m_fileType),
+                                    VIDEO_FORMAT_RAW,
+                                    "RAW (lossless)");
     gtk_combo_box_set_active (GTK_COMBO_BOX(m_fileType),CLIP_FORMAT_MP4);
 
     // Default to ~/Videos folder
@@ -131,6 +145,16 @@ PxLVideo::PxLVideo (GtkBuilder *builder)
     // Default to a 10 seconds of recording
     gtk_entry_set_text (GTK_ENTRY (m_recordTime), "10.0");
 
+    //
+    // Step 3
+    //      How the video file is made from the encoded clip
+    const char* clipMux = getenv ("PXL_CLIP_MUX");
+    if (clipMux)
+    {
+        m_muxWhileCapturing = strcmp (clipMux, "off") != 0;
+        m_muxFromFifo = strcmp (clipMux, "fifo") == 0;
+    }
+
 }
 
 
@@ -393,8 +417,28 @@ static gboolean VideoActivate (gpointer pData)
     sprintf (cTextValue, "%8.1f", numFrames / effectiveFps);
     gtk_entry_set_text (GTK_ENTRY (pControls->m_playbackTime), cTextValue);
 
-    // The file size (in KBytes), is playbacktime * bitRate, but in MegaBytes
-    float fileSize = ((numFrames / effectiveFps) * bitRate) / 8.0;
+    ShowFileSize (pControls, numFrames, numFrames / effectiveFps, bitRate);
+
+    gtk_widget_set_sensitive (pControls->m_captureButton, true);
+
+    return false;  //  Only run once....
+}
+
+//
+// Shows the estimated size of the file (in MegaBytes).  An encoded clip is playbackTime * bitRate; a raw recording
+// holds every frame as is, so it is width x height x bytes per pixel, times the (decimated) frame rate, for each
+// second recorded.
+static void ShowFileSize (PxLVideo* pControls, float numFrames, float playbackTime, float bitRate)
+{
+    float fileSize = (playbackTime * bitRate) / 8.0;
+    if (gtk_combo_box_get_active (GTK_COMBO_BOX(pControls->m_fileType)) == VIDEO_FORMAT_RAW)
+    {
+        PxLAutoLock lock(&gCameraLock);
+        // Like the bit rate, in units of 1000, not 1024
+        if (gCamera) fileSize = (numFrames * (float)gCamera->imageSizeInBytes()) / (1000.0 * 1000.0);
+    }
+
+    char cTextValue[40];
     if (fileSize < 10.0)
         sprintf (cTextValue, "%8.3f", fileSize);
     else if (fileSize < 100.0)
@@ -402,10 +446,6 @@ static gboolean VideoActivate (gpointer pData)
     else
         sprintf (cTextValue, "%8.0f", fileSize);
     gtk_entry_set_text (GTK_ENTRY (pControls->m_fileSize), cTextValue);
-
-    gtk_widget_set_sensitive (pControls->m_captureButton, true);
-
-    return false;  //  Only run once....
 }
 
 /* ---------------------------------------------------------------------------
@@ -430,7 +470,15 @@ extern "C" void NewVideoFormatSelected
     case CLIP_FORMAT_AVI:
         ReplaceFileExtension (GTK_ENTRY(gVideoTab->m_fileName), "avi");
         break;
+    case VIDEO_FORMAT_RAW:
+        ReplaceFileExtension (GTK_ENTRY(gVideoTab->m_fileName), "pxlraw");
+        break;
     }
+
+    // Raw recordings are a good deal bigger
+    float currentPlaybackTime = atof (gtk_entry_get_text (GTK_ENTRY (gVideoTab->m_playbackTime)));
+    float numFrames = atof (gtk_entry_get_text (GTK_ENTRY (gVideoTab->m_numFramesToCapture)));
+    ShowFileSize (gVideoTab, numFrames, currentPlaybackTime, gVideoTab->m_bitrateSlider->getEditValue());
 }
 
 extern "C" void NewVideoLocation
@@ -478,16 +526,7 @@ extern "C" void VideoNumFramesChanged
     gtk_entry_set_text (GTK_ENTRY (gVideoTab->m_playbackTime), cTextValue);
 
     // If the playback time changed, so does the estimated file size
-    // The file size (in KBytes), is playbackt ime * bitRate, but in MegaBytes
-    float bitRate = gVideoTab->m_bitrateSlider->getEditValue();
-    float fileSize = ((numFrames / effectivePlaybackFps) * bitRate) / 8.0;
-    if (fileSize < 10.0)
-        sprintf (cTextValue, "%8.3f", fileSize);
-    else if (fileSize < 100.0)
-        sprintf (cTextValue, "%8.2f", fileSize);
-    else
-        sprintf (cTextValue, "%8.0f", fileSize);
-    gtk_entry_set_text (GTK_ENTRY (gVideoTab->m_fileSize), cTextValue);
+    ShowFileSize (gVideoTab, numFrames, numFrames / effectivePlaybackFps, gVideoTab->m_bitrateSlider->getEditValue());
 }
 
 extern "C" void VideoDecimationChanged
@@ -513,15 +552,8 @@ extern "C" void VideoDecimationChanged
     gtk_entry_set_text (GTK_ENTRY (gVideoTab->m_fpsPlayback), cTextValue);
 
     // And if the playback time changed, so does the file size.
-    // The file size (in KBytes), is playbacktime * bitRate, but in MegaBytes
-    float fileSize = ((currentPlaybackTime * decimationChange) * bitRate) / 8.0;
-    if (fileSize < 10.0)
-        sprintf (cTextValue, "%8.3f", fileSize);
-    else if (fileSize < 100.0)
-        sprintf (cTextValue, "%8.2f", fileSize);
-    else
-        sprintf (cTextValue, "%8.0f", fileSize);
-    gtk_entry_set_text (GTK_ENTRY (gVideoTab->m_fileSize), cTextValue);
+    float numFrames = atof (gtk_entry_get_text (GTK_ENTRY (gVideoTab->m_numFramesToCapture)));
+    ShowFileSize (gVideoTab, numFrames, currentPlaybackTime * decimationChange, bitRate);
 
     gVideoTab->m_currentDecimation = newDecimation;
 }
@@ -549,17 +581,9 @@ extern "C" void VideoMatchFpsToggled
         gtk_label_set_text (GTK_LABEL (gVideoTab->m_fpsComment), "");
 
         // If the playback time changed, so does the file size.
-        // The file size (in KBytes), is playbacktime * bitRate, but in MegaBytes
         float currentPlaybackTime = atof (gtk_entry_get_text (GTK_ENTRY (gVideoTab->m_playbackTime)));
-        float bitRate = gVideoTab->m_bitrateSlider->getEditValue();
-        float fileSize = (currentPlaybackTime * bitRate) / 8.0;
-        if (fileSize < 10.0)
-            sprintf (cTextValue, "%8.3f", fileSize);
-        else if (fileSize < 100.0)
-            sprintf (cTextValue, "%8.2f", fileSize);
-        else
-            sprintf (cTextValue, "%8.0f", fileSize);
-        gtk_entry_set_text (GTK_ENTRY (gVideoTab->m_fileSize), cTextValue);
+        float numFrames = atof (gtk_entry_get_text (GTK_ENTRY (gVideoTab->m_numFramesToCapture)));
+        ShowFileSize (gVideoTab, numFrames, currentPlaybackTime, gVideoTab->m_bitrateSlider->getEditValue());
     }
     gtk_widget_set_sensitive (gVideoTab->m_fpsPlayback, ! bAuto);
 }
@@ -594,16 +618,7 @@ extern "C" void VideoPlaybackFpsChanged
     }
 
     // If the playback time changed, so does the file size.
-    // The file size (in KBytes), is playbacktime * bitRate, but in MegaBytes
-    float bitRate = gVideoTab->m_bitrateSlider->getEditValue();
-    float fileSize = ((numFrames / effectivePlaybackFps) * bitRate) / 8.0;
-    if (fileSize < 10.0)
-        sprintf (cTextValue, "%8.3f", fileSize);
-    else if (fileSize < 100.0)
-        sprintf (cTextValue, "%8.2f", fileSize);
-    else
-        sprintf (cTextValue, "%8.0f", fileSize);
-    gtk_entry_set_text (GTK_ENTRY (gVideoTab->m_fileSize), cTextValue);
+    ShowFileSize (gVideoTab, numFrames, numFrames / effectivePlaybackFps, gVideoTab->m_bitrateSlider->getEditValue());
 }
 
 extern "C" void VideoAutoBitrateToggled
@@ -636,18 +651,10 @@ extern "C" void BitrateValueChanged
     newValue = gVideoTab->m_bitrateSlider->getEditValue();
     gVideoTab->m_bitrateSlider->setValue(newValue);
 
-    // if the bitrate changes, so does the file size.
-    // The file size (in KBytes), is playbacktime * bitRate, but in MegaBytes
+    // if the bitrate changes, so does the file size (of an encoded clip).
     float currentPlaybackTime = atof (gtk_entry_get_text (GTK_ENTRY (gVideoTab->m_playbackTime)));
-    float fileSize = (currentPlaybackTime * newValue) / 8.0;
-    char cTextValue[40];
-    if (fileSize < 10.0)
-        sprintf (cTextValue, "%8.3f", fileSize);
-    else if (fileSize < 100.0)
-        sprintf (cTextValue, "%8.2f", fileSize);
-    else
-        sprintf (cTextValue, "%8.0f", fileSize);
-    gtk_entry_set_text (GTK_ENTRY (gVideoTab->m_fileSize), cTextValue);
+    float numFrames = atof (gtk_entry_get_text (GTK_ENTRY (gVideoTab->m_numFramesToCapture)));
+    ShowFileSize (gVideoTab, numFrames, currentPlaybackTime, newValue);
 }
 
 extern "C" void BitrateScaleChanged
@@ -661,18 +668,10 @@ extern "C" void BitrateScaleChanged
     newValue = gVideoTab->m_bitrateSlider->getScaleValue();
     gVideoTab->m_bitrateSlider->setValue(newValue);
 
-    // if the bitrate changes, so does the file size.
-    // The file size (in KBytes), is playbacktime * bitRate, but in MegaBytes
+    // if the bitrate changes, so does the file size (of an encoded clip).
     float currentPlaybackTime = atof (gtk_entry_get_text (GTK_ENTRY (gVideoTab->m_playbackTime)));
-    float fileSize = (currentPlaybackTime * newValue) / 8.0;
-    char cTextValue[40];
-    if (fileSize < 10.0)
-        sprintf (cTextValue, "%8.3f", fileSize);
-    else if (fileSize < 100.0)
-        sprintf (cTextValue, "%8.2f", fileSize);
-    else
-        sprintf (cTextValue, "%8.0f", fileSize);
-    gtk_entry_set_text (GTK_ENTRY (gVideoTab->m_fileSize), cTextValue);
+    float numFrames = atof (gtk_entry_get_text (GTK_ENTRY (gVideoTab->m_numFramesToCapture)));
+    ShowFileSize (gVideoTab, numFrames, currentPlaybackTime, newValue);
 }
 
 extern "C" void VideoRecordTimeChanged
@@ -698,16 +697,7 @@ extern "C" void VideoRecordTimeChanged
     gtk_entry_set_text (GTK_ENTRY (gVideoTab->m_playbackTime), cTextValue);
 
     // If the playback time changed, so does the file size.
-    // The file size (in KBytes), is playbacktime * bitRate, but in MegaBytes
-    float bitRate = gVideoTab->m_bitrateSlider->getEditValue();
-    float fileSize = ((numFrames / effectivePlaybackFps) * bitRate) / 8.0;
-    if (fileSize < 10.0)
-        sprintf (cTextValue, "%8.3f", fileSize);
-    else if (fileSize < 100.0)
-        sprintf (cTextValue, "%8.2f", fileSize);
-    else
-        sprintf (cTextValue, "%8.0f", fileSize);
-    gtk_entry_set_text (GTK_ENTRY (gVideoTab->m_fileSize), cTextValue);
+    ShowFileSize (gVideoTab, numFrames, numFrames / effectivePlaybackFps, gVideoTab->m_bitrateSlider->getEditValue());
 }
 
 // Some static varaibles we use for clip captures
@@ -774,12 +764,52 @@ extern "C" void VideoCaptureButtonPressed
     //         bitRate,
     //         playbackFramerate);
     // ---
-    rc = gCamera->getH264Clip (atoi (gtk_entry_get_text (GTK_ENTRY(gVideoTab->m_numFramesToCapture))),
-                               decimation,
-                               gVideoTab->m_encodedFilename,
-                               playbackFramerate,
-                               bitRate,
-                               ClipTermCallback);
+
+    int   numFrames = atoi (gtk_entry_get_text (GTK_ENTRY(gVideoTab->m_numFramesToCapture)));
+    gVideoTab->m_recordingRaw = gtk_combo_box_get_active (GTK_COMBO_BOX(gVideoTab->m_fileType)) == VIDEO_FORMAT_RAW;
+    if (gVideoTab->m_recordingRaw)
+    {
+        // Raw frames need no encoding (or formatting); we record them ourselves.
+        if (gFilterTab)
+        {
+            PxLTemporalState& motion = gFilterTab->m_filterStream.m_motionState;
+            gVideoTab->m_rawRecorder.skipStaticFrames (gVideoTab->m_rawSkipStatic, motion.noiseFloor(), motion.blockPercent());
+        } else {
+            gVideoTab->m_rawRecorder.skipStaticFrames (gVideoTab->m_rawSkipStatic);
+        }
+        rc = gVideoTab->m_rawRecorder.begin (gCamera,
+                                             gVideoTab->m_videoFilename,
+                                             numFrames,
+                                             decimation,
+                                             gVideoTab->m_rawDirectIo,
+                                             ClipTermCallback);
+    } else {
+        // Start muxing the video file; it is built up as the API encodes the clip.
+        if (gVideoTab->m_muxWhileCapturing)
+        {
+            float paMode, paX, paY;
+            PXL_ROI roi;
+            gCamera->getRoiValue (FrameRoi, &roi);
+            if (!API_SUCCESS (gCamera->getPixelAddressValues (&paMode, &paX, &paY))) paX = paY = 1.0f;
+            // Only use a FIFO if the user does not want to keep the encoded file
+            bool fifo = gVideoTab->m_muxFromFifo &&
+                        ! gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON(gVideoTab->m_keepIntermidiate));
+            gVideoTab->m_muxer.begin (gVideoTab->m_encodedFilename,
+                                      gVideoTab->m_videoFilename,
+                                      gtk_combo_box_get_active (GTK_COMBO_BOX(gVideoTab->m_fileType)),
+                                      (int)(roi.m_width / max (1.0f, paX)),
+                                      (int)(roi.m_height / max (1.0f, paY)),
+                                      playbackFramerate,
+                                      fifo ? MUX_INPUT_FIFO : MUX_INPUT_FILE);
+        }
+
+        rc = gCamera->getH264Clip (numFrames,
+                                   decimation,
+                                   gVideoTab->m_encodedFilename,
+                                   playbackFramerate,
+                                   bitRate,
+                                   ClipTermCallback);
+    }
 
     //
     // Step 5
@@ -791,6 +821,7 @@ extern "C" void VideoCaptureButtonPressed
     {
         gtk_widget_set_sensitive (gVideoTab->m_captureButton, true); // so we better re-enable the button
     }
+    if (!API_SUCCESS(rc)) gVideoTab->m_muxer.abort();
 
     if (rc == ApiUnsupportedPixelFormatError)
     {
@@ -811,6 +842,15 @@ extern "C" void VideoCaptureButtonPressed
                                                  "Frame too large for H264 compression.\nReduce the ROI to <= 9 Megapixels");
             gtk_dialog_run (GTK_DIALOG (popupError));  // This makes the popup modal
             gtk_widget_destroy (popupError);
+    } else if (rc == ApiDiskFullError) {
+            // Pop up an error message
+            GtkWidget *popupError = gtk_message_dialog_new (gTopLevelWindow,
+                                                 GTK_DIALOG_DESTROY_WITH_PARENT,
+                                                 GTK_MESSAGE_ERROR,
+                                                 GTK_BUTTONS_CLOSE,
+                                                 "Not enough disk space for the recording.\nReduce 'Number of Frames' or the ROI");
+            gtk_dialog_run (GTK_DIALOG (popupError));  // This makes the popup modal
+            gtk_widget_destroy (popupError);
     } else if (API_SUCCESS(rc)) {
         gVideoTab->m_captureInProgress = true;
         gVideoCaptureDialog->begin (atoi (gtk_entry_get_text (GTK_ENTRY(gVideoTab->m_recordTime))) * 1000, // in milliseconds
@@ -866,17 +906,56 @@ extern "C" U32 ClipTermCallback(HANDLE hCamera, U32 uNumFramesStreamed, PXL_RETU
 
     //
     // Step 2
-    //      Format the clip
-    if (API_SUCCESS(uRetCode) && gCamera)
+    //      Format the clip.  Raw recordings are complete as is.
+    if (API_SUCCESS(uRetCode) && gVideoTab->m_recordingRaw)
     {
+        if (getenv ("PXL_CLIP_STATS"))
+        {
+            PxLRawRecordStatistics stats = gVideoTab->m_rawRecorder.statistics();
+            printf ("Raw recording: %u frames of %llu streamed (%llu missing, %u static) in %.2f s, %u writes of %.1f MB (longest %.1f ms), %u ring stalls%s\n",
+                    stats.m_frames, (unsigned long long)stats.m_framesStreamed, (unsigned long long)stats.m_missingFrames,
+                    stats.m_staticFrames,
+                    stats.m_duration, stats.m_writes,
+                    stats.m_writes ? stats.m_bytesWritten / (1024.0 * 1024.0) / stats.m_writes : 0.0,
+                    stats.m_maxWriteTime * 1000.0, stats.m_ringStalls,
+                    stats.m_directIo ? ", O_DIRECT" : "");
+            for (size_t i = 0; i < stats.m_gaps.size(); i++)
+            {
+                printf ("    missing %llu frames from frame %llu\n",
+                        (unsigned long long)stats.m_gaps[i].m_count, (unsigned long long)stats.m_gaps[i].m_firstMissing);
+            }
+        }
+    } else if (API_SUCCESS(uRetCode) && gCamera) {
         // TEMP PEC +++
         //     Uncomment to debug
         //printf ("Using Encoded clip: %s\n", gVideoTab->m_encodedFilename);
         //printf ("To Create videoclip: %s\n", gVideoTab->m_videoFilename);
         // ---
-        gCamera->formatH264Clip(gVideoTab->m_encodedFilename,
-                                gVideoTab->m_videoFilename,
-                                gtk_combo_box_get_active (GTK_COMBO_BOX(gVideoTab->m_fileType)));
+        PXL_RETURN_CODE muxRc = ApiInvalidFunctionCallError;
+        bool fromFifo = false;
+        if (gVideoTab->m_muxer.active())
+        {
+            // The video file is all but done; wait for the last of it.
+            gVideoTab->m_muxer.inputComplete();
+            muxRc = gVideoTab->m_muxer.end();
+            fromFifo = gVideoTab->m_muxFromFifo &&
+                       ! gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON(gVideoTab->m_keepIntermidiate));
+            if (getenv ("PXL_CLIP_STATS"))
+            {
+                PxLClipMuxStatistics stats = gVideoTab->m_muxer.statistics();
+                printf ("Clip mux: rc:0x%X, %u frames (%u key), %llu bytes encoded, %llu bytes muxed, done %.1f ms after the capture\n",
+                        muxRc, stats.m_frames, stats.m_keyFrames,
+                        (unsigned long long)stats.m_bytesIn, (unsigned long long)stats.m_bytesOut,
+                        stats.m_finishTime * 1000.0);
+            }
+        }
+        // If we could not mux it as it was captured, format it the old way (so long as we still have it).
+        if (!API_SUCCESS (muxRc) && ! fromFifo)
+        {
+            gCamera->formatH264Clip(gVideoTab->m_encodedFilename,
+                                    gVideoTab->m_videoFilename,
+                                    gtk_combo_box_get_active (GTK_COMBO_BOX(gVideoTab->m_fileType)));
+        }
     } else if (uRetCode != ApiStreamStopped &&
                uRetCode != ApiNoStreamError) { // Bugzilla.1338 -- don't report error if the user cancelled
         GtkWidget *popup;
@@ -897,6 +976,8 @@ extern "C" U32 ClipTermCallback(HANDLE hCamera, U32 uNumFramesStreamed, PXL_RETU
         gtk_dialog_run (GTK_DIALOG (popup));  // This makes the popup modal
         gtk_widget_destroy (popup);
     }
+    // Don't leave a partial video file behind
+    if (!API_SUCCESS(uRetCode)) gVideoTab->m_muxer.abort();
 
     gVideoTab->m_captureInProgress = false;
     // We need to re-activate the video capture button.  Do this in a gdk thread.
@@ -906,15 +987,17 @@ extern "C" U32 ClipTermCallback(HANDLE hCamera, U32 uNumFramesStreamed, PXL_RETU
     //
     // Step 3
     //      Erase the intermediate file
-    if (! gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON(gVideoTab->m_keepIntermidiate)))
+    if (! gVideoTab->m_recordingRaw &&
+        ! gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON(gVideoTab->m_keepIntermidiate)))
     {
         remove (gVideoTab->m_encodedFilename);
     }
 
     //
     // Step 4
-    //      Launch a viewer if the user requested it.
-    if (gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON(gVideoTab->m_captureLaunch)))
+    //      Launch a viewer if the user requested it (there are none for raw recordings).
+    if (! gVideoTab->m_recordingRaw &&
+        gtk_toggle_button_get_active (GTK_TOGGLE_BUTTON(gVideoTab->m_captureLaunch)))
     {
         pid_t pid = fork();
 
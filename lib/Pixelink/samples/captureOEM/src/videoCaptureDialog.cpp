@@ -11,10 +11,12 @@
 #include "videoCaptureDialog.h"
 #include "camera.h"
 #include "captureOEM.h"
+#include "video.h"
 
 #define  POLL_TIME 1000  // in milliseconds
 
 extern PxLVideoCaptureDialog      *gVideoCaptureDialog;
+extern PxLVideo                   *gVideoTab;
 extern GtkWindow                  *gTopLevelWindow;
 
 // prototypes to allow top down design
@@ -114,8 +116,10 @@ extern "C" void CancelVideoCapture
 {
     if (gVideoCaptureDialog && gCamera)
     {
-        // The user wants to quit.  The only way to do this, is to cycle the stream
+        // The user wants to quit.  The only way to do this, is to cycle the stream (a raw recording
+        // stops as soon as it is told to).
         PxLAutoLock lock(&gCameraLock);
+        if (gVideoTab) gVideoTab->m_rawRecorder.cancel();
         gCamera->stopStream();
         gCamera->startStream();
 
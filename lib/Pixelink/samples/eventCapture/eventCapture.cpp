@@ -0,0 +1,750 @@
+//
+// This demonstrates how to capture fast, transient events, that cannot be anticipated.  Unlike
+// slowMotionVideo, which records a clip from the moment it starts (and so would miss an event
+// that is over before anyone can start it), this application streams continuously into a RAM ring
+// holding the last few seconds of (raw) frames.  When a trigger arrives, the frames already in the
+// ring (the pre-roll) are kept, a few more are recorded (the post-roll), and then both are written to
+// a file in the background -- the stream is never stopped, so the application is immediately ready
+// for the next event.
+//
+// An event can be triggered by:
+//    - The user pressing 't' (a software trigger)
+//    - The camera's GPI (the first GPIO) going active
+//    - Motion; the mean difference between consecutive frames exceeding a threshold
+//
+// This application showcases how to use:
+//    - PxLGetNextFrame, into a pool of buffers that is allocated up front
+//    - FEATURE_GPIO, in GPIO_MODE_INPUT
+//
+// Each event is written to its own file, event_name_NNNN.pxlevt, containing (all values little endian):
+//    - An EVENT_FILE_HEADER
+//    - For each frame (oldest first): an EVENT_FRAME_HEADER, then the raw frame (as returned by
+//      PxLGetNextFrame)
+//
+// NOTE: This application assumes there is at most, one PixeLINK camera connected to the system
+
+#include <iostream>
+#include <stdio.h>
+#include <stdexcept>
+#include <unistd.h>
+#include <stdlib.h>
+#include <cassert>
+#include <vector>
+#include <deque>
+#include <algorithm>
+#include <string.h>
+#include <pthread.h>
+#include "PixeLINKApi.h"
+#include "LinuxUtil.h"
+
+using namespace std;
+
+//
+// A few useful defines and enums.
+//
+#define ASSERT(x)	do { assert((x)); } while(0)
+#define A_OK            0  // non-zero error codes
+#define GENERAL_ERROR   1
+
+#define DEFAULT_PRE_ROLL        (2.0f)  // in seconds
+#define DEFAULT_POST_ROLL       (1.0f)  // in seconds
+#define MAX_ROLL                (60.0f) // in seconds
+#define GPI_POLL_PERIOD_MS      (20)    // How often the GPI is read
+#define MOTION_SAMPLE_STEP      (8)     // Motion is measured on every 8th byte of every 8th row
+#define SPARE_FRAMES            (4)     // Frames in the pool, beyond those needed for the pre and post rolls
+
+#define EVENT_FILE_MAGIC  "PXLEVT01"
+
+typedef struct _EVENT_FILE_HEADER
+{
+    char  magic[8];        // EVENT_FILE_MAGIC
+    U32   headerSize;      // sizeof (EVENT_FILE_HEADER)
+    U32   frameHeaderSize; // sizeof (EVENT_FRAME_HEADER)
+    U32   frames;          // Frames in the file
+    U32   triggerFrame;    // Index (in the file) of the frame that was being grabbed when the trigger arrived
+    U32   frameSize;       // Bytes of frame data after each frame header
+    U32   pixelFormat;
+    U32   width;           // in pixels
+    U32   height;
+    float frameRate;       // of the camera
+    U32   trigger;         // TRIGGER_SOURCE
+} EVENT_FILE_HEADER;
+
+typedef struct _EVENT_FRAME_HEADER
+{
+    U64    frameNumber;    // As numbered by the camera
+    double frameTime;      // Camera time stamp (in seconds)
+} EVENT_FRAME_HEADER;
+
+typedef enum _TRIGGER_SOURCE
+{
+    TRIGGER_NONE = 0,
+    TRIGGER_SOFTWARE,
+    TRIGGER_GPI,
+    TRIGGER_MOTION
+} TRIGGER_SOURCE;
+
+// One frame buffer from the pool
+typedef struct _FRAME_BUFFER
+{
+    vector<U8>  data;
+    FRAME_DESC  desc;
+} FRAME_BUFFER;
+
+// An event that is waiting to be written
+typedef struct _EVENT
+{
+    U32            number;
+    TRIGGER_SOURCE trigger;
+    U32            triggerFrame;
+    deque<FRAME_BUFFER*> frames;
+} EVENT;
+
+// Prototypes to allow top-down structure
+void  usage (char* argv[]);
+int   getParameters (int argc, char* argv[], float* preRoll, float* postRoll, float* motionThreshold, bool* useGpi, char* eventName);
+float effectiveFrameRate (HANDLE hCamera);
+static U32   determineRawImageSize (HANDLE hCamera, U32* pixelFormat, U32* width, U32* height);
+static float getPixelSize (U32 pixelFormat);
+static bool  setupGpi (HANDLE hCamera);
+static bool  gpiActive (HANDLE hCamera);
+static float motionScore (const FRAME_BUFFER* pFrame, vector<U8>& lastSamples);
+static void* eventWriter (void* pData);
+
+//
+// State shared between our main line (which grabs the frames), and the event writer thread.  The pool of
+// frame buffers is shared too; a buffer is either free, in the ring, in the event being recorded, or
+// in an event waiting to be written.
+static pthread_mutex_t   poolMutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t    poolCond = PTHREAD_COND_INITIALIZER;
+static vector<FRAME_BUFFER*> freeFrames;
+static deque<EVENT*>     pendingEvents;
+static bool              writerDone = false;
+static char              eventName[256];
+static EVENT_FILE_HEADER fileHeaderTemplate;
+
+int main (int argc, char* argv[])
+{
+    float preRoll;
+    float postRoll;
+    float motionThreshold;
+    bool  useGpi;
+
+    //
+    // Step 1
+    //      Validate the user parameters
+    if (A_OK != getParameters(argc, argv, &preRoll, &postRoll, &motionThreshold, &useGpi, eventName))
+    {
+        usage(argv);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 2
+    //		Grab our camera
+    HANDLE          hCamera;
+    PXL_RETURN_CODE rc = A_OK;
+    U32             uNumberOfCameras = 0;
+
+    rc = PxLGetNumberCameras (NULL, &uNumberOfCameras);
+    if (!API_SUCCESS(rc) || uNumberOfCameras != 1)
+    {
+        printf (" Error:  There should be exactly one PixeLINK camera connected.\n");
+        return GENERAL_ERROR;
+    }
+    rc = PxLInitialize (0, &hCamera);
+    if (!API_SUCCESS(rc))
+    {
+        printf (" Error:  Could not initialize the camera.\n");
+        return GENERAL_ERROR;
+    }
+    if (useGpi && !setupGpi (hCamera))
+    {
+        printf (" Error:  The camera does not have a GPI (or it could not be set up).\n");
+        PxLUninitialize (hCamera);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 3
+    //      Allocate the entire pool of frame buffers up front; nothing is allocated once we are streaming.
+    //      We need enough for the pre-roll, the post-roll, and a fresh pre-roll to be gathered while the
+    //      previous event is being written.
+    U32   pixelFormat, width, height;
+    U32   frameSize = determineRawImageSize (hCamera, &pixelFormat, &width, &height);
+    float cameraFps = effectiveFrameRate (hCamera);
+    if (0 == frameSize)
+    {
+        printf (" Error:  Could not determine the size of the camera's frames.\n");
+        PxLUninitialize (hCamera);
+        return GENERAL_ERROR;
+    }
+    U32 preFrames  = (U32)(preRoll * cameraFps + 0.5f);
+    U32 postFrames = max ((U32)1, (U32)(postRoll * cameraFps + 0.5f));
+    U32 poolFrames = 2 * preFrames + postFrames + SPARE_FRAMES;
+    printf (" Allocating %d frames (%.1f MB) to hold %.1f s of pre-roll and %.1f s of post-roll at %.1f fps...\n",
+            poolFrames, ((float)poolFrames * frameSize) / (1024.0f * 1024.0f), preRoll, postRoll, cameraFps);
+    vector<FRAME_BUFFER> pool;
+    try
+    {
+        pool.resize (poolFrames);
+        for (U32 i = 0; i < poolFrames; i++)
+        {
+            pool[i].data.resize (frameSize);
+            freeFrames.push_back (&pool[i]);
+        }
+    } catch (std::bad_alloc&) {
+        printf (" Error:  Not enough memory; reduce the pre-roll or post-roll.\n");
+        PxLUninitialize (hCamera);
+        return GENERAL_ERROR;
+    }
+
+    memset (&fileHeaderTemplate, 0, sizeof(fileHeaderTemplate));
+    memcpy (fileHeaderTemplate.magic, EVENT_FILE_MAGIC, sizeof(fileHeaderTemplate.magic));
+    fileHeaderTemplate.headerSize = sizeof(EVENT_FILE_HEADER);
+    fileHeaderTemplate.frameHeaderSize = sizeof(EVENT_FRAME_HEADER);
+    fileHeaderTemplate.frameSize = frameSize;
+    fileHeaderTemplate.pixelFormat = pixelFormat;
+    fileHeaderTemplate.width = width;
+    fileHeaderTemplate.height = height;
+    fileHeaderTemplate.frameRate = cameraFps;
+
+    //
+    // Step 4
+    //      Start the stream, and the thread that writes the events
+    pthread_t writerThread;
+    if (0 != pthread_create (&writerThread, NULL, eventWriter, NULL))
+    {
+        printf (" Error:  Could not start the event writer.\n");
+        PxLUninitialize (hCamera);
+        return GENERAL_ERROR;
+    }
+    if (!API_SUCCESS (PxLSetStreamState (hCamera, START_STREAM)))
+    {
+        printf (" Error:  Could not start the stream.\n");
+        writerDone = true;
+        pthread_cond_broadcast (&poolCond);
+        pthread_join (writerThread, NULL);
+        PxLUninitialize (hCamera);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 5
+    //      Grab frames into the ring until the user quits, recording an event whenever we are triggered.
+    printf (" Armed.  Press 't' to trigger an event%s%s, or 'q' to quit...\n\n",
+            useGpi ? ", or activate the GPI" : "",
+            motionThreshold > 0.0f ? ", or move something in front of the camera" : "");
+    DontWaitForEnter unbufferedKeyboard;
+    deque<FRAME_BUFFER*> ring;          // The pre-roll; oldest first
+    EVENT*     pEvent = NULL;           // The event being recorded (during the post-roll)
+    U32        postRemaining = 0;
+    U32        eventNumber = 0;
+    U32        droppedFrames = 0;       // Frames we had no buffer for
+    bool       lastGpi = true;          // So that a GPI that is already active does not trigger us
+    time_t     lastGpiPoll = 0;
+    vector<U8> motionSamples;
+    vector<U8> scratch (frameSize);     // Where frames go, when we have no buffer for them
+    FRAME_DESC scratchDesc;
+    bool       quit = false;
+
+    while (!quit)
+    {
+        // Find a buffer for the next frame; if the writer has all of the spare ones, shorten the pre-roll.
+        FRAME_BUFFER* pFrame = NULL;
+        bool fromRing = false;              // pFrame is the oldest of the pre-roll, rather than a free buffer
+        pthread_mutex_lock (&poolMutex);
+        if (!freeFrames.empty())
+        {
+            pFrame = freeFrames.back();
+            freeFrames.pop_back();
+        }
+        pthread_mutex_unlock (&poolMutex);
+        if (NULL == pFrame && !ring.empty())
+        {
+            pFrame = ring.front();
+            ring.pop_front();
+            fromRing = true;
+        }
+
+        if (NULL != pFrame)
+        {
+            pFrame->desc.uSize = sizeof(FRAME_DESC);
+            rc = PxLGetNextFrame (hCamera, frameSize, &pFrame->data[0], &pFrame->desc);
+        } else {
+            // Keep the stream flowing, even though we have nowhere to keep this frame.
+            scratchDesc.uSize = sizeof(FRAME_DESC);
+            rc = PxLGetNextFrame (hCamera, frameSize, &scratch[0], &scratchDesc);
+            droppedFrames++;
+        }
+        if (!API_SUCCESS (rc))
+        {
+            // Probably a dropped or damaged frame; PxLGetNextFrame will resync on the next one.  The buffer goes
+            // back where it came from; a free buffer holds no frame, so it must not go into the ring.
+            if (fromRing)
+            {
+                ring.push_front (pFrame);
+            } else if (NULL != pFrame) {
+                pthread_mutex_lock (&poolMutex);
+                freeFrames.push_back (pFrame);
+                pthread_mutex_unlock (&poolMutex);
+            }
+            continue;
+        }
+
+        //
+        // Step 5a
+        //      Has something happened?
+        TRIGGER_SOURCE trigger = TRIGGER_NONE;
+        if (kbhit())
+        {
+            int key = getchar();
+            if (key == 'q' || key == 'Q') quit = true;
+            if (key == 't' || key == 'T') trigger = TRIGGER_SOFTWARE;
+        }
+        if (useGpi && (timeInMilliseconds() - lastGpiPoll) >= GPI_POLL_PERIOD_MS)
+        {
+            lastGpiPoll = timeInMilliseconds();
+            bool gpi = gpiActive (hCamera);
+            if (gpi && !lastGpi) trigger = TRIGGER_GPI;
+            lastGpi = gpi;
+        }
+        if (motionThreshold > 0.0f && NULL != pFrame)
+        {
+            float score = motionScore (pFrame, motionSamples);
+            if (score > motionThreshold && trigger == TRIGGER_NONE) trigger = TRIGGER_MOTION;
+        }
+        if (NULL == pFrame) continue;
+
+        //
+        // Step 5b
+        //      Add the frame to the pre-roll, or to the post-roll of the event being recorded.
+        if (NULL == pEvent)
+        {
+            // The ring holds the pre-roll, and this frame (which may yet be the trigger frame)
+            ring.push_back (pFrame);
+            while (ring.size() > preFrames + 1)
+            {
+                FRAME_BUFFER* pOldest = ring.front();
+                ring.pop_front();
+                pthread_mutex_lock (&poolMutex);
+                freeFrames.push_back (pOldest);
+                pthread_mutex_unlock (&poolMutex);
+            }
+
+            if (trigger != TRIGGER_NONE)
+            {
+                // Freeze the pre-roll; the frame that saw the trigger is the first of the post-roll.
+                pEvent = new EVENT;
+                pEvent->number = ++eventNumber;
+                pEvent->trigger = trigger;
+                pEvent->frames.swap (ring);
+                pEvent->triggerFrame = pEvent->frames.size() - 1;
+                postRemaining = postFrames - 1;
+                printf (" Event %d triggered by %s at frame %llu\n", eventNumber,
+                        trigger == TRIGGER_SOFTWARE ? "the keyboard" : trigger == TRIGGER_GPI ? "the GPI" : "motion",
+                        (unsigned long long)(pFrame->desc.u64FrameNumber ? pFrame->desc.u64FrameNumber : pFrame->desc.uFrameNumber));
+            }
+        } else {
+            pEvent->frames.push_back (pFrame);
+            postRemaining--;
+        }
+
+        //
+        // Step 5c
+        //      Once the post-roll is complete, hand the event to the writer.
+        if (NULL != pEvent && (0 == postRemaining || quit))
+        {
+            pthread_mutex_lock (&poolMutex);
+            pendingEvents.push_back (pEvent);
+            pthread_cond_broadcast (&poolCond);
+            pthread_mutex_unlock (&poolMutex);
+            pEvent = NULL;
+        }
+    }
+
+    //
+    // Step 6
+    //      Let the writer finish with any events it still has.
+    PxLSetStreamState (hCamera, STOP_STREAM);
+    pthread_mutex_lock (&poolMutex);
+    writerDone = true;
+    pthread_cond_broadcast (&poolCond);
+    pthread_mutex_unlock (&poolMutex);
+    pthread_join (writerThread, NULL);
+
+    printf ("\n %d events recorded.\n", eventNumber);
+    if (droppedFrames > 0)
+    {
+        printf (" Warning\n %d frames were not kept, as the pre-roll could not be recycled quickly enough.\n", droppedFrames);
+    }
+
+    PxLUninitialize (hCamera);
+    return A_OK;
+}
+
+//
+// The body of the event writer thread.  Writes each event to its own file, returning the frame buffers
+// to the pool as it goes (so the ring can be refilled while the rest of the event is still being written).
+//
+static void* eventWriter (void* pData)
+{
+    for (;;)
+    {
+        pthread_mutex_lock (&poolMutex);
+        while (pendingEvents.empty() && !writerDone) pthread_cond_wait (&poolCond, &poolMutex);
+        if (pendingEvents.empty())
+        {
+            pthread_mutex_unlock (&poolMutex);
+            break;
+        }
+        EVENT* pEvent = pendingEvents.front();
+        pendingEvents.pop_front();
+        pthread_mutex_unlock (&poolMutex);
+
+        //
+        // Step 1
+        //      The file header
+        char fileName[300];
+        snprintf (fileName, sizeof(fileName), "%s_%04d.pxlevt", eventName, pEvent->number);
+        FILE* pFile = fopen (fileName, "wb");
+        if (NULL == pFile) printf (" Error:  Could not create %s\n", fileName);
+
+        EVENT_FILE_HEADER header = fileHeaderTemplate;
+        header.frames = pEvent->frames.size();
+        header.triggerFrame = pEvent->triggerFrame;
+        header.trigger = pEvent->trigger;
+        bool ok = NULL != pFile && 1 == fwrite (&header, sizeof(header), 1, pFile);
+
+        //
+        // Step 2
+        //      The frames, oldest first
+        while (!pEvent->frames.empty())
+        {
+            FRAME_BUFFER* pFrame = pEvent->frames.front();
+            pEvent->frames.pop_front();
+
+            EVENT_FRAME_HEADER frameHeader;
+            frameHeader.frameNumber = pFrame->desc.u64FrameNumber ? pFrame->desc.u64FrameNumber : pFrame->desc.uFrameNumber;
+            frameHeader.frameTime = pFrame->desc.dFrameTime != 0.0 ? pFrame->desc.dFrameTime : pFrame->desc.fFrameTime;
+            if (ok) ok = 1 == fwrite (&frameHeader, sizeof(frameHeader), 1, pFile);
+            if (ok) ok = 1 == fwrite (&pFrame->data[0], pFrame->data.size(), 1, pFile);
+
+            pthread_mutex_lock (&poolMutex);
+            freeFrames.push_back (pFrame);
+            pthread_mutex_unlock (&poolMutex);
+        }
+
+        if (NULL != pFile && 0 != fclose (pFile)) ok = false;
+        if (ok)
+        {
+            printf (" Event %d written to %s (%d frames, %d before the trigger)\n",
+                    pEvent->number, fileName, header.frames, header.triggerFrame);
+        } else if (NULL != pFile) {
+            printf (" Error:  Could not write %s\n", fileName);
+        }
+        delete pEvent;
+    }
+    return NULL;
+}
+
+//
+// A (very) simple measure of motion:  the mean absolute difference, between this frame and the last,
+// of a sparse sampling of the frame's bytes.  It works on the raw bytes, so it is only approximate for
+// the packed and multi-byte pixel formats, but it need only tell 'nothing happening' from 'something
+// happening'.
+//
+static float motionScore (const FRAME_BUFFER* pFrame, vector<U8>& lastSamples)
+{
+    const U32 rowBytes = pFrame->data.size() / max ((U32)1, fileHeaderTemplate.height);
+    U32 numSamples = 0;
+    U32 totalDiff = 0;
+    bool first = lastSamples.empty();
+
+    for (U32 y = 0; y < fileHeaderTemplate.height; y += MOTION_SAMPLE_STEP)
+    {
+        const U8* pRow = &pFrame->data[y * rowBytes];
+        for (U32 x = 0; x < rowBytes; x += MOTION_SAMPLE_STEP)
+        {
+            if (first)
+            {
+                lastSamples.push_back (pRow[x]);
+            } else {
+                totalDiff += abs ((int)pRow[x] - (int)lastSamples[numSamples]);
+                lastSamples[numSamples] = pRow[x];
+            }
+            numSamples++;
+        }
+    }
+
+    return first || 0 == numSamples ? 0.0f : (float)totalDiff / numSamples;
+}
+
+//
+// Sets the first GPIO up as an input.  Returns false if the camera does not have a GPI.
+//
+static bool setupGpi (HANDLE hCamera)
+{
+    U32 bufferSize = 0;
+    if (!API_SUCCESS (PxLGetCameraFeatures (hCamera, FEATURE_GPIO, NULL, &bufferSize))) return false;
+    vector<U8> buffer(bufferSize, 0);
+    CAMERA_FEATURES* pGpioFeatureInfo = (CAMERA_FEATURES*)&buffer[0];
+    if (!API_SUCCESS (PxLGetCameraFeatures (hCamera, FEATURE_GPIO, pGpioFeatureInfo, &bufferSize))) return false;
+    if (! (pGpioFeatureInfo->pFeatures->uFlags & FEATURE_FLAG_PRESENCE)) return false;
+    if (pGpioFeatureInfo->pFeatures->pParams[1].fMaxValue < GPIO_MODE_INPUT) return false;
+
+    float gpioParams[6] = {0};
+    gpioParams[FEATURE_GPIO_PARAM_GPIO_INDEX] = 1.0; // The first GPIO
+    gpioParams[FEATURE_GPIO_PARAM_MODE]       = (float)GPIO_MODE_INPUT;
+    gpioParams[FEATURE_GPIO_PARAM_POLARITY]   = (float)0;
+    return API_SUCCESS (PxLSetFeature (hCamera, FEATURE_GPIO, FEATURE_FLAG_MANUAL, 6, gpioParams));
+}
+
+static bool gpiActive (HANDLE hCamera)
+{
+    float gpioParams[6] = {0};
+    U32   flags;
+    U32   numParams = 6;
+    gpioParams[FEATURE_GPIO_PARAM_GPIO_INDEX] = 1.0;
+    if (!API_SUCCESS (PxLGetFeature (hCamera, FEATURE_GPIO, &flags, &numParams, gpioParams))) return false;
+    return gpioParams[FEATURE_GPIO_MODE_INPUT_PARAM_STATUS] != 0.0f;
+}
+
+//
+// Returns the frame rate being used by the camera.  Ideally, this is simply FEAUTURE_ACTUAL_FRAME_RATE, but
+// some older cameras do not support that.  If that is the case, use FEATURE_FRAME_RATE, which is
+// always supported.
+//
+float effectiveFrameRate (HANDLE hCamera)
+{
+    float frameRate = 30.0f;
+    PXL_RETURN_CODE rc;
+
+    //
+    // Step 1
+    //      Determine if the camera supports FEATURE_ACTUAL_FRAME_RATE
+    U32 bufferSize = -1;
+    U32 frameRateFeature = FEATURE_FRAME_RATE;
+    if (API_SUCCESS (PxLGetCameraFeatures(hCamera, FEATURE_ACTUAL_FRAME_RATE, NULL, &bufferSize)))
+    {
+        ASSERT(bufferSize > 0);
+
+        // Declare a buffer and read the feature information
+        vector<U8> buffer(bufferSize, 0);  // zero-initialized buffer
+        CAMERA_FEATURES* pCameraFeatures = (CAMERA_FEATURES*)&buffer[0];
+        if (API_SUCCESS (PxLGetCameraFeatures(hCamera, FEATURE_ACTUAL_FRAME_RATE, pCameraFeatures, &bufferSize)))
+        {
+            //
+            //  Step 2
+            //      Get the 'best available' frame rate of the camera
+            if (pCameraFeatures[0].pFeatures->uFlags & FEATURE_FLAG_PRESENCE)
+            {
+                frameRateFeature = FEATURE_ACTUAL_FRAME_RATE;
+            }
+        }
+    }
+
+    U32 flags;
+    U32 numParams = 1;
+    rc = PxLGetFeature (hCamera, frameRateFeature, &flags, &numParams, &frameRate);
+    ASSERT(API_SUCCESS(rc));
+
+    return frameRate;
+}
+
+//
+// Returns the size (in bytes) of the camera's raw frames, or 0 on failure.  Also returns the pixel
+// format and the dimensions (in pixels) of the frames.
+//
+static U32 determineRawImageSize (HANDLE hCamera, U32* pixelFormat, U32* width, U32* height)
+{
+    float parms[4];     // reused for each feature query
+    U32 flags = FEATURE_FLAG_MANUAL;
+    U32 numParams;
+
+    // Get Region of interest (ROI)
+    numParams = 4; // left, top, width, height
+    if (!API_SUCCESS (PxLGetFeature(hCamera, FEATURE_ROI, &flags, &numParams, &parms[0]))) return 0;
+    U32 roiWidth  = (U32)parms[2];
+    U32 roiHeight = (U32)parms[3];
+
+    // Ask about Pixel Addressing
+    numParams = 4; // value, mode, x_value, y_value
+    U32 paX = 1, paY = 1;
+    if (API_SUCCESS (PxLGetFeature(hCamera, FEATURE_PIXEL_ADDRESSING, &flags, &numParams, &parms[0])))
+    {
+        paX = max ((U32)1, (U32)(numParams >= 4 ? parms[2] : parms[0]));
+        paY = max ((U32)1, (U32)(numParams >= 4 ? parms[3] : parms[0]));
+    }
+
+    // Pixel Format
+    numParams = 1;
+    if (!API_SUCCESS (PxLGetFeature(hCamera, FEATURE_PIXEL_FORMAT, &flags, &numParams, &parms[0]))) return 0;
+    *pixelFormat = (U32)parms[0];
+
+    *width = roiWidth / paX;
+    *height = roiHeight / paY;
+    return (U32) ((float)(*width * *height) * getPixelSize (*pixelFormat));
+}
+
+//
+// Given the pixel format, return the size of a individual pixel (in bytes)
+//
+// Returns 0 on failure.
+//
+static float getPixelSize (U32 pixelFormat)
+{
+    float retVal = 0.0f;
+
+    switch(pixelFormat) {
+
+        case PIXEL_FORMAT_MONO8:
+        case PIXEL_FORMAT_BAYER8_GRBG:
+        case PIXEL_FORMAT_BAYER8_RGGB:
+        case PIXEL_FORMAT_BAYER8_GBRG:
+        case PIXEL_FORMAT_BAYER8_BGGR:
+            retVal = 1.0f;
+            break;
+
+        case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
+        case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
+        case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
+        case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
+        case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+            retVal = 1.25f;
+            break;
+
+        case PIXEL_FORMAT_MONO12_PACKED:
+        case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
+        case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+        case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
+        case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+        case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
+        case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
+        case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+        case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
+        case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+            retVal = 1.5f;
+            break;
+
+        case PIXEL_FORMAT_YUV422:
+        case PIXEL_FORMAT_MONO16:
+        case PIXEL_FORMAT_BAYER16_GRBG:
+        case PIXEL_FORMAT_BAYER16_RGGB:
+        case PIXEL_FORMAT_BAYER16_GBRG:
+        case PIXEL_FORMAT_BAYER16_BGGR:
+            retVal = 2.0f;
+            break;
+
+        case PIXEL_FORMAT_RGB24:
+            retVal = 3.0f;
+            break;
+
+        case PIXEL_FORMAT_RGB48:
+        case PIXEL_FORMAT_STOKES4_12:
+        case PIXEL_FORMAT_POLAR4_12:
+        case PIXEL_FORMAT_POLAR_RAW4_12:
+        case PIXEL_FORMAT_HSV4_12:
+            retVal = 6.0f;
+            break;
+
+        default:
+            assert(0);
+            break;
+    }
+    return retVal;
+}
+
+void usage (char* argv[])
+{
+        printf("\n This application captures fast, transient events.  It streams continuously into a RAM ring that\n");
+        printf(" holds the last few seconds of (raw) frames.  When triggered, it keeps the frames leading up to the\n");
+        printf(" trigger (the pre-roll), and those that follow it (the post-roll), and writes them to a file in the\n");
+        printf(" background, without stopping the stream.  Events can be triggered from the keyboard ('t'), the\n");
+        printf(" camera's GPI, or by motion in front of the camera.\n\n");
+        printf("    Usage: %s [-p pre_roll] [-o post_roll] [-m motion_threshold] [-g] event_name \n", argv[0]);
+        printf("       where: \n");
+        printf("          -p pre_roll           Time before the trigger to keep (in seconds).  Its default\n");
+        printf("                                value is %.1f \n", DEFAULT_PRE_ROLL);
+        printf("          -o post_roll          Time after the trigger to keep (in seconds).  Its default\n");
+        printf("                                value is %.1f \n", DEFAULT_POST_ROLL);
+        printf("          -m motion_threshold   Trigger when the mean difference between consecutive frames\n");
+        printf("                                exceeds this value (0 to 255).  By default, motion does not\n");
+        printf("                                trigger an event.\n");
+        printf("          -g                    Trigger when the GPI (the first GPIO) goes active.\n");
+        printf("          event_name            Events are written to event_name_NNNN.pxlevt \n");
+        printf("    Example: \n");
+        printf("        %s -p 5 -o 2 -m 12 door \n", argv[0]);
+        printf("              This will keep 5 seconds before, and 2 seconds after, anything moving in front of\n");
+        printf("              the camera, in door_0001.pxlevt, door_0002.pxlevt, ... \n");
+}
+
+int getParameters (int argc, char* argv[], float* preRoll, float* postRoll, float* motionThreshold, bool* useGpi, char* fileName)
+{
+    // Default our local copies to the user supplied values
+    float fPreRoll = DEFAULT_PRE_ROLL;
+    float fPostRoll = DEFAULT_POST_ROLL;
+    float fMotionThreshold = 0.0f;
+    bool  bUseGpi = false;
+
+    //
+    // Step 1
+    //      Simple parameter parameter check
+    if (argc < 2 || argc > 9)
+    {
+        printf ("\n ERROR -- Incorrect number of parameters\n");
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 2
+    //      Parse the command line looking for the optional parameters.
+    float parm;
+    for (int i=1; i<argc-1; i++)
+    {
+        if (!strcmp(argv[i],"-p") ||
+            !strcmp(argv[i],"-P"))
+        {
+            if (i+1 >= argc) return GENERAL_ERROR;
+            parm = atof(argv[i+1]);
+            if (parm < 0.0f || parm > MAX_ROLL) return  GENERAL_ERROR;
+            fPreRoll = parm;
+            i++;
+        } else if (!strcmp(argv[i],"-o") ||
+                   !strcmp(argv[i],"-O")) {
+            if (i+1 >= argc) return GENERAL_ERROR;
+            parm = atof(argv[i+1]);
+            if (parm < 0.0f || parm > MAX_ROLL) return  GENERAL_ERROR;
+            fPostRoll = parm;
+            i++;
+        } else if (!strcmp(argv[i],"-m") ||
+                   !strcmp(argv[i],"-M")) {
+            if (i+1 >= argc) return GENERAL_ERROR;
+            parm = atof(argv[i+1]);
+            if (parm <= 0.0f || parm > 255.0f) return  GENERAL_ERROR;
+            fMotionThreshold = parm;
+            i++;
+        } else if (!strcmp(argv[i],"-g") ||
+                   !strcmp(argv[i],"-G")) {
+            bUseGpi = true;
+        } else {
+            return GENERAL_ERROR;
+        }
+    }
+
+    //
+    // Step 3
+    //      The last parameter must be the event name
+    if (argv[argc-1][0] == '-') return GENERAL_ERROR;
+
+    //
+    // Step 4
+    //      Let the app know the user parameters.
+    *preRoll = fPreRoll;
+    *postRoll = fPostRoll;
+    *motionThreshold = fMotionThreshold;
+    *useGpi = bUseGpi;
+    strncpy (fileName, argv[argc-1], 255);
+    fileName[255] = 0;
+    return A_OK;
+}
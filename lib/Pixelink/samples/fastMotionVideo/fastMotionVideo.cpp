@@ -2,11 +2,17 @@
 // This demonstrates how to create videos using the PixeLINK API.  Specifically, 
 // this applocation will create videos that play back normal motion, to fast motion.
 // It will also accomodate the creation of periodic uncompressed still images while
-// the video is being cpatured
+// the video is being cpatured.  The stills are taken from the very frames that are feeding
+// the clip (see stillTee.cpp), so the two never compete for the stream.
+//
+// Optionally (-q), rather than a clip using every N'th frame, it will build the time-lapse
+// from the best frame (the sharpest, best exposed, least blurred by motion) of each run of
+// N frames, as a sequence of still images.
 //
 // This application showcases how to use:
 //    - PxLGetH264Clip
 //    - PxLFormatClipEx
+//    - PxLSetCallback
 //
 // NOTE: This application assumes there is at most, one PixeLINK camera connected to the system
 
@@ -19,8 +25,9 @@
 #include <vector>
 #include <string.h>
 #include "PixeLINKApi.h"
+#include "PxLProfile.h"
 #include "LinuxUtil.h"
-#include "getsnapshot.h"
+#include "stillTee.h"
 
 using namespace std;
 
@@ -37,10 +44,12 @@ using namespace std;
 #define DEFAULT_CLIP_DECIMATION   5           // Every X'th frame will be included in the clip
 
 #define DEFAULT_IMAGE_CAPTURE_PERIOD  10      // in seconds
+#define NO_FRAME_INTERVAL             0       // Stills are taken by time, rather than every N'th frame
+#define NO_QUALITY_BUDGET             0       // A clip using every N'th frame, rather than a time-lapse of the best frames
 
 // Prototypes to allow top-down structure
 void  usage (char* argv[]);
-int   getParameters (int argc, char* argv[], U32* recordTime, U32* decimation, U32* imagePeriod, U32* frameRte, char** fileNames);
+int   getParameters (int argc, char* argv[], U32* recordTime, U32* decimation, U32* imagePeriod, U32* frameInterval, U32* qualityBudget, U32* frameRte, char** fileNames);
 float effectiveFrameRate (HANDLE hCamera);
 static U32 CaptureDoneCallback(HANDLE hCamera, U32 numFramesCapture, PXL_RETURN_CODE returnCode);
 
@@ -54,15 +63,16 @@ int main (int argc, char* argv[])
     U32  recordTime;
     U32  decimation;
     U32  imagePeriod;
+    U32  frameInterval;
+    U32  qualityBudget;
     U32  frameRate;
     char* rootName;
     vector<char> aviFile(256,0);
-    vector<char> bmpFile(256,0);
 
     //
     // Step 1
     //      Validate the user parameters, getting user specified (or default) values
-    if (A_OK != getParameters(argc, argv, &recordTime, &decimation, &imagePeriod, &frameRate, &rootName))
+    if (A_OK != getParameters(argc, argv, &recordTime, &decimation, &imagePeriod, &frameInterval, &qualityBudget, &frameRate, &rootName))
     {
         usage(argv);
         return GENERAL_ERROR;
@@ -91,32 +101,42 @@ int main (int argc, char* argv[])
     // 
     // Step 3
     //      Determine the effective frame rate for the camera, and the number of images we will need to
-    //      capture the video of the requested length then start the stream
+    //      capture the video of the requested length
     float cameraFps = effectiveFrameRate(hCamera);
     U32   numImages = (U32)(((float)recordTime) * cameraFps);
     numImages = numImages/decimation + 1; // Include the decimation factor
+
+    //
+    // Step 4
+    //      Tee the still images (or the time-lapse frames) off of the stream, before starting it.  From
+    //      here on, there are no stream state changes until the clip is done.
+    bool timeLapse = (qualityBudget != NO_QUALITY_BUDGET);
+    bool takingStills = (timeLapse || imagePeriod > 0 || frameInterval != NO_FRAME_INTERVAL);
+    if (takingStills)
+    {
+        if (timeLapse)
+        {
+            rc = startStillTee (hCamera, rootName, STILLS_BEST_OF_WINDOW, decimation, qualityBudget);
+        } else if (frameInterval != NO_FRAME_INTERVAL) {
+            rc = startStillTee (hCamera, rootName, STILLS_EVERY_NTH_FRAME, frameInterval, NO_QUALITY_BUDGET);
+        } else {
+            rc = startStillTee (hCamera, rootName, STILLS_PERIODIC, imagePeriod, NO_QUALITY_BUDGET);
+        }
+        if (A_OK != rc)
+        {
+            printf (" Error:  Could not set up the still image capture.\n");
+            PxLUninitialize (hCamera);
+            return GENERAL_ERROR;
+        }
+    }
     if (!API_SUCCESS (PxLSetStreamState (hCamera, START_STREAM)))
     {
         printf (" Error:  Could not start the stream.\n");
+        if (takingStills) stopStillTee (hCamera, NULL);
         PxLUninitialize (hCamera);
         return GENERAL_ERROR;
     }
 
-    //
-    // Step 4
-    //      Figure out time base, and when we should be capturing our first image
-    int capImageNum = 0;
-    time_t  currentTime;
-    time_t  nextImageTime;
-
-    nextImageTime = currentTime = timeInMilliseconds() / 1000;
-    if (imagePeriod < 1)
-    {
-        // This means the user is not interested in capturing still images, 
-        // seet the nextCapture to a very long period from now
-        nextImageTime += recordTime * 100;
-    }
-
     //
     // Step 5
     //      Start captureing the required images into the clip
@@ -130,16 +150,33 @@ int main (int argc, char* argv[])
     clipInfo.playbackFrameRate = (float)frameRate;
     clipInfo.playbackBitRate = CLIP_PLAYBACK_BITRATE_DEFAULT;
 
-    printf (" Recording %d seconds of h264 compressed video (based on %d images) + still images ever %d seconds.\n",
-            recordTime, numImages, imagePeriod);
+    if (timeLapse)
+    {
+        printf (" Recording a %d second time-lapse (about %d images), using the best of every %d frames.\n",
+                recordTime, numImages, decimation);
+    } else if (frameInterval != NO_FRAME_INTERVAL) {
+        printf (" Recording %d seconds of h264 compressed video (based on %d images) + a still image every %d frames.\n",
+                recordTime, numImages, frameInterval);
+    } else {
+        printf (" Recording %d seconds of h264 compressed video (based on %d images) + still images ever %d seconds.\n",
+                recordTime, numImages, imagePeriod);
+    }
     printf (" Press any key to abort...\n\n");
     captureFinished = false;
-    rc = PxLGetEncodedClip (hCamera, numImages, &h264File[0], &clipInfo, CaptureDoneCallback);
-    if (API_SUCCESS(rc))
+    if (timeLapse)
+    {
+        // The tee does all of the work; just let the stream run for the requested time.
+        time_t endTime = timeInMilliseconds() / 1000 + recordTime;
+        while (!kbhit() && timeInMilliseconds() / 1000 < endTime) usleep (200*1000);
+    } else {
+        rc = PxLGetEncodedClip (hCamera, numImages, &h264File[0], &clipInfo, CaptureDoneCallback);
+    }
+    if (API_SUCCESS(rc) && !timeLapse)
     {
         //
         // Step 6
-        //      While we are waiting for the clip to finsh (or for the user to quit), collect still images at the requested frequency
+        //      Wait for the clip to finsh (or for the user to quit).  The still images are collected by the tee as the frames
+        //      go by.
 
         while (!captureFinished)
         {
@@ -151,38 +188,56 @@ int main (int argc, char* argv[])
             } else {
                 // No need to steal a bunck of cpu cycles on a loop doing nothing -- sleep for a bit until it's time to check for keyboard
                 // input again.
-                currentTime = timeInMilliseconds() / 1000;
-                if (currentTime >= nextImageTime)
-                {
-                    // It's time to capture an image
-                    sprintf (&bmpFile[0], "%s%d.bmp", rootName, capImageNum);  
-                    getSnapshot (hCamera, IMAGE_FORMAT_BMP, &bmpFile[0]);
-                    nextImageTime = currentTime + imagePeriod;
-                    capImageNum++;
-                } else {
-                    usleep (200*1000); // There was nothing to do -- don't waste too much time
-                }
+                usleep (200*1000);
             }
         }
     }
     PxLSetStreamState (hCamera, STOP_STREAM);  //already stopped if user aborted, but that's OK
 
     //
-    // Step 6
+    // Step 7
+    //      Report on the still images, and on any frames that both the clip and the stills lost
+    if (takingStills)
+    {
+        STILL_TEE_STATS stillStats;
+        stopStillTee (hCamera, &stillStats);
+        printf (" Stills:  %d saved of %d selected", stillStats.stillsSaved, stillStats.stillsSelected);
+        if (stillStats.stillsDropped) printf (", %d dropped (encoder busy)", stillStats.stillsDropped);
+        if (stillStats.stillsFailed)  printf (", %d could not be saved", stillStats.stillsFailed);
+        if (stillStats.stillsLate)    printf (", %d taken from the next frame (the exact frame was lost)", stillStats.stillsLate);
+        printf (".\n");
+        if (timeLapse)
+        {
+            printf (" Scoring: %d of %d frames scored, %d us per frame on average (%d us max, budget %d us, %d us of it copying), %d over budget.\n",
+                    stillStats.framesScored, stillStats.framesSeen, stillStats.averageUs, stillStats.maxUs, qualityBudget,
+                    stillStats.copyUs, stillStats.overBudget);
+        }
+        if (stillStats.streamGaps)
+        {
+            printf (" Stream:  %d of %d frames were lost before reaching the host; they are missing from the clip too.\n",
+                    stillStats.streamGaps, stillStats.framesSeen + stillStats.streamGaps);
+        }
+    }
+
+    //
+    // Step 8
     //      Clip capture is done.  If it completed OK, create the clip video file (.avi)
-    if (API_SUCCESS (rc))
+    if (API_SUCCESS (rc) && !timeLapse)
     {
         if (API_SUCCESS (captureRc))
         {
             if (captureRc == ApiSuccessWithFrameLoss)
             {
                 printf ("Warning\n %d images had to be streamed to capture %d of them.\n",numImagesStreamed,numImages);  
+                // With decimation, the camera streams decimation frames for each one captured; only those beyond that were lost.
+                U32 numImagesNeeded = numImages * decimation;
+                printf (" Clip:    %d frames lost.\n", numImagesStreamed > numImagesNeeded ? numImagesStreamed - numImagesNeeded : 0);
             } else {
                 printf ("Success\n %d images captured.\n",numImages);
             }
 
             //
-            // Step 6
+            // Step 8
             //      convert the clip capture file, into a .avi video file
             strncpy (&aviFile[0],rootName,256);
             strncat (&aviFile[0],".avi",256);
@@ -220,7 +275,8 @@ static U32 CaptureDoneCallback(HANDLE hCamera, U32 numFramesCapture, PXL_RETURN_
 // 
 // Returns the frame rate being used by the camera.  Ideally, this is simply FEAUTURE_ACTUAL_FRAME_RATE, but
 // some older cameras do not support that.  If that is the case, use FEATURE_FRAME_RATE, which is 
-// always supported.
+// always supported.  Which of the two it has is told by a PxLFeatureCache, so that once the camera has
+// been seen, it isn't asked again.
 //
 float effectiveFrameRate (HANDLE hCamera)
 {
@@ -231,28 +287,16 @@ float effectiveFrameRate (HANDLE hCamera)
     // Step 1
     //      Determine if the camera supports FEATURE_ACTUAL_FRAME_RATE
 
-    // How big a buffer will we need to hold the information about the trigger feature?
-    U32 bufferSize = -1;
+    PxLFeatureCache features;
     U32 frameRateFeature = FEATURE_FRAME_RATE;
-    if (API_SUCCESS (PxLGetCameraFeatures(hCamera, FEATURE_ACTUAL_FRAME_RATE, NULL, &bufferSize)))
+    if (API_SUCCESS (features.load(hCamera, pxlDefaultFeatureCacheDir())) && features.supported(FEATURE_ACTUAL_FRAME_RATE))
     {
-	    ASSERT(bufferSize > 0);
-
-	    // Declare a buffer and read the feature information
-	    vector<U8> buffer(bufferSize, 0);  // zero-initialized buffer
-	    CAMERA_FEATURES* pCameraFeatures = (CAMERA_FEATURES*)&buffer[0];
-	    if (API_SUCCESS (PxLGetCameraFeatures(hCamera, FEATURE_ACTUAL_FRAME_RATE, pCameraFeatures, &bufferSize)))
-            {
-                //
-                //  Step 2
-                //      Get the 'best available' frame rate of the camera
-                if (pCameraFeatures[0].pFeatures->uFlags & FEATURE_FLAG_PRESENCE)
-                {
-                    frameRateFeature = FEATURE_ACTUAL_FRAME_RATE;
-                }
-            }
+        frameRateFeature = FEATURE_ACTUAL_FRAME_RATE;
     }
     
+    //
+    //  Step 2
+    //      Get the 'best available' frame rate of the camera
     U32 flags;
     U32 numParams = 1;
     rc = PxLGetFeature (hCamera, frameRateFeature, &flags, &numParams, &frameRate);
@@ -271,7 +315,8 @@ void usage (char* argv[])
         printf(" More specificaly, over the capture period it will create a video clip using every N'th\n");
         printf(" frame from the stream (thus creating the fast motion effect).  Additionaly, it will \n");
         printf(" also capture an image every X seconds over the same period.\n\n");
-        printf("    Usage: %s [-t capture_duration] [-d decimation] [-i image_period] [-f playback_framerate] capture_names \n", argv[0]);
+        printf("    Usage: %s [-t capture_duration] [-d decimation] [-i image_period | -n image_frames | -q cpu_budget]\n", argv[0]);
+        printf("              [-f playback_framerate] capture_names \n");
         printf("       where: \n");
         printf("          -t capture_duration   How much time to spend captureing video (in seconds). \n");
         printf("                                If not specified, %d seconds of video will be captured.\n", DEFAULT_RECORD_DURATION);
@@ -279,7 +324,13 @@ void usage (char* argv[])
         printf("                                stream, in the video.  The larger this number, the faster\n");
         printf("                                the video appears.  Its default value is %d seconds\n", DEFAULT_CLIP_DECIMATION);
         printf("          -i image_period       A still Image will be captured with the specified period\n");
-        printf("                                The default is %d seconds\n", DEFAULT_IMAGE_CAPTURE_PERIOD);
+        printf("                                The default is %d seconds; 0 means no still images\n", DEFAULT_IMAGE_CAPTURE_PERIOD);
+        printf("          -n image_frames       Rather than by time, a still image will be captured from every\n");
+        printf("                                N'th frame of the camera stream\n");
+        printf("          -q cpu_budget         Rather than a video clip, create a time-lapse sequence of images,\n");
+        printf("                                using the best frame of every 'decimation' frames.  Frames are\n");
+        printf("                                scored on sharpness, exposure and motion, using no more than\n");
+        printf("                                cpu_budget microseconds for each one\n");
         printf("          -f playback_framerate Framerate (f/s) that will be used for playback.  This value\n");
         printf("                                determines the duration of the clip. If this value matches the\n");
         printf("                                camera's framerate, then the playback duration will match the\n");
@@ -293,21 +344,24 @@ void usage (char* argv[])
         printf("              create %d still images (one captured every %d seconds)\n", numDefaultImagesIn30Seconds, DEFAULT_IMAGE_CAPTURE_PERIOD);
 }
 
-int getParameters (int argc, char* argv[], U32* recordTime, U32* decimation, U32* imagePeriod, U32* frameRate, char** fileNames)
+int getParameters (int argc, char* argv[], U32* recordTime, U32* decimation, U32* imagePeriod, U32* frameInterval, U32* qualityBudget, U32* frameRate, char** fileNames)
 {
     
     // Default our local copies to the user supplied values
     U32  uRecordTime = DEFAULT_RECORD_DURATION;
     U32  uDecimation = DEFAULT_CLIP_DECIMATION;
     U32  uImagePeriod = DEFAULT_IMAGE_CAPTURE_PERIOD;
+    U32  uFrameInterval = NO_FRAME_INTERVAL;
+    U32  uQualityBudget = NO_QUALITY_BUDGET;
     U32  uFrameRate = DEFAULT_PLAYBACK_FRAME_RATE;
     char*  sFileNames;  
+    int    stillOptions = 0;  // -i, -n and -q are alternatives; only one may be used
    
     // 
     // Step 1
     //      Simple parameter parameter check
     if (argc < 2 ||   // Must have at least the fileNames
-        argc > 10)    // Only 4 options allowed
+        argc > 14)    // Only 6 options allowed
     {
         printf ("\n ERROR -- Incorrect number of parameters\n");
         return GENERAL_ERROR;
@@ -339,6 +393,23 @@ int getParameters (int argc, char* argv[], U32* recordTime, U32* decimation, U32
             if (i+1 >= argc) return GENERAL_ERROR;
             parm = atoi(argv[i+1]);
             uImagePeriod = parm;
+            stillOptions++;
+            i++;
+        } else if (!strcmp(argv[i],"-n") ||
+                   !strcmp(argv[i],"-N")) {
+            if (i+1 >= argc) return GENERAL_ERROR;
+            parm = atoi(argv[i+1]);
+            if (parm < 1) return  GENERAL_ERROR;
+            uFrameInterval = (U32) parm;
+            stillOptions++;
+            i++;
+        } else if (!strcmp(argv[i],"-q") ||
+                   !strcmp(argv[i],"-Q")) {
+            if (i+1 >= argc) return GENERAL_ERROR;
+            parm = atoi(argv[i+1]);
+            if (parm < 1) return  GENERAL_ERROR;
+            uQualityBudget = (U32) parm;
+            stillOptions++;
             i++;
         } else if (!strcmp(argv[i],"-f") ||
                    !strcmp(argv[i],"-F")) {
@@ -360,8 +431,10 @@ int getParameters (int argc, char* argv[], U32* recordTime, U32* decimation, U32
 
     //
     // Step 4.
-    //      Additional sanity checks
-    if (uRecordTime < uImagePeriod) return GENERAL_ERROR;
+    //      Additional sanity checks.  The image period is only used when the stills are taken by time.
+    if (stillOptions > 1) return GENERAL_ERROR;
+    if (NO_FRAME_INTERVAL == uFrameInterval && NO_QUALITY_BUDGET == uQualityBudget &&
+        uRecordTime < uImagePeriod) return GENERAL_ERROR;
 
     //
     // Step 5
@@ -369,6 +442,8 @@ int getParameters (int argc, char* argv[], U32* recordTime, U32* decimation, U32
     *recordTime = uRecordTime;
     *decimation = uDecimation;
     *imagePeriod = uImagePeriod;
+    *frameInterval = uFrameInterval;
+    *qualityBudget = uQualityBudget;
     *frameRate = uFrameRate;
     *fileNames = sFileNames;
 
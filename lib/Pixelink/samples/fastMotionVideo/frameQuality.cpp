@@ -0,0 +1,238 @@
+//
+// frameQuality.cpp
+//
+// Scores frames for a time-lapse, from a sparse grid of samples of the raw frame:
+//    - sharpness: the mean squared gradient (horizontal and vertical).  A frame blurred by motion, or
+//                 taken while the focus was hunting, scores lower than its neighbours.
+//    - exposure:  how far the mean is from mid grey, and what fraction of the samples are clipped.
+//    - motion:    how much the samples changed since the previous frame.  Lots of motion means a
+//                 frame is likely smeared.
+// The gradients are taken between samples 2 pixels apart, so that with bayer formats, they are always
+// between pixels of the same colour.  Only the most significant 8 bits of each pixel are used.  Each
+// sample is at a different spot within its cell of the grid, so that a regular pattern in the scene
+// can't line up with the grid, and hide all of its edges.
+//
+// Each frame must be scored within a CPU budget.  The time taken to score each frame is fed back
+// (frameCost), and the grid is made coarser when over budget, and finer again when well under it.
+// Any other work done on a frame (copying it) costs the same however coarse the grid is, so it's
+// taken off the top of the budget; the scoring gets what is left.
+//
+
+#include <assert.h>
+#include <string.h>
+#include <math.h>
+#include <stdlib.h>
+#include "frameQuality.h"
+
+#define MIN_STEP   4     // Sample no more than every 4th row and column
+#define MAX_STEP   128
+
+#define CLIPPED_LOW   4
+#define CLIPPED_HIGH  251
+
+// How the 8 bit samples are found in a row of pixels
+typedef enum _SAMPLE_LAYOUT
+{
+    SAMPLES_8BIT,
+    SAMPLES_16BIT,             // most significant byte first
+    SAMPLES_12BIT_PACKED,
+    SAMPLES_12BIT_PACKED_MSFIRST,
+    SAMPLES_10BIT_PACKED_MSFIRST,
+    SAMPLES_YUV422,            // U Y V Y
+    SAMPLES_RGB24,
+    SAMPLES_UNSUPPORTED
+} SAMPLE_LAYOUT;
+
+static SAMPLE_LAYOUT sampleLayout (U32 pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case PIXEL_FORMAT_MONO8:
+    case PIXEL_FORMAT_BAYER8_BGGR:
+    case PIXEL_FORMAT_BAYER8_GBRG:
+    case PIXEL_FORMAT_BAYER8_GRBG:
+    case PIXEL_FORMAT_BAYER8_RGGB:
+        return SAMPLES_8BIT;
+
+    case PIXEL_FORMAT_MONO16:
+    case PIXEL_FORMAT_BAYER16_BGGR:
+    case PIXEL_FORMAT_BAYER16_GBRG:
+    case PIXEL_FORMAT_BAYER16_GRBG:
+    case PIXEL_FORMAT_BAYER16_RGGB:
+        return SAMPLES_16BIT;
+
+    case PIXEL_FORMAT_MONO12_PACKED:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+        return SAMPLES_12BIT_PACKED;
+
+    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+        return SAMPLES_12BIT_PACKED_MSFIRST;
+
+    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
+        return SAMPLES_10BIT_PACKED_MSFIRST;
+
+    case PIXEL_FORMAT_YUV422:
+        return SAMPLES_YUV422;
+
+    case PIXEL_FORMAT_RGB24:
+    case PIXEL_FORMAT_RGB24_NON_DIB:
+        return SAMPLES_RGB24;
+
+    default:
+        return SAMPLES_UNSUPPORTED;
+    }
+}
+
+static U32 bytesPerRow (SAMPLE_LAYOUT layout, U32 width)
+{
+    switch (layout)
+    {
+    case SAMPLES_16BIT:
+    case SAMPLES_YUV422:               return width * 2;
+    case SAMPLES_12BIT_PACKED:
+    case SAMPLES_12BIT_PACKED_MSFIRST: return width + width/2;
+    case SAMPLES_10BIT_PACKED_MSFIRST: return width + width/4;
+    case SAMPLES_RGB24:                return width * 3;
+    default:                           return width;
+    }
+}
+
+// The 8 bit sample for pixel p of a row
+static inline U8 sampleAt (SAMPLE_LAYOUT layout, const U8* pRow, U32 p)
+{
+    switch (layout)
+    {
+    case SAMPLES_16BIT:                return pRow[2*p];
+    case SAMPLES_12BIT_PACKED:         return pRow[3*(p/2) + 2*(p&1)];
+    case SAMPLES_12BIT_PACKED_MSFIRST: return pRow[3*(p/2) + (p&1)];
+    case SAMPLES_10BIT_PACKED_MSFIRST: return pRow[5*(p/4) + (p&3)];
+    case SAMPLES_YUV422:               return pRow[2*p + 1];
+    case SAMPLES_RGB24:                return (U8)((pRow[3*p] + 2*pRow[3*p+1] + pRow[3*p+2]) >> 2);
+    default:                           return pRow[p];
+    }
+}
+
+void initQualityScorer (QUALITY_SCORER* pScorer, U32 budgetUs)
+{
+    assert (pScorer);
+
+    pScorer->budgetUs = budgetUs;
+    pScorer->overheadUs = 0;
+    pScorer->step = MIN_STEP * 2;   // A guess; the first few frames will settle it
+    pScorer->previous.clear();
+    pScorer->previousStep = 0;
+    pScorer->framesScored = 0;
+    pScorer->overBudget = 0;
+    pScorer->totalUs = 0.0;
+    pScorer->maxUs = 0;
+}
+
+bool scoreFrame (QUALITY_SCORER* pScorer, const void* pFrame, const FRAME_DESC* pFrameDesc, U32 pixelFormat, FRAME_QUALITY* pQuality)
+{
+    assert (pScorer && pFrame && pFrameDesc && pQuality);
+
+    //
+    // Step 1
+    //      Figure out the frame geometry
+    SAMPLE_LAYOUT layout = sampleLayout (pixelFormat);
+    if (SAMPLES_UNSUPPORTED == layout) return false;
+
+    float paX = pFrameDesc->PixelAddressingValue.fHorizontal;
+    float paY = pFrameDesc->PixelAddressingValue.fVertical;
+    U32 width  = (U32)(pFrameDesc->Roi.fWidth  / (paX >= 1.0f ? paX : 1.0f));
+    U32 height = (U32)(pFrameDesc->Roi.fHeight / (paY >= 1.0f ? paY : 1.0f));
+    U32 step = pScorer->step;
+    if (width < 3 || height < 3) return false;
+
+    const U8* pBase = (const U8*)pFrame;
+    U32 rowBytes = bytesPerRow (layout, width);
+    U32 cols = (width - 2 + step - 1) / step;
+    U32 rows = (height - 2 + step - 1) / step;
+
+    //
+    // Step 2
+    //      One pass over the grid, gathering all of the statistics
+    bool haveMotion = (pScorer->previousStep == step && pScorer->previous.size() == cols * rows);
+    if (!haveMotion) pScorer->previous.resize (cols * rows);
+    U8* pPrevious = &pScorer->previous[0];
+
+    double gradients = 0.0;
+    U32    sum = 0;
+    U32    clipped = 0;
+    U32    differences = 0;
+    for (U32 r = 0; r < rows; r++)
+    {
+        for (U32 c = 0; c < cols; c++)
+        {
+            U32 x = c * step + (r * 5 + c * 3) % step;
+            U32 y = r * step + (r * 3 + c * 5) % step;
+            if (x > width - 3)  x = width - 3;
+            if (y > height - 3) y = height - 3;
+            const U8* pRow = pBase + y * rowBytes;
+            const U8* pBelow = pRow + 2 * rowBytes;
+
+            int s  = sampleAt (layout, pRow, x);
+            int dx = sampleAt (layout, pRow, x + 2) - s;
+            int dy = sampleAt (layout, pBelow, x) - s;
+            gradients += dx*dx + dy*dy;
+            sum += s;
+            if (s <= CLIPPED_LOW || s >= CLIPPED_HIGH) clipped++;
+            if (haveMotion) differences += (U32)abs (s - *pPrevious);
+            *pPrevious++ = (U8)s;
+        }
+    }
+    pScorer->previousStep = step;
+
+    //
+    // Step 3
+    //      Boil it down to the scores
+    U32 samples = cols * rows;
+    float mean = (float)sum / (float)samples;
+    float clippedFraction = (float)clipped / (float)samples;
+
+    pQuality->sharpness = (float)(gradients / (double)samples);
+    pQuality->exposure  = 1.0f - fabsf (mean - 118.0f) / 128.0f - 2.0f * clippedFraction;
+    if (pQuality->exposure < 0.0f) pQuality->exposure = 0.0f;
+    pQuality->motion    = haveMotion ? (float)differences / (float)samples : 0.0f;
+
+    // Sharpness spans orders of magnitude from scene to scene, so it's compared on a log scale; a
+    // poor exposure, or a lot of motion, discounts it.
+    pQuality->score = logf (1.0f + pQuality->sharpness) * pQuality->exposure / (1.0f + pQuality->motion / 16.0f);
+
+    pScorer->framesScored++;
+    return true;
+}
+
+void frameCost (QUALITY_SCORER* pScorer, U32 scoringUs, U32 overheadUs)
+{
+    assert (pScorer);
+
+    U32 elapsedUs = scoringUs + overheadUs;
+    pScorer->totalUs += elapsedUs;
+    if (elapsedUs > pScorer->maxUs) pScorer->maxUs = elapsedUs;
+    if (elapsedUs > pScorer->budgetUs) pScorer->overBudget++;
+
+    // Any frame could be one that needs the overhead, so the scoring has to fit in what's left of the
+    // budget, even on the frames that don't.
+    if (overheadUs) pScorer->overheadUs = overheadUs;
+    U32 scoringBudgetUs = pScorer->budgetUs > pScorer->overheadUs ? pScorer->budgetUs - pScorer->overheadUs : 0;
+
+    // Sampling every step'th row and column, the work goes with the square of the step.
+    if (scoringUs > scoringBudgetUs)
+    {
+        if (pScorer->step < MAX_STEP) pScorer->step *= 2;
+    } else if (scoringUs < scoringBudgetUs / 8 && pScorer->step > MIN_STEP) {
+        pScorer->step /= 2;
+    }
+}
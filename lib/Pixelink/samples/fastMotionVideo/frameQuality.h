@@ -0,0 +1,40 @@
+//
+// frameQuality.h
+//
+// Cheap scoring of frames, so that a time-lapse can use the best frame from each group of
+// frames, rather than simply every N'th one.  See frameQuality.cpp.
+//
+
+#include <vector>
+#include "PixeLINKApi.h"
+
+typedef struct _FRAME_QUALITY
+{
+    float sharpness;  // Mean squared gradient of the samples
+    float exposure;   // 1.0 for a well exposed frame, down to 0.0 for a badly clipped, or very dark/bright one
+    float motion;     // Mean absolute difference from the previous frame's samples (0..255)
+    float score;      // All of the above, combined.  Only meaningful relative to other frames of the same stream.
+} FRAME_QUALITY;
+
+typedef struct _QUALITY_SCORER
+{
+    U32   budgetUs;        // CPU time (in microseconds) we may spend on each frame
+    U32   overheadUs;      // Of that, the part that isn't scoring (copying the frame), as last measured
+    U32   step;            // Sample every step'th row and column; adjusted to stay within the budget
+    std::vector<U8> previous;  // The previous frame's samples, for the motion estimate
+    U32   previousStep;
+
+    // Statistics
+    U32   framesScored;
+    U32   overBudget;      // Frames that took longer than the budget (scoring and overhead together)
+    double totalUs;
+    U32   maxUs;
+} QUALITY_SCORER;
+
+void  initQualityScorer (QUALITY_SCORER* pScorer, U32 budgetUs);
+// Scores a frame.  Returns false if the pixel format is not one we can score.
+bool  scoreFrame (QUALITY_SCORER* pScorer, const void* pFrame, const FRAME_DESC* pFrameDesc, U32 pixelFormat, FRAME_QUALITY* pQuality);
+// Tells the scorer how long (in microseconds) scoring the last frame took, and how long anything else done
+// with it (copying it) took, so that it can adjust the sampling to stay within the budget.  overheadUs is 0
+// for frames that needed nothing else.
+void  frameCost (QUALITY_SCORER* pScorer, U32 scoringUs, U32 overheadUs);
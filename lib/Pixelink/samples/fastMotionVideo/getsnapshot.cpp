@@ -70,6 +70,40 @@ int getSnapshot(HANDLE hCamera, U32 imageFormat, const char* pFilename)
 	return retVal;
 }
 
+//
+// The size of buffer needed to hold one (raw) image from the camera, with its
+// current ROI, pixel addressing, and pixel format.
+//
+// Returns 0 on failure
+//
+U32 getRawImageSize(HANDLE hCamera)
+{
+	return determineRawImageSize(hCamera);
+}
+
+//
+// Encode a raw image, one that has already been captured, and save it to a file.
+//
+int saveRawImage(const char* pRawImage, const FRAME_DESC* pFrameDesc, U32 imageFormat, const char* pFilename)
+{
+	U32   encodedImageSize;
+	char* pEncodedImage;
+	int   retVal = FAILURE;
+
+	assert(NULL != pRawImage);
+	assert(NULL != pFrameDesc);
+	assert(pFilename);
+
+	if (encodeRawImage(pRawImage, pFrameDesc, imageFormat, &pEncodedImage, &encodedImageSize) == SUCCESS) {
+		if (saveImageToFile(pFilename, pEncodedImage, encodedImageSize) == SUCCESS) {
+			retVal = SUCCESS;
+		}
+		free(pEncodedImage);
+	}
+
+	return retVal;
+}
+
 //
 // Capture an image from the camera.
 // 
@@ -137,7 +171,7 @@ determineRawImageSize(HANDLE hCamera)
     if (!API_SUCCESS(retValue)) return 0;
 	
     paX = (U32)parms[2];
-    paY = (U32)parms[2];
+    paY = (U32)parms[3];
 
     // Pixel Format
     numParams = 1;
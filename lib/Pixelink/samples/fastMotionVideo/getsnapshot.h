@@ -1,2 +1,4 @@
 
 int getSnapshot(HANDLE hCamera, U32 imageFormat, const char* pFilename);
+U32 getRawImageSize(HANDLE hCamera);
+int saveRawImage(const char* pRawImage, const FRAME_DESC* pFrameDesc, U32 imageFormat, const char* pFilename);
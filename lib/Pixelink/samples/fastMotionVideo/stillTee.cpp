@@ -0,0 +1,379 @@
+//
+// stillTee.cpp
+//
+// A 'tee' on the camera's stream, that takes still images from the very same frames
+// that are feeding a clip capture (PxLGetEncodedClip).
+//
+// Grabbing stills with PxLGetNextFrame while a clip is being captured has the stills and
+// the clip competing for the frames, and the still is simply whatever frame happens to
+// arrive next.  Instead, a CALLBACK_FRAME callback sees every frame of the stream, picks
+// out the exact frames wanted (every N'th frame, or the one nearest to every N'th second),
+// and copies them into one of a small pool of preallocated buffers.  A separate thread
+// then encodes and saves them, so the callback (and therefore the clip) is never held up
+// by the encoding or the disk.  If the encoder falls behind, stills are dropped (and
+// counted) -- never frames of the clip.
+//
+// There are no stream state changes at all; the tee is set up before the stream starts.
+//
+// With STILLS_BEST_OF_WINDOW, it's a time-lapse builder:  rather than every N'th frame, it
+// scores every frame (frameQuality.cpp), and keeps the best one of each run of N frames.
+// The best frame so far is held in a pool buffer, and replaced whenever a better one comes
+// along; once the run is over, that buffer is queued for the encoder.
+//
+
+#include <assert.h>
+#include <stdio.h>
+#include <string.h>
+#include <pthread.h>
+#include <time.h>
+#include <vector>
+#include <string>
+#include "PixeLINKApi.h"
+#include "getsnapshot.h"
+#include "frameQuality.h"
+#include "stillTee.h"
+
+using namespace std;
+
+#define STILL_POOL_SIZE  8    // Stills that can be waiting to be encoded
+#define NO_BUFFER        ((U32)-1)
+
+#define A_OK            0  // non-zero error codes
+#define GENERAL_ERROR   1
+
+typedef struct _STILL_BUFFER
+{
+    vector<char> image;
+    FRAME_DESC   frameDesc;
+    U32          stillNum;
+} STILL_BUFFER;
+
+// State shared between the frame callback, the encoder thread, and the main line.
+static pthread_mutex_t s_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  s_cond  = PTHREAD_COND_INITIALIZER;
+static vector<STILL_BUFFER> s_pool;
+static vector<U32>     s_free;        // Buffers available to the callback
+static vector<U32>     s_queued;      // Buffers waiting for the encoder, oldest first
+static bool            s_stopping = false;
+static pthread_t       s_encoder;
+
+static string          s_rootName;
+static U32             s_imageSize = 0;
+static STILL_SELECTION s_selection = STILLS_PERIODIC;
+static U32             s_interval = 0;
+static STILL_TEE_STATS s_stats;
+
+// Selection state, owned by the callback
+static bool  s_firstFrame = true;
+static U32   s_lastFrameNumber = 0;
+static float s_lastFrameTime = 0.0f;
+static float s_framePeriod = 0.0f;    // Estimated from the camera's time stamps
+static U32   s_nextFrameNumber = 0;   // STILLS_EVERY_NTH_FRAME
+static float s_nextFrameTime = 0.0f;  // STILLS_PERIODIC
+static U32   s_nextStillNum = 0;
+static U32   s_firstFrameNumber = 0;
+
+// STILLS_BEST_OF_WINDOW state, owned by the callback
+static QUALITY_SCORER s_scorer;
+static U32   s_candidate = NO_BUFFER;   // Holds the best frame of the current window
+static U32   s_candidateWindow = 0;
+static float s_candidateScore = 0.0f;
+static U32   s_droppedWindow = NO_BUFFER;
+
+static U32 PXL_APICALL StillTeeCallback(HANDLE hCamera, LPVOID pFrameData, U32 dataFormat, FRAME_DESC const * pFrameDesc, LPVOID pContext);
+static void* StillEncoderThread(void* pContext);
+static void  bestOfWindow(LPVOID pFrameData, U32 dataFormat, FRAME_DESC const * pFrameDesc);
+
+int startStillTee (HANDLE hCamera, const char* rootName, STILL_SELECTION selection, U32 interval, U32 budgetUs)
+{
+    assert (interval > 0);
+
+    //
+    // Step 1
+    //      Size, and allocate, the buffers up front; the callback must never allocate
+    s_imageSize = getRawImageSize (hCamera);
+    if (0 == s_imageSize) return GENERAL_ERROR;
+
+    s_pool.resize (STILL_POOL_SIZE);
+    s_free.clear();
+    s_queued.clear();
+    for (U32 i = 0; i < STILL_POOL_SIZE; i++)
+    {
+        s_pool[i].image.resize (s_imageSize);
+        s_free.push_back (i);
+    }
+    s_queued.reserve (STILL_POOL_SIZE);
+
+    s_rootName = rootName;
+    s_selection = selection;
+    s_interval = interval;
+    memset (&s_stats, 0, sizeof(s_stats));
+    s_firstFrame = true;
+    s_framePeriod = 0.0f;
+    s_nextStillNum = 0;
+    s_stopping = false;
+    initQualityScorer (&s_scorer, budgetUs);
+    s_candidate = NO_BUFFER;
+    s_droppedWindow = NO_BUFFER;
+
+    //
+    // Step 2
+    //      Start the encoder, and then hook into the stream
+    if (0 != pthread_create (&s_encoder, NULL, StillEncoderThread, NULL)) return GENERAL_ERROR;
+
+    if (!API_SUCCESS (PxLSetCallback (hCamera, CALLBACK_FRAME, NULL, StillTeeCallback)))
+    {
+        pthread_mutex_lock (&s_mutex);
+        s_stopping = true;
+        pthread_cond_signal (&s_cond);
+        pthread_mutex_unlock (&s_mutex);
+        pthread_join (s_encoder, NULL);
+        return GENERAL_ERROR;
+    }
+
+    return A_OK;
+}
+
+//
+// Takes a buffer from the pool, or returns NO_BUFFER if they are all in use.
+//
+static U32 takeBuffer ()
+{
+    U32 buffer = NO_BUFFER;
+
+    pthread_mutex_lock (&s_mutex);
+    if (!s_free.empty())
+    {
+        buffer = s_free.back();
+        s_free.pop_back();
+    }
+    pthread_mutex_unlock (&s_mutex);
+
+    return buffer;
+}
+
+static void queueBuffer (U32 buffer)
+{
+    pthread_mutex_lock (&s_mutex);
+    s_queued.push_back (buffer);
+    pthread_cond_signal (&s_cond);
+    pthread_mutex_unlock (&s_mutex);
+}
+
+// Microseconds since start
+static U32 elapsedUs (const struct timespec& start)
+{
+    struct timespec now;
+    clock_gettime (CLOCK_MONOTONIC, &now);
+    return (U32)((now.tv_sec - start.tv_sec) * 1000000 + (now.tv_nsec - start.tv_nsec) / 1000);
+}
+
+static void copyFrame (U32 buffer, LPVOID pFrameData, FRAME_DESC const * pFrameDesc, U32 stillNum)
+{
+    STILL_BUFFER& still = s_pool[buffer];
+    memcpy (&still.image[0], pFrameData, s_imageSize);
+    still.frameDesc = *pFrameDesc;
+    still.stillNum = stillNum;
+}
+
+void stopStillTee (HANDLE hCamera, STILL_TEE_STATS* pStats)
+{
+    PxLSetCallback (hCamera, CALLBACK_FRAME, NULL, NULL);
+
+    // The last (partial) window of a time-lapse still gets its frame
+    if (NO_BUFFER != s_candidate)
+    {
+        queueBuffer (s_candidate);
+        s_candidate = NO_BUFFER;
+    }
+
+    s_stats.framesScored = s_scorer.framesScored;
+    s_stats.overBudget = s_scorer.overBudget;
+    s_stats.averageUs = s_stats.framesSeen ? (U32)(s_scorer.totalUs / s_stats.framesSeen) : 0;
+    s_stats.maxUs = s_scorer.maxUs;
+    s_stats.copyUs = s_scorer.overheadUs;
+
+    // Let the encoder finish what is queued
+    pthread_mutex_lock (&s_mutex);
+    s_stopping = true;
+    pthread_cond_signal (&s_cond);
+    pthread_mutex_unlock (&s_mutex);
+    pthread_join (s_encoder, NULL);
+
+    if (pStats) *pStats = s_stats;
+}
+
+//
+// Called by the API for every frame of the stream -- including the ones going into the clip.  It
+// must return quickly, and it must not change the frame.
+//
+static U32 PXL_APICALL StillTeeCallback(HANDLE hCamera, LPVOID pFrameData, U32 dataFormat, FRAME_DESC const * pFrameDesc, LPVOID pContext)
+{
+    U32   frameNumber = pFrameDesc->uFrameNumber;
+    float frameTime = pFrameDesc->fFrameTime;
+    bool  selected = false;
+    bool  late = false;
+
+    s_stats.framesSeen++;
+
+    //
+    // Step 1
+    //      Keep track of the frames the camera sent, but we never got.
+    if (s_firstFrame)
+    {
+        s_firstFrame = false;
+        s_firstFrameNumber = frameNumber;
+        s_nextFrameNumber = frameNumber;
+        s_nextFrameTime = frameTime;
+    } else if (frameNumber > s_lastFrameNumber) {
+        U32 missed = frameNumber - s_lastFrameNumber - 1;
+        s_stats.streamGaps += missed;
+        if (frameTime > s_lastFrameTime)
+        {
+            s_framePeriod = (frameTime - s_lastFrameTime) / (float)(missed + 1);
+        }
+    }
+    s_lastFrameNumber = frameNumber;
+    s_lastFrameTime = frameTime;
+
+    //
+    // Step 2
+    //      Is this a frame we want?
+    if (STILLS_BEST_OF_WINDOW == s_selection)
+    {
+        bestOfWindow (pFrameData, dataFormat, pFrameDesc);
+        return ApiSuccess;
+    } else if (STILLS_EVERY_NTH_FRAME == s_selection)
+    {
+        if (frameNumber >= s_nextFrameNumber)
+        {
+            selected = true;
+            late = frameNumber > s_nextFrameNumber;
+            while (s_nextFrameNumber <= frameNumber) s_nextFrameNumber += s_interval;
+        }
+    } else {
+        // This frame is the nearest one to the deadline, if the next one will be further past it, than
+        // this one is short of it.
+        if (frameTime + s_framePeriod / 2.0f >= s_nextFrameTime)
+        {
+            selected = true;
+            late = frameTime - s_framePeriod / 2.0f > s_nextFrameTime;
+            while (s_nextFrameTime <= frameTime + s_framePeriod / 2.0f) s_nextFrameTime += (float)s_interval;
+        }
+    }
+    if (!selected) return ApiSuccess;
+
+    //
+    // Step 3
+    //      Copy it into a free buffer, and queue it for the encoder.  No buffer means the encoder
+    //      is behind; the still is dropped, the stream is not held up.
+    U32 stillNum = s_nextStillNum++;
+    s_stats.stillsSelected++;
+    if (late) s_stats.stillsLate++;
+
+    U32 buffer = takeBuffer();
+    if (NO_BUFFER == buffer)
+    {
+        s_stats.stillsDropped++;
+        return ApiSuccess;
+    }
+    copyFrame (buffer, pFrameData, pFrameDesc, stillNum);
+    queueBuffer (buffer);
+
+    return ApiSuccess;
+}
+
+//
+// STILLS_BEST_OF_WINDOW:  keep the best frame of each window of s_interval frames (as numbered by the camera).
+//
+static void bestOfWindow(LPVOID pFrameData, U32 dataFormat, FRAME_DESC const * pFrameDesc)
+{
+    //
+    // Step 1
+    //      A frame from a new window means the previous window is done; its best frame goes to the encoder
+    U32 window = (pFrameDesc->uFrameNumber - s_firstFrameNumber) / s_interval;
+    if (NO_BUFFER != s_candidate && window != s_candidateWindow)
+    {
+        queueBuffer (s_candidate);
+        s_candidate = NO_BUFFER;
+    }
+
+    //
+    // Step 2
+    //      Score it.  If we can't, the frame is taken as is -- the first of each window, just like decimation.
+    struct timespec start;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    FRAME_QUALITY quality;
+    if (!scoreFrame (&s_scorer, pFrameData, pFrameDesc, dataFormat, &quality)) quality.score = 0.0f;
+    U32 scoringUs = elapsedUs (start);
+
+    //
+    // Step 3
+    //      Keep it, if it's the first of its window, or better than the best so far
+    bool copied = false;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    if (NO_BUFFER == s_candidate)
+    {
+        if (window != s_droppedWindow)
+        {
+            s_candidate = takeBuffer();
+            if (NO_BUFFER == s_candidate)
+            {
+                // The encoder is behind; this window will have no frame
+                s_stats.stillsDropped++;
+                s_droppedWindow = window;
+            } else {
+                s_stats.stillsSelected++;
+                copyFrame (s_candidate, pFrameData, pFrameDesc, s_nextStillNum++);
+                copied = true;
+                s_candidateWindow = window;
+                s_candidateScore = quality.score;
+            }
+        }
+    } else if (quality.score > s_candidateScore) {
+        copyFrame (s_candidate, pFrameData, pFrameDesc, s_pool[s_candidate].stillNum);
+        copied = true;
+        s_candidateScore = quality.score;
+    }
+
+    //
+    // Step 4
+    //      Both the scoring and the copy count against the budget.  The copy costs the same however coarsely
+    //      we sample, so the scorer takes it off the top of the budget, and samples within what is left.
+    frameCost (&s_scorer, scoringUs, copied ? elapsedUs (start) : 0);
+}
+
+//
+// Encodes, and saves, the stills the callback has queued.
+//
+static void* StillEncoderThread(void* pContext)
+{
+    vector<char> fileName(s_rootName.length() + 16, 0);
+
+    pthread_mutex_lock (&s_mutex);
+    for (;;)
+    {
+        while (s_queued.empty() && !s_stopping) pthread_cond_wait (&s_cond, &s_mutex);
+        if (s_queued.empty()) break;  // Stopping, and nothing left to do
+
+        U32 buffer = s_queued.front();
+        s_queued.erase (s_queued.begin());
+        pthread_mutex_unlock (&s_mutex);
+
+        STILL_BUFFER& still = s_pool[buffer];
+        sprintf (&fileName[0], "%s%d.bmp", s_rootName.c_str(), still.stillNum);
+        bool saved = (0 == saveRawImage (&still.image[0], &still.frameDesc, IMAGE_FORMAT_BMP, &fileName[0]));
+
+        pthread_mutex_lock (&s_mutex);
+        if (saved)
+        {
+            s_stats.stillsSaved++;
+        } else {
+            s_stats.stillsFailed++;
+        }
+        s_free.push_back (buffer);
+    }
+    pthread_mutex_unlock (&s_mutex);
+
+    return NULL;
+}
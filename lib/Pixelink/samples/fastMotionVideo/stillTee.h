@@ -0,0 +1,43 @@
+//
+// stillTee.h
+//
+// Takes still images from the same stream of frames that is feeding a clip capture,
+// without touching the stream state.  See stillTee.cpp.
+//
+// It can also build a time-lapse (as a sequence of stills) on its own, using the best
+// frame from each group of frames.
+//
+
+#include "PixeLINKApi.h"
+
+// How the frames to be saved as stills are chosen
+typedef enum _STILL_SELECTION
+{
+    STILLS_EVERY_NTH_FRAME,  // Every N'th frame, as numbered by the camera
+    STILLS_PERIODIC,         // The frame nearest to every N'th second (as timed by the camera)
+    STILLS_BEST_OF_WINDOW    // The best frame (see frameQuality.cpp) from each run of N frames
+} STILL_SELECTION;
+
+typedef struct _STILL_TEE_STATS
+{
+    U32 framesSeen;     // Frames the camera sent us while the tee was active
+    U32 streamGaps;     // Frames the camera numbered, but we never got.  These are missing from the clip too.
+    U32 stillsSelected; // Frames chosen to be stills
+    U32 stillsLate;     // Of those, ones where the exact frame was lost, so the next one was used instead
+    U32 stillsDropped;  // Chosen, but not saved, because the encoder was still busy with earlier stills
+    U32 stillsSaved;
+    U32 stillsFailed;   // Could not be encoded, or written
+
+    // STILLS_BEST_OF_WINDOW only
+    U32 framesScored;   // Frames that could not be scored (unsupported pixel format) are taken as is
+    U32 overBudget;     // Frames where the scoring (and copying) took longer than the budget
+    U32 averageUs;      // CPU time spent scoring (and copying) each frame
+    U32 maxUs;
+    U32 copyUs;         // Of that, the time to copy a frame into the pool (as last measured)
+} STILL_TEE_STATS;
+
+// Start the tee; call this before starting the stream.  Stills are named rootName<n>.bmp.  budgetUs is the
+// CPU time (in microseconds) that STILLS_BEST_OF_WINDOW may spend on each frame.
+int  startStillTee (HANDLE hCamera, const char* rootName, STILL_SELECTION selection, U32 interval, U32 budgetUs);
+// Stop the tee (after the stream has stopped), waiting for the queued stills to be saved.
+void stopStillTee (HANDLE hCamera, STILL_TEE_STATS* pStats);
@@ -24,14 +24,14 @@ DoesCameraSupportHdr(HANDLE hCamera) {
     assert(0 != hCamera);
 
     // Figure out how much memory we have to allocate for feature gain HDR
-    rc = PxLGetCameraFeatures(hCamera, FEATURE_GAIN_HDR, NULL, &pBufferSize);
+    rc = pxlGetCameraFeatures(hCamera, NULL, FEATURE_GAIN_HDR, NULL, &pBufferSize);
     if (API_SUCCESS(rc)) 
     {
         CAMERA_FEATURES* pFeatureInfo = (CAMERA_FEATURES*)malloc(pBufferSize);
         if(NULL != pFeatureInfo)
         {
             // Now read the information into the buffer
-            rc = PxLGetCameraFeatures(hCamera, FEATURE_GAIN_HDR, pFeatureInfo, &pBufferSize);
+            rc = pxlGetCameraFeatures(hCamera, NULL, FEATURE_GAIN_HDR, pFeatureInfo, &pBufferSize);
             if (API_SUCCESS(rc)) 
             {
                 // Do a few sanity checks
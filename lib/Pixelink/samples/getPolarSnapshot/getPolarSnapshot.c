@@ -25,14 +25,14 @@ IsPolarCamera(HANDLE hCamera)
     assert(0 != hCamera);
 
     // Figure out how much memory we have to allocate for feature polar weightings
-    rc = PxLGetCameraFeatures(hCamera, FEATURE_POLAR_WEIGHTINGS, NULL, &pBufferSize);
+    rc = pxlGetCameraFeatures(hCamera, NULL, FEATURE_POLAR_WEIGHTINGS, NULL, &pBufferSize);
     if (API_SUCCESS(rc))
     {
         CAMERA_FEATURES* pFeatureInfo = (CAMERA_FEATURES*)malloc(pBufferSize);
         if (NULL != pFeatureInfo) 
         {
             // Now read the information into the buffer
-            rc = PxLGetCameraFeatures(hCamera, FEATURE_POLAR_WEIGHTINGS, pFeatureInfo, &pBufferSize);
+            rc = pxlGetCameraFeatures(hCamera, NULL, FEATURE_POLAR_WEIGHTINGS, pFeatureInfo, &pBufferSize);
             if (API_SUCCESS(rc))
             {
                 // Do a few sanity checks
@@ -5,6 +5,7 @@
 #define getPolarSnapshot_H
 
 #include <PixeLINKApi.h>
+#include "PxLProfile.h"
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -38,7 +38,34 @@
 //  4. Use Pixel Addressing to reduce image size.
 //  5. Reduce the frame rate.
 //
-// This sample, uses strategy #5 from above.
+// This sample uses strategies #2 through #5 together, with a 'governor'.  Each
+// of them trades something away, and which trade is best depends on the
+// application, so the governor is given a policy:
+//    fps         Keep the frame rate as high as possible.  Give up bit depth,
+//                then resolution.
+//    resolution  Keep as many pixels (and as much of the field of view) as
+//                possible.  Give up bit depth, then frame rate (down to the
+//                minimum).
+//    depth       Never give up bit depth.  Give up frame rate (down to the
+//                minimum), then resolution.
+// It models the cost, in bytes/second, of every mix of pixel format (including
+// the packed 10 and 12 bit ones), pixel addressing, ROI, and frame rate, and
+// picks the best mix, for the policy, that fits the USB memory.  Keeping
+// something means keeping what the camera started with; no mix has more bit
+// depth, frame rate, ROI or pixels than that.
+//
+// How many bytes/second fit is not something the API tells us, so the
+// governor finds out.  Each START_STREAM that returns ApiSuccessLowMemory
+// tells it that it asked for too much; each one that doesn't, that it asked
+// for few enough.  It bisects between the two.  Then, while streaming, it
+// watches the frame numbers; losing LOSS_LIMIT of the last LOSS_WINDOW frames
+// means it is still asking for too much, and it re-tunes, there and then.
+// Frames can also be lost to a passing load on the bus, so what it has learnt
+// doesn't fit from lost frames (but not from ApiSuccessLowMemory) is raised
+// again after CEILING_EXPIRY windows without loss.
+//
+// NOTE: This application assumes there is at most, one PixeLINK camera connected to the system
+//
 
 //
 //
@@ -46,94 +73,736 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include <time.h>
 #include <PixeLINKApi.h>
 
-ULONG
-getMinFrameRate (HANDLE hCamera, float *minValue)
+//
+// A few useful defines and enums.
+//
+#define A_OK            0  // non-zero error codes
+#define GENERAL_ERROR   1
+
+#define DEFAULT_RUN_DURATION  10       // in seconds, of streaming, once tuned
+#define MAX_TUNE_ATTEMPTS     10       // Stream starts, to find a mix that fits
+#define BACKOFF               0.7      // With no mix known to fit, try this fraction of the least known not to
+#define CONVERGED             0.9      // Stop tuning once what fits is within this fraction of what doesn't
+#define LOSS_WINDOW           16       // in frames
+#define LOSS_LIMIT            2        // Frames lost, in LOSS_WINDOW, that mean we're asking for too much
+#define CEILING_EXPIRY        8        // LOSS_WINDOWs without loss, before the least known not to fit is raised
+#define MAX_FAILED_GRABS      3        // PxLGetNextFrame failures in a row, before we give up
+#define NUM_ROI_SCALES        7
+#define MAX_PIXEL_FORMATS     4
+#define MAX_PIXEL_ADDRESSING  8
+
+typedef enum _POLICY
+{
+    POLICY_FPS,
+    POLICY_RESOLUTION,
+    POLICY_DEPTH
+} POLICY;
+
+static const char* const s_policyNames[] = {"fps", "resolution", "depth"};
+
+//
+// What a pixel format costs, and what it keeps.  Formats of the same family can stand in for one another;
+// they differ only in bit depth.
+//
+typedef struct _PIXEL_FORMAT_INFO
+{
+    U32         pixelFormat;
+    U32         family;
+    U32         bitDepth;        // Significant bits.  The 16 bit formats carry (at most) the sensor's 12.
+    float       bytesPerPixel;
+    const char* name;
+} PIXEL_FORMAT_INFO;
+
+enum {MONO, BAYER_GRBG, BAYER_RGGB, BAYER_GBRG, BAYER_BGGR, YUV, RGB24, RGB48};
+
+static const PIXEL_FORMAT_INFO s_pixelFormats[] = {
+    {PIXEL_FORMAT_MONO8,                      MONO,       8,  1.0f,  "MONO8"},
+    {PIXEL_FORMAT_MONO10_PACKED_MSFIRST,      MONO,       10, 1.25f, "MONO10_PACKED"},
+    {PIXEL_FORMAT_MONO12_PACKED,              MONO,       12, 1.5f,  "MONO12_PACKED"},
+    {PIXEL_FORMAT_MONO16,                     MONO,       12, 2.0f,  "MONO16"},
+    {PIXEL_FORMAT_BAYER8_GRBG,                BAYER_GRBG, 8,  1.0f,  "BAYER8_GRBG"},
+    {PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST,BAYER_GRBG, 10, 1.25f, "BAYER10_GRBG_PACKED"},
+    {PIXEL_FORMAT_BAYER12_GRBG_PACKED,        BAYER_GRBG, 12, 1.5f,  "BAYER12_GRBG_PACKED"},
+    {PIXEL_FORMAT_BAYER16_GRBG,               BAYER_GRBG, 12, 2.0f,  "BAYER16_GRBG"},
+    {PIXEL_FORMAT_BAYER8_RGGB,                BAYER_RGGB, 8,  1.0f,  "BAYER8_RGGB"},
+    {PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST,BAYER_RGGB, 10, 1.25f, "BAYER10_RGGB_PACKED"},
+    {PIXEL_FORMAT_BAYER12_RGGB_PACKED,        BAYER_RGGB, 12, 1.5f,  "BAYER12_RGGB_PACKED"},
+    {PIXEL_FORMAT_BAYER16_RGGB,               BAYER_RGGB, 12, 2.0f,  "BAYER16_RGGB"},
+    {PIXEL_FORMAT_BAYER8_GBRG,                BAYER_GBRG, 8,  1.0f,  "BAYER8_GBRG"},
+    {PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST,BAYER_GBRG, 10, 1.25f, "BAYER10_GBRG_PACKED"},
+    {PIXEL_FORMAT_BAYER12_GBRG_PACKED,        BAYER_GBRG, 12, 1.5f,  "BAYER12_GBRG_PACKED"},
+    {PIXEL_FORMAT_BAYER16_GBRG,               BAYER_GBRG, 12, 2.0f,  "BAYER16_GBRG"},
+    {PIXEL_FORMAT_BAYER8_BGGR,                BAYER_BGGR, 8,  1.0f,  "BAYER8_BGGR"},
+    {PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST,BAYER_BGGR, 10, 1.25f, "BAYER10_BGGR_PACKED"},
+    {PIXEL_FORMAT_BAYER12_BGGR_PACKED,        BAYER_BGGR, 12, 1.5f,  "BAYER12_BGGR_PACKED"},
+    {PIXEL_FORMAT_BAYER16_BGGR,               BAYER_BGGR, 12, 2.0f,  "BAYER16_BGGR"},
+    {PIXEL_FORMAT_YUV422,                     YUV,        8,  2.0f,  "YUV422"},
+    {PIXEL_FORMAT_RGB24,                      RGB24,      8,  3.0f,  "RGB24"},
+    {PIXEL_FORMAT_RGB48,                      RGB48,      12, 6.0f,  "RGB48"}
+};
+#define NUM_PIXEL_FORMATS (sizeof(s_pixelFormats) / sizeof(s_pixelFormats[0]))
+
+// The ROIs tried, as a fraction of the sensor's width and height.  They are centered.
+static const float s_roiScales[NUM_ROI_SCALES] = {1.0f, 0.875f, 0.75f, 0.625f, 0.5f, 0.375f, 0.25f};
+
+//
+// One mix of the settings that decide how many bytes/second the camera sends.
+//
+typedef struct _STREAM_CONFIG
+{
+    const PIXEL_FORMAT_INFO* pFormat;
+    U32   pixelAddressing;       // The same, horizontally and vertically
+    U32   roiWidth;              // In sensor pixels
+    U32   roiHeight;
+    float frameRate;
+} STREAM_CONFIG;
+
+//
+// What the camera can do, learned once, up front.
+//
+typedef struct _CAMERA_LIMITS
+{
+    U32   sensorWidth;
+    U32   sensorHeight;
+    U32   minRoiWidth;
+    U32   minRoiHeight;
+    float minFrameRate;
+    float maxFrameRate;
+    U32   pixelAddressingMode;   // Decimate, bin, ..., as the camera had it
+    U32   pixelAddressingParams; // 2 (value, mode) for older cameras, 4 (value, mode, x, y) for newer
+    U32   numPixelAddressing;
+    U32   pixelAddressing[MAX_PIXEL_ADDRESSING];   // Those the camera accepts
+    U32   numPixelFormats;
+    const PIXEL_FORMAT_INFO* pPixelFormats[MAX_PIXEL_FORMATS];   // Those of the camera's family it accepts
+} CAMERA_LIMITS;
+
+//
+// The governor's state:  what it has learned about the USB memory, and what it is streaming with.
+//
+typedef struct _GOVERNOR
+{
+    HANDLE        hCamera;
+    POLICY        policy;
+    float         minFrameRate;  // The least the application will accept
+    STREAM_CONFIG start;         // The mix the camera started with; the most of anything we'll ask for
+    CAMERA_LIMITS limits;
+    double        fits;          // Most bytes/second known to fit; 0 if none known yet
+    double        tooMuch;       // Least bytes/second known not to fit; 0 if none known yet
+    double        noRoom;        // Least bytes/second START_STREAM said doesn't fit; 0 if none.  Frame loss can pass; this doesn't.
+    STREAM_CONFIG current;
+    bool          streaming;
+} GOVERNOR;
+
+typedef struct _USER_PARAMETERS
+{
+    POLICY policy;
+    float  minFrameRate;         // 0 for the camera's minimum
+    U32    duration;
+} USER_PARAMETERS;
+
+static void   usage (char** argv);
+static int    getParameters (int argc, char* argv[], USER_PARAMETERS* pParms);
+static ULONG  getCameraLimits (GOVERNOR* pGovernor, STREAM_CONFIG* pStartConfig);
+static double bytesPerSecond (const STREAM_CONFIG* pConfig);
+static bool   pickConfig (const GOVERNOR* pGovernor, double budget, STREAM_CONFIG* pConfig);
+static ULONG  startStream (GOVERNOR* pGovernor, const STREAM_CONFIG* pConfig);
+static ULONG  tune (GOVERNOR* pGovernor, bool probe);
+static ULONG  stream (GOVERNOR* pGovernor, U32 duration);
+static void   printConfig (const char* pPrefix, const STREAM_CONFIG* pConfig);
+
+int
+main(int argc, char* argv[])
+{
+    USER_PARAMETERS parms;
+    GOVERNOR governor;
+    STREAM_CONFIG startConfig;
+    ULONG  rc;
+
+    //
+    // Step 1
+    //      Validate the user parameters
+    if (A_OK != getParameters (argc, argv, &parms)) {
+        usage (argv);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 2
+    //      Find the camera, and learn what it can do
+    memset (&governor, 0, sizeof(governor));
+    governor.policy = parms.policy;
+
+    // We assume there's only one camera connected;
+    rc = PxLInitialize(0, &governor.hCamera);
+    if (!API_SUCCESS(rc)) {
+        printf ("Could not find a camera, rc=0x%x\n", rc);
+        return GENERAL_ERROR;
+    }
+
+    rc = getCameraLimits (&governor, &startConfig);
+    if (!API_SUCCESS(rc)) {
+        printf ("Difficuty reading the camera's ROI, pixel addressing, pixel format, or frame rate, rc=0x%x\n", rc);
+        PxLUninitialize(governor.hCamera);
+        return GENERAL_ERROR;
+    }
+    governor.minFrameRate = parms.minFrameRate > governor.limits.minFrameRate ? parms.minFrameRate : governor.limits.minFrameRate;
+    governor.start = startConfig;
+    printf ("Policy: %s, at no less than %5.2f fps\n", s_policyNames[governor.policy], governor.minFrameRate);
+
+    //
+    // Step 3
+    //      Try the camera as it is.  If the USB memory copes with that, there's nothing to govern.
+    printConfig ("Starting with", &startConfig);
+    rc = startStream (&governor, &startConfig);
+    if (!API_SUCCESS(rc)) {
+        printf ("Difficuty starting the stream, rc=0x%x\n", rc);
+        PxLUninitialize(governor.hCamera);
+        return GENERAL_ERROR;
+    }
+    if (ApiSuccessLowMemory == rc) {
+        printf ("Sub-optimal USB memory allocation detected at %.1f MB/s\n", bytesPerSecond (&startConfig) / 1.0e6);
+        governor.tooMuch = governor.noRoom = bytesPerSecond (&startConfig);
+        rc = tune (&governor, false);
+    } else {
+        printf ("Camera can stream fine as it is\n");
+    }
+
+    //
+    // Step 4
+    //      Stream, re-tuning if frames are lost
+    if (API_SUCCESS(rc)) rc = stream (&governor, parms.duration);
+
+    if (API_SUCCESS(rc)) {
+        printConfig ("Settled on", &governor.current);
+    } else {
+        printf ("Difficuty governing the stream, rc=0x%x\n", rc);
+    }
+
+    PxLSetStreamState (governor.hCamera, STOP_STREAM);
+    PxLUninitialize(governor.hCamera);
+    return API_SUCCESS(rc) ? A_OK : GENERAL_ERROR;
+}
+
+static void usage (char** argv)
+{
+    printf ("\n Streams within the USB memory available, trading away frame rate, resolution, or bit\n");
+    printf (" depth, according to a policy\n\n");
+    printf ("    Usage: %s [-p policy] [-m min_frame_rate] [-t duration]\n", argv[0]);
+    printf ("       where: \n");
+    printf ("          -p policy          One of 'fps', 'resolution' or 'depth'.  The default is fps\n");
+    printf ("          -m min_frame_rate  The least frame rate (frames/second) to accept.  The default\n");
+    printf ("                             is the camera's minimum\n");
+    printf ("          -t duration        How long to stream for, once tuned (in seconds).  The default\n");
+    printf ("                             is %d seconds\n", DEFAULT_RUN_DURATION);
+    printf ("    Example: \n");
+    printf ("        %s -p resolution -m 15 \n", argv[0]);
+}
+
+static int getParameters (int argc, char* argv[], USER_PARAMETERS* pParms)
+{
+    //
+    // Step 1
+    //      Set our defaults
+    pParms->policy = POLICY_FPS;
+    pParms->minFrameRate = 0.0f;
+    pParms->duration = DEFAULT_RUN_DURATION;
+
+    //
+    // Step 2
+    //      Parse the command line
+    for (int i = 1; i < argc; i++) {
+        if (i + 1 >= argc) return GENERAL_ERROR;
+        if (!strcmp (argv[i], "-p") || !strcmp (argv[i], "-P")) {
+            i++;
+            if      (!strcmp (argv[i], "fps"))        pParms->policy = POLICY_FPS;
+            else if (!strcmp (argv[i], "resolution")) pParms->policy = POLICY_RESOLUTION;
+            else if (!strcmp (argv[i], "depth"))      pParms->policy = POLICY_DEPTH;
+            else return GENERAL_ERROR;
+        } else if (!strcmp (argv[i], "-m") || !strcmp (argv[i], "-M")) {
+            pParms->minFrameRate = (float)atof (argv[++i]);
+            if (pParms->minFrameRate <= 0.0f) return GENERAL_ERROR;
+        } else if (!strcmp (argv[i], "-t") || !strcmp (argv[i], "-T")) {
+            int parm = atoi (argv[++i]);
+            if (parm < 1) return GENERAL_ERROR;
+            pParms->duration = (U32)parm;
+        } else {
+            return GENERAL_ERROR;
+        }
+    }
+
+    return A_OK;
+}
+
+// Reads a feature's parameter ranges (pMin and pMax may be NULL)
+static ULONG
+getFeatureRange (HANDLE hCamera, U32 featureId, U32 param, float* pMin, float* pMax)
 {
     ULONG  rc;
     ULONG  bufferSize = 0;
 
-    rc = PxLGetCameraFeatures(hCamera, FEATURE_FRAME_RATE, NULL, &bufferSize);
+    rc = PxLGetCameraFeatures(hCamera, featureId, NULL, &bufferSize);
     if (API_SUCCESS(rc)) {
         CAMERA_FEATURES* pFeatureInfo = (CAMERA_FEATURES*)malloc(bufferSize);
         if (NULL != pFeatureInfo) {
             // Now read the information into the buffer
-            rc = PxLGetCameraFeatures(hCamera, FEATURE_FRAME_RATE, pFeatureInfo, &bufferSize);
+            rc = PxLGetCameraFeatures(hCamera, featureId, pFeatureInfo, &bufferSize);
             if (API_SUCCESS(rc)) {
-                *minValue = pFeatureInfo->pFeatures->pParams->fMinValue;
+                if (param >= pFeatureInfo->pFeatures->uNumberOfParameters) {
+                    rc = ApiInvalidParameterError;
+                } else {
+                    if (pMin) *pMin = pFeatureInfo->pFeatures->pParams[param].fMinValue;
+                    if (pMax) *pMax = pFeatureInfo->pFeatures->pParams[param].fMaxValue;
+                }
             }
             free(pFeatureInfo);
+        } else {
+            rc = ApiOutOfMemoryError;
         }
     }
 
     return rc;
 }
 
-int 
-main(int argc, char* argv[])
+static ULONG
+setPixelAddressing (GOVERNOR* pGovernor, U32 value)
+{
+    float parms[FEATURE_PIXEL_ADDRESSING_NUM_PARAMS];
+
+    parms[FEATURE_PIXEL_ADDRESSING_PARAM_VALUE] = (float)value;
+    parms[FEATURE_PIXEL_ADDRESSING_PARAM_MODE] = (float)pGovernor->limits.pixelAddressingMode;
+    parms[FEATURE_PIXEL_ADDRESSING_PARAM_X_VALUE] = (float)value;
+    parms[FEATURE_PIXEL_ADDRESSING_PARAM_Y_VALUE] = (float)value;
+    return PxLSetFeature (pGovernor->hCamera, FEATURE_PIXEL_ADDRESSING, FEATURE_FLAG_MANUAL,
+                          pGovernor->limits.pixelAddressingParams, parms);
+}
+
+//
+// Learns the sensor size, the frame rate range, and which pixel addressing values and pixel formats (of the
+// camera's family) the camera accepts.  Also returns the settings the camera has now.
+//
+static ULONG
+getCameraLimits (GOVERNOR* pGovernor, STREAM_CONFIG* pStartConfig)
 {
-	HANDLE hCamera;
-	ULONG  rc;
+    HANDLE hCamera = pGovernor->hCamera;
+    CAMERA_LIMITS* pLimits = &pGovernor->limits;
+    float  parms[FEATURE_ROI_NUM_PARAMS > FEATURE_PIXEL_ADDRESSING_NUM_PARAMS ? FEATURE_ROI_NUM_PARAMS : FEATURE_PIXEL_ADDRESSING_NUM_PARAMS];
+    float  minValue, maxValue;
+    ULONG  numParams;
+    ULONG  flags;
+    ULONG  rc;
 
-	float  currentFrameRate = 0.0f;
-	float  minFrameRate;
-	ULONG  numParams = 1;
-	ULONG  flags;
+    //
+    // Step 1
+    //      The ROI, and the sensor
+    numParams = FEATURE_ROI_NUM_PARAMS;
+    rc = PxLGetFeature (hCamera, FEATURE_ROI, &flags, &numParams, parms);
+    if (!API_SUCCESS(rc)) return rc;
+    pStartConfig->roiWidth = (U32)parms[FEATURE_ROI_PARAM_WIDTH];
+    pStartConfig->roiHeight = (U32)parms[FEATURE_ROI_PARAM_HEIGHT];
+    rc = getFeatureRange (hCamera, FEATURE_ROI, FEATURE_ROI_PARAM_WIDTH, &minValue, &maxValue);
+    if (!API_SUCCESS(rc)) return rc;
+    pLimits->minRoiWidth = (U32)minValue;
+    pLimits->sensorWidth = (U32)maxValue;
+    rc = getFeatureRange (hCamera, FEATURE_ROI, FEATURE_ROI_PARAM_HEIGHT, &minValue, &maxValue);
+    if (!API_SUCCESS(rc)) return rc;
+    pLimits->minRoiHeight = (U32)minValue;
+    pLimits->sensorHeight = (U32)maxValue;
 
-	// We assume there's only one camera connected;
-	rc = PxLInitialize(0, &hCamera);
-	if (API_SUCCESS(rc)) {
+    //
+    // Step 2
+    //      The frame rate
+    numParams = 1;
+    rc = PxLGetFeature (hCamera, FEATURE_FRAME_RATE, &flags, &numParams, &pStartConfig->frameRate);
+    if (!API_SUCCESS(rc)) return rc;
+    rc = getFeatureRange (hCamera, FEATURE_FRAME_RATE, 0, &pLimits->minFrameRate, &pLimits->maxFrameRate);
+    if (!API_SUCCESS(rc)) return rc;
+    // A frame can't be shorter than its exposure
+    float exposure = 0.0f;
+    numParams = 1;
+    if (API_SUCCESS (PxLGetFeature (hCamera, FEATURE_SHUTTER, &flags, &numParams, &exposure)) &&
+        exposure > 0.0f && 1.0f / exposure < pLimits->maxFrameRate) {
+        pLimits->maxFrameRate = 1.0f / exposure;
+    }
 
-        rc = getMinFrameRate (hCamera, &minFrameRate);
-        if (API_SUCCESS(rc)) {
-            rc = PxLGetFeature (hCamera, FEATURE_FRAME_RATE, &flags, &numParams, &currentFrameRate);
+    //
+    // Step 3
+    //      Pixel addressing.  Not all values in the range are accepted, so try each.
+    numParams = FEATURE_PIXEL_ADDRESSING_NUM_PARAMS;
+    rc = PxLGetFeature (hCamera, FEATURE_PIXEL_ADDRESSING, &flags, &numParams, parms);
+    if (API_SUCCESS(rc)) {
+        pLimits->pixelAddressingParams = numParams;
+        pLimits->pixelAddressingMode = (U32)parms[FEATURE_PIXEL_ADDRESSING_PARAM_MODE];
+        pStartConfig->pixelAddressing = (U32)parms[FEATURE_PIXEL_ADDRESSING_PARAM_VALUE];
+        maxValue = 1.0f;
+        getFeatureRange (hCamera, FEATURE_PIXEL_ADDRESSING, FEATURE_PIXEL_ADDRESSING_PARAM_VALUE, NULL, &maxValue);
+        for (U32 value = 1; value <= (U32)maxValue && pLimits->numPixelAddressing < MAX_PIXEL_ADDRESSING; value++) {
+            if (API_SUCCESS (setPixelAddressing (pGovernor, value))) {
+                pLimits->pixelAddressing[pLimits->numPixelAddressing++] = value;
+            }
         }
-        if (!API_SUCCESS(rc)) {
-            printf ("Difficuty accessing FEATURE_FRAME_RATE, rc=0x%x\n", rc);
-            PxLUninitialize(hCamera);
-            return 1;
+        PxLSetFeature (hCamera, FEATURE_PIXEL_ADDRESSING, FEATURE_FLAG_MANUAL, numParams, parms);
+    }
+    if (0 == pLimits->numPixelAddressing) {
+        // The camera doesn't do pixel addressing
+        pStartConfig->pixelAddressing = 1;
+        pLimits->pixelAddressing[pLimits->numPixelAddressing++] = 1;
+    }
+
+    //
+    // Step 4
+    //      Pixel formats; those of the same family as the camera has now, that it accepts
+    float pixelFormat;
+    numParams = 1;
+    rc = PxLGetFeature (hCamera, FEATURE_PIXEL_FORMAT, &flags, &numParams, &pixelFormat);
+    if (!API_SUCCESS(rc)) return rc;
+    pStartConfig->pFormat = NULL;
+    for (U32 i = 0; i < NUM_PIXEL_FORMATS && NULL == pStartConfig->pFormat; i++) {
+        if (s_pixelFormats[i].pixelFormat == (U32)pixelFormat) pStartConfig->pFormat = &s_pixelFormats[i];
+    }
+    if (NULL == pStartConfig->pFormat) {
+        printf ("The governor doesn't know pixel format %u\n", (U32)pixelFormat);
+        return ApiInvalidParameterError;
+    }
+    for (U32 i = 0; i < NUM_PIXEL_FORMATS && pLimits->numPixelFormats < MAX_PIXEL_FORMATS; i++) {
+        if (s_pixelFormats[i].family != pStartConfig->pFormat->family) continue;
+        float value = (float)s_pixelFormats[i].pixelFormat;
+        if (API_SUCCESS (PxLSetFeature (hCamera, FEATURE_PIXEL_FORMAT, FEATURE_FLAG_MANUAL, 1, &value))) {
+            pLimits->pPixelFormats[pLimits->numPixelFormats++] = &s_pixelFormats[i];
         }
+    }
+    PxLSetFeature (hCamera, FEATURE_PIXEL_FORMAT, FEATURE_FLAG_MANUAL, 1, &pixelFormat);
+    if (0 == pLimits->numPixelFormats) pLimits->pPixelFormats[pLimits->numPixelFormats++] = pStartConfig->pFormat;
 
-        rc = PxLSetStreamState (hCamera, START_STREAM);
-        if (!API_SUCCESS(rc)) {
-            printf ("Difficuty starting the, rc=0x%x\n", rc);
-            PxLUninitialize(hCamera);
-            return 1;
+    return ApiSuccess;
+}
+
+// The cost of a mix of settings
+static double
+bytesPerSecond (const STREAM_CONFIG* pConfig)
+{
+    double pixels = (double)(pConfig->roiWidth / pConfig->pixelAddressing) * (double)(pConfig->roiHeight / pConfig->pixelAddressing);
+    return pixels * pConfig->pFormat->bytesPerPixel * pConfig->frameRate;
+}
+
+// Compares two values, a and b, that we want more of; > 0 if a is better.  Values within 2% are as good as one another.
+static int
+compareMore (double a, double b)
+{
+    if (a > b * 1.02) return 1;
+    if (b > a * 1.02) return -1;
+    return 0;
+}
+
+//
+// > 0 if config a is better than config b, under the policy
+//
+static int
+compareConfigs (POLICY policy, const STREAM_CONFIG* a, const STREAM_CONFIG* b)
+{
+    double pixelsA = (double)(a->roiWidth / a->pixelAddressing) * (double)(a->roiHeight / a->pixelAddressing);
+    double pixelsB = (double)(b->roiWidth / b->pixelAddressing) * (double)(b->roiHeight / b->pixelAddressing);
+    double viewA = (double)a->roiWidth * (double)a->roiHeight;
+    double viewB = (double)b->roiWidth * (double)b->roiHeight;
+    int    result;
+
+    // What each policy gives up last, is compared first
+    switch (policy) {
+    case POLICY_FPS:
+        if (0 != (result = compareMore (a->frameRate, b->frameRate))) return result;
+        if (0 != (result = compareMore (pixelsA, pixelsB))) return result;
+        if (0 != (result = compareMore (viewA, viewB))) return result;
+        return compareMore (a->pFormat->bitDepth, b->pFormat->bitDepth);
+    case POLICY_RESOLUTION:
+        if (0 != (result = compareMore (pixelsA, pixelsB))) return result;
+        if (0 != (result = compareMore (viewA, viewB))) return result;
+        if (0 != (result = compareMore (a->frameRate, b->frameRate))) return result;
+        return compareMore (a->pFormat->bitDepth, b->pFormat->bitDepth);
+    case POLICY_DEPTH:
+    default:
+        if (0 != (result = compareMore (a->pFormat->bitDepth, b->pFormat->bitDepth))) return result;
+        if (0 != (result = compareMore (pixelsA, pixelsB))) return result;
+        if (0 != (result = compareMore (viewA, viewB))) return result;
+        return compareMore (a->frameRate, b->frameRate);
+    }
+}
+
+//
+// The best mix, for the policy, that costs no more than budget bytes/second (0 for no limit).  Each mix of pixel
+// format, pixel addressing and ROI gets the highest frame rate the budget allows.  No mix has more of anything than
+// the camera started with.  If nothing fits, returns false, with the cheapest mix there is (at the minimum frame rate).
+//
+static bool
+pickConfig (const GOVERNOR* pGovernor, double budget, STREAM_CONFIG* pConfig)
+{
+    const CAMERA_LIMITS* pLimits = &pGovernor->limits;
+    const STREAM_CONFIG* pStart = &pGovernor->start;
+    double startPixels = (double)(pStart->roiWidth / pStart->pixelAddressing) * (double)(pStart->roiHeight / pStart->pixelAddressing);
+    float  maxFrameRate = pStart->frameRate > pGovernor->minFrameRate ? pStart->frameRate : pGovernor->minFrameRate;
+    STREAM_CONFIG cheapest;
+    bool found = false;
+    bool any = false;
+
+    if (maxFrameRate > pLimits->maxFrameRate) maxFrameRate = pLimits->maxFrameRate;
+    for (U32 f = 0; f < pLimits->numPixelFormats; f++) {
+        // No more bit depth than we started with; POLICY_DEPTH:  no less, either
+        if (pLimits->pPixelFormats[f]->bitDepth > pStart->pFormat->bitDepth) continue;
+        if (POLICY_DEPTH == pGovernor->policy && pLimits->pPixelFormats[f]->bitDepth < pStart->pFormat->bitDepth) continue;
+        for (U32 p = 0; p < pLimits->numPixelAddressing; p++) {
+            for (U32 s = 0; s < NUM_ROI_SCALES; s++) {
+                STREAM_CONFIG candidate;
+                U32 step = 8 * pLimits->pixelAddressing[p];   // Keep the (pixel addressed) width a multiple of 8
+                candidate.pFormat = pLimits->pPixelFormats[f];
+                candidate.pixelAddressing = pLimits->pixelAddressing[p];
+                candidate.roiWidth  = ((U32)(s_roiScales[s] * (float)pLimits->sensorWidth) / step) * step;
+                candidate.roiHeight = ((U32)(s_roiScales[s] * (float)pLimits->sensorHeight) / step) * step;
+                if (candidate.roiWidth < pLimits->minRoiWidth || candidate.roiHeight < pLimits->minRoiHeight) continue;
+                if (candidate.roiWidth > pStart->roiWidth || candidate.roiHeight > pStart->roiHeight) continue;
+                if ((double)(candidate.roiWidth / candidate.pixelAddressing) *
+                    (double)(candidate.roiHeight / candidate.pixelAddressing) > startPixels) continue;
+
+                candidate.frameRate = pGovernor->minFrameRate;
+                if (!any || bytesPerSecond (&candidate) < bytesPerSecond (&cheapest)) cheapest = candidate;
+                any = true;
+
+                candidate.frameRate = maxFrameRate;
+                if (budget > 0.0) {
+                    double rate = budget / (bytesPerSecond (&candidate) / candidate.frameRate);
+                    if (rate < (double)candidate.frameRate) candidate.frameRate = (float)rate;
+                }
+                if (candidate.frameRate < pGovernor->minFrameRate) continue;
+
+                if (!found || compareConfigs (pGovernor->policy, &candidate, pConfig) > 0) {
+                    *pConfig = candidate;
+                    found = true;
+                }
+            }
         }
+    }
+
+    if (!found && any) *pConfig = cheapest;
+    return found;
+}
+
+//
+// (Re)starts the stream with a mix of settings.  Returns PxLSetStreamState's return code; ApiSuccessLowMemory means
+// the mix doesn't fit.
+//
+static ULONG
+startStream (GOVERNOR* pGovernor, const STREAM_CONFIG* pConfig)
+{
+    HANDLE hCamera = pGovernor->hCamera;
+    float  parms[FEATURE_ROI_NUM_PARAMS];
+    float  value;
+    ULONG  rc;
+
+    if (pGovernor->streaming) {
+        PxLSetStreamState (hCamera, STOP_STREAM);
+        pGovernor->streaming = false;
+    }
 
-        while (ApiSuccessLowMemory == rc) {
-            printf ("Sub-optimal USB memory allocation detected at a frame rate of %5.2f fps\n", currentFrameRate);
-            if (currentFrameRate == minFrameRate) break; // We cannot reduce the frame rate any lower.
+    // Pixel addressing first, as the ROI may need to be a multiple of it
+    rc = setPixelAddressing (pGovernor, pConfig->pixelAddressing);
+    if (!API_SUCCESS(rc) && pConfig->pixelAddressing > 1) return rc;
 
-            // try restarting the stream at a lower frame rate
-            rc = PxLSetStreamState (hCamera, STOP_STREAM);
-            if (! API_SUCCESS(rc)) break;
+    parms[FEATURE_ROI_PARAM_LEFT]   = (float)(((pGovernor->limits.sensorWidth - pConfig->roiWidth) / 2) & ~7);
+    parms[FEATURE_ROI_PARAM_TOP]    = (float)(((pGovernor->limits.sensorHeight - pConfig->roiHeight) / 2) & ~7);
+    parms[FEATURE_ROI_PARAM_WIDTH]  = (float)pConfig->roiWidth;
+    parms[FEATURE_ROI_PARAM_HEIGHT] = (float)pConfig->roiHeight;
+    rc = PxLSetFeature (hCamera, FEATURE_ROI, FEATURE_FLAG_MANUAL, FEATURE_ROI_NUM_PARAMS, parms);
+    if (!API_SUCCESS(rc)) return rc;
 
-            // reduce the frame rate by 20%, being careful to not go lower than the minimum value
-            currentFrameRate = (currentFrameRate * 0.8) < minFrameRate ? minFrameRate : (currentFrameRate * 0.8);
-            rc = PxLSetFeature (hCamera, FEATURE_FRAME_RATE, FEATURE_FLAG_MANUAL, numParams, &currentFrameRate);
-            if (! API_SUCCESS(rc)) break;
+    value = (float)pConfig->pFormat->pixelFormat;
+    rc = PxLSetFeature (hCamera, FEATURE_PIXEL_FORMAT, FEATURE_FLAG_MANUAL, 1, &value);
+    if (!API_SUCCESS(rc)) return rc;
 
-            rc = PxLSetStreamState (hCamera, START_STREAM);
-            if (! API_SUCCESS(rc)) break;
+    value = pConfig->frameRate;
+    rc = PxLSetFeature (hCamera, FEATURE_FRAME_RATE, FEATURE_FLAG_MANUAL, 1, &value);
+    if (!API_SUCCESS(rc)) return rc;
+
+    rc = PxLSetStreamState (hCamera, START_STREAM);
+    if (API_SUCCESS(rc)) {
+        pGovernor->streaming = true;
+        pGovernor->current = *pConfig;
+        // The camera may not manage the frame rate asked for; what it does manage is what the stream costs
+        ULONG numParams = 1;
+        ULONG flags;
+        if (API_SUCCESS (PxLGetFeature (hCamera, FEATURE_ACTUAL_FRAME_RATE, &flags, &numParams, &value)) &&
+            value > 0.0f && value < pConfig->frameRate) {
+            pGovernor->current.frameRate = value;
         }
+    }
+    return rc;
+}
 
-        if (API_SUCCESS(rc))
-        {
-            if (ApiSuccessLowMemory != rc) {
-                printf ("Camera can stream fine at a frame rate of %5.2f fps\n", currentFrameRate);
-            } else {
-                printf ("Cannot fully accomodate sub-optimal USB memory allocations, "
-                        "try adjusting ROI, PixelAddressing, or PixelFormat\n");
-            }
+// The bytes/second to aim for next, from what we know fits, and what doesn't
+static double
+budget (const GOVERNOR* pGovernor)
+{
+    if (0.0 == pGovernor->tooMuch) return 0.0;   // No limit known
+    if (0.0 == pGovernor->fits) return pGovernor->tooMuch * BACKOFF;
+    if (pGovernor->fits >= pGovernor->tooMuch * CONVERGED) return pGovernor->fits;
+    return (pGovernor->fits + pGovernor->tooMuch) / 2.0;
+}
+
+// True if two configs would stream the same way
+static bool
+sameConfig (const STREAM_CONFIG* a, const STREAM_CONFIG* b)
+{
+    return a->pFormat == b->pFormat && a->pixelAddressing == b->pixelAddressing &&
+           a->roiWidth == b->roiWidth && a->roiHeight == b->roiHeight && 0 == compareMore (a->frameRate, b->frameRate);
+}
+
+//
+// Finds the best mix that fits:  restarts the stream, bisecting between what fits and what doesn't, until the two
+// are close, or the next mix to try is the one we already have.
+// When probing (while streaming), a START_STREAM without ApiSuccessLowMemory doesn't show that a mix fits; only
+// streaming it, without losing frames, does.  So we stop at the first such mix, and leave it to stream() to judge.
+//
+static ULONG
+tune (GOVERNOR* pGovernor, bool probe)
+{
+    STREAM_CONFIG config;
+    ULONG rc = probe ? ApiSuccess : ApiSuccessLowMemory;
+
+    for (int attempt = 0; attempt < MAX_TUNE_ATTEMPTS; attempt++) {
+        // If nothing fits the budget, we get the cheapest mix there is; it's the last thing to try
+        bool cheapest = !pickConfig (pGovernor, budget (pGovernor), &config);
+        if (ApiSuccessLowMemory != rc && pGovernor->streaming && sameConfig (&config, &pGovernor->current)) return rc;
+
+        printConfig ("Trying", &config);
+        rc = startStream (pGovernor, &config);
+        if (!API_SUCCESS(rc)) return rc;
+
+        double cost = bytesPerSecond (&pGovernor->current);
+        if (ApiSuccessLowMemory == rc) {
+            printf ("   ... sub-optimal USB memory allocation detected at %.1f MB/s\n", cost / 1.0e6);
+            if (0.0 == pGovernor->tooMuch || cost < pGovernor->tooMuch) pGovernor->tooMuch = cost;
+            if (0.0 == pGovernor->noRoom || cost < pGovernor->noRoom) pGovernor->noRoom = cost;
+            if (pGovernor->fits >= pGovernor->tooMuch) pGovernor->fits = 0.0;
+            if (cheapest) break;
+            continue;
+        }
+        if (probe) return rc;
+        if (cost > pGovernor->fits) pGovernor->fits = cost;
+        if (pGovernor->fits >= pGovernor->tooMuch * CONVERGED) return rc;
+    }
+
+    if (ApiSuccessLowMemory == rc) {
+        printf ("Cannot fully accomodate sub-optimal USB memory allocations, even at %5.2f fps\n", pGovernor->current.frameRate);
+    }
+    return rc;
+}
+
+static double
+now ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+//
+// Streams for duration seconds, watching the frame numbers.  Losing LOSS_LIMIT of the last LOSS_WINDOW frames means
+// the current mix costs too much, after all; re-tune straight away.  LOSS_WINDOW frames without loss means it fits;
+// if there's room between it and the least known not to, try for more.  CEILING_EXPIRY such windows in a row raise
+// the least known not to fit, if frame loss is all that says so, up to what START_STREAM says doesn't (or, if it
+// hasn't, what we started with), and try for more again.
+//
+static ULONG
+stream (GOVERNOR* pGovernor, U32 duration)
+{
+    // Big enough for any mix
+    U32 bufferSize = pGovernor->limits.sensorWidth * pGovernor->limits.sensorHeight * 6;
+    U8* pFrame = (U8*)malloc (bufferSize);
+    if (NULL == pFrame) return ApiOutOfMemoryError;
+
+    ULONG  rc = ApiSuccess;
+    FRAME_DESC frameDesc;
+    U32    lastFrameNumber = 0;
+    bool   haveFrame = false;
+    U32    windowStart = 0;   // Frame number at the start of the window
+    U32    windowLost = 0;
+    U32    totalLost = 0;
+    U32    failedGrabs = 0;
+    U32    cleanWindows = 0;  // In a row
+    bool   atFloor = false;   // Losing frames with the cheapest mix there is; nothing more to be done
+    double end = now() + (double)duration;
+
+    while (now() < end) {
+        frameDesc.uSize = sizeof(frameDesc);
+        rc = PxLGetNextFrame (pGovernor->hCamera, bufferSize, pFrame, &frameDesc);
+        if (!API_SUCCESS(rc)) {
+            if (++failedGrabs >= MAX_FAILED_GRABS) break;
+            windowLost++;
         } else {
-            printf ("Difficuty attempting to reduce the frame rate, rc=0x%x\n", rc);
-	    }
+            failedGrabs = 0;
+            if (!haveFrame) {
+                windowStart = frameDesc.uFrameNumber;
+            } else if (frameDesc.uFrameNumber > lastFrameNumber + 1) {
+                windowLost += frameDesc.uFrameNumber - lastFrameNumber - 1;
+                totalLost += frameDesc.uFrameNumber - lastFrameNumber - 1;
+            }
+            lastFrameNumber = frameDesc.uFrameNumber;
+            haveFrame = true;
+        }
 
-        PxLSetStreamState (hCamera, STOP_STREAM);
-        PxLUninitialize(hCamera);
-	}
-	return 0;
+        double cost = bytesPerSecond (&pGovernor->current);
+        if (windowLost >= LOSS_LIMIT && !atFloor) {
+            printf ("Lost %u frames of %u at %.1f MB/s; re-tuning\n", windowLost,
+                    haveFrame ? lastFrameNumber - windowStart + 1 : windowLost, cost / 1.0e6);
+            if (0.0 == pGovernor->tooMuch || cost < pGovernor->tooMuch) pGovernor->tooMuch = cost;
+            if (pGovernor->fits >= pGovernor->tooMuch) pGovernor->fits = 0.0;
+            cleanWindows = 0;
+            STREAM_CONFIG previous = pGovernor->current;
+            rc = tune (pGovernor, true);
+            if (!API_SUCCESS(rc)) break;
+            if (sameConfig (&previous, &pGovernor->current)) {
+                printf ("Still losing frames with the cheapest mix there is; try adjusting the USB memory\n");
+                atFloor = true;
+            }
+            haveFrame = false;
+            windowLost = 0;
+        } else if (haveFrame && lastFrameNumber - windowStart + 1 >= LOSS_WINDOW) {
+            if (windowLost < LOSS_LIMIT) {
+                bool tryForMore = cost > pGovernor->fits;
+                if (tryForMore) pGovernor->fits = cost;
+                // What was lost may have been to a passing load on the bus; don't let it cap the stream for good
+                if (0.0 != pGovernor->tooMuch && pGovernor->tooMuch != pGovernor->noRoom && ++cleanWindows >= CEILING_EXPIRY) {
+                    double ceiling = 0.0 != pGovernor->noRoom ? pGovernor->noRoom : bytesPerSecond (&pGovernor->start);
+                    pGovernor->tooMuch /= BACKOFF;
+                    if (pGovernor->tooMuch >= ceiling) pGovernor->tooMuch = pGovernor->noRoom;
+                    printf ("No frames lost in %u windows; raising the limit to %.1f MB/s\n", cleanWindows,
+                            (0.0 != pGovernor->tooMuch ? pGovernor->tooMuch : ceiling) / 1.0e6);
+                    cleanWindows = 0;
+                    atFloor = false;
+                    tryForMore = true;
+                }
+                STREAM_CONFIG next;
+                if (tryForMore && (0.0 == pGovernor->tooMuch || pGovernor->fits < pGovernor->tooMuch * CONVERGED) &&
+                    pickConfig (pGovernor, budget (pGovernor), &next) && !sameConfig (&next, &pGovernor->current)) {
+                    printf ("No frames lost at %.1f MB/s; trying for more\n", cost / 1.0e6);
+                    rc = tune (pGovernor, true);
+                    if (!API_SUCCESS(rc)) break;
+                    haveFrame = false;
+                }
+            }
+            windowStart = lastFrameNumber + 1;
+            windowLost = 0;
+        }
+    }
+
+    free (pFrame);
+    if (API_SUCCESS(rc)) printf ("Streamed for %u seconds; %u frames lost\n", duration, totalLost);
+    return rc;
 }
 
+static void
+printConfig (const char* pPrefix, const STREAM_CONFIG* pConfig)
+{
+    printf ("%s %ux%u, pixel addressing %u, %s, %5.2f fps (%.1f MB/s)\n", pPrefix,
+            pConfig->roiWidth, pConfig->roiHeight, pConfig->pixelAddressing, pConfig->pFormat->name,
+            pConfig->frameRate, bytesPerSecond (pConfig) / 1.0e6);
+}
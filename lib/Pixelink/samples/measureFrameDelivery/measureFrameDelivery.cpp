@@ -0,0 +1,772 @@
+//
+// measureFrameDelivery.cpp
+//
+// Measures how frames are delivered to the application, rather than simply how many
+// of them there are (see measureGetNextFrameRate and measureCallbackRate for that).
+//
+// For each camera configuration (a sweep of ROIs, pixel formats and frame rates), and
+// for each way of getting frames (PxLGetNextFrame, and CALLBACK_FRAME callbacks), it
+// reports:
+//    - The distribution (p50/p99/max) of the interval between frames, both as seen by
+//      the host, and as time stamped by the camera.  The difference between the two is
+//      the jitter added by the host (USB, the API, and the scheduler).
+//    - For callbacks, the latency from the callback, to a separate consumer thread
+//      picking the frame up -- the hand off that every real application has to do.
+//    - Frames lost, from gaps in the camera's frame numbers.
+// The results are written to a JSON file and a CSV file, so that configurations (and
+// boards) can be compared.
+//
+// NOTE: This application assumes there is at most, one PixeLINK camera connected to the system
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <time.h>
+#include <math.h>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include "PixeLINKApi.h"
+
+using namespace std;
+
+//
+// A few useful defines and enums.
+//
+#define A_OK            0  // non-zero error codes
+#define GENERAL_ERROR   1
+
+#define NO_CAMERA(rc) ((rc == ApiNoCameraError) || (rc == ApiNoCameraAvailableError))
+
+#define DEFAULT_RUN_DURATION   10       // in seconds, for each configuration and method
+#define SETTLE_TIME            1.0      // in seconds; frames from the start of the stream are not measured
+#define MAX_SWEEP_VALUES       16
+#define CALLBACK_QUEUE_SIZE    256      // Frames the callback can be ahead of the consumer
+#define NOT_SWEPT              0        // Leave this setting as the camera has it
+#define NOT_SWEPT_FORMAT       0xFFFFFFFF // ... and for the pixel format, where 0 is PIXEL_FORMAT_MONO8
+
+typedef enum _DELIVERY_METHOD
+{
+    METHOD_GET_NEXT_FRAME,
+    METHOD_CALLBACK,
+    NUM_METHODS
+} DELIVERY_METHOD;
+
+static const char* const s_methodNames[NUM_METHODS] = {"getNextFrame", "callback"};
+
+typedef struct _PIXEL_FORMAT_NAME
+{
+    const char* name;
+    U32         pixelFormat;
+} PIXEL_FORMAT_NAME;
+
+static const PIXEL_FORMAT_NAME s_pixelFormats[] = {
+    {"mono8",             PIXEL_FORMAT_MONO8},
+    {"mono16",            PIXEL_FORMAT_MONO16},
+    {"mono12packed",      PIXEL_FORMAT_MONO12_PACKED},
+    {"bayer8_grbg",       PIXEL_FORMAT_BAYER8_GRBG},
+    {"bayer8_rggb",       PIXEL_FORMAT_BAYER8_RGGB},
+    {"bayer8_gbrg",       PIXEL_FORMAT_BAYER8_GBRG},
+    {"bayer8_bggr",       PIXEL_FORMAT_BAYER8_BGGR},
+    {"bayer16_grbg",      PIXEL_FORMAT_BAYER16_GRBG},
+    {"bayer16_rggb",      PIXEL_FORMAT_BAYER16_RGGB},
+    {"bayer16_gbrg",      PIXEL_FORMAT_BAYER16_GBRG},
+    {"bayer16_bggr",      PIXEL_FORMAT_BAYER16_BGGR},
+    {"yuv422",            PIXEL_FORMAT_YUV422},
+    {"rgb24",             PIXEL_FORMAT_RGB24},
+    {"rgb48",             PIXEL_FORMAT_RGB48}
+};
+#define NUM_PIXEL_FORMATS (sizeof(s_pixelFormats)/sizeof(s_pixelFormats[0]))
+
+// One point of the sweep.  NOT_SWEPT values are left as the camera has them.
+typedef struct _CONFIGURATION
+{
+    U32   roiWidth;
+    U32   roiHeight;
+    U32   pixelFormat;
+    float frameRate;
+} CONFIGURATION;
+
+typedef struct _USER_PARAMETERS
+{
+    U32   duration;
+    bool  methods[NUM_METHODS];
+    vector<U32>   roiWidths;    // roiWidths[i] goes with roiHeights[i]
+    vector<U32>   roiHeights;
+    vector<U32>   pixelFormats;
+    vector<float> frameRates;
+    const char*   outputName;
+} USER_PARAMETERS;
+
+// A distribution of times, in milliseconds
+typedef struct _DISTRIBUTION
+{
+    U32    count;
+    double mean;
+    double p50;
+    double p99;
+    double max;
+} DISTRIBUTION;
+
+typedef struct _RUN_RESULT
+{
+    DELIVERY_METHOD method;
+    CONFIGURATION   actual;          // The camera's settings, as read back
+    PXL_RETURN_CODE rc;              // Of setting up the configuration, or the stream
+    U32    frames;                   // Measured, after the settle time
+    U32    lostFrames;               // From gaps in the frame numbers
+    U32    failedGrabs;              // PxLGetNextFrame errors
+    U32    queueOverflows;           // Frames the callback could not hand to the consumer
+    double rate;                     // Frames/second received
+    DISTRIBUTION hostInterval;
+    DISTRIBUTION cameraInterval;
+    DISTRIBUTION latency;            // Callback to consumer; callbacks only
+} RUN_RESULT;
+
+// What the callback hands to the consumer
+typedef struct _DELIVERED_FRAME
+{
+    U32    frameNumber;
+    float  cameraTime;
+    double callbackTime;
+} DELIVERED_FRAME;
+
+// The samples of one run, and the queue between the callback and the consumer
+typedef struct _RUN_STATE
+{
+    double settleTime;
+    bool   haveLast;
+    U32    lastFrameNumber;
+    float  lastCameraTime;
+    double lastHostTime;
+
+    vector<double> hostIntervals;
+    vector<double> cameraIntervals;
+    vector<double> latencies;
+    U32    frames;
+    U32    lostFrames;
+    U32    queueOverflows;
+
+    pthread_mutex_t mutex;
+    pthread_cond_t  cond;
+    vector<DELIVERED_FRAME> queue;   // A ring of CALLBACK_QUEUE_SIZE
+    U32    head;                     // Total frames queued
+    U32    tail;                     // Total frames consumed
+    bool   done;
+} RUN_STATE;
+
+// Prototypes to allow top-down structure
+void   usage (char* argv[]);
+int    getParameters (int argc, char* argv[], USER_PARAMETERS* pParms);
+static double now ();
+static PXL_RETURN_CODE applyConfiguration (HANDLE hCamera, const CONFIGURATION& config, CONFIGURATION* pActual);
+static void   measure (HANDLE hCamera, DELIVERY_METHOD method, U32 duration, RUN_RESULT* pResult);
+static void   distribution (vector<double>& samples, DISTRIBUTION* pDist);
+static const char* pixelFormatName (U32 pixelFormat);
+static bool   writeResults (const char* outputName, HANDLE hCamera, U32 duration, const vector<RUN_RESULT>& results);
+
+int main (int argc, char* argv[])
+{
+    USER_PARAMETERS parms;
+
+    //
+    // Step 1
+    //      Validate the user parameters, getting user specified (or default) values
+    if (A_OK != getParameters(argc, argv, &parms))
+    {
+        usage(argv);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 2
+    //		Grab our camera, remembering the settings we will be sweeping, so they can be restored
+    HANDLE	hCamera;
+    PXL_RETURN_CODE rc = A_OK;
+    U32		uNumberOfCameras = 0;
+
+    rc = PxLGetNumberCameras (NULL, &uNumberOfCameras);
+    if (!API_SUCCESS(rc) || uNumberOfCameras != 1)
+    {
+        printf (" Error:  There should be exactly one PixeLINK camera connected.\n");
+        return GENERAL_ERROR;
+    }
+    rc = PxLInitialize (0, &hCamera);
+    if (!API_SUCCESS(rc))
+    {
+        printf (" Error:  Could not initialize the camera.\n");
+        return GENERAL_ERROR;
+    }
+
+    float roi[4];
+    float pixelFormat;
+    float frameRate;
+    U32   roiFlags, pixelFormatFlags, frameRateFlags;
+    U32   numParams = 4;
+    PxLGetFeature (hCamera, FEATURE_ROI, &roiFlags, &numParams, roi);
+    numParams = 1;
+    PxLGetFeature (hCamera, FEATURE_PIXEL_FORMAT, &pixelFormatFlags, &numParams, &pixelFormat);
+    numParams = 1;
+    PxLGetFeature (hCamera, FEATURE_FRAME_RATE, &frameRateFlags, &numParams, &frameRate);
+
+    //
+    // Step 3
+    //      Sweep the configurations.  A sweep with no values for a setting, leaves it as the camera has it.
+    U32 numRois    = max ((U32)parms.roiWidths.size(), (U32)1);
+    U32 numFormats = max ((U32)parms.pixelFormats.size(), (U32)1);
+    U32 numRates   = max ((U32)parms.frameRates.size(), (U32)1);
+    vector<RUN_RESULT> results;
+
+    printf ("\n %-13s %-10s %-13s %8s | %8s %8s %8s | %8s %8s | %8s %8s | %6s\n",
+            "method", "roi", "format", "fps", "frames/s", "int p50", "int p99", "int max", "cam p99",
+            "lat p50", "lat p99", "lost");
+    for (U32 r = 0; r < numRois; r++)
+    {
+        for (U32 f = 0; f < numFormats; f++)
+        {
+            for (U32 fr = 0; fr < numRates; fr++)
+            {
+                CONFIGURATION config;
+                config.roiWidth    = parms.roiWidths.empty()    ? NOT_SWEPT : parms.roiWidths[r];
+                config.roiHeight   = parms.roiHeights.empty()   ? NOT_SWEPT : parms.roiHeights[r];
+                config.pixelFormat = parms.pixelFormats.empty() ? NOT_SWEPT_FORMAT : parms.pixelFormats[f];
+                config.frameRate   = parms.frameRates.empty()   ? NOT_SWEPT : parms.frameRates[fr];
+
+                CONFIGURATION actual;
+                PXL_RETURN_CODE configRc = applyConfiguration (hCamera, config, &actual);
+
+                for (int m = 0; m < NUM_METHODS; m++)
+                {
+                    if (!parms.methods[m]) continue;
+
+                    RUN_RESULT result;
+                    memset (&result, 0, sizeof(result));
+                    result.method = (DELIVERY_METHOD)m;
+                    result.actual = actual;
+                    result.rc = configRc;
+                    if (API_SUCCESS (configRc)) measure (hCamera, (DELIVERY_METHOD)m, parms.duration, &result);
+                    results.push_back (result);
+
+                    char roiText[32];
+                    sprintf (roiText, "%dx%d", actual.roiWidth, actual.roiHeight);
+                    if (!API_SUCCESS (result.rc))
+                    {
+                        printf (" %-13s %-10s %-13s %8.2f | Error 0x%08X\n", s_methodNames[m], roiText,
+                                pixelFormatName(actual.pixelFormat), actual.frameRate, result.rc);
+                        if (NO_CAMERA (result.rc))
+                        {
+                            printf ("Camera is Gone!! -- Aborting\n");
+                            return GENERAL_ERROR;  // No point is continuing
+                        }
+                        continue;
+                    }
+                    printf (" %-13s %-10s %-13s %8.2f | %8.2f %8.3f %8.3f | %8.3f %8.3f | ", s_methodNames[m], roiText,
+                            pixelFormatName(actual.pixelFormat), actual.frameRate, result.rate,
+                            result.hostInterval.p50, result.hostInterval.p99, result.hostInterval.max, result.cameraInterval.p99);
+                    if (METHOD_CALLBACK == m)
+                    {
+                        printf ("%8.3f %8.3f | %6d\n", result.latency.p50, result.latency.p99, result.lostFrames);
+                    } else {
+                        printf ("%8s %8s | %6d\n", "-", "-", result.lostFrames);
+                    }
+                }
+            }
+        }
+    }
+    printf (" (all times in milliseconds)\n");
+
+    //
+    // Step 4
+    //      Save the results, and put the camera back the way we found it
+    bool saved = writeResults (parms.outputName, hCamera, parms.duration, results);
+
+    PxLSetFeature (hCamera, FEATURE_ROI, roiFlags, 4, roi);
+    PxLSetFeature (hCamera, FEATURE_PIXEL_FORMAT, pixelFormatFlags, 1, &pixelFormat);
+    PxLSetFeature (hCamera, FEATURE_FRAME_RATE, frameRateFlags, 1, &frameRate);
+    PxLUninitialize (hCamera);
+
+    return saved ? A_OK : GENERAL_ERROR;
+}
+
+//
+// A monotonic time, in seconds
+//
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+//
+// Sets up the camera for one point of the sweep (the stream must be stopped), and reads back
+// what the camera actually ended up using.
+//
+static PXL_RETURN_CODE applyConfiguration (HANDLE hCamera, const CONFIGURATION& config, CONFIGURATION* pActual)
+{
+    PXL_RETURN_CODE rc = ApiSuccess;
+    U32   flags;
+    U32   numParams;
+    float parms[4];
+
+    //
+    // Step 1
+    //      The ROI is centered, on 8 pixel boundaries
+    if (NOT_SWEPT != config.roiWidth)
+    {
+        U32 bufferSize = 0;
+        float maxWidth = (float)config.roiWidth;
+        float maxHeight = (float)config.roiHeight;
+        if (API_SUCCESS (PxLGetCameraFeatures (hCamera, FEATURE_ROI, NULL, &bufferSize)))
+        {
+            vector<U8> buffer(bufferSize, 0);
+            CAMERA_FEATURES* pFeatures = (CAMERA_FEATURES*)&buffer[0];
+            if (API_SUCCESS (PxLGetCameraFeatures (hCamera, FEATURE_ROI, pFeatures, &bufferSize)))
+            {
+                maxWidth  = pFeatures->pFeatures[0].pParams[FEATURE_ROI_PARAM_WIDTH].fMaxValue;
+                maxHeight = pFeatures->pFeatures[0].pParams[FEATURE_ROI_PARAM_HEIGHT].fMaxValue;
+            }
+        }
+        parms[FEATURE_ROI_PARAM_LEFT]   = (float)(((U32)max (maxWidth  - (float)config.roiWidth,  0.0f) / 2) & ~7);
+        parms[FEATURE_ROI_PARAM_TOP]    = (float)(((U32)max (maxHeight - (float)config.roiHeight, 0.0f) / 2) & ~7);
+        parms[FEATURE_ROI_PARAM_WIDTH]  = (float)config.roiWidth;
+        parms[FEATURE_ROI_PARAM_HEIGHT] = (float)config.roiHeight;
+        rc = PxLSetFeature (hCamera, FEATURE_ROI, FEATURE_FLAG_MANUAL, 4, parms);
+    }
+
+    //
+    // Step 2
+    //      Pixel format, and frame rate
+    if (API_SUCCESS (rc) && NOT_SWEPT_FORMAT != config.pixelFormat)
+    {
+        parms[0] = (float)config.pixelFormat;
+        rc = PxLSetFeature (hCamera, FEATURE_PIXEL_FORMAT, FEATURE_FLAG_MANUAL, 1, parms);
+    }
+    if (API_SUCCESS (rc) && NOT_SWEPT != config.frameRate)
+    {
+        parms[0] = config.frameRate;
+        rc = PxLSetFeature (hCamera, FEATURE_FRAME_RATE, FEATURE_FLAG_MANUAL, 1, parms);
+    }
+
+    //
+    // Step 3
+    //      Read back what the camera is really doing.  Prefer the actual frame rate, if the camera has it.
+    numParams = 4;
+    if (API_SUCCESS (PxLGetFeature (hCamera, FEATURE_ROI, &flags, &numParams, parms)))
+    {
+        pActual->roiWidth  = (U32)parms[FEATURE_ROI_PARAM_WIDTH];
+        pActual->roiHeight = (U32)parms[FEATURE_ROI_PARAM_HEIGHT];
+    }
+    numParams = 1;
+    if (API_SUCCESS (PxLGetFeature (hCamera, FEATURE_PIXEL_FORMAT, &flags, &numParams, parms)))
+    {
+        pActual->pixelFormat = (U32)parms[0];
+    }
+    numParams = 1;
+    if (API_SUCCESS (PxLGetFeature (hCamera, FEATURE_ACTUAL_FRAME_RATE, &flags, &numParams, parms)) ||
+        API_SUCCESS (PxLGetFeature (hCamera, FEATURE_FRAME_RATE, &flags, &numParams, parms)))
+    {
+        pActual->frameRate = parms[0];
+    }
+
+    return rc;
+}
+
+//
+// Accounts for one frame:  the intervals since the previous one, and any frames lost in between.
+//
+static void frameArrived (RUN_STATE* pState, U32 frameNumber, float cameraTime, double hostTime)
+{
+    if (hostTime < pState->settleTime) return;
+
+    if (pState->haveLast)
+    {
+        if (frameNumber > pState->lastFrameNumber)
+        {
+            U32 missed = frameNumber - pState->lastFrameNumber - 1;
+            pState->lostFrames += missed;
+            // Only back to back frames give a meaningful interval
+            if (0 == missed)
+            {
+                pState->hostIntervals.push_back ((hostTime - pState->lastHostTime) * 1000.0);
+                pState->cameraIntervals.push_back ((double)(cameraTime - pState->lastCameraTime) * 1000.0);
+            }
+        }
+    }
+    pState->haveLast = true;
+    pState->lastFrameNumber = frameNumber;
+    pState->lastCameraTime = cameraTime;
+    pState->lastHostTime = hostTime;
+    pState->frames++;
+}
+
+//
+// The callback only time stamps the frame and queues it; everything else is done by the consumer.
+//
+static U32 DeliveryCallback(HANDLE hCamera, LPVOID pFrameData, U32 dataFormat, FRAME_DESC const * pFrameDesc, LPVOID pContext)
+{
+    RUN_STATE* pState = (RUN_STATE*)pContext;
+    double callbackTime = now();
+
+    pthread_mutex_lock (&pState->mutex);
+    if (pState->head - pState->tail >= CALLBACK_QUEUE_SIZE)
+    {
+        pState->queueOverflows++;
+    } else {
+        DELIVERED_FRAME& frame = pState->queue[pState->head % CALLBACK_QUEUE_SIZE];
+        frame.frameNumber = pFrameDesc->uFrameNumber;
+        frame.cameraTime = pFrameDesc->fFrameTime;
+        frame.callbackTime = callbackTime;
+        pState->head++;
+        pthread_cond_signal (&pState->cond);
+    }
+    pthread_mutex_unlock (&pState->mutex);
+
+    return ApiSuccess;
+}
+
+static void* ConsumerThread(void* pContext)
+{
+    RUN_STATE* pState = (RUN_STATE*)pContext;
+
+    pthread_mutex_lock (&pState->mutex);
+    for (;;)
+    {
+        while (pState->head == pState->tail && !pState->done) pthread_cond_wait (&pState->cond, &pState->mutex);
+        if (pState->head == pState->tail) break;
+
+        DELIVERED_FRAME frame = pState->queue[pState->tail % CALLBACK_QUEUE_SIZE];
+        pState->tail++;
+        pthread_mutex_unlock (&pState->mutex);
+
+        double consumedTime = now();
+        if (frame.callbackTime >= pState->settleTime)
+        {
+            pState->latencies.push_back ((consumedTime - frame.callbackTime) * 1000.0);
+        }
+        frameArrived (pState, frame.frameNumber, frame.cameraTime, frame.callbackTime);
+
+        pthread_mutex_lock (&pState->mutex);
+    }
+    pthread_mutex_unlock (&pState->mutex);
+
+    return NULL;
+}
+
+//
+// Streams the camera for duration seconds (plus the settle time), getting the frames with the given method.
+//
+static void measure (HANDLE hCamera, DELIVERY_METHOD method, U32 duration, RUN_RESULT* pResult)
+{
+    RUN_STATE state;
+    PXL_RETURN_CODE rc;
+
+    //
+    // Step 1
+    //      Size the sample buffers up front, so that growing them doesn't add to the jitter
+    U32 expected = (U32)((pResult->actual.frameRate > 0.0f ? pResult->actual.frameRate : 100.0f) * (float)duration * 1.5f) + 16;
+    state.haveLast = false;
+    state.hostIntervals.reserve (expected);
+    state.cameraIntervals.reserve (expected);
+    state.latencies.reserve (method == METHOD_CALLBACK ? expected : 0);
+    state.frames = state.lostFrames = state.queueOverflows = 0;
+    state.queue.resize (CALLBACK_QUEUE_SIZE);
+    state.head = state.tail = 0;
+    state.done = false;
+    pthread_mutex_init (&state.mutex, NULL);
+    pthread_cond_init (&state.cond, NULL);
+
+    //
+    // Step 2
+    //      Stream, and collect the samples
+    pthread_t consumer;
+    if (METHOD_CALLBACK == method)
+    {
+        pthread_create (&consumer, NULL, ConsumerThread, &state);
+        rc = PxLSetCallback (hCamera, CALLBACK_FRAME, &state, DeliveryCallback);
+    } else {
+        rc = ApiSuccess;
+    }
+
+    double startTime = now();
+    state.settleTime = startTime + SETTLE_TIME;
+    double endTime = state.settleTime + (double)duration;
+    if (API_SUCCESS (rc)) rc = PxLSetStreamState (hCamera, START_STREAM);
+    if (API_SUCCESS (rc))
+    {
+        if (METHOD_GET_NEXT_FRAME == method)
+        {
+            // A buffer large enough for any pixel format, at this ROI
+            vector<U8> frameBuffer(pResult->actual.roiWidth * pResult->actual.roiHeight * 6);
+            FRAME_DESC frameDesc;
+            while (now() < endTime)
+            {
+                frameDesc.uSize = sizeof(FRAME_DESC);
+                PXL_RETURN_CODE grabRc = PxLGetNextFrame (hCamera, (U32)frameBuffer.size(), &frameBuffer[0], &frameDesc);
+                double hostTime = now();
+                if (!API_SUCCESS (grabRc))
+                {
+                    if (hostTime >= state.settleTime) pResult->failedGrabs++;
+                    if (NO_CAMERA (grabRc))
+                    {
+                        rc = grabRc;
+                        break;
+                    }
+                    continue;
+                }
+                frameArrived (&state, frameDesc.uFrameNumber, frameDesc.fFrameTime, hostTime);
+            }
+        } else {
+            while (now() < endTime) usleep (100*1000);
+        }
+        PxLSetStreamState (hCamera, STOP_STREAM);
+    }
+
+    if (METHOD_CALLBACK == method)
+    {
+        PxLSetCallback (hCamera, CALLBACK_FRAME, NULL, NULL);
+        pthread_mutex_lock (&state.mutex);
+        state.done = true;
+        pthread_cond_signal (&state.cond);
+        pthread_mutex_unlock (&state.mutex);
+        pthread_join (consumer, NULL);
+    }
+    pthread_cond_destroy (&state.cond);
+    pthread_mutex_destroy (&state.mutex);
+
+    //
+    // Step 3
+    //      Boil the samples down
+    pResult->rc = rc;
+    pResult->frames = state.frames;
+    pResult->lostFrames = state.lostFrames;
+    pResult->queueOverflows = state.queueOverflows;
+    pResult->rate = (double)state.frames / (double)duration;
+    distribution (state.hostIntervals, &pResult->hostInterval);
+    distribution (state.cameraIntervals, &pResult->cameraInterval);
+    distribution (state.latencies, &pResult->latency);
+}
+
+//
+// Mean, median, 99th percentile (nearest rank), and max of the samples.  The samples are sorted.
+//
+static void distribution (vector<double>& samples, DISTRIBUTION* pDist)
+{
+    memset (pDist, 0, sizeof(*pDist));
+    if (samples.empty()) return;
+
+    sort (samples.begin(), samples.end());
+    size_t n = samples.size();
+    double sum = 0.0;
+    for (size_t i = 0; i < n; i++) sum += samples[i];
+
+    pDist->count = (U32)n;
+    pDist->mean = sum / (double)n;
+    pDist->p50 = samples[(size_t)ceil (0.50 * (double)n) - 1];
+    pDist->p99 = samples[(size_t)ceil (0.99 * (double)n) - 1];
+    pDist->max = samples[n - 1];
+}
+
+static const char* pixelFormatName (U32 pixelFormat)
+{
+    for (U32 i = 0; i < NUM_PIXEL_FORMATS; i++)
+    {
+        if (s_pixelFormats[i].pixelFormat == pixelFormat) return s_pixelFormats[i].name;
+    }
+    return "other";
+}
+
+static void writeDistribution (FILE* pFile, const char* name, const DISTRIBUTION& dist, bool last)
+{
+    fprintf (pFile, "      \"%s\": {\"count\": %u, \"mean\": %.4f, \"p50\": %.4f, \"p99\": %.4f, \"max\": %.4f}%s\n",
+             name, dist.count, dist.mean, dist.p50, dist.p99, dist.max, last ? "" : ",");
+}
+
+//
+// Writes outputName.json (everything), and outputName.csv (a row per run).
+//
+static bool writeResults (const char* outputName, HANDLE hCamera, U32 duration, const vector<RUN_RESULT>& results)
+{
+    CAMERA_INFO info;
+    char hostName[256];
+    string fileName;
+
+    memset (&info, 0, sizeof(info));
+    PxLGetCameraInfoEx (hCamera, &info, sizeof(info));
+    if (0 != gethostname (hostName, sizeof(hostName))) strcpy (hostName, "unknown");
+    hostName[sizeof(hostName)-1] = 0;
+
+    //
+    // Step 1
+    //      JSON
+    fileName = string(outputName) + ".json";
+    FILE* pFile = fopen (fileName.c_str(), "w");
+    if (NULL == pFile)
+    {
+        printf (" Error:  Could not create %s\n", fileName.c_str());
+        return false;
+    }
+    fprintf (pFile, "{\n");
+    fprintf (pFile, "  \"host\": \"%s\",\n", hostName);
+    fprintf (pFile, "  \"camera\": {\"model\": \"%s\", \"serial\": \"%s\", \"firmware\": \"%s\"},\n",
+             (char*)info.ModelName, (char*)info.SerialNumber, (char*)info.FirmwareVersion);
+    fprintf (pFile, "  \"duration\": %u,\n", duration);
+    fprintf (pFile, "  \"units\": \"milliseconds\",\n");
+    fprintf (pFile, "  \"runs\": [\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const RUN_RESULT& r = results[i];
+        fprintf (pFile, "    {\n");
+        fprintf (pFile, "      \"method\": \"%s\",\n", s_methodNames[r.method]);
+        fprintf (pFile, "      \"roi\": [%u, %u],\n", r.actual.roiWidth, r.actual.roiHeight);
+        fprintf (pFile, "      \"pixelFormat\": \"%s\",\n", pixelFormatName (r.actual.pixelFormat));
+        fprintf (pFile, "      \"frameRate\": %.3f,\n", r.actual.frameRate);
+        fprintf (pFile, "      \"rc\": %d,\n", r.rc);
+        fprintf (pFile, "      \"frames\": %u,\n", r.frames);
+        fprintf (pFile, "      \"rate\": %.3f,\n", r.rate);
+        fprintf (pFile, "      \"lostFrames\": %u,\n", r.lostFrames);
+        fprintf (pFile, "      \"failedGrabs\": %u,\n", r.failedGrabs);
+        fprintf (pFile, "      \"queueOverflows\": %u,\n", r.queueOverflows);
+        writeDistribution (pFile, "hostInterval", r.hostInterval, false);
+        writeDistribution (pFile, "cameraInterval", r.cameraInterval, METHOD_CALLBACK != r.method);
+        if (METHOD_CALLBACK == r.method) writeDistribution (pFile, "latency", r.latency, true);
+        fprintf (pFile, "    }%s\n", i + 1 < results.size() ? "," : "");
+    }
+    fprintf (pFile, "  ]\n}\n");
+    fclose (pFile);
+
+    //
+    // Step 2
+    //      CSV
+    fileName = string(outputName) + ".csv";
+    pFile = fopen (fileName.c_str(), "w");
+    if (NULL == pFile)
+    {
+        printf (" Error:  Could not create %s\n", fileName.c_str());
+        return false;
+    }
+    fprintf (pFile, "host,camera,serial,method,width,height,pixelFormat,frameRate,rc,frames,rate,lostFrames,failedGrabs,queueOverflows,"
+                    "intervalMean,intervalP50,intervalP99,intervalMax,cameraIntervalP50,cameraIntervalP99,cameraIntervalMax,"
+                    "latencyMean,latencyP50,latencyP99,latencyMax\n");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const RUN_RESULT& r = results[i];
+        fprintf (pFile, "%s,%s,%s,%s,%u,%u,%s,%.3f,%d,%u,%.3f,%u,%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f\n",
+                 hostName, (char*)info.ModelName, (char*)info.SerialNumber, s_methodNames[r.method],
+                 r.actual.roiWidth, r.actual.roiHeight, pixelFormatName (r.actual.pixelFormat), r.actual.frameRate,
+                 r.rc, r.frames, r.rate, r.lostFrames, r.failedGrabs, r.queueOverflows,
+                 r.hostInterval.mean, r.hostInterval.p50, r.hostInterval.p99, r.hostInterval.max,
+                 r.cameraInterval.p50, r.cameraInterval.p99, r.cameraInterval.max,
+                 r.latency.mean, r.latency.p50, r.latency.p99, r.latency.max);
+    }
+    fclose (pFile);
+
+    printf ("\n Results saved to %s.json and %s.csv\n", outputName, outputName);
+    return true;
+}
+
+void usage (char* argv[])
+{
+    printf("\n Measures the interval between frames (p50/p99/max), the callback to consumer latency,\n");
+    printf(" and frame loss, for PxLGetNextFrame and for CALLBACK_FRAME callbacks, over a sweep of\n");
+    printf(" camera configurations.\n\n");
+    printf("    Usage: %s [-t duration] [-m method] [-r roi_list] [-p format_list] [-f rate_list] output_name\n", argv[0]);
+    printf("       where: \n");
+    printf("          -t duration     How long to measure each configuration and method (in seconds).\n");
+    printf("                          The default is %d seconds\n", DEFAULT_RUN_DURATION);
+    printf("          -m method       One of 'grab', 'callback' or 'both'.  The default is both\n");
+    printf("          -r roi_list     A comma separated list of (centered) ROIs, as widthxheight\n");
+    printf("          -p format_list  A comma separated list of pixel formats:\n");
+    printf("                             ");
+    for (U32 i = 0; i < NUM_PIXEL_FORMATS; i++) printf ("%s%s", s_pixelFormats[i].name, i+1 < NUM_PIXEL_FORMATS ? ", " : "\n");
+    printf("          -f rate_list    A comma separated list of frame rates (frames/second)\n");
+    printf("          output_name     The results are saved to output_name.json and output_name.csv\n");
+    printf("       A setting that isn't swept is left as the camera has it.\n");
+    printf("    Example: \n");
+    printf("        %s -r 640x480,1280x1024 -p mono8,mono16 -f 30,60 board1 \n", argv[0]);
+    printf("              Measures each of the 8 combinations, with both methods, for %d seconds each\n", DEFAULT_RUN_DURATION);
+}
+
+int getParameters (int argc, char* argv[], USER_PARAMETERS* pParms)
+{
+    //
+    // Step 1
+    //      Defaults, and a simple parameter check
+    pParms->duration = DEFAULT_RUN_DURATION;
+    pParms->methods[METHOD_GET_NEXT_FRAME] = true;
+    pParms->methods[METHOD_CALLBACK] = true;
+    pParms->outputName = NULL;
+
+    if (argc < 2 ||   // Must have at least the output name
+        argc > 12)    // Only 5 options allowed
+    {
+        printf ("\n ERROR -- Incorrect number of parameters\n");
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 2
+    //      Parse the command line looking for the optional parameters.
+    for (int i=1; i<argc-1; i++)
+    {
+        if (i+1 >= argc-1 && argv[i][0] == '-') return GENERAL_ERROR;  // every option has a value
+        if (!strcmp(argv[i],"-t") ||
+            !strcmp(argv[i],"-T"))
+        {
+            int parm = atoi(argv[i+1]);
+            if (parm < 1) return  GENERAL_ERROR;
+            pParms->duration = (U32) parm;
+        } else if (!strcmp(argv[i],"-m") ||
+                   !strcmp(argv[i],"-M")) {
+            pParms->methods[METHOD_GET_NEXT_FRAME] = !strcmp(argv[i+1],"grab") || !strcmp(argv[i+1],"both");
+            pParms->methods[METHOD_CALLBACK] = !strcmp(argv[i+1],"callback") || !strcmp(argv[i+1],"both");
+            if (!pParms->methods[METHOD_GET_NEXT_FRAME] && !pParms->methods[METHOD_CALLBACK]) return GENERAL_ERROR;
+        } else if (!strcmp(argv[i],"-r") ||
+                   !strcmp(argv[i],"-R")) {
+            for (char* pRoi = strtok (argv[i+1], ","); pRoi; pRoi = strtok (NULL, ","))
+            {
+                U32 width, height;
+                if (2 != sscanf (pRoi, "%ux%u", &width, &height) || width < 1 || height < 1) return GENERAL_ERROR;
+                pParms->roiWidths.push_back (width);
+                pParms->roiHeights.push_back (height);
+            }
+        } else if (!strcmp(argv[i],"-p") ||
+                   !strcmp(argv[i],"-P")) {
+            for (char* pFormat = strtok (argv[i+1], ","); pFormat; pFormat = strtok (NULL, ","))
+            {
+                U32 j;
+                for (j = 0; j < NUM_PIXEL_FORMATS; j++)
+                {
+                    if (!strcasecmp (pFormat, s_pixelFormats[j].name)) break;
+                }
+                if (j >= NUM_PIXEL_FORMATS) return GENERAL_ERROR;
+                pParms->pixelFormats.push_back (s_pixelFormats[j].pixelFormat);
+            }
+        } else if (!strcmp(argv[i],"-f") ||
+                   !strcmp(argv[i],"-F")) {
+            for (char* pRate = strtok (argv[i+1], ","); pRate; pRate = strtok (NULL, ","))
+            {
+                float rate = (float)atof (pRate);
+                if (rate <= 0.0f) return GENERAL_ERROR;
+                pParms->frameRates.push_back (rate);
+            }
+        } else {
+            return GENERAL_ERROR;
+        }
+        i++;
+    }
+
+    //
+    // Step 3
+    //      The last parameter must be the output name, and the sweep can't be too big
+    if (argv[argc-1][0] == '-') return GENERAL_ERROR;
+    pParms->outputName = argv[argc-1];
+    if (pParms->roiWidths.size() > MAX_SWEEP_VALUES ||
+        pParms->pixelFormats.size() > MAX_SWEEP_VALUES ||
+        pParms->frameRates.size() > MAX_SWEEP_VALUES) return GENERAL_ERROR;
+
+    return A_OK;
+}
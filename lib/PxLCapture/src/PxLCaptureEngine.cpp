@@ -0,0 +1,423 @@
+/***************************************************************************
+ *
+ *     File: PxLCaptureEngine.cpp
+ *
+ *     Description:
+ *       Parallel capture from every camera, merged into one timestamp
+ *       ordered queue.  See PxLCaptureEngine.h.
+ *
+ */
+
+#include <assert.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <sched.h>
+#include "PxLCaptureEngine.h"
+#include "PxLRecording.h"
+
+#define CLOCK_DRIFT     0.001   // How fast (per frame) a camera's clock offset may creep up; see acquire()
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+// The bytes a frame from the camera needs, with its current settings; 0 if they can't be read
+static U32 frameBufferSize (HANDLE hCamera)
+{
+    FRAME_DESC frameDesc;
+    float parms[FEATURE_ROI_NUM_PARAMS > FEATURE_PIXEL_ADDRESSING_NUM_PARAMS ? FEATURE_ROI_NUM_PARAMS : FEATURE_PIXEL_ADDRESSING_NUM_PARAMS];
+    float pixelFormat;
+    U32 flags;
+    U32 numParams;
+
+    memset (&frameDesc, 0, sizeof(frameDesc));
+    numParams = FEATURE_ROI_NUM_PARAMS;
+    if (!API_SUCCESS (PxLGetFeature (hCamera, FEATURE_ROI, &flags, &numParams, parms))) return 0;
+    frameDesc.Roi.fWidth = parms[FEATURE_ROI_PARAM_WIDTH];
+    frameDesc.Roi.fHeight = parms[FEATURE_ROI_PARAM_HEIGHT];
+
+    frameDesc.PixelAddressingValue.fHorizontal = frameDesc.PixelAddressingValue.fVertical = 1.0f;
+    numParams = FEATURE_PIXEL_ADDRESSING_NUM_PARAMS;
+    if (API_SUCCESS (PxLGetFeature (hCamera, FEATURE_PIXEL_ADDRESSING, &flags, &numParams, parms)))
+    {
+        frameDesc.PixelAddressingValue.fHorizontal = parms[FEATURE_PIXEL_ADDRESSING_PARAM_VALUE];
+        frameDesc.PixelAddressingValue.fVertical = parms[FEATURE_PIXEL_ADDRESSING_PARAM_VALUE];
+        if (numParams > FEATURE_PIXEL_ADDRESSING_PARAM_Y_VALUE)
+        {
+            frameDesc.PixelAddressingValue.fHorizontal = parms[FEATURE_PIXEL_ADDRESSING_PARAM_X_VALUE];
+            frameDesc.PixelAddressingValue.fVertical = parms[FEATURE_PIXEL_ADDRESSING_PARAM_Y_VALUE];
+        }
+    }
+
+    numParams = 1;
+    if (!API_SUCCESS (PxLGetFeature (hCamera, FEATURE_PIXEL_FORMAT, &flags, &numParams, &pixelFormat))) return 0;
+
+    U32 size = pxlRecordingFrameSize ((U32)pixelFormat, &frameDesc);
+    // A format we don't know the size of; allow for the largest there is (RGB48)
+    if (0 == size) size = (U32)(frameDesc.Roi.fWidth * frameDesc.Roi.fHeight * 6.0f);
+    return size;
+}
+
+PxLCaptureEngine::PxLCaptureEngine (U32 buffersPerCamera, double mergeWindow)
+: m_buffersPerCamera(buffersPerCamera ? buffersPerCamera : 1)
+, m_mergeWindow(mergeWindow)
+, m_stop(false)
+, m_started(false)
+{
+    pthread_mutex_init (&m_mutex, NULL);
+    pthread_condattr_t attr;
+    pthread_condattr_init (&attr);
+    pthread_condattr_setclock (&attr, CLOCK_MONOTONIC);
+    pthread_cond_init (&m_cond, &attr);
+    pthread_condattr_destroy (&attr);
+}
+
+PxLCaptureEngine::~PxLCaptureEngine ()
+{
+    close();
+    pthread_cond_destroy (&m_cond);
+    pthread_mutex_destroy (&m_mutex);
+}
+
+PXL_RETURN_CODE PxLCaptureEngine::open ()
+{
+    close();
+
+    //
+    // Step 1
+    //      Find the cameras
+    U32 numCameras = 0;
+    PXL_RETURN_CODE rc = PxLGetNumberCamerasEx (NULL, &numCameras);
+    if (!API_SUCCESS (rc)) return rc;
+    if (0 == numCameras) return ApiNoCameraError;
+
+    std::vector<CAMERA_ID_INFO> ids (numCameras);
+    for (U32 i = 0; i < numCameras; i++)
+    {
+        memset (&ids[i], 0, sizeof(CAMERA_ID_INFO));
+        ids[i].StructSize = sizeof(CAMERA_ID_INFO);
+    }
+    rc = PxLGetNumberCamerasEx (&ids[0], &numCameras);
+    if (!API_SUCCESS (rc)) return rc;
+
+    //
+    // Step 2
+    //      Open each of them.  By default, spread the acquisition threads over the CPUs we may use, other than the
+    //      first (for the consumer).
+    cpu_set_t cpus;
+    std::vector<int> allowed;
+    if (0 == sched_getaffinity (0, sizeof(cpus), &cpus))
+    {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) if (CPU_ISSET (cpu, &cpus)) allowed.push_back (cpu);
+    }
+
+    for (U32 i = 0; i < numCameras && i < ids.size(); i++)
+    {
+        HANDLE hCamera;
+        rc = PxLInitializeEx (ids[i].CameraSerialNum, &hCamera, 0);
+        if (!API_SUCCESS (rc))
+        {
+            close();
+            return rc;
+        }
+        Camera* pCamera = new Camera();
+        pCamera->m_pEngine = this;
+        pCamera->m_index = (U32)m_cameras.size();
+        pCamera->m_hCamera = hCamera;
+        pCamera->m_serialNumber = ids[i].CameraSerialNum;
+        pCamera->m_cpu = allowed.size() > 1 ? allowed[1 + pCamera->m_index % (allowed.size() - 1)] : PXL_CAPTURE_ANY_CPU;
+        pCamera->m_running = false;
+        pCamera->m_held = 0;
+        m_cameras.push_back (pCamera);
+    }
+
+    return ApiSuccess;
+}
+
+void PxLCaptureEngine::close ()
+{
+    stop();
+    for (size_t i = 0; i < m_cameras.size(); i++)
+    {
+        PxLUninitialize (m_cameras[i]->m_hCamera);
+        delete m_cameras[i];
+    }
+    m_cameras.clear();
+}
+
+void PxLCaptureEngine::setAffinity (U32 i, int cpu)
+{
+    assert (i < m_cameras.size());
+    m_cameras[i]->m_cpu = cpu;
+}
+
+PXL_RETURN_CODE PxLCaptureEngine::start ()
+{
+    if (m_started) return ApiSuccessAlreadyRunning;
+    if (m_cameras.empty()) return ApiNoCameraError;
+
+    // The consumer still has frames from the last start; their buffers can't be reallocated from under it
+    pthread_mutex_lock (&m_mutex);
+    bool held = false;
+    for (size_t i = 0; i < m_cameras.size(); i++) held = held || m_cameras[i]->m_held;
+    pthread_mutex_unlock (&m_mutex);
+    if (held) return ApiFrameInUseError;
+
+    m_stop = false;
+    PXL_RETURN_CODE rc = ApiSuccess;
+    for (size_t i = 0; i < m_cameras.size() && API_SUCCESS (rc); i++)
+    {
+        Camera* pCamera = m_cameras[i];
+
+        //
+        // Step 1
+        //      The camera's pool of buffers, sized for its current settings
+        U32 size = frameBufferSize (pCamera->m_hCamera);
+        if (0 == size)
+        {
+            rc = ApiInvalidParameterError;
+            break;
+        }
+        pCamera->m_data.assign ((size_t)size * m_buffersPerCamera, 0);
+        pCamera->m_scratch.assign (size, 0);
+        pCamera->m_frames.assign (m_buffersPerCamera, PXL_CAPTURED_FRAME());
+        pCamera->m_free.clear();
+        pCamera->m_queue.clear();
+        for (U32 b = 0; b < m_buffersPerCamera; b++)
+        {
+            PXL_CAPTURED_FRAME* pFrame = &pCamera->m_frames[b];
+            memset (pFrame, 0, sizeof(*pFrame));
+            pFrame->camera = pCamera->m_index;
+            pFrame->serialNumber = pCamera->m_serialNumber;
+            pFrame->pData = &pCamera->m_data[(size_t)size * b];
+            pFrame->size = size;
+            pCamera->m_free.push_back (pFrame);
+        }
+        pCamera->m_haveFrame = false;
+        pCamera->m_lastTimestamp = 0.0;
+        pCamera->m_clockOffset = 0.0;
+        memset (&pCamera->m_stats, 0, sizeof(pCamera->m_stats));
+
+        //
+        // Step 2
+        //      Stream, and take the frames, on a thread of its own
+        rc = PxLSetStreamState (pCamera->m_hCamera, START_STREAM);
+        if (!API_SUCCESS (rc)) break;
+        if (0 != pthread_create (&pCamera->m_thread, NULL, acquisitionThread, pCamera))
+        {
+            PxLSetStreamState (pCamera->m_hCamera, STOP_STREAM);
+            rc = ApiOutOfMemoryError;
+            break;
+        }
+        pCamera->m_running = true;
+        if (PXL_CAPTURE_ANY_CPU != pCamera->m_cpu)
+        {
+            cpu_set_t cpus;
+            CPU_ZERO (&cpus);
+            CPU_SET (pCamera->m_cpu, &cpus);
+            pthread_setaffinity_np (pCamera->m_thread, sizeof(cpus), &cpus);   // Best effort
+        }
+    }
+
+    m_started = true;
+    if (!API_SUCCESS (rc)) stop();
+    return rc;
+}
+
+void PxLCaptureEngine::stop ()
+{
+    if (!m_started) return;
+
+    // Stopping the streams ends any PxLGetNextFrame the threads are waiting in
+    m_stop = true;
+    for (size_t i = 0; i < m_cameras.size(); i++)
+    {
+        if (m_cameras[i]->m_running) PxLSetStreamState (m_cameras[i]->m_hCamera, STOP_STREAM);
+    }
+    pthread_mutex_lock (&m_mutex);
+    pthread_cond_broadcast (&m_cond);
+    pthread_mutex_unlock (&m_mutex);
+    for (size_t i = 0; i < m_cameras.size(); i++)
+    {
+        if (!m_cameras[i]->m_running) continue;
+        pthread_join (m_cameras[i]->m_thread, NULL);
+        m_cameras[i]->m_running = false;
+    }
+    m_started = false;
+}
+
+void* PxLCaptureEngine::acquisitionThread (void* pContext)
+{
+    Camera* pCamera = (Camera*)pContext;
+    pCamera->m_pEngine->acquire (pCamera);
+    return NULL;
+}
+
+//
+// The body of a camera's acquisition thread:  frames, as fast as the camera makes them, into the camera's pool
+//
+void PxLCaptureEngine::acquire (Camera* pCamera)
+{
+    while (!m_stop)
+    {
+        //
+        // Step 1
+        //      A free buffer, or if the consumer has them all, the scratch buffer (the frame is dropped)
+        pthread_mutex_lock (&m_mutex);
+        PXL_CAPTURED_FRAME* pFrame = NULL;
+        if (!pCamera->m_free.empty())
+        {
+            pFrame = pCamera->m_free.back();
+            pCamera->m_free.pop_back();
+        }
+        pthread_mutex_unlock (&m_mutex);
+
+        FRAME_DESC frameDesc;
+        memset (&frameDesc, 0, sizeof(frameDesc));
+        frameDesc.uSize = sizeof(frameDesc);
+        U8* pData = pFrame ? pFrame->pData : &pCamera->m_scratch[0];
+        PXL_RETURN_CODE rc = PxLGetNextFrame (pCamera->m_hCamera, (U32)pCamera->m_scratch.size(), pData, &frameDesc);
+        double received = now();
+
+        //
+        // Step 2
+        //      Map the camera's frame time onto our clock.  The offset is the least (host - camera) time seen, which
+        //      is the one with the least delivery latency in it.  It may creep up slowly, as the two clocks drift.
+        pthread_mutex_lock (&m_mutex);
+        if (!API_SUCCESS (rc))
+        {
+            if (pFrame) pCamera->m_free.push_back (pFrame);
+            if (!m_stop) pCamera->m_stats.errors++;
+            pthread_mutex_unlock (&m_mutex);
+            continue;
+        }
+
+        double timestamp = received;
+        if (frameDesc.fFrameTime > 0.0f)
+        {
+            double offset = received - (double)frameDesc.fFrameTime;
+            if (!pCamera->m_haveFrame || offset < pCamera->m_clockOffset)
+            {
+                pCamera->m_clockOffset = offset;
+            } else {
+                pCamera->m_clockOffset += (offset - pCamera->m_clockOffset) * CLOCK_DRIFT;
+            }
+            timestamp = (double)frameDesc.fFrameTime + pCamera->m_clockOffset;
+        }
+        if (pCamera->m_haveFrame)
+        {
+            if (frameDesc.uFrameNumber > pCamera->m_lastFrameNumber + 1)
+            {
+                pCamera->m_stats.lost += frameDesc.uFrameNumber - pCamera->m_lastFrameNumber - 1;
+            }
+            if (timestamp < pCamera->m_lastTimestamp) timestamp = pCamera->m_lastTimestamp;   // Keep each camera in order
+        }
+        pCamera->m_haveFrame = true;
+        pCamera->m_lastFrameNumber = frameDesc.uFrameNumber;
+        pCamera->m_lastTimestamp = timestamp;
+
+        //
+        // Step 3
+        //      Queue it for the consumer
+        if (pFrame)
+        {
+            pFrame->frameDesc = frameDesc;
+            pFrame->pixelFormat = (U32)frameDesc.PixelFormat.fValue;
+            pFrame->timestamp = timestamp;
+            pCamera->m_queue.push_back (pFrame);
+            pCamera->m_stats.frames++;
+        } else {
+            pCamera->m_stats.dropped++;
+        }
+        pthread_cond_broadcast (&m_cond);
+        pthread_mutex_unlock (&m_mutex);
+    }
+}
+
+//
+// Whether a frame (the earliest queued) can be handed out:  no other camera can still deliver an earlier one, or
+// it has waited long enough for them.  Called with m_mutex held.
+//
+bool PxLCaptureEngine::releasable (const PXL_CAPTURED_FRAME* pFrame, double now) const
+{
+    if (now - pFrame->timestamp >= m_mergeWindow) return true;
+    for (size_t i = 0; i < m_cameras.size(); i++)
+    {
+        const Camera* pCamera = m_cameras[i];
+        if (i == pFrame->camera || !pCamera->m_queue.empty()) continue;   // Its next frame is later than pFrame
+        if (pCamera->m_lastTimestamp < pFrame->timestamp) return false;    // Its next frame might be earlier
+    }
+    return true;
+}
+
+PXL_CAPTURED_FRAME* PxLCaptureEngine::nextFrame (double timeout)
+{
+    double deadline = now() + timeout;
+
+    pthread_mutex_lock (&m_mutex);
+    PXL_CAPTURED_FRAME* pNext = NULL;
+    while (true)
+    {
+        //
+        // Step 1
+        //      The earliest frame queued, from any camera
+        Camera* pEarliest = NULL;
+        for (size_t i = 0; i < m_cameras.size(); i++)
+        {
+            Camera* pCamera = m_cameras[i];
+            if (pCamera->m_queue.empty()) continue;
+            if (NULL == pEarliest || pCamera->m_queue.front()->timestamp < pEarliest->m_queue.front()->timestamp) pEarliest = pCamera;
+        }
+
+        double time = now();
+        if (pEarliest && (releasable (pEarliest->m_queue.front(), time) || !m_started))
+        {
+            pNext = pEarliest->m_queue.front();
+            pEarliest->m_queue.pop_front();
+            pEarliest->m_held++;
+            break;
+        }
+        if (time >= deadline || m_stop) break;
+
+        //
+        // Step 2
+        //      Wait for more frames, or for the earliest to have waited long enough
+        double wake = deadline;
+        if (pEarliest && pEarliest->m_queue.front()->timestamp + m_mergeWindow < wake) wake = pEarliest->m_queue.front()->timestamp + m_mergeWindow;
+        struct timespec ts;
+        ts.tv_sec = (time_t)wake;
+        ts.tv_nsec = (long)((wake - (double)ts.tv_sec) * 1.0e9);
+        int err = pthread_cond_timedwait (&m_cond, &m_mutex, &ts);
+        if (err && ETIMEDOUT != err) break;
+    }
+    pthread_mutex_unlock (&m_mutex);
+
+    return pNext;
+}
+
+void PxLCaptureEngine::release (PXL_CAPTURED_FRAME* pFrame)
+{
+    if (NULL == pFrame) return;
+    assert (pFrame->camera < m_cameras.size());
+
+    pthread_mutex_lock (&m_mutex);
+    Camera* pCamera = m_cameras[pFrame->camera];
+    assert (pCamera->m_held > 0);
+    pCamera->m_held--;
+    pCamera->m_free.push_back (pFrame);
+    pthread_mutex_unlock (&m_mutex);
+}
+
+PXL_CAPTURE_STATS PxLCaptureEngine::stats (U32 i)
+{
+    assert (i < m_cameras.size());
+
+    pthread_mutex_lock (&m_mutex);
+    PXL_CAPTURE_STATS stats = m_cameras[i]->m_stats;
+    pthread_mutex_unlock (&m_mutex);
+    return stats;
+}
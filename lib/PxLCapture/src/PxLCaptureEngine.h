@@ -0,0 +1,124 @@
+/***************************************************************************
+ *
+ *     File: PxLCaptureEngine.h
+ *
+ *     Description:
+ *       Captures from every PixeLINK camera on the system at once.  Each
+ *       camera gets an acquisition thread of its own, pinned to a CPU, that
+ *       does nothing but PxLGetNextFrame into the camera's own pool of
+ *       buffers.  So a slow camera, or a second camera, doesn't hold up the
+ *       others, the way it does when one thread takes frames from each
+ *       camera in turn.
+ *
+ *       Frames from all the cameras come out of a single queue, in timestamp
+ *       order.  Each camera's frame times (FRAME_DESC::fFrameTime, on the
+ *       camera's own clock) are mapped onto the host's monotonic clock, so
+ *       frames from different cameras can be compared.  A frame is handed
+ *       out once no other camera can still deliver an earlier one, or once
+ *       it has waited the merge window for them.
+ *
+ *       The consumer must release() each frame it is given, which returns
+ *       the buffer to its camera's pool.  If the consumer falls behind, and
+ *       a camera's pool runs dry, that camera's frames are dropped (and
+ *       counted), rather than the camera being held up.
+ */
+
+#if !defined(PIXELINK_PXLCAPTUREENGINE_H)
+#define PIXELINK_PXLCAPTUREENGINE_H
+
+#include <pthread.h>
+#include <deque>
+#include <vector>
+#include "PixeLINKApi.h"
+
+#define PXL_CAPTURE_DEFAULT_BUFFERS   8       // Per camera
+#define PXL_CAPTURE_MERGE_WINDOW      0.1     // Seconds a frame waits for the other cameras' earlier frames
+#define PXL_CAPTURE_ANY_CPU           -1
+
+// A frame, as handed to the consumer
+typedef struct _PXL_CAPTURED_FRAME
+{
+    U32        camera;          // Index of the camera, 0 .. cameraCount()-1
+    U32        serialNumber;
+    U8*        pData;
+    U32        size;            // Bytes of frame data
+    U32        pixelFormat;
+    double     timestamp;       // When the frame was exposed, on the host's monotonic clock (seconds)
+    FRAME_DESC frameDesc;
+} PXL_CAPTURED_FRAME;
+
+typedef struct _PXL_CAPTURE_STATS
+{
+    U64 frames;                 // Frames queued for the consumer
+    U64 lost;                   // Frames the camera numbered, that never reached us
+    U64 dropped;                // Frames we received, but had no free buffer for
+    U64 errors;                 // PxLGetNextFrame failures
+} PXL_CAPTURE_STATS;
+
+class PxLCaptureEngine
+{
+public:
+    PxLCaptureEngine (U32 buffersPerCamera = PXL_CAPTURE_DEFAULT_BUFFERS, double mergeWindow = PXL_CAPTURE_MERGE_WINDOW);
+    ~PxLCaptureEngine ();
+
+    // Finds, and opens, every camera (PxLGetNumberCamerasEx)
+    PXL_RETURN_CODE open ();
+    void close ();
+
+    U32    cameraCount () const { return (U32)m_cameras.size(); }
+    HANDLE camera (U32 i) const { return m_cameras[i]->m_hCamera; }
+    U32    serialNumber (U32 i) const { return m_cameras[i]->m_serialNumber; }
+
+    // Pins camera i's acquisition thread to a CPU (PXL_CAPTURE_ANY_CPU for none).  By default, the cameras are
+    // spread over the CPUs we may run on, leaving the first for the consumer.  Takes effect at start().
+    void   setAffinity (U32 i, int cpu);
+
+    // Starts every camera streaming, and its acquisition thread.  The cameras' settings can't be changed while
+    // started; the buffers are sized for them.  As the buffers are reallocated, every frame from an earlier start
+    // must have been released; if not, returns ApiFrameInUseError.
+    PXL_RETURN_CODE start ();
+    void   stop ();
+
+    // The next frame, in timestamp order; NULL if there is none within timeout seconds
+    PXL_CAPTURED_FRAME* nextFrame (double timeout);
+    void   release (PXL_CAPTURED_FRAME* pFrame);
+
+    PXL_CAPTURE_STATS stats (U32 i);
+
+private:
+    struct Camera
+    {
+        PxLCaptureEngine* m_pEngine;
+        U32         m_index;
+        HANDLE      m_hCamera;
+        U32         m_serialNumber;
+        int         m_cpu;
+        pthread_t   m_thread;
+        bool        m_running;        // The thread was started
+        std::vector<PXL_CAPTURED_FRAME> m_frames;
+        std::vector<U8>                 m_data;       // All of the frames' buffers
+        std::vector<PXL_CAPTURED_FRAME*> m_free;
+        U32                              m_held;      // Handed to the consumer, and not yet released
+        std::deque<PXL_CAPTURED_FRAME*>  m_queue;     // Waiting for the consumer, oldest first
+        std::vector<U8>                 m_scratch;    // Where frames go to be dropped
+        bool        m_haveFrame;
+        U32         m_lastFrameNumber;
+        double      m_lastTimestamp;  // Of the newest frame received
+        double      m_clockOffset;    // Host time - camera time
+        PXL_CAPTURE_STATS m_stats;
+    };
+
+    static void* acquisitionThread (void* pContext);
+    void   acquire (Camera* pCamera);
+    bool   releasable (const PXL_CAPTURED_FRAME* pFrame, double now) const;
+
+    U32             m_buffersPerCamera;
+    double          m_mergeWindow;
+    std::vector<Camera*> m_cameras;
+    pthread_mutex_t m_mutex;          // Guards the pools, queues, and stats
+    pthread_cond_t  m_cond;           // Signalled as frames are queued
+    volatile bool   m_stop;
+    bool            m_started;
+};
+
+#endif // !defined(PIXELINK_PXLCAPTUREENGINE_H)
@@ -0,0 +1,250 @@
+/***************************************************************************
+ *
+ *     File: pxlcapture.cpp
+ *
+ *     Description:
+ *       Captures from every camera at once, with PxLCaptureEngine, for a
+ *       while, and reports each camera's frame rate, and frames lost and
+ *       dropped.  It checks that the merged frames come out in timestamp
+ *       order.
+ *
+ *       With -s, it instead takes frames the way a single control thread
+ *       would:  from each camera in turn.  Comparing the two shows what the
+ *       per-camera threads buy, as cameras are added.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "PxLCaptureEngine.h"
+
+#define A_OK            0  // non-zero error codes
+#define GENERAL_ERROR   1
+
+#define DEFAULT_RUN_DURATION   10      // in seconds
+
+typedef struct _USER_PARAMETERS
+{
+    U32  duration;
+    U32  buffersPerCamera;
+    bool sequential;
+    std::vector<int> cpus;   // Per camera; empty for the default
+} USER_PARAMETERS;
+
+static void usage (char** argv);
+static int  getParameters (int argc, char* argv[], USER_PARAMETERS* pParms);
+static int  captureParallel (PxLCaptureEngine& engine, const USER_PARAMETERS& parms);
+static int  captureSequential (PxLCaptureEngine& engine, const USER_PARAMETERS& parms);
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+int main (int argc, char* argv[])
+{
+    USER_PARAMETERS parms;
+
+    //
+    // Step 1
+    //      Validate the user parameters
+    if (A_OK != getParameters (argc, argv, &parms))
+    {
+        usage (argv);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 2
+    //      Find the cameras
+    PxLCaptureEngine engine (parms.buffersPerCamera);
+    PXL_RETURN_CODE rc = engine.open();
+    if (!API_SUCCESS (rc))
+    {
+        printf (" Error:  Could not open the cameras (0x%08X)\n", rc);
+        return GENERAL_ERROR;
+    }
+    printf ("\n %u camera(s):", engine.cameraCount());
+    for (U32 i = 0; i < engine.cameraCount(); i++) printf (" %u", engine.serialNumber (i));
+    printf ("\n");
+
+    //
+    // Step 3
+    //      Capture
+    int result = parms.sequential ? captureSequential (engine, parms) : captureParallel (engine, parms);
+    engine.close();
+    return result;
+}
+
+static void usage (char** argv)
+{
+    printf ("\n Captures from every camera at once, and reports each camera's frame rate\n\n");
+    printf ("    Usage: %s [-t duration] [-b buffers] [-c cpu_list] [-s]\n", argv[0]);
+    printf ("       where: \n");
+    printf ("          -t duration  How long to capture for (in seconds).  The default is %d seconds\n", DEFAULT_RUN_DURATION);
+    printf ("          -b buffers   Buffers in each camera's pool.  The default is %d\n", PXL_CAPTURE_DEFAULT_BUFFERS);
+    printf ("          -c cpu_list  A comma separated list of the CPU to pin each camera's thread to (-1 for\n");
+    printf ("                       none).  By default, the cameras are spread over the CPUs, other than the first\n");
+    printf ("          -s           Take frames from each camera in turn, from one thread, instead\n");
+    printf ("    Example: \n");
+    printf ("        %s -t 30 -c 2,3 \n", argv[0]);
+}
+
+static int getParameters (int argc, char* argv[], USER_PARAMETERS* pParms)
+{
+    //
+    // Step 1
+    //      Set our defaults
+    pParms->duration = DEFAULT_RUN_DURATION;
+    pParms->buffersPerCamera = PXL_CAPTURE_DEFAULT_BUFFERS;
+    pParms->sequential = false;
+    pParms->cpus.clear();
+
+    //
+    // Step 2
+    //      Parse the command line
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp (argv[i], "-s") || !strcmp (argv[i], "-S"))
+        {
+            pParms->sequential = true;
+            continue;
+        }
+        if (i + 1 >= argc) return GENERAL_ERROR;
+        if (!strcmp (argv[i], "-t") || !strcmp (argv[i], "-T"))
+        {
+            int parm = atoi (argv[++i]);
+            if (parm < 1) return GENERAL_ERROR;
+            pParms->duration = (U32)parm;
+        } else if (!strcmp (argv[i], "-b") || !strcmp (argv[i], "-B")) {
+            int parm = atoi (argv[++i]);
+            if (parm < 1) return GENERAL_ERROR;
+            pParms->buffersPerCamera = (U32)parm;
+        } else if (!strcmp (argv[i], "-c") || !strcmp (argv[i], "-C")) {
+            char* pList = argv[++i];
+            for (char* pCpu = strtok (pList, ","); pCpu; pCpu = strtok (NULL, ","))
+            {
+                int cpu = atoi (pCpu);
+                if (cpu < PXL_CAPTURE_ANY_CPU) return GENERAL_ERROR;
+                pParms->cpus.push_back (cpu);
+            }
+        } else {
+            return GENERAL_ERROR;
+        }
+    }
+
+    return A_OK;
+}
+
+static int captureParallel (PxLCaptureEngine& engine, const USER_PARAMETERS& parms)
+{
+    //
+    // Step 1
+    //      Start every camera, on its own thread
+    for (U32 i = 0; i < engine.cameraCount() && i < parms.cpus.size(); i++) engine.setAffinity (i, parms.cpus[i]);
+    PXL_RETURN_CODE rc = engine.start();
+    if (!API_SUCCESS (rc))
+    {
+        printf (" Error:  Could not start the cameras (0x%08X)\n", rc);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 2
+    //      Consume the merged frames, checking their order
+    U64 frames = 0;
+    U64 outOfOrder = 0;
+    double lastTimestamp = 0.0;
+    double start = now();
+    while (now() - start < (double)parms.duration)
+    {
+        PXL_CAPTURED_FRAME* pFrame = engine.nextFrame (1.0);
+        if (NULL == pFrame) continue;
+        if (pFrame->timestamp < lastTimestamp) outOfOrder++;
+        lastTimestamp = pFrame->timestamp;
+        frames++;
+        engine.release (pFrame);
+    }
+    double elapsed = now() - start;
+    engine.stop();
+
+    //
+    // Step 3
+    //      Report
+    printf ("\n Per-camera threads, %.1f seconds:\n", elapsed);
+    printf ("  %10s %10s %10s %8s %8s %8s\n", "camera", "frames", "frames/s", "lost", "dropped", "errors");
+    for (U32 i = 0; i < engine.cameraCount(); i++)
+    {
+        PXL_CAPTURE_STATS stats = engine.stats (i);
+        printf ("  %10u %10llu %10.2f %8llu %8llu %8llu\n", engine.serialNumber (i), (unsigned long long)stats.frames,
+                (double)stats.frames / elapsed, (unsigned long long)stats.lost, (unsigned long long)stats.dropped,
+                (unsigned long long)stats.errors);
+    }
+    printf ("  %llu frames merged, %llu out of timestamp order\n", (unsigned long long)frames, (unsigned long long)outOfOrder);
+
+    return A_OK;
+}
+
+static int captureSequential (PxLCaptureEngine& engine, const USER_PARAMETERS& parms)
+{
+    U32 numCameras = engine.cameraCount();
+    std::vector<std::vector<U8> > buffers (numCameras);
+    std::vector<U64> frames (numCameras, 0);
+    std::vector<U64> lost (numCameras, 0);
+    std::vector<U32> lastFrameNumber (numCameras, 0);
+
+    //
+    // Step 1
+    //      Start every camera; one buffer each, big enough for any frame the sensor can make
+    for (U32 i = 0; i < numCameras; i++)
+    {
+        float parms[FEATURE_ROI_NUM_PARAMS] = {0.0f, 0.0f, 4096.0f, 4096.0f};
+        U32 flags;
+        U32 numParams = FEATURE_ROI_NUM_PARAMS;
+        PxLGetFeature (engine.camera (i), FEATURE_ROI, &flags, &numParams, parms);
+        buffers[i].assign ((size_t)(parms[FEATURE_ROI_PARAM_WIDTH] * parms[FEATURE_ROI_PARAM_HEIGHT] * 6.0f), 0);
+        PXL_RETURN_CODE rc = PxLSetStreamState (engine.camera (i), START_STREAM);
+        if (!API_SUCCESS (rc))
+        {
+            printf (" Error:  Could not start camera %u (0x%08X)\n", engine.serialNumber (i), rc);
+            return GENERAL_ERROR;
+        }
+    }
+
+    //
+    // Step 2
+    //      Take a frame from each in turn
+    double start = now();
+    while (now() - start < (double)parms.duration)
+    {
+        for (U32 i = 0; i < numCameras; i++)
+        {
+            FRAME_DESC frameDesc;
+            frameDesc.uSize = sizeof(frameDesc);
+            if (!API_SUCCESS (PxLGetNextFrame (engine.camera (i), (U32)buffers[i].size(), &buffers[i][0], &frameDesc))) continue;
+            if (frames[i] && frameDesc.uFrameNumber > lastFrameNumber[i] + 1) lost[i] += frameDesc.uFrameNumber - lastFrameNumber[i] - 1;
+            lastFrameNumber[i] = frameDesc.uFrameNumber;
+            frames[i]++;
+        }
+    }
+    double elapsed = now() - start;
+    for (U32 i = 0; i < numCameras; i++) PxLSetStreamState (engine.camera (i), STOP_STREAM);
+
+    //
+    // Step 3
+    //      Report
+    printf ("\n One thread, cameras in turn, %.1f seconds:\n", elapsed);
+    printf ("  %10s %10s %10s %8s\n", "camera", "frames", "frames/s", "lost");
+    for (U32 i = 0; i < numCameras; i++)
+    {
+        printf ("  %10u %10llu %10.2f %8llu\n", engine.serialNumber (i), (unsigned long long)frames[i],
+                (double)frames[i] / elapsed, (unsigned long long)lost[i]);
+    }
+
+    return A_OK;
+}
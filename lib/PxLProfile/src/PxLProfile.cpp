@@ -0,0 +1,510 @@
+/***************************************************************************
+ *
+ *     File: PxLProfile.cpp
+ *
+ *     Description:
+ *       The feature description cache, and settings profiles.  See
+ *       PxLProfile.h.
+ *
+ */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include "PxLProfile.h"
+
+#define MAX_LINE    1024
+
+// Features that limit others are set first, and those they limit, last; the rest go in between
+static const U32 s_setFirst[] = {FEATURE_PIXEL_ADDRESSING, FEATURE_ROI, FEATURE_PIXEL_FORMAT};
+static const U32 s_setLast[]  = {FEATURE_BANDWIDTH_LIMIT, FEATURE_SHUTTER, FEATURE_FRAME_RATE};
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+// Part of a cache file's name; the camera's strings are whatever the firmware says they are
+static std::string keyPart (const S8* pValue, size_t maxLength)
+{
+    std::string part;
+    for (size_t i = 0; i < maxLength && 0 != pValue[i]; i++)
+    {
+        char c = (char)pValue[i];
+        bool safe = (c >= '0' && c <= '9') || (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || '.' == c || '_' == c;
+        part += safe ? c : '_';
+    }
+    return part.empty() ? std::string("unknown") : part;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   PxLFeatureCache
+ * ---------------------------------------------------------------------------
+ */
+
+PxLFeatureCache::PxLFeatureCache ()
+: m_fromCache(false)
+{
+}
+
+PXL_RETURN_CODE PxLFeatureCache::load (HANDLE hCamera, const char* cacheDir)
+{
+    m_blob.clear();
+    m_byId.clear();
+    m_fromCache = false;
+
+    //
+    // Step 1
+    //      Which camera, and firmware, is this?
+    CAMERA_INFO info;
+    memset (&info, 0, sizeof(info));
+    PXL_RETURN_CODE rc = PxLGetCameraInfoEx (hCamera, &info, sizeof(info));
+    if (!API_SUCCESS (rc)) return rc;
+    m_key = keyPart (info.SerialNumber, sizeof(info.SerialNumber)) + "-" +
+            keyPart (info.FirmwareVersion, sizeof(info.FirmwareVersion)) + "-" +
+            keyPart (info.FPGAVersion, sizeof(info.FPGAVersion));
+
+    //
+    // Step 2
+    //      The description we saved last time, or failing that, the camera's
+    std::string path;
+    if (NULL != cacheDir && 0 != *cacheDir) path = std::string (cacheDir) + "/" + m_key + PXL_FEATURE_CACHE_EXTENSION;
+    if (!path.empty() && read (path))
+    {
+        m_fromCache = true;
+    } else {
+        rc = describe (hCamera);
+        if (!API_SUCCESS (rc)) return rc;
+        // Not being able to save it only costs us next time
+        if (!path.empty()) write (path);
+    }
+
+    //
+    // Step 3
+    //      Index it
+    const CAMERA_FEATURES* pFeatures = features();
+    for (U32 i = 0; i < pFeatures->uNumberOfFeatures; i++)
+    {
+        const CAMERA_FEATURE* pFeature = &pFeatures->pFeatures[i];
+        if (pFeature->uFeatureId >= m_byId.size()) m_byId.resize (pFeature->uFeatureId + 1, NULL);
+        m_byId[pFeature->uFeatureId] = pFeature;
+    }
+    return ApiSuccess;
+}
+
+const CAMERA_FEATURES* PxLFeatureCache::features () const
+{
+    assert (!m_blob.empty());
+    return (const CAMERA_FEATURES*)&m_blob[0];
+}
+
+const CAMERA_FEATURE* PxLFeatureCache::feature (U32 featureId) const
+{
+    if (featureId >= m_byId.size() || NULL == m_byId[featureId]) return NULL;
+    return IS_FEATURE_SUPPORTED (m_byId[featureId]->uFlags) ? m_byId[featureId] : NULL;
+}
+
+bool PxLFeatureCache::supported (U32 featureId) const
+{
+    return NULL != feature (featureId);
+}
+
+bool PxLFeatureCache::settable (U32 featureId) const
+{
+    const CAMERA_FEATURE* pFeature = feature (featureId);
+    return NULL != pFeature && !(pFeature->uFlags & FEATURE_FLAG_READ_ONLY);
+}
+
+bool PxLFeatureCache::settableWhileStreaming (U32 featureId) const
+{
+    const CAMERA_FEATURE* pFeature = feature (featureId);
+    return settable (featureId) && (pFeature->uFlags & FEATURE_FLAG_SETTABLE_WHILE_STREAMING);
+}
+
+PXL_RETURN_CODE PxLFeatureCache::getCameraFeatures (U32 featureId, CAMERA_FEATURES* pFeatureInfo, U32* pBufferSize) const
+{
+    if (NULL == pBufferSize) return ApiNullPointerError;
+    if (featureId >= m_byId.size() || NULL == m_byId[featureId]) return ApiInvalidParameterError;
+
+    // One feature, then its parameters, all in the caller's buffer
+    const CAMERA_FEATURE* pFeature = m_byId[featureId];
+    U32 size = sizeof(CAMERA_FEATURES) + sizeof(CAMERA_FEATURE) + pFeature->uNumberOfParameters * sizeof(FEATURE_PARAM);
+    if (NULL == pFeatureInfo)
+    {
+        *pBufferSize = size;
+        return ApiSuccess;
+    }
+    if (*pBufferSize < size) return ApiBufferTooSmall;
+
+    CAMERA_FEATURE* pCopy = (CAMERA_FEATURE*)((U8*)pFeatureInfo + sizeof(CAMERA_FEATURES));
+    FEATURE_PARAM* pParams = (FEATURE_PARAM*)((U8*)pCopy + sizeof(CAMERA_FEATURE));
+    pFeatureInfo->uSize = size;
+    pFeatureInfo->uNumberOfFeatures = 1;
+    pFeatureInfo->pFeatures = pCopy;
+    *pCopy = *pFeature;
+    pCopy->pParams = 0 == pFeature->uNumberOfParameters ? NULL : pParams;
+    if (pFeature->uNumberOfParameters) memcpy (pParams, pFeature->pParams, pFeature->uNumberOfParameters * sizeof(FEATURE_PARAM));
+    *pBufferSize = size;
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE pxlGetCameraFeatures (HANDLE hCamera, const char* cacheDir, U32 featureId,
+                                      CAMERA_FEATURES* pFeatureInfo, U32* pBufferSize)
+{
+    PxLFeatureCache features;
+    PXL_RETURN_CODE rc = features.load (hCamera, NULL != cacheDir ? cacheDir : pxlDefaultFeatureCacheDir());
+    if (!API_SUCCESS (rc)) return rc;
+    return features.getCameraFeatures (featureId, pFeatureInfo, pBufferSize);
+}
+
+PXL_RETURN_CODE PxLFeatureCache::describe (HANDLE hCamera)
+{
+    U32 size = 0;
+    PXL_RETURN_CODE rc = PxLGetCameraFeatures (hCamera, FEATURE_ALL, NULL, &size);
+    if (!API_SUCCESS (rc)) return rc;
+    if (size < sizeof(CAMERA_FEATURES)) return ApiInvalidParameterError;
+
+    m_blob.assign (size, 0);
+    rc = PxLGetCameraFeatures (hCamera, FEATURE_ALL, (CAMERA_FEATURES*)&m_blob[0], &size);
+    if (!API_SUCCESS (rc)) m_blob.clear();
+    return rc;
+}
+
+// The blob's pointers are into itself; in the file, they are offsets from its start
+bool PxLFeatureCache::read (const std::string& path)
+{
+    FILE* pFile = fopen (path.c_str(), "rb");
+    if (NULL == pFile) return false;
+
+    PXL_FEATURE_CACHE_HEADER header;
+    bool ok = 1 == fread (&header, sizeof(header), 1, pFile) &&
+              PXL_FEATURE_CACHE_MAGIC == header.magic &&
+              PXL_FEATURE_CACHE_VERSION == header.version &&
+              sizeof(void*) == header.pointerSize &&
+              header.blobSize >= sizeof(CAMERA_FEATURES) &&
+              0 == strncmp (header.key, m_key.c_str(), sizeof(header.key));
+    if (ok)
+    {
+        m_blob.assign (header.blobSize, 0);
+        ok = 1 == fread (&m_blob[0], header.blobSize, 1, pFile);
+    }
+    fclose (pFile);
+
+    // A file that doesn't hang together is as good as none; the camera is asked again, and it's rewritten
+    size_t blobSize = m_blob.size();
+    CAMERA_FEATURES* pFeatures = ok ? (CAMERA_FEATURES*)&m_blob[0] : NULL;
+    if (ok)
+    {
+        uintptr_t offset = (uintptr_t)pFeatures->pFeatures;
+        ok = offset <= blobSize && pFeatures->uNumberOfFeatures <= (blobSize - offset) / sizeof(CAMERA_FEATURE);
+        if (ok) pFeatures->pFeatures = (CAMERA_FEATURE*)&m_blob[offset];
+    }
+    for (U32 i = 0; ok && i < pFeatures->uNumberOfFeatures; i++)
+    {
+        CAMERA_FEATURE* pFeature = &pFeatures->pFeatures[i];
+        if (0 == pFeature->uNumberOfParameters)
+        {
+            pFeature->pParams = NULL;
+            continue;
+        }
+        uintptr_t offset = (uintptr_t)pFeature->pParams;
+        ok = offset <= blobSize && pFeature->uNumberOfParameters <= (blobSize - offset) / sizeof(FEATURE_PARAM);
+        if (ok) pFeature->pParams = (FEATURE_PARAM*)&m_blob[offset];
+    }
+
+    if (!ok) m_blob.clear();
+    return ok;
+}
+
+bool PxLFeatureCache::write (const std::string& path) const
+{
+    //
+    // Step 1
+    //      A copy of the blob, with its pointers made offsets.  A camera whose description isn't all in the one
+    //      buffer, isn't cached.
+    std::vector<U8> blob (m_blob);
+    const U8* pStart = &m_blob[0];
+    const U8* pEnd = pStart + m_blob.size();
+    const CAMERA_FEATURES* pFeatures = features();
+    CAMERA_FEATURES* pCopy = (CAMERA_FEATURES*)&blob[0];
+    if ((const U8*)pFeatures->pFeatures < pStart || (const U8*)pFeatures->pFeatures > pEnd) return false;
+    pCopy->pFeatures = (CAMERA_FEATURE*)(uintptr_t)((const U8*)pFeatures->pFeatures - pStart);
+    CAMERA_FEATURE* pCopyFeatures = (CAMERA_FEATURE*)&blob[(uintptr_t)pCopy->pFeatures];
+    for (U32 i = 0; i < pFeatures->uNumberOfFeatures; i++)
+    {
+        const U8* pParams = (const U8*)pFeatures->pFeatures[i].pParams;
+        if (0 == pFeatures->pFeatures[i].uNumberOfParameters)
+        {
+            pCopyFeatures[i].pParams = NULL;
+            continue;
+        }
+        if (pParams < pStart || pParams > pEnd) return false;
+        pCopyFeatures[i].pParams = (FEATURE_PARAM*)(uintptr_t)(pParams - pStart);
+    }
+
+    //
+    // Step 2
+    //      Write it beside the old one, and swap it in, so a reader never sees half a file
+    PXL_FEATURE_CACHE_HEADER header;
+    memset (&header, 0, sizeof(header));
+    header.magic = PXL_FEATURE_CACHE_MAGIC;
+    header.version = PXL_FEATURE_CACHE_VERSION;
+    header.pointerSize = sizeof(void*);
+    header.blobSize = (U32)blob.size();
+    strncpy (header.key, m_key.c_str(), sizeof(header.key) - 1);
+
+    std::string temporary = path + ".tmp";
+    FILE* pFile = fopen (temporary.c_str(), "wb");
+    if (NULL == pFile) return false;
+    bool ok = 1 == fwrite (&header, sizeof(header), 1, pFile) && 1 == fwrite (&blob[0], blob.size(), 1, pFile);
+    ok = 0 == fclose (pFile) && ok;
+    if (ok) ok = 0 == rename (temporary.c_str(), path.c_str());
+    if (!ok) unlink (temporary.c_str());
+    return ok;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   PxLSettingsProfile
+ * ---------------------------------------------------------------------------
+ */
+
+// Where a feature goes, in the order features are set
+static int setOrder (U32 featureId)
+{
+    const int first = (int)(sizeof(s_setFirst) / sizeof(s_setFirst[0]));
+    for (int i = 0; i < first; i++) if (s_setFirst[i] == featureId) return i;
+    for (int i = 0; i < (int)(sizeof(s_setLast) / sizeof(s_setLast[0])); i++) if (s_setLast[i] == featureId) return first + 1 + i;
+    return first;
+}
+
+static bool setBefore (const PXL_FEATURE_SETTING* pA, const PXL_FEATURE_SETTING* pB)
+{
+    return setOrder (pA->featureId) < setOrder (pB->featureId);
+}
+
+// Does the camera's setting need changing, to be the profile's?  Parameters only matter in manual mode; in auto,
+// they're the camera's to choose, and off, they're ignored.
+static bool differs (const PXL_FEATURE_SETTING& wanted, U32 flags, const std::vector<float>& params)
+{
+    U32 mode = wanted.flags & FEATURE_FLAG_MODE_BITS;
+    if (mode != (flags & FEATURE_FLAG_MODE_BITS)) return true;
+    if (FEATURE_FLAG_ONEPUSH & mode) return true;
+    if (!(FEATURE_FLAG_MANUAL & mode)) return false;
+    for (size_t i = 0; i < wanted.params.size(); i++)
+    {
+        if (i >= params.size() || wanted.params[i] != params[i]) return true;
+    }
+    return false;
+}
+
+PXL_RETURN_CODE PxLSettingsProfile::capture (HANDLE hCamera, const PxLFeatureCache& features)
+{
+    m_settings.clear();
+    const CAMERA_FEATURES* pFeatures = features.features();
+    for (U32 i = 0; i < pFeatures->uNumberOfFeatures; i++)
+    {
+        const CAMERA_FEATURE* pFeature = &pFeatures->pFeatures[i];
+        if (!features.settable (pFeature->uFeatureId)) continue;
+
+        PXL_FEATURE_SETTING setting;
+        setting.featureId = pFeature->uFeatureId;
+        setting.flags = 0;
+        setting.params.assign (pFeature->uNumberOfParameters ? pFeature->uNumberOfParameters : 1, 0.0f);
+        U32 numParams = (U32)setting.params.size();
+        PXL_RETURN_CODE rc = PxLGetFeature (hCamera, setting.featureId, &setting.flags, &numParams, &setting.params[0]);
+        if (!API_SUCCESS (rc)) return rc;
+        setting.params.resize (numParams);
+        m_settings.push_back (setting);
+    }
+    return ApiSuccess;
+}
+
+bool PxLSettingsProfile::save (const char* fileName) const
+{
+    FILE* pFile = fopen (fileName, "w");
+    if (NULL == pFile) return false;
+
+    fprintf (pFile, "# PixeLINK settings profile:  feature id, flags, number of params, params\n");
+    for (size_t i = 0; i < m_settings.size(); i++)
+    {
+        const PXL_FEATURE_SETTING& setting = m_settings[i];
+        fprintf (pFile, "%u 0x%08X %u", setting.featureId, setting.flags, (U32)setting.params.size());
+        // Enough digits that the floats read back exactly, so unchanged features compare equal
+        for (size_t p = 0; p < setting.params.size(); p++) fprintf (pFile, " %.9g", setting.params[p]);
+        fprintf (pFile, "\n");
+    }
+    return 0 == fclose (pFile);
+}
+
+bool PxLSettingsProfile::load (const char* fileName)
+{
+    FILE* pFile = fopen (fileName, "r");
+    if (NULL == pFile) return false;
+
+    m_settings.clear();
+    char line[MAX_LINE];
+    bool ok = true;
+    while (ok && NULL != fgets (line, sizeof(line), pFile))
+    {
+        char* pNext = line;
+        while (' ' == *pNext || '\t' == *pNext) pNext++;
+        if ('#' == *pNext || '\n' == *pNext || '\r' == *pNext || 0 == *pNext) continue;
+
+        PXL_FEATURE_SETTING setting;
+        char* pEnd;
+        setting.featureId = (U32)strtoul (pNext, &pEnd, 0);
+        ok = pEnd != pNext;
+        pNext = pEnd;
+        setting.flags = (U32)strtoul (pNext, &pEnd, 0);
+        ok = ok && pEnd != pNext;
+        pNext = pEnd;
+        U32 numParams = (U32)strtoul (pNext, &pEnd, 0);
+        ok = ok && pEnd != pNext;
+        pNext = pEnd;
+        for (U32 p = 0; ok && p < numParams; p++)
+        {
+            setting.params.push_back (strtof (pNext, &pEnd));
+            ok = pEnd != pNext;
+            pNext = pEnd;
+        }
+        if (ok) m_settings.push_back (setting);
+    }
+    fclose (pFile);
+
+    if (!ok) m_settings.clear();
+    return ok;
+}
+
+PXL_RETURN_CODE PxLSettingsProfile::apply (HANDLE hCamera, const PxLFeatureCache& features, PXL_PROFILE_APPLY_STATS* pStats) const
+{
+    double start = now();
+    PXL_PROFILE_APPLY_STATS stats;
+    memset (&stats, 0, sizeof(stats));
+
+    //
+    // Step 1
+    //      In the order they must be set
+    std::vector<const PXL_FEATURE_SETTING*> order;
+    for (size_t i = 0; i < m_settings.size(); i++) order.push_back (&m_settings[i]);
+    std::stable_sort (order.begin(), order.end(), setBefore);
+
+    //
+    // Step 2
+    //      Set those that differ from the camera's.  The first that can't be set while streaming stops the stream,
+    //      if it is running, for all of the rest.
+    PXL_RETURN_CODE result = ApiSuccess;
+    bool stopped = false;
+    std::vector<float> params;
+    for (size_t i = 0; i < order.size(); i++)
+    {
+        const PXL_FEATURE_SETTING& setting = *order[i];
+        const CAMERA_FEATURE* pFeature = features.feature (setting.featureId);
+        if (!features.settable (setting.featureId) || setting.params.size() < pFeature->uNumberOfParameters)
+        {
+            stats.skipped++;
+            continue;
+        }
+
+        U32 flags = 0;
+        U32 numParams = (U32)std::max (setting.params.size(), (size_t)std::max (pFeature->uNumberOfParameters, (U32)1));
+        params.assign (numParams, 0.0f);
+        PXL_RETURN_CODE rc = PxLGetFeature (hCamera, setting.featureId, &flags, &numParams, &params[0]);
+        stats.compared++;
+        if (API_SUCCESS (rc))
+        {
+            params.resize (numParams);
+            if (!differs (setting, flags, params)) continue;
+        }
+
+        const float* pParams = setting.params.empty() ? NULL : &setting.params[0];
+        rc = PxLSetFeature (hCamera, setting.featureId, setting.flags, (U32)setting.params.size(), pParams);
+        if (ApiNotPermittedWhileStreaming == rc && !stopped)
+        {
+            stopped = API_SUCCESS (PxLSetStreamState (hCamera, STOP_STREAM));
+            if (stopped) rc = PxLSetFeature (hCamera, setting.featureId, setting.flags, (U32)setting.params.size(), pParams);
+        }
+        if (API_SUCCESS (rc))
+        {
+            stats.changed++;
+        } else {
+            stats.failed++;
+            if (API_SUCCESS (result)) result = rc;
+        }
+    }
+
+    //
+    // Step 3
+    //      As we found it
+    if (stopped)
+    {
+        PXL_RETURN_CODE rc = PxLSetStreamState (hCamera, START_STREAM);
+        if (!API_SUCCESS (rc) && API_SUCCESS (result)) result = rc;
+        stats.restarted = true;
+    }
+
+    stats.seconds = now() - start;
+    if (NULL != pStats) *pStats = stats;
+    return result;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Start up timing
+ * ---------------------------------------------------------------------------
+ */
+
+const char* pxlDefaultFeatureCacheDir ()
+{
+    static std::string s_dir;
+    if (!s_dir.empty()) return s_dir.c_str();
+
+    const char* pDir = getenv ("PXL_FEATURE_CACHE_DIR");
+    if (NULL != pDir && 0 != *pDir)
+    {
+        s_dir = pDir;
+        return s_dir.c_str();
+    }
+    const char* pHome = getenv ("HOME");
+    if (NULL == pHome || 0 == *pHome) return NULL;
+
+    // Not being able to make it only costs us the cache; load() carries on without
+    std::string cache = std::string (pHome) + "/.cache";
+    mkdir (cache.c_str(), 0755);
+    cache += "/pixelink";
+    if (0 != mkdir (cache.c_str(), 0755) && EEXIST != errno) return NULL;
+    s_dir = cache;
+    return s_dir.c_str();
+}
+
+double pxlSecondsSinceProcessStart ()
+{
+    // Field 22 of /proc/self/stat is when we started, in clock ticks since boot.  Field 2 (our name) is in
+    // parentheses, and may hold spaces; count from after it.
+    FILE* pFile = fopen ("/proc/self/stat", "r");
+    if (NULL == pFile) return -1.0;
+    char stat[MAX_LINE];
+    size_t length = fread (stat, 1, sizeof(stat) - 1, pFile);
+    fclose (pFile);
+    stat[length] = 0;
+
+    const char* pField = strrchr (stat, ')');
+    if (NULL == pField) return -1.0;
+    pField++;
+    for (int field = 3; field < 22 && NULL != pField; field++) pField = strchr (pField + 1, ' ');
+    if (NULL == pField) return -1.0;
+    unsigned long long startTicks = strtoull (pField, NULL, 10);
+
+    struct timespec ts;
+    long ticksPerSecond = sysconf (_SC_CLK_TCK);
+    if (ticksPerSecond <= 0 || 0 != clock_gettime (CLOCK_BOOTTIME, &ts)) return -1.0;
+    double sinceBoot = (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+    return sinceBoot - (double)startTicks / (double)ticksPerSecond;
+}
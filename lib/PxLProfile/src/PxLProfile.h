@@ -0,0 +1,162 @@
+/***************************************************************************
+ *
+ *     File: PxLProfile.h
+ *
+ *     Description:
+ *       Brings a camera up quickly, from what we learnt about it last time.
+ *
+ *       PxLFeatureCache describes the camera's features (their flags, and
+ *       limits), as PxLGetCameraFeatures (FEATURE_ALL) does.  But that takes
+ *       a control transfer per feature, every time a camera is opened, and
+ *       the answer only changes with the camera's firmware.  So the
+ *       description is kept on disk, in a cache directory, under the
+ *       camera's serial number, and firmware and FPGA versions; once it is
+ *       there, bringing the camera up costs one PxLGetCameraInfo instead.
+ *
+ *       PxLSettingsProfile is a camera's settings, saved to a file:  the
+ *       flags (mode) and parameters of each feature that can be set.  It is
+ *       applied as a batch, that only sets the features that differ from
+ *       the camera's current settings, in an order that respects how they
+ *       limit one another (the frame's geometry, then the exposure, then
+ *       the frame rate), and that stops the stream at most once, for all of
+ *       the features that can't be changed while streaming.  Setting the
+ *       features one at a time, as PxLCamera::commitSettingsAsDefault and
+ *       the samples do, costs a transfer (and, for many, a sensor
+ *       reconfiguration) per feature, changed or not.
+ *
+ *       Profile files are text; one feature per line, as
+ *          <feature id> <flags> <number of params> <param> ...
+ *       with the flags in hex.  Lines starting with '#' are comments.
+ *
+ *       C code gets at the cache through pxlGetCameraFeatures, a stand in
+ *       for PxLGetCameraFeatures.
+ */
+
+#if !defined(PIXELINK_PXLPROFILE_H)
+#define PIXELINK_PXLPROFILE_H
+
+#include "PixeLINKApi.h"
+
+#define PXL_FEATURE_CACHE_MAGIC     0x4C434150   // 'PACL'
+#define PXL_FEATURE_CACHE_VERSION   1
+#define PXL_FEATURE_CACHE_EXTENSION ".pxlcaps"
+
+// The start of a cache file; the CAMERA_FEATURES blob follows, with its pointers stored as offsets into it
+typedef struct _PXL_FEATURE_CACHE_HEADER
+{
+    U32 magic;
+    U32 version;
+    U32 pointerSize;       // sizeof(void*) of the writer; a cache is only read back by the same kind of process
+    U32 blobSize;          // Bytes of CAMERA_FEATURES blob
+    char key[96];          // serial-firmware-fpga, as in the file's name
+} PXL_FEATURE_CACHE_HEADER;
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+// As PxLGetCameraFeatures, but from the camera's description in cacheDir (which it is described into, if it
+// isn't there yet).  cacheDir may be NULL, for pxlDefaultFeatureCacheDir.  Each call loads the description;
+// C++ code that asks about more than a feature or two should keep a PxLFeatureCache instead.
+PXL_RETURN_CODE pxlGetCameraFeatures (HANDLE hCamera, const char* cacheDir, U32 featureId,
+                                      CAMERA_FEATURES* pFeatureInfo, U32* pBufferSize);
+
+// Where the cache is kept, when a program isn't told:  $PXL_FEATURE_CACHE_DIR, or failing that ~/.cache/pixelink
+// (made, if need be).  NULL if there's nowhere.
+const char* pxlDefaultFeatureCacheDir ();
+
+#ifdef __cplusplus
+}
+#endif
+
+#ifdef __cplusplus
+
+#include <string>
+#include <vector>
+
+class PxLFeatureCache
+{
+public:
+    PxLFeatureCache ();
+
+    // Describes the camera's features:  from cacheDir, if it has them for this camera (and firmware), otherwise
+    // from the camera, saving them in cacheDir for next time.  cacheDir may be NULL, for no cache.
+    PXL_RETURN_CODE load (HANDLE hCamera, const char* cacheDir);
+
+    bool  fromCache () const { return m_fromCache; }
+    const std::string& key () const { return m_key; }
+    const CAMERA_FEATURES* features () const;
+
+    // The feature's description; NULL if the camera doesn't have it.  The limits of FEATURE_FLAG_VOLATILE
+    // features are as they were when the description was taken; ask the camera if they matter.
+    const CAMERA_FEATURE* feature (U32 featureId) const;
+    bool  supported (U32 featureId) const;
+    bool  settable (U32 featureId) const;                 // Supported, and not read only
+    bool  settableWhileStreaming (U32 featureId) const;
+
+    // The feature's description, as PxLGetCameraFeatures (featureId) gives it, for code written against that
+    // (pFeatureInfo NULL for the size needed).  Supported or not, as the camera described it; ApiInvalidParameterError
+    // for FEATURE_ALL, or a feature it didn't describe.
+    PXL_RETURN_CODE getCameraFeatures (U32 featureId, CAMERA_FEATURES* pFeatureInfo, U32* pBufferSize) const;
+
+private:
+    PXL_RETURN_CODE describe (HANDLE hCamera);
+    bool  read (const std::string& path);
+    bool  write (const std::string& path) const;
+
+    // The blob points into itself
+    PxLFeatureCache (const PxLFeatureCache&);
+    PxLFeatureCache& operator= (const PxLFeatureCache&);
+
+    std::vector<U8> m_blob;        // CAMERA_FEATURES, then its CAMERA_FEATUREs, then their FEATURE_PARAMs
+    std::vector<const CAMERA_FEATURE*> m_byId;
+    std::string m_key;
+    bool  m_fromCache;
+};
+
+// A feature's setting, as PxLGetFeature gives it
+typedef struct _PXL_FEATURE_SETTING
+{
+    U32 featureId;
+    U32 flags;
+    std::vector<float> params;
+} PXL_FEATURE_SETTING;
+
+typedef struct _PXL_PROFILE_APPLY_STATS
+{
+    U32    compared;           // Features read back from the camera
+    U32    changed;            // Features set, because they differed
+    U32    skipped;            // Features the camera doesn't have, or can't set
+    U32    failed;             // Features it wouldn't take
+    bool   restarted;          // The stream was stopped, and started again, to set them
+    double seconds;            // Taken, in all
+} PXL_PROFILE_APPLY_STATS;
+
+class PxLSettingsProfile
+{
+public:
+    // Takes the camera's current settings, of every feature it can set
+    PXL_RETURN_CODE capture (HANDLE hCamera, const PxLFeatureCache& features);
+
+    bool  save (const char* fileName) const;
+    bool  load (const char* fileName);
+
+    // Sets the camera's features to the profile's, where they differ.  The camera may be streaming; if features
+    // that can't be changed while streaming differ, the stream is stopped (once) for them, and started again.
+    // Not so for a camera a PxLCaptureEngine has started, whose buffers were sized for its settings; apply first.
+    PXL_RETURN_CODE apply (HANDLE hCamera, const PxLFeatureCache& features, PXL_PROFILE_APPLY_STATS* pStats = NULL) const;
+
+    const std::vector<PXL_FEATURE_SETTING>& settings () const { return m_settings; }
+
+private:
+    std::vector<PXL_FEATURE_SETTING> m_settings;
+};
+
+// Seconds since this process was started (by the kernel's reckoning, so including the loader, and static
+// initialization); to 1/CLK_TCK of a second.  Negative if it can't be told.
+double pxlSecondsSinceProcessStart ();
+
+#endif // __cplusplus
+
+#endif // !defined(PIXELINK_PXLPROFILE_H)
@@ -0,0 +1,245 @@
+/***************************************************************************
+ *
+ *     File: pxlprofile.cpp
+ *
+ *     Description:
+ *       Brings a camera up the fast way (see PxLProfile.h), and says how long
+ *       each step took, from the moment the process was started:  the
+ *       camera's initialization, the description of its features (from the
+ *       cache, or the camera), applying a settings profile, and, optionally,
+ *       the stream's first frame.  Also saves a camera's settings as a
+ *       profile, to be applied later.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <vector>
+#include "PxLProfile.h"
+#include "PxLRecording.h"
+
+#define A_OK            0  // non-zero error codes
+#define GENERAL_ERROR   1
+
+#define FIRST_FRAME_TIMEOUT 5.0   // Seconds
+
+typedef struct _USER_PARAMETERS
+{
+    const char* cacheDir;     // NULL for none
+    const char* saveFile;     // Save the camera's settings to this profile
+    const char* applyFile;    // Apply this profile
+    bool  firstFrame;         // Stream, and time the first frame
+} USER_PARAMETERS;
+
+static double s_processStart;  // On the monotonic clock
+
+static void   usage (char** argv);
+static int    getParameters (int argc, char* argv[], USER_PARAMETERS* pParms);
+static double now ();
+static void   report (const char* step);
+static PXL_RETURN_CODE firstFrame (HANDLE hCamera);
+
+int main (int argc, char* argv[])
+{
+    USER_PARAMETERS parms;
+    double age = pxlSecondsSinceProcessStart();
+    s_processStart = now() - (age >= 0.0 ? age : 0.0);
+
+    //
+    // Step 1
+    //      Validate the user parameters
+    if (A_OK != getParameters (argc, argv, &parms))
+    {
+        usage (argv);
+        return GENERAL_ERROR;
+    }
+    PxLSettingsProfile profile;
+    if (NULL != parms.applyFile && !profile.load (parms.applyFile))
+    {
+        printf (" Error:  %s is not a settings profile, or could not be read\n", parms.applyFile);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 2
+    //      The camera, and its features
+    printf (" ms since the process started:\n");
+    report ("started main");
+    HANDLE hCamera;
+    PXL_RETURN_CODE rc = PxLInitialize (0, &hCamera);
+    if (!API_SUCCESS (rc))
+    {
+        printf (" Error:  Could not initialize a camera (0x%08X)\n", rc);
+        return GENERAL_ERROR;
+    }
+    report ("camera initialized");
+
+    PxLFeatureCache features;
+    rc = features.load (hCamera, parms.cacheDir);
+    if (!API_SUCCESS (rc))
+    {
+        printf (" Error:  Could not describe the camera's features (0x%08X)\n", rc);
+        PxLUninitialize (hCamera);
+        return GENERAL_ERROR;
+    }
+    report (features.fromCache() ? "features described, from the cache" : "features described, by the camera");
+
+    //
+    // Step 3
+    //      Its settings
+    int result = A_OK;
+    if (NULL != parms.applyFile)
+    {
+        PXL_PROFILE_APPLY_STATS stats;
+        rc = profile.apply (hCamera, features, &stats);
+        report ("profile applied");
+        printf ("            %u features compared, %u changed, %u skipped, %u failed, in %.1f ms%s\n",
+                stats.compared, stats.changed, stats.skipped, stats.failed, stats.seconds * 1000.0,
+                stats.restarted ? " (the stream was restarted)" : "");
+        if (!API_SUCCESS (rc))
+        {
+            printf (" Error:  The camera would not take all of the profile (0x%08X)\n", rc);
+            result = GENERAL_ERROR;
+        }
+    }
+
+    if (NULL != parms.saveFile)
+    {
+        PxLSettingsProfile current;
+        rc = current.capture (hCamera, features);
+        if (!API_SUCCESS (rc) || !current.save (parms.saveFile))
+        {
+            printf (" Error:  Could not save the camera's settings to %s\n", parms.saveFile);
+            result = GENERAL_ERROR;
+        } else {
+            report ("settings saved");
+            printf ("            %u features, to %s\n", (U32)current.settings().size(), parms.saveFile);
+        }
+    }
+
+    //
+    // Step 4
+    //      And, its first frame
+    if (parms.firstFrame)
+    {
+        rc = firstFrame (hCamera);
+        if (!API_SUCCESS (rc))
+        {
+            printf (" Error:  No frame from the camera (0x%08X)\n", rc);
+            result = GENERAL_ERROR;
+        }
+    }
+
+    printf (" Camera %s\n", features.key().c_str());
+    PxLUninitialize (hCamera);
+    return result;
+}
+
+static void usage (char** argv)
+{
+    printf ("\n Brings up a camera, from a cache of its feature descriptions and a settings profile,\n");
+    printf (" and times each step from the process starting\n\n");
+    printf ("    Usage: %s [-c cacheDir] [-a profile] [-s profile] [-f]\n", argv[0]);
+    printf ("       where: \n");
+    printf ("          -c cacheDir  Where the cameras' feature descriptions are kept (%s files)\n", PXL_FEATURE_CACHE_EXTENSION);
+    printf ("          -a profile   Apply a settings profile; only the features that differ are set\n");
+    printf ("          -s profile   Save the camera's settings, as a profile\n");
+    printf ("          -f           Then stream, and time the first frame\n");
+    printf ("    Example: \n");
+    printf ("        %s -c /var/cache/pixelink -a payload.pxlprofile -f \n", argv[0]);
+}
+
+static int getParameters (int argc, char* argv[], USER_PARAMETERS* pParms)
+{
+    //
+    // Step 1
+    //      Set our defaults
+    pParms->cacheDir = NULL;
+    pParms->saveFile = NULL;
+    pParms->applyFile = NULL;
+    pParms->firstFrame = false;
+
+    //
+    // Step 2
+    //      Parse the command line
+    for (int i = 1; i < argc; i++)
+    {
+        if ((!strcmp (argv[i], "-c") || !strcmp (argv[i], "-C")) && i + 1 < argc)
+        {
+            pParms->cacheDir = argv[++i];
+        } else if ((!strcmp (argv[i], "-a") || !strcmp (argv[i], "-A")) && i + 1 < argc) {
+            pParms->applyFile = argv[++i];
+        } else if ((!strcmp (argv[i], "-s") || !strcmp (argv[i], "-S")) && i + 1 < argc) {
+            pParms->saveFile = argv[++i];
+        } else if (!strcmp (argv[i], "-f") || !strcmp (argv[i], "-F")) {
+            pParms->firstFrame = true;
+        } else {
+            return GENERAL_ERROR;
+        }
+    }
+
+    return A_OK;
+}
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+static void report (const char* step)
+{
+    printf ("   %8.1f  %s\n", (now() - s_processStart) * 1000.0, step);
+}
+
+// Streams, and waits for the first frame
+static PXL_RETURN_CODE firstFrame (HANDLE hCamera)
+{
+    //
+    // Step 1
+    //      A buffer for it
+    FRAME_DESC frameDesc;
+    float parms[FEATURE_ROI_NUM_PARAMS];
+    float pixelFormat;
+    U32 flags;
+    U32 numParams = FEATURE_ROI_NUM_PARAMS;
+    memset (&frameDesc, 0, sizeof(frameDesc));
+    PXL_RETURN_CODE rc = PxLGetFeature (hCamera, FEATURE_ROI, &flags, &numParams, parms);
+    if (!API_SUCCESS (rc)) return rc;
+    frameDesc.Roi.fWidth = parms[FEATURE_ROI_PARAM_WIDTH];
+    frameDesc.Roi.fHeight = parms[FEATURE_ROI_PARAM_HEIGHT];
+    frameDesc.PixelAddressingValue.fHorizontal = frameDesc.PixelAddressingValue.fVertical = 1.0f;
+    numParams = 1;
+    rc = PxLGetFeature (hCamera, FEATURE_PIXEL_FORMAT, &flags, &numParams, &pixelFormat);
+    if (!API_SUCCESS (rc)) return rc;
+    // Without pixel addressing, it's the most the frame can be
+    U32 size = pxlRecordingFrameSize ((U32)pixelFormat, &frameDesc);
+    if (0 == size) size = (U32)(frameDesc.Roi.fWidth * frameDesc.Roi.fHeight * 6.0f);
+    std::vector<U8> frame (size);
+
+    //
+    // Step 2
+    //      Stream, and wait for it
+    rc = PxLSetStreamState (hCamera, START_STREAM);
+    if (!API_SUCCESS (rc)) return rc;
+    report ("streaming");
+
+    double deadline = now() + FIRST_FRAME_TIMEOUT;
+    do
+    {
+        memset (&frameDesc, 0, sizeof(frameDesc));
+        frameDesc.uSize = sizeof(frameDesc);
+        rc = PxLGetNextFrame (hCamera, size, &frame[0], &frameDesc);
+    } while (!API_SUCCESS (rc) && now() < deadline);
+    if (API_SUCCESS (rc))
+    {
+        report ("first frame");
+        printf ("            frame %u, %.0fx%.0f\n", frameDesc.uFrameNumber, frameDesc.Roi.fWidth, frameDesc.Roi.fHeight);
+    }
+
+    PxLSetStreamState (hCamera, STOP_STREAM);
+    return rc;
+}
@@ -0,0 +1,456 @@
+/***************************************************************************
+ *
+ *     File: PxLRecording.cpp
+ *
+ *     Description:
+ *       Writing, mapping, and replaying recordings of a camera's frames.
+ *       See PxLRecording.h.
+ *
+ */
+
+#include <assert.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "PxLRecording.h"
+
+#define MAX_SLEEP   0.1     // Seconds; a paced replay checks for stop() at least this often
+
+static U8 s_padding[PXL_RECORDING_ALIGN];
+
+static U64 alignUp (U64 value)
+{
+    return (value + PXL_RECORDING_ALIGN - 1) & ~(U64)(PXL_RECORDING_ALIGN - 1);
+}
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+U32 pxlRecordingFrameSize (U32 pixelFormat, const FRAME_DESC* pFrameDesc)
+{
+    assert (pFrameDesc);
+
+    float paX = pFrameDesc->PixelAddressingValue.fHorizontal;
+    float paY = pFrameDesc->PixelAddressingValue.fVertical;
+    U32 width  = (U32)(pFrameDesc->Roi.fWidth  / (paX >= 1.0f ? paX : 1.0f));
+    U32 height = (U32)(pFrameDesc->Roi.fHeight / (paY >= 1.0f ? paY : 1.0f));
+
+    // Bits per pixel
+    U32 bits;
+    switch (pixelFormat)
+    {
+    case PIXEL_FORMAT_MONO8:
+    case PIXEL_FORMAT_BAYER8_GRBG:
+    case PIXEL_FORMAT_BAYER8_RGGB:
+    case PIXEL_FORMAT_BAYER8_GBRG:
+    case PIXEL_FORMAT_BAYER8_BGGR:
+        bits = 8;
+        break;
+    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+        bits = 10;
+        break;
+    case PIXEL_FORMAT_MONO12_PACKED:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+        bits = 12;
+        break;
+    case PIXEL_FORMAT_MONO16:
+    case PIXEL_FORMAT_BAYER16_GRBG:
+    case PIXEL_FORMAT_BAYER16_RGGB:
+    case PIXEL_FORMAT_BAYER16_GBRG:
+    case PIXEL_FORMAT_BAYER16_BGGR:
+    case PIXEL_FORMAT_YUV422:
+        bits = 16;
+        break;
+    case PIXEL_FORMAT_RGB24:
+    case PIXEL_FORMAT_RGB24_NON_DIB:
+    case PIXEL_FORMAT_BGR24:
+        bits = 24;
+        break;
+    case PIXEL_FORMAT_RGB48:
+        bits = 48;
+        break;
+    default:
+        return 0;
+    }
+    return width * height * bits / 8;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   PxLRecordWriter
+ * ---------------------------------------------------------------------------
+ */
+
+PxLRecordWriter::PxLRecordWriter ()
+: m_pFile(NULL)
+, m_position(0)
+, m_failed(false)
+{
+    pthread_mutex_init (&m_mutex, NULL);
+}
+
+PxLRecordWriter::~PxLRecordWriter ()
+{
+    close();
+    pthread_mutex_destroy (&m_mutex);
+}
+
+bool PxLRecordWriter::open (const char* pFileName, U32 serialNumber, const char* pDescription)
+{
+    assert (pFileName);
+    if (isOpen()) return false;
+
+    m_pFile = fopen (pFileName, "wb");
+    if (NULL == m_pFile) return false;
+
+    PXL_RECORDING_HEADER header;
+    memset (&header, 0, sizeof(header));
+    header.magic = PXL_RECORDING_MAGIC;
+    header.version = PXL_RECORDING_VERSION;
+    header.headerSize = sizeof(header);
+    header.frameDescSize = sizeof(FRAME_DESC);
+    header.serialNumber = serialNumber;
+    if (pDescription) strncpy (header.description, pDescription, sizeof(header.description) - 1);
+
+    m_offsets.clear();
+    m_failed = false;
+    m_position = alignUp (sizeof(header));
+    if (1 != fwrite (&header, sizeof(header), 1, m_pFile) ||
+        1 != fwrite (s_padding, m_position - sizeof(header), 1, m_pFile))
+    {
+        fclose (m_pFile);
+        m_pFile = NULL;
+        return false;
+    }
+    return true;
+}
+
+bool PxLRecordWriter::addFrame (const void* pFrame, U32 frameSize, U32 pixelFormat, const FRAME_DESC* pFrameDesc)
+{
+    assert (pFrame && pFrameDesc);
+
+    PXL_RECORDING_FRAME frame;
+    memset (&frame, 0, sizeof(frame));
+    frame.magic = PXL_RECORDING_FRAME_MAGIC;
+    frame.dataSize = frameSize;
+    frame.dataOffset = (U32)alignUp (sizeof(frame));
+    frame.pixelFormat = pixelFormat;
+    // An application may pass a smaller (older) FRAME_DESC; keep what it has
+    memcpy (&frame.frameDesc, pFrameDesc,
+            pFrameDesc->uSize && pFrameDesc->uSize < sizeof(FRAME_DESC) ? pFrameDesc->uSize : sizeof(FRAME_DESC));
+    frame.frameDesc.uSize = sizeof(FRAME_DESC);
+
+    pthread_mutex_lock (&m_mutex);
+    bool written = false;
+    if (m_pFile && !m_failed)
+    {
+        U64 end = alignUp (m_position + frame.dataOffset + frameSize);
+        written = 1 == fwrite (&frame, sizeof(frame), 1, m_pFile) &&
+                  (frame.dataOffset == sizeof(frame) || 1 == fwrite (s_padding, frame.dataOffset - sizeof(frame), 1, m_pFile)) &&
+                  (0 == frameSize || 1 == fwrite (pFrame, frameSize, 1, m_pFile)) &&
+                  (end == m_position + frame.dataOffset + frameSize ||
+                   1 == fwrite (s_padding, end - (m_position + frame.dataOffset + frameSize), 1, m_pFile));
+        if (written)
+        {
+            m_offsets.push_back (m_position);
+            m_position = end;
+        } else {
+            // Probably out of disk.  Whatever made it to the file, past the last good frame, is ignored.
+            m_failed = true;
+        }
+    }
+    pthread_mutex_unlock (&m_mutex);
+
+    return written;
+}
+
+bool PxLRecordWriter::close ()
+{
+    pthread_mutex_lock (&m_mutex);
+    bool closed = false;
+    if (m_pFile)
+    {
+        //
+        // Step 1
+        //      The index goes after the last good frame, then the header is updated to point to it.
+        closed = 0 == fseeko (m_pFile, (off_t)m_position, SEEK_SET) &&
+                 (m_offsets.empty() || m_offsets.size() == fwrite (&m_offsets[0], sizeof(U64), m_offsets.size(), m_pFile));
+        if (closed)
+        {
+            U64 counts[2] = {m_offsets.size(), m_position};
+            closed = 0 == fseeko (m_pFile, (off_t)offsetof (PXL_RECORDING_HEADER, frameCount), SEEK_SET) &&
+                     1 == fwrite (counts, sizeof(counts), 1, m_pFile);
+        }
+        if (0 != fclose (m_pFile)) closed = false;
+        m_pFile = NULL;
+    }
+    pthread_mutex_unlock (&m_mutex);
+
+    return closed;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   PxLRecording
+ * ---------------------------------------------------------------------------
+ */
+
+PxLRecording::PxLRecording ()
+: m_pMap(NULL)
+, m_mapSize(0)
+, m_maxFrameSize(0)
+{
+}
+
+PxLRecording::~PxLRecording ()
+{
+    close();
+}
+
+bool PxLRecording::open (const char* pFileName)
+{
+    assert (pFileName);
+    close();
+
+    //
+    // Step 1
+    //      Map it, privately, so that frames can be modified in place without changing the file
+    int fd = ::open (pFileName, O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (0 != fstat (fd, &info) || info.st_size < (off_t)sizeof(PXL_RECORDING_HEADER))
+    {
+        ::close (fd);
+        return false;
+    }
+    void* pMap = mmap (NULL, (size_t)info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    ::close (fd);
+    if (MAP_FAILED == pMap) return false;
+    m_pMap = (U8*)pMap;
+    m_mapSize = (size_t)info.st_size;
+    madvise (m_pMap, m_mapSize, MADV_SEQUENTIAL);
+
+    const PXL_RECORDING_HEADER& head = header();
+    if (PXL_RECORDING_MAGIC != head.magic ||
+        PXL_RECORDING_VERSION != head.version ||
+        sizeof(FRAME_DESC) != head.frameDescSize)
+    {
+        close();
+        return false;
+    }
+
+    //
+    // Step 2
+    //      Find the frames; from the index if there is one, otherwise by walking them.  The header and the
+    //      frames come from the file, so none of the sums of their offsets and sizes may overflow.
+    std::vector<U64> offsets;
+    if (head.indexOffset && head.indexOffset <= m_mapSize &&
+        head.frameCount <= (m_mapSize - head.indexOffset) / sizeof(U64))
+    {
+        const U64* pIndex = (const U64*)(m_pMap + head.indexOffset);
+        offsets.assign (pIndex, pIndex + head.frameCount);
+    } else {
+        for (U64 offset = alignUp (head.headerSize); offset + sizeof(PXL_RECORDING_FRAME) <= m_mapSize; )
+        {
+            const PXL_RECORDING_FRAME* pFrame = (const PXL_RECORDING_FRAME*)(m_pMap + offset);
+            if (PXL_RECORDING_FRAME_MAGIC != pFrame->magic ||
+                pFrame->dataOffset < sizeof(PXL_RECORDING_FRAME)) break;
+            offsets.push_back (offset);
+            U64 next = alignUp (offset + pFrame->dataOffset + pFrame->dataSize);
+            if (next <= offset) break;   // Not a frame we could have written; never walk back, or stand still
+            offset = next;
+        }
+    }
+
+    for (size_t i = 0; i < offsets.size(); i++)
+    {
+        if (m_mapSize < sizeof(PXL_RECORDING_FRAME) || offsets[i] > m_mapSize - sizeof(PXL_RECORDING_FRAME)) break;
+        PXL_RECORDING_FRAME* pFrame = (PXL_RECORDING_FRAME*)(m_pMap + offsets[i]);
+        if (PXL_RECORDING_FRAME_MAGIC != pFrame->magic ||
+            pFrame->dataOffset < sizeof(PXL_RECORDING_FRAME) ||
+            (U64)pFrame->dataOffset + pFrame->dataSize > m_mapSize - offsets[i]) break;   // Truncated, or corrupt
+        m_frames.push_back (pFrame);
+        if (pFrame->dataSize > m_maxFrameSize) m_maxFrameSize = pFrame->dataSize;
+    }
+
+    return true;
+}
+
+void PxLRecording::close ()
+{
+    if (m_pMap) munmap (m_pMap, m_mapSize);
+    m_pMap = NULL;
+    m_mapSize = 0;
+    m_maxFrameSize = 0;
+    m_frames.clear();
+}
+
+/* ---------------------------------------------------------------------------
+ * --   PxLReplay
+ * ---------------------------------------------------------------------------
+ */
+
+PxLReplay::PxLReplay (PxLRecording& recording, bool originalTiming, bool loop)
+: m_recording(recording)
+, m_originalTiming(originalTiming)
+, m_loop(loop)
+, m_next(0)
+, m_pass(0)
+, m_started(false)
+, m_start(0.0)
+, m_timeOffset(0.0)
+, m_lastTime(0.0)
+, m_running(false)
+, m_stop(false)
+, m_hCamera(NULL)
+, m_callback(NULL)
+, m_pContext(NULL)
+{
+}
+
+PxLReplay::~PxLReplay ()
+{
+    stop();
+}
+
+//
+// Waits until frame is due.  Frames are due at the same time, relative to the first frame, as they were recorded.
+// When the recorded time goes backwards (the replay looped, or the camera's clock was reset), the frame is due
+// one frame interval after the previous one.
+//
+bool PxLReplay::waitFor (U32 frame)
+{
+    if (m_stop) return false;
+    if (!m_originalTiming) return true;
+
+    double frameTime = (double)m_recording.frameDesc(frame)->fFrameTime;
+    if (!m_started)
+    {
+        m_start = now();
+        m_timeOffset = frameTime;
+        m_started = true;
+    } else if (frameTime < m_lastTime) {
+        double interval = frame > 0 ? frameTime - (double)m_recording.frameDesc(frame - 1)->fFrameTime : 0.0;
+        if (frame + 1 < m_recording.frameCount())
+        {
+            interval = (double)m_recording.frameDesc(frame + 1)->fFrameTime - frameTime;
+        }
+        if (interval < 0.0) interval = 0.0;
+        m_start += (m_lastTime - m_timeOffset) + interval;
+        m_timeOffset = frameTime;
+    }
+    m_lastTime = frameTime;
+
+    double due = m_start + (frameTime - m_timeOffset);
+    for (double remaining = due - now(); remaining > 0.0; remaining = due - now())
+    {
+        if (m_stop) return false;
+        double sleep = remaining < MAX_SLEEP ? remaining : MAX_SLEEP;
+        struct timespec ts;
+        ts.tv_sec = (time_t)sleep;
+        ts.tv_nsec = (long)((sleep - (double)ts.tv_sec) * 1.0e9);
+        nanosleep (&ts, NULL);
+    }
+    return !m_stop;
+}
+
+PXL_RETURN_CODE PxLReplay::nextFrame (const void** ppFrame, const FRAME_DESC** ppFrameDesc, U32* pPixelFormat, U32* pFrameSize)
+{
+    assert (ppFrame && ppFrameDesc);
+
+    if (m_next >= m_recording.frameCount())
+    {
+        if (!m_loop || 0 == m_recording.frameCount()) return ApiStreamStopped;
+        m_next = 0;
+        m_pass++;
+    }
+    if (!waitFor (m_next)) return ApiStreamStopped;
+
+    *ppFrame = m_recording.frameData (m_next);
+    *ppFrameDesc = m_recording.frameDesc (m_next);
+    if (pPixelFormat) *pPixelFormat = m_recording.pixelFormat (m_next);
+    if (pFrameSize) *pFrameSize = m_recording.frameSize (m_next);
+    m_next++;
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PxLReplay::getNextFrame (U32 bufferSize, LPVOID pFrame, FRAME_DESC* pFrameDesc)
+{
+    if (NULL == pFrame || NULL == pFrameDesc) return ApiNullPointerError;
+
+    U32 next = m_next < m_recording.frameCount() ? m_next : 0;
+    if (next < m_recording.frameCount() && bufferSize < m_recording.frameSize (next)) return ApiBufferTooSmall;
+
+    const void* pData;
+    const FRAME_DESC* pDesc;
+    PXL_RETURN_CODE rc = nextFrame (&pData, &pDesc, NULL);
+    if (!API_SUCCESS (rc)) return rc;
+
+    memcpy (pFrame, pData, m_recording.frameSize (m_next - 1));
+    U32 descSize = pFrameDesc->uSize && pFrameDesc->uSize < sizeof(FRAME_DESC) ? pFrameDesc->uSize : sizeof(FRAME_DESC);
+    memcpy (pFrameDesc, pDesc, descSize);
+    pFrameDesc->uSize = descSize;
+    return ApiSuccess;
+}
+
+void* PxLReplay::replayThread (void* pContext)
+{
+    PxLReplay* pReplay = (PxLReplay*)pContext;
+
+    const void* pFrame;
+    const FRAME_DESC* pFrameDesc;
+    U32 pixelFormat;
+    while (API_SUCCESS (pReplay->nextFrame (&pFrame, &pFrameDesc, &pixelFormat)))
+    {
+        // The callback gets the frame in place; it may modify it (the mapping is copy on write)
+        pReplay->m_callback (pReplay->m_hCamera, (LPVOID)pFrame, pixelFormat, pFrameDesc, pReplay->m_pContext);
+    }
+    pReplay->m_running = false;
+    return NULL;
+}
+
+bool PxLReplay::start (HANDLE hCamera, PxLReplayCallback callback, LPVOID pContext)
+{
+    if (m_running || NULL == callback) return false;
+
+    m_hCamera = hCamera;
+    m_callback = callback;
+    m_pContext = pContext;
+    m_stop = false;
+    m_running = true;
+    if (0 != pthread_create (&m_thread, NULL, replayThread, this))
+    {
+        m_running = false;
+        return false;
+    }
+    return true;
+}
+
+void PxLReplay::stop ()
+{
+    m_stop = true;
+    if (m_callback)
+    {
+        pthread_join (m_thread, NULL);
+        m_callback = NULL;
+    }
+}
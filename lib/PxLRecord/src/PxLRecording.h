@@ -0,0 +1,167 @@
+/***************************************************************************
+ *
+ *     File: PxLRecording.h
+ *
+ *     Description:
+ *       Recordings of a PixeLINK camera's frames, for replaying the exact
+ *       same frames through a processing pipeline, run after run.
+ *
+ *       A recording (.pxlrec) holds each raw frame, as the camera delivered
+ *       it, with its FRAME_DESC (so the ROI, pixel addressing, pixel format,
+ *       frame time and frame number all come back on replay), and an index.
+ *          PxLRecordWriter  records frames (see also PXL_TRACE_RECORD, in PxLTrace)
+ *          PxLRecording     maps a recording; frames are views into the mapping
+ *          PxLReplay        delivers a recording's frames through a frame callback,
+ *                           or a PxLGetNextFrame shaped call, at their original
+ *                           timing, or flat out
+ *       PxLSim can also stand in for a camera, replaying a recording (see PXL_SIM_REPLAY).
+ *
+ *       The file layout (all in the recording host's byte order):
+ *          PXL_RECORDING_HEADER
+ *          for each frame, on a PXL_RECORDING_ALIGN boundary:
+ *             PXL_RECORDING_FRAME, then the frame's data
+ *          the index:  a U64 file offset, of each PXL_RECORDING_FRAME
+ *       The header's frameCount and indexOffset are filled in when the recording
+ *       is closed.  If it never was (the recorder crashed), the frames are found
+ *       by walking them from the start.
+ */
+
+#if !defined(PIXELINK_PXLRECORDING_H)
+#define PIXELINK_PXLRECORDING_H
+
+#include <pthread.h>
+#include <stdio.h>
+#include <vector>
+#include "PixeLINKApi.h"
+
+#define PXL_RECORDING_MAGIC        0x4345524C5850ULL   // "PXLREC"
+#define PXL_RECORDING_FRAME_MAGIC  0x4D524650          // "PFRM"
+#define PXL_RECORDING_VERSION      1
+#define PXL_RECORDING_ALIGN        64                  // Frame data is aligned for SIMD loads
+
+typedef struct _PXL_RECORDING_HEADER
+{
+    U64  magic;
+    U32  version;
+    U32  headerSize;        // sizeof(PXL_RECORDING_HEADER)
+    U32  frameDescSize;     // sizeof(FRAME_DESC), as recorded
+    U32  serialNumber;      // Of the camera recorded; 0 if not known
+    U64  frameCount;        // 0 until the recording is closed
+    U64  indexOffset;       // 0 until the recording is closed
+    char description[64];   // Free form; the camera model, say
+} PXL_RECORDING_HEADER;
+
+typedef struct _PXL_RECORDING_FRAME
+{
+    U32  magic;             // PXL_RECORDING_FRAME_MAGIC
+    U32  dataSize;          // Bytes of frame data, following this (and its padding)
+    U32  dataOffset;        // From the start of this, to the frame data
+    U32  pixelFormat;       // As given to the frame callback (same as frameDesc.PixelFormat)
+    FRAME_DESC frameDesc;
+} PXL_RECORDING_FRAME;
+
+//
+// Writes a recording.  Thread safe; frames can be added from a callback, and from PxLGetNextFrame, at once.
+//
+class PxLRecordWriter
+{
+public:
+    PxLRecordWriter ();
+    ~PxLRecordWriter ();
+
+    bool open (const char* pFileName, U32 serialNumber, const char* pDescription);
+    bool addFrame (const void* pFrame, U32 frameSize, U32 pixelFormat, const FRAME_DESC* pFrameDesc);
+    bool close ();   // Writes the index; a recording that isn't closed can still be read
+
+    bool isOpen () const { return NULL != m_pFile; }
+    U64  frameCount () const { return m_offsets.size(); }
+
+private:
+    pthread_mutex_t  m_mutex;
+    FILE*            m_pFile;
+    U64              m_position;
+    std::vector<U64> m_offsets;
+    bool             m_failed;   // A write failed; the recording is truncated at the last good frame
+};
+
+//
+// A recording, mapped read only (copy on write), so frames are views into the mapping, not copies.
+//
+class PxLRecording
+{
+public:
+    PxLRecording ();
+    ~PxLRecording ();
+
+    bool open (const char* pFileName);
+    void close ();
+
+    U32  frameCount () const { return (U32)m_frames.size(); }
+    const PXL_RECORDING_HEADER& header () const { return *(const PXL_RECORDING_HEADER*)m_pMap; }
+
+    // Frame i of the recording.  The pointers stay valid until the recording is closed.  Writing to the frame
+    // data is allowed (frame callbacks may process frames in place); it affects only this mapping.
+    void*             frameData (U32 i) const { return (U8*)m_frames[i] + m_frames[i]->dataOffset; }
+    U32               frameSize (U32 i) const { return m_frames[i]->dataSize; }
+    U32               pixelFormat (U32 i) const { return m_frames[i]->pixelFormat; }
+    const FRAME_DESC* frameDesc (U32 i) const { return &m_frames[i]->frameDesc; }
+    U32               maxFrameSize () const { return m_maxFrameSize; }
+
+private:
+    U8*    m_pMap;
+    size_t m_mapSize;
+    U32    m_maxFrameSize;
+    std::vector<PXL_RECORDING_FRAME*> m_frames;
+};
+
+// The size (in bytes) of a frame, from its descriptor; 0 for pixel formats we don't know the size of.
+U32 pxlRecordingFrameSize (U32 pixelFormat, const FRAME_DESC* pFrameDesc);
+
+typedef U32 (PXL_APICALL * PxLReplayCallback)(HANDLE, LPVOID, U32, FRAME_DESC const *, LPVOID);
+
+//
+// Replays a recording, the way a camera would deliver it.  Frames are taken from the recording, in order, either
+// at the pace they were recorded (so frames come with their original intervals), or flat out.
+//
+class PxLReplay
+{
+public:
+    PxLReplay (PxLRecording& recording, bool originalTiming, bool loop);
+    ~PxLReplay ();
+
+    // Calls the callback with each frame (in place; a view into the recording), from a thread of our own,
+    // until the recording runs out, or stop() is called.
+    bool start (HANDLE hCamera, PxLReplayCallback callback, LPVOID pContext);
+    void stop ();
+    bool running () const { return m_running; }
+
+    // Like PxLGetNextFrame:  copies the next frame into pFrame.  Returns ApiStreamStopped at the end of the
+    // recording.  Don't use this, and start(), at once.
+    PXL_RETURN_CODE getNextFrame (U32 bufferSize, LPVOID pFrame, FRAME_DESC* pFrameDesc);
+    // The same, without the copy
+    PXL_RETURN_CODE nextFrame (const void** ppFrame, const FRAME_DESC** ppFrameDesc, U32* pPixelFormat, U32* pFrameSize = NULL);
+    // Times the replay has gone back to the start of the recording
+    U32  pass () const { return m_pass; }
+
+private:
+    static void* replayThread (void* pContext);
+    bool waitFor (U32 frame);   // Paces the replay; false if we've been stopped
+
+    PxLRecording&     m_recording;
+    bool              m_originalTiming;
+    bool              m_loop;
+    U32               m_next;        // The next frame to deliver
+    U32               m_pass;
+    bool              m_started;     // m_start and m_timeOffset are set
+    double            m_start;       // When we delivered the first frame (monotonic clock)
+    double            m_timeOffset;  // Recorded time that corresponds to m_start
+    double            m_lastTime;    // Recorded time of the last frame delivered
+    pthread_t         m_thread;
+    volatile bool     m_running;
+    volatile bool     m_stop;
+    HANDLE            m_hCamera;
+    PxLReplayCallback m_callback;
+    LPVOID            m_pContext;
+};
+
+#endif // !defined(PIXELINK_PXLRECORDING_H)
@@ -0,0 +1,210 @@
+/***************************************************************************
+ *
+ *     File: pxlrecord_info.cpp
+ *
+ *     Description:
+ *       Describes a recording (.pxlrec, see PxLRecording.h):  the camera, the
+ *       frames' geometry and pixel formats, the duration and frame rate, and
+ *       any frames the recorder missed.  Optionally, replays it flat out,
+ *       through a frame callback, to show how fast frames can be had from it.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "PxLRecording.h"
+
+#define A_OK            0  // non-zero error codes
+#define GENERAL_ERROR   1
+
+typedef struct _USER_PARAMETERS
+{
+    bool listFrames;       // Print every frame
+    U32  benchmarkPasses;  // Replay it this many times, flat out; 0 for none
+    const char* fileName;
+} USER_PARAMETERS;
+
+typedef struct _BENCHMARK_STATE
+{
+    U32 frames;
+    U64 bytes;
+    U32 checksum;          // So that the frame data is really read
+} BENCHMARK_STATE;
+
+static void usage (char** argv);
+static int  getParameters (int argc, char* argv[], USER_PARAMETERS* pParms);
+static void describe (const PxLRecording& recording, bool listFrames);
+static void benchmark (PxLRecording& recording, U32 passes);
+
+int main (int argc, char* argv[])
+{
+    USER_PARAMETERS parms;
+
+    //
+    // Step 1
+    //      Validate the user parameters
+    if (A_OK != getParameters (argc, argv, &parms))
+    {
+        usage (argv);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 2
+    //      Open the recording
+    PxLRecording recording;
+    if (!recording.open (parms.fileName))
+    {
+        printf (" Error:  %s is not a recording, or could not be read\n", parms.fileName);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 3
+    //      Describe it, and optionally, time replaying it
+    describe (recording, parms.listFrames);
+    if (parms.benchmarkPasses) benchmark (recording, parms.benchmarkPasses);
+
+    return A_OK;
+}
+
+static void usage (char** argv)
+{
+    printf ("\n Describes a recording of a camera's frames (.pxlrec)\n\n");
+    printf ("    Usage: %s [-l] [-b passes] recording\n", argv[0]);
+    printf ("       where: \n");
+    printf ("          -l         List every frame\n");
+    printf ("          -b passes  Replay the recording this many times, flat out, through a frame\n");
+    printf ("                     callback, and report the rate\n");
+    printf ("    Example: \n");
+    printf ("        %s -b 10 bench.pxlrec \n", argv[0]);
+}
+
+static int getParameters (int argc, char* argv[], USER_PARAMETERS* pParms)
+{
+    //
+    // Step 1
+    //      Set our defaults
+    pParms->listFrames = false;
+    pParms->benchmarkPasses = 0;
+    pParms->fileName = NULL;
+
+    //
+    // Step 2
+    //      Parse the command line; the last parameter is the recording
+    if (argc < 2 || argv[argc-1][0] == '-') return GENERAL_ERROR;
+    for (int i = 1; i < argc - 1; i++)
+    {
+        if (!strcmp (argv[i], "-l") || !strcmp (argv[i], "-L"))
+        {
+            pParms->listFrames = true;
+        } else if ((!strcmp (argv[i], "-b") || !strcmp (argv[i], "-B")) && i + 1 < argc - 1) {
+            int parm = atoi (argv[++i]);
+            if (parm < 1) return GENERAL_ERROR;
+            pParms->benchmarkPasses = (U32)parm;
+        } else {
+            return GENERAL_ERROR;
+        }
+    }
+    pParms->fileName = argv[argc-1];
+
+    return A_OK;
+}
+
+static void describe (const PxLRecording& recording, bool listFrames)
+{
+    const PXL_RECORDING_HEADER& header = recording.header();
+    U32 frames = recording.frameCount();
+
+    printf ("\n Camera:       %s (serial number %u)\n", header.description, header.serialNumber);
+    printf (" Frames:       %u%s\n", frames, header.indexOffset ? "" : " (the recording was not closed; no index)");
+    if (0 == frames) return;
+
+    //
+    // Step 1
+    //      Summarize, noting where the geometry or pixel format changes
+    U64 bytes = 0;
+    U32 missed = 0;
+    for (U32 i = 0; i < frames; i++)
+    {
+        const FRAME_DESC* pDesc = recording.frameDesc (i);
+        bytes += recording.frameSize (i);
+        if (i > 0 && pDesc->uFrameNumber > recording.frameDesc(i-1)->uFrameNumber + 1)
+        {
+            missed += pDesc->uFrameNumber - recording.frameDesc(i-1)->uFrameNumber - 1;
+        }
+        bool changed = 0 == i ||
+                       recording.pixelFormat (i) != recording.pixelFormat (i-1) ||
+                       pDesc->Roi.fWidth != recording.frameDesc(i-1)->Roi.fWidth ||
+                       pDesc->Roi.fHeight != recording.frameDesc(i-1)->Roi.fHeight ||
+                       pDesc->PixelAddressingValue.fHorizontal != recording.frameDesc(i-1)->PixelAddressingValue.fHorizontal ||
+                       pDesc->PixelAddressingValue.fVertical != recording.frameDesc(i-1)->PixelAddressingValue.fVertical;
+        if (changed)
+        {
+            printf (" From frame %-6u %gx%g at (%g,%g), pixel addressing %gx%g, pixel format %u, %u bytes\n", i,
+                    pDesc->Roi.fWidth, pDesc->Roi.fHeight, pDesc->Roi.fLeft, pDesc->Roi.fTop,
+                    pDesc->PixelAddressingValue.fHorizontal, pDesc->PixelAddressingValue.fVertical,
+                    recording.pixelFormat (i), recording.frameSize (i));
+        }
+    }
+
+    double duration = (double)recording.frameDesc(frames-1)->fFrameTime - (double)recording.frameDesc(0)->fFrameTime;
+    printf (" Duration:     %.3f seconds", duration);
+    if (duration > 0.0) printf (", %.2f frames/second", (double)(frames - 1) / duration);
+    printf ("\n Data:         %.1f MB\n", (double)bytes / 1.0e6);
+    printf (" Missed:       %u frames (numbered by the camera, but not recorded)\n", missed);
+
+    //
+    // Step 2
+    //      Every frame, if asked
+    if (listFrames)
+    {
+        printf ("\n %8s %12s %12s %10s %8s\n", "frame", "number", "time", "shutter", "gain");
+        for (U32 i = 0; i < frames; i++)
+        {
+            const FRAME_DESC* pDesc = recording.frameDesc (i);
+            printf (" %8u %12u %12.6f %10.6f %8.2f\n", i, pDesc->uFrameNumber, pDesc->fFrameTime,
+                    pDesc->Shutter.fValue, pDesc->Gain.fValue);
+        }
+    }
+}
+
+static U32 PXL_APICALL benchmarkCallback (HANDLE hCamera, LPVOID pFrameData, U32 dataFormat, FRAME_DESC const * pFrameDesc, LPVOID pContext)
+{
+    BENCHMARK_STATE* pState = (BENCHMARK_STATE*)pContext;
+    const U8* pData = (const U8*)pFrameData;
+    U32 size = (U32)(pFrameDesc->Roi.fWidth * pFrameDesc->Roi.fHeight);   // At least this many bytes, in any format
+
+    // Touch every cache line, so that the frame really is read from the mapping
+    for (U32 i = 0; i < size; i += 64) pState->checksum += pData[i];
+    pState->frames++;
+    pState->bytes += size;
+    return ApiSuccess;
+}
+
+static void benchmark (PxLRecording& recording, U32 passes)
+{
+    BENCHMARK_STATE state;
+    memset (&state, 0, sizeof(state));
+
+    struct timespec start, end;
+    clock_gettime (CLOCK_MONOTONIC, &start);
+    for (U32 pass = 0; pass < passes; pass++)
+    {
+        PxLReplay replay (recording, false, false);
+        replay.start (NULL, benchmarkCallback, &state);
+        while (replay.running())
+        {
+            struct timespec ts = {0, 1000000};
+            nanosleep (&ts, NULL);
+        }
+        replay.stop();
+    }
+    clock_gettime (CLOCK_MONOTONIC, &end);
+
+    double seconds = (double)(end.tv_sec - start.tv_sec) + (double)(end.tv_nsec - start.tv_nsec) / 1.0e9;
+    printf ("\n Replayed %u frames in %.3f seconds:  %.0f frames/second, %.0f MB/second (checksum %u)\n",
+            state.frames, seconds, (double)state.frames / seconds, (double)state.bytes / seconds / 1.0e6, state.checksum);
+}
@@ -0,0 +1,1448 @@
+
+/***************************************************************************
+ *
+ *     File: PxLSim.cpp
+ *
+ *     Description:
+ *       A simulated PixeLINK API.  It is built as a stand-in libPxLApi.so,
+ *       implementing the part of PixeLINKApi.h that the tools in this tree
+ *       use, with synthetic cameras in place of USB ones.  So, throughput
+ *       and latency work can be benchmarked, and tested, on any Linux box:
+ *          LD_LIBRARY_PATH=<path to lib/PxLSim/bin> ./measureFrameDelivery sim
+ *
+ *       Implemented:
+ *          PxLGetNumberCameras(Ex), PxLInitialize(Ex), PxLUninitialize,
+ *          PxLGetCameraInfo(Ex), PxLGetCameraFeatures, PxLGetFeature,
+ *          PxLSetFeature, PxLGetCurrentTimestamp, PxLGetErrorReport,
+ *          PxLSaveSettings, PxLLoadSettings, PxLSetStreamState,
+ *          PxLGetNextFrame, PxLSetCallback (CALLBACK_FRAME), and
+ *          PxLFormatImage (the raw formats, and BMP).
+ *       Everything else returns ApiNotSupportedError.
+ *
+ *       The simulated cameras are configured with environment variables:
+ *          PXL_SIM_CAMERAS       Number of cameras (default 1)
+ *          PXL_SIM_SERIAL        Serial number of the first camera; the rest follow on
+ *          PXL_SIM_WIDTH         Sensor size, in pixels (default 1280x1024)
+ *          PXL_SIM_HEIGHT
+ *          PXL_SIM_FPS           Default frame rate (default 30)
+ *          PXL_SIM_JITTER        Standard deviation of the frame timing, in microseconds (default 0)
+ *          PXL_SIM_LOSS          Fraction of frames lost on the 'link' (default 0); the frame numbers
+ *                                of lost frames are skipped, as with a real camera
+ *          PXL_SIM_PIXEL_FORMAT  Default pixel format, as its PIXEL_FORMAT_ value (default MONO8)
+ *          PXL_SIM_LINK_MBPS     Bandwidth of the link, in megabits/second (default 0 == unlimited).
+ *                                The frame rate is limited to what the link can carry.
+ *          PXL_SIM_USBFS_MB      USB buffer memory, in MB (default 0 == plenty).  A stream needing
+ *                                more (SIM_USB_BUFFER_SECONDS worth of frames) starts with
+ *                                ApiSuccessLowMemory, and loses the frames that don't fit.
+ *          PXL_SIM_SEED          Seeds the jitter and loss, so that runs can be repeated
+ *          PXL_SIM_CONTROL_US    Cost of a control transfer, in microseconds (default 0).  Getting
+ *                                or setting a feature, or the camera's info, is one; describing
+ *                                features (PxLGetCameraFeatures) is one per feature described.
+ *          PXL_SIM_REPLAY        A recording (.pxlrec; see PxLRecording.h) to replay, instead of
+ *                                making up frames.  There is then one camera, whose geometry, and
+ *                                pixel format, are those of the recording, and can't be changed.
+ *                                Each stream replays the recording from the start, looping.
+ *                                Callbacks get the frames in place, in the recording's mapping.
+ *          PXL_SIM_REPLAY_PACE   'original' (the default), to replay frames at the intervals they
+ *                                were recorded at, or 'flat', to replay them as fast as possible
+ *
+ *       Frames are a gradient that rolls down the image, with a bright
+ *       square that moves across it, so that motion and sharpness
+ *       measurements have something to work with.  Brightness follows the
+ *       exposure and gain.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sys/time.h>
+#include <vector>
+#include "PixeLINKApi.h"
+#include "PxLRecording.h"
+
+#define SIM_DEFAULT_SERIAL     700000001
+#define SIM_DEFAULT_WIDTH      1280
+#define SIM_DEFAULT_HEIGHT     1024
+#define SIM_DEFAULT_FPS        30.0f
+#define SIM_MAX_FPS            2000.0f
+#define SIM_MIN_ROI            32
+#define SIM_MAX_PARAMS         6
+#define SIM_RING_FRAMES        4          // Frames buffered for PxLGetNextFrame
+#define SIM_SQUARE_SIZE        64
+#define SIM_NOMINAL_EXPOSURE   0.01f      // The exposure (in seconds) that gives full brightness, at 0 gain
+#define SIM_USB_BUFFER_SECONDS 0.05f      // USB buffer memory a stream needs, in seconds of frames
+#define SIM_FRAME_TIMEOUT      2.0        // Seconds PxLGetNextFrame waits beyond the frame period
+
+/* ---------------------------------------------------------------------------
+ * --   Simulated camera
+ * ---------------------------------------------------------------------------
+ */
+
+typedef U32 (PXL_APICALL * PxLFrameCallback)(HANDLE, LPVOID, U32, FRAME_DESC const *, LPVOID);
+
+// A feature, as the camera has it
+class PxLSimFeature
+{
+public:
+    PxLSimFeature () : m_flags(0), m_numParams(0) {}
+
+    U32   m_flags;       // Capability flags (FEATURE_FLAG_PRESENCE, ...); 0 if not supported
+    U32   m_mode;        // FEATURE_FLAG_MANUAL, FEATURE_FLAG_AUTO or FEATURE_FLAG_OFF
+    U32   m_numParams;
+    float m_value[SIM_MAX_PARAMS];
+    float m_min[SIM_MAX_PARAMS];
+    float m_max[SIM_MAX_PARAMS];
+};
+
+// One frame of the ring
+class PxLSimFrame
+{
+public:
+    PxLSimFrame () : m_pView(NULL), m_readers(0) {}
+
+    std::vector<U8> m_data;
+    const U8*  m_pView;      // Replaying:  the frame, in the recording (rather than in m_data)
+    U32        m_size;
+    FRAME_DESC m_desc;
+    U32        m_pixelFormat;
+    U32        m_readers;    // PxLGetNextFrame calls copying this frame
+};
+
+class PxLSimCamera
+{
+public:
+    PxLSimCamera ();
+
+    void  defaults ();
+    float actualFrameRate ();
+    U32   frameSize ();
+    float usbShortfall ();
+    void  produceFrames ();
+    void  replayFrames ();
+
+    U32   m_serial;
+    U32   m_sensorWidth;
+    U32   m_sensorHeight;
+    bool  m_open;
+    double m_timeBase;           // Camera time 0, on our monotonic clock
+
+    PxLSimFeature m_features[FEATURES_TOTAL];
+    PxLSimFeature m_saved[FEATURES_TOTAL];   // PxLSaveSettings
+    bool  m_haveSaved;
+
+    // Streaming.  m_mutex protects all of these, and the features.
+    pthread_mutex_t m_mutex;
+    pthread_cond_t  m_cond;
+    bool  m_streaming;
+    bool  m_paused;
+    pthread_t m_producer;
+    PxLSimFrame m_ring[SIM_RING_FRAMES];
+    U64   m_published;          // Frames put in the ring, since the stream started
+    U64   m_delivered;          // The next frame PxLGetNextFrame will return
+    U32   m_frameNumber;        // As numbered by the 'camera'; lost frames are counted too
+
+    PxLFrameCallback m_callback;
+    LPVOID m_callbackContext;
+    PxLReplay* m_pReplay;       // While replaying a recording
+
+    ERROR_REPORT m_lastError;
+};
+
+static struct _SIM_CONFIG
+{
+    bool  loaded;
+    U32   cameras;
+    U32   serial;
+    U32   width;
+    U32   height;
+    float fps;
+    float jitterUs;
+    float loss;
+    U32   pixelFormat;
+    float linkMbps;
+    float usbfsMB;
+    float controlUs;
+    bool  replaying;
+    bool  replayOriginalTiming;
+    float replayRate;           // Frames/second of the recording
+} s_config;
+
+static pthread_mutex_t s_configMutex = PTHREAD_MUTEX_INITIALIZER;
+static std::vector<PxLSimCamera*> s_cameras;
+static PxLRecording s_recording;   // PXL_SIM_REPLAY
+static unsigned int s_seed = 1;
+
+static double now ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (double)ts.tv_sec + (double)ts.tv_nsec / 1.0e9;
+}
+
+static float envFloat (const char* name, float defaultValue)
+{
+    const char* value = getenv (name);
+    return value && *value ? (float)atof (value) : defaultValue;
+}
+
+static U32 envU32 (const char* name, U32 defaultValue)
+{
+    const char* value = getenv (name);
+    return value && *value ? (U32)strtoul (value, NULL, 0) : defaultValue;
+}
+
+// What a real camera's control transfers cost; see PXL_SIM_CONTROL_US
+static void controlTransfers (U32 count)
+{
+    if (s_config.controlUs <= 0.0f || 0 == count) return;
+    double delay = (double)s_config.controlUs * count / 1.0e6;
+    struct timespec ts;
+    ts.tv_sec = (time_t)delay;
+    ts.tv_nsec = (long)((delay - (double)ts.tv_sec) * 1.0e9);
+    while (0 != nanosleep (&ts, &ts) && EINTR == errno) ;
+}
+
+// Reads the configuration, and creates the cameras, the first time we're used.
+static void loadConfig ()
+{
+    pthread_mutex_lock (&s_configMutex);
+    if (!s_config.loaded)
+    {
+        s_config.cameras     = envU32 ("PXL_SIM_CAMERAS", 1);
+        s_config.serial      = envU32 ("PXL_SIM_SERIAL", SIM_DEFAULT_SERIAL);
+        s_config.width       = envU32 ("PXL_SIM_WIDTH", SIM_DEFAULT_WIDTH);
+        s_config.height      = envU32 ("PXL_SIM_HEIGHT", SIM_DEFAULT_HEIGHT);
+        s_config.fps         = envFloat ("PXL_SIM_FPS", SIM_DEFAULT_FPS);
+        s_config.jitterUs    = envFloat ("PXL_SIM_JITTER", 0.0f);
+        s_config.loss        = envFloat ("PXL_SIM_LOSS", 0.0f);
+        s_config.pixelFormat = envU32 ("PXL_SIM_PIXEL_FORMAT", PIXEL_FORMAT_MONO8);
+        s_config.linkMbps    = envFloat ("PXL_SIM_LINK_MBPS", 0.0f);
+        s_config.usbfsMB     = envFloat ("PXL_SIM_USBFS_MB", 0.0f);
+        s_config.controlUs   = envFloat ("PXL_SIM_CONTROL_US", 0.0f);
+        s_seed               = envU32 ("PXL_SIM_SEED", (U32)time(NULL));
+
+        if (s_config.width < SIM_MIN_ROI * 2)  s_config.width = SIM_MIN_ROI * 2;
+        if (s_config.height < SIM_MIN_ROI * 2) s_config.height = SIM_MIN_ROI * 2;
+        if (s_config.fps <= 0.0f || s_config.fps > SIM_MAX_FPS) s_config.fps = SIM_DEFAULT_FPS;
+
+        // Replaying a recording:  one camera, like the one recorded
+        const char* pReplay = getenv ("PXL_SIM_REPLAY");
+        if (pReplay && *pReplay)
+        {
+            if (s_recording.open (pReplay) && s_recording.frameCount() > 0)
+            {
+                const FRAME_DESC* pFirst = s_recording.frameDesc (0);
+                const FRAME_DESC* pLast = s_recording.frameDesc (s_recording.frameCount() - 1);
+                const char* pPace = getenv ("PXL_SIM_REPLAY_PACE");
+                s_config.replaying = true;
+                s_config.replayOriginalTiming = !(pPace && !strcmp (pPace, "flat"));
+                s_config.cameras = 1;
+                if (s_recording.header().serialNumber) s_config.serial = s_recording.header().serialNumber;
+                s_config.width = (U32)(pFirst->Roi.fLeft + pFirst->Roi.fWidth);
+                s_config.height = (U32)(pFirst->Roi.fTop + pFirst->Roi.fHeight);
+                s_config.pixelFormat = s_recording.pixelFormat (0);
+                float duration = pLast->fFrameTime - pFirst->fFrameTime;
+                s_config.replayRate = duration > 0.0f ? (float)(s_recording.frameCount() - 1) / duration : s_config.fps;
+                if (s_config.replayRate > SIM_MAX_FPS) s_config.replayRate = SIM_MAX_FPS;
+                s_config.fps = s_config.replayRate;
+            } else {
+                fprintf (stderr, "PxLSim: could not replay %s; it is not a recording, or has no frames\n", pReplay);
+            }
+        }
+
+        for (U32 i = 0; i < s_config.cameras; i++)
+        {
+            PxLSimCamera* pCamera = new PxLSimCamera();
+            pCamera->m_serial = s_config.serial + i;
+            pCamera->m_sensorWidth = s_config.width;
+            pCamera->m_sensorHeight = s_config.height;
+            pCamera->defaults();
+            s_cameras.push_back (pCamera);
+        }
+        s_config.loaded = true;
+    }
+    pthread_mutex_unlock (&s_configMutex);
+}
+
+static PxLSimCamera* cameraFromHandle (HANDLE hCamera)
+{
+    for (size_t i = 0; i < s_cameras.size(); i++)
+    {
+        if (s_cameras[i] == (PxLSimCamera*)hCamera && s_cameras[i]->m_open) return s_cameras[i];
+    }
+    return NULL;
+}
+
+static PXL_RETURN_CODE reportError (PxLSimCamera* pCamera, const char* function, PXL_RETURN_CODE rc, const char* report)
+{
+    if (pCamera)
+    {
+        pCamera->m_lastError.uReturnCode = rc;
+        snprintf ((char*)pCamera->m_lastError.strFunctionName, sizeof(pCamera->m_lastError.strFunctionName), "%s", function);
+        snprintf ((char*)pCamera->m_lastError.strReturnCode, sizeof(pCamera->m_lastError.strReturnCode), "0x%08X", rc);
+        snprintf ((char*)pCamera->m_lastError.strReport, sizeof(pCamera->m_lastError.strReport), "%s", report);
+    }
+    return rc;
+}
+
+// Bytes for width pixels of the pixel format
+static U32 bytesForPixels (U32 pixelFormat, U32 width)
+{
+    switch (pixelFormat)
+    {
+    case PIXEL_FORMAT_MONO8:
+    case PIXEL_FORMAT_BAYER8_GRBG:
+    case PIXEL_FORMAT_BAYER8_RGGB:
+    case PIXEL_FORMAT_BAYER8_GBRG:
+    case PIXEL_FORMAT_BAYER8_BGGR:
+        return width;
+    case PIXEL_FORMAT_MONO16:
+    case PIXEL_FORMAT_BAYER16_GRBG:
+    case PIXEL_FORMAT_BAYER16_RGGB:
+    case PIXEL_FORMAT_BAYER16_GBRG:
+    case PIXEL_FORMAT_BAYER16_BGGR:
+    case PIXEL_FORMAT_YUV422:
+        return width * 2;
+    case PIXEL_FORMAT_MONO12_PACKED:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+        return width + width / 2;
+    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+        return width + width / 4;
+    case PIXEL_FORMAT_RGB24:
+    case PIXEL_FORMAT_RGB24_NON_DIB:
+    case PIXEL_FORMAT_BGR24:
+        return width * 3;
+    case PIXEL_FORMAT_RGB48:
+        return width * 6;
+    default:
+        return 0;   // Not one we simulate
+    }
+}
+
+static bool isBayer (U32 pixelFormat)
+{
+    switch (pixelFormat)
+    {
+    case PIXEL_FORMAT_BAYER8_GRBG:  case PIXEL_FORMAT_BAYER8_RGGB:  case PIXEL_FORMAT_BAYER8_GBRG:  case PIXEL_FORMAT_BAYER8_BGGR:
+    case PIXEL_FORMAT_BAYER16_GRBG: case PIXEL_FORMAT_BAYER16_RGGB: case PIXEL_FORMAT_BAYER16_GBRG: case PIXEL_FORMAT_BAYER16_BGGR:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED: case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED: case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+        return true;
+    default:
+        return false;
+    }
+}
+
+// Writes a row of 8 bit values, in the pixel format
+static void encodeRow (U32 pixelFormat, const U8* pValues, U32 width, U8* pRow)
+{
+    U32 x;
+    switch (pixelFormat)
+    {
+    case PIXEL_FORMAT_MONO16:
+    case PIXEL_FORMAT_BAYER16_GRBG: case PIXEL_FORMAT_BAYER16_RGGB: case PIXEL_FORMAT_BAYER16_GBRG: case PIXEL_FORMAT_BAYER16_BGGR:
+        // Most significant byte first
+        for (x = 0; x < width; x++) { pRow[2*x] = pValues[x]; pRow[2*x+1] = pValues[x] & 0xF0; }
+        break;
+    case PIXEL_FORMAT_MONO12_PACKED:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED: case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED: case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+        for (x = 0; x + 1 < width; x += 2) { pRow[3*(x/2)] = pValues[x]; pRow[3*(x/2)+1] = 0; pRow[3*(x/2)+2] = pValues[x+1]; }
+        break;
+    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+        for (x = 0; x + 1 < width; x += 2) { pRow[3*(x/2)] = pValues[x]; pRow[3*(x/2)+1] = pValues[x+1]; pRow[3*(x/2)+2] = 0; }
+        break;
+    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+        for (x = 0; x + 3 < width; x += 4)
+        {
+            memcpy (&pRow[5*(x/4)], &pValues[x], 4);
+            pRow[5*(x/4)+4] = 0;
+        }
+        break;
+    case PIXEL_FORMAT_YUV422:
+        for (x = 0; x < width; x++) { pRow[2*x] = 128; pRow[2*x+1] = pValues[x]; }
+        break;
+    case PIXEL_FORMAT_RGB24:
+    case PIXEL_FORMAT_RGB24_NON_DIB:
+    case PIXEL_FORMAT_BGR24:
+        for (x = 0; x < width; x++) { pRow[3*x] = pRow[3*x+1] = pRow[3*x+2] = pValues[x]; }
+        break;
+    case PIXEL_FORMAT_RGB48:
+        for (x = 0; x < width; x++) for (int c = 0; c < 3; c++) { pRow[6*x+2*c] = 0; pRow[6*x+2*c+1] = pValues[x]; }
+        break;
+    default:
+        memcpy (pRow, pValues, width);
+        break;
+    }
+}
+
+// The 8 bit value of pixel x, of a row in the pixel format
+static U8 sampleAt (U32 pixelFormat, const U8* pRow, U32 x, int channel)
+{
+    switch (pixelFormat)
+    {
+    case PIXEL_FORMAT_MONO16:
+    case PIXEL_FORMAT_BAYER16_GRBG: case PIXEL_FORMAT_BAYER16_RGGB: case PIXEL_FORMAT_BAYER16_GBRG: case PIXEL_FORMAT_BAYER16_BGGR:
+        return pRow[2*x];
+    case PIXEL_FORMAT_MONO12_PACKED:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED: case PIXEL_FORMAT_BAYER12_RGGB_PACKED:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED: case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+        return pRow[3*(x/2) + 2*(x&1)];
+    case PIXEL_FORMAT_MONO12_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER12_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST:
+        return pRow[3*(x/2) + (x&1)];
+    case PIXEL_FORMAT_MONO10_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER10_RGGB_PACKED_MSFIRST:
+    case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+        return pRow[5*(x/4) + (x&3)];
+    case PIXEL_FORMAT_YUV422:
+        return pRow[2*x+1];
+    case PIXEL_FORMAT_RGB24_NON_DIB:
+        return pRow[3*x + channel];
+    case PIXEL_FORMAT_RGB24:
+    case PIXEL_FORMAT_BGR24:
+        return pRow[3*x + 2 - channel];
+    case PIXEL_FORMAT_RGB48:
+        return pRow[6*x + 2*channel + 1];
+    default:
+        return pRow[x];
+    }
+}
+
+PxLSimCamera::PxLSimCamera ()
+: m_serial(0)
+, m_sensorWidth(SIM_DEFAULT_WIDTH)
+, m_sensorHeight(SIM_DEFAULT_HEIGHT)
+, m_open(false)
+, m_timeBase(now())
+, m_haveSaved(false)
+, m_streaming(false)
+, m_paused(false)
+, m_published(0)
+, m_delivered(0)
+, m_frameNumber(0)
+, m_callback(NULL)
+, m_callbackContext(NULL)
+, m_pReplay(NULL)
+{
+    pthread_mutex_init (&m_mutex, NULL);
+    pthread_cond_init (&m_cond, NULL);
+    memset (&m_lastError, 0, sizeof(m_lastError));
+}
+
+static void defineFeature (PxLSimFeature* pFeature, U32 flags, U32 mode, U32 numParams, const float* pValues, const float* pMins, const float* pMaxs)
+{
+    pFeature->m_flags = FEATURE_FLAG_PRESENCE | flags;
+    pFeature->m_mode = mode;
+    pFeature->m_numParams = numParams;
+    for (U32 i = 0; i < numParams; i++)
+    {
+        pFeature->m_value[i] = pValues[i];
+        pFeature->m_min[i] = pMins[i];
+        pFeature->m_max[i] = pMaxs[i];
+    }
+}
+
+// The factory settings
+void PxLSimCamera::defaults ()
+{
+    for (int i = 0; i < FEATURES_TOTAL; i++) m_features[i] = PxLSimFeature();
+
+    const U32 whileStreaming = FEATURE_FLAG_SETTABLE_WHILE_STREAMING;
+    float w = (float)m_sensorWidth;
+    float h = (float)m_sensorHeight;
+    {
+        float v[] = {SIM_NOMINAL_EXPOSURE}, lo[] = {0.00001f}, hi[] = {2.0f};
+        defineFeature (&m_features[FEATURE_SHUTTER], FEATURE_FLAG_MANUAL | whileStreaming, FEATURE_FLAG_MANUAL, 1, v, lo, hi);
+    }
+    {
+        float v[] = {0.0f}, lo[] = {0.0f}, hi[] = {24.0f};
+        defineFeature (&m_features[FEATURE_GAIN], FEATURE_FLAG_MANUAL | whileStreaming, FEATURE_FLAG_MANUAL, 1, v, lo, hi);
+    }
+    {
+        float v[] = {s_config.fps}, lo[] = {1.0f}, hi[] = {SIM_MAX_FPS};
+        defineFeature (&m_features[FEATURE_FRAME_RATE], FEATURE_FLAG_MANUAL | FEATURE_FLAG_OFF | whileStreaming, FEATURE_FLAG_MANUAL, 1, v, lo, hi);
+    }
+    {
+        float v[] = {s_config.fps}, lo[] = {0.0f}, hi[] = {SIM_MAX_FPS};
+        defineFeature (&m_features[FEATURE_ACTUAL_FRAME_RATE], FEATURE_FLAG_READ_ONLY, FEATURE_FLAG_MANUAL, 1, v, lo, hi);
+    }
+    {
+        float v[] = {0.0f, 0.0f, w, h}, lo[] = {0.0f, 0.0f, (float)SIM_MIN_ROI, (float)SIM_MIN_ROI}, hi[] = {w - SIM_MIN_ROI, h - SIM_MIN_ROI, w, h};
+        defineFeature (&m_features[FEATURE_ROI], FEATURE_FLAG_MANUAL, FEATURE_FLAG_MANUAL, 4, v, lo, hi);
+    }
+    {
+        float v[] = {1.0f, PIXEL_ADDRESSING_MODE_DECIMATE, 1.0f, 1.0f}, lo[] = {1.0f, 0.0f, 1.0f, 1.0f}, hi[] = {4.0f, PIXEL_ADDRESSING_MODE_BIN, 4.0f, 4.0f};
+        defineFeature (&m_features[FEATURE_PIXEL_ADDRESSING], FEATURE_FLAG_MANUAL, FEATURE_FLAG_MANUAL, 4, v, lo, hi);
+    }
+    {
+        float v[] = {(float)(bytesForPixels (s_config.pixelFormat, 1) ? s_config.pixelFormat : PIXEL_FORMAT_MONO8)}, lo[] = {0.0f}, hi[] = {(float)PIXEL_FORMAT_BGR24};
+        defineFeature (&m_features[FEATURE_PIXEL_FORMAT], FEATURE_FLAG_MANUAL, FEATURE_FLAG_MANUAL, 1, v, lo, hi);
+    }
+    {
+        float linkMbps = s_config.linkMbps > 0.0f ? s_config.linkMbps : 5000.0f;
+        float v[] = {linkMbps}, lo[] = {10.0f}, hi[] = {linkMbps};
+        defineFeature (&m_features[FEATURE_BANDWIDTH_LIMIT], FEATURE_FLAG_MANUAL | FEATURE_FLAG_OFF, FEATURE_FLAG_OFF, 1, v, lo, hi);
+    }
+    {
+        float v[] = {40.0f}, lo[] = {-40.0f}, hi[] = {120.0f};
+        defineFeature (&m_features[FEATURE_SENSOR_TEMPERATURE], FEATURE_FLAG_READ_ONLY, FEATURE_FLAG_MANUAL, 1, v, lo, hi);
+    }
+
+    // Replaying, the frames are what they are; the settings that shape them are as recorded, and read only
+    if (s_config.replaying)
+    {
+        const FRAME_DESC* pFirst = s_recording.frameDesc (0);
+        float* pRoi = m_features[FEATURE_ROI].m_value;
+        pRoi[FEATURE_ROI_PARAM_LEFT] = pFirst->Roi.fLeft;
+        pRoi[FEATURE_ROI_PARAM_TOP] = pFirst->Roi.fTop;
+        pRoi[FEATURE_ROI_PARAM_WIDTH] = pFirst->Roi.fWidth;
+        pRoi[FEATURE_ROI_PARAM_HEIGHT] = pFirst->Roi.fHeight;
+        float* pAddressing = m_features[FEATURE_PIXEL_ADDRESSING].m_value;
+        pAddressing[FEATURE_PIXEL_ADDRESSING_PARAM_VALUE] = pFirst->PixelAddressingValue.fHorizontal;
+        pAddressing[FEATURE_PIXEL_ADDRESSING_PARAM_MODE] = pFirst->DecimationMode.fValue;
+        pAddressing[FEATURE_PIXEL_ADDRESSING_PARAM_X_VALUE] = pFirst->PixelAddressingValue.fHorizontal;
+        pAddressing[FEATURE_PIXEL_ADDRESSING_PARAM_Y_VALUE] = pFirst->PixelAddressingValue.fVertical;
+        m_features[FEATURE_PIXEL_FORMAT].m_value[0] = (float)s_recording.pixelFormat (0);
+        m_features[FEATURE_SHUTTER].m_value[0] = pFirst->Shutter.fValue;
+        m_features[FEATURE_GAIN].m_value[0] = pFirst->Gain.fValue;
+        m_features[FEATURE_ROI].m_flags = FEATURE_FLAG_PRESENCE | FEATURE_FLAG_READ_ONLY;
+        m_features[FEATURE_PIXEL_ADDRESSING].m_flags = FEATURE_FLAG_PRESENCE | FEATURE_FLAG_READ_ONLY;
+        m_features[FEATURE_PIXEL_FORMAT].m_flags = FEATURE_FLAG_PRESENCE | FEATURE_FLAG_READ_ONLY;
+        m_features[FEATURE_SHUTTER].m_flags = FEATURE_FLAG_PRESENCE | FEATURE_FLAG_READ_ONLY;
+        m_features[FEATURE_GAIN].m_flags = FEATURE_FLAG_PRESENCE | FEATURE_FLAG_READ_ONLY;
+        m_features[FEATURE_FRAME_RATE].m_flags = FEATURE_FLAG_PRESENCE | FEATURE_FLAG_READ_ONLY;
+    }
+}
+
+// Bytes in a frame, with the current settings
+U32 PxLSimCamera::frameSize ()
+{
+    U32 paX = (U32)m_features[FEATURE_PIXEL_ADDRESSING].m_value[FEATURE_PIXEL_ADDRESSING_PARAM_X_VALUE];
+    U32 paY = (U32)m_features[FEATURE_PIXEL_ADDRESSING].m_value[FEATURE_PIXEL_ADDRESSING_PARAM_Y_VALUE];
+    U32 width  = (U32)m_features[FEATURE_ROI].m_value[FEATURE_ROI_PARAM_WIDTH] / (paX ? paX : 1);
+    U32 height = (U32)m_features[FEATURE_ROI].m_value[FEATURE_ROI_PARAM_HEIGHT] / (paY ? paY : 1);
+    return bytesForPixels ((U32)m_features[FEATURE_PIXEL_FORMAT].m_value[0], width) * height;
+}
+
+// The frame rate the camera can really deliver:  the frame rate setting, limited by the exposure, and the link.
+float PxLSimCamera::actualFrameRate ()
+{
+    if (s_config.replaying) return s_config.replayOriginalTiming ? s_config.replayRate : SIM_MAX_FPS;
+
+    float rate = SIM_MAX_FPS;
+    if (!(m_features[FEATURE_FRAME_RATE].m_mode & FEATURE_FLAG_OFF)) rate = m_features[FEATURE_FRAME_RATE].m_value[0];
+
+    float exposure = m_features[FEATURE_SHUTTER].m_value[0];
+    if (exposure > 0.0f && 1.0f / exposure < rate) rate = 1.0f / exposure;
+
+    float linkMbps = s_config.linkMbps;
+    if (!(m_features[FEATURE_BANDWIDTH_LIMIT].m_mode & FEATURE_FLAG_OFF))
+    {
+        float limit = m_features[FEATURE_BANDWIDTH_LIMIT].m_value[0];
+        if (linkMbps <= 0.0f || limit < linkMbps) linkMbps = limit;
+    }
+    if (linkMbps > 0.0f)
+    {
+        float linkRate = linkMbps * 1.0e6f / 8.0f / (float)frameSize();
+        if (linkRate < rate) rate = linkRate;
+    }
+    return rate;
+}
+
+// The fraction of the frames that the USB buffer memory (PXL_SIM_USBFS_MB) can't hold; 0 if it is enough.
+float PxLSimCamera::usbShortfall ()
+{
+    if (s_config.usbfsMB <= 0.0f) return 0.0f;
+
+    float needed = (float)frameSize() * actualFrameRate() * SIM_USB_BUFFER_SECONDS;
+    float available = s_config.usbfsMB * 1024.0f * 1024.0f;
+    return needed > available ? 1.0f - available / needed : 0.0f;
+}
+
+// A normally distributed random number (Box-Muller)
+static double gaussian (unsigned int* pSeed)
+{
+    double u1 = ((double)rand_r (pSeed) + 1.0) / ((double)RAND_MAX + 2.0);
+    double u2 = ((double)rand_r (pSeed) + 1.0) / ((double)RAND_MAX + 2.0);
+    return sqrt (-2.0 * log (u1)) * cos (2.0 * M_PI * u2);
+}
+
+static void* ProducerThread (void* pContext)
+{
+    ((PxLSimCamera*)pContext)->produceFrames();
+    return NULL;
+}
+
+//
+// The body of the stream:  makes each frame at its due time, hands it to the callback (if any), then
+// puts it in the ring for PxLGetNextFrame.
+//
+void PxLSimCamera::produceFrames ()
+{
+    if (s_config.replaying)
+    {
+        replayFrames();
+        return;
+    }
+
+    unsigned int seed = s_seed + m_serial;
+    std::vector<U8> values;
+    double due = now();
+
+    pthread_mutex_lock (&m_mutex);
+    while (m_streaming)
+    {
+        //
+        // Step 1
+        //      Wait until the frame is due.  Settings can change while streaming, so the period is taken afresh
+        //      each frame.
+        double period = 1.0 / (double)actualFrameRate();
+        due += period;
+        double jitter = s_config.jitterUs > 0.0f ? gaussian (&seed) * s_config.jitterUs / 1.0e6 : 0.0;
+        if (jitter < -period) jitter = -period;
+        double when = due + jitter;
+        struct timespec ts;
+        ts.tv_sec = (time_t)when;
+        ts.tv_nsec = (long)((when - (double)ts.tv_sec) * 1.0e9);
+        pthread_mutex_unlock (&m_mutex);
+        while (EINTR == clock_nanosleep (CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL));
+        pthread_mutex_lock (&m_mutex);
+        if (!m_streaming) break;
+        double woke = now();
+        if (woke > due + period)
+        {
+            // We fell behind (a debugger, say); don't try to catch up.  This frame is taken now, not when it was due.
+            due = woke;
+            when = woke;
+        }
+
+        m_frameNumber++;
+        if (m_paused) continue;
+        if (s_config.loss > 0.0f && (float)rand_r (&seed) / (float)RAND_MAX < s_config.loss) continue;
+        float shortfall = usbShortfall();
+        if (shortfall > 0.0f && (float)rand_r (&seed) / (float)RAND_MAX < shortfall) continue;
+
+        //
+        // Step 2
+        //      Make the frame, in the oldest slot of the ring (once nobody is reading it)
+        PxLSimFrame& frame = m_ring[m_published % SIM_RING_FRAMES];
+        while (frame.m_readers > 0 && m_streaming) pthread_cond_wait (&m_cond, &m_mutex);
+        if (!m_streaming) break;
+
+        U32 pixelFormat = (U32)m_features[FEATURE_PIXEL_FORMAT].m_value[0];
+        float paX = m_features[FEATURE_PIXEL_ADDRESSING].m_value[FEATURE_PIXEL_ADDRESSING_PARAM_X_VALUE];
+        float paY = m_features[FEATURE_PIXEL_ADDRESSING].m_value[FEATURE_PIXEL_ADDRESSING_PARAM_Y_VALUE];
+        float* pRoi = m_features[FEATURE_ROI].m_value;
+        U32 width  = (U32)(pRoi[FEATURE_ROI_PARAM_WIDTH] / paX);
+        U32 height = (U32)(pRoi[FEATURE_ROI_PARAM_HEIGHT] / paY);
+        U32 rowBytes = bytesForPixels (pixelFormat, width);
+        float exposure = m_features[FEATURE_SHUTTER].m_value[0];
+        float gain = m_features[FEATURE_GAIN].m_value[0];
+
+        FRAME_DESC& desc = frame.m_desc;
+        memset (&desc, 0, sizeof(desc));
+        desc.uSize = sizeof(FRAME_DESC);
+        desc.fFrameTime = (float)(when - m_timeBase);
+        desc.uFrameNumber = m_frameNumber;
+        desc.Shutter.fValue = exposure;
+        desc.Gain.fValue = gain;
+        desc.FrameRate.fValue = m_features[FEATURE_FRAME_RATE].m_value[0];
+        desc.Roi.fLeft = pRoi[FEATURE_ROI_PARAM_LEFT];
+        desc.Roi.fTop = pRoi[FEATURE_ROI_PARAM_TOP];
+        desc.Roi.fWidth = pRoi[FEATURE_ROI_PARAM_WIDTH];
+        desc.Roi.fHeight = pRoi[FEATURE_ROI_PARAM_HEIGHT];
+        desc.Decimation.fValue = paX;
+        desc.DecimationMode.fValue = m_features[FEATURE_PIXEL_ADDRESSING].m_value[FEATURE_PIXEL_ADDRESSING_PARAM_MODE];
+        desc.PixelAddressingValue.fHorizontal = paX;
+        desc.PixelAddressingValue.fVertical = paY;
+        desc.PixelFormat.fValue = (float)pixelFormat;
+        desc.Temperature.fValue = m_features[FEATURE_SENSOR_TEMPERATURE].m_value[0];
+        frame.m_pixelFormat = pixelFormat;
+        frame.m_size = rowBytes * height;
+        frame.m_pView = NULL;
+        U32 frameNumber = m_frameNumber;
+        pthread_mutex_unlock (&m_mutex);
+
+        //
+        // Step 3
+        //      The picture:  a gradient rolling down, and a square moving across
+        if (frame.m_data.size() < frame.m_size) frame.m_data.resize (frame.m_size);
+        if (values.size() < width) values.resize (width);
+        float brightness = exposure / SIM_NOMINAL_EXPOSURE * powf (10.0f, gain / 20.0f);
+        U32 squareX = width > SIM_SQUARE_SIZE ? (frameNumber * 4) % (width - SIM_SQUARE_SIZE) : 0;
+        U32 squareY = height > SIM_SQUARE_SIZE ? (height - SIM_SQUARE_SIZE) / 2 : 0;
+        for (U32 y = 0; y < height; y++)
+        {
+            float level = (float)((y * 192 / height + frameNumber) % 192 + 32) * brightness;
+            U8 value = level > 255.0f ? 255 : (U8)level;
+            memset (&values[0], value, width);
+            if (y >= squareY && y < squareY + SIM_SQUARE_SIZE)
+            {
+                U8 square = brightness * 240.0f > 255.0f ? 255 : (U8)(brightness * 240.0f);
+                memset (&values[squareX], square, width > SIM_SQUARE_SIZE ? SIM_SQUARE_SIZE : width);
+            }
+            encodeRow (pixelFormat, &values[0], width, &frame.m_data[y * rowBytes]);
+        }
+
+        //
+        // Step 4
+        //      Hand it to the callback, then to PxLGetNextFrame
+        if (m_callback) m_callback ((HANDLE)this, &frame.m_data[0], pixelFormat, &desc, m_callbackContext);
+
+        pthread_mutex_lock (&m_mutex);
+        m_published++;
+        pthread_cond_broadcast (&m_cond);
+    }
+    pthread_mutex_unlock (&m_mutex);
+}
+
+//
+// The body of a stream replaying a recording:  the same as produceFrames, but the frames, and their timing, come
+// from the recording.  Frames are not copied; the callback, and PxLGetNextFrame, get them from the mapping.
+//
+void PxLSimCamera::replayFrames ()
+{
+    // Each time the replay loops, the frame numbers and times carry on from where they got to
+    const FRAME_DESC* pFirst = s_recording.frameDesc (0);
+    const FRAME_DESC* pLast = s_recording.frameDesc (s_recording.frameCount() - 1);
+    U32 numberSpan = pLast->uFrameNumber - pFirst->uFrameNumber + 1;
+    float timeSpan = pLast->fFrameTime - pFirst->fFrameTime + 1.0f / s_config.replayRate;
+
+    PxLReplay replay (s_recording, s_config.replayOriginalTiming, true);
+    pthread_mutex_lock (&m_mutex);
+    m_pReplay = &replay;
+    while (m_streaming)
+    {
+        //
+        // Step 1
+        //      Wait for the next frame
+        const void* pData;
+        const FRAME_DESC* pDesc;
+        U32 pixelFormat;
+        U32 size;
+        pthread_mutex_unlock (&m_mutex);
+        PXL_RETURN_CODE rc = replay.nextFrame (&pData, &pDesc, &pixelFormat, &size);
+        pthread_mutex_lock (&m_mutex);
+        if (!API_SUCCESS (rc) || !m_streaming) break;
+        if (m_paused) continue;
+
+        //
+        // Step 2
+        //      Into the ring, by reference
+        PxLSimFrame& frame = m_ring[m_published % SIM_RING_FRAMES];
+        while (frame.m_readers > 0 && m_streaming) pthread_cond_wait (&m_cond, &m_mutex);
+        if (!m_streaming) break;
+
+        frame.m_desc = *pDesc;
+        frame.m_desc.uFrameNumber += replay.pass() * numberSpan;
+        frame.m_desc.fFrameTime += (float)replay.pass() * timeSpan;
+        frame.m_pixelFormat = pixelFormat;
+        frame.m_size = size;
+        frame.m_pView = (const U8*)pData;
+        m_frameNumber = frame.m_desc.uFrameNumber;
+        pthread_mutex_unlock (&m_mutex);
+
+        //
+        // Step 3
+        //      Hand it to the callback, then to PxLGetNextFrame
+        if (m_callback) m_callback ((HANDLE)this, (LPVOID)pData, pixelFormat, &frame.m_desc, m_callbackContext);
+
+        pthread_mutex_lock (&m_mutex);
+        m_published++;
+        pthread_cond_broadcast (&m_cond);
+    }
+    m_pReplay = NULL;
+    pthread_mutex_unlock (&m_mutex);
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Enumerating, and connecting to, cameras
+ * ---------------------------------------------------------------------------
+ */
+
+PXL_RETURN_CODE PXL_API PxLGetNumberCameras (U32* pSerialNumbers, U32* pNumberSerialNumbers)
+{
+    loadConfig();
+    if (NULL == pNumberSerialNumbers) return ApiNullPointerError;
+
+    if (pSerialNumbers)
+    {
+        for (U32 i = 0; i < *pNumberSerialNumbers && i < s_cameras.size(); i++) pSerialNumbers[i] = s_cameras[i]->m_serial;
+    }
+    *pNumberSerialNumbers = (U32)s_cameras.size();
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PXL_API PxLGetNumberCamerasEx (CAMERA_ID_INFO* pCameraIdInfo, U32* pNumberCameraIdInfos)
+{
+    loadConfig();
+    if (NULL == pNumberCameraIdInfos) return ApiNullPointerError;
+
+    if (pCameraIdInfo)
+    {
+        for (U32 i = 0; i < *pNumberCameraIdInfos && i < s_cameras.size(); i++)
+        {
+            memset (&pCameraIdInfo[i], 0, sizeof(CAMERA_ID_INFO));
+            pCameraIdInfo[i].StructSize = sizeof(CAMERA_ID_INFO);
+            pCameraIdInfo[i].CameraSerialNum = s_cameras[i]->m_serial;
+        }
+    }
+    *pNumberCameraIdInfos = (U32)s_cameras.size();
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PXL_API PxLInitializeEx (U32 serialNumber, HANDLE* phCamera, U32 flags)
+{
+    loadConfig();
+    if (NULL == phCamera) return ApiNullPointerError;
+
+    for (size_t i = 0; i < s_cameras.size(); i++)
+    {
+        PxLSimCamera* pCamera = s_cameras[i];
+        if (0 != serialNumber && pCamera->m_serial != serialNumber) continue;
+        if (pCamera->m_open)
+        {
+            if (0 != serialNumber) return ApiCameraInUseError;
+            continue;
+        }
+        pCamera->m_open = true;
+        *phCamera = (HANDLE)pCamera;
+        return ApiSuccess;
+    }
+    return 0 == serialNumber ? ApiNoCameraAvailableError : ApiInvalidSerialNumberError;
+}
+
+PXL_RETURN_CODE PXL_API PxLInitialize (U32 serialNumber, HANDLE* phCamera)
+{
+    return PxLInitializeEx (serialNumber, phCamera, 0);
+}
+
+PXL_RETURN_CODE PXL_API PxLUninitialize (HANDLE hCamera)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+
+    PxLSetStreamState (hCamera, STOP_STREAM);
+    pCamera->m_callback = NULL;
+    pCamera->m_open = false;
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PXL_API PxLGetCameraInfoEx (HANDLE hCamera, CAMERA_INFO* pInformation, U32 informationSize)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+    if (NULL == pInformation) return ApiNullPointerError;
+    controlTransfers (1);
+
+    CAMERA_INFO info;
+    memset (&info, 0, sizeof(info));
+    snprintf ((char*)info.VendorName, sizeof(info.VendorName), "PixeLINK");
+    snprintf ((char*)info.ModelName, sizeof(info.ModelName), "Simulated %ux%u", pCamera->m_sensorWidth, pCamera->m_sensorHeight);
+    snprintf ((char*)info.Description, sizeof(info.Description), "Simulated camera (PxLSim)");
+    snprintf ((char*)info.SerialNumber, sizeof(info.SerialNumber), "%u", pCamera->m_serial);
+    snprintf ((char*)info.FirmwareVersion, sizeof(info.FirmwareVersion), "0.0.0");
+    snprintf ((char*)info.FPGAVersion, sizeof(info.FPGAVersion), "0.0.0");
+    snprintf ((char*)info.CameraName, sizeof(info.CameraName), "PxLSim %u", pCamera->m_serial);
+    memcpy (pInformation, &info, informationSize < sizeof(info) ? informationSize : sizeof(info));
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PXL_API PxLGetCameraInfo (HANDLE hCamera, CAMERA_INFO* pInformation)
+{
+    return PxLGetCameraInfoEx (hCamera, pInformation, sizeof(CAMERA_INFO));
+}
+
+PXL_RETURN_CODE PXL_API PxLGetErrorReport (HANDLE hCamera, ERROR_REPORT* pErrorReport)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+    if (NULL == pErrorReport) return ApiNullPointerError;
+
+    *pErrorReport = pCamera->m_lastError;
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PXL_API PxLGetCurrentTimestamp (HANDLE hCamera, double* pCurrentTimestamp)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+    if (NULL == pCurrentTimestamp) return ApiNullPointerError;
+
+    *pCurrentTimestamp = now() - pCamera->m_timeBase;
+    return ApiSuccess;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Features
+ * ---------------------------------------------------------------------------
+ */
+
+PXL_RETURN_CODE PXL_API PxLGetCameraFeatures (HANDLE hCamera, U32 featureId, CAMERA_FEATURES* pFeatureInfo, U32* pBufferSize)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+    if (NULL == pBufferSize) return ApiNullPointerError;
+    if (FEATURE_ALL != featureId && featureId >= FEATURES_TOTAL) return ApiInvalidParameterError;
+
+    //
+    // Step 1
+    //      The buffer holds the CAMERA_FEATURES, then a CAMERA_FEATURE for each feature, then all of their parameters
+    U32 first = FEATURE_ALL == featureId ? 0 : featureId;
+    U32 count = FEATURE_ALL == featureId ? FEATURES_TOTAL : 1;
+    U32 numParams = 0;
+    for (U32 i = first; i < first + count; i++) numParams += pCamera->m_features[i].m_numParams;
+    U32 size = sizeof(CAMERA_FEATURES) + count * sizeof(CAMERA_FEATURE) + numParams * sizeof(FEATURE_PARAM);
+    controlTransfers (count);
+
+    if (NULL == pFeatureInfo)
+    {
+        *pBufferSize = size;
+        return ApiSuccess;
+    }
+    if (*pBufferSize < size)
+    {
+        *pBufferSize = size;
+        return reportError (pCamera, "PxLGetCameraFeatures", ApiBufferTooSmall, "Buffer too small for the features");
+    }
+
+    //
+    // Step 2
+    //      Fill it in
+    CAMERA_FEATURE* pFeatures = (CAMERA_FEATURE*)(pFeatureInfo + 1);
+    FEATURE_PARAM*  pParams = (FEATURE_PARAM*)(pFeatures + count);
+    pFeatureInfo->uSize = size;
+    pFeatureInfo->uNumberOfFeatures = count;
+    pFeatureInfo->pFeatures = pFeatures;
+    for (U32 i = 0; i < count; i++)
+    {
+        const PxLSimFeature& feature = pCamera->m_features[first + i];
+        pFeatures[i].uFeatureId = first + i;
+        pFeatures[i].uFlags = feature.m_flags;
+        pFeatures[i].uNumberOfParameters = feature.m_numParams;
+        pFeatures[i].pParams = feature.m_numParams ? pParams : NULL;
+        for (U32 p = 0; p < feature.m_numParams; p++, pParams++)
+        {
+            pParams->fMinValue = feature.m_min[p];
+            pParams->fMaxValue = feature.m_max[p];
+        }
+    }
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PXL_API PxLGetFeature (HANDLE hCamera, U32 featureId, U32* pFlags, U32* pNumberOfParams, F32* pParams)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+    if (NULL == pFlags || NULL == pNumberOfParams || NULL == pParams) return ApiNullPointerError;
+    if (featureId >= FEATURES_TOTAL || 0 == pCamera->m_features[featureId].m_flags)
+    {
+        return reportError (pCamera, "PxLGetFeature", ApiNotSupportedError, "Feature not supported by the simulated camera");
+    }
+    controlTransfers (1);
+
+    pthread_mutex_lock (&pCamera->m_mutex);
+    PxLSimFeature& feature = pCamera->m_features[featureId];
+    if (FEATURE_ACTUAL_FRAME_RATE == featureId) feature.m_value[0] = pCamera->actualFrameRate();
+    PXL_RETURN_CODE rc = ApiSuccess;
+    if (*pNumberOfParams < feature.m_numParams)
+    {
+        rc = ApiInvalidParameterError;
+    } else {
+        for (U32 i = 0; i < feature.m_numParams; i++) pParams[i] = feature.m_value[i];
+        *pFlags = feature.m_mode;
+    }
+    *pNumberOfParams = feature.m_numParams;
+    pthread_mutex_unlock (&pCamera->m_mutex);
+
+    return rc;
+}
+
+PXL_RETURN_CODE PXL_API PxLSetFeature (HANDLE hCamera, U32 featureId, U32 flags, U32 numberOfParams, F32 const * pParams)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+    if (featureId >= FEATURES_TOTAL || 0 == pCamera->m_features[featureId].m_flags)
+    {
+        return reportError (pCamera, "PxLSetFeature", ApiNotSupportedError, "Feature not supported by the simulated camera");
+    }
+    controlTransfers (1);
+
+    pthread_mutex_lock (&pCamera->m_mutex);
+    PxLSimFeature& feature = pCamera->m_features[featureId];
+    PXL_RETURN_CODE rc = ApiSuccess;
+
+    //
+    // Step 1
+    //      Is this a change we can make, now?
+    U32 mode = flags & FEATURE_FLAG_MODE_BITS;
+    if (feature.m_flags & FEATURE_FLAG_READ_ONLY)
+    {
+        rc = ApiInvalidFunctionCallError;
+    } else if (pCamera->m_streaming && !(feature.m_flags & FEATURE_FLAG_SETTABLE_WHILE_STREAMING)) {
+        rc = ApiNotPermittedWhileStreaming;
+    } else if (0 == mode || !(feature.m_flags & mode)) {
+        rc = ApiInvalidParameterError;
+    } else if (FEATURE_FLAG_OFF != mode && (NULL == pParams || numberOfParams < feature.m_numParams)) {
+        rc = ApiInvalidParameterError;
+    }
+
+    //
+    // Step 2
+    //      Range check, and make it so
+    if (API_SUCCESS (rc) && FEATURE_FLAG_OFF != mode)
+    {
+        for (U32 i = 0; i < feature.m_numParams && API_SUCCESS (rc); i++)
+        {
+            if (pParams[i] < feature.m_min[i] || pParams[i] > feature.m_max[i]) rc = ApiOutOfRangeError;
+        }
+        if (API_SUCCESS (rc) && FEATURE_PIXEL_FORMAT == featureId && 0 == bytesForPixels ((U32)pParams[0], 1))
+        {
+            rc = ApiOutOfRangeError;
+        }
+        if (API_SUCCESS (rc) && FEATURE_ROI == featureId &&
+            (pParams[FEATURE_ROI_PARAM_LEFT] + pParams[FEATURE_ROI_PARAM_WIDTH] > (float)pCamera->m_sensorWidth ||
+             pParams[FEATURE_ROI_PARAM_TOP] + pParams[FEATURE_ROI_PARAM_HEIGHT] > (float)pCamera->m_sensorHeight))
+        {
+            rc = ApiOutOfRangeError;
+        }
+        if (API_SUCCESS (rc))
+        {
+            for (U32 i = 0; i < feature.m_numParams; i++) feature.m_value[i] = pParams[i];
+            if (FEATURE_PIXEL_ADDRESSING == featureId)
+            {
+                // A single value sets both directions
+                if (numberOfParams < FEATURE_PIXEL_ADDRESSING_NUM_PARAMS)
+                {
+                    feature.m_value[FEATURE_PIXEL_ADDRESSING_PARAM_X_VALUE] = pParams[FEATURE_PIXEL_ADDRESSING_PARAM_VALUE];
+                    feature.m_value[FEATURE_PIXEL_ADDRESSING_PARAM_Y_VALUE] = pParams[FEATURE_PIXEL_ADDRESSING_PARAM_VALUE];
+                }
+            }
+        }
+    }
+    if (API_SUCCESS (rc)) feature.m_mode = mode;
+    pthread_mutex_unlock (&pCamera->m_mutex);
+
+    if (!API_SUCCESS (rc)) reportError (pCamera, "PxLSetFeature", rc, "Could not set the feature");
+    return rc;
+}
+
+PXL_RETURN_CODE PXL_API PxLSaveSettings (HANDLE hCamera, U32 channelNumber)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+    if (0 == channelNumber) return ApiInvalidParameterError;   // Channel 0 is the factory settings
+
+    pthread_mutex_lock (&pCamera->m_mutex);
+    for (int i = 0; i < FEATURES_TOTAL; i++) pCamera->m_saved[i] = pCamera->m_features[i];
+    pCamera->m_haveSaved = true;
+    pthread_mutex_unlock (&pCamera->m_mutex);
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PXL_API PxLLoadSettings (HANDLE hCamera, U32 channelNumber)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+
+    pthread_mutex_lock (&pCamera->m_mutex);
+    PXL_RETURN_CODE rc = ApiSuccess;
+    if (pCamera->m_streaming)
+    {
+        rc = ApiNotPermittedWhileStreaming;
+    } else if (0 == channelNumber || !pCamera->m_haveSaved) {
+        pCamera->defaults();
+    } else {
+        for (int i = 0; i < FEATURES_TOTAL; i++) pCamera->m_features[i] = pCamera->m_saved[i];
+    }
+    pthread_mutex_unlock (&pCamera->m_mutex);
+    return rc;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Streaming, and frames
+ * ---------------------------------------------------------------------------
+ */
+
+PXL_RETURN_CODE PXL_API PxLSetStreamState (HANDLE hCamera, U32 streamState)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+
+    pthread_mutex_lock (&pCamera->m_mutex);
+    PXL_RETURN_CODE rc = ApiSuccess;
+    switch (streamState)
+    {
+    case START_STREAM:
+    case PAUSE_STREAM:
+        if (pCamera->m_streaming)
+        {
+            if (START_STREAM == streamState && !pCamera->m_paused) rc = ApiSuccessAlreadyRunning;
+            pCamera->m_paused = (PAUSE_STREAM == streamState);
+            break;
+        }
+        pCamera->m_streaming = true;
+        pCamera->m_paused = (PAUSE_STREAM == streamState);
+        pCamera->m_published = pCamera->m_delivered = 0;
+        if (0 != pthread_create (&pCamera->m_producer, NULL, ProducerThread, pCamera))
+        {
+            pCamera->m_streaming = false;
+            rc = ApiOutOfMemoryError;
+        } else if (pCamera->usbShortfall() > 0.0f) {
+            rc = ApiSuccessLowMemory;
+        }
+        break;
+
+    case STOP_STREAM:
+        if (pCamera->m_streaming)
+        {
+            pCamera->m_streaming = false;
+            if (pCamera->m_pReplay) pCamera->m_pReplay->stop();   // So that it stops waiting for the next frame
+            pthread_cond_broadcast (&pCamera->m_cond);
+            pthread_mutex_unlock (&pCamera->m_mutex);
+            pthread_join (pCamera->m_producer, NULL);
+            pthread_mutex_lock (&pCamera->m_mutex);
+        }
+        break;
+
+    default:
+        rc = ApiInvalidParameterError;
+        break;
+    }
+    pthread_mutex_unlock (&pCamera->m_mutex);
+    return rc;
+}
+
+PXL_RETURN_CODE PXL_API PxLGetNextFrame (HANDLE hCamera, U32 bufferSize, LPVOID pFrame, FRAME_DESC* pFrameDesc)
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+    if (NULL == pFrame || NULL == pFrameDesc) return ApiNullPointerError;
+
+    //
+    // Step 1
+    //      Wait for a frame we have not yet returned.  If we've fallen more than the ring behind, the
+    //      frames in between are gone; skip to the newest.
+    pthread_mutex_lock (&pCamera->m_mutex);
+    double deadline = now() + 1.0 / (double)pCamera->actualFrameRate() + SIM_FRAME_TIMEOUT;
+    while (pCamera->m_streaming && pCamera->m_delivered >= pCamera->m_published)
+    {
+        struct timespec ts;
+        struct timeval tv;
+        gettimeofday (&tv, NULL);   // The condition variable uses the realtime clock
+        double remaining = deadline - now();
+        if (remaining <= 0.0) break;
+        double when = (double)tv.tv_sec + (double)tv.tv_usec / 1.0e6 + remaining;
+        ts.tv_sec = (time_t)when;
+        ts.tv_nsec = (long)((when - (double)ts.tv_sec) * 1.0e9);
+        pthread_cond_timedwait (&pCamera->m_cond, &pCamera->m_mutex, &ts);
+    }
+    if (!pCamera->m_streaming)
+    {
+        pthread_mutex_unlock (&pCamera->m_mutex);
+        return reportError (pCamera, "PxLGetNextFrame", ApiStreamStopped, "The stream is not running");
+    }
+    if (pCamera->m_delivered >= pCamera->m_published)
+    {
+        pthread_mutex_unlock (&pCamera->m_mutex);
+        return reportError (pCamera, "PxLGetNextFrame", ApiCameraTimeoutError, "Timed out waiting for a frame");
+    }
+    if (pCamera->m_published - pCamera->m_delivered > SIM_RING_FRAMES - 1)
+    {
+        pCamera->m_delivered = pCamera->m_published - 1;
+    }
+    PxLSimFrame& frame = pCamera->m_ring[pCamera->m_delivered % SIM_RING_FRAMES];
+    if (bufferSize < frame.m_size)
+    {
+        pthread_mutex_unlock (&pCamera->m_mutex);
+        return reportError (pCamera, "PxLGetNextFrame", ApiBufferTooSmall, "Buffer too small for the frame");
+    }
+    pCamera->m_delivered++;
+    frame.m_readers++;
+    pthread_mutex_unlock (&pCamera->m_mutex);
+
+    //
+    // Step 2
+    //      Copy it out; the producer won't reuse the slot until we're done
+    memcpy (pFrame, frame.m_pView ? frame.m_pView : &frame.m_data[0], frame.m_size);
+    U32 descSize = pFrameDesc->uSize && pFrameDesc->uSize < sizeof(FRAME_DESC) ? pFrameDesc->uSize : sizeof(FRAME_DESC);
+    memcpy (pFrameDesc, &frame.m_desc, descSize);
+    pFrameDesc->uSize = descSize;
+
+    pthread_mutex_lock (&pCamera->m_mutex);
+    frame.m_readers--;
+    pthread_cond_broadcast (&pCamera->m_cond);
+    pthread_mutex_unlock (&pCamera->m_mutex);
+
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PXL_API PxLSetCallback (HANDLE hCamera, U32 callbackType, LPVOID pContext,
+                                        U32 (PXL_APICALL* DataProcessFunction)(HANDLE, LPVOID, U32, FRAME_DESC const *, LPVOID))
+{
+    PxLSimCamera* pCamera = cameraFromHandle (hCamera);
+    if (NULL == pCamera) return ApiInvalidHandleError;
+
+    // Only frame callbacks; there is no preview, image or clip formatting to hook into
+    if (CALLBACK_FRAME != callbackType) return ApiNotSupportedError;
+
+    pthread_mutex_lock (&pCamera->m_mutex);
+    pCamera->m_callback = DataProcessFunction;
+    pCamera->m_callbackContext = pContext;
+    pthread_mutex_unlock (&pCamera->m_mutex);
+    return ApiSuccess;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Formatting images
+ * ---------------------------------------------------------------------------
+ */
+
+// Loads a row as RGB (8 bits a channel).  Bayer rows are demosaiced in 2x2 blocks, so pRowBelow is
+// the other row of the block.
+static void loadRgbRow (U32 pixelFormat, const U8* pRow, const U8* pOtherRow, bool evenRow, U32 width, U8* pRgb)
+{
+    if (isBayer (pixelFormat))
+    {
+        // Where red is, in the 2x2 block; blue is diagonally opposite
+        int redX = 0, redY = 0;
+        switch (pixelFormat)
+        {
+        case PIXEL_FORMAT_BAYER8_GRBG: case PIXEL_FORMAT_BAYER16_GRBG: case PIXEL_FORMAT_BAYER12_GRBG_PACKED:
+        case PIXEL_FORMAT_BAYER12_GRBG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER10_GRBG_PACKED_MSFIRST:
+            redX = 1; redY = 0; break;
+        case PIXEL_FORMAT_BAYER8_GBRG: case PIXEL_FORMAT_BAYER16_GBRG: case PIXEL_FORMAT_BAYER12_GBRG_PACKED:
+        case PIXEL_FORMAT_BAYER12_GBRG_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER10_GBRG_PACKED_MSFIRST:
+            redX = 0; redY = 1; break;
+        case PIXEL_FORMAT_BAYER8_BGGR: case PIXEL_FORMAT_BAYER16_BGGR: case PIXEL_FORMAT_BAYER12_BGGR_PACKED:
+        case PIXEL_FORMAT_BAYER12_BGGR_PACKED_MSFIRST: case PIXEL_FORMAT_BAYER10_BGGR_PACKED_MSFIRST:
+            redX = 1; redY = 1; break;
+        default:
+            break;
+        }
+        const U8* pTop = evenRow ? pRow : pOtherRow;
+        const U8* pBottom = evenRow ? pOtherRow : pRow;
+        for (U32 x = 0; x + 1 < width; x += 2)
+        {
+            U8 block[2][2] = {{sampleAt (pixelFormat, pTop, x, 0),    sampleAt (pixelFormat, pTop, x+1, 0)},
+                              {sampleAt (pixelFormat, pBottom, x, 0), sampleAt (pixelFormat, pBottom, x+1, 0)}};
+            U8 red   = block[redY][redX];
+            U8 blue  = block[1-redY][1-redX];
+            U8 green = (U8)((block[redY][1-redX] + block[1-redY][redX]) / 2);
+            for (int i = 0; i < 2; i++) { pRgb[3*(x+i)] = red; pRgb[3*(x+i)+1] = green; pRgb[3*(x+i)+2] = blue; }
+        }
+        return;
+    }
+
+    for (U32 x = 0; x < width; x++)
+    {
+        for (int c = 0; c < 3; c++) pRgb[3*x+c] = sampleAt (pixelFormat, pRow, x, c);
+    }
+}
+
+PXL_RETURN_CODE PXL_API PxLFormatImage (void const * pSrcFrame, FRAME_DESC const * pSrcFrameDesc, U32 outputFormat,
+                                        LPVOID pDestBuffer, U32* pDestBufferSize)
+{
+    if (NULL == pSrcFrame || NULL == pSrcFrameDesc || NULL == pDestBufferSize) return ApiNullPointerError;
+
+    //
+    // Step 1
+    //      What do we have, and how big will the result be?
+    U32 pixelFormat = (U32)pSrcFrameDesc->PixelFormat.fValue;
+    float paX = pSrcFrameDesc->PixelAddressingValue.fHorizontal >= 1.0f ? pSrcFrameDesc->PixelAddressingValue.fHorizontal : 1.0f;
+    float paY = pSrcFrameDesc->PixelAddressingValue.fVertical >= 1.0f ? pSrcFrameDesc->PixelAddressingValue.fVertical : 1.0f;
+    U32 width  = (U32)(pSrcFrameDesc->Roi.fWidth / paX);
+    U32 height = (U32)(pSrcFrameDesc->Roi.fHeight / paY);
+    U32 srcRowBytes = bytesForPixels (pixelFormat, width);
+    if (0 == srcRowBytes || 0 == width || 0 == height) return ApiUnsupportedPixelFormatError;
+
+    U32 bmpRowBytes = (width * 3 + 3) & ~3;
+    U32 bmpHeaderSize = 54;
+    U32 size;
+    switch (outputFormat)
+    {
+    case IMAGE_FORMAT_RAW_MONO8:       size = width * height; break;
+    case IMAGE_FORMAT_RAW_RGB24:
+    case IMAGE_FORMAT_RAW_RGB24_NON_DIB:
+    case IMAGE_FORMAT_RAW_BGR24:       size = width * height * 3; break;
+    case IMAGE_FORMAT_RAW_RGB48:       size = width * height * 6; break;
+    case IMAGE_FORMAT_BMP:             size = bmpHeaderSize + bmpRowBytes * height; break;
+    default:                           return ApiNotSupportedError;   // The compressed formats need the real API
+    }
+    if (NULL == pDestBuffer)
+    {
+        *pDestBufferSize = size;
+        return ApiSuccess;
+    }
+    if (*pDestBufferSize < size)
+    {
+        *pDestBufferSize = size;
+        return ApiBufferTooSmall;
+    }
+    *pDestBufferSize = size;
+
+    //
+    // Step 2
+    //      The BMP header (a BITMAPFILEHEADER, and a BITMAPINFOHEADER); all little endian
+    U8* pDest = (U8*)pDestBuffer;
+    if (IMAGE_FORMAT_BMP == outputFormat)
+    {
+        U32 fields[13] = {size, 0, bmpHeaderSize, 40, width, height, 0 /* planes & bpp */, 0, bmpRowBytes * height, 2835, 2835, 0, 0};
+        memset (pDest, 0, bmpHeaderSize);
+        pDest[0] = 'B'; pDest[1] = 'M';
+        for (int i = 0; i < 13; i++)
+        {
+            for (int b = 0; b < 4; b++) pDest[2 + 4*i + b] = (U8)(fields[i] >> (8*b));
+        }
+        pDest[26] = 1;    // planes
+        pDest[28] = 24;   // bits per pixel
+        pDest += bmpHeaderSize;
+    }
+
+    //
+    // Step 3
+    //      Convert each row
+    const U8* pSrc = (const U8*)pSrcFrame;
+    std::vector<U8> rgb(width * 3);
+    for (U32 y = 0; y < height; y++)
+    {
+        const U8* pRow = pSrc + y * srcRowBytes;
+        const U8* pOther = pSrc + ((y ^ 1) < height ? (y ^ 1) : y) * srcRowBytes;
+        loadRgbRow (pixelFormat, pRow, pOther, 0 == (y & 1), width, &rgb[0]);
+
+        U32 x;
+        switch (outputFormat)
+        {
+        case IMAGE_FORMAT_RAW_MONO8:
+            for (x = 0; x < width; x++) pDest[y*width + x] = (U8)((rgb[3*x] + 2*rgb[3*x+1] + rgb[3*x+2]) / 4);
+            break;
+        case IMAGE_FORMAT_RAW_RGB24_NON_DIB:
+            memcpy (&pDest[y*width*3], &rgb[0], width * 3);
+            break;
+        case IMAGE_FORMAT_RAW_BGR24:
+            for (x = 0; x < width; x++) { U8* p = &pDest[(y*width + x)*3]; p[0] = rgb[3*x+2]; p[1] = rgb[3*x+1]; p[2] = rgb[3*x]; }
+            break;
+        case IMAGE_FORMAT_RAW_RGB24:   // DIB:  BGR, bottom up
+        case IMAGE_FORMAT_BMP:
+        {
+            U8* pOut = &pDest[(height - 1 - y) * (IMAGE_FORMAT_BMP == outputFormat ? bmpRowBytes : width * 3)];
+            for (x = 0; x < width; x++) { pOut[3*x] = rgb[3*x+2]; pOut[3*x+1] = rgb[3*x+1]; pOut[3*x+2] = rgb[3*x]; }
+            break;
+        }
+        case IMAGE_FORMAT_RAW_RGB48:
+            for (x = 0; x < width * 3; x++) { pDest[(y*width*3 + x)*2] = 0; pDest[(y*width*3 + x)*2 + 1] = rgb[x]; }
+            break;
+        }
+    }
+
+    return ApiSuccess;
+}
+
+/* ---------------------------------------------------------------------------
+ * --   Not simulated
+ * ---------------------------------------------------------------------------
+ */
+
+PXL_RETURN_CODE PXL_API PxLGetNumberControllers (PCONTROLLER_INFO pControllerInfo, ULONG sizeofControllerInfo, PULONG pNumberControllerInfo)
+{
+    if (NULL == pNumberControllerInfo) return ApiNullPointerError;
+    *pNumberControllerInfo = 0;
+    return ApiSuccess;
+}
+
+PXL_RETURN_CODE PXL_API PxLSetCameraIpAddress (PXL_MAC_ADDRESS const * pCameraMac, PXL_IP_ADDRESS const * pCameraIp,
+                                               PXL_IP_ADDRESS const * pCameraSubnetMask, PXL_IP_ADDRESS const * pCameraDefaultGateway,
+                                               BOOL32 bPersistent)
+{
+    return ApiNotSupportedError;
+}
+
+PXL_RETURN_CODE PXL_API PxLAssignController (HANDLE hCamera, ULONG controllerSerialNum)
+{
+    return ApiNoControllerError;
+}
+
+PXL_RETURN_CODE PXL_API PxLUnassignController (HANDLE hCamera, ULONG controllerSerialNum)
+{
+    return ApiNoControllerError;
+}
+
+PXL_RETURN_CODE PXL_API PxLSetCameraName (HANDLE hCamera, LPCSTR pCameraName)
+{
+    return cameraFromHandle (hCamera) ? ApiSuccess : ApiInvalidHandleError;
+}
+
+PXL_RETURN_CODE PXL_API PxLGetEncodedClip (HANDLE hCamera, U32 numberOfFramesToCapture, LPCSTR pFileName, PCLIP_ENCODING_INFO pClipInfo,
+                                           U32 (PXL_APICALL * TerminationFunction)(HANDLE, U32, PXL_RETURN_CODE))
+{
+    return ApiNotSupportedError;
+}
+
+PXL_RETURN_CODE PXL_API PxLFormatClipEx (LPCSTR pInputFileName, LPCSTR pOutputFileName, U32 inputFormat, U32 outputFormat)
+{
+    return ApiNotSupportedError;
+}
+
+PXL_RETURN_CODE PXL_API PxLSetPreviewState (HANDLE hCamera, U32 previewState, HWND* pHWnd)
+{
+    return ApiNotSupportedError;
+}
+
+PXL_RETURN_CODE PXL_API PxLSetPreviewStateEx (HANDLE hCamera, U32 previewState, HWND* pHWnd, LPVOID pContext,
+                                              U32 (PXL_APICALL * ChangeFunction)(HANDLE, U32, LPVOID))
+{
+    return ApiNotSupportedError;
+}
+
+PXL_RETURN_CODE PXL_API PxLSetPreviewSettings (HANDLE hCamera, LPCSTR pTitle, U32 style, U32 left, U32 top, U32 width, U32 height,
+                                               HWND hParent, U32 childId)
+{
+    return ApiNotSupportedError;
+}
+
+PXL_RETURN_CODE PXL_API PxLResetPreviewWindow (HANDLE hCamera)
+{
+    return ApiNotSupportedError;
+}
+
+PXL_RETURN_CODE PXL_API PxLCameraRead (HANDLE hCamera, U32 bufferSize, U8* pBuffer)
+{
+    return ApiNotSupportedError;
+}
+
+PXL_RETURN_CODE PXL_API PxLCameraWrite (HANDLE hCamera, U32 bufferSize, const U8* pBuffer)
+{
+    return ApiNotSupportedError;
+}
+
+PXL_RETURN_CODE PXL_API PxLPrivateCmd (HANDLE hCamera, U32 bufferSize, U32* pBuffer)
+{
+    return ApiNotSupportedError;
+}
@@ -0,0 +1,525 @@
+/***************************************************************************
+ *
+ *     File: PxLTrace.cpp
+ *
+ *     Description:
+ *       An interposer for the PixeLINK API.  Preloaded ahead of libPxLApi.so,
+ *       it wraps every function of PixeLINKApi.h, timing each call, and
+ *       counting its return codes, per function and per camera.  The results
+ *       go to a shared memory segment (see PxLTrace.h), which pxltrace_dump
+ *       reads, while the program runs, or after it has finished:
+ *          LD_PRELOAD=<path to lib/PxLTrace/bin>/libPxLTrace.so ./getSnapshot
+ *          pxltrace_dump <pid>
+ *       So, any program using the API can be profiled, without recompiling it.
+ *
+ *       Time spent in the application's own callbacks (see PxLSetCallback) is
+ *       measured too, as the '(callback)' function; it is not included in
+ *       any API call's time.
+ *
+ *       Environment:
+ *          PXL_TRACE_SHM     Name of the shared memory segment (default /pxltrace-<pid>)
+ *          PXL_TRACE_RECORD  Also record the frames the program gets (from PxLGetNextFrame,
+ *                            and CALLBACK_FRAME callbacks) to <PXL_TRACE_RECORD>-<camera>.pxlrec;
+ *                            see PxLRecording.h.  Writing the frames is not counted in the
+ *                            calls' times, but it does slow the program down.
+ *
+ *       The cost of tracing a call is two reads of the monotonic clock, and a
+ *       handful of atomic adds; about 100 ns on a modern x86.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include "PxLTrace.h"
+#include "PxLRecording.h"
+
+#define MAX_CALLBACK_TYPES  8   // CALLBACK_PREVIEW ... ; one bit each
+
+static PXL_TRACE_SHARED* s_pShared = NULL;
+static pthread_once_t s_startOnce = PTHREAD_ONCE_INIT;
+static void* s_real[TRACE_FUNCTIONS_TOTAL];
+
+// API calls this thread is in.  The API may call its own exported functions (PxLInitialize calling PxLInitializeEx,
+// say); only the outermost call is traced.
+static __thread U32 s_depth = 0;
+
+// The application's callback, which our trampoline calls in its place
+typedef U32 (PXL_APICALL * PxLDataCallback)(HANDLE, LPVOID, U32, FRAME_DESC const *, LPVOID);
+typedef struct _TRACE_CALLBACK
+{
+    PxLDataCallback pFunction;
+    LPVOID          pContext;
+} TRACE_CALLBACK;
+static TRACE_CALLBACK s_callbacks[PXL_TRACE_MAX_CAMERAS][MAX_CALLBACK_TYPES];
+
+// PXL_TRACE_RECORD:  a recording of each camera's frames
+static pthread_mutex_t  s_recordMutex = PTHREAD_MUTEX_INITIALIZER;
+static PxLRecordWriter* s_pRecorders[PXL_TRACE_MAX_CAMERAS];
+static bool             s_recordFailed[PXL_TRACE_MAX_CAMERAS];
+
+static inline U64 nowNs ()
+{
+    struct timespec ts;
+    clock_gettime (CLOCK_MONOTONIC, &ts);
+    return (U64)ts.tv_sec * 1000000000ULL + (U64)ts.tv_nsec;
+}
+
+// Sets up the shared memory segment, on the first API call; so that other programs the traced one runs (which
+// inherit LD_PRELOAD) don't get one.  If that fails, calls are still passed through; they just aren't traced.
+static void startTrace ()
+{
+    char name[256];
+    const char* pName = getenv ("PXL_TRACE_SHM");
+    if (pName && *pName)
+    {
+        snprintf (name, sizeof(name), "%s%s", '/' == pName[0] ? "" : "/", pName);
+    } else {
+        snprintf (name, sizeof(name), "/pxltrace-%d", (int)getpid());
+    }
+
+    int fd = shm_open (name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+    if (fd < 0)
+    {
+        fprintf (stderr, "PxLTrace: could not create %s; not tracing\n", name);
+        return;
+    }
+    if (0 != ftruncate (fd, sizeof(PXL_TRACE_SHARED)))
+    {
+        close (fd);
+        fprintf (stderr, "PxLTrace: could not size %s; not tracing\n", name);
+        return;
+    }
+    void* pMap = mmap (NULL, sizeof(PXL_TRACE_SHARED), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close (fd);
+    if (MAP_FAILED == pMap)
+    {
+        fprintf (stderr, "PxLTrace: could not map %s; not tracing\n", name);
+        return;
+    }
+
+    PXL_TRACE_SHARED* pShared = (PXL_TRACE_SHARED*)pMap;
+    pShared->version = PXL_TRACE_VERSION;
+    pShared->pid = (U32)getpid();
+    pShared->numFunctions = TRACE_FUNCTIONS_TOTAL;
+    pShared->startNs = nowNs();
+    ssize_t length = readlink ("/proc/self/exe", pShared->program, sizeof(pShared->program) - 1);
+    pShared->program[length > 0 ? length : 0] = 0;
+    __sync_synchronize();
+    pShared->magic = PXL_TRACE_MAGIC;   // Last, so that a reader never sees a half built segment
+
+    s_pShared = pShared;
+    fprintf (stderr, "PxLTrace: tracing to /dev/shm%s\n", name);
+}
+
+// The real API function, from the next library in the search order (normally libPxLApi.so)
+static void* realFunction (PXL_TRACE_FUNCTION function)
+{
+    pthread_once (&s_startOnce, startTrace);
+    if (NULL == s_real[function])
+    {
+        s_real[function] = dlsym (RTLD_NEXT, s_pxlTraceFunctionNames[function]);
+    }
+    return s_real[function];
+}
+
+// The slot for a camera; the first call on a camera claims a slot for it.  Calls on a camera we have no slot for
+// (or on no camera at all) are counted in slot 0.
+static U32 cameraSlot (HANDLE hCamera)
+{
+    if (NULL == s_pShared || NULL == hCamera) return 0;
+
+    U64 handle = (U64)(size_t)hCamera;
+    for (U32 i = 1; i < PXL_TRACE_MAX_CAMERAS; i++)
+    {
+        U64 slotHandle = s_pShared->cameras[i].handle;
+        if (slotHandle == handle) return i;
+        if (0 == slotHandle && __sync_bool_compare_and_swap (&s_pShared->cameras[i].handle, 0, handle)) return i;
+        if (s_pShared->cameras[i].handle == handle) return i;   // Another thread claimed it for the same camera
+    }
+    return 0;
+}
+
+static inline U32 bucketFor (U64 ns)
+{
+    if (0 == ns) return 0;
+    U32 octave = 63 - __builtin_clzll (ns);
+    U32 fraction = octave >= 3 ? (U32)(ns >> (octave - 3)) & 7 : (U32)(ns << (3 - octave)) & 7;
+    U32 bucket = octave * PXL_TRACE_SUB_BUCKETS + fraction;
+    return bucket < PXL_TRACE_BUCKETS ? bucket : PXL_TRACE_BUCKETS - 1;
+}
+
+static void record (PXL_TRACE_FUNCTION function, U32 slot, U32 returnCode, U64 startNs)
+{
+    U64 elapsed = nowNs() - startNs;
+    if (NULL == s_pShared) return;
+
+    //
+    // Step 1
+    //      The statistics
+    PXL_TRACE_STATS& stats = s_pShared->cameras[slot].functions[function];
+    __sync_fetch_and_add (&stats.calls, 1);
+    if (TRACE_Callback != function && !API_SUCCESS (returnCode)) __sync_fetch_and_add (&stats.failures, 1);
+    __sync_fetch_and_add (&stats.totalNs, elapsed);
+    for (U64 max = stats.maxNs; elapsed > max; max = stats.maxNs)
+    {
+        if (__sync_bool_compare_and_swap (&stats.maxNs, max, elapsed)) break;
+    }
+    __sync_fetch_and_add (&stats.histogram[bucketFor (elapsed)], 1);
+
+    // Count the return code, claiming an entry for it if it's new
+    int i;
+    for (i = 0; i < PXL_TRACE_RETURN_CODES; i++)
+    {
+        PXL_TRACE_RETURN_CODE& entry = stats.returnCodes[i];
+        if (TRACE_CODE_FREE == entry.state &&
+            __sync_bool_compare_and_swap (&entry.state, TRACE_CODE_FREE, TRACE_CODE_CLAIMED))
+        {
+            entry.returnCode = returnCode;
+            __sync_synchronize();
+            entry.state = TRACE_CODE_USED;
+        }
+        while (TRACE_CODE_CLAIMED == *(volatile U32*)&entry.state);   // Another thread is filling it in
+        if (entry.returnCode == returnCode)
+        {
+            __sync_fetch_and_add (&entry.count, 1);
+            break;
+        }
+    }
+    if (i >= PXL_TRACE_RETURN_CODES) __sync_fetch_and_add (&stats.otherReturnCodes, 1);
+
+    //
+    // Step 2
+    //      The ring of recent calls.  The sequence word brackets the other fields, so that a reader can tell
+    //      if it copied the event while it was being written.
+    U64 index = __sync_fetch_and_add (&s_pShared->ringNext, 1);
+    PXL_TRACE_EVENT& event = s_pShared->ring[index & (PXL_TRACE_RING_SIZE - 1)];
+    *(volatile U64*)&event.sequence = 0;
+    __sync_synchronize();
+    event.startNs = startNs;
+    event.durationNs = elapsed > 0xFFFFFFFFULL ? 0xFFFFFFFF : (U32)elapsed;
+    event.returnCode = returnCode;
+    event.function = (U16)function;
+    event.camera = (U16)slot;
+    event.thread = (U32)syscall (SYS_gettid);
+    __sync_synchronize();
+    *(volatile U64*)&event.sequence = index + 1;   // Last
+}
+
+//
+// Adds a frame to its camera's recording (PXL_TRACE_RECORD), starting the recording with the camera's first frame.
+//
+static void recordFrame (U32 slot, HANDLE hCamera, const void* pFrame, U32 frameSize, U32 pixelFormat, const FRAME_DESC* pFrameDesc)
+{
+    const char* pRoot = getenv ("PXL_TRACE_RECORD");
+    if (NULL == pRoot || 0 == *pRoot || 0 == frameSize) return;
+
+    pthread_mutex_lock (&s_recordMutex);
+    if (NULL == s_pRecorders[slot] && !s_recordFailed[slot])
+    {
+        char fileName[1024];
+        snprintf (fileName, sizeof(fileName), "%s-%u.pxlrec", pRoot, slot);
+
+        // The camera's model, for the recording's description; the call isn't traced
+        typedef PXL_RETURN_CODE (PXL_APICALL * GET_CAMERA_INFO)(HANDLE, CAMERA_INFO*);
+        GET_CAMERA_INFO pGetCameraInfo = (GET_CAMERA_INFO)realFunction (TRACE_GetCameraInfo);
+        CAMERA_INFO info;
+        memset (&info, 0, sizeof(info));
+        s_depth++;
+        if (pGetCameraInfo && hCamera) pGetCameraInfo (hCamera, &info);
+        s_depth--;
+
+        PxLRecordWriter* pRecorder = new PxLRecordWriter();
+        U32 serialNumber = s_pShared ? s_pShared->cameras[slot].serialNumber : 0;
+        if (0 == serialNumber) serialNumber = (U32)atoi ((const char*)info.SerialNumber);
+        if (pRecorder->open (fileName, serialNumber, (const char*)info.ModelName))
+        {
+            s_pRecorders[slot] = pRecorder;
+            fprintf (stderr, "PxLTrace: recording frames to %s\n", fileName);
+        } else {
+            delete pRecorder;
+            s_recordFailed[slot] = true;
+            fprintf (stderr, "PxLTrace: could not create %s; not recording\n", fileName);
+        }
+    }
+    PxLRecordWriter* pRecorder = s_pRecorders[slot];
+    pthread_mutex_unlock (&s_recordMutex);
+
+    if (pRecorder) pRecorder->addFrame (pFrame, frameSize, pixelFormat, pFrameDesc);
+}
+
+// Finishes the recordings (writing their indexes) as the program exits
+__attribute__((destructor)) static void stopRecording ()
+{
+    pthread_mutex_lock (&s_recordMutex);
+    for (int i = 0; i < PXL_TRACE_MAX_CAMERAS; i++)
+    {
+        if (NULL == s_pRecorders[i]) continue;
+        fprintf (stderr, "PxLTrace: recorded %llu frames of camera %d\n", (unsigned long long)s_pRecorders[i]->frameCount(), i);
+        delete s_pRecorders[i];
+        s_pRecorders[i] = NULL;
+    }
+    pthread_mutex_unlock (&s_recordMutex);
+}
+
+/* ---------------------------------------------------------------------------
+ * --   The wrappers
+ * ---------------------------------------------------------------------------
+ */
+
+// A wrapper for PxL<function>, for functions that need nothing more than timing.  params is the parameter list,
+// args the same, as arguments, and hCameraArg the camera the call is on (NULL if none).
+#define TRACE_WRAPPER(function, params, args, hCameraArg)                          \
+    PXL_RETURN_CODE PXL_API PxL##function params                                   \
+    {                                                                              \
+        typedef PXL_RETURN_CODE (PXL_APICALL * REAL_FUNCTION) params;              \
+        REAL_FUNCTION pReal = (REAL_FUNCTION)realFunction (TRACE_##function);      \
+        if (NULL == pReal) return ApiNotSupportedError;                            \
+        if (s_depth) return pReal args;                                            \
+        U32 slot = cameraSlot (hCameraArg);                                        \
+        s_depth++;                                                                 \
+        U64 start = nowNs();                                                       \
+        PXL_RETURN_CODE rc = pReal args;                                           \
+        record (TRACE_##function, slot, (U32)rc, start);                           \
+        s_depth--;                                                                 \
+        return rc;                                                                 \
+    }
+
+TRACE_WRAPPER (GetNumberCameras,
+               (U32* pSerialNumbers, U32* pNumberSerialNumbers),
+               (pSerialNumbers, pNumberSerialNumbers), NULL)
+TRACE_WRAPPER (GetNumberCamerasEx,
+               (CAMERA_ID_INFO* pCameraIdInfo, U32* pNumberCameraIdInfos),
+               (pCameraIdInfo, pNumberCameraIdInfos), NULL)
+TRACE_WRAPPER (GetNumberControllers,
+               (PCONTROLLER_INFO pControllerInfo, ULONG sizeofControllerInfo, PULONG pNumberControllerInfo),
+               (pControllerInfo, sizeofControllerInfo, pNumberControllerInfo), NULL)
+TRACE_WRAPPER (SetCameraIpAddress,
+               (PXL_MAC_ADDRESS const * pCameraMac, PXL_IP_ADDRESS const * pCameraIp, PXL_IP_ADDRESS const * pCameraSubnetMask,
+                PXL_IP_ADDRESS const * pCameraDefaultGateway, BOOL32 bPersistent),
+               (pCameraMac, pCameraIp, pCameraSubnetMask, pCameraDefaultGateway, bPersistent), NULL)
+TRACE_WRAPPER (Uninitialize,
+               (HANDLE hCamera),
+               (hCamera), hCamera)
+TRACE_WRAPPER (AssignController,
+               (HANDLE hCamera, ULONG controllerSerialNum),
+               (hCamera, controllerSerialNum), hCamera)
+TRACE_WRAPPER (UnassignController,
+               (HANDLE hCamera, ULONG controllerSerialNum),
+               (hCamera, controllerSerialNum), hCamera)
+TRACE_WRAPPER (GetCameraInfo,
+               (HANDLE hCamera, CAMERA_INFO* pInformation),
+               (hCamera, pInformation), hCamera)
+TRACE_WRAPPER (GetCameraInfoEx,
+               (HANDLE hCamera, CAMERA_INFO* pInformation, U32 informationSize),
+               (hCamera, pInformation, informationSize), hCamera)
+TRACE_WRAPPER (GetCameraFeatures,
+               (HANDLE hCamera, U32 featureId, CAMERA_FEATURES* pFeatureInfo, U32* pBufferSize),
+               (hCamera, featureId, pFeatureInfo, pBufferSize), hCamera)
+TRACE_WRAPPER (GetFeature,
+               (HANDLE hCamera, U32 featureId, U32* pFlags, U32* pNumberOfParams, F32* pParams),
+               (hCamera, featureId, pFlags, pNumberOfParams, pParams), hCamera)
+TRACE_WRAPPER (SetFeature,
+               (HANDLE hCamera, U32 featureId, U32 flags, U32 numberOfParams, F32 const * pParams),
+               (hCamera, featureId, flags, numberOfParams, pParams), hCamera)
+TRACE_WRAPPER (GetCurrentTimestamp,
+               (HANDLE hCamera, double* pCurrentTimestamp),
+               (hCamera, pCurrentTimestamp), hCamera)
+TRACE_WRAPPER (SetCameraName,
+               (HANDLE hCamera, LPCSTR pCameraName),
+               (hCamera, pCameraName), hCamera)
+TRACE_WRAPPER (GetErrorReport,
+               (HANDLE hCamera, ERROR_REPORT* pErrorReport),
+               (hCamera, pErrorReport), hCamera)
+TRACE_WRAPPER (SaveSettings,
+               (HANDLE hCamera, U32 channelNumber),
+               (hCamera, channelNumber), hCamera)
+TRACE_WRAPPER (LoadSettings,
+               (HANDLE hCamera, U32 channelNumber),
+               (hCamera, channelNumber), hCamera)
+TRACE_WRAPPER (CreateDescriptor,
+               (HANDLE hCamera, HANDLE* pDescriptorHandle, U32 updateMode),
+               (hCamera, pDescriptorHandle, updateMode), hCamera)
+TRACE_WRAPPER (RemoveDescriptor,
+               (HANDLE hCamera, HANDLE hDescriptor),
+               (hCamera, hDescriptor), hCamera)
+TRACE_WRAPPER (UpdateDescriptor,
+               (HANDLE hCamera, HANDLE hDescriptor, U32 updateMode),
+               (hCamera, hDescriptor, updateMode), hCamera)
+TRACE_WRAPPER (SetStreamState,
+               (HANDLE hCamera, U32 streamState),
+               (hCamera, streamState), hCamera)
+TRACE_WRAPPER (FormatImage,
+               (void const * pSrcFrame, FRAME_DESC const * pSrcFrameDesc, U32 outputFormat, LPVOID pDestBuffer, U32* pDestBufferSize),
+               (pSrcFrame, pSrcFrameDesc, outputFormat, pDestBuffer, pDestBufferSize), NULL)
+TRACE_WRAPPER (GetClip,
+               (HANDLE hCamera, U32 numberOfFramesToCapture, LPCSTR pFileName,
+                U32 (PXL_APICALL * TerminationFunction)(HANDLE, U32, PXL_RETURN_CODE)),
+               (hCamera, numberOfFramesToCapture, pFileName, TerminationFunction), hCamera)
+TRACE_WRAPPER (GetEncodedClip,
+               (HANDLE hCamera, U32 numberOfFramesToCapture, LPCSTR pFileName, PCLIP_ENCODING_INFO pClipInfo,
+                U32 (PXL_APICALL * TerminationFunction)(HANDLE, U32, PXL_RETURN_CODE)),
+               (hCamera, numberOfFramesToCapture, pFileName, pClipInfo, TerminationFunction), hCamera)
+TRACE_WRAPPER (FormatClip,
+               (LPCSTR pInputFileName, LPCSTR pOutputFileName, U32 outputFormat),
+               (pInputFileName, pOutputFileName, outputFormat), NULL)
+TRACE_WRAPPER (FormatClipEx,
+               (LPCSTR pInputFileName, LPCSTR pOutputFileName, U32 inputFormat, U32 outputFormat),
+               (pInputFileName, pOutputFileName, inputFormat, outputFormat), NULL)
+TRACE_WRAPPER (SetPreviewState,
+               (HANDLE hCamera, U32 previewState, HWND* pHWnd),
+               (hCamera, previewState, pHWnd), hCamera)
+TRACE_WRAPPER (SetPreviewStateEx,
+               (HANDLE hCamera, U32 previewState, HWND* pHWnd, LPVOID pContext, U32 (PXL_APICALL * ChangeFunction)(HANDLE, U32, LPVOID)),
+               (hCamera, previewState, pHWnd, pContext, ChangeFunction), hCamera)
+TRACE_WRAPPER (SetPreviewSettings,
+               (HANDLE hCamera, LPCSTR pTitle, U32 style, U32 left, U32 top, U32 width, U32 height, HWND hParent, U32 childId),
+               (hCamera, pTitle, style, left, top, width, height, hParent, childId), hCamera)
+TRACE_WRAPPER (ResetPreviewWindow,
+               (HANDLE hCamera),
+               (hCamera), hCamera)
+TRACE_WRAPPER (Debug,
+               (HANDLE hCamera, U16 requestType, U32 offsetHigh, U32 offsetLow, U32 bufferSize, U8* pBuffer),
+               (hCamera, requestType, offsetHigh, offsetLow, bufferSize, pBuffer), hCamera)
+TRACE_WRAPPER (CameraRead,
+               (HANDLE hCamera, U32 bufferSize, U8* pBuffer),
+               (hCamera, bufferSize, pBuffer), hCamera)
+TRACE_WRAPPER (CameraWrite,
+               (HANDLE hCamera, U32 bufferSize, const U8* pBuffer),
+               (hCamera, bufferSize, pBuffer), hCamera)
+TRACE_WRAPPER (PrivateCmd,
+               (HANDLE hCamera, U32 bufferSize, U32* pBuffer),
+               (hCamera, bufferSize, pBuffer), hCamera)
+
+//
+// Initializing a camera claims it a slot, and notes its serial number, so that the dump can tell the cameras apart.
+//
+PXL_RETURN_CODE PXL_API PxLInitializeEx (U32 serialNumber, HANDLE* phCamera, U32 flags)
+{
+    typedef PXL_RETURN_CODE (PXL_APICALL * REAL_FUNCTION)(U32, HANDLE*, U32);
+    REAL_FUNCTION pReal = (REAL_FUNCTION)realFunction (TRACE_InitializeEx);
+    if (NULL == pReal) return ApiNotSupportedError;
+
+    if (s_depth) return pReal (serialNumber, phCamera, flags);
+
+    s_depth++;
+    U64 start = nowNs();
+    PXL_RETURN_CODE rc = pReal (serialNumber, phCamera, flags);
+    U32 slot = API_SUCCESS (rc) && phCamera ? cameraSlot (*phCamera) : 0;
+    record (TRACE_InitializeEx, slot, (U32)rc, start);
+    s_depth--;
+
+    if (slot && s_pShared) s_pShared->cameras[slot].serialNumber = serialNumber;
+    return rc;
+}
+
+PXL_RETURN_CODE PXL_API PxLInitialize (U32 serialNumber, HANDLE* phCamera)
+{
+    typedef PXL_RETURN_CODE (PXL_APICALL * REAL_FUNCTION)(U32, HANDLE*);
+    REAL_FUNCTION pReal = (REAL_FUNCTION)realFunction (TRACE_Initialize);
+    if (NULL == pReal) return ApiNotSupportedError;
+
+    if (s_depth) return pReal (serialNumber, phCamera);
+
+    s_depth++;
+    U64 start = nowNs();
+    PXL_RETURN_CODE rc = pReal (serialNumber, phCamera);
+    U32 slot = API_SUCCESS (rc) && phCamera ? cameraSlot (*phCamera) : 0;
+    record (TRACE_Initialize, slot, (U32)rc, start);
+    s_depth--;
+
+    if (slot && s_pShared) s_pShared->cameras[slot].serialNumber = serialNumber;
+    return rc;
+}
+
+//
+// As well as being timed, frames can be recorded (PXL_TRACE_RECORD)
+//
+PXL_RETURN_CODE PXL_API PxLGetNextFrame (HANDLE hCamera, U32 bufferSize, LPVOID pFrame, FRAME_DESC* pFrameDesc)
+{
+    typedef PXL_RETURN_CODE (PXL_APICALL * REAL_FUNCTION)(HANDLE, U32, LPVOID, FRAME_DESC*);
+    REAL_FUNCTION pReal = (REAL_FUNCTION)realFunction (TRACE_GetNextFrame);
+    if (NULL == pReal) return ApiNotSupportedError;
+    if (s_depth) return pReal (hCamera, bufferSize, pFrame, pFrameDesc);
+
+    U32 slot = cameraSlot (hCamera);
+    s_depth++;
+    U64 start = nowNs();
+    PXL_RETURN_CODE rc = pReal (hCamera, bufferSize, pFrame, pFrameDesc);
+    record (TRACE_GetNextFrame, slot, (U32)rc, start);
+    s_depth--;
+
+    if (API_SUCCESS (rc))
+    {
+        U32 pixelFormat = (U32)pFrameDesc->PixelFormat.fValue;
+        U32 frameSize = pxlRecordingFrameSize (pixelFormat, pFrameDesc);
+        recordFrame (slot, hCamera, pFrame, frameSize && frameSize < bufferSize ? frameSize : bufferSize, pixelFormat, pFrameDesc);
+    }
+    return rc;
+}
+
+// Calls the application's callback, timing it, and recording the frames of frame callbacks
+static U32 PXL_APICALL CallbackTrampoline (HANDLE hCamera, LPVOID pFrameData, U32 dataFormat, FRAME_DESC const * pFrameDesc, LPVOID pContext)
+{
+    const TRACE_CALLBACK* pCallback = (const TRACE_CALLBACK*)pContext;
+    U32 slot = (U32)((pCallback - &s_callbacks[0][0]) / MAX_CALLBACK_TYPES);
+    U32 type = (U32)((pCallback - &s_callbacks[0][0]) % MAX_CALLBACK_TYPES);
+
+    // Before the callback has a chance to modify the frame
+    if ((1U << type) == CALLBACK_FRAME)
+    {
+        recordFrame (slot, hCamera, pFrameData, pxlRecordingFrameSize (dataFormat, pFrameDesc), dataFormat, pFrameDesc);
+    }
+
+    // The callback may be called from within an API call, on the caller's thread; API calls the callback makes are
+    // the application's, so they're traced.
+    U32 depth = s_depth;
+    s_depth = 0;
+    U64 start = nowNs();
+    U32 rc = pCallback->pFunction (hCamera, pFrameData, dataFormat, pFrameDesc, pCallback->pContext);
+    record (TRACE_Callback, slot, rc, start);
+    s_depth = depth;
+    return rc;
+}
+
+//
+// The application's callback is replaced with CallbackTrampoline, so that the time spent in it can be measured.
+// Only callbacks on a camera with a slot, and of a single type, are timed; others are passed straight through.
+//
+PXL_RETURN_CODE PXL_API PxLSetCallback (HANDLE hCamera, U32 callbackType, LPVOID pContext,
+                                        U32 (PXL_APICALL * DataProcessFunction)(HANDLE, LPVOID, U32, FRAME_DESC const *, LPVOID))
+{
+    typedef PXL_RETURN_CODE (PXL_APICALL * REAL_FUNCTION)(HANDLE, U32, LPVOID, PxLDataCallback);
+    REAL_FUNCTION pReal = (REAL_FUNCTION)realFunction (TRACE_SetCallback);
+    if (NULL == pReal) return ApiNotSupportedError;
+
+    U32 slot = cameraSlot (hCamera);
+    int type = callbackType && 0 == (callbackType & (callbackType - 1)) ? __builtin_ctz (callbackType) : MAX_CALLBACK_TYPES;
+    PxLDataCallback pFunction = DataProcessFunction;
+    LPVOID pRealContext = pContext;
+    if (slot && type < MAX_CALLBACK_TYPES && DataProcessFunction)
+    {
+        TRACE_CALLBACK* pCallback = &s_callbacks[slot][type];
+        pCallback->pFunction = DataProcessFunction;
+        pCallback->pContext = pContext;
+        __sync_synchronize();
+        pFunction = CallbackTrampoline;
+        pRealContext = pCallback;
+    }
+
+    if (s_depth) return pReal (hCamera, callbackType, pRealContext, pFunction);
+
+    s_depth++;
+    U64 start = nowNs();
+    PXL_RETURN_CODE rc = pReal (hCamera, callbackType, pRealContext, pFunction);
+    record (TRACE_SetCallback, slot, (U32)rc, start);
+    s_depth--;
+    return rc;
+}
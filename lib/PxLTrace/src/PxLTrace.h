@@ -0,0 +1,186 @@
+/***************************************************************************
+ *
+ *     File: PxLTrace.h
+ *
+ *     Description:
+ *       The shared memory layout written by the PxLTrace interposer
+ *       (libPxLTrace.so), and read by pxltrace_dump.
+ *
+ *       The segment is /dev/shm/pxltrace-<pid> (or PXL_TRACE_SHM, if that is
+ *       set).  It is created by the first API call, and is left in place when the traced program exits, so that it
+ *       can be dumped afterwards.  pxltrace_dump -u removes it.
+ *
+ *       The statistics are updated with atomic operations, so they can be read
+ *       while the program is running; a reader may see one call's count
+ *       without its histogram entry, but never a torn value.  The events in the
+ *       ring of recent calls are written with plain stores, but each has a
+ *       sequence word that is written last; a reader copies the event, and
+ *       only uses the copy if the sequence word is the one it expected, both
+ *       before and after the copy.
+ */
+
+#if !defined(PIXELINK_PXLTRACE_H)
+#define PIXELINK_PXLTRACE_H
+
+#include "PixeLINKApi.h"
+
+#define PXL_TRACE_MAGIC            0x50784C54   // 'PxLT'
+#define PXL_TRACE_VERSION          2
+
+#define PXL_TRACE_MAX_CAMERAS      8            // Slot 0 is for calls that aren't on a camera (PxLFormatImage, ...)
+#define PXL_TRACE_SUB_BUCKETS      8            // Latency histogram:  8 buckets an octave, from 1 ns ...
+#define PXL_TRACE_BUCKETS          320          // ... to about 18 minutes
+#define PXL_TRACE_RETURN_CODES     6            // Distinct return codes counted, per function
+#define PXL_TRACE_RING_SIZE        4096         // Most recent calls (a power of 2)
+
+// The traced functions.  Keep in step with s_pxlTraceFunctionNames.
+typedef enum _PXL_TRACE_FUNCTION
+{
+    TRACE_GetNumberCameras,
+    TRACE_GetNumberCamerasEx,
+    TRACE_GetNumberControllers,
+    TRACE_SetCameraIpAddress,
+    TRACE_Initialize,
+    TRACE_InitializeEx,
+    TRACE_Uninitialize,
+    TRACE_AssignController,
+    TRACE_UnassignController,
+    TRACE_GetCameraInfo,
+    TRACE_GetCameraInfoEx,
+    TRACE_GetCameraFeatures,
+    TRACE_GetFeature,
+    TRACE_SetFeature,
+    TRACE_GetCurrentTimestamp,
+    TRACE_SetCameraName,
+    TRACE_GetErrorReport,
+    TRACE_SaveSettings,
+    TRACE_LoadSettings,
+    TRACE_CreateDescriptor,
+    TRACE_RemoveDescriptor,
+    TRACE_UpdateDescriptor,
+    TRACE_SetStreamState,
+    TRACE_GetNextFrame,
+    TRACE_FormatImage,
+    TRACE_SetCallback,
+    TRACE_GetClip,
+    TRACE_GetEncodedClip,
+    TRACE_FormatClip,
+    TRACE_FormatClipEx,
+    TRACE_SetPreviewState,
+    TRACE_SetPreviewStateEx,
+    TRACE_SetPreviewSettings,
+    TRACE_ResetPreviewWindow,
+    TRACE_Debug,
+    TRACE_CameraRead,
+    TRACE_CameraWrite,
+    TRACE_PrivateCmd,
+    TRACE_Callback,             // Time spent in the application's callbacks (CALLBACK_FRAME, ...), not an API call
+    TRACE_FUNCTIONS_TOTAL
+} PXL_TRACE_FUNCTION;
+
+static const char* const s_pxlTraceFunctionNames[TRACE_FUNCTIONS_TOTAL] = {
+    "PxLGetNumberCameras",
+    "PxLGetNumberCamerasEx",
+    "PxLGetNumberControllers",
+    "PxLSetCameraIpAddress",
+    "PxLInitialize",
+    "PxLInitializeEx",
+    "PxLUninitialize",
+    "PxLAssignController",
+    "PxLUnassignController",
+    "PxLGetCameraInfo",
+    "PxLGetCameraInfoEx",
+    "PxLGetCameraFeatures",
+    "PxLGetFeature",
+    "PxLSetFeature",
+    "PxLGetCurrentTimestamp",
+    "PxLSetCameraName",
+    "PxLGetErrorReport",
+    "PxLSaveSettings",
+    "PxLLoadSettings",
+    "PxLCreateDescriptor",
+    "PxLRemoveDescriptor",
+    "PxLUpdateDescriptor",
+    "PxLSetStreamState",
+    "PxLGetNextFrame",
+    "PxLFormatImage",
+    "PxLSetCallback",
+    "PxLGetClip",
+    "PxLGetEncodedClip",
+    "PxLFormatClip",
+    "PxLFormatClipEx",
+    "PxLSetPreviewState",
+    "PxLSetPreviewStateEx",
+    "PxLSetPreviewSettings",
+    "PxLResetPreviewWindow",
+    "PxLDebug",
+    "PxLCameraRead",
+    "PxLCameraWrite",
+    "PxLPrivateCmd",
+    "(callback)"
+};
+
+#define TRACE_CODE_FREE     0
+#define TRACE_CODE_CLAIMED  1   // Being filled in
+#define TRACE_CODE_USED     2
+
+typedef struct _PXL_TRACE_RETURN_CODE
+{
+    U32 state;                  // TRACE_CODE_FREE, ...
+    U32 returnCode;
+    U64 count;
+} PXL_TRACE_RETURN_CODE;
+
+// The statistics for one function, on one camera
+typedef struct _PXL_TRACE_STATS
+{
+    U64 calls;
+    U64 failures;               // Calls where !API_SUCCESS(rc)
+    U64 totalNs;
+    U64 maxNs;
+    U32 histogram[PXL_TRACE_BUCKETS];
+    PXL_TRACE_RETURN_CODE returnCodes[PXL_TRACE_RETURN_CODES];
+    U64 otherReturnCodes;       // Calls whose return code didn't fit in returnCodes
+} PXL_TRACE_STATS;
+
+typedef struct _PXL_TRACE_CAMERA
+{
+    U64 handle;                 // 0 if the slot is unused
+    U32 serialNumber;           // 0 if not known (the camera was opened before the trace started)
+    U32 reserved;
+    PXL_TRACE_STATS functions[TRACE_FUNCTIONS_TOTAL];
+} PXL_TRACE_CAMERA;
+
+// One call, in the ring of recent calls
+typedef struct _PXL_TRACE_EVENT
+{
+    U64 sequence;               // 1 + the call's index (see ringNext); 0 while the event is being written
+    U64 startNs;                // CLOCK_MONOTONIC
+    U32 durationNs;             // Saturates at 0xFFFFFFFF (about 4.3 seconds)
+    U32 returnCode;
+    U16 function;
+    U16 camera;
+    U32 thread;                 // The caller's thread id
+} PXL_TRACE_EVENT;
+
+typedef struct _PXL_TRACE_SHARED
+{
+    U32 magic;
+    U32 version;
+    U32 pid;
+    U32 numFunctions;           // TRACE_FUNCTIONS_TOTAL, as built
+    U64 startNs;                // When tracing started (CLOCK_MONOTONIC)
+    char program[256];
+    U64 ringNext;               // Total events written; the newest is ring[(ringNext-1) % PXL_TRACE_RING_SIZE]
+    PXL_TRACE_CAMERA cameras[PXL_TRACE_MAX_CAMERAS];
+    PXL_TRACE_EVENT ring[PXL_TRACE_RING_SIZE];
+} PXL_TRACE_SHARED;
+
+// The lower bound (in ns) of a histogram bucket
+static inline double pxlTraceBucketNs (U32 bucket)
+{
+    U32 octave = bucket / PXL_TRACE_SUB_BUCKETS;
+    return (double)(1ULL << octave) * (1.0 + (double)(bucket % PXL_TRACE_SUB_BUCKETS) / (double)PXL_TRACE_SUB_BUCKETS);
+}
+
+#endif // !defined(PIXELINK_PXLTRACE_H)
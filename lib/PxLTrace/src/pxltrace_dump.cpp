@@ -0,0 +1,269 @@
+/***************************************************************************
+ *
+ *     File: pxltrace_dump.cpp
+ *
+ *     Description:
+ *       Prints the PixeLINK API call statistics gathered by libPxLTrace.so
+ *       (see PxLTrace.cpp):  for each camera, and each API function called,
+ *       the number of calls, failures, the latency (mean, median, 99th
+ *       percentile and maximum), and the return codes seen.  Optionally,
+ *       the most recent calls too.
+ *
+ *       It can be run while the traced program is running, or after.
+ *
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "PxLTrace.h"
+
+#define A_OK            0  // non-zero error codes
+#define GENERAL_ERROR   1
+
+typedef struct _USER_PARAMETERS
+{
+    U32  recentCalls;   // Number of the most recent calls to print
+    bool unlink;        // Remove the segment, once printed
+    const char* name;   // NULL to list the segments
+} USER_PARAMETERS;
+
+static void usage (char** argv);
+static int  getParameters (int argc, char* argv[], USER_PARAMETERS* pParms);
+static int  listSegments ();
+static void printStats (const PXL_TRACE_SHARED* pShared);
+static void printRecent (const PXL_TRACE_SHARED* pShared, U32 recentCalls);
+
+int main (int argc, char* argv[])
+{
+    USER_PARAMETERS parms;
+
+    //
+    // Step 1
+    //      Validate the user parameters
+    if (A_OK != getParameters (argc, argv, &parms))
+    {
+        usage (argv);
+        return GENERAL_ERROR;
+    }
+    if (NULL == parms.name) return listSegments();
+
+    //
+    // Step 2
+    //      Map the segment; a pid is short for /pxltrace-<pid>
+    char name[256];
+    if (isdigit (parms.name[0]))
+    {
+        snprintf (name, sizeof(name), "/pxltrace-%s", parms.name);
+    } else {
+        snprintf (name, sizeof(name), "%s%s", '/' == parms.name[0] ? "" : "/", parms.name);
+    }
+    int fd = shm_open (name, O_RDONLY, 0);
+    if (fd < 0)
+    {
+        printf (" Error:  Could not open /dev/shm%s\n", name);
+        return GENERAL_ERROR;
+    }
+    struct stat info;
+    if (0 != fstat (fd, &info) || info.st_size < (off_t)sizeof(PXL_TRACE_SHARED))
+    {
+        close (fd);
+        printf (" Error:  /dev/shm%s is not a PxLTrace segment\n", name);
+        return GENERAL_ERROR;
+    }
+    const PXL_TRACE_SHARED* pShared =
+        (const PXL_TRACE_SHARED*)mmap (NULL, sizeof(PXL_TRACE_SHARED), PROT_READ, MAP_SHARED, fd, 0);
+    close (fd);
+    if (MAP_FAILED == (void*)pShared ||
+        PXL_TRACE_MAGIC != pShared->magic ||
+        PXL_TRACE_VERSION != pShared->version ||
+        TRACE_FUNCTIONS_TOTAL != pShared->numFunctions)
+    {
+        printf (" Error:  /dev/shm%s is not a PxLTrace segment, or is from a different version\n", name);
+        return GENERAL_ERROR;
+    }
+
+    //
+    // Step 3
+    //      Print it
+    bool running = (0 == kill ((pid_t)pShared->pid, 0));
+    printf ("\n %s (pid %u, %s)\n", pShared->program, pShared->pid, running ? "running" : "finished");
+    printStats (pShared);
+    if (parms.recentCalls) printRecent (pShared, parms.recentCalls);
+
+    munmap ((void*)pShared, sizeof(PXL_TRACE_SHARED));
+    if (parms.unlink) shm_unlink (name);
+
+    return A_OK;
+}
+
+static void usage (char** argv)
+{
+    printf ("\n Prints the PixeLINK API call statistics, gathered by libPxLTrace.so\n\n");
+    printf ("    Usage: %s [-r recent_calls] [-u] [segment]\n", argv[0]);
+    printf ("       where: \n");
+    printf ("          -r recent_calls  Also print this many of the most recent calls (up to %d)\n", PXL_TRACE_RING_SIZE);
+    printf ("          -u               Remove the segment, once printed\n");
+    printf ("          segment          The pid of the traced program, or the PXL_TRACE_SHM it used.\n");
+    printf ("                           With no segment, the segments available are listed.\n");
+    printf ("    Example: \n");
+    printf ("        LD_PRELOAD=libPxLTrace.so ./getSnapshot\n");
+    printf ("        %s -r 20 -u 12345 \n", argv[0]);
+}
+
+static int getParameters (int argc, char* argv[], USER_PARAMETERS* pParms)
+{
+    //
+    // Step 1
+    //      Set our defaults
+    pParms->recentCalls = 0;
+    pParms->unlink = false;
+    pParms->name = NULL;
+
+    //
+    // Step 2
+    //      Parse the command line
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp (argv[i], "-r") || !strcmp (argv[i], "-R"))
+        {
+            if (i + 1 >= argc) return GENERAL_ERROR;
+            int parm = atoi (argv[++i]);
+            if (parm < 1 || parm > PXL_TRACE_RING_SIZE) return GENERAL_ERROR;
+            pParms->recentCalls = (U32)parm;
+        } else if (!strcmp (argv[i], "-u") || !strcmp (argv[i], "-U")) {
+            pParms->unlink = true;
+        } else if ('-' != argv[i][0] && NULL == pParms->name) {
+            pParms->name = argv[i];
+        } else {
+            return GENERAL_ERROR;
+        }
+    }
+
+    return A_OK;
+}
+
+static int listSegments ()
+{
+    DIR* pDir = opendir ("/dev/shm");
+    if (NULL == pDir)
+    {
+        printf (" Error:  Could not read /dev/shm\n");
+        return GENERAL_ERROR;
+    }
+
+    printf ("\n PxLTrace segments (those named with PXL_TRACE_SHM are not listed):\n");
+    int found = 0;
+    for (struct dirent* pEntry = readdir (pDir); pEntry; pEntry = readdir (pDir))
+    {
+        if (0 != strncmp (pEntry->d_name, "pxltrace-", 9)) continue;
+        printf ("    /dev/shm/%s\n", pEntry->d_name);
+        found++;
+    }
+    closedir (pDir);
+    if (0 == found) printf ("    (none)\n");
+
+    return A_OK;
+}
+
+// The latency (in us) below which the given fraction of calls completed
+static double percentileUs (const PXL_TRACE_STATS& stats, double fraction)
+{
+    U64 total = 0;
+    for (int b = 0; b < PXL_TRACE_BUCKETS; b++) total += stats.histogram[b];
+    if (0 == total) return 0.0;
+
+    U64 target = (U64)(fraction * (double)total);
+    U64 seen = 0;
+    for (int b = 0; b < PXL_TRACE_BUCKETS; b++)
+    {
+        seen += stats.histogram[b];
+        if (seen > target)
+        {
+            // The middle of the bucket
+            double low = pxlTraceBucketNs (b);
+            double high = b + 1 < PXL_TRACE_BUCKETS ? pxlTraceBucketNs (b + 1) : low;
+            double middle = (low + high) / 2.0;
+            return (middle < (double)stats.maxNs ? middle : (double)stats.maxNs) / 1000.0;
+        }
+    }
+    return (double)stats.maxNs / 1000.0;
+}
+
+static void printStats (const PXL_TRACE_SHARED* pShared)
+{
+    for (int c = 0; c < PXL_TRACE_MAX_CAMERAS; c++)
+    {
+        const PXL_TRACE_CAMERA& camera = pShared->cameras[c];
+        bool any = false;
+        for (int f = 0; f < TRACE_FUNCTIONS_TOTAL && !any; f++) any = camera.functions[f].calls > 0;
+        if (!any) continue;
+
+        if (0 == c)
+        {
+            printf ("\n Not on a camera (or more cameras than the trace has room for):\n");
+        } else if (camera.serialNumber) {
+            printf ("\n Camera %d (serial number %u):\n", c, camera.serialNumber);
+        } else {
+            printf ("\n Camera %d (handle 0x%llx):\n", c, (unsigned long long)camera.handle);
+        }
+        printf ("  %-24s %10s %8s | %10s %10s %10s %10s | %s\n",
+                "function", "calls", "failed", "mean us", "p50 us", "p99 us", "max us", "return codes (count)");
+
+        for (int f = 0; f < TRACE_FUNCTIONS_TOTAL; f++)
+        {
+            const PXL_TRACE_STATS& stats = camera.functions[f];
+            if (0 == stats.calls) continue;
+
+            printf ("  %-24s %10llu %8llu | %10.1f %10.1f %10.1f %10.1f |",
+                    s_pxlTraceFunctionNames[f], (unsigned long long)stats.calls, (unsigned long long)stats.failures,
+                    (double)stats.totalNs / (double)stats.calls / 1000.0,
+                    percentileUs (stats, 0.50), percentileUs (stats, 0.99), (double)stats.maxNs / 1000.0);
+            for (int r = 0; r < PXL_TRACE_RETURN_CODES; r++)
+            {
+                if (TRACE_CODE_USED != stats.returnCodes[r].state) continue;
+                printf (" 0x%08X(%llu)", stats.returnCodes[r].returnCode, (unsigned long long)stats.returnCodes[r].count);
+            }
+            if (stats.otherReturnCodes) printf (" other(%llu)", (unsigned long long)stats.otherReturnCodes);
+            printf ("\n");
+        }
+    }
+}
+
+static void printRecent (const PXL_TRACE_SHARED* pShared, U32 recentCalls)
+{
+    U64 next = pShared->ringNext;
+    U64 count = next < recentCalls ? next : recentCalls;
+    U64 skipped = 0;
+
+    printf ("\n Most recent %llu calls (of %llu):\n", (unsigned long long)count, (unsigned long long)next);
+    printf ("  %12s %8s %-24s %6s %12s %s\n", "start s", "thread", "function", "camera", "duration us", "return code");
+    for (U64 i = next - count; i < next; i++)
+    {
+        // Copy the event, and check that the copy is of call i, and that it wasn't being written while we copied it.
+        const PXL_TRACE_EVENT& slot = pShared->ring[i & (PXL_TRACE_RING_SIZE - 1)];
+        U64 sequence = *(volatile const U64*)&slot.sequence;
+        __sync_synchronize();
+        PXL_TRACE_EVENT event;
+        memcpy (&event, (const void*)&slot, sizeof(event));
+        __sync_synchronize();
+        if (i + 1 != sequence || *(volatile const U64*)&slot.sequence != sequence)
+        {
+            skipped++;
+            continue;
+        }
+        printf ("  %12.6f %8u %-24s %6u %12.1f 0x%08X\n",
+                (double)(event.startNs - pShared->startNs) / 1.0e9, event.thread,
+                event.function < TRACE_FUNCTIONS_TOTAL ? s_pxlTraceFunctionNames[event.function] : "?",
+                event.camera, (double)event.durationNs / 1000.0, event.returnCode);
+    }
+    if (skipped) printf ("  (%llu calls not shown; they were being written, or were overwritten by newer calls, as we read them)\n",
+                         (unsigned long long)skipped);
+}